@@ -31,6 +31,7 @@
 #define BLADE_USB_CMD_QUERY_DEVICE_READY        6
 #define BLADE_USB_CMD_QUERY_FLASH_ID            7
 #define BLADE_USB_CMD_QUERY_FPGA_SOURCE         8
+#define BLADE_USB_CMD_QUERY_FPGA_CHECKSUM       9
 #define BLADE_USB_CMD_FLASH_READ              100
 #define BLADE_USB_CMD_FLASH_WRITE             101
 #define BLADE_USB_CMD_FLASH_ERASE             102
@@ -101,6 +102,53 @@ typedef enum {
     NUAND_FPGA_CONFIG_SOURCE_HOST    = 2  /**< Last FPGA load was from host */
 } NuandFpgaConfigSource;
 
+/**
+ * Checksum of the bitstream most recently streamed to the FPGA, as returned
+ * by BLADE_USB_CMD_QUERY_FPGA_CHECKSUM. All fields are little-endian.
+ *
+ * This is a Fletcher-style checksum over little-endian 32-bit words. It is not
+ * intended to protect against deliberate tampering, only to identify which
+ * image is loaded.
+ */
+struct bladeRF_fpga_checksum {
+    unsigned int length; /**< Number of bytes streamed */
+    unsigned int sum1;   /**< Sum of words */
+    unsigned int sum2;   /**< Sum of running sum1 values */
+};
+
+/**
+ * Accumulate a portion of a bitstream into a checksum. Only the final portion
+ * may have a length that is not a multiple of 4; its trailing bytes are
+ * treated as though they were zero-padded to a full word.
+ */
+static inline void bladeRF_fpga_checksum_update(
+    struct bladeRF_fpga_checksum *c, const unsigned char *data,
+    unsigned int len)
+{
+    unsigned int i;
+
+    for (i = 0; i < len; i += 4) {
+        unsigned int word = data[i];
+
+        if (i + 1 < len) {
+            word |= ((unsigned int)data[i + 1]) << 8;
+        }
+
+        if (i + 2 < len) {
+            word |= ((unsigned int)data[i + 2]) << 16;
+        }
+
+        if (i + 3 < len) {
+            word |= ((unsigned int)data[i + 3]) << 24;
+        }
+
+        c->sum1 += word;
+        c->sum2 += c->sum1;
+    }
+
+    c->length += len;
+}
+
 #define USB_CYPRESS_VENDOR_ID   0x04b4
 #define USB_FX3_PRODUCT_ID      0x00f3
 
@@ -198,6 +198,11 @@ typedef enum {
      *    |      15:8      | count of items in      |
      *    |                | write queue            |
      *    +----------------+------------------------+
+     *    |        2       | 1 if SYNC is supported |
+     *    +----------------+------------------------+
+     *    |        1       | 1 if last job in write |
+     *    |                | queue was successful   |
+     *    +----------------+------------------------+
      *    |        0       | 1 if initialized, 0    |
      *    |                | otherwise              |
      *    +----------------+------------------------+
@@ -273,6 +278,21 @@ typedef enum {
      */
     BLADERF_RFIC_COMMAND_FASTLOCK = 0x0B,
 
+    /** Complete pending write queue jobs. (Read)
+     *
+     * Pass ::BLADERF_CHANNEL_INVALID as the `ch` parameter.
+     *
+     * Executes the jobs in the write queue before responding, rather than
+     * leaving them to the background worker, so that the response is issued
+     * as soon as they have finished. An INIT job is left to the background
+     * worker, as it may take longer than the host is willing to wait for a
+     * response.
+     *
+     * Returns the status register, as per ::BLADERF_RFIC_COMMAND_STATUS,
+     * after the jobs have been executed.
+     */
+    BLADERF_RFIC_COMMAND_SYNC = 0x0C,
+
     /** User-defined functionality (placeholder 1) */
     BLADERF_RFIC_COMMAND_USER_001 = 0x80,
 
@@ -291,6 +311,8 @@ typedef enum {
  *  +---------------+---------------------------------------------------+
  *  |      15:8     | count of items in write queue                     |
  *  +---------------+---------------------------------------------------+
+ *  |        2      | 1 if BLADERF_RFIC_COMMAND_SYNC is supported       |
+ *  +---------------+---------------------------------------------------+
  *  |        1      | 1 if the last job executed in the write queue was |
  *  |               | successful, 0 otherwise                           |
  *  +---------------+---------------------------------------------------+
@@ -302,6 +324,8 @@ typedef enum {
 #define BLADERF_RFIC_STATUS_INIT_MASK        0x1
 #define BLADERF_RFIC_STATUS_WQSUCCESS_SHIFT  1
 #define BLADERF_RFIC_STATUS_WQSUCCESS_MASK   0x1
+#define BLADERF_RFIC_STATUS_SYNC_SHIFT       2
+#define BLADERF_RFIC_STATUS_SYNC_MASK        0x1
 #define BLADERF_RFIC_STATUS_WQLEN_SHIFT      8
 #define BLADERF_RFIC_STATUS_WQLEN_MASK       0xff
 
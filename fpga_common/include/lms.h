@@ -667,6 +667,23 @@ int lms_calculate_tuning_params(unsigned int freq, struct lms_freq *f);
 int lms_set_precalculated_frequency(struct bladerf *dev, bladerf_module mod,
                                     struct lms_freq *f);
 
+/**
+ * Check that the VCOCAP currently in use leaves the PLL's VTUNE in its NORM
+ * region, and search for a new VCOCAP value if it does not
+ *
+ * This is intended to follow a tune with ::LMS_FREQ_FLAGS_FORCE_VCOCAP, when
+ * the forced value may have gone stale.
+ *
+ * @param[in]       dev     Device handle
+ * @param[in]       mod     Module to check
+ * @param[inout]    vcocap  VCOCAP value in use. Updated with the value found
+ *                          by the search, if one was needed.
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_verify_vcocap(struct bladerf *dev, bladerf_module mod,
+                      uint8_t *vcocap);
+
 /**
  * Set the frequency of a module in Hz
  *
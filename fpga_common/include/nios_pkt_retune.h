@@ -243,7 +243,12 @@ static inline void nios_pkt_retune_unpack(const uint8_t *buf,
  * +----------------+---------------------------------------------------------+
  * |       10       | Status Flags (Note 3)                                   |
  * +----------------+---------------------------------------------------------+
- * |      11-15     | Reserved. All bits set to 0.                            |
+ * |       11       | Number of entries in the module's retune queue after    |
+ * |                | handling the request (Note 4)                           |
+ * +----------------+---------------------------------------------------------+
+ * |       12       | Capacity of the module's retune queue (Note 4)          |
+ * +----------------+---------------------------------------------------------+
+ * |      13-15     | Reserved. All bits set to 0.                            |
  * +----------------+---------------------------------------------------------+
  *
  * (Note 1) This value will be zero if timestamps are not running for the
@@ -274,13 +279,18 @@ static inline void nios_pkt_retune_unpack(const uint8_t *buf,
  *                is full.
  *
  *      flags[7:2]    Reserved. Set to 0.
+ *
+ * (Note 4) Firmware that predates these fields sets them to 0. A capacity of
+ *          0 therefore indicates that the queue occupancy is unknown.
  */
 
-#define NIOS_PKT_RETUNERESP_IDX_MAGIC   0
-#define NIOS_PKT_RETUNERESP_IDX_TIME    1
-#define NIOS_PKT_RETUNERESP_IDX_VCOCAP  9
-#define NIOS_PKT_RETUNERESP_IDX_FLAGS   10
-#define NIOS_PKT_RETUNERESP_IDX_RESV    11
+#define NIOS_PKT_RETUNERESP_IDX_MAGIC       0
+#define NIOS_PKT_RETUNERESP_IDX_TIME        1
+#define NIOS_PKT_RETUNERESP_IDX_VCOCAP      9
+#define NIOS_PKT_RETUNERESP_IDX_FLAGS       10
+#define NIOS_PKT_RETUNERESP_IDX_QUEUE_FILL  11
+#define NIOS_PKT_RETUNERESP_IDX_QUEUE_DEPTH 12
+#define NIOS_PKT_RETUNERESP_IDX_RESV        13
 
 #define NIOS_PKT_RETUNERESP_FLAG_TSVTUNE_VALID (1 << 0)
 #define NIOS_PKT_RETUNERESP_FLAG_SUCCESS       (1 << 1)
@@ -288,7 +298,9 @@ static inline void nios_pkt_retune_unpack(const uint8_t *buf,
 static inline void nios_pkt_retune_resp_pack(uint8_t *buf,
                                              uint64_t duration,
                                              uint8_t vcocap,
-                                             uint8_t flags)
+                                             uint8_t flags,
+                                             uint8_t queue_fill,
+                                             uint8_t queue_depth)
 {
     buf[NIOS_PKT_RETUNERESP_IDX_MAGIC] = NIOS_PKT_RETUNE_MAGIC;
 
@@ -305,17 +317,20 @@ static inline void nios_pkt_retune_resp_pack(uint8_t *buf,
 
     buf[NIOS_PKT_RETUNERESP_IDX_FLAGS] = flags;
 
+    buf[NIOS_PKT_RETUNERESP_IDX_QUEUE_FILL]  = queue_fill;
+    buf[NIOS_PKT_RETUNERESP_IDX_QUEUE_DEPTH] = queue_depth;
+
     buf[NIOS_PKT_RETUNERESP_IDX_RESV + 0] = 0x00;
     buf[NIOS_PKT_RETUNERESP_IDX_RESV + 1] = 0x00;
     buf[NIOS_PKT_RETUNERESP_IDX_RESV + 2] = 0x00;
-    buf[NIOS_PKT_RETUNERESP_IDX_RESV + 3] = 0x00;
-    buf[NIOS_PKT_RETUNERESP_IDX_RESV + 4] = 0x00;
 }
 
 static inline void nios_pkt_retune_resp_unpack(const uint8_t *buf,
                                                uint64_t      *duration,
                                                uint8_t       *vcocap,
-                                               uint8_t       *flags)
+                                               uint8_t       *flags,
+                                               uint8_t       *queue_fill,
+                                               uint8_t       *queue_depth)
 {
     *duration  = buf[NIOS_PKT_RETUNERESP_IDX_TIME + 0];
     *duration |= ((uint64_t) buf[NIOS_PKT_RETUNERESP_IDX_TIME + 1]) << 8;
@@ -329,6 +344,9 @@ static inline void nios_pkt_retune_resp_unpack(const uint8_t *buf,
     *vcocap = buf[NIOS_PKT_RETUNERESP_IDX_VCOCAP];
 
     *flags = buf[NIOS_PKT_RETUNERESP_IDX_FLAGS];
+
+    *queue_fill  = buf[NIOS_PKT_RETUNERESP_IDX_QUEUE_FILL];
+    *queue_depth = buf[NIOS_PKT_RETUNERESP_IDX_QUEUE_DEPTH];
 }
 
 #endif
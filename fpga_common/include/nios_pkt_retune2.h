@@ -192,7 +192,12 @@ static inline void nios_pkt_retune2_unpack(const uint8_t *buf,
  * +----------------+---------------------------------------------------------+
  * |        9       | Status Flags (Note 2)                                   |
  * +----------------+---------------------------------------------------------+
- * |      10-15     | Reserved. All bits set to 0.                            |
+ * |       10       | Number of entries in the module's retune queue after    |
+ * |                | handling the request (Note 3)                           |
+ * +----------------+---------------------------------------------------------+
+ * |       11       | Capacity of the module's retune queue (Note 3)          |
+ * +----------------+---------------------------------------------------------+
+ * |      12-15     | Reserved. All bits set to 0.                            |
  * +----------------+---------------------------------------------------------+
  *
  * (Note 1) This value will be zero if timestamps are not running for the
@@ -219,19 +224,26 @@ static inline void nios_pkt_retune2_unpack(const uint8_t *buf,
  *                is full.
  *
  *      flags[7:2]    Reserved. Set to 0.
+ *
+ * (Note 3) Firmware that predates these fields sets them to 0. A capacity of
+ *          0 therefore indicates that the queue occupancy is unknown.
  */
 
-#define NIOS_PKT_RETUNE2_RESP_IDX_MAGIC   0
-#define NIOS_PKT_RETUNE2_RESP_IDX_TIME    1
-#define NIOS_PKT_RETUNE2_RESP_IDX_FLAGS   9
-#define NIOS_PKT_RETUNE2_RESP_IDX_RESV    10
+#define NIOS_PKT_RETUNE2_RESP_IDX_MAGIC       0
+#define NIOS_PKT_RETUNE2_RESP_IDX_TIME        1
+#define NIOS_PKT_RETUNE2_RESP_IDX_FLAGS       9
+#define NIOS_PKT_RETUNE2_RESP_IDX_QUEUE_FILL  10
+#define NIOS_PKT_RETUNE2_RESP_IDX_QUEUE_DEPTH 11
+#define NIOS_PKT_RETUNE2_RESP_IDX_RESV        12
 
 #define NIOS_PKT_RETUNE2_RESP_FLAG_TSVTUNE_VALID (1 << 0)
 #define NIOS_PKT_RETUNE2_RESP_FLAG_SUCCESS       (1 << 1)
 
 static inline void nios_pkt_retune2_resp_pack(uint8_t *buf,
                                               uint64_t duration,
-                                              uint8_t flags)
+                                              uint8_t flags,
+                                              uint8_t queue_fill,
+                                              uint8_t queue_depth)
 {
     buf[NIOS_PKT_RETUNE2_RESP_IDX_MAGIC] = NIOS_PKT_RETUNE2_MAGIC;
 
@@ -246,17 +258,20 @@ static inline void nios_pkt_retune2_resp_pack(uint8_t *buf,
 
     buf[NIOS_PKT_RETUNE2_RESP_IDX_FLAGS] = flags;
 
+    buf[NIOS_PKT_RETUNE2_RESP_IDX_QUEUE_FILL]  = queue_fill;
+    buf[NIOS_PKT_RETUNE2_RESP_IDX_QUEUE_DEPTH] = queue_depth;
+
     buf[NIOS_PKT_RETUNE2_RESP_IDX_RESV + 0] = 0x00;
     buf[NIOS_PKT_RETUNE2_RESP_IDX_RESV + 1] = 0x00;
     buf[NIOS_PKT_RETUNE2_RESP_IDX_RESV + 2] = 0x00;
     buf[NIOS_PKT_RETUNE2_RESP_IDX_RESV + 3] = 0x00;
-    buf[NIOS_PKT_RETUNE2_RESP_IDX_RESV + 4] = 0x00;
-    buf[NIOS_PKT_RETUNE2_RESP_IDX_RESV + 5] = 0x00;
 }
 
 static inline void nios_pkt_retune2_resp_unpack(const uint8_t *buf,
                                                 uint64_t      *duration,
-                                                uint8_t       *flags)
+                                                uint8_t       *flags,
+                                                uint8_t       *queue_fill,
+                                                uint8_t       *queue_depth)
 {
     *duration  = buf[NIOS_PKT_RETUNE2_RESP_IDX_TIME + 0];
     *duration |= ((uint64_t) buf[NIOS_PKT_RETUNE2_RESP_IDX_TIME + 1]) << 8;
@@ -268,6 +283,9 @@ static inline void nios_pkt_retune2_resp_unpack(const uint8_t *buf,
     *duration |= ((uint64_t) buf[NIOS_PKT_RETUNE2_RESP_IDX_TIME + 7]) << 56;
 
     *flags = buf[NIOS_PKT_RETUNE2_RESP_IDX_FLAGS];
+
+    *queue_fill  = buf[NIOS_PKT_RETUNE2_RESP_IDX_QUEUE_FILL];
+    *queue_depth = buf[NIOS_PKT_RETUNE2_RESP_IDX_QUEUE_DEPTH];
 }
 
 #endif
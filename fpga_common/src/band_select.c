@@ -26,6 +26,11 @@
 #include "band_select.h"
 #include "lms.h"
 
+/* The NIOS II PC simulation runs the firmware's variant of this code */
+#if defined(BLADERF_NIOS_PC_SIMULATION) && !defined(BLADERF_NIOS_BUILD)
+#   define BLADERF_NIOS_BUILD
+#endif
+
 int band_select(struct bladerf *dev, bladerf_module module, bool low_band)
 {
     int status;
@@ -51,6 +51,11 @@
 
 #include "lms.h"
 
+/* The NIOS II PC simulation runs the firmware's variant of this code */
+#if defined(BLADERF_NIOS_PC_SIMULATION) && !defined(BLADERF_NIOS_BUILD)
+#   define BLADERF_NIOS_BUILD
+#endif
+
 #ifndef BLADERF_NIOS_BUILD
 #   include "log.h"
 #   include "rel_assert.h"
@@ -1841,7 +1846,17 @@ static inline int write_vcocap(struct bladerf *dev, uint8_t base,
 #define VCO_NORM 0x00
 #define VCO_LOW  0x01
 
-#if defined(LOGGING_ENABLED) || defined(BLADERF_NIOS_DEBUG)
+/* vtune_str() is only used in log_verbose() messages, which the firmware
+ * drops unless its DBG() output is enabled */
+#if defined(BLADERF_NIOS_PC_SIMULATION)
+#   ifndef BLADERF_NIOS_PC_SIMULATION_QUIET
+#       define LMS_LOG_VTUNE
+#   endif
+#elif defined(LOGGING_ENABLED) || defined(BLADERF_NIOS_DEBUG)
+#   define LMS_LOG_VTUNE
+#endif
+
+#ifdef LMS_LOG_VTUNE
 static const char *vtune_str(uint8_t value) {
     switch (value) {
         case VCO_HIGH:
@@ -2415,6 +2430,54 @@ error:
 }
 
 #ifndef BLADERF_NIOS_BUILD
+int lms_verify_vcocap(struct bladerf *dev, bladerf_module mod,
+                      uint8_t *vcocap)
+{
+    const uint8_t base = (mod == BLADERF_MODULE_RX) ? 0x20 : 0x10;
+
+    uint8_t data;
+    uint8_t vcocap_reg_state;
+    uint8_t vtune;
+    int status, dsm_status;
+
+    status = LMS_READ(dev, 0x09, &data);
+    if (status == 0) {
+        data |= 0x05;
+        status = LMS_WRITE(dev, 0x09, data);
+    }
+
+    if (status != 0) {
+        log_debug("Failed to turn on DSMs\n");
+        return status;
+    }
+
+    status = get_vtune(dev, base, VTUNE_DELAY_LARGE, &vtune);
+    if (status != 0 || vtune == VCO_NORM) {
+        goto out;
+    }
+
+    log_verbose("VCOCAP=%u is not in VTUNE NORM region (%s); retuning.\n",
+                *vcocap, vtune_str(vtune));
+
+    status = LMS_READ(dev, base + 9, &vcocap_reg_state);
+    if (status != 0) {
+        goto out;
+    }
+
+    vcocap_reg_state &= ~(0x3f);
+
+    status = tune_vcocap(dev, *vcocap, base, vcocap_reg_state, vcocap);
+
+out:
+    dsm_status = LMS_READ(dev, 0x09, &data);
+    if (dsm_status == 0) {
+        data &= ~(0x05);
+        dsm_status = LMS_WRITE(dev, 0x09, data);
+    }
+
+    return (status == 0) ? dsm_status : status;
+}
+
 int lms_dump_registers(struct bladerf *dev)
 {
     int status = 0;
@@ -470,6 +470,12 @@ CyBool_t NuandHandleVendorRequest(
         CyU3PUsbSendRetCode(ret);
     break;
 
+    case BLADE_USB_CMD_QUERY_FPGA_CHECKSUM:
+        apiRetStatus = CyU3PUsbSendEP0Data(
+            sizeof(struct bladeRF_fpga_checksum),
+            (uint8_t *)NuandGetFpgaChecksum());
+    break;
+
     case BLADE_USB_CMD_SET_LOOPBACK:
         NuandRFLinkLoopBack(wValue);
         CyU3PUsbSendRetCode(wValue);
@@ -42,6 +42,9 @@ static uint16_t glFlipLut[256];
 /* Tracks the last FPGA programmer (SPI flash or USB host) */
 static NuandFpgaConfigSource glFpgaConfigSrc = NUAND_FPGA_CONFIG_SOURCE_INVALID;
 
+/* Checksum of the bitstream streamed since the config interface was started */
+static struct bladeRF_fpga_checksum glFpgaChecksum;
+
 int FpgaBeginProgram(void)
 {
     CyBool_t value;
@@ -82,6 +85,10 @@ static void bladeRFConfigUtoPDmaCallback(CyU3PDmaChannel *chHandle, CyU3PDmaCbTy
         uint8_t *end_in_b = &( ((uint8_t *)input->buffer_p.buffer)[input->buffer_p.count - 1]);
         uint16_t *end_in_w = &( ((uint16_t *)input->buffer_p.buffer)[input->buffer_p.count - 1]);
 
+        /* Checksum the bitstream before it is expanded in place */
+        bladeRF_fpga_checksum_update(&glFpgaChecksum,
+                                     input->buffer_p.buffer,
+                                     input->buffer_p.count);
 
         /* Flip the bits in such a way that the FPGA can be programmed
          * This mapping can be determined by looking at the schematic */
@@ -109,6 +116,7 @@ static void NuandFpgaConfigStart(void)
     bool doUsb = true;
 
     NuandSetFpgaConfigSource(NUAND_FPGA_CONFIG_SOURCE_INVALID);
+    CyU3PMemSet((uint8_t *)&glFpgaChecksum, 0, sizeof(glFpgaChecksum));
 
     NuandAllowSuspend(CyFalse);
 
@@ -397,6 +405,11 @@ void NuandSetFpgaConfigSource(NuandFpgaConfigSource src)
     glFpgaConfigSrc = src;
 }
 
+const struct bladeRF_fpga_checksum *NuandGetFpgaChecksum(void)
+{
+    return &glFpgaChecksum;
+}
+
 const struct NuandApplication NuandFpgaConfig = {
     .start = NuandFpgaConfigStart,
     .stop = NuandFpgaConfigStop,
@@ -30,5 +30,6 @@ int FpgaBeginProgram(void);
 CyBool_t NuandLoadFromFlash(int fpga_len);
 NuandFpgaConfigSource NuandGetFpgaConfigSource(void);
 void NuandSetFpgaConfigSource(NuandFpgaConfigSource src);
+const struct bladeRF_fpga_checksum *NuandGetFpgaChecksum(void);
 
 #endif /* _FPGA_H_ */
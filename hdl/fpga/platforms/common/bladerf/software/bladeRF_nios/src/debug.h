@@ -29,7 +29,13 @@
 #ifdef BLADERF_NIOS_PC_SIMULATION
 #   include <stdio.h>
 
+/* Define BLADERF_NIOS_PC_SIMULATION_QUIET to suppress output when running
+ * the simulation inside another program (e.g., libbladeRF) */
+#ifdef BLADERF_NIOS_PC_SIMULATION_QUIET
+#   define DBG(...) do {} while (0)
+#else
 #   define DBG(...) fprintf(stderr,  __VA_ARGS__)
+#endif
 
     /* Always keep assert() enabled for PC simulation */
 #   ifdef NDEBUG
@@ -50,6 +56,10 @@ static inline void print_bytes(const char *msg, const uint8_t *bytes, size_t n)
 {
     size_t i;
 
+#ifdef BLADERF_NIOS_PC_SIMULATION_QUIET
+    return;
+#endif
+
     if (msg != NULL) {
         puts(msg);
     }
@@ -99,14 +99,6 @@
 #   define VT_STAT_ERR_10S   (1<<1)
 #   define VT_STAT_ERR_100S  (1<<2)
 
-/* Number of RFFE fast lock profiles to store in the Nios.
- * Make sure this matches what is defined in bladerf2.c.
- */
-#define NUM_BBP_FASTLOCK_PROFILES  256
-
-/* Number of fast lock profiles that can be stored in the RFFE */
-#define NUM_RFFE_FASTLOCK_PROFILES 8
-
 /* Enable libad936x if we have enough RAM. Note that it is very important
  * that all calls to ad9361_* be ifdef-wrapped! */
 #   if RAM_SPAN >= 131072
@@ -118,6 +110,20 @@
     void SIMULATION_FLUSH_UART();
 #endif
 
+/* Number of RFFE fast lock profiles to store in the Nios.
+ * Make sure this matches what is defined in bladerf2.c.
+ */
+#define NUM_BBP_FASTLOCK_PROFILES  256
+
+/* Number of fast lock profiles that can be stored in the RFFE */
+#define NUM_RFFE_FASTLOCK_PROFILES 8
+
+/* RFIC commands are handled by libad936x on the NIOS II, and are forwarded to
+ * the host's simulated RFIC in the PC simulation */
+#if defined(BLADERF_NIOS_LIBAD936X) || defined(BLADERF_NIOS_PC_SIMULATION)
+#   define BLADERF_NIOS_RFIC_COMMANDS
+#endif
+
 /* Define a global variable containing the current VCTCXO DAC setting.
  * This is a 'cached' value of what is written to the DAC and is used
  * for the calibration algorithm to avoid unnecessary read requests
@@ -373,6 +379,22 @@ INLINE uint32_t control_reg_read(void);
  */
 INLINE void control_reg_write(uint32_t value);
 
+#ifdef BLADERF_NIOS_PC_SIMULATION
+/**
+ * Read the RFFE control/status register
+ *
+ * @return RFFE control bit map
+ */
+uint32_t rffe_csr_read(void);
+
+/**
+ * Write the RFFE control/status register
+ *
+ * @param   value   RFFE control bit map
+ */
+void rffe_csr_write(uint32_t value);
+#endif
+
 /**
  * Get IQ balance gain value
  *
@@ -593,6 +615,9 @@ void rfic_command_init(void);
  * Do background RFIC command processing.
  */
 void rfic_command_work(void);
+#endif  // BLADERF_NIOS_LIBAD936X
+
+#ifdef BLADERF_NIOS_RFIC_COMMANDS
 
 /**
  * RFIC command write (queuing)
@@ -617,7 +642,7 @@ bool rfic_command_write(uint16_t addr, uint64_t data);
  * @return bool (true = success)
  */
 bool rfic_command_read(uint16_t addr, uint64_t *data);
-#endif  // BLADERF_NIOS_LIBAD936X
+#endif  // BLADERF_NIOS_RFIC_COMMANDS
 
 /* A number of rountines define here are implemented as just a register
  * access, where incurring function call overhead is wasteful. Therefore,
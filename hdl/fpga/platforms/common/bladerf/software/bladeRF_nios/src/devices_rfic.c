@@ -62,6 +62,10 @@ struct rfic_command_fns {
     uint8_t command;
 };
 
+static bool _rfic_cmd_rd_sync(struct rfic_state *state,
+                              bladerf_channel channel,
+                              uint64_t *status);
+
 /**
  * Function pointers for command dispatching
  */
@@ -144,6 +148,11 @@ struct rfic_command_fns const funcs[] = {
         FIELD_INIT(.bitmask,
             RFIC_CMD_INIT_REQD | RFIC_CMD_CHAN_TX | RFIC_CMD_CHAN_RX),
     },
+    {
+        FIELD_INIT(.command, BLADERF_RFIC_COMMAND_SYNC),
+        FIELD_INIT(.read64, _rfic_cmd_rd_sync),
+        FIELD_INIT(.bitmask, RFIC_CMD_CHAN_SYSTEM),
+    },
     // clang-format on
 };
 
@@ -227,6 +236,9 @@ static bool _check_validity(struct rfic_command_fns const *cmd_ptr,
  *
  * Sets e->rv to 0xFE if there is no write handler for the command.
  *
+ * A new job is executed and retired in a single pass, so that its completion
+ * is visible to the host as soon as possible.
+ *
  * @param      q     rfic_queue pointer
  */
 static void rfic_command_work_wq(struct rfic_queue *q)
@@ -246,10 +258,9 @@ static void rfic_command_work_wq(struct rfic_queue *q)
     }
 
     switch (e->state) {
-        case ENTRY_STATE_NEW: {
+        case ENTRY_STATE_NEW:
             e->state = ENTRY_STATE_RUNNING;
-            break;
-        }
+            /* Fall through */
 
         case ENTRY_STATE_RUNNING: {
             struct rfic_command_fns const *f = _get_cmd_ptr(e->cmd);
@@ -263,7 +274,7 @@ static void rfic_command_work_wq(struct rfic_queue *q)
                 e->rv = f->write32(&state, e->ch, e->value);
             }
 
-            break;
+            /* Fall through */
         }
 
         case ENTRY_STATE_COMPLETE: {
@@ -278,6 +289,30 @@ static void rfic_command_work_wq(struct rfic_queue *q)
     }
 }
 
+/**
+ * @brief      Execute pending write queue jobs, then read the status register
+ *
+ * Stops short of an INIT job, which is left to the background worker since it
+ * may run for longer than the host's request timeout.
+ *
+ * @param[out] status  Status register value
+ *
+ * @return     true if successful, false if not
+ */
+static bool _rfic_cmd_rd_sync(struct rfic_state *state,
+                              bladerf_channel channel,
+                              uint64_t *status)
+{
+    struct rfic_queue_entry *e;
+
+    while (NULL != (e = rfic_queue_peek(&state->write_queue)) &&
+           BLADERF_RFIC_COMMAND_INIT != e->cmd) {
+        rfic_command_work_wq(&state->write_queue);
+    }
+
+    return _rfic_cmd_rd_status(state, channel, status);
+}
+
 bool rfic_command_write(uint16_t addr, uint64_t data)
 {
     uint8_t cmd                      = _rfic_unpack_cmd(addr);
@@ -286,7 +286,9 @@ bool _rfic_cmd_rd_status(struct rfic_state *state,
                << BLADERF_RFIC_STATUS_WQLEN_SHIFT) |
 
               ((state->write_queue.last_rv & BLADERF_RFIC_STATUS_WQSUCCESS_MASK)
-               << BLADERF_RFIC_STATUS_WQSUCCESS_SHIFT);
+               << BLADERF_RFIC_STATUS_WQSUCCESS_SHIFT) |
+
+              (BLADERF_RFIC_STATUS_SYNC_MASK << BLADERF_RFIC_STATUS_SYNC_SHIFT);
 
     return true;
 }
@@ -39,11 +39,11 @@ static inline bool perform_write(uint8_t id, uint16_t addr, uint64_t data)
             break;
 #endif  // BOARD_BLADERF_MICRO
 
-#ifdef BLADERF_NIOS_LIBAD936X
+#ifdef BLADERF_NIOS_RFIC_COMMANDS
         case NIOS_PKT_16x64_TARGET_RFIC:
             success = rfic_command_write(addr, data);
             break;
-#endif  // BLADERF_NIOS_LIBAD936X
+#endif  // BLADERF_NIOS_RFIC_COMMANDS
 
         /* Add user customizations here
 
@@ -72,11 +72,11 @@ static inline bool perform_read(uint8_t id, uint16_t addr, uint64_t *data)
             break;
 #endif  // BOARD_BLADERF_MICRO
 
-#ifdef BLADERF_NIOS_LIBAD936X
+#ifdef BLADERF_NIOS_RFIC_COMMANDS
         case NIOS_PKT_16x64_TARGET_RFIC:
             success = rfic_command_read(addr, data);
             break;
-#endif  // BLADERF_NIOS_LIBAD936X
+#endif  // BLADERF_NIOS_RFIC_COMMANDS
 
         /* Add user customizations here
 
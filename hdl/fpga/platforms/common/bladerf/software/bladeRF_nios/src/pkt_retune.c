@@ -37,8 +37,16 @@
 #   define INCREMENT_ERROR_COUNT() do {} while (0)
 #endif
 
-/* The enqueue/dequeue routines require that this be a power of two */
-#define RETUNE_QUEUE_MAX    16
+/* The enqueue/dequeue routines require that this be a power of two. It may be
+ * overridden at build time, up to 128 entries. */
+#ifndef RETUNE_QUEUE_MAX
+#   define RETUNE_QUEUE_MAX 32
+#endif
+
+#if (RETUNE_QUEUE_MAX & (RETUNE_QUEUE_MAX - 1)) != 0 || RETUNE_QUEUE_MAX > 128
+#   error "RETUNE_QUEUE_MAX must be a power of two, no greater than 128"
+#endif
+
 #define QUEUE_FULL          0xff
 #define QUEUE_EMPTY         0xfe
 
@@ -102,7 +110,7 @@ static inline uint8_t dequeue_retune(struct queue *q, struct queue_entry *e)
     }
 
     if (e != NULL) {
-        memcpy(&e, &q->entries[q->rem_idx], sizeof(e[0]));
+        memcpy(e, &q->entries[q->rem_idx], sizeof(e[0]));
     }
 
     q->rem_idx = (q->rem_idx + 1) & (RETUNE_QUEUE_MAX - 1);
@@ -113,6 +121,19 @@ static inline uint8_t dequeue_retune(struct queue *q, struct queue_entry *e)
     return ret;
 }
 
+/* Number of entries in a module's retune queue */
+static inline uint8_t queue_fill(bladerf_module module)
+{
+    switch (module) {
+        case BLADERF_MODULE_RX:
+            return rx_queue.count;
+        case BLADERF_MODULE_TX:
+            return tx_queue.count;
+        default:
+            return 0;
+    }
+}
+
 /* Get the state of the next item in the retune queue */
 static inline struct queue_entry * peek_next_retune(struct queue *q)
 {
@@ -171,6 +192,11 @@ static void retune_tx(void *context)
     /* Clear the interrupt */
     timer_tamer_clear_interrupt(BLADERF_MODULE_TX);
 }
+#else
+void pkt_retune_isr(bladerf_module module)
+{
+    retune_isr(module == BLADERF_MODULE_RX ? &rx_queue : &tx_queue);
+}
 #endif
 
 
@@ -409,5 +435,6 @@ out:
         flags &= ~(NIOS_PKT_RETUNERESP_FLAG_SUCCESS);
     }
 
-    nios_pkt_retune_resp_pack(b->resp, duration, f.vcocap_result, flags);
+    nios_pkt_retune_resp_pack(b->resp, duration, f.vcocap_result, flags,
+                              queue_fill(module), RETUNE_QUEUE_MAX);
 }
@@ -34,6 +34,11 @@ void pkt_retune(struct pkt_buf *b);
 
 void pkt_retune_work(void);
 
+#ifdef BLADERF_NIOS_PC_SIMULATION
+/* Simulates the time tamer interrupt for the specified module */
+void pkt_retune_isr(bladerf_module module);
+#endif
+
 #define PKT_RETUNE { \
     .magic          = NIOS_PKT_RETUNE_MAGIC, \
     .init           = pkt_retune_init, \
@@ -40,8 +40,16 @@ void rfic_invalidate_frequency(bladerf_module module);
 #   define INCREMENT_ERROR_COUNT() do {} while (0)
 #endif
 
-/* The enqueue/dequeue routines require that this be a power of two */
-#define RETUNE2_QUEUE_MAX   16
+/* The enqueue/dequeue routines require that this be a power of two. It may be
+ * overridden at build time, up to 128 entries. */
+#ifndef RETUNE2_QUEUE_MAX
+#   define RETUNE2_QUEUE_MAX 64
+#endif
+
+#if (RETUNE2_QUEUE_MAX & (RETUNE2_QUEUE_MAX - 1)) != 0 || RETUNE2_QUEUE_MAX > 128
+#   error "RETUNE2_QUEUE_MAX must be a power of two, no greater than 128"
+#endif
+
 #define QUEUE_FULL          0xff
 #define QUEUE_EMPTY         0xfe
 
@@ -105,7 +113,7 @@ static inline uint8_t dequeue_retune(struct queue *q, struct queue_entry *e)
     }
 
     if (e != NULL) {
-        memcpy(&e, &q->entries[q->rem_idx], sizeof(e[0]));
+        memcpy(e, &q->entries[q->rem_idx], sizeof(e[0]));
     }
 
     q->entries[q->rem_idx].state = ENTRY_STATE_DONE;
@@ -117,6 +125,19 @@ static inline uint8_t dequeue_retune(struct queue *q, struct queue_entry *e)
     return ret;
 }
 
+/* Number of entries in a module's retune queue */
+static inline uint8_t queue_fill(bladerf_module module)
+{
+    switch (module) {
+        case BLADERF_MODULE_RX:
+            return rx_queue.count;
+        case BLADERF_MODULE_TX:
+            return tx_queue.count;
+        default:
+            return 0;
+    }
+}
+
 /* Get the state of the next item in the retune queue */
 static inline struct queue_entry* peek_next_retune(struct queue *q)
 {
@@ -250,6 +271,11 @@ static void retune_tx(void *context)
     /* Clear the interrupt */
     timer_tamer_clear_interrupt(BLADERF_MODULE_TX);
 }
+#else
+void pkt_retune2_isr(bladerf_module module)
+{
+    retune_isr(module == BLADERF_MODULE_RX ? &rx_queue : &tx_queue);
+}
 #endif
 
 
@@ -443,5 +469,6 @@ void pkt_retune2(struct pkt_buf *b)
         flags &= ~(NIOS_PKT_RETUNE2_RESP_FLAG_SUCCESS);
     }
 
-    nios_pkt_retune2_resp_pack(b->resp, duration, flags);
+    nios_pkt_retune2_resp_pack(b->resp, duration, flags,
+                               queue_fill(module), RETUNE2_QUEUE_MAX);
 }
@@ -34,6 +34,11 @@ void pkt_retune2(struct pkt_buf *b);
 
 void pkt_retune2_work(void);
 
+#ifdef BLADERF_NIOS_PC_SIMULATION
+/* Simulates the time tamer interrupt for the specified module */
+void pkt_retune2_isr(bladerf_module module);
+#endif
+
 #define PKT_RETUNE2 { \
     .magic          = NIOS_PKT_RETUNE2_MAGIC, \
     .init           = pkt_retune2_init, \
@@ -249,6 +249,9 @@ void sc16q11_to_float(const int16_t *in, float *out, unsigned int n);
  * Therefore, the caller must ensure the output buffer large enough to contain
  * 2*n int16_t's (or 2*n*sizeof(int16_t) bytes).
  *
+ * Values are rounded to the nearest integer and saturated to the SC16Q11
+ * range of [-2048, 2047].
+ *
  * @param[in]   in      Input buffer containing float samples
  * @param[out]  out     Output buffer of int16_t values
  * @param[in]   n       Number of samples to convert
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <stdbool.h>
+
+/**
+ * Precomputed tables for complex FFTs of one size
+ */
+struct fft_plan;
+
+/**
+ * Create a plan for forward FFTs of `n` points.
+ *
+ * @param[in]   n       FFT size. Must be a power of two, and at least 2.
+ *
+ * @return Plan on success, NULL if `n` is invalid or memory allocation fails
+ */
+struct fft_plan *fft_plan_create(unsigned int n);
+
+/**
+ * Free a plan created by fft_plan_create()
+ *
+ * @param       plan    Plan to free. May be NULL.
+ */
+void fft_plan_free(struct fft_plan *plan);
+
+/**
+ * Compute a forward FFT in place. The data is split into separate real and
+ * imaginary arrays, so that butterflies operate on contiguous values.
+ *
+ * @param[in]       plan    Plan
+ * @param[inout]    re      Real parts of the `n` points
+ * @param[inout]    im      Imaginary parts of the `n` points
+ */
+void fft_execute(const struct fft_plan *plan, float *re, float *im);
+
+/**
+ * @return true if fft_execute() uses SIMD instructions
+ */
+bool fft_is_vectorized(void);
+
+#endif
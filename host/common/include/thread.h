@@ -103,6 +103,7 @@
 
 #   define COND_INIT(m) pthread_cond_init(m, NULL)
 #   define COND_SIGNAL(m) pthread_cond_signal(m)
+#   define COND_BROADCAST(m) pthread_cond_broadcast(m)
 // POSIX implementation as a function
 static inline int posix_cond_timedwait(pthread_cond_t *c,
                                        pthread_mutex_t *m,
@@ -177,6 +178,7 @@ static inline int posix_cond_timedwait(pthread_cond_t *c,
 
 #   define COND_INIT(m) (InitializeConditionVariable(m), 0)
 #   define COND_SIGNAL(m) WakeConditionVariable(m)
+#   define COND_BROADCAST(m) WakeAllConditionVariable(m)
 #   define COND_TIMED_WAIT(c, m, t) \
         (SleepConditionVariableCS(c, m, t) ? 0 : GetLastError())
 #   define COND_WAIT(c, m) (!SleepConditionVariableCS(c, m, INFINITE))
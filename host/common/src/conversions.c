@@ -413,22 +413,14 @@ const char *backend_description(bladerf_backend b)
 
 void sc16q11_to_float(const int16_t *in, float *out, unsigned int n)
 {
-    unsigned int i;
-
-    for (i = 0; i < (2 * n); i += 2) {
-        out[i]     = (float)in[i] * (1.0f / 2048.0f);
-        out[i + 1] = (float)in[i + 1] * (1.0f / 2048.0f);
-    }
+    bladerf_convert_samples(BLADERF_SAMPLE_SC16, in, BLADERF_SAMPLE_CF32, out,
+                            n);
 }
 
 void float_to_sc16q11(const float *in, int16_t *out, unsigned int n)
 {
-    unsigned int i;
-
-    for (i = 0; i < (2 * n); i += 2) {
-        out[i]     = (int16_t)(in[i] * 2048.0f);
-        out[i + 1] = (int16_t)(in[i + 1] * 2048.0f);
-    }
+    bladerf_convert_samples(BLADERF_SAMPLE_CF32, in, BLADERF_SAMPLE_SC16, out,
+                            n);
 }
 
 bladerf_cal_module str_to_bladerf_cal_module(const char *str)
@@ -28,6 +28,15 @@
 #define _USE_MATH_DEFINES /* Required for MSVC */
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TX_CAL_SSE2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TX_CAL_NEON 1
+#endif
+
 #include <libbladeRF.h>
 
 #include "dc_calibration.h"
@@ -308,6 +317,116 @@ static int rx_samples(struct bladerf *dev, int16_t *samples,
     return status;
 }
 
+/* Ensure the next capture starts `settle` samples after the settings written
+ * so far. Control writes have completed once they return, so rather than
+ * leaving a fixed, worst-case gap between captures, the next capture is
+ * started shortly after the device's current timestamp. */
+static int ts_after_writes(struct bladerf *dev, uint64_t *ts, uint64_t settle)
+{
+    int status;
+    uint64_t now;
+
+    status = bladerf_get_timestamp(dev, BLADERF_MODULE_RX, &now);
+    if (status == 0 && *ts < now + settle) {
+        *ts = now + settle;
+    }
+
+    return status;
+}
+
+/* Search for the correction value that minimizes an error measurement, given
+ * that the error has a single minimum over the search range.
+ *
+ * Starting from an estimate, the search walks in one direction while the error
+ * decreases, and stops once it has risen for CORR_SEARCH_RISES consecutive
+ * points. If the first direction yields no improvement, the other direction is
+ * walked instead. This typically requires a handful of measurements, rather
+ * than a sweep of the whole range around the estimate. */
+#define CORR_SEARCH_RISES 2
+
+struct corr_search {
+    int16_t corr;           /* Value to measure next */
+    int16_t start;          /* Initial estimate */
+    int16_t step;           /* Signed increment */
+    int16_t min, max;       /* Range to search */
+
+    int16_t best_corr;
+    float best_err;
+
+    unsigned int rises;     /* Consecutive measurements above best_err */
+    bool reversed;
+    bool done;
+};
+
+/* The search range is limited to the valid correction values, [-2048, 2048] */
+static void corr_search_init(struct corr_search *s, int16_t start,
+                             int16_t step, int min, int max)
+{
+    if (min < -2048) {
+        min = -2048;
+    }
+
+    if (max > 2048) {
+        max = 2048;
+    }
+
+    if (start < min) {
+        start = min;
+    } else if (start > max) {
+        start = max;
+    }
+
+    s->corr      = start;
+    s->start     = start;
+    s->step      = step;
+    s->min       = (int16_t)min;
+    s->max       = (int16_t)max;
+    s->best_corr = start;
+    s->best_err  = 2048;
+    s->rises     = 0;
+    s->reversed  = false;
+    s->done      = false;
+}
+
+/* Record the error measured at s->corr, and select the next value */
+static void corr_search_update(struct corr_search *s, float err)
+{
+    int next;
+
+    if (err < 0) {
+        err = -err;
+    }
+
+    if (err < s->best_err) {
+        s->best_err  = err;
+        s->best_corr = s->corr;
+        s->rises     = 0;
+    } else {
+        s->rises++;
+    }
+
+    next = s->corr + s->step;
+
+    if (s->rises >= CORR_SEARCH_RISES || next < s->min || next > s->max) {
+        if (!s->reversed && s->best_corr == s->start) {
+            s->reversed = true;
+            s->rises    = 0;
+            s->step     = -s->step;
+
+            next = s->start + s->step;
+            if (next >= s->min && next <= s->max) {
+                s->corr = (int16_t)next;
+                return;
+            }
+        }
+
+        s->done = true;
+        s->corr = s->best_corr;
+    } else {
+        s->corr = (int16_t)next;
+    }
+}
+
 
 
 /*******************************************************************************
@@ -319,19 +438,31 @@ static int rx_samples(struct bladerf *dev, int16_t *samples,
 #define RX_CAL_TS_INC           (MS_TO_SAMPLES(15, RX_CAL_RATE))
 #define RX_CAL_COUNT            (MS_TO_SAMPLES(5,  RX_CAL_RATE))
 
+/* Time allowed for correction and gain writes to settle before a capture */
+#define RX_CAL_SETTLE           (MS_TO_SAMPLES(2,  RX_CAL_RATE))
+
+/* Time allowed for a scheduled retune to complete before a capture */
+#define RX_CAL_RETUNE_SETTLE    (MS_TO_SAMPLES(4,  RX_CAL_RATE))
+
 #define RX_CAL_MAX_SWEEP_LEN    (2 * 2048 / 32) /* -2048 : 32 : 2048 */
 
+/* Correction range searched on either side of the coarse estimates */
+#define RX_CAL_SEARCH_SPAN      (12 * 32)
+
 struct rx_cal {
     struct bladerf *dev;
 
     int16_t *samples;
     unsigned int num_samples;
 
-    int16_t *corr_sweep;
-
     uint64_t ts;
 
     uint64_t tx_freq;
+    uint64_t rx_freq;
+
+    /* A retune to the next frequency has been scheduled at retune_ts */
+    bool retune_scheduled;
+    uint64_t retune_ts;
 };
 
 struct rx_cal_backup {
@@ -387,11 +518,9 @@ static int set_rx_cal_backup(struct bladerf *dev, struct rx_cal_backup *b)
     return retval;
 }
 
-/* Ensure TX >= 1 MHz away from the RX frequency to avoid any potential
- * artifacts from the PLLs interfering with one another */
-static int rx_cal_update_frequency(struct rx_cal *cal, uint64_t rx_freq)
+/* TX must be moved if it is not >= 1 MHz away from the RX frequency */
+static bool rx_cal_tx_conflicts(const struct rx_cal *cal, uint64_t rx_freq)
 {
-    int status = 0;
     uint64_t f_diff;
 
     if (rx_freq < cal->tx_freq) {
@@ -400,10 +529,77 @@ static int rx_cal_update_frequency(struct rx_cal *cal, uint64_t rx_freq)
         f_diff = rx_freq - cal->tx_freq;
     }
 
-    PR_DBG("Set F_RX = %u\n", rx_freq);
-    PR_DBG("F_diff(RX, TX) = %u\n", f_diff);
+    PR_DBG("F_diff(RX, TX) = %" PRIu64 "\n", f_diff);
+
+    return f_diff < 1000000;
+}
+
+/* Schedule a retune to the next frequency at the end of a capture starting at
+ * `ts`, so that it is performed while that capture streams, rather than after
+ * it has been received. This is skipped if TX must be moved first, or if the
+ * FPGA does not support scheduled retunes. */
+static void rx_cal_schedule_frequency(struct rx_cal *cal, uint64_t rx_freq,
+                                      uint64_t ts)
+{
+    int status;
+
+    if (rx_freq == 0 || rx_cal_tx_conflicts(cal, rx_freq)) {
+        return;
+    }
+
+    ts += cal->num_samples;
+
+    status = bladerf_schedule_retune(cal->dev, BLADERF_MODULE_RX, ts,
+                                     rx_freq, NULL);
+    if (status == 0) {
+        PR_DBG("Scheduled F_RX = %" PRIu64 " @ %" PRIu64 "\n", rx_freq, ts);
+        cal->retune_scheduled = true;
+        cal->retune_ts        = ts;
+    }
+}
+
+/* Drop a scheduled retune, returning to the current frequency in case the
+ * retune has already been performed */
+static int rx_cal_unschedule_frequency(struct rx_cal *cal)
+{
+    int status;
 
-    if (f_diff < 1000000) {
+    status = bladerf_cancel_scheduled_retunes(cal->dev, BLADERF_MODULE_RX);
+    if (status != 0) {
+        return status;
+    }
+
+    cal->retune_scheduled = false;
+
+    status = bladerf_set_frequency(cal->dev, BLADERF_MODULE_RX, cal->rx_freq);
+    if (status != 0) {
+        return status;
+    }
+
+    return ts_after_writes(cal->dev, &cal->ts, RX_CAL_RETUNE_SETTLE);
+}
+
+/* Ensure TX >= 1 MHz away from the RX frequency to avoid any potential
+ * artifacts from the PLLs interfering with one another */
+static int rx_cal_update_frequency(struct rx_cal *cal, uint64_t rx_freq)
+{
+    int status = 0;
+
+    PR_DBG("Set F_RX = %" PRIu64 "\n", rx_freq);
+
+    cal->rx_freq = rx_freq;
+
+    if (cal->retune_scheduled) {
+        cal->retune_scheduled = false;
+
+        if (cal->ts < cal->retune_ts + RX_CAL_RETUNE_SETTLE) {
+            cal->ts = cal->retune_ts + RX_CAL_RETUNE_SETTLE;
+        }
+
+        return 0;
+    }
+
+    if (rx_cal_tx_conflicts(cal, rx_freq)) {
         if (rx_freq >= (BLADERF_FREQUENCY_MIN + 1000000)) {
             cal->tx_freq = rx_freq - 1000000;
         } else {
@@ -416,7 +612,7 @@ static int rx_cal_update_frequency(struct rx_cal *cal, uint64_t rx_freq)
             return status;
         }
 
-        PR_DBG("Adjusted TX frequency: %u\n", cal->tx_freq);
+        PR_DBG("Adjusted TX frequency: %" PRIu64 "\n", cal->tx_freq);
     }
 
     status = bladerf_set_frequency(cal->dev, BLADERF_MODULE_RX, rx_freq);
@@ -424,9 +620,7 @@ static int rx_cal_update_frequency(struct rx_cal *cal, uint64_t rx_freq)
         return status;
     }
 
-    cal->ts += RX_CAL_TS_INC;
-
-    return status;
+    return ts_after_writes(cal->dev, &cal->ts, RX_CAL_RETUNE_SETTLE);
 }
 
 static inline void sample_mean(int16_t *samples, size_t count,
@@ -486,8 +680,13 @@ static int rx_cal_coarse_means(struct rx_cal *cal, int16_t *corr_value,
             return status;
         }
 
+        status = ts_after_writes(cal->dev, &cal->ts, RX_CAL_SETTLE);
+        if (status != 0) {
+            return status;
+        }
+
         status = rx_samples(cal->dev, cal->samples, cal->num_samples,
-                            &cal->ts, RX_CAL_TS_INC);
+                            &cal->ts, RX_CAL_SETTLE);
         if (status != 0) {
             return status;
         }
@@ -583,50 +782,6 @@ static int rx_cal_coarse_estimate(struct rx_cal *cal,
     return 0;
 }
 
-static void init_rx_cal_sweep(int16_t *corr, unsigned int *sweep_len,
-                              int16_t i_est, int16_t q_est)
-{
-    unsigned int actual_len = 0;
-    unsigned int i;
-
-    int16_t sweep_min, sweep_max, sweep_val;
-
-    /* LMS6002D RX DC calibrations have a limited range. libbladeRF throws away
-     * the lower 5 bits. */
-    const int16_t sweep_inc = 32;
-
-    const int16_t min_est = (i_est < q_est) ? i_est : q_est;
-    const int16_t max_est = (i_est > q_est) ? i_est : q_est;
-
-    sweep_min = min_est - 12 * 32;
-    if (sweep_min < -2048) {
-        sweep_min = -2048;
-    }
-
-    sweep_max = max_est + 12 * 32;
-    if (sweep_max > 2048) {
-        sweep_max = 2048;
-    }
-
-    /* Given that these lower bits are thrown away, it can be confusing to
-     * see that values change in their LSBs that don't matter. Therefore,
-     * we'll adjust to muliples of sweep_inc */
-    sweep_min = (sweep_min / 32) * 32;
-    sweep_max = (sweep_max / 32) * 32;
-
-
-    PR_DBG("Sweeping [%d : %d : %d]\n", sweep_min, sweep_inc, sweep_max);
-
-    sweep_val = sweep_min;
-    for (i = 0; sweep_val < sweep_max && i < RX_CAL_MAX_SWEEP_LEN; i++) {
-        corr[i] = sweep_val;
-        sweep_val += sweep_inc;
-        actual_len++;
-    }
-
-    *sweep_len = actual_len;
-}
-
 static int save_gains(struct rx_cal *cal, struct gain_mode *gain) {
     int status;
 
@@ -669,10 +824,13 @@ static int load_gains(struct rx_cal *cal, struct gain_mode *gain) {
     return status;
 }
 
+/* If next_freq is non-zero, the retune to it is scheduled to follow this
+ * measurement's capture */
 static int rx_cal_dc_off(struct rx_cal *cal, struct gain_mode *gains,
-                        int16_t *dc_i, int16_t *dc_q)
+                         uint64_t next_freq, int16_t *dc_i, int16_t *dc_q)
 {
     int status = BLADERF_ERR_UNEXPECTED;
+    uint64_t start;
 
     float mean_i, mean_q;
 
@@ -681,12 +839,41 @@ static int rx_cal_dc_off(struct rx_cal *cal, struct gain_mode *gains,
         return status;
     }
 
+    status = ts_after_writes(cal->dev, &cal->ts, RX_CAL_SETTLE);
+    if (status != 0) {
+        return status;
+    }
+
+    start = cal->ts;
+    rx_cal_schedule_frequency(cal, next_freq, start);
+
     status = rx_samples(cal->dev, cal->samples, cal->num_samples,
-                        &cal->ts, RX_CAL_TS_INC);
+                        &cal->ts, RX_CAL_SETTLE);
     if (status != 0) {
         return status;
     }
 
+    /* rx_samples() moves the capture later if it was too late to start it
+     * on time, or if it overran. The retune would then have been performed
+     * during (or before) the capture, so drop it and capture again. The next
+     * frequency is then tuned as usual, once this one is done. */
+    if (cal->retune_scheduled &&
+        cal->ts - cal->num_samples - RX_CAL_SETTLE != start) {
+        PR_DBG("Capture moved from %" PRIu64 "; dropping scheduled retune\n",
+               start);
+
+        status = rx_cal_unschedule_frequency(cal);
+        if (status != 0) {
+            return status;
+        }
+
+        status = rx_samples(cal->dev, cal->samples, cal->num_samples,
+                            &cal->ts, RX_CAL_SETTLE);
+        if (status != 0) {
+            return status;
+        }
+    }
+
     sample_mean(cal->samples, cal->num_samples, &mean_i, &mean_q);
     *dc_i = float_to_int16(mean_i);
     *dc_q = float_to_int16(mean_q);
@@ -694,72 +881,79 @@ static int rx_cal_dc_off(struct rx_cal *cal, struct gain_mode *gains,
     return 0;
 }
 
-static int rx_cal_sweep(struct rx_cal *cal,
-                        int16_t *corr, unsigned int sweep_len,
-                        int16_t *result_i, int16_t *result_q,
-                        float *error_i,  float *error_q)
+/* Search for the I and Q correction values yielding the smallest DC offsets.
+ * I and Q are independent, so both are searched with the same captures. */
+static int rx_cal_search(struct rx_cal *cal, int16_t i_est, int16_t q_est,
+                         int16_t *result_i, int16_t *result_q,
+                         float *error_i,  float *error_q)
 {
     int status = BLADERF_ERR_UNEXPECTED;
     unsigned int n;
+    struct corr_search si, sq;
+    float mean_i, mean_q;
 
-    int16_t min_corr_i = 0;
-    int16_t min_corr_q = 0;
+    /* LMS6002D RX DC calibrations have a limited range. libbladeRF throws away
+     * the lower 5 bits, so the search moves in multiples of 32. The estimates
+     * are truncated toward zero, so start by moving away from zero. */
+    const int16_t i_start = (i_est / 32) * 32;
+    const int16_t q_start = (q_est / 32) * 32;
 
-    float mean_i, mean_q;
-    float min_val_i, min_val_q;
+    corr_search_init(&si, i_start, (i_est < 0) ? -32 : 32,
+                     i_start - RX_CAL_SEARCH_SPAN,
+                     i_start + RX_CAL_SEARCH_SPAN);
 
-    min_val_i = min_val_q = 2048;
+    corr_search_init(&sq, q_start, (q_est < 0) ? -32 : 32,
+                     q_start - RX_CAL_SEARCH_SPAN,
+                     q_start + RX_CAL_SEARCH_SPAN);
+
+    for (n = 0; n < RX_CAL_MAX_SWEEP_LEN && !(si.done && sq.done); n++) {
+        status = set_rx_dc_corr(cal->dev, si.corr, sq.corr);
+        if (status != 0) {
+            return status;
+        }
 
-    for (n = 0; n < sweep_len; n++) {
-        status = set_rx_dc_corr(cal->dev, corr[n], corr[n]);
+        status = ts_after_writes(cal->dev, &cal->ts, RX_CAL_SETTLE);
         if (status != 0) {
             return status;
         }
 
         status = rx_samples(cal->dev, cal->samples, cal->num_samples,
-                            &cal->ts, RX_CAL_TS_INC);
+                            &cal->ts, RX_CAL_SETTLE);
         if (status != 0) {
             return status;
         }
 
         sample_mean(cal->samples, cal->num_samples, &mean_i, &mean_q);
 
-        PR_VERBOSE("  Corr=%4d, Mean_I=%4.2f, Mean_Q=%4.2f\n",
-                   corr[n], mean_i, mean_q);
+        PR_VERBOSE("  Corr=(%4d, %4d), Mean_I=%4.2f, Mean_Q=%4.2f\n",
+                   si.corr, sq.corr, mean_i, mean_q);
 
-        /* Not using fabs() to avoid adding a -lm dependency */
-        if (mean_i < 0) {
-            mean_i = -mean_i;
+        if (!si.done) {
+            corr_search_update(&si, mean_i);
         }
 
-        if (mean_q < 0) {
-            mean_q = -mean_q;
-        }
-
-        if (mean_i < min_val_i) {
-            min_val_i  = mean_i;
-            min_corr_i = corr[n];
-        }
-
-        if (mean_q < min_val_q) {
-            min_val_q  = mean_q;
-            min_corr_q = corr[n];
+        if (!sq.done) {
+            corr_search_update(&sq, mean_q);
         }
     }
 
-    *result_i = min_corr_i;
-    *result_q = min_corr_q;
-    *error_i  = min_val_i;
-    *error_q  = min_val_q;
+    PR_DBG("Searched %u points\n", n);
+
+    *result_i = si.best_corr;
+    *result_q = sq.best_corr;
+    *error_i  = si.best_err;
+    *error_q  = sq.best_err;
 
     return 0;
 }
 
-static int perform_rx_cal(struct rx_cal *cal, struct dc_calibration_params *p)
+/* If next_freq is non-zero, the retune to it is scheduled ahead of the final
+ * capture at this frequency */
+static int perform_rx_cal(struct rx_cal *cal, struct dc_calibration_params *p,
+                          uint64_t next_freq)
 {
     int status;
     int16_t i_est, q_est;
-    unsigned int sweep_len = RX_CAL_MAX_SWEEP_LEN;
     struct gain_mode saved_gains;
 
     struct gain_mode agc_gains[] = {
@@ -779,15 +973,9 @@ static int perform_rx_cal(struct rx_cal *cal, struct dc_calibration_params *p)
         return status;
     }
 
-    /* Perform a finer sweep of correction values */
-    init_rx_cal_sweep(cal->corr_sweep, &sweep_len, i_est, q_est);
-
-    /* Advance our timestmap just to account for any time we may have lost */
-    cal->ts += RX_CAL_TS_INC;
-
-    status = rx_cal_sweep(cal, cal->corr_sweep, sweep_len,
-                          &p->corr_i, &p->corr_q,
-                          &p->error_i, &p->error_q);
+    /* Refine the estimates */
+    status = rx_cal_search(cal, i_est, q_est, &p->corr_i, &p->corr_q,
+                           &p->error_i, &p->error_q);
 
     if (status != 0) {
         return status;
@@ -816,17 +1004,20 @@ static int perform_rx_cal(struct rx_cal *cal, struct dc_calibration_params *p)
         return status;
     }
 
-    status = rx_cal_dc_off(cal, &agc_gains[2], &p->min_dc_i, &p->min_dc_q);
+    status = rx_cal_dc_off(cal, &agc_gains[2], 0,
+                           &p->min_dc_i, &p->min_dc_q);
     if (status != 0) {
         return status;
     }
 
-    status = rx_cal_dc_off(cal, &agc_gains[1], &p->mid_dc_i, &p->mid_dc_q);
+    status = rx_cal_dc_off(cal, &agc_gains[1], 0,
+                           &p->mid_dc_i, &p->mid_dc_q);
     if (status != 0) {
         return status;
     }
 
-    status = rx_cal_dc_off(cal, &agc_gains[0], &p->max_dc_i, &p->max_dc_q);
+    status = rx_cal_dc_off(cal, &agc_gains[0], next_freq,
+                           &p->max_dc_i, &p->max_dc_q);
     if (status != 0) {
         return status;
     }
@@ -851,11 +1042,6 @@ static int rx_cal_init_state(struct bladerf *dev,
         return BLADERF_ERR_MEM;
     }
 
-    state->corr_sweep = malloc(sizeof(state->corr_sweep[0]) * RX_CAL_MAX_SWEEP_LEN);
-    if (state->corr_sweep == NULL) {
-        return BLADERF_ERR_MEM;
-    }
-
     state->tx_freq = backup->tx_freq;
 
     status = bladerf_get_timestamp(dev, BLADERF_MODULE_RX, &state->ts);
@@ -883,9 +1069,11 @@ static int rx_cal_init(struct bladerf *dev)
         return status;
     }
 
+    /* Small buffers keep the latency between a capture's end and its
+     * reception low, as each capture's result determines the next settings */
     status = bladerf_sync_config(dev, BLADERF_MODULE_RX,
                                  BLADERF_FORMAT_SC16_Q11_META,
-                                 64, 16384, 16, 1000);
+                                 64, 4096, 16, 1000);
     if (status != 0) {
         return status;
     }
@@ -926,7 +1114,10 @@ int dc_calibration_rx(struct bladerf *dev,
     }
 
     for (i = 0; i < params_count && status == 0; i++) {
-        status = perform_rx_cal(&state, &params[i]);
+        const uint64_t next_freq =
+            (i + 1 < params_count) ? params[i + 1].frequency : 0;
+
+        status = perform_rx_cal(&state, &params[i], next_freq);
 
         if (status == 0 && print_status) {
 #           ifdef DEBUG_DC_CALIBRATION
@@ -956,10 +1147,13 @@ int dc_calibration_rx(struct bladerf *dev,
 
 out:
     free(state.samples);
-    free(state.corr_sweep);
 
     retval = status;
 
+    if (state.retune_scheduled) {
+        bladerf_cancel_scheduled_retunes(dev, BLADERF_MODULE_RX);
+    }
+
     status = bladerf_enable_module(dev, BLADERF_MODULE_RX, false);
     if (status != 0 && retval == 0) {
         retval = status;
@@ -991,6 +1185,10 @@ out:
 #define TX_CAL_TS_INC   (MS_TO_SAMPLES(15, TX_CAL_RATE))
 #define TX_CAL_COUNT    (MS_TO_SAMPLES(5,  TX_CAL_RATE))
 
+/* Time allowed for correction writes and retunes to settle before a capture */
+#define TX_CAL_SETTLE           (MS_TO_SAMPLES(2, TX_CAL_RATE))
+#define TX_CAL_RETUNE_SETTLE    (MS_TO_SAMPLES(4, TX_CAL_RATE))
+
 #define TX_CAL_CORR_SWEEP_LEN (4096 / 16)   /* -2048:16:2048 */
 
 #define TX_CAL_DEFAULT_LB (BLADERF_LB_RF_LNA1)
@@ -1010,24 +1208,48 @@ struct tx_cal_backup {
     bladerf_loopback loopback;
 };
 
+#define TX_CAL_FILT_NUM_TAPS 16
+
+/* The TX DC offset appears at +/-Fs/4 in the received signal, and is mixed to
+ * baseband before filtering. Mixing multiplies sample k by r^k, where r is
+ * -j or j, so the filter's output n is:
+ *
+ *   y[n] = sum_m h[m] x[n-m] r^(n-m) = r^n sum_m (h[m] r^-m) x[n-m]
+ *
+ * As |r^n| = 1, the magnitude of y[n] is that of the raw samples filtered with
+ * the complex taps h[m] r^-m. The mix is therefore folded into the taps.
+ *
+ * The taps are stored in the order they apply to consecutive samples, and
+ * are laid out to operate on interleaved I/Q pairs:
+ *   re[2t] = re[2t+1] = Re(tap), im[2t] = -Im(tap), im[2t+1] = Im(tap)
+ */
+struct tx_cal_taps {
+    float re[2 * TX_CAL_FILT_NUM_TAPS];
+    float im[2 * TX_CAL_FILT_NUM_TAPS];
+};
+
 struct tx_cal {
     struct bladerf *dev;
     int16_t *samples;           /* Raw samples */
     unsigned int num_samples;   /* Number of raw samples */
-    struct complexf *filt;      /* Filter state */
-    struct complexf *filt_out;  /* Filter output */
-    struct complexf *post_mix;  /* Post-filter, mixed to baseband */
     int16_t *sweep;             /* Correction sweep */
     float   *mag;               /* Magnitude results from sweep */
     uint64_t ts;                /* Timestamp */
     bladerf_loopback loopback;  /* Current loopback mode */
     bool rx_low;                /* RX tuned lower than TX */
+
+    /* Filter taps, indexed by rx_low */
+    struct tx_cal_taps taps[2];
 };
 
+/* Only every TX_CAL_DECIMATION'th filter output is used. The filter's output is
+ * band-limited to 1 MHz, so the outputs are decimated to 2 Msps. */
+#define TX_CAL_DECIMATION 2
+
 /* Filter used to isolate contribution of TX LO leakage in received
  * signal. 15th order Equiripple FIR with Fs=4e6, Fpass=1, Fstop=1e6
  */
-static const float tx_cal_filt[] = {
+static const float tx_cal_filt[TX_CAL_FILT_NUM_TAPS] = {
     0.000327949366768f, 0.002460188536582f, 0.009842382390924f,
     0.027274728394777f, 0.057835200476419f, 0.098632713294830f,
     0.139062540460741f, 0.164562494987592f, 0.164562494987592f,
@@ -1036,8 +1258,28 @@ static const float tx_cal_filt[] = {
     0.000327949366768f,
 };
 
-static const unsigned int tx_cal_filt_num_taps =
-    (sizeof(tx_cal_filt) / sizeof(tx_cal_filt[0]));
+static void tx_cal_init_taps(struct tx_cal *cal)
+{
+    /* Real and imaginary parts of j^m */
+    static const float j_re[4] = { 1, 0, -1,  0 };
+    static const float j_im[4] = { 0, 1,  0, -1 };
+    unsigned int m, low;
+
+    for (low = 0; low < 2; low++) {
+        struct tx_cal_taps *taps = &cal->taps[low];
+
+        for (m = 0; m < TX_CAL_FILT_NUM_TAPS; m++) {
+            /* r^-m is j^m when r = -j, and (-j)^m = conj(j^m) when r = j */
+            const float rot_im = low ? j_im[m & 3] : -j_im[m & 3];
+            const unsigned int t = TX_CAL_FILT_NUM_TAPS - 1 - m;
+
+            taps->re[2 * t]     = tx_cal_filt[m] * j_re[m & 3];
+            taps->re[2 * t + 1] = tx_cal_filt[m] * j_re[m & 3];
+            taps->im[2 * t]     = -tx_cal_filt[m] * rot_im;
+            taps->im[2 * t + 1] = tx_cal_filt[m] * rot_im;
+        }
+    }
+}
 
 static inline int set_tx_dc_corr(struct bladerf *dev, int16_t i, int16_t q)
 {
@@ -1272,7 +1514,7 @@ static int tx_cal_rx_init(struct bladerf *dev)
 
     status = bladerf_sync_config(dev, BLADERF_MODULE_RX,
                                  BLADERF_FORMAT_SC16_Q11_META,
-                                 64, 16384, 32, 1000);
+                                 64, 4096, 32, 1000);
     if (status != 0) {
         return status;
     }
@@ -1286,9 +1528,6 @@ static void tx_cal_state_deinit(struct tx_cal *cal)
     free(cal->sweep);
     free(cal->mag);
     free(cal->samples);
-    free(cal->filt);
-    free(cal->filt_out);
-    free(cal->post_mix);
 }
 
 /* This should be called immediately preceding the cal routines */
@@ -1300,30 +1539,14 @@ static int tx_cal_state_init(struct bladerf *dev, struct tx_cal *cal)
     cal->num_samples = TX_CAL_COUNT;
     cal->loopback = TX_CAL_DEFAULT_LB;
 
+    tx_cal_init_taps(cal);
+
     /* Interleaved SC16 Q11 samples */
     cal->samples = malloc(2 * sizeof(cal->samples[0]) * cal->num_samples);
     if (cal->samples == NULL) {
         return BLADERF_ERR_MEM;
     }
 
-    /* Filter state */
-    cal->filt = malloc(2 * sizeof(cal->filt[0]) * tx_cal_filt_num_taps);
-    if (cal->filt == NULL) {
-        return BLADERF_ERR_MEM;
-    }
-
-    /* Filter output */
-    cal->filt_out = malloc(sizeof(cal->filt_out[0]) * cal->num_samples);
-    if (cal->filt_out == NULL) {
-        return BLADERF_ERR_MEM;
-    }
-
-    /* Post-mix */
-    cal->post_mix = malloc(sizeof(cal->post_mix[0]) * cal->num_samples);
-    if (cal->post_mix == NULL) {
-        return BLADERF_ERR_MEM;
-    }
-
     /* Correction sweep and results */
     cal->sweep = malloc(sizeof(cal->sweep[0]) * TX_CAL_CORR_SWEEP_LEN);
     if (cal->sweep == NULL) {
@@ -1344,127 +1567,160 @@ static int tx_cal_state_init(struct bladerf *dev, struct tx_cal *cal)
     return status;
 }
 
-/* Filter samples
- *  Input:  state->post_mix
- *  Output: state->filt_out
- */
-static void tx_cal_filter(struct tx_cal *state)
+/* Magnitude of one filter output, whose input window starts at x */
+static inline float tx_cal_output_mag(const struct tx_cal_taps *taps,
+                                      const int16_t *x)
 {
-    unsigned int n, m;
-    struct complexf *ins1, *ins2;
-    struct complexf *curr; /* Current filter state */
-    const struct complexf *filt_end = &state->filt[2 * tx_cal_filt_num_taps];
-
-    /* Reset filter state */
-    ins1 = &state->filt[0];
-    ins2 = &state->filt[tx_cal_filt_num_taps];
-    memset(state->filt, 0, 2 * sizeof(state->filt[0]) * tx_cal_filt_num_taps);
-
-    for (n = 0; n < state->num_samples; n++) {
-        /* Insert sample */
-        *ins1 = *ins2 = state->post_mix[n];
-
-        /* Convolve */
-        state->filt_out[n].i = 0;
-        state->filt_out[n].q = 0;
-        curr = ins2;
-
-        for (m = 0; m < tx_cal_filt_num_taps; m++, curr--) {
-            state->filt_out[n].i += tx_cal_filt[m] * curr->i;
-            state->filt_out[n].q += tx_cal_filt[m] * curr->q;
-        }
+    float y_i = 0;
+    float y_q = 0;
+    unsigned int t;
 
-        /* Update insertion points */
-        ins2++;
-        if (ins2 == filt_end) {
-            ins1 = &state->filt[0];
-            ins2 = &state->filt[tx_cal_filt_num_taps];
-        } else {
-            ins1++;
-        }
+    for (t = 0; t < 2 * TX_CAL_FILT_NUM_TAPS; t += 2) {
+        y_i += taps->re[t] * x[t] + taps->im[t] * x[t + 1];
+        y_q += taps->re[t + 1] * x[t + 1] + taps->im[t + 1] * x[t];
+    }
+
+    return sqrtf(y_i * y_i + y_q * y_q);
+}
+
+#if defined(TX_CAL_SSE2)
+/* Filter output for one window, as (I, Q, I, Q) partial sums */
+static inline __m128 tx_cal_output_sse2(const struct tx_cal_taps *taps,
+                                        const int16_t *x)
+{
+    __m128 acc = _mm_setzero_ps();
+    unsigned int t;
+
+    for (t = 0; t < 2 * TX_CAL_FILT_NUM_TAPS; t += 4) {
+        /* Sign-extend two I/Q pairs to 32 bits and convert to float */
+        __m128i v = _mm_loadl_epi64((const __m128i *)&x[t]);
+        const __m128 s = _mm_cvtepi32_ps(
+                            _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        const __m128 swapped = _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1));
 
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&taps->re[t]), s));
+        acc = _mm_add_ps(acc,
+                         _mm_mul_ps(_mm_loadu_ps(&taps->im[t]), swapped));
     }
+
+    return acc;
 }
+#elif defined(TX_CAL_NEON)
+/* Filter output for one window, as (I, Q) */
+static inline float32x2_t tx_cal_output_neon(const struct tx_cal_taps *taps,
+                                             const int16_t *x)
+{
+    float32x4_t acc = vdupq_n_f32(0);
+    unsigned int t;
 
-/* Deinterleave, scale, and mix with an -Fs/4 tone to shift TX DC offset out at
- * Fs/4 to baseband.
- *  Input:  state->samples
- *  Output: state->post_mix
- */
-static void tx_cal_mix(struct tx_cal *state)
+    for (t = 0; t < 2 * TX_CAL_FILT_NUM_TAPS; t += 4) {
+        const float32x4_t s = vcvtq_f32_s32(vmovl_s16(vld1_s16(&x[t])));
+
+        acc = vmlaq_f32(acc, vld1q_f32(&taps->re[t]), s);
+        acc = vmlaq_f32(acc, vld1q_f32(&taps->im[t]), vrev64q_f32(s));
+    }
+
+    return vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+}
+#endif
+
+/* Mix the TX DC offset's contribution to baseband, filter out everything
+ * else, and sum the magnitudes of the decimated filter outputs. Four outputs
+ * are computed at a time, so that their square roots are taken together.
+ *
+ * Returns the number of outputs summed. */
+static unsigned int tx_cal_filtered_mag(const struct tx_cal_taps *taps,
+                                        const int16_t *samples,
+                                        unsigned int num_samples, float *sum)
 {
-    unsigned int n, m;
-    int mix_state;
-    float scaled_i, scaled_q;
-
-    /* Mix with -Fs/4 if RX is tuned "lower" than TX, and Fs/4 otherwise */
-    const int mix_state_inc = state->rx_low ? 1 : -1;
-    mix_state = 0;
-
-    for (n = 0, m = 0; n < (2 * state->num_samples); n += 2, m++) {
-        scaled_i = state->samples[n]   / 2048.0f;
-        scaled_q = state->samples[n+1] / 2048.0f;
-
-        switch (mix_state) {
-            case 0:
-                state->post_mix[m].i =  scaled_i;
-                state->post_mix[m].q =  scaled_q;
-                break;
-
-            case 1:
-                state->post_mix[m].i =  scaled_q;
-                state->post_mix[m].q = -scaled_i;
-                break;
-
-            case 2:
-                state->post_mix[m].i = -scaled_i;
-                state->post_mix[m].q = -scaled_q;
-                break;
-
-            case 3:
-                state->post_mix[m].i = -scaled_q;
-                state->post_mix[m].q =  scaled_i;
-                break;
+    /* Outputs are computed once the filter's window is full of samples, rather
+     * than while it ramps up from zero state */
+    const unsigned int first = TX_CAL_FILT_NUM_TAPS - 1;
+    const unsigned int d = TX_CAL_DECIMATION;
+    unsigned int n = first;
+    unsigned int count = 0;
+    float accum = 0;
+
+    if (num_samples <= first) {
+        *sum = 0;
+        return 0;
+    }
+
+#if defined(TX_CAL_SSE2)
+    {
+        __m128 acc = _mm_setzero_ps();
+
+        for (; n + 3 * d < num_samples; n += 4 * d, count += 4) {
+            const int16_t *x = &samples[2 * (n - first)];
+            __m128 y0 = tx_cal_output_sse2(taps, x);
+            __m128 y1 = tx_cal_output_sse2(taps, x + 2 * d);
+            __m128 y2 = tx_cal_output_sse2(taps, x + 4 * d);
+            __m128 y3 = tx_cal_output_sse2(taps, x + 6 * d);
+            __m128 y_i, y_q;
+
+            /* Rows become (I, Q, I, Q) partial sums across the four outputs */
+            _MM_TRANSPOSE4_PS(y0, y1, y2, y3);
+            y_i = _mm_add_ps(y0, y2);
+            y_q = _mm_add_ps(y1, y3);
+
+            acc = _mm_add_ps(acc, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(y_i, y_i),
+                                                         _mm_mul_ps(y_q, y_q))));
         }
 
-        mix_state = (mix_state + mix_state_inc) & 0x3;
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        accum = _mm_cvtss_f32(acc);
+    }
+#elif defined(TX_CAL_NEON)
+    {
+        float32x4_t acc = vdupq_n_f32(0);
+
+        for (; n + 3 * d < num_samples; n += 4 * d, count += 4) {
+            const int16_t *x = &samples[2 * (n - first)];
+            const float32x4_t y01 =
+                vcombine_f32(tx_cal_output_neon(taps, x),
+                             tx_cal_output_neon(taps, x + 2 * d));
+            const float32x4_t y23 =
+                vcombine_f32(tx_cal_output_neon(taps, x + 4 * d),
+                             tx_cal_output_neon(taps, x + 6 * d));
+
+            /* Pairwise sums of squares yield the four outputs' power */
+            const float32x4_t p = vpaddq_f32(vmulq_f32(y01, y01),
+                                             vmulq_f32(y23, y23));
+
+            acc = vaddq_f32(acc, vsqrtq_f32(p));
+        }
+
+        accum = vaddvq_f32(acc);
+    }
+#endif
+
+    for (; n < num_samples; n += d, count++) {
+        accum += tx_cal_output_mag(taps, &samples[2 * (n - first)]);
     }
+
+    *sum = accum;
+    return count;
 }
 
 static int tx_cal_avg_magnitude(struct tx_cal *state, float *avg_mag)
 {
     int status;
-    const unsigned int start = (tx_cal_filt_num_taps + 1) / 2;
-    unsigned int n;
+    unsigned int count;
     float accum;
 
     /* Fetch samples at the current settings */
     status = rx_samples(state->dev, state->samples, state->num_samples,
-                        &state->ts, TX_CAL_TS_INC);
+                        &state->ts, TX_CAL_SETTLE);
     if (status != 0) {
         return status;
     }
 
-    /* Deinterleave & mix TX's DC offset contribution to baseband */
-    tx_cal_mix(state);
-
-    /* Filter out everything other than the TX DC offset's contribution */
-    tx_cal_filter(state);
-
-    /* Compute the power (magnitude^2 to alleviate need for square root).
-     * We skip samples here to account for the group delay of the filter;
-     * the initial samples will be ramping up. */
-    accum = 0;
-    for (n = start; n < state->num_samples; n++) {
-        const struct complexf *s = &state->filt_out[n];
-        const float m = (float) sqrt(s->i * s->i + s->q * s->q);
-        accum += m;
-    }
-
-    *avg_mag = (accum / (state->num_samples - start));
+    count = tx_cal_filtered_mag(&state->taps[state->rx_low ? 1 : 0],
+                                state->samples, state->num_samples, &accum);
 
-    /* Scale this back up to DAC/ADC counts, just for convenience */
-    *avg_mag *= 2048.0;
+    /* The samples are not scaled, so this is already in DAC/ADC counts */
+    *avg_mag = (count != 0) ? (accum / count) : 0;
 
     return status;
 }
@@ -1481,7 +1737,10 @@ static int tx_cal_measure_correction(struct tx_cal *state,
         return status;
     }
 
-    state->ts += TX_CAL_TS_INC;
+    status = ts_after_writes(state->dev, &state->ts, TX_CAL_SETTLE);
+    if (status != 0) {
+        return status;
+    }
 
     status = tx_cal_avg_magnitude(state, mag);
     if (status == 0) {
@@ -1491,6 +1750,40 @@ static int tx_cal_measure_correction(struct tx_cal *state,
     return status;
 }
 
+/* The magnitude has a single minimum near the estimate, so search outward
+ * from it rather than sweeping the whole range around it */
+static int tx_cal_search(struct tx_cal *state, bladerf_correction c,
+                         int16_t corr_est, int16_t range_min,
+                         int16_t range_max, int16_t *min_corr, float *min_mag)
+{
+    int status;
+    unsigned int n;
+    struct corr_search search;
+
+    PR_DBG("Searching correction values: [%-5d : 16 :%5d]\n",
+           range_min, range_max);
+
+    corr_search_init(&search, corr_est, 16, range_min, range_max);
+
+    for (n = 0; n < TX_CAL_CORR_SWEEP_LEN && !search.done; n++) {
+        float mag;
+
+        status = tx_cal_measure_correction(state, c, search.corr, &mag);
+        if (status != 0) {
+            return status;
+        }
+
+        corr_search_update(&search, mag);
+    }
+
+    PR_DBG("Searched %u points\n", n);
+
+    *min_corr = search.best_corr;
+    *min_mag  = search.best_err;
+
+    return 0;
+}
+
 static int tx_cal_get_corr(struct tx_cal *state, bool i_ch,
                            int16_t *corr_value, float *error_value)
 {
@@ -1502,6 +1795,8 @@ static int tx_cal_get_corr(struct tx_cal *state, bool i_ch,
     int16_t range_min, range_max;
     int16_t min_corr;
     float   min_mag;
+    bool    have_est = false;
+    int16_t corr_est = 0;
 
     const int16_t x[4] = { -1800, -1000, 1000, 1800 };
 
@@ -1528,10 +1823,12 @@ static int tx_cal_get_corr(struct tx_cal *state, bool i_ch,
 
     if (m1 < 0 && m2 > 0) {
         const int16_t tmp = (int16_t)((b2 - b1) / (m1 - m2) + 0.5);
-        const int16_t corr_est = (tmp / 16) * 16;
 
-        /* Number of points to sweep on either side of our estimate */
-        const unsigned int n_sweep = 10;
+        /* Number of points to search on either side of our estimate */
+        const int n_sweep = 10;
+
+        corr_est = (tmp / 16) * 16;
+        have_est = true;
 
         PR_VERBOSE("  corr_est=%d\n", corr_est);
 
@@ -1557,30 +1854,39 @@ static int tx_cal_get_corr(struct tx_cal *state, bool i_ch,
     }
 
 
-    PR_DBG("Performing correction value sweep: [%-5d : 16 :%5d]\n",
-           range_min, range_max);
+    if (have_est) {
+        status = tx_cal_search(state, corr_module, corr_est,
+                               range_min, range_max, &min_corr, &min_mag);
+        if (status != 0) {
+            return status;
+        }
+    } else {
+        PR_DBG("Performing correction value sweep: [%-5d : 16 :%5d]\n",
+               range_min, range_max);
 
-    min_corr = 0;
-    min_mag  = 2048;
+        min_corr = 0;
+        min_mag  = 2048;
 
-    for (n = 0, corr = range_min;
-         corr <= range_max && n < TX_CAL_CORR_SWEEP_LEN;
-         n++, corr += 16) {
+        for (n = 0, corr = range_min;
+             corr <= range_max && n < TX_CAL_CORR_SWEEP_LEN;
+             n++, corr += 16) {
 
-        float tmp;
+            float tmp;
 
-        status = tx_cal_measure_correction(state, corr_module, corr, &tmp);
-        if (status != 0) {
-            return status;
-        }
+            status = tx_cal_measure_correction(state, corr_module, corr,
+                                               &tmp);
+            if (status != 0) {
+                return status;
+            }
 
-        if (tmp < 0) {
-            tmp = -tmp;
-        }
+            if (tmp < 0) {
+                tmp = -tmp;
+            }
 
-        if (tmp < min_mag) {
-            min_corr = corr;
-            min_mag  = tmp;
+            if (tmp < min_mag) {
+                min_corr = corr;
+                min_mag  = tmp;
+            }
         }
     }
 
@@ -1604,7 +1910,10 @@ static int perform_tx_cal(struct tx_cal *state, struct dc_calibration_params *p)
         return status;
     }
 
-    state->ts += TX_CAL_TS_INC;
+    status = ts_after_writes(state->dev, &state->ts, TX_CAL_RETUNE_SETTLE);
+    if (status != 0) {
+        return status;
+    }
 
     /* Perform I calibration */
     status = tx_cal_get_corr(state, true, &p->corr_i, &p->error_i);
@@ -0,0 +1,226 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Iterative radix-2 decimation-in-time FFT.
+ *
+ * Each stage's twiddle factors are stored contiguously, so the butterflies of
+ * a stage are a loop over contiguous arrays. That loop uses SSE or NEON where
+ * available.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FFT_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FFT_NEON 1
+#endif
+
+#include "fft.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct fft_plan {
+    unsigned int n;
+    unsigned int log2n;
+
+    /* Bit-reversed index of each point */
+    uint32_t *bitrev;
+
+    /* Twiddle factors. Stage s (butterfly span 2^s) uses the 2^(s-1) values
+     * starting at index 2^(s-1) - 1. */
+    float *tw_re;
+    float *tw_im;
+};
+
+struct fft_plan *fft_plan_create(unsigned int n)
+{
+    struct fft_plan *plan;
+    unsigned int log2n = 0;
+    unsigned int i, half;
+
+    if (n < 2 || (n & (n - 1)) != 0) {
+        return NULL;
+    }
+
+    while ((1u << log2n) < n) {
+        log2n++;
+    }
+
+    plan = calloc(1, sizeof(*plan));
+    if (plan == NULL) {
+        return NULL;
+    }
+
+    plan->n      = n;
+    plan->log2n  = log2n;
+    plan->bitrev = malloc(n * sizeof(plan->bitrev[0]));
+    plan->tw_re  = malloc((n - 1) * sizeof(plan->tw_re[0]));
+    plan->tw_im  = malloc((n - 1) * sizeof(plan->tw_im[0]));
+
+    if (plan->bitrev == NULL || plan->tw_re == NULL || plan->tw_im == NULL) {
+        fft_plan_free(plan);
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+        uint32_t r = 0;
+        unsigned int b;
+
+        for (b = 0; b < log2n; b++) {
+            r |= ((i >> b) & 1) << (log2n - 1 - b);
+        }
+
+        plan->bitrev[i] = r;
+    }
+
+    for (half = 1; half < n; half <<= 1) {
+        float *re = &plan->tw_re[half - 1];
+        float *im = &plan->tw_im[half - 1];
+
+        for (i = 0; i < half; i++) {
+            const double theta = -M_PI * i / half;
+            re[i] = (float)cos(theta);
+            im[i] = (float)sin(theta);
+        }
+    }
+
+    return plan;
+}
+
+void fft_plan_free(struct fft_plan *plan)
+{
+    if (plan != NULL) {
+        free(plan->bitrev);
+        free(plan->tw_re);
+        free(plan->tw_im);
+        free(plan);
+    }
+}
+
+bool fft_is_vectorized(void)
+{
+#if defined(FFT_SSE) || defined(FFT_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* Butterflies of one group: a = x[k], b = x[k + half], for k in [0, half) */
+static inline void butterflies(float *a_re, float *a_im,
+                               float *b_re, float *b_im,
+                               const float *w_re,
+                               const float *w_im,
+                               unsigned int half)
+{
+    unsigned int k = 0;
+
+#if defined(FFT_SSE)
+    for (; k + 4 <= half; k += 4) {
+        const __m128 wr = _mm_loadu_ps(&w_re[k]);
+        const __m128 wi = _mm_loadu_ps(&w_im[k]);
+        const __m128 br = _mm_loadu_ps(&b_re[k]);
+        const __m128 bi = _mm_loadu_ps(&b_im[k]);
+        const __m128 ar = _mm_loadu_ps(&a_re[k]);
+        const __m128 ai = _mm_loadu_ps(&a_im[k]);
+
+        const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+        const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+
+        _mm_storeu_ps(&b_re[k], _mm_sub_ps(ar, tr));
+        _mm_storeu_ps(&b_im[k], _mm_sub_ps(ai, ti));
+        _mm_storeu_ps(&a_re[k], _mm_add_ps(ar, tr));
+        _mm_storeu_ps(&a_im[k], _mm_add_ps(ai, ti));
+    }
+#elif defined(FFT_NEON)
+    for (; k + 4 <= half; k += 4) {
+        const float32x4_t wr = vld1q_f32(&w_re[k]);
+        const float32x4_t wi = vld1q_f32(&w_im[k]);
+        const float32x4_t br = vld1q_f32(&b_re[k]);
+        const float32x4_t bi = vld1q_f32(&b_im[k]);
+        const float32x4_t ar = vld1q_f32(&a_re[k]);
+        const float32x4_t ai = vld1q_f32(&a_im[k]);
+
+        const float32x4_t tr = vmlsq_f32(vmulq_f32(br, wr), bi, wi);
+        const float32x4_t ti = vmlaq_f32(vmulq_f32(br, wi), bi, wr);
+
+        vst1q_f32(&b_re[k], vsubq_f32(ar, tr));
+        vst1q_f32(&b_im[k], vsubq_f32(ai, ti));
+        vst1q_f32(&a_re[k], vaddq_f32(ar, tr));
+        vst1q_f32(&a_im[k], vaddq_f32(ai, ti));
+    }
+#endif
+
+    for (; k < half; k++) {
+        const float tr = b_re[k] * w_re[k] - b_im[k] * w_im[k];
+        const float ti = b_re[k] * w_im[k] + b_im[k] * w_re[k];
+
+        b_re[k] = a_re[k] - tr;
+        b_im[k] = a_im[k] - ti;
+        a_re[k] += tr;
+        a_im[k] += ti;
+    }
+}
+
+void fft_execute(const struct fft_plan *plan, float *re, float *im)
+{
+    const unsigned int n = plan->n;
+    unsigned int i, half;
+
+    for (i = 0; i < n; i++) {
+        const uint32_t j = plan->bitrev[i];
+        if (i < j) {
+            float t;
+
+            t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    /* The first stage's twiddle is 1 */
+    for (i = 0; i < n; i += 2) {
+        const float r = re[i + 1];
+        const float m = im[i + 1];
+
+        re[i + 1] = re[i] - r;
+        im[i + 1] = im[i] - m;
+        re[i] += r;
+        im[i] += m;
+    }
+
+    for (half = 2; half < n; half <<= 1) {
+        const float *w_re = &plan->tw_re[half - 1];
+        const float *w_im = &plan->tw_im[half - 1];
+
+        for (i = 0; i < n; i += 2 * half) {
+            butterflies(&re[i], &im[i], &re[i + half], &im[i + half], w_re,
+                        w_im, half);
+        }
+    }
+}
@@ -25,6 +25,19 @@
 #include <stdint.h>
 #include "libbladeRF.h"
 
+/**
+ * Dense gain correction lookup table, built from a channel's gain calibration
+ * table when it is loaded. Points are uniformly spaced in frequency, so a
+ * lookup is an index computation rather than a search of the table.
+ */
+struct gain_cal_lut {
+    bladerf_frequency start_freq; /**< Frequency of the first point (Hz) */
+    bladerf_frequency stop_freq;  /**< Frequency of the last point (Hz) */
+    bladerf_frequency step;       /**< Spacing between points (Hz) */
+    uint32_t n_points;            /**< Number of points */
+    float *corr;                  /**< Gain correction at each point */
+};
+
 /**
  * @brief Converts gain calibration CSV data to a binary format.
  *
@@ -38,6 +51,37 @@
  */
 int gain_cal_csv_to_bin(struct bladerf *dev, const char *csv_path, const char *binary_path, bladerf_channel ch);
 
+/**
+ * @brief Converts a gain calibration CSV file to binary format without a device.
+ *
+ * Whether the file holds RX or TX measurements is determined from its header,
+ * and the serial number recorded in the file is written to the binary file.
+ *
+ * @param csv_path     Path to the input CSV file.
+ * @param binary_path  Path to the output binary file.
+ * @return 0 on success, BLADERF_ERR_* code on failure.
+ */
+int gain_cal_csv_to_bin_file(const char *csv_path, const char *binary_path);
+
+/**
+ * @brief Converts gain calibration CSV files to binary format in parallel.
+ *
+ * Each file is converted as per gain_cal_csv_to_bin_file().
+ *
+ * @param csv_paths     Paths to the input CSV files.
+ * @param binary_paths  Paths to the output binary files.
+ * @param num_files     Number of files to convert.
+ * @param num_threads   Number of files to convert concurrently, or 0 for one
+ *                      per online CPU.
+ * @param statuses      If non-NULL, updated with each file's conversion status.
+ * @return 0 if all files were converted, BLADERF_ERR_* code otherwise.
+ */
+int gain_cal_csv_to_bin_batch(const char *const *csv_paths,
+                              const char *const *binary_paths,
+                              unsigned int num_files,
+                              unsigned int num_threads,
+                              int *statuses);
+
 /**
  * @brief Loads gain calibration data from a binary file into a bladeRF device.
  *
@@ -101,6 +145,45 @@ int get_gain_cal_entry(const struct bladerf_gain_cal_tbl *tbl,
                        bladerf_frequency freq,
                        struct bladerf_gain_cal_entry *result);
 
+/**
+ * Builds a dense gain correction lookup table from a calibration table.
+ *
+ * The point spacing is the largest that places every calibration entry on a
+ * point, so lookups match get_gain_cal_entry(). If that would require too many
+ * points, the spacing is widened and lookups are approximate between entries.
+ *
+ * @param[out] lut    Lookup table to build. Any previous contents are not freed.
+ * @param[in]  tbl    Calibration table, sorted by frequency
+ *
+ * @return 0 on success, BLADERF_ERR_* code on failure.
+ */
+int gain_cal_lut_build(struct gain_cal_lut *lut,
+                       const struct bladerf_gain_cal_tbl *tbl);
+
+/**
+ * Looks up the interpolated gain correction for a frequency.
+ *
+ * Frequencies below the first point use the first point's correction, as
+ * get_gain_cal_entry() does.
+ *
+ * @param[in]  lut        Lookup table
+ * @param[in]  freq       Frequency (Hz)
+ * @param[out] gain_corr  Gain correction
+ *
+ * @return 0 on success, BLADERF_ERR_UNEXPECTED if the table is empty or
+ *         `freq` is above its last point.
+ */
+int gain_cal_lut_lookup(const struct gain_cal_lut *lut,
+                        bladerf_frequency freq,
+                        double *gain_corr);
+
+/**
+ * Frees a lookup table's points and resets its fields.
+ *
+ * @param lut   Lookup table
+ */
+void gain_cal_lut_free(struct gain_cal_lut *lut);
+
 /**
  * Applies compensated gain given the current gain target and center frequency
  *
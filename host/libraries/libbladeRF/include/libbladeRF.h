@@ -169,6 +169,8 @@ struct bladerf_backendinfo {
  *   - libusb:  libusb (See libusb changelog notes for required version, given
  *   your OS and controller)
  *   - cypress: Cypress CyUSB/CyAPI backend (Windows only)
+ *   - dummy:   Simulated device, when libbladeRF is built with
+ *              ENABLE_BACKEND_DUMMY
  *
  * If no arguments are provided after the backend, the first encountered
  * device on the specified backend will be opened. Note that a backend is
@@ -268,6 +270,79 @@ int CALL_CONV bladerf_get_device_list(struct bladerf_devinfo **devices);
 API_EXPORT
 void CALL_CONV bladerf_free_device_list(struct bladerf_devinfo *devices);
 
+/**
+ * Hotplug events reported to a ::bladerf_hotplug_cb
+ */
+typedef enum {
+    BLADERF_HOTPLUG_ARRIVED, /**< A device has been attached */
+    BLADERF_HOTPLUG_LEFT,    /**< A device has been detached */
+} bladerf_hotplug_event;
+
+/**
+ * Hotplug notification callback
+ *
+ * This is invoked from an internal monitoring thread. It may open the device
+ * described by `info`, but it must not call bladerf_hotplug_deregister() or
+ * bladerf_set_device_cache().
+ *
+ * @param[in]   event       Type of event
+ * @param[in]   info        Device that arrived or left. Only valid for the
+ *                          duration of the callback.
+ * @param[in]   user_data   User data provided to bladerf_hotplug_register()
+ */
+typedef void (*bladerf_hotplug_cb)(bladerf_hotplug_event event,
+                                   const struct bladerf_devinfo *info,
+                                   void *user_data);
+
+/**
+ * Enable or disable the device list cache
+ *
+ * When enabled, libbladeRF monitors device arrival and removal, and serves
+ * bladerf_get_device_list() and bladerf_open() lookups from a cached list
+ * rather than opening every attached device to read its descriptors. This
+ * makes repeated enumeration considerably cheaper.
+ *
+ * The cache is disabled by default.
+ *
+ * @note This is currently only supported by the libusb backend, on platforms
+ *       where libusb supports hotplug events.
+ *
+ * @param[in]   enable      Set true to enable the cache, false to disable it
+ *
+ * @return 0 on success, BLADERF_ERR_UNSUPPORTED if hotplug monitoring is not
+ *         available, or value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_device_cache(bool enable);
+
+/**
+ * Register a callback to be notified of device arrival and removal
+ *
+ * Devices already attached are reported as arrivals when monitoring starts.
+ * The device list cache is maintained while any callback is registered.
+ *
+ * @param[in]   cb          Callback function
+ * @param[in]   user_data   Data passed to `cb`
+ * @param[out]  handle      Handle used to deregister the callback
+ *
+ * @return 0 on success, BLADERF_ERR_UNSUPPORTED if hotplug monitoring is not
+ *         available, or value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_hotplug_register(bladerf_hotplug_cb cb,
+                                       void *user_data,
+                                       int *handle);
+
+/**
+ * Deregister a hotplug callback
+ *
+ * @param[in]   handle      Handle returned by bladerf_hotplug_register()
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_hotplug_deregister(int handle);
+
 /**
  * Initialize a device identifier information structure to a "wildcard" state.
  *
@@ -374,6 +449,30 @@ const char *CALL_CONV bladerf_backend_str(bladerf_backend backend);
 API_EXPORT
 void CALL_CONV bladerf_set_usb_reset_on_open(bool enabled);
 
+/**
+ * Enable or disable "warm open" for future bladerf_open() and
+ * bladerf_open_with_devinfo() calls.
+ *
+ * When enabled, and the FPGA-based RFIC controller reports that it is already
+ * holding an initialized (or standby) RFIC configuration -- e.g., left behind
+ * by a previous process that called bladerf_close() -- the device is opened in
+ * ::BLADERF_TUNING_MODE_FPGA and that configuration is resumed, rather than
+ * re-running the full RFIC initialization and calibration sequence.
+ *
+ * The frequency, sample rate, bandwidth, gain, and filter settings from the
+ * previous session are retained. Board-level defaults (VCTCXO trim, reference
+ * clock PLL) are still applied.
+ *
+ * If no reusable configuration is found, a normal (cold) open is performed.
+ *
+ * This currently only affects the bladeRF 2.0 Micro. Warm open may also be
+ * enabled by defining the BLADERF_WARM_OPEN environment variable.
+ *
+ * @param[in]   enabled     Set true to enable warm open, false to disable it
+ */
+API_EXPORT
+void CALL_CONV bladerf_set_warm_open(bool enabled);
+
 /** @} (End FN_INIT) */
 
 /**
@@ -1890,6 +1989,30 @@ int CALL_CONV bladerf_schedule_retune(struct bladerf *dev,
                                       bladerf_frequency frequency,
                                       struct bladerf_quick_tune *quick_tune);
 
+/**
+ * Get the occupancy of a channel's retune queue
+ *
+ * The FPGA reports the number of pending retunes in its response to each
+ * retune request, so this reflects the queue as of the most recent call to
+ * bladerf_schedule_retune() or bladerf_cancel_scheduled_retunes() for the
+ * channel's direction. Retunes that have occurred since then are not accounted
+ * for.
+ *
+ * @param       dev         Device handle
+ * @param[in]   ch          Channel
+ * @param[out]  fill        Number of pending retunes
+ * @param[out]  depth       Capacity of the retune queue
+ *
+ * @return 0 on success, ::BLADERF_ERR_UNSUPPORTED if the FPGA does not report
+ *         its retune queue occupancy or no retune has been requested yet, or
+ *         another value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_retune_queue_status(struct bladerf *dev,
+                                              bladerf_channel ch,
+                                              unsigned int *fill,
+                                              unsigned int *depth);
+
 /**
  * Cancel all pending scheduled retune operations for the specified channel.
  *
@@ -1924,7 +2047,9 @@ int CALL_CONV bladerf_cancel_scheduled_retunes(struct bladerf *dev,
  * @param[in]   ch          Channel
  * @param[out]  quick_tune  Quick retune parameters
  *
- * @return 0 on success, value from \ref RETCODES list on failure
+ * @return 0 on success, ::BLADERF_ERR_QUEUE_FULL if all of a bladeRF2's quick
+ *         retune profiles are in use (see bladerf_release_quick_tune()), or
+ *         another value from \ref RETCODES list on failure
  */
 API_EXPORT
 int CALL_CONV bladerf_get_quick_tune(struct bladerf *dev,
@@ -1950,6 +2075,100 @@ API_EXPORT
 int bladerf_print_quick_tune(struct bladerf *dev,
                              const struct bladerf_quick_tune *qt);
 
+/**
+ * Release the device resources held by quick retune parameters
+ *
+ * On the bladeRF2, each call to bladerf_get_quick_tune() stores a fast lock
+ * profile in one of 256 per-direction profile slots, and fails with
+ * ::BLADERF_ERR_QUEUE_FULL once they are all in use. Releasing a profile allows
+ * its slot to be reused. On the bladeRF1, this has no effect.
+ *
+ * @note The released parameters must not be used afterwards, including by
+ *       retunes that have already been scheduled but have not yet occurred.
+ *
+ * @param       dev         Device handle
+ * @param[in]   ch          Channel the parameters were fetched for
+ * @param[in]   quick_tune  Quick retune parameters to release
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_release_quick_tune(
+    struct bladerf *dev,
+    bladerf_channel ch,
+    const struct bladerf_quick_tune *quick_tune);
+
+/**
+ * Opaque handle to a hop set
+ *
+ * A hop set is a list of frequencies for a channel, for which quick retune
+ * parameters are managed by libbladeRF. Frequencies are referred to by their
+ * index in the list passed to bladerf_hop_set_create().
+ *
+ * All of the frequencies' quick retune parameters are computed when the hop
+ * set is created, up to the number of profiles available on the device. When
+ * a hop set has more frequencies than that, the least recently scheduled
+ * frequency's profile is reused for a frequency that is not resident. Creating
+ * a profile requires tuning to its frequency, so this immediately retunes the
+ * channel, and should be avoided while streaming.
+ *
+ * Profiles are only reused once more hops have been scheduled since their last
+ * use than a retune queue holds, so their retunes will have occurred.
+ */
+struct bladerf_hop_set;
+
+/**
+ * Create a hop set, computing quick retune parameters for its frequencies
+ *
+ * The channel is tuned to each of the frequencies in turn, and then returned to
+ * its original frequency.
+ *
+ * @param       dev             Device handle
+ * @param[in]   ch              Channel
+ * @param[in]   frequencies     Frequencies, in Hz
+ * @param[in]   num_frequencies Number of frequencies
+ * @param[out]  hop_set         Created hop set. This must be freed with
+ *                              bladerf_hop_set_free() before the device is
+ *                              closed.
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_hop_set_create(struct bladerf *dev,
+                                     bladerf_channel ch,
+                                     const bladerf_frequency *frequencies,
+                                     unsigned int num_frequencies,
+                                     struct bladerf_hop_set **hop_set);
+
+/**
+ * Schedule a retune to one of a hop set's frequencies
+ *
+ * This is equivalent to calling bladerf_schedule_retune() with the frequency's
+ * quick retune parameters.
+ *
+ * @param       hop_set     Hop set
+ * @param[in]   timestamp   Timestamp of the retune, as per
+ *                          bladerf_schedule_retune()
+ * @param[in]   index       Index of the frequency in the hop set
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_hop_set_schedule(struct bladerf_hop_set *hop_set,
+                                       bladerf_timestamp timestamp,
+                                       unsigned int index);
+
+/**
+ * Free a hop set, releasing its quick retune parameters
+ *
+ * Retunes to the hop set's frequencies that are still scheduled should be
+ * cancelled first, via bladerf_cancel_scheduled_retunes().
+ *
+ * @param       hop_set     Hop set to free. NULL is ignored.
+ */
+API_EXPORT
+void CALL_CONV bladerf_hop_set_free(struct bladerf_hop_set *hop_set);
+
 /** @} (End of FN_SCHEDULED_TUNING) */
 
 /**
@@ -2050,6 +2269,131 @@ int CALL_CONV bladerf_get_correction(struct bladerf *dev,
                                      bladerf_correction corr,
                                      bladerf_correction_value *value);
 
+/**
+ * Software DC offset and IQ imbalance correction parameters.
+ *
+ * These describe the impairment to be corrected: a received sample `(I, Q)`
+ * is assumed to carry a DC offset of `(dc_i, dc_q)`, and a quadrature
+ * component of `gain * (Q cos(phase) + I sin(phase))`. Received samples are
+ * corrected, and transmitted samples are pre-distorted, by
+ *
+ * <pre>
+ *   [ I' ]   [ 1             0                      ] [ I - dc_i ]
+ *   [ Q' ] = [ -tan(phase)   1 / (gain cos(phase))  ] [ Q - dc_q ]
+ * </pre>
+ *
+ * and limited to the SC16 Q11 range of [-2048, 2047].
+ *
+ * @see bladerf_set_iq_correction()
+ * @see bladerf_set_iq_correction_table()
+ */
+struct bladerf_iq_correction {
+    /** Frequency, in Hz. Only used by table entries. */
+    bladerf_frequency frequency;
+
+    /** In-phase DC offset, in sample counts. Valid values are
+     *  [-2048, 2048]. */
+    float dc_i;
+
+    /** Quadrature DC offset, in sample counts. Valid values are
+     *  [-2048, 2048]. */
+    float dc_q;
+
+    /** Amplitude of the quadrature component relative to the in-phase
+     *  component. Valid values are [0.5, 2.0], and 1.0 is no correction. */
+    float gain;
+
+    /** Phase error of the quadrature component, in degrees. Valid values are
+     *  [-45.0, 45.0]. */
+    float phase;
+};
+
+/**
+ * Set the software correction applied to synchronous interface samples.
+ *
+ * Unlike the corrections of bladerf_set_correction(), this is applied by
+ * the host to each buffer of ::BLADERF_FORMAT_SC16_Q11 and
+ * ::BLADERF_FORMAT_SC16_Q11_META samples passed through bladerf_sync_rx() or
+ * bladerf_sync_tx(), with finer resolution. It may be changed while a stream
+ * is running; each buffer is corrected with one consistent set of
+ * parameters.
+ *
+ * Setting fixed parameters removes any table loaded with
+ * bladerf_set_iq_correction_table().
+ *
+ * @note Only the bladeRF 1 supports this.
+ *
+ * @param       dev         Device handle
+ * @param[in]   ch          Channel
+ * @param[in]   corr        Parameters to apply, or NULL to disable the
+ *                          correction. The `frequency` field is ignored.
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for parameters out of range,
+ *         BLADERF_ERR_UNSUPPORTED if the device does not support this, or
+ *         another value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV
+    bladerf_set_iq_correction(struct bladerf *dev,
+                              bladerf_channel ch,
+                              const struct bladerf_iq_correction *corr);
+
+/**
+ * Get the software correction parameters in effect
+ *
+ * @param       dev         Device handle
+ * @param[in]   ch          Channel
+ * @param[out]  corr        Current parameters. If a table is in use, these
+ *                          are the values interpolated at the frequency in
+ *                          `frequency`. If the correction is disabled, these
+ *                          describe no correction.
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_iq_correction(struct bladerf *dev,
+                                        bladerf_channel ch,
+                                        struct bladerf_iq_correction *corr);
+
+/**
+ * Load a frequency-indexed table of software correction parameters.
+ *
+ * Whenever the channel is tuned with bladerf_set_frequency(), the parameters
+ * are linearly interpolated from the two nearest entries and take effect
+ * from the next buffer. Outside of the table's range, the first or last
+ * entry is used. The table is applied at the current frequency when it is
+ * loaded.
+ *
+ * As with the DC calibration tables, entries are indexed by the frequency of
+ * the RF transceiver, which differs from the requested frequency when an
+ * XB-200 is mixing. Retunes scheduled with bladerf_schedule_retune() do not
+ * update the parameters.
+ *
+ * Tables are also loaded when the device is opened, from images of type
+ * ::BLADERF_IMAGE_TYPE_RX_IQ_CAL or ::BLADERF_IMAGE_TYPE_TX_IQ_CAL named
+ * `<serial>_iq_rx.tbl` and `<serial>_iq_tx.tbl`, found in the same locations
+ * as the DC calibration tables. These take effect at the first retune.
+ *
+ * @note Only the bladeRF 1 supports this.
+ *
+ * @param       dev         Device handle
+ * @param[in]   ch          Channel
+ * @param[in]   entries     Table entries, in strictly ascending order of
+ *                          frequency. The table is copied. NULL removes the
+ *                          table and disables the correction.
+ * @param[in]   num_entries Number of entries
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for unordered or out of range
+ *         entries, BLADERF_ERR_UNSUPPORTED if the device does not support
+ *         this, or another value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_iq_correction_table(
+    struct bladerf *dev,
+    bladerf_channel ch,
+    const struct bladerf_iq_correction *entries,
+    unsigned int num_entries);
+
 /** @} (End of FN_CORR) */
 
 /** @} (End of FN_CHANNEL) */
@@ -2629,6 +2973,146 @@ int CALL_CONV bladerf_deinterleave_stream_buffer(bladerf_channel_layout layout,
                                                  unsigned int buffer_size,
                                                  void *samples);
 
+/**
+ * @defgroup FN_SAMPLE_CONVERSION Sample conversion
+ *
+ * These functions convert buffers of complex samples between the integer
+ * format used on the wire and the floating-point formats commonly used for
+ * processing, and compute summary statistics over them.
+ *
+ * Samples are stored as interleaved I and Q values. Integer types are scaled
+ * such that their full-scale value corresponds to 1.0 in floating-point types:
+ * ::BLADERF_SAMPLE_SC16 values span [-2048, 2047], as produced by
+ * ::BLADERF_FORMAT_SC16_Q11, and ::BLADERF_SAMPLE_SC8 values span [-128, 127],
+ * as produced by ::BLADERF_FORMAT_SC8_Q7.
+ *
+ * These functions are implemented with SIMD instructions where the host
+ * supports them. The implementation is selected when first used, and may be
+ * overridden with bladerf_set_sample_kernels().
+ *
+ * These functions are thread-safe.
+ *
+ * @{
+ */
+
+/**
+ * Sample types supported by the sample conversion functions
+ */
+typedef enum {
+    BLADERF_SAMPLE_SC8,  /**< Signed 8-bit I and Q, with full scale at 128 */
+    BLADERF_SAMPLE_SC16, /**< Signed 16-bit I and Q, with full scale at 2048 */
+    BLADERF_SAMPLE_CF32, /**< `float` I and Q, with full scale at 1.0 */
+    BLADERF_SAMPLE_CF64, /**< `double` I and Q, with full scale at 1.0 */
+} bladerf_sample_type;
+
+/**
+ * Summary statistics of a sample buffer, relative to full scale
+ */
+struct bladerf_sample_stats {
+    double mean_i;     /**< Mean of I values (DC offset) */
+    double mean_q;     /**< Mean of Q values (DC offset) */
+    double power;      /**< Mean of \f$I^2 + Q^2\f$ */
+    double peak_power; /**< Largest \f$I^2 + Q^2\f$ of any sample */
+};
+
+/**
+ * Convert a buffer of samples from one type to another.
+ *
+ * Conversions from integer to floating-point types are exact. Conversions to
+ * integer types round to the nearest value, with ties to even, and saturate
+ * at the limits of the output type. The result of converting NaN to an
+ * integer type is unspecified.
+ *
+ * Converting between ::BLADERF_SAMPLE_SC8 and ::BLADERF_SAMPLE_CF32 or
+ * ::BLADERF_SAMPLE_CF64 is performed through ::BLADERF_SAMPLE_SC16, and
+ * converting between ::BLADERF_SAMPLE_SC16 and ::BLADERF_SAMPLE_CF64 through
+ * ::BLADERF_SAMPLE_CF32, so the result is the same as that of the sequence of
+ * conversions.
+ *
+ * @param[in]   in_type     Type of input samples
+ * @param[in]   in          Input samples
+ * @param[in]   out_type    Type of output samples
+ * @param[out]  out         Output samples. This may be the same buffer as
+ *                          `in` if `in_type` and `out_type` are the same,
+ *                          and must not otherwise overlap `in`.
+ * @param[in]   num_samples Number of samples (I/Q pairs) to convert
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_convert_samples(bladerf_sample_type in_type,
+                                      const void *in,
+                                      bladerf_sample_type out_type,
+                                      void *out,
+                                      size_t num_samples);
+
+/**
+ * Reverse the byte order of each I and Q value in a sample buffer, in place.
+ *
+ * Samples are transferred to and from the device in little-endian order. On
+ * big-endian hosts, this converts a buffer between device and host order.
+ * It has no effect on ::BLADERF_SAMPLE_SC8 samples.
+ *
+ * @param[in]   type        Type of samples
+ * @param       samples     Samples to process
+ * @param[in]   num_samples Number of samples (I/Q pairs) to process
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_byteswap_samples(bladerf_sample_type type,
+                                       void *samples,
+                                       size_t num_samples);
+
+/**
+ * Compute the mean, power and peak power of a buffer of samples.
+ *
+ * Statistics of integer samples are accumulated exactly, and those of
+ * floating-point samples in at least `double` precision per block of samples.
+ *
+ * @param[in]   type        Type of samples
+ * @param[in]   samples     Samples to process
+ * @param[in]   num_samples Number of samples (I/Q pairs). Must be non-zero.
+ * @param[out]  stats       Statistics, relative to full scale
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_sample_stats(bladerf_sample_type type,
+                                       const void *samples,
+                                       size_t num_samples,
+                                       struct bladerf_sample_stats *stats);
+
+/**
+ * Select the implementation used by the sample conversion functions.
+ *
+ * This is primarily intended for testing and benchmarking. All
+ * implementations produce identical conversions, and statistics that differ
+ * only by floating-point rounding.
+ *
+ * This may be called while other threads use the conversion functions. Calls
+ * already in progress complete with the previously selected implementation.
+ *
+ * @param[in]   name    "generic", "sse2", "avx2" or "neon", or NULL to select
+ *                      the fastest implementation the host supports
+ *
+ * @return 0 on success, ::BLADERF_ERR_UNSUPPORTED if the named implementation
+ *         is not supported by this build or host, ::BLADERF_ERR_INVAL if the
+ *         name is not recognized
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_sample_kernels(const char *name);
+
+/**
+ * Get the name of the implementation used by the sample conversion functions
+ *
+ * @return Name, as accepted by bladerf_set_sample_kernels()
+ */
+API_EXPORT
+const char *CALL_CONV bladerf_get_sample_kernels(void);
+
+/** @} (End of FN_SAMPLE_CONVERSION) */
+
 /** @} (End of STREAMING_FORMAT) */
 
 /**
@@ -2861,6 +3345,53 @@ int CALL_CONV bladerf_sync_rx(struct bladerf *dev,
                               struct bladerf_metadata *metadata,
                               unsigned int timeout_ms);
 
+/**
+ * Shift and decimate received samples before they are returned by
+ * bladerf_sync_rx().
+ *
+ * Each received buffer is multiplied by a complex oscillator at `shift`,
+ * low-pass filtered and decimated by `factor` as it arrives, on the thread
+ * that receives it. bladerf_sync_rx() then returns `factor` times fewer
+ * samples, at the reduced rate, in the configured format and channel layout.
+ *
+ * This avoids copying full-rate samples to the caller when only a narrow
+ * band is of interest.
+ *
+ * If `taps` is NULL, a windowed-sinc low-pass filter of `16 * factor + 1`
+ * taps is used. It has unity gain at DC and a cutoff at 80% of the output
+ * Nyquist frequency.
+ *
+ * Only the ::BLADERF_FORMAT_SC16_Q11 and ::BLADERF_FORMAT_SC8_Q7 formats are
+ * supported. Their sample values are saturated after filtering.
+ *
+ * This configuration is cleared by bladerf_sync_config(). It may only be
+ * changed while the RX stream is not running: after bladerf_sync_config()
+ * and before the first bladerf_sync_rx() call, or after the RX module has
+ * been disabled. A `factor` of 1, a `shift` of 0 and NULL `taps` disable
+ * processing.
+ *
+ * @pre A bladerf_sync_config() call has been made for an RX layout.
+ *
+ * @param       dev         Device handle
+ * @param[in]   factor      Decimation factor, from 1 to 1024
+ * @param[in]   taps        Low-pass filter taps, at the input rate, or NULL
+ *                          to use a designed filter. These are copied.
+ * @param[in]   num_taps    Number of taps in `taps`, from 1 to 8192
+ * @param[in]   shift       Frequency shift, as a fraction of the sample rate,
+ *                          from -0.5 to 0.5. A signal at frequency offset
+ *                          \f$f\f$ is moved to \f$f + shift\f$.
+ *
+ * @return 0 on success,
+ *         ::BLADERF_ERR_UNSUPPORTED if the stream format is not supported,
+ *         ::BLADERF_ERR_INVAL if the stream is running or not configured,
+ *         or a value from \ref RETCODES list on other failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_set_rx_decimation(struct bladerf *dev,
+                                             unsigned int factor,
+                                             const float *taps,
+                                             unsigned int num_taps,
+                                             double shift);
 
 /** @} (End of FN_STREAMING_SYNC) */
 
@@ -3146,6 +3677,146 @@ int CALL_CONV bladerf_get_stream_timeout(struct bladerf *dev,
 
 /** @} (End of FN_STREAMING_ASYNC) */
 
+/**
+ * @defgroup FN_SWEEP Spectrum sweeps
+ *
+ * These functions measure the power spectrum over a frequency range wider than
+ * the sample rate, by stepping an RX channel across the range.
+ *
+ * Rather than retuning and restarting a stream for each step, a sweep keeps a
+ * timestamped RX stream running. Each step is a scheduled retune using quick
+ * retune parameters computed when the sweep is created. Samples received while
+ * the retune settles are discarded by timestamp, and the remaining samples are
+ * reduced to a windowed, averaged FFT. The central bins of each step's FFT are
+ * stitched together into one spectrum.
+ *
+ * A sweep configures and uses the synchronous RX interface, via
+ * bladerf_sync_config(), with the ::BLADERF_FORMAT_SC16_Q11_META format. The
+ * RX stream must not be used by the caller while a sweep exists.
+ *
+ * These functions are thread-safe, but a sweep must not be run from multiple
+ * threads at once.
+ *
+ * @{
+ */
+
+/**
+ * Sweep configuration
+ *
+ * @see bladerf_sweep_init_config()
+ */
+struct bladerf_sweep_config {
+    bladerf_frequency start; /**< Frequency of the spectrum's first bin (Hz) */
+    bladerf_frequency stop;  /**< Upper end of the spectrum (Hz) */
+
+    /** FFT size. This must be a power of two, from 64 to 65536. The bin width
+     *  is the sample rate divided by this. */
+    unsigned int fft_size;
+
+    /** Number of consecutive FFTs averaged at each step */
+    unsigned int num_averages;
+
+    /** Fraction of each step's FFT bins that are used, from 0.1 to 1.0. Bins
+     *  at the edges of the band are discarded, where the channel's filters
+     *  attenuate the signal. This also sets the step size. */
+    float usable_fraction;
+
+    /** Time to discard after each retune while the synthesizers settle, in
+     *  microseconds */
+    unsigned int settle_us;
+};
+
+/**
+ * Opaque handle to a sweep
+ */
+struct bladerf_sweep;
+
+/**
+ * Fill a sweep configuration with defaults.
+ *
+ * The default configuration uses 1024-point FFTs, 4 averages, 75% of each
+ * step's bins, and a 500 us settling time. The start and stop frequencies are
+ * set to 0, and must be assigned before use.
+ *
+ * @param[out]  config      Configuration to fill
+ */
+API_EXPORT
+void CALL_CONV bladerf_sweep_init_config(struct bladerf_sweep_config *config);
+
+/**
+ * Create a sweep
+ *
+ * Quick retune parameters are computed for each step, which tunes the channel
+ * to each step's frequency in turn. The RX stream is then configured and the
+ * channel enabled. The channel's current sample rate determines the bin width.
+ *
+ * @param       dev         Device handle
+ * @param[in]   ch          RX channel. Only `BLADERF_CHANNEL_RX(0)` is
+ *                          currently supported.
+ * @param[in]   config      Sweep configuration
+ * @param[out]  sweep       Created sweep. This must be freed with
+ *                          bladerf_sweep_free() before the device is closed.
+ *
+ * @return 0 on success, ::BLADERF_ERR_INVAL for an invalid configuration or a
+ *         frequency range outside of the channel's, ::BLADERF_ERR_UNSUPPORTED
+ *         if the device does not support scheduled retunes, or another value
+ *         from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_sweep_create(struct bladerf *dev,
+                                   bladerf_channel ch,
+                                   const struct bladerf_sweep_config *config,
+                                   struct bladerf_sweep **sweep);
+
+/**
+ * Get the layout of a sweep's spectrum
+ *
+ * Bin `i` is centered on `config.start + i * bin_width`.
+ *
+ * @param[in]   sweep       Sweep
+ * @param[out]  num_bins    Number of bins in the spectrum. May be NULL.
+ * @param[out]  bin_width   Width of each bin, in Hz. May be NULL.
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_sweep_get_bins(const struct bladerf_sweep *sweep,
+                                     unsigned int *num_bins,
+                                     double *bin_width);
+
+/**
+ * Run a sweep, measuring the power spectrum across its frequency range
+ *
+ * If processing falls behind the stream, the remaining retunes are
+ * rescheduled from the current time and the sweep continues.
+ *
+ * @param       sweep       Sweep
+ * @param[out]  power       Power of each bin, in dB relative to a full-scale
+ *                          sinusoid
+ * @param[in]   num_bins    Number of entries in `power`. This must be at least
+ *                          the number of bins reported by
+ *                          bladerf_sweep_get_bins().
+ * @param[in]   timeout_ms  Timeout for receiving each step's samples. 0
+ *                          implies an infinite wait.
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_sweep_run(struct bladerf_sweep *sweep,
+                                float *power,
+                                unsigned int num_bins,
+                                unsigned int timeout_ms);
+
+/**
+ * Free a sweep, cancelling its scheduled retunes and disabling the RX channel
+ *
+ * @param       sweep       Sweep to free. NULL is ignored.
+ */
+API_EXPORT
+void CALL_CONV bladerf_sweep_free(struct bladerf_sweep *sweep);
+
+/** @} (End of FN_SWEEP) */
+
 /** @} (End of STREAMING) */
 
 /**
@@ -3179,6 +3850,9 @@ int CALL_CONV bladerf_flash_firmware(struct bladerf *dev, const char *firmware);
 /**
  * Load device's FPGA.
  *
+ * The bitstream may be gzip-compressed if libbladeRF was built with zlib
+ * support.
+ *
  * @note This FPGA configuration will be reset at the next power cycle.
  *
  * @param       dev         Device handle
@@ -3189,6 +3863,49 @@ int CALL_CONV bladerf_flash_firmware(struct bladerf *dev, const char *firmware);
 API_EXPORT
 int CALL_CONV bladerf_load_fpga(struct bladerf *dev, const char *fpga);
 
+/**
+ * FPGA loading modes used by bladerf_load_fpga()
+ */
+typedef enum {
+    /**
+     * Always load the FPGA bitstream. This is the default.
+     */
+    BLADERF_FPGA_LOAD_ALWAYS = 0,
+
+    /**
+     * Skip loading if the FPGA is already configured with an identical
+     * bitstream loaded from the host. The device's firmware must support
+     * reporting a checksum of the loaded bitstream; otherwise, the bitstream
+     * is always loaded.
+     */
+    BLADERF_FPGA_LOAD_IF_CHANGED,
+} bladerf_fpga_load_mode;
+
+/**
+ * Select whether bladerf_load_fpga() reloads an FPGA bitstream that is
+ * already loaded.
+ *
+ * @param       dev         Device handle
+ * @param[in]   mode        FPGA loading mode
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_fpga_load_mode(struct bladerf *dev,
+                                         bladerf_fpga_load_mode mode);
+
+/**
+ * Get the currently selected FPGA loading mode
+ *
+ * @param       dev         Device handle
+ * @param[out]  mode        FPGA loading mode
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_fpga_load_mode(struct bladerf *dev,
+                                         bladerf_fpga_load_mode *mode);
+
 /**
  * Write the provided FPGA image to the bladeRF's SPI flash and enable FPGA
  * loading from SPI flash at power on (also referred to within this project as
@@ -3202,6 +3919,51 @@ int CALL_CONV bladerf_load_fpga(struct bladerf *dev, const char *fpga);
 API_EXPORT
 int CALL_CONV bladerf_flash_fpga(struct bladerf *dev, const char *fpga_image);
 
+/**
+ * Flash programming modes used by bladerf_flash_fpga() and
+ * bladerf_flash_firmware()
+ */
+typedef enum {
+    /**
+     * Erase and rewrite the entire flash region. This is the default.
+     */
+    BLADERF_FLASH_MODE_FULL = 0,
+
+    /**
+     * Read back the flash region and only erase, program, and verify the erase
+     * blocks whose contents differ from the new image. This is substantially
+     * faster when most of the image is unchanged.
+     */
+    BLADERF_FLASH_MODE_DIFF,
+} bladerf_flash_mode;
+
+/**
+ * Select how bladerf_flash_fpga() and bladerf_flash_firmware() program the
+ * SPI flash.
+ *
+ * The resulting flash contents are identical in both modes.
+ *
+ * @param       dev         Device handle
+ * @param[in]   mode        Flash programming mode
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_flash_mode(struct bladerf *dev,
+                                     bladerf_flash_mode mode);
+
+/**
+ * Get the currently selected flash programming mode
+ *
+ * @param       dev         Device handle
+ * @param[out]  mode        Flash programming mode
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_flash_mode(struct bladerf *dev,
+                                     bladerf_flash_mode *mode);
+
 /**
  * Erase the FPGA region of SPI flash, effectively disabling FPGA autoloading
  *
@@ -4358,6 +5120,51 @@ int CALL_CONV bladerf_get_gain_calibration(struct bladerf *dev, bladerf_channel
 API_EXPORT
 int CALL_CONV bladerf_get_gain_target(struct bladerf *dev, bladerf_channel ch, int *gain_target);
 
+/**
+ * @brief Converts a gain calibration CSV file to the binary format loaded by
+ * bladerf_load_gain_calibration(), without requiring a device.
+ *
+ * Whether the file contains RX or TX measurements is determined from its
+ * header. The serial number recorded in the CSV file is written to the binary
+ * file.
+ *
+ * @param[in] csv_path     Path to the CSV file
+ * @param[in] binary_path  Path of the binary file to write
+ *
+ * @return 0 on success, BLADERF_ERR_NO_FILE if the CSV file does not exist,
+ * BLADERF_ERR_INVAL if it is malformed, or other BLADERF_ERR_* codes for
+ * different failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_convert_gain_calibration(const char *csv_path,
+                                               const char *binary_path);
+
+/**
+ * @brief Converts many gain calibration CSV files in parallel.
+ *
+ * Each file is converted as per bladerf_convert_gain_calibration(). Files
+ * continue to be converted after a conversion fails.
+ *
+ * @param[in]  csv_paths     Paths to the CSV files
+ * @param[in]  binary_paths  Paths of the binary files to write. If NULL, each
+ *                           is its CSV path with its ".csv" extension replaced
+ *                           by ".tbl".
+ * @param[in]  num_files     Number of files to convert
+ * @param[in]  num_threads   Number of files to convert concurrently. 0 selects
+ *                           one per online CPU.
+ * @param[out] statuses      If non-NULL, an array of `num_files` entries that
+ *                           is updated with each file's conversion status.
+ *
+ * @return 0 if all files were converted, BLADERF_ERR_UNEXPECTED if any failed,
+ * or other BLADERF_ERR_* codes for different failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_convert_gain_calibrations(const char *const *csv_paths,
+                                                const char *const *binary_paths,
+                                                unsigned int num_files,
+                                                unsigned int num_threads,
+                                                int *statuses);
+
 /** @} (End of FN_CAL) */
 
 /**
@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "rel_assert.h"
@@ -28,6 +29,7 @@
 
 #include "backend/backend.h"
 #include "backend/backend_config.h"
+#include "backend/trace/trace.h"
 
 static const struct backend_fns *backend_list[] = BLADERF_BACKEND_LIST;
 
@@ -62,6 +64,14 @@ int backend_open(struct bladerf *dev, struct bladerf_devinfo *info)
         }
     }
 
+    if (status == 0 && getenv("BLADERF_RECORD") != NULL) {
+        /* Recording is a diagnostic aid; don't fail the open over it */
+        if (trace_record_attach(dev, getenv("BLADERF_RECORD")) != 0) {
+            log_warning("Failed to start recording to %s\n",
+                        getenv("BLADERF_RECORD"));
+        }
+    }
+
     return status;
 }
 
@@ -114,6 +124,27 @@ int backend_probe(backend_probe_target probe_target,
     return status;
 }
 
+int backend_hotplug_monitor(bool enable, backend_hotplug_fn notify)
+{
+    int status = BLADERF_ERR_UNSUPPORTED;
+    bool supported = false;
+    size_t i;
+    const size_t n_backends = ARRAY_SIZE(backend_list);
+
+    for (i = 0; i < n_backends; i++) {
+        if (backend_list[i]->hotplug_monitor != NULL) {
+            status = backend_list[i]->hotplug_monitor(enable, notify);
+            if (status == 0) {
+                supported = true;
+            } else if (status != BLADERF_ERR_UNSUPPORTED) {
+                return status;
+            }
+        }
+    }
+
+    return supported ? 0 : status;
+}
+
 int backend_load_fw_from_bootloader(bladerf_backend backend,
                                     uint8_t bus, uint8_t addr,
                                     struct fx3_firmware *fw)
@@ -145,6 +176,9 @@ const char *backend2str(bladerf_backend backend)
         case BLADERF_BACKEND_CYPRESS:
             return BACKEND_STR_CYPRESS;
 
+        case BLADERF_BACKEND_DUMMY:
+            return BACKEND_STR_DUMMY;
+
         default:
             return BACKEND_STR_ANY;
     }
@@ -160,6 +194,8 @@ int str2backend(const char *str, bladerf_backend *backend)
         *backend = BLADERF_BACKEND_LINUX;
     } else if (!strcasecmp(BACKEND_STR_CYPRESS, str)) {
         *backend = BLADERF_BACKEND_CYPRESS;
+    } else if (!strcasecmp(BACKEND_STR_DUMMY, str)) {
+        *backend = BLADERF_BACKEND_DUMMY;
     } else if (!strcasecmp(BACKEND_STR_ANY, str)) {
         *backend = BLADERF_BACKEND_ANY;
     } else {
@@ -37,6 +37,7 @@
 #define BACKEND_STR_LIBUSB "libusb"
 #define BACKEND_STR_LINUX "linux"
 #define BACKEND_STR_CYPRESS "cypress"
+#define BACKEND_STR_DUMMY "dummy"
 
 /**
  * Specifies what to probe for
@@ -57,6 +58,13 @@ typedef enum {
 struct bladerf_devinfo_list;
 struct fx3_firmware;
 
+/**
+ * Device arrival/removal notification, issued by backends performing hotplug
+ * monitoring. `arrived` is true on arrival and false on removal.
+ */
+typedef void (*backend_hotplug_fn)(bool arrived,
+                                   const struct bladerf_devinfo *info);
+
 /**
  * Backend-specific function table
  *
@@ -298,6 +306,18 @@ struct backend_fns {
 
     /* Backend name */
     const char *name;
+
+    /* Start or stop hotplug monitoring and device list caching. `notify` is
+     * invoked on device arrival and removal while monitoring is enabled.
+     * May be NULL if the backend does not support this. */
+    int (*hotplug_monitor)(bool enable, backend_hotplug_fn notify);
+
+    /* Returns 1 if the FPGA is configured with the provided bitstream, 0 if
+     * it is not or if this cannot be determined, or a negative BLADERF_ERR_*
+     * value on failure. May be NULL if the backend does not support this. */
+    int (*is_fpga_image_loaded)(struct bladerf *dev,
+                                const uint8_t *image,
+                                size_t image_size);
 };
 
 /**
@@ -325,6 +345,17 @@ int backend_probe(backend_probe_target probe_target,
                   struct bladerf_devinfo **devinfo_items,
                   size_t *num_items);
 
+/**
+ * Start or stop hotplug monitoring on all backends that support it
+ *
+ * @param[in]   enable      Set true to start monitoring, false to stop
+ * @param[in]   notify      Arrival/removal notification function
+ *
+ * @return 0 on success, BLADERF_ERR_UNSUPPORTED if no backend supports
+ *         hotplug monitoring, or another BLADERF_ERR_* value on failure
+ */
+int backend_hotplug_monitor(bool enable, backend_hotplug_fn notify);
+
 /**
  * Search for bootloader via provided specification, download firmware,
  * and boot it.
@@ -1,7 +1,30 @@
 /*
- * Dummy backend to allow libbladeRF to build when no other backends are
- * enabled. This is intended for development purposes only, and should
- * generally should not be enabled for libbladeRF releases.
+ * Simulated device backend
+ *
+ * This backend presents a virtual bladeRF 1 or bladeRF 2.0 Micro that can be
+ * opened, configured, and streamed without any hardware attached. It keeps
+ * register state for the peripherals accessed by the board code, generates
+ * synthetic RX samples, and consumes TX samples at the configured sample rate,
+ * using the same async/sync streaming paths as the USB backend.
+ *
+ * This is intended for development and testing purposes, and should generally
+ * not be enabled for libbladeRF releases.
+ *
+ * The following environment variables configure the simulated device:
+ *
+ *  BLADERF_DUMMY_BOARD     "bladerf1" or "bladerf2" (default: bladerf2)
+ *  BLADERF_DUMMY_TONES     Comma-separated list of RX tones, each of the form
+ *                          <offset Hz>[@<amplitude>], where amplitude is
+ *                          relative to full scale (default: 100e3@0.5)
+ *  BLADERF_DUMMY_NOISE     RMS amplitude of the RX noise floor, relative to
+ *                          full scale (default: 0.01)
+ *  BLADERF_DUMMY_BURST     <on>:<off> RX burst gating, in samples
+ *                          (default: continuous)
+ *  BLADERF_DUMMY_REALTIME  Set to 0 to run streams as fast as the host can
+ *                          produce and consume samples (default: 1)
+ *  BLADERF_DUMMY_NIOS      Set to 1 to execute control packets with the NIOS II
+ *                          firmware's packet handlers (default: 0). Requires
+ *                          libbladeRF to be built with ENABLE_NIOS_SIM.
  *
  * This file is part of the bladeRF project:
  *   http://www.github.com/nuand/bladeRF
@@ -23,79 +46,1110 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
-#include "backend/backend.h"
+#include "host_config.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "conversions.h"
+#include "log.h"
+#include "rel_assert.h"
+#include "thread.h"
+
+#include "backend/backend.h"
+#include "backend/backend_config.h"
+#include "backend/trace/trace.h"
+#include "backend/usb/usb.h"
 #include "board/board.h"
+#include "board/bladerf1/flash.h"
+#include "helpers/version.h"
+#include "helpers/wallclock.h"
+#include "streaming/async.h"
+#include "streaming/format.h"
+#include "streaming/metadata.h"
+
+#include "bladeRF.h"
+#include "bladerf2_common.h"
+#include "devinfo.h"
+#include "nios_pkt_retune.h"
+#include "nios_pkt_retune2.h"
+
+#ifdef ENABLE_NIOS_SIM
+#include "backend/dummy/nios_sim.h"
+#include "backend/usb/nios_access.h"
+#include "nios_pkt_formats.h"
+#endif
+
+#define DUMMY_SERIAL "0000000000000000000000000000d0d0"
+
+/* Versions are chosen to satisfy both boards' compatibility tables */
+#define DUMMY_FW_MAJOR 2
+#define DUMMY_FW_MINOR 6
+#define DUMMY_FW_PATCH 0
+#define DUMMY_FPGA_MAJOR 0
+#define DUMMY_FPGA_MINOR 16
+#define DUMMY_FPGA_PATCH 0
+
+/* Winbond W25Q32: 32 Mbit, 256 byte pages, 64 KiB erase blocks */
+#define DUMMY_FLASH_MID 0xef
+#define DUMMY_FLASH_DID 0x15
+#define DUMMY_FLASH_SIZE (4 * 1024 * 1024)
+#define DUMMY_FLASH_PAGE_SIZE 256
+#define DUMMY_FLASH_EB_SIZE (64 * 1024)
+
+#define DUMMY_OTP_SIZE 256
+
+/* The firmware and FPGA versions above use the larger SuperSpeed messages */
+#define DUMMY_MSG_SIZE USB_MSG_SIZE_SS
+
+#define DUMMY_DEFAULT_SAMPLE_RATE 1000000
+#define DUMMY_MAX_TONES 8
+/* Retune queue depths of the bladeRF 1 and bladeRF 2 NIOS II firmware */
+#define DUMMY_RETUNE_QUEUE_MAX 32
+#define DUMMY_RETUNE2_QUEUE_MAX 64
+#define DUMMY_KV_MAX 64
+#define DUMMY_NUM_RFIC_CMDS (BLADERF_RFIC_COMMAND_SYNC + 1)
+
+/* Number of samples the RX FIFO can absorb before the simulated FPGA starts
+ * dropping samples because no transfers were available to receive them */
+#define DUMMY_RX_FIFO_SAMPLES (1 << 16)
+
+/* Longest interval the stream thread sleeps before re-checking its state */
+#define DUMMY_MAX_SLEEP_NS 100000000ULL
+
+/* LMS6002D VTUNE comparator outputs, as reported in bits [7:6] */
+#define DUMMY_VCO_NORM 0x00
+#define DUMMY_VCO_LOW 0x01
+#define DUMMY_VCO_HIGH 0x02
+
+/* Half-width of the VCOCAP window in which the simulated VTUNE reads NORM */
+#define DUMMY_VCOCAP_WINDOW 4
+
+enum dummy_board {
+    DUMMY_BOARD_BLADERF1,
+    DUMMY_BOARD_BLADERF2,
+};
+
+/* Simple address/value store for sparsely-accessed register spaces */
+struct dummy_kv {
+    uint32_t addr[DUMMY_KV_MAX];
+    uint32_t value[DUMMY_KV_MAX];
+    size_t count;
+};
+
+/* Sample counter for one direction. In real-time mode the counter advances
+ * with the wall clock; otherwise it is advanced by streaming. */
+struct dummy_clock {
+    uint64_t base_ts; /* Counter value at base_ns */
+    uint64_t base_ns; /* Wall clock time, in ns, at which base_ts was valid */
+    uint64_t rate;    /* Samples per second */
+};
+
+struct dummy_retune {
+    uint64_t timestamp;
+    bladerf_channel ch;
+    bool is_retune2;
+
+    /* bladeRF 1 */
+    uint16_t nint;
+    uint32_t nfrac;
+    uint8_t freqsel;
+    uint8_t vcocap;
+    bool low_band;
+    uint8_t xb_gpio;
+
+    /* bladeRF 2 */
+    uint16_t nios_profile;
+    uint8_t port;
+    uint8_t spdt;
+};
+
+struct dummy_retune_queue {
+    struct dummy_retune entries[DUMMY_RETUNE2_QUEUE_MAX];
+    size_t count;
+};
+
+struct dummy_tone {
+    double freq;      /* Offset from the LO, in Hz */
+    double amplitude; /* Relative to full scale */
+};
+
+struct dummy_stats {
+    uint64_t rx_samples;
+    uint64_t rx_dropped;
+    uint64_t tx_samples;
+    uint64_t tx_late;
+    uint64_t tx_underrun;
+};
+
+struct dummy_device {
+#ifdef ENABLE_NIOS_SIM
+    /* In firmware-in-the-loop mode, the USB backend's NIOS II access functions
+     * are used as-is. They expect backend_data to point to this. */
+    struct bladerf_usb usb;
+#endif
+
+    MUTEX lock;
+
+    enum dummy_board board;
+    bool realtime;
+
+    /* RX signal configuration */
+    struct dummy_tone tones[DUMMY_MAX_TONES];
+    size_t num_tones;
+    double noise;
+    uint64_t burst_on;
+    uint64_t burst_off;
+
+    /* FPGA */
+    bool fpga_configured;
+    bladerf_fpga_source fpga_source;
+    backend_fpga_protocol fpga_protocol;
+    uint32_t config_gpio;
+    int16_t iq_gain[4];
+    int16_t iq_phase[4];
+    int16_t agc_dc[6];
+    uint8_t triggers[4][16];
+    struct dummy_kv wishbone;
+    struct dummy_kv adi_axi;
+
+    /* Expansion board */
+    uint32_t xb_gpio;
+    uint32_t xb_gpio_dir;
+    uint32_t xb_spi;
+
+    /* Peripherals */
+    uint8_t lms[128];
+    uint8_t vco_center[2];
+    bool vco_center_pending[2];
+    bool low_band[2];
+    uint8_t si5338[256];
+    uint16_t ina219[6];
+    uint8_t ad9361[1024];
+    uint32_t adf400x[4];
+    uint16_t trim_dac;
+    uint16_t vctcxo_dac[256];
+    bladerf_vctcxo_tamer_mode tamer_mode;
+    bool fw_loopback;
+
+    /* FPGA-hosted RFIC controller and RF front end */
+    bladerf_rfic_init_state rfic_init;
+    bool rfic_wq_success;
+    uint64_t rfic[16][DUMMY_NUM_RFIC_CMDS];
+    uint32_t rffe_control;
+    uint64_t rfic_fastlock[2][NUM_RFFE_FASTLOCK_PROFILES];
+    uint64_t nios_fastlock[2][NUM_BBP_FASTLOCK_PROFILES];
+
+    /* SPI flash and OTP */
+    uint8_t *flash;
+    uint8_t otp[DUMMY_OTP_SIZE];
+    bool otp_locked;
+
+    /* Timestamps, scheduled retunes, and streaming */
+    struct dummy_clock clock[2];
+    uint64_t stream_pos[2];
+    bool enabled[2];
+    struct dummy_retune_queue retunes[2];
+    struct dummy_stats stats;
+
+    /* NIOS II firmware-in-the-loop */
+    bool nios;
+#ifdef ENABLE_NIOS_SIM
+    MUTEX nios_lock;
+    uint8_t nios_resp[NIOS_PKT_LEN];
+    bool nios_resp_valid;
+#endif
+};
+
+struct dummy_tone_state {
+    double re;
+    double im;
+    double step_re;
+    double step_im;
+    double amplitude;
+};
+
+struct dummy_stream_data {
+    /* Submitted transfers, oldest first, stored as a ring */
+    void **xfer_buf;
+    size_t *xfer_len;
+    size_t num_transfers;
+    size_t num_avail;
+    size_t head;
+    COND xfer_ready;
+
+    bladerf_direction dir;
+    unsigned int num_channels;
+
+    /* RX signal generator */
+    struct dummy_tone_state tones[DUMMY_MAX_TONES];
+    size_t num_tones;
+    double noise;
+    uint64_t burst_on;
+    uint64_t burst_off;
+    uint64_t rng;
+    int16_t *scratch;
+    size_t scratch_len;
+
+    bool warned_late;
+};
+
+static inline struct dummy_device *dummy_backend(struct bladerf *dev)
+{
+    return (struct dummy_device *)dev->backend_data;
+}
+
+#ifdef ENABLE_NIOS_SIM
+static const struct backend_fns backend_fns_dummy_nios;
+
+static int dummy_nios_attach(struct bladerf *dev);
+static void dummy_nios_detach(struct dummy_device *dd);
+static void dummy_nios_poll(struct dummy_device *dd);
+#else
+static inline void dummy_nios_poll(struct dummy_device *dd)
+{
+}
+#endif
+
+/******************************************************************************/
+/* Helpers */
+/******************************************************************************/
+
+static inline size_t dummy_dir_idx(bladerf_direction dir)
+{
+    return (dir == BLADERF_TX) ? 1 : 0;
+}
+
+static inline bladerf_direction dummy_ch_dir(bladerf_channel ch)
+{
+    return BLADERF_CHANNEL_IS_TX(ch) ? BLADERF_TX : BLADERF_RX;
+}
+
+static uint32_t dummy_kv_read(const struct dummy_kv *kv, uint32_t addr)
+{
+    size_t i;
+
+    for (i = 0; i < kv->count; i++) {
+        if (kv->addr[i] == addr) {
+            return kv->value[i];
+        }
+    }
+
+    return 0;
+}
+
+static int dummy_kv_write(struct dummy_kv *kv, uint32_t addr, uint32_t value)
+{
+    size_t i;
+
+    for (i = 0; i < kv->count; i++) {
+        if (kv->addr[i] == addr) {
+            kv->value[i] = value;
+            return 0;
+        }
+    }
+
+    if (kv->count >= DUMMY_KV_MAX) {
+        log_debug("%s: register space full\n", __FUNCTION__);
+        return BLADERF_ERR_MEM;
+    }
+
+    kv->addr[kv->count]  = addr;
+    kv->value[kv->count] = value;
+    kv->count++;
+
+    return 0;
+}
+
+/******************************************************************************/
+/* Sample clock */
+/******************************************************************************/
+
+static uint64_t dummy_clock_now(struct dummy_device *dd, bladerf_direction dir)
+{
+    struct dummy_clock *c = &dd->clock[dummy_dir_idx(dir)];
+    uint64_t dt;
+
+    if (!dd->realtime) {
+        return c->base_ts;
+    }
+
+    /* Split the elapsed time to avoid overflowing the intermediate product */
+    dt = wallclock_get_current_nsec() - c->base_ns;
+
+    return c->base_ts + (dt / 1000000000) * c->rate +
+           ((dt % 1000000000) * c->rate) / 1000000000;
+}
+
+static void dummy_clock_set_rate(struct dummy_device *dd,
+                                 bladerf_direction dir,
+                                 uint64_t rate)
+{
+    struct dummy_clock *c = &dd->clock[dummy_dir_idx(dir)];
+
+    if (rate == 0) {
+        rate = DUMMY_DEFAULT_SAMPLE_RATE;
+    }
+
+    if (rate != c->rate) {
+        c->base_ts = dummy_clock_now(dd, dir);
+        c->base_ns = wallclock_get_current_nsec();
+        c->rate    = rate;
+    }
+}
+
+/* Advance a free-running clock; real-time clocks advance on their own */
+static void dummy_clock_advance(struct dummy_device *dd,
+                                bladerf_direction dir,
+                                uint64_t timestamp)
+{
+    struct dummy_clock *c = &dd->clock[dummy_dir_idx(dir)];
+
+    if (!dd->realtime && timestamp > c->base_ts) {
+        c->base_ts = timestamp;
+    }
+}
+
+/* Nanoseconds until the clock reaches the specified timestamp */
+static uint64_t dummy_clock_ns_until(struct dummy_device *dd,
+                                     bladerf_direction dir,
+                                     uint64_t timestamp)
+{
+    const uint64_t rate = dd->clock[dummy_dir_idx(dir)].rate;
+    const uint64_t now  = dummy_clock_now(dd, dir);
+    uint64_t delta;
+
+    if (!dd->realtime || timestamp <= now) {
+        return 0;
+    }
+
+    delta = timestamp - now;
+
+    return (delta / rate) * 1000000000 + ((delta % rate) * 1000000000) / rate;
+}
+
+/******************************************************************************/
+/* LMS6002D */
+/******************************************************************************/
+
+static void dummy_lms_set_pll(struct dummy_device *dd,
+                              bladerf_direction dir,
+                              uint16_t nint,
+                              uint32_t nfrac,
+                              uint8_t freqsel,
+                              uint8_t vcocap)
+{
+    const uint8_t base = (dir == BLADERF_TX) ? 0x10 : 0x20;
+
+    dd->lms[base + 0] = (nint >> 1) & 0xff;
+    dd->lms[base + 1] = ((nint & 1) << 7) | ((nfrac >> 16) & 0x7f);
+    dd->lms[base + 2] = (nfrac >> 8) & 0xff;
+    dd->lms[base + 3] = nfrac & 0xff;
+    dd->lms[base + 5] = (freqsel << 2) | (dd->lms[base + 5] & 0x03);
+    dd->lms[base + 9] = (dd->lms[base + 9] & 0xc0) | (vcocap & 0x3f);
+
+    dd->vco_center[dummy_dir_idx(dir)]         = vcocap & 0x3f;
+    dd->vco_center_pending[dummy_dir_idx(dir)] = false;
+}
+
+/* The VCO locks within a window around the first VCOCAP value written after
+ * the PLL configuration changes. Below the window VTUNE reads HIGH, and above
+ * it VTUNE reads LOW. */
+static uint8_t dummy_lms_vtune(struct dummy_device *dd, bladerf_direction dir)
+{
+    const uint8_t base   = (dir == BLADERF_TX) ? 0x10 : 0x20;
+    const int vcocap     = dd->lms[base + 9] & 0x3f;
+    const int center     = dd->vco_center[dummy_dir_idx(dir)];
+
+    if (vcocap < center - DUMMY_VCOCAP_WINDOW) {
+        return DUMMY_VCO_HIGH;
+    } else if (vcocap > center + DUMMY_VCOCAP_WINDOW) {
+        return DUMMY_VCO_LOW;
+    } else {
+        return DUMMY_VCO_NORM;
+    }
+}
+
+/******************************************************************************/
+/* RFIC command interface */
+/******************************************************************************/
+
+static void dummy_rfic_reset(struct dummy_device *dd)
+{
+    size_t ch;
+
+    memset(dd->rfic, 0, sizeof(dd->rfic));
+
+    for (ch = 0; ch < 4; ch++) {
+        uint64_t *r = dd->rfic[ch];
+
+        r[BLADERF_RFIC_COMMAND_SAMPLERATE] = 30720000;
+        r[BLADERF_RFIC_COMMAND_FREQUENCY]  = 2400000000ULL;
+        r[BLADERF_RFIC_COMMAND_BANDWIDTH]  = 18000000;
+
+        if (BLADERF_CHANNEL_IS_TX(ch)) {
+            r[BLADERF_RFIC_COMMAND_GAIN]   = 10000;
+            r[BLADERF_RFIC_COMMAND_FILTER] = BLADERF_RFIC_TXFIR_DEFAULT;
+            r[BLADERF_RFIC_COMMAND_TXMUTE] = 1;
+        } else {
+            r[BLADERF_RFIC_COMMAND_GAIN]     = 60;
+            r[BLADERF_RFIC_COMMAND_GAINMODE] = BLADERF_GAIN_SLOWATTACK_AGC;
+            r[BLADERF_RFIC_COMMAND_FILTER]   = BLADERF_RFIC_RXFIR_DEFAULT;
+        }
+    }
+
+    dd->rffe_control = (1 << RFFE_CONTROL_RESET_N);
+}
+
+/* Mirrors the FPGA's handling of channel and direction enables, including
+ * the RF switch (SPDT) selection */
+static int dummy_rfic_enable(struct dummy_device *dd,
+                             bladerf_channel ch,
+                             bool enable)
+{
+    const bladerf_direction dir = dummy_ch_dir(ch);
+    uint32_t reg                = dd->rffe_control;
+    bool ch_pending, dir_enable, dir_pending;
+    size_t i;
+
+    ch_pending  = _rffe_ch_enabled(reg, ch) != enable;
+    dir_enable  = enable || _rffe_dir_otherwise_enabled(reg, ch);
+    dir_pending = _rffe_dir_enabled(reg, dir) != dir_enable;
+
+    if (ch_pending) {
+        if (_modify_spdt_bits_by_freq(&reg, ch, enable,
+                                      dd->rfic[ch][BLADERF_RFIC_COMMAND_FREQUENCY]) != 0) {
+            return BLADERF_ERR_INVAL;
+        }
+
+        if (enable) {
+            reg |= (1 << _get_rffe_control_bit_for_ch(ch));
+        } else {
+            reg &= ~(1 << _get_rffe_control_bit_for_ch(ch));
+        }
+    }
+
+    if (dir_pending) {
+        if (dir_enable) {
+            reg |= (1 << _get_rffe_control_bit_for_dir(dir));
+        } else {
+            for (i = 0; i < 2; i++) {
+                bladerf_channel subch = (dir == BLADERF_TX) ? BLADERF_CHANNEL_TX(i)
+                                                            : BLADERF_CHANNEL_RX(i);
+
+                if (_modify_spdt_bits_by_freq(&reg, subch, false, 0) != 0) {
+                    return BLADERF_ERR_INVAL;
+                }
+            }
+
+            reg &= ~(1 << _get_rffe_control_bit_for_dir(dir));
+        }
+    }
+
+    dd->rffe_control = reg;
+
+    return 0;
+}
+
+static int dummy_rfic_set_frequency(struct dummy_device *dd,
+                                    bladerf_channel ch,
+                                    uint64_t freq)
+{
+    const bladerf_direction dir = dummy_ch_dir(ch);
+    size_t i;
+
+    /* Both channels in a direction share an LO */
+    for (i = 0; i < 2; i++) {
+        bladerf_channel subch = (dir == BLADERF_TX) ? BLADERF_CHANNEL_TX(i)
+                                                    : BLADERF_CHANNEL_RX(i);
+
+        dd->rfic[subch][BLADERF_RFIC_COMMAND_FREQUENCY] = freq;
+
+        if (_rffe_ch_enabled(dd->rffe_control, subch) &&
+            _modify_spdt_bits_by_freq(&dd->rffe_control, subch, true, freq) != 0) {
+            return BLADERF_ERR_INVAL;
+        }
+    }
+
+    return 0;
+}
+
+static uint64_t dummy_rfic_status(struct dummy_device *dd)
+{
+    const uint64_t init = (dd->rfic_init == BLADERF_RFIC_INIT_STATE_ON);
+
+    return ((init & BLADERF_RFIC_STATUS_INIT_MASK)
+            << BLADERF_RFIC_STATUS_INIT_SHIFT) |
+           (((uint64_t)dd->rfic_wq_success & BLADERF_RFIC_STATUS_WQSUCCESS_MASK)
+            << BLADERF_RFIC_STATUS_WQSUCCESS_SHIFT) |
+           ((uint64_t)BLADERF_RFIC_STATUS_SYNC_MASK
+            << BLADERF_RFIC_STATUS_SYNC_SHIFT);
+}
+
+/******************************************************************************/
+/* Scheduled retunes */
+/******************************************************************************/
+
+/* RF switch selection, as stored in a fast lock profile */
+static void dummy_rffe_select_spdt(struct dummy_device *dd,
+                                   bladerf_direction dir,
+                                   uint8_t spdt)
+{
+    uint32_t mask;
+
+    if (dir == BLADERF_TX) {
+        mask = 0xF << RFFE_CONTROL_TX_SPDT_1;
+        dd->rffe_control = (dd->rffe_control & ~mask) |
+                           ((uint32_t)(spdt >> 4) << RFFE_CONTROL_TX_SPDT_1);
+    } else {
+        mask = 0xF << RFFE_CONTROL_RX_SPDT_1;
+        dd->rffe_control = (dd->rffe_control & ~mask) |
+                           ((uint32_t)(spdt & 0xf) << RFFE_CONTROL_RX_SPDT_1);
+    }
+}
+
+static void dummy_apply_retune(struct dummy_device *dd,
+                               const struct dummy_retune *r)
+{
+    const bladerf_direction dir = dummy_ch_dir(r->ch);
+    const size_t d              = dummy_dir_idx(dir);
+
+    if (!r->is_retune2) {
+        dummy_lms_set_pll(dd, dir, r->nint, r->nfrac, r->freqsel, r->vcocap);
+        dd->low_band[d] = r->low_band;
+        return;
+    }
+
+    dummy_rfic_set_frequency(dd, r->ch, dd->nios_fastlock[d][r->nios_profile]);
+
+    /* Port selection, as written to the AD9361 INPUT_SELECT register */
+    if (r->port >> 7) {
+        dd->ad9361[0x004] = (dd->ad9361[0x004] & ~0x3f) | (r->port & 0x3f);
+    } else {
+        dd->ad9361[0x004] = (dd->ad9361[0x004] & ~0x40) | (r->port & 0x40);
+    }
+
+    dummy_rffe_select_spdt(dd, dir, r->spdt);
+}
+
+/* Apply any queued retunes whose timestamps have passed */
+static void dummy_service_retunes(struct dummy_device *dd)
+{
+    size_t d;
+
+    for (d = 0; d < 2; d++) {
+        struct dummy_retune_queue *q = &dd->retunes[d];
+        const uint64_t now = dummy_clock_now(dd, d == 0 ? BLADERF_RX : BLADERF_TX);
+
+        while (q->count > 0 && q->entries[0].timestamp <= now) {
+            dummy_apply_retune(dd, &q->entries[0]);
+            q->count--;
+            memmove(&q->entries[0], &q->entries[1],
+                    q->count * sizeof(q->entries[0]));
+        }
+    }
+}
+
+static int dummy_schedule_retune(struct bladerf *dev,
+                                 struct dummy_device *dd,
+                                 const struct dummy_retune *r)
+{
+    struct dummy_retune_queue *q = &dd->retunes[dummy_dir_idx(dummy_ch_dir(r->ch))];
+    const size_t depth = r->is_retune2 ? DUMMY_RETUNE2_QUEUE_MAX
+                                       : DUMMY_RETUNE_QUEUE_MAX;
+    int status = 0;
+
+    if (r->timestamp == NIOS_PKT_RETUNE_CLEAR_QUEUE) {
+        q->count = 0;
+    } else {
+        dummy_service_retunes(dd);
+
+        if (r->timestamp == NIOS_PKT_RETUNE_NOW) {
+            dummy_apply_retune(dd, r);
+        } else if (q->count >= depth) {
+            status = BLADERF_ERR_QUEUE_FULL;
+        } else {
+            q->entries[q->count++] = *r;
+        }
+    }
+
+    /* Report the occupancy as the firmware does in its response */
+    dev->retune_queue[BLADERF_CHANNEL_IS_TX(r->ch)].fill  = q->count;
+    dev->retune_queue[BLADERF_CHANNEL_IS_TX(r->ch)].depth = depth;
+
+    return status;
+}
+
+/******************************************************************************/
+/* Environment configuration */
+/******************************************************************************/
+
+static void dummy_parse_tones(struct dummy_device *dd, const char *str)
+{
+    char *copy, *tok, *amp, *saveptr = NULL;
+    bool ok;
+
+    dd->num_tones = 0;
+
+    copy = strdup(str);
+    if (copy == NULL) {
+        return;
+    }
+
+    for (tok = strtok_r(copy, ",", &saveptr);
+         tok != NULL && dd->num_tones < DUMMY_MAX_TONES;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        struct dummy_tone *t = &dd->tones[dd->num_tones];
+
+        amp = strchr(tok, '@');
+        if (amp != NULL) {
+            *amp++ = '\0';
+        }
+
+        t->freq = str2double(tok, -1e9, 1e9, &ok);
+        if (!ok) {
+            log_warning("Ignoring invalid simulated tone: %s\n", tok);
+            continue;
+        }
+
+        t->amplitude = 1.0;
+        if (amp != NULL) {
+            t->amplitude = str2double(amp, 0.0, 1.0, &ok);
+            if (!ok) {
+                log_warning("Ignoring invalid tone amplitude: %s\n", amp);
+                continue;
+            }
+        }
+
+        dd->num_tones++;
+    }
+
+    free(copy);
+}
+
+static void dummy_load_config(struct dummy_device *dd)
+{
+    const char *env;
+    bool ok;
+
+    dd->board    = DUMMY_BOARD_BLADERF2;
+    dd->realtime = true;
+
+    dd->tones[0].freq      = 100e3;
+    dd->tones[0].amplitude = 0.5;
+    dd->num_tones          = 1;
+    dd->noise              = 0.01;
+
+    env = getenv("BLADERF_DUMMY_BOARD");
+    if (env != NULL) {
+        if (!strcasecmp(env, "bladerf1")) {
+            dd->board = DUMMY_BOARD_BLADERF1;
+        } else if (strcasecmp(env, "bladerf2") != 0) {
+            log_warning("Unknown BLADERF_DUMMY_BOARD \"%s\". "
+                        "Defaulting to bladerf2.\n", env);
+        }
+    }
+
+    env = getenv("BLADERF_DUMMY_TONES");
+    if (env != NULL) {
+        dummy_parse_tones(dd, env);
+    }
+
+    env = getenv("BLADERF_DUMMY_NOISE");
+    if (env != NULL) {
+        double noise = str2double(env, 0.0, 1.0, &ok);
+        if (ok) {
+            dd->noise = noise;
+        } else {
+            log_warning("Ignoring invalid BLADERF_DUMMY_NOISE: %s\n", env);
+        }
+    }
+
+    env = getenv("BLADERF_DUMMY_BURST");
+    if (env != NULL) {
+        const char *sep = strchr(env, ':');
+        char on[32] = { 0 };
+        bool on_ok = false, off_ok = false;
+        uint64_t burst_on = 0, burst_off = 0;
+
+        if (sep != NULL && (size_t)(sep - env) < sizeof(on)) {
+            memcpy(on, env, sep - env);
+            burst_on  = str2uint64(on, 1, UINT64_MAX, &on_ok);
+            burst_off = str2uint64(sep + 1, 0, UINT64_MAX, &off_ok);
+        }
+
+        if (on_ok && off_ok) {
+            dd->burst_on  = burst_on;
+            dd->burst_off = burst_off;
+        } else {
+            log_warning("Ignoring invalid BLADERF_DUMMY_BURST: %s\n", env);
+        }
+    }
+
+    env = getenv("BLADERF_DUMMY_REALTIME");
+    if (env != NULL) {
+        dd->realtime = str2uint(env, 0, 1, &ok) != 0 || !ok;
+    }
+
+    env = getenv("BLADERF_DUMMY_NIOS");
+    if (env != NULL) {
+        dd->nios = str2uint(env, 0, 1, &ok) != 0 && ok;
+        if (!ok) {
+            log_warning("Ignoring invalid BLADERF_DUMMY_NIOS: %s\n", env);
+        }
+    }
+}
+
+/******************************************************************************/
+/* Open, close, and probe */
+/******************************************************************************/
 
 static bool dummy_matches(bladerf_backend backend)
 {
-    return false;
+    return backend == BLADERF_BACKEND_DUMMY;
+}
+
+static void dummy_fill_devinfo(struct bladerf_devinfo *info)
+{
+    memset(info, 0, sizeof(*info));
+
+    info->backend  = BLADERF_BACKEND_DUMMY;
+    info->usb_bus  = 0;
+    info->usb_addr = 0;
+    info->instance = 0;
+    snprintf(info->serial, sizeof(info->serial), "%s", DUMMY_SERIAL);
+    snprintf(info->manufacturer, sizeof(info->manufacturer), "Nuand");
+    snprintf(info->product, sizeof(info->product), "Simulated bladeRF");
 }
 
-/* We never "find" dummy devices */
 static int dummy_probe(backend_probe_target probe_target,
                        struct bladerf_devinfo_list *info_list)
 {
-    return 0;
+    struct bladerf_devinfo info;
+
+    if (probe_target != BACKEND_PROBE_BLADERF) {
+        return 0;
+    }
+
+    dummy_fill_devinfo(&info);
+
+    return bladerf_devinfo_list_add(info_list, &info);
 }
 
 static int dummy_get_vid_pid(struct bladerf *dev, uint16_t *vid, uint16_t *pid)
 {
-    return BLADERF_ERR_UNSUPPORTED;
+    struct dummy_device *dd = dummy_backend(dev);
+
+    *vid = USB_NUAND_VENDOR_ID;
+
+    if (dd->board == DUMMY_BOARD_BLADERF1) {
+        *pid = USB_NUAND_BLADERF_PRODUCT_ID;
+    } else {
+        *pid = USB_NUAND_BLADERF2_PRODUCT_ID;
+    }
+
+    return 0;
+}
+
+static int dummy_init_flash(struct dummy_device *dd)
+{
+    uint8_t *cal;
+    char buf[16];
+    int status;
+
+    dd->flash = malloc(DUMMY_FLASH_SIZE);
+    if (dd->flash == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    memset(dd->flash, 0xff, DUMMY_FLASH_SIZE);
+
+    /* Calibration region: FPGA size and VCTCXO trim */
+    cal = dd->flash + BLADERF_FLASH_ADDR_CAL;
+
+    status = binkv_add_field((char *)cal, CAL_BUFFER_SIZE, "B",
+                             dd->board == DUMMY_BOARD_BLADERF1 ? "40" : "A4");
+    if (status < 0) {
+        return status;
+    }
+
+    snprintf(buf, sizeof(buf), "%u", dd->trim_dac);
+    status = binkv_add_field((char *)cal, CAL_BUFFER_SIZE, "DAC", buf);
+    if (status < 0) {
+        return status;
+    }
+
+    /* OTP region: serial number */
+    memset(dd->otp, 0xff, sizeof(dd->otp));
+
+    return binkv_add_field((char *)dd->otp, sizeof(dd->otp), "S", DUMMY_SERIAL);
 }
 
 static int dummy_open(struct bladerf *dev, struct bladerf_devinfo *info)
 {
-    return BLADERF_ERR_NODEV;
+    const char *replay = getenv("BLADERF_REPLAY");
+    struct trace_info trace_info;
+    struct bladerf_devinfo ident;
+    struct dummy_device *dd;
+    size_t i;
+    int status;
+
+    if (info->backend != BLADERF_BACKEND_ANY &&
+        info->backend != BLADERF_BACKEND_DUMMY) {
+        return BLADERF_ERR_NODEV;
+    }
+
+    dummy_fill_devinfo(&ident);
+
+    /* When replaying, impersonate the device the trace was recorded on */
+    if (replay != NULL) {
+        status = trace_read_info(replay, &trace_info);
+        if (status != 0) {
+            return status;
+        }
+
+        memset(ident.serial, 0, sizeof(ident.serial));
+        memcpy(ident.serial, trace_info.serial,
+               strnlen(trace_info.serial, sizeof(ident.serial) - 1));
+    }
+
+    if (!bladerf_instance_matches(&ident, info) ||
+        !bladerf_serial_matches(&ident, info)) {
+        return BLADERF_ERR_NODEV;
+    }
+
+    dd = calloc(1, sizeof(*dd));
+    if (dd == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    MUTEX_INIT(&dd->lock);
+
+    dummy_load_config(dd);
+
+    if (replay != NULL) {
+        if (trace_info.pid == USB_NUAND_BLADERF_PRODUCT_ID ||
+            trace_info.pid == USB_NUAND_BLADERF_LEGACY_PRODUCT_ID) {
+            dd->board = DUMMY_BOARD_BLADERF1;
+        } else {
+            dd->board = DUMMY_BOARD_BLADERF2;
+        }
+
+        /* Stream timing is reproduced from the trace instead */
+        dd->realtime = false;
+    }
+
+    dd->fpga_configured = true;
+    dd->fpga_source     = BLADERF_FPGA_SOURCE_FLASH;
+    dd->fpga_protocol   = BACKEND_FPGA_PROTOCOL_NIOSII;
+    dd->tamer_mode      = BLADERF_VCTCXO_TAMER_DISABLED;
+    dd->rfic_init       = BLADERF_RFIC_INIT_STATE_OFF;
+    dd->rfic_wq_success = true;
+
+    /* LMS6002D version register */
+    dd->lms[0x04] = 0x22;
+
+    /* INA219 power-on configuration */
+    dd->ina219[0] = 0x399f;
+
+    /* AD9361 product ID */
+    dd->ad9361[0x037] = 0x0a;
+
+    if (dd->board == DUMMY_BOARD_BLADERF1) {
+        dd->trim_dac = 0x8000;
+    } else {
+        dd->trim_dac = 0x1ffc;
+    }
+
+    for (i = 0; i < 2; i++) {
+        dd->clock[i].base_ns = wallclock_get_current_nsec();
+        dd->clock[i].rate    = DUMMY_DEFAULT_SAMPLE_RATE;
+    }
+
+    status = dummy_init_flash(dd);
+    if (status < 0) {
+        free(dd->flash);
+        MUTEX_DESTROY(&dd->lock);
+        free(dd);
+        return status;
+    }
+
+    dev->backend      = &backend_fns_dummy;
+    dev->backend_data = dd;
+    memcpy(&dev->ident, &ident, sizeof(ident));
+
+    if (dd->nios) {
+#ifdef ENABLE_NIOS_SIM
+        status = dummy_nios_attach(dev);
+        if (status != 0) {
+            backend_fns_dummy.close(dev);
+            return status;
+        }
+
+        dev->backend = &backend_fns_dummy_nios;
+#else
+        log_warning("BLADERF_DUMMY_NIOS requires libbladeRF to be built with "
+                    "ENABLE_NIOS_SIM. Ignoring it.\n");
+        dd->nios = false;
+#endif
+    }
+
+    log_info("Opened simulated %s (%s mode%s)\n",
+             dd->board == DUMMY_BOARD_BLADERF1 ? "bladeRF 1" : "bladeRF 2.0",
+             dd->realtime ? "real-time" : "free-running",
+             dd->nios ? ", NIOS II firmware in the loop" : "");
+
+    if (replay != NULL) {
+        const char *env = getenv("BLADERF_REPLAY_SPEED");
+        double speed    = 1.0;
+        bool ok         = true;
+
+        if (env != NULL) {
+            speed = str2double(env, 0.0, 1e6, &ok);
+            if (!ok) {
+                log_warning("Ignoring invalid BLADERF_REPLAY_SPEED: %s\n",
+                            env);
+                speed = 1.0;
+            }
+        }
+
+        status = trace_replay_attach(dev, replay, speed);
+        if (status != 0) {
+            backend_fns_dummy.close(dev);
+            return status;
+        }
+    }
+
+    return 0;
 }
 
 static int dummy_set_fpga_protocol(struct bladerf *dev,
                                    backend_fpga_protocol fpga_protocol)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->fpga_protocol = fpga_protocol;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static void dummy_close(struct bladerf *dev)
 {
-    /* Nothing to do */
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if (dd == NULL) {
+        return;
+    }
+
+    log_debug("Simulated device stats: RX %" PRIu64 " samples (%" PRIu64
+              " dropped), TX %" PRIu64 " samples (%" PRIu64 " late, %" PRIu64
+              " underrun)\n",
+              dd->stats.rx_samples, dd->stats.rx_dropped,
+              dd->stats.tx_samples, dd->stats.tx_late,
+              dd->stats.tx_underrun);
+
+#ifdef ENABLE_NIOS_SIM
+    if (dd->nios) {
+        dummy_nios_detach(dd);
+    }
+#endif
+
+    free(dd->flash);
+    MUTEX_DESTROY(&dd->lock);
+    free(dd);
+
+    dev->backend_data = NULL;
 }
 
 static int dummy_is_fw_ready(struct bladerf *dev)
 {
-    return 0;
+    return 1;
 }
 
 static int dummy_get_handle(struct bladerf *dev, void **handle)
 {
+    *handle = NULL;
     return 0;
 }
 
-static int dummy_get_flash_id(struct bladerf *dev, uint8_t *mid, uint8_t *did)
-{
-    return BLADERF_ERR_UNSUPPORTED;
-}
+/******************************************************************************/
+/* FPGA */
+/******************************************************************************/
 
 static int dummy_load_fpga(struct bladerf *dev,
                            const uint8_t *image,
                            size_t image_size)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if (image == NULL || image_size == 0) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    dd->fpga_configured = true;
+    dd->fpga_source     = BLADERF_FPGA_SOURCE_HOST;
+    dd->config_gpio     = 0;
+    MUTEX_UNLOCK(&dd->lock);
+
+    log_debug("Simulated FPGA load of %zu bytes\n", image_size);
+
     return 0;
 }
 
 static int dummy_is_fpga_configured(struct bladerf *dev)
 {
-    return 0;
+    return dummy_backend(dev)->fpga_configured ? 1 : 0;
+}
+
+static bladerf_fpga_source dummy_get_fpga_source(struct bladerf *dev)
+{
+    return dummy_backend(dev)->fpga_source;
+}
+
+/* The caller provides storage for the version string */
+static void dummy_fill_version(struct bladerf_version *version,
+                               uint16_t major,
+                               uint16_t minor,
+                               uint16_t patch)
+{
+    version->major = major;
+    version->minor = minor;
+    version->patch = patch;
+
+    snprintf((char *)version->describe, BLADERF_VERSION_STR_MAX, "%u.%u.%u",
+             major, minor, patch);
 }
 
 static int dummy_get_fw_version(struct bladerf *dev,
                                 struct bladerf_version *version)
 {
+    dummy_fill_version(version, DUMMY_FW_MAJOR, DUMMY_FW_MINOR,
+                       DUMMY_FW_PATCH);
     return 0;
 }
 
 static int dummy_get_fpga_version(struct bladerf *dev,
                                   struct bladerf_version *version)
 {
+    dummy_fill_version(version, DUMMY_FPGA_MAJOR, DUMMY_FPGA_MINOR,
+                       DUMMY_FPGA_PATCH);
+    return 0;
+}
+
+/******************************************************************************/
+/* SPI flash, calibration, and OTP */
+/******************************************************************************/
+
+static int dummy_get_flash_id(struct bladerf *dev, uint8_t *mid, uint8_t *did)
+{
+    *mid = DUMMY_FLASH_MID;
+    *did = DUMMY_FLASH_DID;
     return 0;
 }
 
@@ -103,6 +1157,17 @@ static int dummy_erase_flash_blocks(struct bladerf *dev,
                                     uint32_t eb,
                                     uint16_t count)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if ((uint64_t)(eb + count) * DUMMY_FLASH_EB_SIZE > DUMMY_FLASH_SIZE) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    memset(dd->flash + (size_t)eb * DUMMY_FLASH_EB_SIZE, 0xff,
+           (size_t)count * DUMMY_FLASH_EB_SIZE);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -111,6 +1176,17 @@ static int dummy_read_flash_pages(struct bladerf *dev,
                                   uint32_t page,
                                   uint32_t count)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if ((uint64_t)(page + count) * DUMMY_FLASH_PAGE_SIZE > DUMMY_FLASH_SIZE) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    memcpy(buf, dd->flash + (size_t)page * DUMMY_FLASH_PAGE_SIZE,
+           (size_t)count * DUMMY_FLASH_PAGE_SIZE);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -119,6 +1195,24 @@ static int dummy_write_flash_pages(struct bladerf *dev,
                                    uint32_t page,
                                    uint32_t count)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    uint8_t *dst;
+    size_t i, len;
+
+    if ((uint64_t)(page + count) * DUMMY_FLASH_PAGE_SIZE > DUMMY_FLASH_SIZE) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    dst = dd->flash + (size_t)page * DUMMY_FLASH_PAGE_SIZE;
+    len = (size_t)count * DUMMY_FLASH_PAGE_SIZE;
+
+    /* Like NOR flash, programming can only clear bits */
+    MUTEX_LOCK(&dd->lock);
+    for (i = 0; i < len; i++) {
+        dst[i] &= buf[i];
+    }
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -129,42 +1223,88 @@ static int dummy_device_reset(struct bladerf *dev)
 
 static int dummy_jump_to_bootloader(struct bladerf *dev)
 {
-    return 0;
+    return BLADERF_ERR_UNSUPPORTED;
 }
 
 static int dummy_get_cal(struct bladerf *dev, char *cal)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    memcpy(cal, dd->flash + BLADERF_FLASH_ADDR_CAL, CAL_BUFFER_SIZE);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_get_otp(struct bladerf *dev, char *otp)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    memcpy(otp, dd->otp, DUMMY_OTP_SIZE);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_write_otp(struct bladerf *dev, char *otp)
 {
-    return 0;
+    struct dummy_device *dd = dummy_backend(dev);
+    int status = 0;
+
+    MUTEX_LOCK(&dd->lock);
+    if (dd->otp_locked) {
+        status = BLADERF_ERR_PERMISSION;
+    } else {
+        memcpy(dd->otp, otp, DUMMY_OTP_SIZE);
+    }
+    MUTEX_UNLOCK(&dd->lock);
+
+    return status;
 }
 
 static int dummy_lock_otp(struct bladerf *dev)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->otp_locked = true;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_get_device_speed(struct bladerf *dev,
                                   bladerf_dev_speed *device_speed)
 {
+    *device_speed = BLADERF_DEVICE_SPEED_SUPER;
     return 0;
 }
 
+/******************************************************************************/
+/* GPIO and IQ corrections */
+/******************************************************************************/
+
 static int dummy_config_gpio_write(struct bladerf *dev, uint32_t val)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->config_gpio = val;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_config_gpio_read(struct bladerf *dev, uint32_t *val)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *val = dd->config_gpio;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -172,23 +1312,48 @@ static int dummy_expansion_gpio_write(struct bladerf *dev,
                                       uint32_t mask,
                                       uint32_t val)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->xb_gpio = (dd->xb_gpio & ~mask) | (val & mask);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_expansion_gpio_read(struct bladerf *dev, uint32_t *val)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *val = dd->xb_gpio;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_expansion_gpio_dir_write(struct bladerf *dev,
                                           uint32_t mask,
-                                          uint32_t val)
+                                          uint32_t outputs)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->xb_gpio_dir = (dd->xb_gpio_dir & ~mask) | (outputs & mask);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
-static int dummy_expansion_gpio_dir_read(struct bladerf *dev, uint32_t *val)
+static int dummy_expansion_gpio_dir_read(struct bladerf *dev,
+                                         uint32_t *outputs)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *outputs = dd->xb_gpio_dir;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -196,6 +1361,12 @@ static int dummy_set_iq_gain_correction(struct bladerf *dev,
                                         bladerf_channel ch,
                                         int16_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->iq_gain[ch & 0x3] = value;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -203,6 +1374,12 @@ static int dummy_set_iq_phase_correction(struct bladerf *dev,
                                          bladerf_channel ch,
                                          int16_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->iq_phase[ch & 0x3] = value;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -210,7 +1387,12 @@ static int dummy_get_iq_gain_correction(struct bladerf *dev,
                                         bladerf_channel ch,
                                         int16_t *value)
 {
-    *value = 0;
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *value = dd->iq_gain[ch & 0x3];
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -218,51 +1400,199 @@ static int dummy_get_iq_phase_correction(struct bladerf *dev,
                                          bladerf_channel ch,
                                          int16_t *value)
 {
-    *value = 0;
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *value = dd->iq_phase[ch & 0x3];
+    MUTEX_UNLOCK(&dd->lock);
+
+    return 0;
+}
+
+static int dummy_set_agc_dc_correction(struct bladerf *dev,
+                                       int16_t q_max,
+                                       int16_t i_max,
+                                       int16_t q_mid,
+                                       int16_t i_mid,
+                                       int16_t q_low,
+                                       int16_t i_low)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->agc_dc[0] = q_max;
+    dd->agc_dc[1] = i_max;
+    dd->agc_dc[2] = q_mid;
+    dd->agc_dc[3] = i_mid;
+    dd->agc_dc[4] = q_low;
+    dd->agc_dc[5] = i_low;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_get_timestamp(struct bladerf *dev,
                                bladerf_direction dir,
-                               uint64_t *val)
+                               uint64_t *value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dummy_service_retunes(dd);
+    *value = dummy_clock_now(dd, dir);
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
-static int dummy_si5338_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
+/******************************************************************************/
+/* Peripheral register accessors */
+/******************************************************************************/
+
+static int dummy_si5338_write(struct bladerf *dev, uint8_t addr, uint8_t data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->si5338[addr] = data;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
-static int dummy_si5338_write(struct bladerf *dev, uint8_t addr, uint8_t data)
+static int dummy_si5338_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *data = dd->si5338[addr];
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_lms_write(struct bladerf *dev, uint8_t addr, uint8_t data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    const uint8_t reg = addr & 0x7f;
+
+    MUTEX_LOCK(&dd->lock);
+
+    dd->lms[reg] = data;
+
+    /* Track PLL reconfiguration, which moves the VCO's tuning window */
+    if ((reg & 0xf0) == 0x10 || (reg & 0xf0) == 0x20) {
+        const size_t d = ((reg & 0xf0) == 0x10) ? 1 : 0;
+
+        if ((reg & 0x0f) <= 5) {
+            dd->vco_center_pending[d] = true;
+        } else if ((reg & 0x0f) == 9 && dd->vco_center_pending[d]) {
+            dd->vco_center[d]         = data & 0x3f;
+            dd->vco_center_pending[d] = false;
+        }
+    }
+
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_lms_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    const uint8_t reg = addr & 0x7f;
+
+    MUTEX_LOCK(&dd->lock);
+
+    dummy_service_retunes(dd);
+
+    if (reg == 0x1a || reg == 0x2a) {
+        const bladerf_direction dir = (reg == 0x1a) ? BLADERF_TX : BLADERF_RX;
+        *data = (dd->lms[reg] & 0x3f) | (dummy_lms_vtune(dd, dir) << 6);
+    } else {
+        *data = dd->lms[reg];
+    }
+
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
-static int dummy_ina219_write(struct bladerf *dev, uint8_t cmd, uint16_t data)
+static int dummy_ina219_write(struct bladerf *dev, uint8_t addr, uint16_t data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if (addr >= ARRAY_SIZE(dd->ina219)) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+
+    /* A soft reset restores the power-on configuration and self-clears */
+    if (addr == 0 && (data & 0x8000)) {
+        dd->ina219[0] = 0x399f;
+    } else {
+        dd->ina219[addr] = data;
+    }
+
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_ina219_read(struct bladerf *dev, uint8_t addr, uint16_t *data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    /* Simulated load: 5.0 V bus, 900 mA through a 1 mOhm shunt */
+    switch (addr) {
+        case 1: /* Shunt voltage, 10 uV/LSB */
+            *data = 90;
+            break;
+
+        case 2: /* Bus voltage, 4 mV/LSB in bits [15:3] */
+            *data = (5000 / 4) << 3;
+            break;
+
+        case 3: /* Power, 20 mW/LSB */
+            *data = 4500 / 20;
+            break;
+
+        case 4: /* Current, 1 mA/LSB */
+            *data = 900;
+            break;
+
+        case 0:
+        case 5:
+            MUTEX_LOCK(&dd->lock);
+            *data = dd->ina219[addr];
+            MUTEX_UNLOCK(&dd->lock);
+            break;
+
+        default:
+            return BLADERF_ERR_INVAL;
+    }
+
     return 0;
 }
 
+/* AD9361 SPI commands carry up to 8 bytes, MSB first, at descending
+ * register addresses */
 static int dummy_ad9361_spi_write(struct bladerf *dev,
                                   uint16_t cmd,
                                   uint64_t data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    const uint16_t addr  = cmd & 0x3ff;
+    const unsigned count = ((cmd >> 12) & 0x7) + 1;
+    unsigned i;
+
+    MUTEX_LOCK(&dd->lock);
+    for (i = 0; i < count; i++) {
+        dd->ad9361[(addr - i) & 0x3ff] = (data >> (8 * (7 - i))) & 0xff;
+    }
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -270,30 +1600,245 @@ static int dummy_ad9361_spi_read(struct bladerf *dev,
                                  uint16_t cmd,
                                  uint64_t *data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    const uint16_t addr  = cmd & 0x3ff;
+    const unsigned count = ((cmd >> 12) & 0x7) + 1;
+    unsigned i;
+
+    *data = 0;
+
+    MUTEX_LOCK(&dd->lock);
+    for (i = 0; i < count; i++) {
+        *data |= (uint64_t)dd->ad9361[(addr - i) & 0x3ff] << (8 * (7 - i));
+    }
+    MUTEX_UNLOCK(&dd->lock);
+
+    return 0;
+}
+
+static int dummy_adi_axi_write(struct bladerf *dev,
+                               uint32_t addr,
+                               uint32_t data)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+    int status;
+
+    MUTEX_LOCK(&dd->lock);
+    status = dummy_kv_write(&dd->adi_axi, addr, data);
+    MUTEX_UNLOCK(&dd->lock);
+
+    return status;
+}
+
+static int dummy_adi_axi_read(struct bladerf *dev,
+                              uint32_t addr,
+                              uint32_t *data)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *data = dummy_kv_read(&dd->adi_axi, addr);
+    MUTEX_UNLOCK(&dd->lock);
+
+    return 0;
+}
+
+static int dummy_wishbone_master_write(struct bladerf *dev,
+                                       uint32_t addr,
+                                       uint32_t data)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+    int status;
+
+    MUTEX_LOCK(&dd->lock);
+    status = dummy_kv_write(&dd->wishbone, addr, data);
+    MUTEX_UNLOCK(&dd->lock);
+
+    return status;
+}
+
+static int dummy_wishbone_master_read(struct bladerf *dev,
+                                      uint32_t addr,
+                                      uint32_t *data)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *data = dummy_kv_read(&dd->wishbone, addr);
+    MUTEX_UNLOCK(&dd->lock);
+
+    return 0;
+}
+
+static int dummy_rfic_command_write(struct bladerf *dev,
+                                    uint16_t cmd,
+                                    uint64_t data)
+{
+    struct dummy_device *dd    = dummy_backend(dev);
+    const uint8_t command      = cmd & 0xff;
+    const bladerf_channel ch   = (cmd >> 8) & 0xf;
+    const bool ch_valid        = ch < 4;
+    int status                 = 0;
+
+    if (command >= DUMMY_NUM_RFIC_CMDS) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+
+    switch (command) {
+        case BLADERF_RFIC_COMMAND_INIT:
+            if (data > BLADERF_RFIC_INIT_STATE_STANDBY) {
+                status = BLADERF_ERR_INVAL;
+            } else if (data != dd->rfic_init) {
+                if (data == BLADERF_RFIC_INIT_STATE_ON &&
+                    dd->rfic_init == BLADERF_RFIC_INIT_STATE_OFF) {
+                    dummy_rfic_reset(dd);
+                } else if (data == BLADERF_RFIC_INIT_STATE_OFF) {
+                    dd->rffe_control = 0;
+                }
+
+                dd->rfic_init = (bladerf_rfic_init_state)data;
+            }
+            break;
+
+        case BLADERF_RFIC_COMMAND_ENABLE:
+            status = ch_valid ? dummy_rfic_enable(dd, ch, data != 0)
+                              : BLADERF_ERR_INVAL;
+            break;
+
+        case BLADERF_RFIC_COMMAND_SAMPLERATE: {
+            size_t i;
+            for (i = 0; i < 4; i++) {
+                dd->rfic[i][command] = data;
+            }
+            dummy_clock_set_rate(dd, BLADERF_RX, data);
+            dummy_clock_set_rate(dd, BLADERF_TX, data);
+            break;
+        }
+
+        case BLADERF_RFIC_COMMAND_FREQUENCY:
+            status = ch_valid ? dummy_rfic_set_frequency(dd, ch, data)
+                              : BLADERF_ERR_INVAL;
+            break;
+
+        case BLADERF_RFIC_COMMAND_BANDWIDTH:
+            if (ch_valid) {
+                dd->rfic[ch & ~0x2][command] = data;
+                dd->rfic[ch | 0x2][command]  = data;
+            } else {
+                status = BLADERF_ERR_INVAL;
+            }
+            break;
+
+        case BLADERF_RFIC_COMMAND_GAINMODE:
+        case BLADERF_RFIC_COMMAND_GAIN:
+        case BLADERF_RFIC_COMMAND_FILTER:
+        case BLADERF_RFIC_COMMAND_TXMUTE:
+            if (ch_valid) {
+                dd->rfic[ch][command] = data;
+            } else {
+                status = BLADERF_ERR_INVAL;
+            }
+            break;
+
+        case BLADERF_RFIC_COMMAND_FASTLOCK:
+            if (ch_valid) {
+                dd->rfic_fastlock[dummy_dir_idx(dummy_ch_dir(ch))]
+                                 [data % NUM_RFFE_FASTLOCK_PROFILES] =
+                    dd->rfic[ch][BLADERF_RFIC_COMMAND_FREQUENCY];
+            } else {
+                status = BLADERF_ERR_INVAL;
+            }
+            break;
+
+        default:
+            /* Status, RSSI, and sync are read-only */
+            status = BLADERF_ERR_INVAL;
+            break;
+    }
+
+    dd->rfic_wq_success = (status == 0);
+
+    MUTEX_UNLOCK(&dd->lock);
+
+    /* Like the FPGA, report failures through the write queue status */
+    if (status != 0) {
+        log_debug("%s: command 0x%02x on channel %d failed: %s\n",
+                  __FUNCTION__, command, ch, bladerf_strerror(status));
+    }
+
     return 0;
 }
 
-static int dummy_adi_axi_write(struct bladerf *dev,
-                               uint32_t addr,
-                               uint32_t data)
-{
-    return 0;
-}
+static int dummy_rfic_command_read(struct bladerf *dev,
+                                   uint16_t cmd,
+                                   uint64_t *data)
+{
+    struct dummy_device *dd  = dummy_backend(dev);
+    const uint8_t command    = cmd & 0xff;
+    const bladerf_channel ch = (cmd >> 8) & 0xf;
+    int status               = 0;
+
+    if (command >= DUMMY_NUM_RFIC_CMDS) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+
+    dummy_service_retunes(dd);
+
+    switch (command) {
+        case BLADERF_RFIC_COMMAND_STATUS:
+        case BLADERF_RFIC_COMMAND_SYNC:
+            *data = dummy_rfic_status(dd);
+            break;
+
+        case BLADERF_RFIC_COMMAND_INIT:
+            *data = dd->rfic_init;
+            break;
+
+        case BLADERF_RFIC_COMMAND_ENABLE:
+            *data = _rffe_ch_enabled(dd->rffe_control, ch);
+            break;
+
+        case BLADERF_RFIC_COMMAND_RSSI:
+            /* -40 dB preamble and symbol RSSI */
+            *data = ((uint64_t)100 << BLADERF_RFIC_RSSI_MULT_SHIFT) |
+                    ((uint64_t)(uint16_t)-4000 << BLADERF_RFIC_RSSI_PRE_SHIFT) |
+                    ((uint64_t)(uint16_t)-4000 << BLADERF_RFIC_RSSI_SYM_SHIFT);
+            break;
 
-static int dummy_adi_axi_read(struct bladerf *dev,
-                              uint32_t addr,
-                              uint32_t *data)
-{
-    return 0;
+        default:
+            *data = dd->rfic[ch][command];
+            break;
+    }
+
+    MUTEX_UNLOCK(&dd->lock);
+
+    return status;
 }
 
 static int dummy_rffe_control_write(struct bladerf *dev, uint32_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->rffe_control = value;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_rffe_control_read(struct bladerf *dev, uint32_t *value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dummy_service_retunes(dd);
+    *value = dd->rffe_control;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -302,28 +1847,64 @@ static int dummy_rffe_fastlock_save(struct bladerf *dev,
                                     uint8_t rffe_profile,
                                     uint16_t nios_profile)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    const size_t d          = is_tx ? 1 : 0;
+
+    if (rffe_profile >= NUM_RFFE_FASTLOCK_PROFILES ||
+        nios_profile >= NUM_BBP_FASTLOCK_PROFILES) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    dd->nios_fastlock[d][nios_profile] = dd->rfic_fastlock[d][rffe_profile];
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_ad56x1_vctcxo_trim_dac_write(struct bladerf *dev,
                                               uint16_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->trim_dac = value;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_ad56x1_vctcxo_trim_dac_read(struct bladerf *dev,
                                              uint16_t *value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *value = dd->trim_dac;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_adf400x_write(struct bladerf *dev, uint8_t addr, uint32_t data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->adf400x[addr & 0x3] = data;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_adf400x_read(struct bladerf *dev, uint8_t addr, uint32_t *data)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *data = dd->adf400x[addr & 0x3];
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -331,6 +1912,12 @@ static int dummy_vctcxo_dac_write(struct bladerf *dev,
                                   uint8_t addr,
                                   uint16_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->vctcxo_dac[addr] = value;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -338,35 +1925,69 @@ static int dummy_vctcxo_dac_read(struct bladerf *dev,
                                  uint8_t addr,
                                  uint16_t *value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *value = dd->vctcxo_dac[addr];
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_set_vctcxo_tamer_mode(struct bladerf *dev,
                                        bladerf_vctcxo_tamer_mode mode)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->tamer_mode = mode;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_get_vctcxo_tamer_mode(struct bladerf *dev,
                                        bladerf_vctcxo_tamer_mode *mode)
 {
-    *mode = BLADERF_VCTCXO_TAMER_INVALID;
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *mode = dd->tamer_mode;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_xb_spi(struct bladerf *dev, uint32_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->xb_spi = value;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_set_firmware_loopback(struct bladerf *dev, bool enable)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    dd->fw_loopback = enable;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
 static int dummy_get_firmware_loopback(struct bladerf *dev, bool *is_enabled)
 {
-    *is_enabled = false;
+    struct dummy_device *dd = dummy_backend(dev);
+
+    MUTEX_LOCK(&dd->lock);
+    *is_enabled = dd->fw_loopback;
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -374,34 +1995,658 @@ static int dummy_enable_module(struct bladerf *dev,
                                bladerf_direction dir,
                                bool enable)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+    const size_t d          = dummy_dir_idx(dir);
+    bladerf_sample_rate rate = 0;
+
+    /* The bladeRF 1 sample rate lives in the Si5338 configuration, so ask the
+     * board for it rather than modeling the clock generator. This must be
+     * done without holding our lock, as it reads back through this backend. */
+    if (enable && dev->board->get_sample_rate != NULL) {
+        bladerf_channel ch = (dir == BLADERF_TX) ? BLADERF_CHANNEL_TX(0)
+                                                 : BLADERF_CHANNEL_RX(0);
+        if (dev->board->get_sample_rate(dev, ch, &rate) != 0) {
+            rate = 0;
+        }
+    }
+
+    MUTEX_LOCK(&dd->lock);
+
+    if (enable) {
+        dummy_clock_set_rate(dd, dir, rate);
+        dd->stream_pos[d] = dummy_clock_now(dd, dir);
+    }
+
+    dd->enabled[d] = enable;
+
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
+/******************************************************************************/
+/* Signal generation */
+/******************************************************************************/
+
+static inline uint64_t dummy_rand(struct dummy_stream_data *sd)
+{
+    /* xorshift64* */
+    sd->rng ^= sd->rng >> 12;
+    sd->rng ^= sd->rng << 25;
+    sd->rng ^= sd->rng >> 27;
+    return sd->rng * 0x2545F4914F6CDD1DULL;
+}
+
+/* Approximately Gaussian, unit variance */
+static inline double dummy_gaussian(struct dummy_stream_data *sd)
+{
+    double sum = 0.0;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        sum += (double)(dummy_rand(sd) >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+    }
+
+    /* The sum of four U(-1, 1) has a variance of 4/3 */
+    return sum * 0.8660254037844386;
+}
+
+static inline int16_t dummy_clip(double v)
+{
+    if (v > 2047.0) {
+        return 2047;
+    } else if (v < -2048.0) {
+        return -2048;
+    }
+
+    return (int16_t)lrint(v);
+}
+
+static void dummy_setup_signal(struct dummy_device *dd,
+                               struct dummy_stream_data *sd,
+                               uint64_t rate)
+{
+    size_t i;
+
+    sd->num_tones = dd->num_tones;
+    sd->noise     = dd->noise;
+    sd->burst_on  = dd->burst_on;
+    sd->burst_off = dd->burst_off;
+    sd->rng       = 0x9E3779B97F4A7C15ULL;
+
+    for (i = 0; i < sd->num_tones; i++) {
+        const double w = 2.0 * M_PI * dd->tones[i].freq / (double)rate;
+
+        sd->tones[i].re        = 1.0;
+        sd->tones[i].im        = 0.0;
+        sd->tones[i].step_re   = cos(w);
+        sd->tones[i].step_im   = sin(w);
+        sd->tones[i].amplitude = dd->tones[i].amplitude;
+    }
+}
+
+/* Generate interleaved SC16 Q11 samples for all channels, starting at the
+ * specified timestamp. Additional channels are phase-shifted copies. */
+static void dummy_generate(struct dummy_stream_data *sd,
+                           int16_t *out,
+                           size_t n,
+                           uint64_t timestamp)
+{
+    const uint64_t burst_period = sd->burst_on + sd->burst_off;
+    size_t i, t, c;
+
+    for (i = 0; i < n; i++) {
+        double re = 0.0, im = 0.0;
+
+        for (t = 0; t < sd->num_tones; t++) {
+            struct dummy_tone_state *ts = &sd->tones[t];
+            const double r = ts->re * ts->step_re - ts->im * ts->step_im;
+            const double q = ts->re * ts->step_im + ts->im * ts->step_re;
+
+            re += ts->re * ts->amplitude;
+            im += ts->im * ts->amplitude;
+
+            ts->re = r;
+            ts->im = q;
+        }
+
+        if (sd->noise > 0.0) {
+            re += sd->noise * dummy_gaussian(sd);
+            im += sd->noise * dummy_gaussian(sd);
+        }
+
+        if (sd->burst_off != 0 &&
+            ((timestamp + i) % burst_period) >= sd->burst_on) {
+            re = 0.0;
+            im = 0.0;
+        }
+
+        for (c = 0; c < sd->num_channels; c++) {
+            int16_t *s = &out[2 * (i * sd->num_channels + c)];
+
+            if (c & 1) {
+                s[0] = HOST_TO_LE16(dummy_clip(-im * 2048.0));
+                s[1] = HOST_TO_LE16(dummy_clip(re * 2048.0));
+            } else {
+                s[0] = HOST_TO_LE16(dummy_clip(re * 2048.0));
+                s[1] = HOST_TO_LE16(dummy_clip(im * 2048.0));
+            }
+        }
+    }
+
+    /* Keep rounding error from accumulating in the rotators */
+    for (t = 0; t < sd->num_tones; t++) {
+        struct dummy_tone_state *ts = &sd->tones[t];
+        const double mag = sqrt(ts->re * ts->re + ts->im * ts->im);
+
+        ts->re /= mag;
+        ts->im /= mag;
+    }
+}
+
+/* Fill n samples (summed over channels) of the specified format */
+static void dummy_fill_samples(struct dummy_stream_data *sd,
+                               bladerf_format format,
+                               uint8_t *dst,
+                               size_t n,
+                               uint64_t timestamp)
+{
+    const size_t frames = n / sd->num_channels;
+    int16_t *src;
+    size_t i;
+
+    if (format == BLADERF_FORMAT_SC16_Q11 ||
+        format == BLADERF_FORMAT_SC16_Q11_META ||
+        format == BLADERF_FORMAT_PACKET_META) {
+        dummy_generate(sd, (int16_t *)dst, frames, timestamp);
+        return;
+    }
+
+    assert(2 * n <= sd->scratch_len);
+    src = sd->scratch;
+    dummy_generate(sd, src, frames, timestamp);
+
+    if (format == BLADERF_FORMAT_SC16_Q11_PACKED) {
+        /* Two samples (four 12-bit values) per 6 bytes, little-endian */
+        for (i = 0; i + 4 <= 2 * n; i += 4) {
+            uint64_t packed = ((uint64_t)(LE16_TO_HOST(src[i + 0]) & 0xfff)) |
+                              ((uint64_t)(LE16_TO_HOST(src[i + 1]) & 0xfff) << 12) |
+                              ((uint64_t)(LE16_TO_HOST(src[i + 2]) & 0xfff) << 24) |
+                              ((uint64_t)(LE16_TO_HOST(src[i + 3]) & 0xfff) << 36);
+            size_t b;
+
+            for (b = 0; b < 6; b++) {
+                *dst++ = (packed >> (8 * b)) & 0xff;
+            }
+        }
+    } else {
+        /* SC8 Q7 */
+        for (i = 0; i < 2 * n; i++) {
+            dst[i] = (uint8_t)(int8_t)((int16_t)LE16_TO_HOST(src[i]) >> 4);
+        }
+    }
+}
+
+/******************************************************************************/
+/* Streaming */
+/******************************************************************************/
+
+static inline bool dummy_format_has_meta(bladerf_format format)
+{
+    return format == BLADERF_FORMAT_SC16_Q11_META ||
+           format == BLADERF_FORMAT_SC8_Q7_META;
+}
+
+/* Sleep until the direction's clock reaches the specified timestamp, or
+ * until the stream stops running */
+static void dummy_wait_for(struct dummy_device *dd,
+                           struct bladerf_stream *stream,
+                           bladerf_direction dir,
+                           uint64_t timestamp)
+{
+    uint64_t ns;
+
+    while (stream->state == STREAM_RUNNING) {
+        MUTEX_LOCK(&dd->lock);
+        ns = dummy_clock_ns_until(dd, dir, timestamp);
+        MUTEX_UNLOCK(&dd->lock);
+
+        if (ns == 0) {
+            break;
+        }
+
+        if (ns > DUMMY_MAX_SLEEP_NS) {
+            ns = DUMMY_MAX_SLEEP_NS;
+        }
+
+        usleep((unsigned int)((ns + 999) / 1000));
+    }
+}
+
+static void dummy_rx_transfer(struct dummy_device *dd,
+                              struct bladerf_stream *stream,
+                              struct dummy_stream_data *sd,
+                              uint8_t *buf,
+                              size_t len)
+{
+    const size_t bps        = samples_to_bytes(stream->format, 1);
+    const size_t nch        = sd->num_channels;
+    const bool has_meta     = dummy_format_has_meta(stream->format);
+    const bool packet_meta  = stream->format == BLADERF_FORMAT_PACKET_META;
+    size_t total, msg_bytes, n_msgs, per_msg, m;
+    uint64_t pos, now;
+
+    /* Determine how the buffer divides into messages */
+    if (has_meta) {
+        msg_bytes = DUMMY_MSG_SIZE;
+        n_msgs    = len / msg_bytes;
+        per_msg   = (msg_bytes - METADATA_HEADER_SIZE) / bps;
+    } else if (packet_meta) {
+        msg_bytes = len;
+        n_msgs    = 1;
+        per_msg   = (len - METADATA_HEADER_SIZE) / bps;
+    } else {
+        msg_bytes = len;
+        n_msgs    = 1;
+        per_msg   = len / bps;
+    }
+
+    total = (n_msgs * per_msg) / nch;
+
+    MUTEX_LOCK(&dd->lock);
+
+    pos = dd->stream_pos[0];
+    now = dummy_clock_now(dd, BLADERF_RX);
+
+    /* If the host fell behind, the FIFO overflowed and samples were lost */
+    if (dd->realtime && now > pos + total + DUMMY_RX_FIFO_SAMPLES) {
+        dd->stats.rx_dropped += now - total - pos;
+        pos = now - total;
+    }
+
+    dd->stream_pos[0] = pos + total;
+
+    MUTEX_UNLOCK(&dd->lock);
+
+    /* Samples are available once the last one has been "received" */
+    dummy_wait_for(dd, stream, BLADERF_RX, pos + total);
+
+    for (m = 0; m < n_msgs; m++) {
+        uint8_t *msg = buf + m * msg_bytes;
+
+        if (has_meta) {
+            metadata_set(msg, pos, 0);
+            msg += METADATA_HEADER_SIZE;
+        } else if (packet_meta) {
+            metadata_set_packet(msg, pos, 0, (uint16_t)per_msg, 0, 0);
+            msg += METADATA_HEADER_SIZE;
+        }
+
+        dummy_fill_samples(sd, stream->format, msg, per_msg, pos);
+        pos += per_msg / nch;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    dd->stats.rx_samples += total;
+    dummy_clock_advance(dd, BLADERF_RX, pos);
+    dummy_service_retunes(dd);
+    MUTEX_UNLOCK(&dd->lock);
+}
+
+static void dummy_tx_transfer(struct dummy_device *dd,
+                              struct bladerf_stream *stream,
+                              struct dummy_stream_data *sd,
+                              uint8_t *buf,
+                              size_t len)
+{
+    const size_t bps       = samples_to_bytes(stream->format, 1);
+    const size_t nch       = sd->num_channels;
+    const bool has_meta    = dummy_format_has_meta(stream->format);
+    const bool packet_meta = stream->format == BLADERF_FORMAT_PACKET_META;
+    size_t msg_bytes, n_msgs, m;
+
+    if (has_meta) {
+        msg_bytes = DUMMY_MSG_SIZE;
+        n_msgs    = len / msg_bytes;
+    } else {
+        msg_bytes = len;
+        n_msgs    = 1;
+    }
+
+    for (m = 0; m < n_msgs && stream->state == STREAM_RUNNING; m++) {
+        const uint8_t *msg = buf + m * msg_bytes;
+        uint64_t timestamp = 0;
+        uint64_t start, now, n;
+
+        if (has_meta) {
+            timestamp = metadata_get_timestamp(msg);
+            n         = (msg_bytes - METADATA_HEADER_SIZE) / bps / nch;
+        } else if (packet_meta) {
+            timestamp = metadata_get_timestamp(msg);
+            n         = metadata_get_packet_len(msg) / nch;
+        } else {
+            n = len / bps / nch;
+        }
+
+        MUTEX_LOCK(&dd->lock);
+
+        start = dd->stream_pos[1];
+        now   = dummy_clock_now(dd, BLADERF_TX);
+
+        if (timestamp != 0) {
+            if (timestamp < start) {
+                dd->stats.tx_late += n;
+                if (!sd->warned_late) {
+                    log_warning("Simulated TX message at t=%" PRIu64
+                                " arrived late (now t=%" PRIu64 ")\n",
+                                timestamp, start);
+                    sd->warned_late = true;
+                }
+            } else {
+                start = timestamp;
+            }
+        } else if (dd->realtime && now > start) {
+            /* Continuous samples that arrive after the FIFO drained */
+            if (!has_meta && !packet_meta) {
+                dd->stats.tx_underrun += now - start;
+            }
+            start = now;
+        }
+
+        dd->stream_pos[1] = start + n;
+
+        MUTEX_UNLOCK(&dd->lock);
+
+        dummy_wait_for(dd, stream, BLADERF_TX, start);
+
+        MUTEX_LOCK(&dd->lock);
+        dd->stats.tx_samples += n;
+        dummy_clock_advance(dd, BLADERF_TX, start + n);
+        dummy_service_retunes(dd);
+        MUTEX_UNLOCK(&dd->lock);
+    }
+}
+
 static int dummy_init_stream(struct bladerf_stream *stream,
                              size_t num_transfers)
 {
+    struct dummy_stream_data *sd;
+    const size_t buf_bytes = async_stream_buf_bytes(stream);
+
+    sd = calloc(1, sizeof(*sd));
+    if (sd == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    sd->xfer_buf = calloc(num_transfers, sizeof(sd->xfer_buf[0]));
+    sd->xfer_len = calloc(num_transfers, sizeof(sd->xfer_len[0]));
+
+    /* SC16 scratch space for formats that are converted after generation */
+    sd->scratch_len = 2 * stream->samples_per_buffer;
+    sd->scratch     = malloc(sd->scratch_len * sizeof(int16_t));
+
+    if (sd->xfer_buf == NULL || sd->xfer_len == NULL || sd->scratch == NULL ||
+        buf_bytes == 0) {
+        free(sd->xfer_buf);
+        free(sd->xfer_len);
+        free(sd->scratch);
+        free(sd);
+        return BLADERF_ERR_MEM;
+    }
+
+    sd->num_transfers = num_transfers;
+    sd->num_avail     = num_transfers;
+    sd->head          = 0;
+    COND_INIT(&sd->xfer_ready);
+
+    stream->backend_data = sd;
+
+    return 0;
+}
+
+/* Precondition: stream->lock is held and a transfer is available */
+static int dummy_submit_transfer(struct bladerf_stream *stream,
+                                 void *buffer,
+                                 size_t len)
+{
+    struct dummy_stream_data *sd = stream->backend_data;
+    const size_t in_flight       = sd->num_transfers - sd->num_avail;
+    const size_t idx             = (sd->head + in_flight) % sd->num_transfers;
+
+    assert(sd->num_avail != 0);
+
+    if (len > async_stream_buf_bytes(stream)) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    sd->xfer_buf[idx] = buffer;
+    sd->xfer_len[idx] = len;
+    sd->num_avail--;
+
+    COND_SIGNAL(&sd->xfer_ready);
+
     return 0;
 }
 
+/* Precondition: stream->lock is held */
+static void dummy_retire_transfer(struct bladerf_stream *stream)
+{
+    struct dummy_stream_data *sd = stream->backend_data;
+
+    sd->head = (sd->head + 1) % sd->num_transfers;
+    sd->num_avail++;
+    COND_SIGNAL(&stream->can_submit_buffer);
+}
+
+/* Precondition: stream->lock is held */
+static void dummy_submit_next(struct bladerf_stream *stream,
+                              void *buffer,
+                              struct bladerf_metadata *metadata)
+{
+    int status;
+
+    if (buffer == BLADERF_STREAM_SHUTDOWN) {
+        stream->state = STREAM_SHUTTING_DOWN;
+    } else if (buffer != BLADERF_STREAM_NO_DATA) {
+        if ((stream->layout & BLADERF_DIRECTION_MASK) == BLADERF_TX &&
+            stream->format == BLADERF_FORMAT_PACKET_META) {
+            status = dummy_submit_transfer(stream, buffer,
+                                           metadata->actual_count *
+                                               sizeof(uint32_t));
+        } else {
+            status = dummy_submit_transfer(stream, buffer,
+                                           async_stream_buf_bytes(stream));
+        }
+
+        if (status != 0) {
+            stream->error_code = status;
+            stream->state      = STREAM_SHUTTING_DOWN;
+        }
+    }
+}
+
 static int dummy_stream(struct bladerf_stream *stream,
                         bladerf_channel_layout layout)
 {
+    struct bladerf *dev          = stream->dev;
+    struct dummy_device *dd      = dummy_backend(dev);
+    struct dummy_stream_data *sd = stream->backend_data;
+    struct bladerf_metadata metadata;
+    void *buffer;
+    size_t i;
+
+    memset(&metadata, 0, sizeof(metadata));
+
+    sd->dir = (layout & BLADERF_DIRECTION_MASK) == BLADERF_TX ? BLADERF_TX
+                                                              : BLADERF_RX;
+    sd->num_channels =
+        (layout == BLADERF_RX_X2 || layout == BLADERF_TX_X2) ? 2 : 1;
+
+    MUTEX_LOCK(&dd->lock);
+    dummy_setup_signal(dd, sd, dd->clock[dummy_dir_idx(sd->dir)].rate);
+    MUTEX_UNLOCK(&dd->lock);
+
+    MUTEX_LOCK(&stream->lock);
+
+    /* Set up initial set of buffers */
+    for (i = 0; i < sd->num_transfers; i++) {
+        if (sd->dir == BLADERF_TX) {
+            buffer = stream->cb(dev, stream, &metadata, NULL,
+                                stream->samples_per_buffer, stream->user_data);
+
+            if (buffer == BLADERF_STREAM_SHUTDOWN) {
+                if (sd->num_avail != sd->num_transfers) {
+                    stream->state = STREAM_SHUTTING_DOWN;
+                } else {
+                    stream->state = STREAM_DONE;
+                }
+                break;
+            }
+        } else {
+            buffer = stream->buffers[i];
+        }
+
+        dummy_submit_next(stream, buffer, &metadata);
+
+        if (stream->state != STREAM_RUNNING) {
+            break;
+        }
+    }
+
+    while (stream->state != STREAM_DONE) {
+        uint8_t *xfer_buf;
+        size_t xfer_len;
+
+        if (stream->state == STREAM_SHUTTING_DOWN) {
+            /* Cancel whatever is still in flight */
+            while (sd->num_avail != sd->num_transfers) {
+                dummy_retire_transfer(stream);
+            }
+
+            stream->state = STREAM_DONE;
+            break;
+        }
+
+        if (sd->num_avail == sd->num_transfers) {
+            /* Nothing in flight; wait for the host to submit a buffer */
+            COND_TIMED_WAIT(&sd->xfer_ready, &stream->lock, 100);
+            continue;
+        }
+
+        xfer_buf = sd->xfer_buf[sd->head];
+        xfer_len = sd->xfer_len[sd->head];
+
+        MUTEX_UNLOCK(&stream->lock);
+
+        if (sd->dir == BLADERF_TX) {
+            dummy_tx_transfer(dd, stream, sd, xfer_buf, xfer_len);
+        } else {
+            dummy_rx_transfer(dd, stream, sd, xfer_buf, xfer_len);
+        }
+
+        trace_replay_pace_transfer(stream->dev, sd->dir);
+
+        /* Give the firmware a chance to perform scheduled retunes */
+        dummy_nios_poll(dd);
+
+        MUTEX_LOCK(&stream->lock);
+
+        /* A shutdown while the transfer was in progress cancels it */
+        if (stream->state != STREAM_RUNNING) {
+            continue;
+        }
+
+        dummy_retire_transfer(stream);
+
+        buffer = stream->cb(dev, stream, &metadata, xfer_buf,
+                            bytes_to_samples(stream->format, xfer_len),
+                            stream->user_data);
+
+        dummy_submit_next(stream, buffer, &metadata);
+
+        if (stream->state == STREAM_SHUTTING_DOWN &&
+            sd->num_avail == sd->num_transfers) {
+            stream->state = STREAM_DONE;
+        }
+    }
+
+    MUTEX_UNLOCK(&stream->lock);
+
     return 0;
 }
 
+/* The top-level code will have acquired the stream->lock for us */
 static int dummy_submit_stream_buffer(struct bladerf_stream *stream,
                                       void *buffer,
+                                      size_t *length,
                                       unsigned int timeout_ms,
                                       bool nonblock)
 {
-    return 0;
+    struct dummy_stream_data *sd = stream->backend_data;
+    int status                   = 0;
+
+    if (buffer == BLADERF_STREAM_SHUTDOWN) {
+        if (sd->num_avail == sd->num_transfers) {
+            stream->state = STREAM_DONE;
+        } else {
+            stream->state = STREAM_SHUTTING_DOWN;
+        }
+
+        COND_SIGNAL(&sd->xfer_ready);
+        return 0;
+    }
+
+    if (sd->num_avail == 0) {
+        if (nonblock) {
+            log_debug("Non-blocking buffer submission requested, but no "
+                      "transfers are currently available.\n");
+
+            return BLADERF_ERR_WOULD_BLOCK;
+        }
+
+        if (timeout_ms != 0) {
+            while (sd->num_avail == 0 && status == THREAD_SUCCESS) {
+                status = COND_TIMED_WAIT(&stream->can_submit_buffer,
+                                         &stream->lock, timeout_ms);
+            }
+        } else {
+            while (sd->num_avail == 0 && status == THREAD_SUCCESS) {
+                status = COND_WAIT(&stream->can_submit_buffer, &stream->lock);
+            }
+        }
+    }
+
+    if (status == THREAD_TIMEOUT) {
+        log_debug("%s: Timed out waiting for a transfer to become available.\n",
+                  __FUNCTION__);
+        return BLADERF_ERR_TIMEOUT;
+    } else if (status != 0) {
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    return dummy_submit_transfer(stream, buffer, *length);
 }
 
 static void dummy_deinit_stream(struct bladerf_stream *stream)
 {
-    return;
+    struct dummy_stream_data *sd = stream->backend_data;
+
+    if (sd == NULL) {
+        return;
+    }
+
+    free(sd->xfer_buf);
+    free(sd->xfer_len);
+    free(sd->scratch);
+    free(sd);
+
+    stream->backend_data = NULL;
 }
 
+/******************************************************************************/
+/* Retune */
+/******************************************************************************/
+
 static int dummy_retune(struct bladerf *dev,
                         bladerf_channel ch,
                         uint64_t timestamp,
@@ -410,18 +2655,67 @@ static int dummy_retune(struct bladerf *dev,
                         uint8_t freqsel,
                         uint8_t vcocap,
                         bool low_band,
+                        uint8_t xb_gpio,
                         bool quick_tune)
 {
-    return 0;
+    struct dummy_device *dd = dummy_backend(dev);
+    struct dummy_retune r;
+    int status;
+
+    memset(&r, 0, sizeof(r));
+    r.timestamp = timestamp;
+    r.ch        = ch;
+    r.nint      = nint;
+    r.nfrac     = nfrac;
+    r.freqsel   = freqsel;
+    r.vcocap    = vcocap;
+    r.low_band  = low_band;
+    r.xb_gpio   = xb_gpio;
+
+    MUTEX_LOCK(&dd->lock);
+    status = dummy_schedule_retune(dev, dd, &r);
+    MUTEX_UNLOCK(&dd->lock);
+
+    return status;
 }
 
+static int dummy_retune2(struct bladerf *dev,
+                         bladerf_channel ch,
+                         uint64_t timestamp,
+                         uint16_t nios_profile,
+                         uint8_t rffe_profile,
+                         uint8_t port,
+                         uint8_t spdt)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+    struct dummy_retune r;
+    int status;
+
+    if (nios_profile >= NUM_BBP_FASTLOCK_PROFILES) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    memset(&r, 0, sizeof(r));
+    r.timestamp    = timestamp;
+    r.ch           = ch;
+    r.is_retune2   = true;
+    r.nios_profile = nios_profile;
+    r.port         = port;
+    r.spdt         = spdt;
+
+    MUTEX_LOCK(&dd->lock);
+    status = dummy_schedule_retune(dev, dd, &r);
+    MUTEX_UNLOCK(&dd->lock);
+
+    return status;
+}
 
 static int dummy_load_fw_from_bootloader(bladerf_backend backend,
                                          uint8_t bus,
                                          uint8_t addr,
                                          struct fx3_firmware *fw)
 {
-    return 0;
+    return BLADERF_ERR_UNSUPPORTED;
 }
 
 static int dummy_read_fw_log(struct bladerf *dev, logger_entry *e)
@@ -435,7 +2729,16 @@ static int dummy_read_trigger(struct bladerf *dev,
                               bladerf_trigger_signal trigger,
                               uint8_t *value)
 {
-    *value = 0;
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if (ch < 0 || ch > 3 || trigger < 0 || trigger > 15) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    *value = dd->triggers[ch][trigger];
+    MUTEX_UNLOCK(&dd->lock);
+
     return 0;
 }
 
@@ -444,9 +2747,371 @@ static int dummy_write_trigger(struct bladerf *dev,
                                bladerf_trigger_signal trigger,
                                uint8_t value)
 {
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if (ch < 0 || ch > 3 || trigger < 0 || trigger > 15) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->lock);
+    dd->triggers[ch][trigger] = value;
+    MUTEX_UNLOCK(&dd->lock);
+
+    return 0;
+}
+
+#ifdef ENABLE_NIOS_SIM
+/******************************************************************************/
+/* NIOS II firmware in the loop */
+/******************************************************************************/
+
+/* The firmware keeps its state in globals, so only one device may run it */
+static struct dummy_device *dummy_nios_owner = NULL;
+
+/* The FPGA has a single trigger control register per direction */
+static inline uint8_t *dummy_nios_trigger(struct dummy_device *dd,
+                                          uint32_t module)
+{
+    return &dd->triggers[module == BLADERF_MODULE_TX ? BLADERF_CHANNEL_TX(0)
+                                                     : BLADERF_CHANNEL_RX(0)][0];
+}
+
+static int dummy_nios_read(void *ctx,
+                           nios_sim_periph periph,
+                           uint32_t addr,
+                           uint64_t *data)
+{
+    struct bladerf *dev     = ctx;
+    struct dummy_device *dd = dummy_backend(dev);
+    bladerf_vctcxo_tamer_mode mode;
+    uint8_t u8   = 0;
+    uint16_t u16 = 0;
+    uint32_t u32 = 0;
+    int16_t s16  = 0;
+    int status;
+
+    switch (periph) {
+        case NIOS_SIM_LMS6:
+            status = dummy_lms_read(dev, addr, &u8);
+            *data  = u8;
+            break;
+
+        case NIOS_SIM_SI5338:
+            status = dummy_si5338_read(dev, addr, &u8);
+            *data  = u8;
+            break;
+
+        case NIOS_SIM_INA219:
+            status = dummy_ina219_read(dev, addr, &u16);
+            *data  = u16;
+            break;
+
+        case NIOS_SIM_AD9361:
+            status = dummy_ad9361_spi_read(dev, addr, data);
+            break;
+
+        case NIOS_SIM_ADI_AXI:
+            status = dummy_adi_axi_read(dev, addr, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_WISHBONE:
+            status = dummy_wishbone_master_read(dev, addr, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_CONFIG_GPIO:
+            status = dummy_config_gpio_read(dev, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_RFFE_CSR:
+            status = dummy_rffe_control_read(dev, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_XB_GPIO:
+            status = dummy_expansion_gpio_read(dev, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_XB_GPIO_DIR:
+            status = dummy_expansion_gpio_dir_read(dev, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_IQ_GAIN:
+            status = dummy_get_iq_gain_correction(dev, addr, &s16);
+            *data  = (uint16_t)s16;
+            break;
+
+        case NIOS_SIM_IQ_PHASE:
+            status = dummy_get_iq_phase_correction(dev, addr, &s16);
+            *data  = (uint16_t)s16;
+            break;
+
+        case NIOS_SIM_TIMESTAMP:
+            status = dummy_get_timestamp(
+                dev, addr == BLADERF_MODULE_TX ? BLADERF_TX : BLADERF_RX, data);
+            break;
+
+        case NIOS_SIM_VCTCXO_DAC:
+            status = dummy_vctcxo_dac_read(dev, addr, &u16);
+            *data  = u16;
+            break;
+
+        case NIOS_SIM_AD56X1_DAC:
+            status = dummy_ad56x1_vctcxo_trim_dac_read(dev, &u16);
+            *data  = u16;
+            break;
+
+        case NIOS_SIM_ADF400X:
+            status = dummy_adf400x_read(dev, addr, &u32);
+            *data  = u32;
+            break;
+
+        case NIOS_SIM_TRIGGER:
+            MUTEX_LOCK(&dd->lock);
+            *data = *dummy_nios_trigger(dd, addr);
+            MUTEX_UNLOCK(&dd->lock);
+            status = 0;
+            break;
+
+        case NIOS_SIM_TAMER_MODE:
+            status = dummy_get_vctcxo_tamer_mode(dev, &mode);
+            *data  = (uint64_t)mode;
+            break;
+
+        case NIOS_SIM_RFIC:
+            status = dummy_rfic_command_read(dev, addr, data);
+            break;
+
+        default:
+            status = BLADERF_ERR_UNSUPPORTED;
+            break;
+    }
+
+    return status;
+}
+
+static int dummy_nios_write(void *ctx,
+                            nios_sim_periph periph,
+                            uint32_t addr,
+                            uint64_t data)
+{
+    struct bladerf *dev     = ctx;
+    struct dummy_device *dd = dummy_backend(dev);
+    int status              = 0;
+
+    switch (periph) {
+        case NIOS_SIM_LMS6:
+            status = dummy_lms_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_SI5338:
+            status = dummy_si5338_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_INA219:
+            status = dummy_ina219_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_AD9361:
+            status = dummy_ad9361_spi_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_ADI_AXI:
+            status = dummy_adi_axi_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_WISHBONE:
+            status = dummy_wishbone_master_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_CONFIG_GPIO:
+            status = dummy_config_gpio_write(dev, data);
+            break;
+
+        case NIOS_SIM_RFFE_CSR:
+            status = dummy_rffe_control_write(dev, data);
+            break;
+
+        case NIOS_SIM_RFFE_SPDT:
+            MUTEX_LOCK(&dd->lock);
+            dummy_rffe_select_spdt(
+                dd, addr == BLADERF_MODULE_TX ? BLADERF_TX : BLADERF_RX, data);
+            MUTEX_UNLOCK(&dd->lock);
+            break;
+
+        case NIOS_SIM_XB_GPIO:
+            status = dummy_expansion_gpio_write(dev, 0xffffffff, data);
+            break;
+
+        case NIOS_SIM_XB_GPIO_DIR:
+            status = dummy_expansion_gpio_dir_write(dev, 0xffffffff, data);
+            break;
+
+        case NIOS_SIM_XB_SPI:
+            status = dummy_xb_spi(dev, data);
+            break;
+
+        case NIOS_SIM_IQ_GAIN:
+            status = dummy_set_iq_gain_correction(dev, addr, (int16_t)data);
+            break;
+
+        case NIOS_SIM_IQ_PHASE:
+            status = dummy_set_iq_phase_correction(dev, addr, (int16_t)data);
+            break;
+
+        case NIOS_SIM_AGC_DC:
+            if (addr >= ARRAY_SIZE(dd->agc_dc)) {
+                return BLADERF_ERR_INVAL;
+            }
+
+            MUTEX_LOCK(&dd->lock);
+            dd->agc_dc[addr] = (int16_t)data;
+            MUTEX_UNLOCK(&dd->lock);
+            break;
+
+        case NIOS_SIM_VCTCXO_DAC:
+            status = dummy_vctcxo_dac_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_AD56X1_DAC:
+            status = dummy_ad56x1_vctcxo_trim_dac_write(dev, data);
+            break;
+
+        case NIOS_SIM_ADF400X:
+            status = dummy_adf400x_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_TRIGGER:
+            MUTEX_LOCK(&dd->lock);
+            *dummy_nios_trigger(dd, addr) = data;
+            MUTEX_UNLOCK(&dd->lock);
+            break;
+
+        case NIOS_SIM_TAMER_MODE:
+            status = dummy_set_vctcxo_tamer_mode(dev, data);
+            break;
+
+        case NIOS_SIM_RFIC:
+            status = dummy_rfic_command_write(dev, addr, data);
+            break;
+
+        case NIOS_SIM_FASTLOCK_SAVE:
+            status = dummy_rffe_fastlock_save(dev, (addr >> 16) != 0,
+                                              addr & 0xff, data);
+            break;
+
+        case NIOS_SIM_FASTLOCK_RECALL:
+            if (data >= NUM_BBP_FASTLOCK_PROFILES) {
+                return BLADERF_ERR_INVAL;
+            }
+
+            MUTEX_LOCK(&dd->lock);
+            status = dummy_rfic_set_frequency(
+                dd, addr,
+                dd->nios_fastlock[addr == BLADERF_MODULE_TX ? 1 : 0][data]);
+            MUTEX_UNLOCK(&dd->lock);
+            break;
+
+        default:
+            status = BLADERF_ERR_UNSUPPORTED;
+            break;
+    }
+
+    return status;
+}
+
+static const struct nios_sim_ops dummy_nios_ops = {
+    FIELD_INIT(.read, dummy_nios_read),
+    FIELD_INIT(.write, dummy_nios_write),
+};
+
+/* Stands in for the USB driver's bulk transfers on the peripheral endpoints,
+ * which carry NIOS II request and response packets */
+static int dummy_nios_bulk_transfer(void *driver,
+                                    uint8_t endpoint,
+                                    void *buffer,
+                                    uint32_t buffer_len,
+                                    uint32_t timeout_ms)
+{
+    struct dummy_device *dd = dummy_backend((struct bladerf *)driver);
+    int status              = 0;
+
+    if (buffer_len != NIOS_PKT_LEN) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dd->nios_lock);
+
+    if (endpoint == PERIPHERAL_EP_OUT) {
+        dd->nios_resp_valid = nios_sim_exec(buffer, dd->nios_resp);
+    } else if (endpoint == PERIPHERAL_EP_IN && dd->nios_resp_valid) {
+        memcpy(buffer, dd->nios_resp, NIOS_PKT_LEN);
+        dd->nios_resp_valid = false;
+    } else {
+        /* The firmware doesn't respond to packets it doesn't recognize */
+        status = BLADERF_ERR_TIMEOUT;
+    }
+
+    MUTEX_UNLOCK(&dd->nios_lock);
+
+    return status;
+}
+
+static const struct usb_fns dummy_nios_usb_fns = {
+    FIELD_INIT(.bulk_transfer, dummy_nios_bulk_transfer),
+};
+
+static int dummy_nios_attach(struct bladerf *dev)
+{
+    struct dummy_device *dd = dummy_backend(dev);
+
+    if (!__sync_bool_compare_and_swap(&dummy_nios_owner, NULL, dd)) {
+        log_error("The NIOS II firmware is already running for another "
+                  "simulated device.\n");
+        dd->nios = false;
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    MUTEX_INIT(&dd->nios_lock);
+
+    dd->usb.fn     = &dummy_nios_usb_fns;
+    dd->usb.driver = dev;
+
+    MUTEX_LOCK(&dd->nios_lock);
+    nios_sim_init(&dummy_nios_ops, dev, dd->board == DUMMY_BOARD_BLADERF2);
+    MUTEX_UNLOCK(&dd->nios_lock);
+
     return 0;
 }
 
+static void dummy_nios_detach(struct dummy_device *dd)
+{
+    MUTEX_LOCK(&dd->nios_lock);
+    nios_sim_deinit();
+    MUTEX_UNLOCK(&dd->nios_lock);
+
+    MUTEX_DESTROY(&dd->nios_lock);
+
+    __sync_bool_compare_and_swap(&dummy_nios_owner, dd, NULL);
+}
+
+/* Run the firmware's deferred work. The caller must not hold dd->lock. */
+static void dummy_nios_poll(struct dummy_device *dd)
+{
+    if (!dd->nios) {
+        return;
+    }
+
+    MUTEX_LOCK(&dd->nios_lock);
+    nios_sim_work();
+    MUTEX_UNLOCK(&dd->nios_lock);
+}
+#endif
+
 const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.matches, dummy_matches),
 
@@ -464,6 +3129,7 @@ const struct backend_fns backend_fns_dummy = {
 
     FIELD_INIT(.load_fpga, dummy_load_fpga),
     FIELD_INIT(.is_fpga_configured, dummy_is_fpga_configured),
+    FIELD_INIT(.get_fpga_source, dummy_get_fpga_source),
 
     FIELD_INIT(.get_fw_version, dummy_get_fw_version),
     FIELD_INIT(.get_fpga_version, dummy_get_fpga_version),
@@ -494,6 +3160,8 @@ const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.get_iq_gain_correction, dummy_get_iq_gain_correction),
     FIELD_INIT(.get_iq_phase_correction, dummy_get_iq_phase_correction),
 
+    FIELD_INIT(.set_agc_dc_correction, dummy_set_agc_dc_correction),
+
     FIELD_INIT(.get_timestamp, dummy_get_timestamp),
 
     FIELD_INIT(.si5338_write, dummy_si5338_write),
@@ -511,6 +3179,12 @@ const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.adi_axi_write, dummy_adi_axi_write),
     FIELD_INIT(.adi_axi_read, dummy_adi_axi_read),
 
+    FIELD_INIT(.wishbone_master_write, dummy_wishbone_master_write),
+    FIELD_INIT(.wishbone_master_read, dummy_wishbone_master_read),
+
+    FIELD_INIT(.rfic_command_write, dummy_rfic_command_write),
+    FIELD_INIT(.rfic_command_read, dummy_rfic_command_read),
+
     FIELD_INIT(.rffe_control_write, dummy_rffe_control_write),
     FIELD_INIT(.rffe_control_read, dummy_rffe_control_read),
 
@@ -542,6 +3216,7 @@ const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.deinit_stream, dummy_deinit_stream),
 
     FIELD_INIT(.retune, dummy_retune),
+    FIELD_INIT(.retune2, dummy_retune2),
 
     FIELD_INIT(.load_fw_from_bootloader, dummy_load_fw_from_bootloader),
 
@@ -551,4 +3226,131 @@ const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.write_trigger, dummy_write_trigger),
 
     FIELD_INIT(.name, "dummy"),
+
+    FIELD_INIT(.hotplug_monitor, NULL),
+    FIELD_INIT(.is_fpga_image_loaded, NULL),
+};
+
+#ifdef ENABLE_NIOS_SIM
+/* Firmware-in-the-loop mode: device control goes through the USB backend's
+ * NIOS II packet interface, and is executed by the firmware's handlers */
+static const struct backend_fns backend_fns_dummy_nios = {
+    FIELD_INIT(.matches, dummy_matches),
+
+    FIELD_INIT(.probe, dummy_probe),
+
+    FIELD_INIT(.get_vid_pid, dummy_get_vid_pid),
+    FIELD_INIT(.get_flash_id, dummy_get_flash_id),
+    FIELD_INIT(.open, dummy_open),
+    FIELD_INIT(.set_fpga_protocol, dummy_set_fpga_protocol),
+    FIELD_INIT(.close, dummy_close),
+
+    FIELD_INIT(.is_fw_ready, dummy_is_fw_ready),
+
+    FIELD_INIT(.get_handle, dummy_get_handle),
+
+    FIELD_INIT(.load_fpga, dummy_load_fpga),
+    FIELD_INIT(.is_fpga_configured, dummy_is_fpga_configured),
+    FIELD_INIT(.get_fpga_source, dummy_get_fpga_source),
+
+    FIELD_INIT(.get_fw_version, dummy_get_fw_version),
+    FIELD_INIT(.get_fpga_version, dummy_get_fpga_version),
+
+    FIELD_INIT(.erase_flash_blocks, dummy_erase_flash_blocks),
+    FIELD_INIT(.read_flash_pages, dummy_read_flash_pages),
+    FIELD_INIT(.write_flash_pages, dummy_write_flash_pages),
+
+    FIELD_INIT(.device_reset, dummy_device_reset),
+    FIELD_INIT(.jump_to_bootloader, dummy_jump_to_bootloader),
+
+    FIELD_INIT(.get_cal, dummy_get_cal),
+    FIELD_INIT(.get_otp, dummy_get_otp),
+    FIELD_INIT(.write_otp, dummy_write_otp),
+    FIELD_INIT(.lock_otp, dummy_lock_otp),
+    FIELD_INIT(.get_device_speed, dummy_get_device_speed),
+
+    FIELD_INIT(.config_gpio_write, nios_config_write),
+    FIELD_INIT(.config_gpio_read, nios_config_read),
+
+    FIELD_INIT(.expansion_gpio_write, nios_expansion_gpio_write),
+    FIELD_INIT(.expansion_gpio_read, nios_expansion_gpio_read),
+    FIELD_INIT(.expansion_gpio_dir_write, nios_expansion_gpio_dir_write),
+    FIELD_INIT(.expansion_gpio_dir_read, nios_expansion_gpio_dir_read),
+
+    FIELD_INIT(.set_iq_gain_correction, nios_set_iq_gain_correction),
+    FIELD_INIT(.set_iq_phase_correction, nios_set_iq_phase_correction),
+    FIELD_INIT(.get_iq_gain_correction, nios_get_iq_gain_correction),
+    FIELD_INIT(.get_iq_phase_correction, nios_get_iq_phase_correction),
+
+    FIELD_INIT(.set_agc_dc_correction, nios_set_agc_dc_correction),
+
+    FIELD_INIT(.get_timestamp, nios_get_timestamp),
+
+    FIELD_INIT(.si5338_write, nios_si5338_write),
+    FIELD_INIT(.si5338_read, nios_si5338_read),
+
+    FIELD_INIT(.lms_write, nios_lms6_write),
+    FIELD_INIT(.lms_read, nios_lms6_read),
+
+    FIELD_INIT(.ina219_write, nios_ina219_write),
+    FIELD_INIT(.ina219_read, nios_ina219_read),
+
+    FIELD_INIT(.ad9361_spi_write, nios_ad9361_spi_write),
+    FIELD_INIT(.ad9361_spi_read, nios_ad9361_spi_read),
+
+    FIELD_INIT(.adi_axi_write, nios_adi_axi_write),
+    FIELD_INIT(.adi_axi_read, nios_adi_axi_read),
+
+    FIELD_INIT(.wishbone_master_write, nios_wishbone_master_write),
+    FIELD_INIT(.wishbone_master_read, nios_wishbone_master_read),
+
+    FIELD_INIT(.rfic_command_write, nios_rfic_command_write),
+    FIELD_INIT(.rfic_command_read, nios_rfic_command_read),
+
+    FIELD_INIT(.rffe_control_write, nios_rffe_control_write),
+    FIELD_INIT(.rffe_control_read, nios_rffe_control_read),
+
+    FIELD_INIT(.rffe_fastlock_save, nios_rffe_fastlock_save),
+
+    FIELD_INIT(.ad56x1_vctcxo_trim_dac_write,
+               nios_ad56x1_vctcxo_trim_dac_write),
+    FIELD_INIT(.ad56x1_vctcxo_trim_dac_read,
+               nios_ad56x1_vctcxo_trim_dac_read),
+
+    FIELD_INIT(.adf400x_write, nios_adf400x_write),
+    FIELD_INIT(.adf400x_read, nios_adf400x_read),
+
+    FIELD_INIT(.vctcxo_dac_write, nios_vctcxo_trim_dac_write),
+    FIELD_INIT(.vctcxo_dac_read, nios_vctcxo_trim_dac_read),
+
+    FIELD_INIT(.set_vctcxo_tamer_mode, nios_set_vctcxo_tamer_mode),
+    FIELD_INIT(.get_vctcxo_tamer_mode, nios_get_vctcxo_tamer_mode),
+
+    FIELD_INIT(.xb_spi, nios_xb200_synth_write),
+
+    FIELD_INIT(.set_firmware_loopback, dummy_set_firmware_loopback),
+    FIELD_INIT(.get_firmware_loopback, dummy_get_firmware_loopback),
+
+    FIELD_INIT(.enable_module, dummy_enable_module),
+
+    FIELD_INIT(.init_stream, dummy_init_stream),
+    FIELD_INIT(.stream, dummy_stream),
+    FIELD_INIT(.submit_stream_buffer, dummy_submit_stream_buffer),
+    FIELD_INIT(.deinit_stream, dummy_deinit_stream),
+
+    FIELD_INIT(.retune, nios_retune),
+    FIELD_INIT(.retune2, nios_retune2),
+
+    FIELD_INIT(.load_fw_from_bootloader, dummy_load_fw_from_bootloader),
+
+    FIELD_INIT(.read_fw_log, dummy_read_fw_log),
+
+    FIELD_INIT(.read_trigger, nios_read_trigger),
+    FIELD_INIT(.write_trigger, nios_write_trigger),
+
+    FIELD_INIT(.name, "dummy"),
+
+    FIELD_INIT(.hotplug_monitor, NULL),
+    FIELD_INIT(.is_fpga_image_loaded, NULL),
 };
+#endif
@@ -0,0 +1,535 @@
+/*
+ * NIOS II firmware-in-the-loop device layer
+ *
+ * This file is built with the NIOS II firmware's packet handlers, in its
+ * BLADERF_NIOS_PC_SIMULATION configuration, and implements the device
+ * interface from the firmware's devices.h on top of the simulated device's
+ * peripheral accessors. See nios_sim.h.
+ *
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "devices.h"
+#include "pkt_handler.h"
+#include "pkt_8x8.h"
+#include "pkt_8x16.h"
+#include "pkt_8x32.h"
+#include "pkt_8x64.h"
+#include "pkt_16x64.h"
+#include "pkt_32x32.h"
+#include "pkt_retune.h"
+#include "pkt_retune2.h"
+
+#include "nios_sim.h"
+
+static const struct pkt_handler bladerf1_handlers[] = {
+    PKT_RETUNE,
+    PKT_8x8,
+    PKT_8x16,
+    PKT_8x32,
+    PKT_8x64,
+    PKT_32x32,
+};
+
+static const struct pkt_handler bladerf2_handlers[] = {
+    PKT_RETUNE2,
+    PKT_8x8,
+    PKT_8x16,
+    PKT_8x32,
+    PKT_8x64,
+    PKT_16x64,
+    PKT_32x32,
+};
+
+/* Time tamer interrupts that have been scheduled, but have not fired */
+struct tamer_irq {
+    bool pending;
+    uint64_t timestamp;
+};
+
+static struct {
+    const struct nios_sim_ops *ops;
+    void *ctx;
+
+    const struct pkt_handler *handlers;
+    size_t num_handlers;
+    void (*retune_isr)(bladerf_module module);
+
+    struct tamer_irq irq[2];
+} sim;
+
+fastlock_profile fastlocks_rx[NUM_BBP_FASTLOCK_PROFILES];
+fastlock_profile fastlocks_tx[NUM_BBP_FASTLOCK_PROFILES];
+
+/******************************************************************************/
+/* Peripheral access */
+/******************************************************************************/
+
+static uint64_t periph_read(nios_sim_periph periph, uint32_t addr)
+{
+    uint64_t data = 0;
+
+    if (sim.ops != NULL) {
+        sim.ops->read(sim.ctx, periph, addr, &data);
+    }
+
+    return data;
+}
+
+static bool periph_write(nios_sim_periph periph, uint32_t addr, uint64_t data)
+{
+    if (sim.ops == NULL) {
+        return false;
+    }
+
+    return sim.ops->write(sim.ctx, periph, addr, data) == 0;
+}
+
+static inline size_t module_idx(bladerf_module m)
+{
+    return (m == BLADERF_MODULE_TX) ? 1 : 0;
+}
+
+uint8_t lms6_read(uint8_t addr)
+{
+    return (uint8_t)periph_read(NIOS_SIM_LMS6, addr);
+}
+
+void lms6_write(uint8_t addr, uint8_t data)
+{
+    periph_write(NIOS_SIM_LMS6, addr, data);
+}
+
+uint64_t adi_spi_read(uint16_t addr)
+{
+    return periph_read(NIOS_SIM_AD9361, addr);
+}
+
+void adi_spi_write(uint16_t addr, uint64_t data)
+{
+    periph_write(NIOS_SIM_AD9361, addr, data);
+}
+
+uint32_t adi_axi_read(uint16_t addr)
+{
+    return (uint32_t)periph_read(NIOS_SIM_ADI_AXI, addr);
+}
+
+void adi_axi_write(uint16_t addr, uint32_t data)
+{
+    periph_write(NIOS_SIM_ADI_AXI, addr, data);
+}
+
+uint32_t wishbone_master_read(uint32_t addr)
+{
+    return (uint32_t)periph_read(NIOS_SIM_WISHBONE, addr);
+}
+
+void wishbone_master_write(uint32_t addr, uint32_t data)
+{
+    periph_write(NIOS_SIM_WISHBONE, addr, data);
+}
+
+uint8_t si5338_read(uint8_t addr)
+{
+    return (uint8_t)periph_read(NIOS_SIM_SI5338, addr);
+}
+
+void si5338_write(uint8_t addr, uint8_t data)
+{
+    periph_write(NIOS_SIM_SI5338, addr, data);
+}
+
+uint16_t ina219_read(uint8_t addr)
+{
+    return (uint16_t)periph_read(NIOS_SIM_INA219, addr);
+}
+
+void ina219_write(uint8_t addr, uint16_t data)
+{
+    periph_write(NIOS_SIM_INA219, addr, data);
+}
+
+void vctcxo_trim_dac_write(uint8_t cmd, uint16_t val)
+{
+    periph_write(NIOS_SIM_VCTCXO_DAC, cmd, val);
+}
+
+void vctcxo_trim_dac_read(uint8_t cmd, uint16_t *val)
+{
+    *val = (uint16_t)periph_read(NIOS_SIM_VCTCXO_DAC, cmd);
+}
+
+void ad56x1_vctcxo_trim_dac_write(uint16_t val)
+{
+    periph_write(NIOS_SIM_AD56X1_DAC, 0, val);
+}
+
+void ad56x1_vctcxo_trim_dac_read(uint16_t *val)
+{
+    *val = (uint16_t)periph_read(NIOS_SIM_AD56X1_DAC, 0);
+}
+
+void adf400x_spi_write(uint32_t val)
+{
+    /* The two LSBs of the latch select the register */
+    periph_write(NIOS_SIM_ADF400X, val & 0x3, val);
+}
+
+uint32_t adf400x_spi_read(uint8_t addr)
+{
+    return (uint32_t)periph_read(NIOS_SIM_ADF400X, addr);
+}
+
+void adf4351_write(uint32_t val)
+{
+    periph_write(NIOS_SIM_XB_SPI, 0, val);
+}
+
+uint32_t control_reg_read(void)
+{
+    return (uint32_t)periph_read(NIOS_SIM_CONFIG_GPIO, 0);
+}
+
+void control_reg_write(uint32_t value)
+{
+    periph_write(NIOS_SIM_CONFIG_GPIO, 0, value);
+}
+
+uint32_t rffe_csr_read(void)
+{
+    return (uint32_t)periph_read(NIOS_SIM_RFFE_CSR, 0);
+}
+
+void rffe_csr_write(uint32_t value)
+{
+    periph_write(NIOS_SIM_RFFE_CSR, 0, value);
+}
+
+uint16_t iqbal_get_gain(bladerf_module m)
+{
+    return (uint16_t)periph_read(NIOS_SIM_IQ_GAIN, m);
+}
+
+void iqbal_set_gain(bladerf_module m, uint16_t value)
+{
+    periph_write(NIOS_SIM_IQ_GAIN, m, value);
+}
+
+uint16_t iqbal_get_phase(bladerf_module m)
+{
+    return (uint16_t)periph_read(NIOS_SIM_IQ_PHASE, m);
+}
+
+void iqbal_set_phase(bladerf_module m, uint16_t value)
+{
+    periph_write(NIOS_SIM_IQ_PHASE, m, value);
+}
+
+void agc_dc_corr_write(uint16_t addr, uint16_t value)
+{
+    periph_write(NIOS_SIM_AGC_DC, addr, value);
+}
+
+uint32_t expansion_port_read(void)
+{
+    return (uint32_t)periph_read(NIOS_SIM_XB_GPIO, 0);
+}
+
+void expansion_port_write(uint32_t value)
+{
+    periph_write(NIOS_SIM_XB_GPIO, 0, value);
+}
+
+uint32_t expansion_port_get_direction(void)
+{
+    return (uint32_t)periph_read(NIOS_SIM_XB_GPIO_DIR, 0);
+}
+
+void expansion_port_set_direction(uint32_t dir)
+{
+    periph_write(NIOS_SIM_XB_GPIO_DIR, 0, dir);
+}
+
+uint64_t time_tamer_read(bladerf_module m)
+{
+    return periph_read(NIOS_SIM_TIMESTAMP, m);
+}
+
+void tamer_schedule(bladerf_module m, uint64_t time)
+{
+    struct tamer_irq *irq = &sim.irq[module_idx(m)];
+
+    irq->timestamp = time;
+    irq->pending   = true;
+}
+
+void vctcxo_tamer_set_tune_mode(bladerf_vctcxo_tamer_mode mode)
+{
+    periph_write(NIOS_SIM_TAMER_MODE, 0, (uint64_t)mode);
+}
+
+bladerf_vctcxo_tamer_mode vctcxo_tamer_get_tune_mode(void)
+{
+    return (bladerf_vctcxo_tamer_mode)periph_read(NIOS_SIM_TAMER_MODE, 0);
+}
+
+void tx_trigger_ctl_write(uint8_t data)
+{
+    periph_write(NIOS_SIM_TRIGGER, BLADERF_MODULE_TX, data);
+}
+
+uint8_t tx_trigger_ctl_read(void)
+{
+    return (uint8_t)periph_read(NIOS_SIM_TRIGGER, BLADERF_MODULE_TX);
+}
+
+void rx_trigger_ctl_write(uint8_t data)
+{
+    periph_write(NIOS_SIM_TRIGGER, BLADERF_MODULE_RX, data);
+}
+
+uint8_t rx_trigger_ctl_read(void)
+{
+    return (uint8_t)periph_read(NIOS_SIM_TRIGGER, BLADERF_MODULE_RX);
+}
+
+bool rfic_command_write(uint16_t addr, uint64_t data)
+{
+    return periph_write(NIOS_SIM_RFIC, addr, data);
+}
+
+bool rfic_command_read(uint16_t addr, uint64_t *data)
+{
+    if (sim.ops == NULL) {
+        return false;
+    }
+
+    return sim.ops->read(sim.ctx, NIOS_SIM_RFIC, addr, data) == 0;
+}
+
+/******************************************************************************/
+/* AD9361 fast lock profiles */
+/******************************************************************************/
+
+/* The profile state bookkeeping follows devices.c. The simulated RFIC does not
+ * model the fast lock program registers, so the profile contents themselves
+ * are saved and recalled by the simulated device. */
+
+void adi_fastlock_save(bool is_tx, uint8_t rffe_profile, uint16_t nios_profile)
+{
+    fastlock_profile *fastlocks = is_tx ? fastlocks_tx : fastlocks_rx;
+    uint32_t i;
+
+    if (nios_profile >= NUM_BBP_FASTLOCK_PROFILES) {
+        return;
+    }
+
+    periph_write(NIOS_SIM_FASTLOCK_SAVE,
+                 ((uint32_t)is_tx << 16) | rffe_profile, nios_profile);
+
+    /* Kick out any other profile stored in the Nios that was in this slot */
+    for (i = 0; i < NUM_BBP_FASTLOCK_PROFILES; i++) {
+        if ((fastlocks[i].profile_num == rffe_profile) &&
+            (fastlocks[i].state == FASTLOCK_STATE_BBP_RFFE)) {
+            fastlocks[i].state = FASTLOCK_STATE_BBP;
+        }
+    }
+
+    fastlocks[nios_profile].state = FASTLOCK_STATE_BBP_RFFE;
+}
+
+void adi_fastlock_load(bladerf_module m, fastlock_profile *p)
+{
+    fastlock_profile *fastlocks =
+        BLADERF_CHANNEL_IS_TX(m) ? fastlocks_tx : fastlocks_rx;
+    uint32_t i;
+
+    if ((p->state == FASTLOCK_STATE_RFFE) ||
+        (p->state == FASTLOCK_STATE_BBP_RFFE)) {
+        /* Already loaded! */
+        return;
+    }
+
+    /* Kick out any other loaded profile that's in this slot */
+    for (i = 0; i < NUM_BBP_FASTLOCK_PROFILES; i++) {
+        if ((fastlocks[i].profile_num == p->profile_num) &&
+            (fastlocks[i].state == FASTLOCK_STATE_BBP_RFFE)) {
+            fastlocks[i].state = FASTLOCK_STATE_BBP;
+        }
+    }
+
+    p->state = FASTLOCK_STATE_BBP_RFFE;
+}
+
+void adi_fastlock_recall(bladerf_module m, fastlock_profile *p)
+{
+    fastlock_profile *fastlocks =
+        BLADERF_CHANNEL_IS_TX(m) ? fastlocks_tx : fastlocks_rx;
+
+    periph_write(NIOS_SIM_FASTLOCK_RECALL, m, (uint64_t)(p - fastlocks));
+}
+
+void adi_rfport_select(fastlock_profile *p)
+{
+    static const uint16_t input_sel_reg = 0x4;
+    static const uint8_t rx_port_mask   = 0x3f;
+    static const uint8_t tx_port_mask   = 0x40;
+    uint16_t addr;
+    uint64_t data;
+
+    /* Get current port selection */
+    addr = (0x0 << 15) | (0x0 << 12) | (input_sel_reg & 0x3ff);
+    data = adi_spi_read(addr) >> 56;
+
+    if (p->port >> 7) {
+        /* RX bit is set, only modify RX port selection */
+        data = (data & ~rx_port_mask) | (p->port & rx_port_mask);
+    } else {
+        /* RX bit is clear, only modify TX port selection */
+        data = (data & ~tx_port_mask) | (p->port & tx_port_mask);
+    }
+
+    /* Write the new port selection to AD9361 */
+    addr = (0x1 << 15) | (0x0 << 12) | (input_sel_reg & 0x3ff);
+    data = data << 56;
+    adi_spi_write(addr, data);
+}
+
+/* The RFFE control register layout is defined in bladerf2_common.h, which
+ * depends on host headers, so the switch update is made by the simulated
+ * device */
+void adi_rfspdt_select(bladerf_module m, fastlock_profile *p)
+{
+    periph_write(NIOS_SIM_RFFE_SPDT, m, p->spdt);
+}
+
+/******************************************************************************/
+/* Firmware main loop */
+/******************************************************************************/
+
+void nios_sim_init(const struct nios_sim_ops *ops, void *ctx, bool bladerf2)
+{
+    size_t i;
+
+    memset(&sim, 0, sizeof(sim));
+    memset(fastlocks_rx, 0, sizeof(fastlocks_rx));
+    memset(fastlocks_tx, 0, sizeof(fastlocks_tx));
+
+    sim.ops = ops;
+    sim.ctx = ctx;
+
+    if (bladerf2) {
+        sim.handlers     = bladerf2_handlers;
+        sim.num_handlers = ARRAY_SIZE(bladerf2_handlers);
+        sim.retune_isr   = pkt_retune2_isr;
+    } else {
+        sim.handlers     = bladerf1_handlers;
+        sim.num_handlers = ARRAY_SIZE(bladerf1_handlers);
+        sim.retune_isr   = pkt_retune_isr;
+    }
+
+    for (i = 0; i < sim.num_handlers; i++) {
+        if (sim.handlers[i].init != NULL) {
+            sim.handlers[i].init();
+        }
+    }
+}
+
+void nios_sim_deinit(void)
+{
+    memset(&sim, 0, sizeof(sim));
+}
+
+static void run_work(void)
+{
+    size_t i;
+
+    for (i = 0; i < sim.num_handlers; i++) {
+        if (sim.handlers[i].do_work != NULL) {
+            sim.handlers[i].do_work();
+        }
+    }
+}
+
+/* Fire the interrupts of any time tamers whose counters have reached their
+ * scheduled timestamp. Returns true if any fired. */
+static bool fire_tamer_irqs(void)
+{
+    static const bladerf_module modules[2] = { BLADERF_MODULE_RX,
+                                               BLADERF_MODULE_TX };
+    bool fired = false;
+    size_t i;
+
+    for (i = 0; i < 2; i++) {
+        struct tamer_irq *irq = &sim.irq[i];
+
+        if (irq->pending && time_tamer_read(modules[i]) >= irq->timestamp) {
+            irq->pending = false;
+            sim.retune_isr(modules[i]);
+            fired = true;
+        }
+    }
+
+    return fired;
+}
+
+void nios_sim_work(void)
+{
+    if (sim.ops == NULL) {
+        return;
+    }
+
+    /* Each pass of the work handlers advances a queued retune by one state,
+     * so keep going until no more retunes come due */
+    do {
+        run_work();
+        run_work();
+    } while (fire_tamer_irqs());
+}
+
+bool nios_sim_exec(const uint8_t *req, uint8_t *resp)
+{
+    const struct pkt_handler *handler = NULL;
+    struct pkt_buf pkt = { { 0 }, { 0 }, false };
+    size_t i;
+
+    for (i = 0; i < sim.num_handlers; i++) {
+        if (sim.handlers[i].magic == req[PKT_MAGIC_IDX]) {
+            handler = &sim.handlers[i];
+        }
+    }
+
+    if (handler == NULL) {
+        return false;
+    }
+
+    memcpy((uint8_t *)pkt.req, req, NIOS_PKT_LEN);
+
+    handler->exec(&pkt);
+    memcpy(resp, pkt.resp, NIOS_PKT_LEN);
+
+    nios_sim_work();
+
+    return true;
+}
@@ -0,0 +1,122 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef BACKEND_DUMMY_NIOS_SIM_H_
+#define BACKEND_DUMMY_NIOS_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @defgroup NIOS_SIM NIOS II firmware-in-the-loop simulation
+ *
+ * The NIOS II firmware's packet handlers (hdl/.../bladeRF_nios/src/pkt_*.c)
+ * are compiled into libbladeRF along with a device layer that replaces the
+ * FPGA's peripheral interfaces with calls back into the simulated device.
+ * Packets that the host would send over the USB peripheral endpoint are
+ * executed by the same handler code that runs on the FPGA.
+ *
+ * This file is compiled in both worlds, so it may only use plain C types.
+ *
+ * The firmware keeps its state in globals, so there is only one firmware
+ * instance per process. Callers must serialize all calls into this interface.
+ *
+ * @{
+ */
+
+/** Peripherals accessed by the firmware */
+typedef enum {
+    NIOS_SIM_LMS6,          /**< LMS6002D register (addr) */
+    NIOS_SIM_SI5338,        /**< Si5338 register (addr) */
+    NIOS_SIM_INA219,        /**< INA219 register (addr) */
+    NIOS_SIM_AD9361,        /**< AD9361 SPI command (addr = command word) */
+    NIOS_SIM_ADI_AXI,       /**< ADI AXI register (addr) */
+    NIOS_SIM_WISHBONE,      /**< Wishbone master register (addr) */
+    NIOS_SIM_CONFIG_GPIO,   /**< FPGA control register */
+    NIOS_SIM_RFFE_CSR,      /**< RF front end control register */
+    NIOS_SIM_RFFE_SPDT,     /**< RF switch selection, as stored in a fast lock
+                             *   profile (write only, addr = module) */
+    NIOS_SIM_XB_GPIO,       /**< Expansion port GPIO values */
+    NIOS_SIM_XB_GPIO_DIR,   /**< Expansion port GPIO directions */
+    NIOS_SIM_XB_SPI,        /**< ADF4351 on the XB-200 (write only) */
+    NIOS_SIM_IQ_GAIN,       /**< IQ gain correction (addr = module) */
+    NIOS_SIM_IQ_PHASE,      /**< IQ phase correction (addr = module) */
+    NIOS_SIM_AGC_DC,        /**< AGC DC correction (write only, addr) */
+    NIOS_SIM_TIMESTAMP,     /**< Time tamer counter (read only, addr = module) */
+    NIOS_SIM_VCTCXO_DAC,    /**< VCTCXO trim DAC (addr = command) */
+    NIOS_SIM_AD56X1_DAC,    /**< AD56x1 VCTCXO trim DAC */
+    NIOS_SIM_ADF400X,       /**< ADF400x register (addr; latch for writes) */
+    NIOS_SIM_TRIGGER,       /**< Trigger control register (addr = module) */
+    NIOS_SIM_TAMER_MODE,    /**< VCTCXO tamer mode */
+    NIOS_SIM_RFIC,          /**< RFIC command (addr = command address) */
+
+    /** Save the RFIC's fast lock profile (write only).
+     *  addr = (is_tx << 16) | rffe_profile, data = nios_profile */
+    NIOS_SIM_FASTLOCK_SAVE,
+
+    /** Recall a fast lock profile in the RFIC (write only).
+     *  addr = module, data = nios_profile */
+    NIOS_SIM_FASTLOCK_RECALL,
+} nios_sim_periph;
+
+/** Peripheral accesses made by the firmware. Both return 0 on success. */
+struct nios_sim_ops {
+    int (*read)(void *ctx, nios_sim_periph periph, uint32_t addr,
+                uint64_t *data);
+    int (*write)(void *ctx, nios_sim_periph periph, uint32_t addr,
+                 uint64_t data);
+};
+
+/**
+ * Reset the firmware and bind it to a simulated device
+ *
+ * @param       ops         Peripheral accessors
+ * @param       ctx         Context passed to the accessors
+ * @param       bladerf2    Run the bladeRF 2.0 Micro firmware if true, or the
+ *                          bladeRF 1 firmware if false
+ */
+void nios_sim_init(const struct nios_sim_ops *ops, void *ctx, bool bladerf2);
+
+/**
+ * Unbind the firmware from its simulated device
+ */
+void nios_sim_deinit(void);
+
+/**
+ * Execute a request packet
+ *
+ * @param       req     Request packet (NIOS_PKT_LEN bytes)
+ * @param[out]  resp    Response packet (NIOS_PKT_LEN bytes)
+ *
+ * @return true if a handler accepted the packet, false if its magic value was
+ *         not recognized (in which case the firmware does not respond)
+ */
+bool nios_sim_exec(const uint8_t *req, uint8_t *resp);
+
+/**
+ * Run the firmware's deferred work, firing any time tamer interrupts whose
+ * timestamps have passed.
+ */
+void nios_sim_work(void);
+
+/** @} (End of NIOS_SIM) */
+
+#endif
@@ -0,0 +1,1855 @@
+/*
+ * Control and stream trace recording and replay
+ *
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_config.h"
+
+#include "log.h"
+#include "rel_assert.h"
+#include "thread.h"
+
+#include "backend/backend.h"
+#include "backend/trace/trace.h"
+#include "helpers/file.h"
+#include "helpers/version.h"
+#include "helpers/wallclock.h"
+#include "streaming/async.h"
+
+#include "bladeRF.h"
+
+/*
+ * Trace file format (all values little-endian):
+ *
+ *  Header (64 bytes):
+ *      [0:7]       Magic: "BRFTRACE"
+ *      [8:11]      Format version
+ *      [12:13]     USB VID
+ *      [14:15]     USB PID
+ *      [16:48]     Serial number (NUL-terminated)
+ *      [49:63]     Reserved
+ *
+ *  Followed by records (48 bytes each):
+ *      [0]         Record type (enum trace_rec_type)
+ *      [1]         Control function (enum trace_fn), or stream direction
+ *      [2:3]       Status returned by the backend
+ *      [4:7]       Length of data immediately following this record
+ *      [8:15]      Start time, in ns, relative to the start of the trace
+ *      [16:23]     Duration, in ns
+ *      [24:39]     Arguments
+ *      [40:47]     Output value
+ */
+#define TRACE_MAGIC "BRFTRACE"
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_HEADER_SIZE 64
+#define TRACE_RECORD_SIZE 48
+
+/* Size of the OTP region returned by the get_otp backend function */
+#define TRACE_OTP_SIZE 256
+
+/* How far ahead of the replay cursor to look for a matching transaction */
+#define TRACE_MATCH_WINDOW 256
+
+enum trace_rec_type {
+    TRACE_REC_CTRL = 1,
+    TRACE_REC_STREAM_START,
+    TRACE_REC_XFER,
+    TRACE_REC_STREAM_END,
+};
+
+/* Values are stored in trace files; only append to this list */
+enum trace_fn {
+    TRACE_FN_GET_VID_PID = 1,
+    TRACE_FN_GET_FLASH_ID,
+    TRACE_FN_SET_FPGA_PROTOCOL,
+    TRACE_FN_IS_FW_READY,
+    TRACE_FN_LOAD_FPGA,
+    TRACE_FN_IS_FPGA_CONFIGURED,
+    TRACE_FN_GET_FPGA_SOURCE,
+    TRACE_FN_GET_FW_VERSION,
+    TRACE_FN_GET_FPGA_VERSION,
+    TRACE_FN_ERASE_FLASH_BLOCKS,
+    TRACE_FN_READ_FLASH_PAGES,
+    TRACE_FN_WRITE_FLASH_PAGES,
+    TRACE_FN_DEVICE_RESET,
+    TRACE_FN_JUMP_TO_BOOTLOADER,
+    TRACE_FN_GET_CAL,
+    TRACE_FN_GET_OTP,
+    TRACE_FN_WRITE_OTP,
+    TRACE_FN_LOCK_OTP,
+    TRACE_FN_GET_DEVICE_SPEED,
+    TRACE_FN_CONFIG_GPIO_WRITE,
+    TRACE_FN_CONFIG_GPIO_READ,
+    TRACE_FN_EXPANSION_GPIO_WRITE,
+    TRACE_FN_EXPANSION_GPIO_READ,
+    TRACE_FN_EXPANSION_GPIO_DIR_WRITE,
+    TRACE_FN_EXPANSION_GPIO_DIR_READ,
+    TRACE_FN_SET_IQ_GAIN_CORRECTION,
+    TRACE_FN_SET_IQ_PHASE_CORRECTION,
+    TRACE_FN_GET_IQ_GAIN_CORRECTION,
+    TRACE_FN_GET_IQ_PHASE_CORRECTION,
+    TRACE_FN_SET_AGC_DC_CORRECTION,
+    TRACE_FN_GET_TIMESTAMP,
+    TRACE_FN_SI5338_WRITE,
+    TRACE_FN_SI5338_READ,
+    TRACE_FN_LMS_WRITE,
+    TRACE_FN_LMS_READ,
+    TRACE_FN_INA219_WRITE,
+    TRACE_FN_INA219_READ,
+    TRACE_FN_AD9361_SPI_WRITE,
+    TRACE_FN_AD9361_SPI_READ,
+    TRACE_FN_ADI_AXI_WRITE,
+    TRACE_FN_ADI_AXI_READ,
+    TRACE_FN_WISHBONE_MASTER_WRITE,
+    TRACE_FN_WISHBONE_MASTER_READ,
+    TRACE_FN_RFIC_COMMAND_WRITE,
+    TRACE_FN_RFIC_COMMAND_READ,
+    TRACE_FN_RFFE_CONTROL_WRITE,
+    TRACE_FN_RFFE_CONTROL_READ,
+    TRACE_FN_RFFE_FASTLOCK_SAVE,
+    TRACE_FN_AD56X1_VCTCXO_TRIM_DAC_WRITE,
+    TRACE_FN_AD56X1_VCTCXO_TRIM_DAC_READ,
+    TRACE_FN_ADF400X_WRITE,
+    TRACE_FN_ADF400X_READ,
+    TRACE_FN_VCTCXO_DAC_WRITE,
+    TRACE_FN_VCTCXO_DAC_READ,
+    TRACE_FN_SET_VCTCXO_TAMER_MODE,
+    TRACE_FN_GET_VCTCXO_TAMER_MODE,
+    TRACE_FN_XB_SPI,
+    TRACE_FN_SET_FIRMWARE_LOOPBACK,
+    TRACE_FN_GET_FIRMWARE_LOOPBACK,
+    TRACE_FN_ENABLE_MODULE,
+    TRACE_FN_RETUNE,
+    TRACE_FN_RETUNE2,
+    TRACE_FN_READ_TRIGGER,
+    TRACE_FN_WRITE_TRIGGER,
+    TRACE_FN_IS_FPGA_IMAGE_LOADED,
+};
+
+struct trace_record {
+    uint8_t type;
+    uint8_t fn;
+    int16_t status;
+    uint32_t data_len;
+    uint64_t t_ns;
+    uint64_t duration_ns;
+    uint64_t arg[2];
+    uint64_t out;
+
+    /* Replay only: data following the record, within the trace buffer */
+    const uint8_t *data;
+};
+
+struct trace_stream {
+    struct trace *trace;
+    bladerf_stream_cb cb;
+    void *user_data;
+    bladerf_direction dir;
+
+    /* Host time at which the stream was started */
+    uint64_t start_ns;
+
+    /* Replay: trace time of the recorded stream start, and the index of the
+     * next recorded transfer. The cursor is only advanced by the stream
+     * thread. */
+    uint64_t rec_start_ns;
+    size_t cursor;
+    bool active;
+};
+
+struct trace {
+    MUTEX lock;
+    const struct backend_fns *inner;
+    bool replay;
+    uint64_t start_ns;
+
+    /* Recording */
+    FILE *file;
+    bool write_failed;
+    uint64_t num_recorded;
+
+    /* Replay */
+    uint8_t *buf;
+    struct trace_record *records;
+    size_t num_records;
+    size_t cursor;
+    double speed;
+    uint64_t num_matched;
+    uint64_t num_mismatched;
+
+    struct trace_stream streams[2];
+};
+
+extern const struct backend_fns backend_fns_trace;
+
+/******************************************************************************/
+/* Serialization */
+/******************************************************************************/
+
+static inline void put_le16(uint8_t *buf, uint16_t v)
+{
+    buf[0] = v & 0xff;
+    buf[1] = v >> 8;
+}
+
+static inline void put_le32(uint8_t *buf, uint32_t v)
+{
+    put_le16(buf, v & 0xffff);
+    put_le16(buf + 2, v >> 16);
+}
+
+static inline void put_le64(uint8_t *buf, uint64_t v)
+{
+    put_le32(buf, v & 0xffffffff);
+    put_le32(buf + 4, v >> 32);
+}
+
+static inline uint16_t get_le16(const uint8_t *buf)
+{
+    return (uint16_t)buf[0] | ((uint16_t)buf[1] << 8);
+}
+
+static inline uint32_t get_le32(const uint8_t *buf)
+{
+    return (uint32_t)get_le16(buf) | ((uint32_t)get_le16(buf + 2) << 16);
+}
+
+static inline uint64_t get_le64(const uint8_t *buf)
+{
+    return (uint64_t)get_le32(buf) | ((uint64_t)get_le32(buf + 4) << 32);
+}
+
+static void trace_pack(uint8_t *buf, const struct trace_record *r)
+{
+    buf[0] = r->type;
+    buf[1] = r->fn;
+    put_le16(&buf[2], (uint16_t)r->status);
+    put_le32(&buf[4], r->data_len);
+    put_le64(&buf[8], r->t_ns);
+    put_le64(&buf[16], r->duration_ns);
+    put_le64(&buf[24], r->arg[0]);
+    put_le64(&buf[32], r->arg[1]);
+    put_le64(&buf[40], r->out);
+}
+
+static void trace_unpack(const uint8_t *buf, struct trace_record *r)
+{
+    r->type        = buf[0];
+    r->fn          = buf[1];
+    r->status      = (int16_t)get_le16(&buf[2]);
+    r->data_len    = get_le32(&buf[4]);
+    r->t_ns        = get_le64(&buf[8]);
+    r->duration_ns = get_le64(&buf[16]);
+    r->arg[0]      = get_le64(&buf[24]);
+    r->arg[1]      = get_le64(&buf[32]);
+    r->out         = get_le64(&buf[40]);
+    r->data        = NULL;
+}
+
+static int trace_parse_header(const uint8_t *buf, size_t len,
+                              struct trace_info *info)
+{
+    if (len < TRACE_HEADER_SIZE ||
+        memcmp(buf, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0) {
+        log_error("Not a bladeRF trace file.\n");
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (get_le32(&buf[8]) != TRACE_FORMAT_VERSION) {
+        log_error("Unsupported trace format version: %u\n", get_le32(&buf[8]));
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    info->vid = get_le16(&buf[12]);
+    info->pid = get_le16(&buf[14]);
+    memcpy(info->serial, &buf[16], BLADERF_SERIAL_LENGTH);
+    info->serial[BLADERF_SERIAL_LENGTH - 1] = '\0';
+
+    return 0;
+}
+
+/******************************************************************************/
+/* Recording and replay */
+/******************************************************************************/
+
+static void trace_delay(struct trace *t, uint64_t duration_ns)
+{
+    uint64_t us;
+
+    if (t->speed <= 0.0) {
+        return;
+    }
+
+    us = (uint64_t)((double)duration_ns / t->speed / 1000.0);
+    if (us > 0) {
+        usleep((unsigned int)us);
+    }
+}
+
+/* Assumes t->lock is held */
+static void trace_write(struct trace *t,
+                        const struct trace_record *r,
+                        const void *data)
+{
+    uint8_t buf[TRACE_RECORD_SIZE];
+
+    if (t->write_failed) {
+        return;
+    }
+
+    trace_pack(buf, r);
+
+    if (fwrite(buf, sizeof(buf), 1, t->file) != 1 ||
+        (r->data_len != 0 && fwrite(data, r->data_len, 1, t->file) != 1)) {
+        log_error("Failed to write trace record. Recording stopped.\n");
+        t->write_failed = true;
+        return;
+    }
+
+    t->num_recorded++;
+}
+
+/* Assumes t->lock is held */
+static const struct trace_record *trace_find_ctrl(struct trace *t,
+                                                  enum trace_fn fn,
+                                                  uint64_t arg0)
+{
+    const size_t end = t->cursor + TRACE_MATCH_WINDOW < t->num_records
+                           ? t->cursor + TRACE_MATCH_WINDOW
+                           : t->num_records;
+    size_t i;
+
+    for (i = t->cursor; i < end; i++) {
+        const struct trace_record *r = &t->records[i];
+
+        if (r->type == TRACE_REC_CTRL && r->fn == fn && r->arg[0] == arg0) {
+            t->cursor = i + 1;
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Record or replay a control transaction
+ *
+ * When recording, the transaction's arguments, outputs, and data are written
+ * to the trace. When replaying, the outputs and data of a matching recorded
+ * transaction replace those provided by the inner backend, and the recorded
+ * duration is reproduced.
+ *
+ * @return Status to return to the caller
+ */
+static int trace_ctrl(struct bladerf *dev,
+                      enum trace_fn fn,
+                      uint64_t t0,
+                      int status,
+                      uint64_t arg0,
+                      uint64_t arg1,
+                      uint64_t *out,
+                      void *data,
+                      size_t data_len)
+{
+    struct trace *t = dev->trace;
+    const struct trace_record *match;
+    struct trace_record r;
+    uint64_t duration;
+
+    if (!t->replay) {
+        memset(&r, 0, sizeof(r));
+        r.type        = TRACE_REC_CTRL;
+        r.fn          = (uint8_t)fn;
+        r.status      = (int16_t)status;
+        r.t_ns        = t0 - t->start_ns;
+        r.duration_ns = wallclock_get_current_nsec() - t0;
+        r.arg[0]      = arg0;
+        r.arg[1]      = arg1;
+        r.out         = (out != NULL) ? *out : 0;
+        r.data_len    = (status == 0 && data != NULL) ? (uint32_t)data_len : 0;
+
+        MUTEX_LOCK(&t->lock);
+        trace_write(t, &r, data);
+        MUTEX_UNLOCK(&t->lock);
+
+        return status;
+    }
+
+    MUTEX_LOCK(&t->lock);
+
+    match = trace_find_ctrl(t, fn, arg0);
+    if (match == NULL) {
+        t->num_mismatched++;
+        MUTEX_UNLOCK(&t->lock);
+
+        log_verbose("%s: no recorded match for fn=%d arg=0x%" PRIx64 "\n",
+                    __FUNCTION__, fn, arg0);
+        return status;
+    }
+
+    t->num_matched++;
+
+    if (out != NULL) {
+        *out = match->out;
+    }
+
+    if (data != NULL && match->data != NULL) {
+        memcpy(data, match->data,
+               match->data_len < data_len ? match->data_len : data_len);
+    }
+
+    status   = match->status;
+    duration = match->duration_ns;
+
+    MUTEX_UNLOCK(&t->lock);
+
+    trace_delay(t, duration);
+
+    return status;
+}
+
+/* Convenience wrapper for transactions without data */
+static inline int trace_ctrl_simple(struct bladerf *dev,
+                                    enum trace_fn fn,
+                                    uint64_t t0,
+                                    int status,
+                                    uint64_t arg0,
+                                    uint64_t arg1,
+                                    uint64_t *out)
+{
+    return trace_ctrl(dev, fn, t0, status, arg0, arg1, out, NULL, 0);
+}
+
+static inline const struct backend_fns *inner(struct bladerf *dev)
+{
+    return dev->trace->inner;
+}
+
+static inline uint64_t trace_now(void)
+{
+    return wallclock_get_current_nsec();
+}
+
+/******************************************************************************/
+/* Backend functions */
+/******************************************************************************/
+
+static bool trace_matches(bladerf_backend backend)
+{
+    /* The trace layer is never selected directly */
+    return false;
+}
+
+static int trace_probe(backend_probe_target probe_target,
+                       struct bladerf_devinfo_list *info_list)
+{
+    return 0;
+}
+
+static int trace_open(struct bladerf *dev, struct bladerf_devinfo *info)
+{
+    return BLADERF_ERR_NODEV;
+}
+
+static int trace_get_vid_pid(struct bladerf *dev, uint16_t *vid, uint16_t *pid)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_vid_pid(dev, vid, pid);
+    out    = ((uint64_t)*vid << 16) | *pid;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_VID_PID, t0, status, 0, 0,
+                               &out);
+
+    *vid = (out >> 16) & 0xffff;
+    *pid = out & 0xffff;
+
+    return status;
+}
+
+static int trace_get_flash_id(struct bladerf *dev, uint8_t *mid, uint8_t *did)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_flash_id(dev, mid, did);
+    out    = ((uint64_t)*mid << 8) | *did;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_FLASH_ID, t0, status, 0, 0,
+                               &out);
+
+    *mid = (out >> 8) & 0xff;
+    *did = out & 0xff;
+
+    return status;
+}
+
+static int trace_set_fpga_protocol(struct bladerf *dev,
+                                   backend_fpga_protocol fpga_protocol)
+{
+    const uint64_t t0 = trace_now();
+    struct trace *t   = dev->trace;
+    int status;
+
+    status = t->inner->set_fpga_protocol(dev, fpga_protocol);
+
+    /* The USB backend switches its function table based on the protocol */
+    if (dev->backend != &backend_fns_trace) {
+        t->inner     = dev->backend;
+        dev->backend = &backend_fns_trace;
+    }
+
+    return trace_ctrl_simple(dev, TRACE_FN_SET_FPGA_PROTOCOL, t0, status,
+                             fpga_protocol, 0, NULL);
+}
+
+static void trace_close(struct bladerf *dev)
+{
+    struct trace *t = dev->trace;
+
+    t->inner->close(dev);
+
+    if (t->replay) {
+        log_debug("Trace replay: %" PRIu64 " transactions matched, %" PRIu64
+                  " not found in trace\n",
+                  t->num_matched, t->num_mismatched);
+        free(t->records);
+        free(t->buf);
+    } else {
+        log_debug("Trace recorded %" PRIu64 " records\n", t->num_recorded);
+        fclose(t->file);
+    }
+
+    MUTEX_DESTROY(&t->lock);
+    free(t);
+
+    dev->trace = NULL;
+}
+
+static int trace_is_fw_ready(struct bladerf *dev)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->is_fw_ready(dev);
+
+    return trace_ctrl_simple(dev, TRACE_FN_IS_FW_READY, t0, status, 0, 0, NULL);
+}
+
+static int trace_get_handle(struct bladerf *dev, void **handle)
+{
+    return inner(dev)->get_handle(dev, handle);
+}
+
+static int trace_load_fpga(struct bladerf *dev,
+                           const uint8_t *image,
+                           size_t image_size)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->load_fpga(dev, image, image_size);
+
+    return trace_ctrl_simple(dev, TRACE_FN_LOAD_FPGA, t0, status, image_size,
+                             0, NULL);
+}
+
+static int trace_is_fpga_configured(struct bladerf *dev)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->is_fpga_configured(dev);
+
+    return trace_ctrl_simple(dev, TRACE_FN_IS_FPGA_CONFIGURED, t0, status, 0,
+                             0, NULL);
+}
+
+static bladerf_fpga_source trace_get_fpga_source(struct bladerf *dev)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out      = inner(dev)->get_fpga_source(dev);
+
+    trace_ctrl_simple(dev, TRACE_FN_GET_FPGA_SOURCE, t0, 0, 0, 0, &out);
+
+    return (bladerf_fpga_source)out;
+}
+
+static int trace_get_version(struct bladerf *dev,
+                             enum trace_fn fn,
+                             struct bladerf_version *version)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    if (fn == TRACE_FN_GET_FW_VERSION) {
+        status = inner(dev)->get_fw_version(dev, version);
+    } else {
+        status = inner(dev)->get_fpga_version(dev, version);
+    }
+
+    out = ((uint64_t)version->major << 32) | ((uint64_t)version->minor << 16) |
+          version->patch;
+
+    status = trace_ctrl(dev, fn, t0, status, 0, 0, &out,
+                        (char *)version->describe,
+                        strlen(version->describe) + 1);
+
+    version->major = (out >> 32) & 0xffff;
+    version->minor = (out >> 16) & 0xffff;
+    version->patch = out & 0xffff;
+
+    return status;
+}
+
+static int trace_get_fw_version(struct bladerf *dev,
+                                struct bladerf_version *version)
+{
+    return trace_get_version(dev, TRACE_FN_GET_FW_VERSION, version);
+}
+
+static int trace_get_fpga_version(struct bladerf *dev,
+                                  struct bladerf_version *version)
+{
+    return trace_get_version(dev, TRACE_FN_GET_FPGA_VERSION, version);
+}
+
+static int trace_erase_flash_blocks(struct bladerf *dev,
+                                    uint32_t eb,
+                                    uint16_t count)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->erase_flash_blocks(dev, eb, count);
+
+    return trace_ctrl_simple(dev, TRACE_FN_ERASE_FLASH_BLOCKS, t0, status, eb,
+                             count, NULL);
+}
+
+static int trace_read_flash_pages(struct bladerf *dev,
+                                  uint8_t *buf,
+                                  uint32_t page,
+                                  uint32_t count)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->read_flash_pages(dev, buf, page, count);
+
+    return trace_ctrl(dev, TRACE_FN_READ_FLASH_PAGES, t0, status, page, count,
+                      NULL, buf, (size_t)count * dev->flash_arch->psize_bytes);
+}
+
+static int trace_write_flash_pages(struct bladerf *dev,
+                                   const uint8_t *buf,
+                                   uint32_t page,
+                                   uint32_t count)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->write_flash_pages(dev, buf, page, count);
+
+    return trace_ctrl_simple(dev, TRACE_FN_WRITE_FLASH_PAGES, t0, status, page,
+                             count, NULL);
+}
+
+static int trace_device_reset(struct bladerf *dev)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->device_reset(dev);
+
+    return trace_ctrl_simple(dev, TRACE_FN_DEVICE_RESET, t0, status, 0, 0,
+                             NULL);
+}
+
+static int trace_jump_to_bootloader(struct bladerf *dev)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->jump_to_bootloader(dev);
+
+    return trace_ctrl_simple(dev, TRACE_FN_JUMP_TO_BOOTLOADER, t0, status, 0,
+                             0, NULL);
+}
+
+static int trace_get_cal(struct bladerf *dev, char *cal)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->get_cal(dev, cal);
+
+    return trace_ctrl(dev, TRACE_FN_GET_CAL, t0, status, 0, 0, NULL, cal,
+                      CAL_BUFFER_SIZE);
+}
+
+static int trace_get_otp(struct bladerf *dev, char *otp)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->get_otp(dev, otp);
+
+    return trace_ctrl(dev, TRACE_FN_GET_OTP, t0, status, 0, 0, NULL, otp,
+                      TRACE_OTP_SIZE);
+}
+
+static int trace_write_otp(struct bladerf *dev, char *otp)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->write_otp(dev, otp);
+
+    return trace_ctrl_simple(dev, TRACE_FN_WRITE_OTP, t0, status, 0, 0, NULL);
+}
+
+static int trace_lock_otp(struct bladerf *dev)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->lock_otp(dev);
+
+    return trace_ctrl_simple(dev, TRACE_FN_LOCK_OTP, t0, status, 0, 0, NULL);
+}
+
+static int trace_get_device_speed(struct bladerf *dev,
+                                  bladerf_dev_speed *device_speed)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_device_speed(dev, device_speed);
+    out    = *device_speed;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_DEVICE_SPEED, t0, status, 0,
+                               0, &out);
+
+    *device_speed = (bladerf_dev_speed)out;
+
+    return status;
+}
+
+static int trace_config_gpio_write(struct bladerf *dev, uint32_t val)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->config_gpio_write(dev, val);
+
+    return trace_ctrl_simple(dev, TRACE_FN_CONFIG_GPIO_WRITE, t0, status, 0,
+                             val, NULL);
+}
+
+static int trace_config_gpio_read(struct bladerf *dev, uint32_t *val)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->config_gpio_read(dev, val);
+    out    = *val;
+    status = trace_ctrl_simple(dev, TRACE_FN_CONFIG_GPIO_READ, t0, status, 0,
+                               0, &out);
+
+    *val = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_expansion_gpio_write(struct bladerf *dev,
+                                      uint32_t mask,
+                                      uint32_t val)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->expansion_gpio_write(dev, mask, val);
+
+    return trace_ctrl_simple(dev, TRACE_FN_EXPANSION_GPIO_WRITE, t0, status,
+                             mask, val, NULL);
+}
+
+static int trace_expansion_gpio_read(struct bladerf *dev, uint32_t *val)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->expansion_gpio_read(dev, val);
+    out    = *val;
+    status = trace_ctrl_simple(dev, TRACE_FN_EXPANSION_GPIO_READ, t0, status,
+                               0, 0, &out);
+
+    *val = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_expansion_gpio_dir_write(struct bladerf *dev,
+                                          uint32_t mask,
+                                          uint32_t outputs)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->expansion_gpio_dir_write(dev, mask, outputs);
+
+    return trace_ctrl_simple(dev, TRACE_FN_EXPANSION_GPIO_DIR_WRITE, t0,
+                             status, mask, outputs, NULL);
+}
+
+static int trace_expansion_gpio_dir_read(struct bladerf *dev,
+                                         uint32_t *outputs)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->expansion_gpio_dir_read(dev, outputs);
+    out    = *outputs;
+    status = trace_ctrl_simple(dev, TRACE_FN_EXPANSION_GPIO_DIR_READ, t0,
+                               status, 0, 0, &out);
+
+    *outputs = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_set_iq_gain_correction(struct bladerf *dev,
+                                        bladerf_channel ch,
+                                        int16_t value)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->set_iq_gain_correction(dev, ch, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_SET_IQ_GAIN_CORRECTION, t0, status,
+                             ch, (uint16_t)value, NULL);
+}
+
+static int trace_set_iq_phase_correction(struct bladerf *dev,
+                                         bladerf_channel ch,
+                                         int16_t value)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->set_iq_phase_correction(dev, ch, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_SET_IQ_PHASE_CORRECTION, t0,
+                             status, ch, (uint16_t)value, NULL);
+}
+
+static int trace_get_iq_gain_correction(struct bladerf *dev,
+                                        bladerf_channel ch,
+                                        int16_t *value)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_iq_gain_correction(dev, ch, value);
+    out    = (uint16_t)*value;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_IQ_GAIN_CORRECTION, t0,
+                               status, ch, 0, &out);
+
+    *value = (int16_t)out;
+
+    return status;
+}
+
+static int trace_get_iq_phase_correction(struct bladerf *dev,
+                                         bladerf_channel ch,
+                                         int16_t *value)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_iq_phase_correction(dev, ch, value);
+    out    = (uint16_t)*value;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_IQ_PHASE_CORRECTION, t0,
+                               status, ch, 0, &out);
+
+    *value = (int16_t)out;
+
+    return status;
+}
+
+static int trace_set_agc_dc_correction(struct bladerf *dev,
+                                       int16_t q_max,
+                                       int16_t i_max,
+                                       int16_t q_mid,
+                                       int16_t i_mid,
+                                       int16_t q_low,
+                                       int16_t i_low)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t arg0, arg1;
+    int status;
+
+    status = inner(dev)->set_agc_dc_correction(dev, q_max, i_max, q_mid,
+                                               i_mid, q_low, i_low);
+
+    arg0 = ((uint64_t)(uint16_t)q_max << 48) |
+           ((uint64_t)(uint16_t)i_max << 32) |
+           ((uint64_t)(uint16_t)q_mid << 16) | (uint16_t)i_mid;
+    arg1 = ((uint64_t)(uint16_t)q_low << 16) | (uint16_t)i_low;
+
+    return trace_ctrl_simple(dev, TRACE_FN_SET_AGC_DC_CORRECTION, t0, status,
+                             arg0, arg1, NULL);
+}
+
+static int trace_get_timestamp(struct bladerf *dev,
+                               bladerf_direction dir,
+                               uint64_t *value)
+{
+    const uint64_t t0 = trace_now();
+    int status;
+
+    status = inner(dev)->get_timestamp(dev, dir, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_GET_TIMESTAMP, t0, status, dir, 0,
+                             value);
+}
+
+static int trace_si5338_write(struct bladerf *dev, uint8_t addr, uint8_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->si5338_write(dev, addr, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_SI5338_WRITE, t0, status, addr,
+                             data, NULL);
+}
+
+static int trace_si5338_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->si5338_read(dev, addr, data);
+    out    = *data;
+    status = trace_ctrl_simple(dev, TRACE_FN_SI5338_READ, t0, status, addr, 0,
+                               &out);
+
+    *data = (uint8_t)out;
+
+    return status;
+}
+
+static int trace_lms_write(struct bladerf *dev, uint8_t addr, uint8_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->lms_write(dev, addr, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_LMS_WRITE, t0, status, addr, data,
+                             NULL);
+}
+
+static int trace_lms_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->lms_read(dev, addr, data);
+    out    = *data;
+    status = trace_ctrl_simple(dev, TRACE_FN_LMS_READ, t0, status, addr, 0,
+                               &out);
+
+    *data = (uint8_t)out;
+
+    return status;
+}
+
+static int trace_ina219_write(struct bladerf *dev, uint8_t addr, uint16_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->ina219_write(dev, addr, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_INA219_WRITE, t0, status, addr,
+                             data, NULL);
+}
+
+static int trace_ina219_read(struct bladerf *dev, uint8_t addr, uint16_t *data)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->ina219_read(dev, addr, data);
+    out    = *data;
+    status = trace_ctrl_simple(dev, TRACE_FN_INA219_READ, t0, status, addr, 0,
+                               &out);
+
+    *data = (uint16_t)out;
+
+    return status;
+}
+
+static int trace_ad9361_spi_write(struct bladerf *dev,
+                                  uint16_t cmd,
+                                  uint64_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->ad9361_spi_write(dev, cmd, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_AD9361_SPI_WRITE, t0, status, cmd,
+                             data, NULL);
+}
+
+static int trace_ad9361_spi_read(struct bladerf *dev,
+                                 uint16_t cmd,
+                                 uint64_t *data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->ad9361_spi_read(dev, cmd, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_AD9361_SPI_READ, t0, status, cmd, 0,
+                             data);
+}
+
+static int trace_adi_axi_write(struct bladerf *dev,
+                               uint32_t addr,
+                               uint32_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->adi_axi_write(dev, addr, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_ADI_AXI_WRITE, t0, status, addr,
+                             data, NULL);
+}
+
+static int trace_adi_axi_read(struct bladerf *dev,
+                              uint32_t addr,
+                              uint32_t *data)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->adi_axi_read(dev, addr, data);
+    out    = *data;
+    status = trace_ctrl_simple(dev, TRACE_FN_ADI_AXI_READ, t0, status, addr, 0,
+                               &out);
+
+    *data = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_wishbone_master_write(struct bladerf *dev,
+                                       uint32_t addr,
+                                       uint32_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->wishbone_master_write(dev, addr, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_WISHBONE_MASTER_WRITE, t0, status,
+                             addr, data, NULL);
+}
+
+static int trace_wishbone_master_read(struct bladerf *dev,
+                                      uint32_t addr,
+                                      uint32_t *data)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->wishbone_master_read(dev, addr, data);
+    out    = *data;
+    status = trace_ctrl_simple(dev, TRACE_FN_WISHBONE_MASTER_READ, t0, status,
+                               addr, 0, &out);
+
+    *data = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_rfic_command_write(struct bladerf *dev,
+                                    uint16_t cmd,
+                                    uint64_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->rfic_command_write(dev, cmd, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_RFIC_COMMAND_WRITE, t0, status, cmd,
+                             data, NULL);
+}
+
+static int trace_rfic_command_read(struct bladerf *dev,
+                                   uint16_t cmd,
+                                   uint64_t *data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->rfic_command_read(dev, cmd, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_RFIC_COMMAND_READ, t0, status, cmd,
+                             0, data);
+}
+
+static int trace_rffe_control_write(struct bladerf *dev, uint32_t value)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->rffe_control_write(dev, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_RFFE_CONTROL_WRITE, t0, status, 0,
+                             value, NULL);
+}
+
+static int trace_rffe_control_read(struct bladerf *dev, uint32_t *value)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->rffe_control_read(dev, value);
+    out    = *value;
+    status = trace_ctrl_simple(dev, TRACE_FN_RFFE_CONTROL_READ, t0, status, 0,
+                               0, &out);
+
+    *value = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_rffe_fastlock_save(struct bladerf *dev,
+                                    bool is_tx,
+                                    uint8_t rffe_profile,
+                                    uint16_t nios_profile)
+{
+    const uint64_t t0 = trace_now();
+    int status;
+
+    status = inner(dev)->rffe_fastlock_save(dev, is_tx, rffe_profile,
+                                            nios_profile);
+
+    return trace_ctrl_simple(dev, TRACE_FN_RFFE_FASTLOCK_SAVE, t0, status,
+                             ((uint64_t)is_tx << 8) | rffe_profile,
+                             nios_profile, NULL);
+}
+
+static int trace_ad56x1_vctcxo_trim_dac_write(struct bladerf *dev,
+                                              uint16_t value)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->ad56x1_vctcxo_trim_dac_write(dev, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_AD56X1_VCTCXO_TRIM_DAC_WRITE, t0,
+                             status, 0, value, NULL);
+}
+
+static int trace_ad56x1_vctcxo_trim_dac_read(struct bladerf *dev,
+                                             uint16_t *value)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->ad56x1_vctcxo_trim_dac_read(dev, value);
+    out    = *value;
+    status = trace_ctrl_simple(dev, TRACE_FN_AD56X1_VCTCXO_TRIM_DAC_READ, t0,
+                               status, 0, 0, &out);
+
+    *value = (uint16_t)out;
+
+    return status;
+}
+
+static int trace_adf400x_write(struct bladerf *dev, uint8_t addr, uint32_t data)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->adf400x_write(dev, addr, data);
+
+    return trace_ctrl_simple(dev, TRACE_FN_ADF400X_WRITE, t0, status, addr,
+                             data, NULL);
+}
+
+static int trace_adf400x_read(struct bladerf *dev, uint8_t addr, uint32_t *data)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->adf400x_read(dev, addr, data);
+    out    = *data;
+    status = trace_ctrl_simple(dev, TRACE_FN_ADF400X_READ, t0, status, addr, 0,
+                               &out);
+
+    *data = (uint32_t)out;
+
+    return status;
+}
+
+static int trace_vctcxo_dac_write(struct bladerf *dev,
+                                  uint8_t addr,
+                                  uint16_t value)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->vctcxo_dac_write(dev, addr, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_VCTCXO_DAC_WRITE, t0, status, addr,
+                             value, NULL);
+}
+
+static int trace_vctcxo_dac_read(struct bladerf *dev,
+                                 uint8_t addr,
+                                 uint16_t *value)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->vctcxo_dac_read(dev, addr, value);
+    out    = *value;
+    status = trace_ctrl_simple(dev, TRACE_FN_VCTCXO_DAC_READ, t0, status, addr,
+                               0, &out);
+
+    *value = (uint16_t)out;
+
+    return status;
+}
+
+static int trace_set_vctcxo_tamer_mode(struct bladerf *dev,
+                                       bladerf_vctcxo_tamer_mode mode)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->set_vctcxo_tamer_mode(dev, mode);
+
+    return trace_ctrl_simple(dev, TRACE_FN_SET_VCTCXO_TAMER_MODE, t0, status,
+                             0, mode, NULL);
+}
+
+static int trace_get_vctcxo_tamer_mode(struct bladerf *dev,
+                                       bladerf_vctcxo_tamer_mode *mode)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_vctcxo_tamer_mode(dev, mode);
+    out    = *mode;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_VCTCXO_TAMER_MODE, t0, status,
+                               0, 0, &out);
+
+    *mode = (bladerf_vctcxo_tamer_mode)out;
+
+    return status;
+}
+
+static int trace_xb_spi(struct bladerf *dev, uint32_t value)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->xb_spi(dev, value);
+
+    return trace_ctrl_simple(dev, TRACE_FN_XB_SPI, t0, status, 0, value, NULL);
+}
+
+static int trace_set_firmware_loopback(struct bladerf *dev, bool enable)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->set_firmware_loopback(dev, enable);
+
+    return trace_ctrl_simple(dev, TRACE_FN_SET_FIRMWARE_LOOPBACK, t0, status,
+                             0, enable, NULL);
+}
+
+static int trace_get_firmware_loopback(struct bladerf *dev, bool *is_enabled)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->get_firmware_loopback(dev, is_enabled);
+    out    = *is_enabled;
+    status = trace_ctrl_simple(dev, TRACE_FN_GET_FIRMWARE_LOOPBACK, t0, status,
+                               0, 0, &out);
+
+    *is_enabled = (out != 0);
+
+    return status;
+}
+
+static int trace_enable_module(struct bladerf *dev,
+                               bladerf_direction dir,
+                               bool enable)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->enable_module(dev, dir, enable);
+
+    return trace_ctrl_simple(dev, TRACE_FN_ENABLE_MODULE, t0, status, dir,
+                             enable, NULL);
+}
+
+static int trace_init_stream(struct bladerf_stream *stream,
+                             size_t num_transfers)
+{
+    return inner(stream->dev)->init_stream(stream, num_transfers);
+}
+
+/* Assumes t->lock is held */
+static void trace_stream_find_start(struct trace *t,
+                                    struct trace_stream *ts,
+                                    bladerf_channel_layout layout)
+{
+    size_t i;
+
+    for (i = ts->cursor; i < t->num_records; i++) {
+        const struct trace_record *r = &t->records[i];
+
+        if (r->type == TRACE_REC_STREAM_START && r->fn == ts->dir) {
+            if (r->arg[0] != (uint64_t)layout) {
+                log_debug("Replayed stream layout differs from trace.\n");
+            }
+
+            ts->rec_start_ns = r->t_ns;
+            ts->cursor       = i + 1;
+            ts->active       = true;
+            return;
+        }
+    }
+
+    log_debug("No further %s streams in trace; transfers will not be paced.\n",
+              ts->dir == BLADERF_TX ? "TX" : "RX");
+    ts->active = false;
+}
+
+static void *trace_stream_cb(struct bladerf *dev,
+                             struct bladerf_stream *stream,
+                             struct bladerf_metadata *meta,
+                             void *samples,
+                             size_t num_samples,
+                             void *user_data)
+{
+    struct trace_stream *ts = user_data;
+    struct trace *t         = ts->trace;
+
+    if (samples != NULL && !t->replay) {
+        struct trace_record r;
+
+        memset(&r, 0, sizeof(r));
+        r.type   = TRACE_REC_XFER;
+        r.fn     = (uint8_t)ts->dir;
+        r.t_ns   = trace_now() - t->start_ns;
+        r.arg[0] = num_samples;
+
+        MUTEX_LOCK(&t->lock);
+        trace_write(t, &r, NULL);
+        MUTEX_UNLOCK(&t->lock);
+    }
+
+    return ts->cb(dev, stream, meta, samples, num_samples, ts->user_data);
+}
+
+static int trace_stream(struct bladerf_stream *stream,
+                        bladerf_channel_layout layout)
+{
+    struct trace *t = stream->dev->trace;
+    const bladerf_direction dir = layout & BLADERF_DIRECTION_MASK;
+    struct trace_stream *ts     = &t->streams[dir == BLADERF_TX ? 1 : 0];
+    struct trace_record r;
+    int status;
+
+    ts->trace     = t;
+    ts->dir       = dir;
+    ts->cb        = stream->cb;
+    ts->user_data = stream->user_data;
+    ts->start_ns  = trace_now();
+
+    memset(&r, 0, sizeof(r));
+    r.type   = TRACE_REC_STREAM_START;
+    r.fn     = (uint8_t)dir;
+    r.t_ns   = ts->start_ns - t->start_ns;
+    r.arg[0] = layout;
+    r.arg[1] = ((uint64_t)stream->format << 32) | stream->samples_per_buffer;
+
+    MUTEX_LOCK(&t->lock);
+    if (t->replay) {
+        trace_stream_find_start(t, ts, layout);
+    } else {
+        trace_write(t, &r, NULL);
+    }
+    MUTEX_UNLOCK(&t->lock);
+
+    stream->cb        = trace_stream_cb;
+    stream->user_data = ts;
+
+    status = t->inner->stream(stream, layout);
+
+    stream->cb        = ts->cb;
+    stream->user_data = ts->user_data;
+
+    if (!t->replay) {
+        r.type        = TRACE_REC_STREAM_END;
+        r.status      = (int16_t)status;
+        r.duration_ns = trace_now() - ts->start_ns;
+
+        MUTEX_LOCK(&t->lock);
+        trace_write(t, &r, NULL);
+        MUTEX_UNLOCK(&t->lock);
+    }
+
+    ts->active = false;
+
+    return status;
+}
+
+static int trace_submit_stream_buffer(struct bladerf_stream *stream,
+                                      void *buffer,
+                                      size_t *length,
+                                      unsigned int timeout_ms,
+                                      bool nonblock)
+{
+    return inner(stream->dev)->submit_stream_buffer(stream, buffer, length,
+                                                    timeout_ms, nonblock);
+}
+
+static void trace_deinit_stream(struct bladerf_stream *stream)
+{
+    inner(stream->dev)->deinit_stream(stream);
+}
+
+static int trace_retune(struct bladerf *dev,
+                        bladerf_channel ch,
+                        uint64_t timestamp,
+                        uint16_t nint,
+                        uint32_t nfrac,
+                        uint8_t freqsel,
+                        uint8_t vcocap,
+                        bool low_band,
+                        uint8_t xb_gpio,
+                        bool quick_tune)
+{
+    const uint64_t t0 = trace_now();
+    int status;
+
+    status = inner(dev)->retune(dev, ch, timestamp, nint, nfrac, freqsel,
+                                vcocap, low_band, xb_gpio, quick_tune);
+
+    return trace_ctrl_simple(dev, TRACE_FN_RETUNE, t0, status, ch, timestamp,
+                             NULL);
+}
+
+static int trace_retune2(struct bladerf *dev,
+                         bladerf_channel ch,
+                         uint64_t timestamp,
+                         uint16_t nios_profile,
+                         uint8_t rffe_profile,
+                         uint8_t port,
+                         uint8_t spdt)
+{
+    const uint64_t t0 = trace_now();
+    int status;
+
+    status = inner(dev)->retune2(dev, ch, timestamp, nios_profile,
+                                 rffe_profile, port, spdt);
+
+    return trace_ctrl_simple(dev, TRACE_FN_RETUNE2, t0, status, ch, timestamp,
+                             NULL);
+}
+
+static int trace_load_fw_from_bootloader(bladerf_backend backend,
+                                         uint8_t bus,
+                                         uint8_t addr,
+                                         struct fx3_firmware *fw)
+{
+    /* Devices in bootloader mode are not opened through the trace layer */
+    return BLADERF_ERR_UNSUPPORTED;
+}
+
+static int trace_read_fw_log(struct bladerf *dev, logger_entry *e)
+{
+    return inner(dev)->read_fw_log(dev, e);
+}
+
+static int trace_read_trigger(struct bladerf *dev,
+                              bladerf_channel ch,
+                              bladerf_trigger_signal trigger,
+                              uint8_t *val)
+{
+    const uint64_t t0 = trace_now();
+    uint64_t out;
+    int status;
+
+    status = inner(dev)->read_trigger(dev, ch, trigger, val);
+    out    = *val;
+    status = trace_ctrl_simple(dev, TRACE_FN_READ_TRIGGER, t0, status,
+                               ((uint64_t)(uint8_t)ch << 8) | (uint8_t)trigger,
+                               0, &out);
+
+    *val = (uint8_t)out;
+
+    return status;
+}
+
+static int trace_write_trigger(struct bladerf *dev,
+                               bladerf_channel ch,
+                               bladerf_trigger_signal trigger,
+                               uint8_t val)
+{
+    const uint64_t t0 = trace_now();
+    int status        = inner(dev)->write_trigger(dev, ch, trigger, val);
+
+    return trace_ctrl_simple(dev, TRACE_FN_WRITE_TRIGGER, t0, status,
+                             ((uint64_t)(uint8_t)ch << 8) | (uint8_t)trigger,
+                             val, NULL);
+}
+
+static int trace_is_fpga_image_loaded(struct bladerf *dev,
+                                      const uint8_t *image,
+                                      size_t image_size)
+{
+    const uint64_t t0 = trace_now();
+    int status        = BLADERF_ERR_UNSUPPORTED;
+
+    if (inner(dev)->is_fpga_image_loaded != NULL) {
+        status = inner(dev)->is_fpga_image_loaded(dev, image, image_size);
+    }
+
+    return trace_ctrl_simple(dev, TRACE_FN_IS_FPGA_IMAGE_LOADED, t0, status,
+                             image_size, 0, NULL);
+}
+
+const struct backend_fns backend_fns_trace = {
+    FIELD_INIT(.matches, trace_matches),
+
+    FIELD_INIT(.probe, trace_probe),
+
+    FIELD_INIT(.get_vid_pid, trace_get_vid_pid),
+    FIELD_INIT(.get_flash_id, trace_get_flash_id),
+    FIELD_INIT(.open, trace_open),
+    FIELD_INIT(.set_fpga_protocol, trace_set_fpga_protocol),
+    FIELD_INIT(.close, trace_close),
+
+    FIELD_INIT(.is_fw_ready, trace_is_fw_ready),
+
+    FIELD_INIT(.get_handle, trace_get_handle),
+
+    FIELD_INIT(.load_fpga, trace_load_fpga),
+    FIELD_INIT(.is_fpga_configured, trace_is_fpga_configured),
+    FIELD_INIT(.get_fpga_source, trace_get_fpga_source),
+
+    FIELD_INIT(.get_fw_version, trace_get_fw_version),
+    FIELD_INIT(.get_fpga_version, trace_get_fpga_version),
+
+    FIELD_INIT(.erase_flash_blocks, trace_erase_flash_blocks),
+    FIELD_INIT(.read_flash_pages, trace_read_flash_pages),
+    FIELD_INIT(.write_flash_pages, trace_write_flash_pages),
+
+    FIELD_INIT(.device_reset, trace_device_reset),
+    FIELD_INIT(.jump_to_bootloader, trace_jump_to_bootloader),
+
+    FIELD_INIT(.get_cal, trace_get_cal),
+    FIELD_INIT(.get_otp, trace_get_otp),
+    FIELD_INIT(.write_otp, trace_write_otp),
+    FIELD_INIT(.lock_otp, trace_lock_otp),
+    FIELD_INIT(.get_device_speed, trace_get_device_speed),
+
+    FIELD_INIT(.config_gpio_write, trace_config_gpio_write),
+    FIELD_INIT(.config_gpio_read, trace_config_gpio_read),
+
+    FIELD_INIT(.expansion_gpio_write, trace_expansion_gpio_write),
+    FIELD_INIT(.expansion_gpio_read, trace_expansion_gpio_read),
+    FIELD_INIT(.expansion_gpio_dir_write, trace_expansion_gpio_dir_write),
+    FIELD_INIT(.expansion_gpio_dir_read, trace_expansion_gpio_dir_read),
+
+    FIELD_INIT(.set_iq_gain_correction, trace_set_iq_gain_correction),
+    FIELD_INIT(.set_iq_phase_correction, trace_set_iq_phase_correction),
+    FIELD_INIT(.get_iq_gain_correction, trace_get_iq_gain_correction),
+    FIELD_INIT(.get_iq_phase_correction, trace_get_iq_phase_correction),
+
+    FIELD_INIT(.set_agc_dc_correction, trace_set_agc_dc_correction),
+
+    FIELD_INIT(.get_timestamp, trace_get_timestamp),
+
+    FIELD_INIT(.si5338_write, trace_si5338_write),
+    FIELD_INIT(.si5338_read, trace_si5338_read),
+
+    FIELD_INIT(.lms_write, trace_lms_write),
+    FIELD_INIT(.lms_read, trace_lms_read),
+
+    FIELD_INIT(.ina219_write, trace_ina219_write),
+    FIELD_INIT(.ina219_read, trace_ina219_read),
+
+    FIELD_INIT(.ad9361_spi_write, trace_ad9361_spi_write),
+    FIELD_INIT(.ad9361_spi_read, trace_ad9361_spi_read),
+
+    FIELD_INIT(.adi_axi_write, trace_adi_axi_write),
+    FIELD_INIT(.adi_axi_read, trace_adi_axi_read),
+
+    FIELD_INIT(.wishbone_master_write, trace_wishbone_master_write),
+    FIELD_INIT(.wishbone_master_read, trace_wishbone_master_read),
+
+    FIELD_INIT(.rfic_command_write, trace_rfic_command_write),
+    FIELD_INIT(.rfic_command_read, trace_rfic_command_read),
+
+    FIELD_INIT(.rffe_control_write, trace_rffe_control_write),
+    FIELD_INIT(.rffe_control_read, trace_rffe_control_read),
+
+    FIELD_INIT(.rffe_fastlock_save, trace_rffe_fastlock_save),
+
+    FIELD_INIT(.ad56x1_vctcxo_trim_dac_write,
+               trace_ad56x1_vctcxo_trim_dac_write),
+    FIELD_INIT(.ad56x1_vctcxo_trim_dac_read, trace_ad56x1_vctcxo_trim_dac_read),
+
+    FIELD_INIT(.adf400x_write, trace_adf400x_write),
+    FIELD_INIT(.adf400x_read, trace_adf400x_read),
+
+    FIELD_INIT(.vctcxo_dac_write, trace_vctcxo_dac_write),
+    FIELD_INIT(.vctcxo_dac_read, trace_vctcxo_dac_read),
+
+    FIELD_INIT(.set_vctcxo_tamer_mode, trace_set_vctcxo_tamer_mode),
+    FIELD_INIT(.get_vctcxo_tamer_mode, trace_get_vctcxo_tamer_mode),
+
+    FIELD_INIT(.xb_spi, trace_xb_spi),
+
+    FIELD_INIT(.set_firmware_loopback, trace_set_firmware_loopback),
+    FIELD_INIT(.get_firmware_loopback, trace_get_firmware_loopback),
+
+    FIELD_INIT(.enable_module, trace_enable_module),
+
+    FIELD_INIT(.init_stream, trace_init_stream),
+    FIELD_INIT(.stream, trace_stream),
+    FIELD_INIT(.submit_stream_buffer, trace_submit_stream_buffer),
+    FIELD_INIT(.deinit_stream, trace_deinit_stream),
+
+    FIELD_INIT(.retune, trace_retune),
+    FIELD_INIT(.retune2, trace_retune2),
+
+    FIELD_INIT(.load_fw_from_bootloader, trace_load_fw_from_bootloader),
+
+    FIELD_INIT(.read_fw_log, trace_read_fw_log),
+
+    FIELD_INIT(.read_trigger, trace_read_trigger),
+    FIELD_INIT(.write_trigger, trace_write_trigger),
+
+    FIELD_INIT(.name, "trace"),
+
+    FIELD_INIT(.hotplug_monitor, NULL),
+    FIELD_INIT(.is_fpga_image_loaded, trace_is_fpga_image_loaded),
+};
+
+/******************************************************************************/
+/* Attach */
+/******************************************************************************/
+
+static struct trace *trace_alloc(struct bladerf *dev)
+{
+    struct trace *t;
+
+    if (dev->trace != NULL) {
+        log_error("A trace is already attached to this device.\n");
+        return NULL;
+    }
+
+    t = calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return NULL;
+    }
+
+    MUTEX_INIT(&t->lock);
+    t->inner    = dev->backend;
+    t->start_ns = trace_now();
+
+    return t;
+}
+
+int trace_record_attach(struct bladerf *dev, const char *path)
+{
+    uint8_t header[TRACE_HEADER_SIZE];
+    struct trace *t;
+    uint16_t vid = 0, pid = 0;
+    int status;
+
+    t = trace_alloc(dev);
+    if (t == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    t->file = fopen(path, "wb");
+    if (t->file == NULL) {
+        log_error("Failed to create trace file %s\n", path);
+        status = BLADERF_ERR_IO;
+        goto error;
+    }
+
+    status = t->inner->get_vid_pid(dev, &vid, &pid);
+    if (status != 0) {
+        goto error;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, TRACE_MAGIC, strlen(TRACE_MAGIC));
+    put_le32(&header[8], TRACE_FORMAT_VERSION);
+    put_le16(&header[12], vid);
+    put_le16(&header[14], pid);
+    memcpy(&header[16], dev->ident.serial,
+           strnlen(dev->ident.serial, BLADERF_SERIAL_LENGTH - 1));
+
+    if (fwrite(header, sizeof(header), 1, t->file) != 1) {
+        status = BLADERF_ERR_IO;
+        goto error;
+    }
+
+    dev->trace   = t;
+    dev->backend = &backend_fns_trace;
+
+    log_info("Recording control and stream activity to %s\n", path);
+
+    return 0;
+
+error:
+    if (t->file != NULL) {
+        fclose(t->file);
+    }
+    MUTEX_DESTROY(&t->lock);
+    free(t);
+    return status;
+}
+
+static int trace_load(struct trace *t, const char *path)
+{
+    struct trace_info info;
+    size_t len, off, n;
+    int status;
+
+    status = file_read_buffer(path, &t->buf, &len);
+    if (status != 0) {
+        log_error("Failed to read trace file %s: %s\n", path,
+                  bladerf_strerror(status));
+        return status;
+    }
+
+    status = trace_parse_header(t->buf, len, &info);
+    if (status != 0) {
+        return status;
+    }
+
+    /* Count records so they can be indexed in a single allocation */
+    for (off = TRACE_HEADER_SIZE, n = 0; off + TRACE_RECORD_SIZE <= len; n++) {
+        off += TRACE_RECORD_SIZE + get_le32(&t->buf[off + 4]);
+    }
+
+    t->records = calloc(n, sizeof(t->records[0]));
+    if (n != 0 && t->records == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    for (off = TRACE_HEADER_SIZE; off + TRACE_RECORD_SIZE <= len;) {
+        struct trace_record *r = &t->records[t->num_records];
+
+        trace_unpack(&t->buf[off], r);
+        off += TRACE_RECORD_SIZE;
+
+        if (r->data_len > len - off) {
+            log_warning("Trace file is truncated.\n");
+            break;
+        }
+
+        if (r->data_len != 0) {
+            r->data = &t->buf[off];
+            off += r->data_len;
+        }
+
+        t->num_records++;
+    }
+
+    log_debug("Loaded %zu trace records from %s\n", t->num_records, path);
+
+    return 0;
+}
+
+int trace_replay_attach(struct bladerf *dev, const char *path, double speed)
+{
+    struct trace *t;
+    int status;
+
+    t = trace_alloc(dev);
+    if (t == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    t->replay = true;
+    t->speed  = speed;
+
+    status = trace_load(t, path);
+    if (status != 0) {
+        free(t->records);
+        free(t->buf);
+        MUTEX_DESTROY(&t->lock);
+        free(t);
+        return status;
+    }
+
+    dev->trace   = t;
+    dev->backend = &backend_fns_trace;
+
+    log_info("Replaying %s at %s\n", path,
+             speed > 0.0 ? "recorded timing" : "full speed");
+
+    return 0;
+}
+
+void trace_replay_pace_transfer(struct bladerf *dev, bladerf_direction dir)
+{
+    struct trace *t = dev->trace;
+    struct trace_stream *ts;
+    uint64_t target, now;
+    size_t i;
+
+    if (t == NULL || !t->replay || t->speed <= 0.0) {
+        return;
+    }
+
+    ts = &t->streams[dir == BLADERF_TX ? 1 : 0];
+    if (!ts->active) {
+        return;
+    }
+
+    for (i = ts->cursor; i < t->num_records; i++) {
+        const struct trace_record *r = &t->records[i];
+
+        if (r->fn != (uint8_t)dir) {
+            continue;
+        }
+
+        if (r->type == TRACE_REC_STREAM_END) {
+            /* The replayed stream outlasted the recorded one */
+            ts->active = false;
+            return;
+        }
+
+        if (r->type == TRACE_REC_XFER) {
+            ts->cursor = i + 1;
+            target     = ts->start_ns +
+                     (uint64_t)((double)(r->t_ns - ts->rec_start_ns) / t->speed);
+            now = trace_now();
+
+            if (target > now) {
+                usleep((unsigned int)((target - now) / 1000));
+            }
+            return;
+        }
+    }
+
+    ts->active = false;
+}
+
+int trace_read_info(const char *path, struct trace_info *info)
+{
+    uint8_t header[TRACE_HEADER_SIZE];
+    FILE *f;
+    size_t n;
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        log_error("Failed to open trace file %s\n", path);
+        return BLADERF_ERR_IO;
+    }
+
+    n = fread(header, 1, sizeof(header), f);
+    fclose(f);
+
+    return trace_parse_header(header, n, info);
+}
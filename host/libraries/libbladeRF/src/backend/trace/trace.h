@@ -0,0 +1,107 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef BACKEND_TRACE_H_
+#define BACKEND_TRACE_H_
+
+#include <stdint.h>
+
+#include "board/board.h"
+
+/**
+ * @defgroup BACKEND_TRACE Control and stream tracing
+ *
+ * The trace layer sits between the board code and a device's backend. When
+ * recording, every control transaction made through the backend (NIOS
+ * packets, vendor requests, flash accesses) is written to a trace file along
+ * with its result and duration, as is the completion time of every stream
+ * transfer.
+ *
+ * When replaying, the trace layer wraps the simulated (dummy) backend.
+ * Control transactions that match the trace return the recorded results after
+ * the recorded duration, and stream transfers complete with the recorded
+ * timing. Both can be scaled by a speed factor, or disabled, to replay traces
+ * from production systems deterministically on machines without hardware.
+ *
+ * Recording is enabled via the BLADERF_RECORD environment variable, and replay
+ * via BLADERF_REPLAY and BLADERF_REPLAY_SPEED.
+ *
+ * @{
+ */
+
+/** Identifying information stored in a trace's header */
+struct trace_info {
+    uint16_t vid;
+    uint16_t pid;
+    char serial[BLADERF_SERIAL_LENGTH];
+};
+
+/**
+ * Start recording the control and stream activity of an opened device
+ *
+ * On success, dev->backend is replaced with the trace layer, which forwards
+ * all calls to the original backend.
+ *
+ * @param       dev     Device handle, with its backend opened
+ * @param       path    Trace file to create
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int trace_record_attach(struct bladerf *dev, const char *path);
+
+/**
+ * Start replaying a trace on an opened device
+ *
+ * @param       dev     Device handle, with the simulated backend opened
+ * @param       path    Trace file to replay
+ * @param       speed   Timing scale factor. 1.0 reproduces the recorded
+ *                      timing, 2.0 replays twice as fast, and 0 replays
+ *                      without delays.
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int trace_replay_attach(struct bladerf *dev, const char *path, double speed);
+
+/**
+ * Wait until the next recorded transfer of a replayed stream is due
+ *
+ * The simulated backend calls this after producing or consuming each transfer,
+ * without holding any stream locks. This is a no-op when no trace is being
+ * replayed, when the speed factor is 0, or when the recorded stream has ended.
+ *
+ * @param       dev     Device handle
+ * @param       dir     Stream direction
+ */
+void trace_replay_pace_transfer(struct bladerf *dev, bladerf_direction dir);
+
+/**
+ * Read the header of a trace file
+ *
+ * @param       path    Trace file
+ * @param[out]  info    Identifying information of the recorded device
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int trace_read_info(const char *path, struct trace_info *info);
+
+/** @} (End of BACKEND_TRACE) */
+
+#endif
@@ -297,6 +297,517 @@ static bool device_is_probe_target(backend_probe_target probe_target,
     return is_probe_target;
 }
 
+/******************************************************************************/
+/* Hotplug monitoring and device list cache */
+/******************************************************************************/
+
+/* Maximum number of device arrivals that may be queued between passes of the
+ * monitor thread. Should this overflow, the cache is rebuilt from scratch. */
+#define HOTPLUG_PENDING_MAX 16
+
+struct lusb_cache_entry {
+    uint8_t bus;
+    uint8_t addr;
+    struct bladerf_devinfo info;
+
+    /* False if the device could only be partially identified (e.g., due to
+     * insufficient permissions), in which case `info` lacks its strings */
+    bool identified;
+};
+
+static struct {
+    bool initialized;            /* `lock` has been initialized */
+    bool active;                 /* Cache is populated and kept current */
+    MUTEX lock;
+
+    libusb_context *context;
+    libusb_hotplug_callback_handle cb_handle;
+    THREAD thread;
+    volatile bool run;
+    backend_hotplug_fn notify;
+
+    struct lusb_cache_entry *entries;
+    size_t num_entries;
+    size_t backing_size;
+
+    /* Devices that have arrived but have not yet been identified. Reading a
+     * device's string descriptors requires synchronous transfers, which must
+     * not be performed from within a hotplug callback. */
+    libusb_device *pending[HOTPLUG_PENDING_MAX];
+    size_t num_pending;
+    bool pending_overflow;
+} lusb_hotplug;
+
+/* Must be called with lusb_hotplug.lock held. Returns the index of the
+ * entry for the specified device, or -1 if it is not in the cache. */
+static ssize_t cache_find(uint8_t bus, uint8_t addr)
+{
+    size_t i;
+
+    for (i = 0; i < lusb_hotplug.num_entries; i++) {
+        if (lusb_hotplug.entries[i].bus == bus &&
+            lusb_hotplug.entries[i].addr == addr) {
+            return (ssize_t)i;
+        }
+    }
+
+    return -1;
+}
+
+/* Must be called with lusb_hotplug.lock held */
+static int cache_add(libusb_device *dev, const struct bladerf_devinfo *info,
+                     bool identified)
+{
+    struct lusb_cache_entry *entry;
+
+    if (lusb_hotplug.num_entries >= lusb_hotplug.backing_size) {
+        size_t new_size = lusb_hotplug.backing_size * 2;
+        struct lusb_cache_entry *tmp;
+
+        if (new_size == 0) {
+            new_size = 4;
+        }
+
+        tmp = realloc(lusb_hotplug.entries, new_size * sizeof(tmp[0]));
+        if (tmp == NULL) {
+            return BLADERF_ERR_MEM;
+        }
+
+        lusb_hotplug.entries      = tmp;
+        lusb_hotplug.backing_size = new_size;
+    }
+
+    entry = &lusb_hotplug.entries[lusb_hotplug.num_entries];
+    entry->bus  = libusb_get_bus_number(dev);
+    entry->addr = libusb_get_device_address(dev);
+    memcpy(&entry->info, info, sizeof(entry->info));
+    entry->info.instance = (unsigned int)lusb_hotplug.num_entries;
+    entry->identified    = identified;
+
+    lusb_hotplug.num_entries++;
+    return 0;
+}
+
+/* Must be called with lusb_hotplug.lock held. Returns true if an entry was
+ * removed, and copies it to `removed`. */
+static bool cache_remove(uint8_t bus, uint8_t addr,
+                         struct bladerf_devinfo *removed)
+{
+    struct lusb_cache_entry *entry;
+    ssize_t idx = cache_find(bus, addr);
+    size_t i;
+
+    if (idx < 0) {
+        return false;
+    }
+
+    i     = (size_t)idx;
+    entry = &lusb_hotplug.entries[i];
+
+    memcpy(removed, &entry->info, sizeof(removed[0]));
+    memmove(entry, entry + 1,
+            (lusb_hotplug.num_entries - i - 1) * sizeof(entry[0]));
+    lusb_hotplug.num_entries--;
+
+    /* Keep instance numbers contiguous */
+    for (; i < lusb_hotplug.num_entries; i++) {
+        lusb_hotplug.entries[i].info.instance = (unsigned int)i;
+    }
+
+    return true;
+}
+
+/* Identify a newly arrived device and add it to the cache. Called from the
+ * monitor thread, outside of libusb's hotplug callback context.
+ *
+ * A device we lack the permissions to open is still listed, as it would be by
+ * a walk of the bus, but is marked as unidentified so that lookups fall back
+ * to opening it (and reporting why that failed) rather than using the
+ * incomplete information. */
+static void hotplug_identify(libusb_device *dev)
+{
+    const uint8_t bus  = libusb_get_bus_number(dev);
+    const uint8_t addr = libusb_get_device_address(dev);
+    struct bladerf_devinfo info;
+    bool added = false;
+    bool cached;
+    int status;
+
+    if (!device_is_bladerf(dev)) {
+        return;
+    }
+
+    /* Already queued arrivals may have been picked up by a rescan */
+    MUTEX_LOCK(&lusb_hotplug.lock);
+    cached = cache_find(bus, addr) >= 0;
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    if (cached) {
+        return;
+    }
+
+    status = get_devinfo(dev, &info);
+    if (status != 0 && status != LIBUSB_ERROR_ACCESS) {
+        log_debug("Could not identify arriving device: %s\n",
+                  libusb_error_name(status));
+        return;
+    }
+
+    MUTEX_LOCK(&lusb_hotplug.lock);
+    if (cache_find(bus, addr) >= 0) {
+        MUTEX_UNLOCK(&lusb_hotplug.lock);
+        return;
+    }
+
+    status = cache_add(dev, &info, status == 0);
+    if (status == 0) {
+        info.instance = lusb_hotplug.entries[lusb_hotplug.num_entries - 1]
+                            .info.instance;
+        added = true;
+    }
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    if (!added) {
+        log_error("Could not add device to cache: %s\n",
+                  bladerf_strerror(status));
+    } else if (lusb_hotplug.notify != NULL) {
+        lusb_hotplug.notify(true, &info);
+    }
+}
+
+static bool device_in_list(libusb_device **list, ssize_t count, uint8_t bus,
+                           uint8_t addr)
+{
+    ssize_t i;
+
+    for (i = 0; i < count; i++) {
+        if (libusb_get_bus_number(list[i]) == bus &&
+            libusb_get_device_address(list[i]) == addr) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Bring the cache up to date with a full walk of the bus, reporting devices
+ * that have gone missing as departures and new devices as arrivals. Devices
+ * that are still present are left untouched. */
+static void hotplug_rescan(void)
+{
+    struct bladerf_devinfo removed;
+    libusb_device **list;
+    ssize_t count, i;
+    size_t j;
+
+    count = libusb_get_device_list(lusb_hotplug.context, &list);
+    if (count < 0) {
+        log_error("Failed to rescan USB devices: %s\n",
+                  libusb_error_name((int)count));
+        return;
+    }
+
+    MUTEX_LOCK(&lusb_hotplug.lock);
+
+    j = 0;
+    while (j < lusb_hotplug.num_entries) {
+        const struct lusb_cache_entry *entry = &lusb_hotplug.entries[j];
+
+        if (device_in_list(list, count, entry->bus, entry->addr)) {
+            j++;
+            continue;
+        }
+
+        cache_remove(entry->bus, entry->addr, &removed);
+
+        /* Notify without holding the lock, and start over afterwards, as the
+         * hotplug callback may have changed the cache in the meantime */
+        MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+        if (lusb_hotplug.notify != NULL) {
+            lusb_hotplug.notify(false, &removed);
+        }
+
+        MUTEX_LOCK(&lusb_hotplug.lock);
+        j = 0;
+    }
+
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    /* Devices already in the cache are skipped */
+    for (i = 0; i < count; i++) {
+        hotplug_identify(list[i]);
+    }
+
+    libusb_free_device_list(list, 1);
+}
+
+static void hotplug_process_pending(void)
+{
+    libusb_device *dev;
+    bool rescan;
+
+    while (true) {
+        MUTEX_LOCK(&lusb_hotplug.lock);
+
+        rescan = lusb_hotplug.pending_overflow;
+        lusb_hotplug.pending_overflow = false;
+
+        if (rescan || lusb_hotplug.num_pending == 0) {
+            dev = NULL;
+        } else {
+            dev = lusb_hotplug.pending[0];
+            lusb_hotplug.num_pending--;
+            memmove(&lusb_hotplug.pending[0], &lusb_hotplug.pending[1],
+                    lusb_hotplug.num_pending * sizeof(dev));
+        }
+
+        MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+        if (rescan) {
+            log_debug("Hotplug event queue overflowed. Rescanning.\n");
+            hotplug_rescan();
+        } else if (dev != NULL) {
+            hotplug_identify(dev);
+            libusb_unref_device(dev);
+        } else {
+            break;
+        }
+    }
+}
+
+static int LIBUSB_CALL hotplug_cb(libusb_context *context,
+                                  libusb_device *dev,
+                                  libusb_hotplug_event event,
+                                  void *user_data)
+{
+    struct bladerf_devinfo removed;
+    bool was_removed = false;
+
+    if (!device_has_bladeRF_ids(dev)) {
+        return 0;
+    }
+
+    MUTEX_LOCK(&lusb_hotplug.lock);
+
+    if (LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED == event) {
+        if (lusb_hotplug.num_pending < HOTPLUG_PENDING_MAX) {
+            lusb_hotplug.pending[lusb_hotplug.num_pending++] =
+                libusb_ref_device(dev);
+        } else {
+            lusb_hotplug.pending_overflow = true;
+        }
+    } else {
+        was_removed = cache_remove(libusb_get_bus_number(dev),
+                                   libusb_get_device_address(dev), &removed);
+    }
+
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    if (was_removed && lusb_hotplug.notify != NULL) {
+        lusb_hotplug.notify(false, &removed);
+    }
+
+    /* Remain registered */
+    return 0;
+}
+
+static void *hotplug_thread(void *arg)
+{
+    struct timeval tv = { 0, 100000 };
+
+    while (lusb_hotplug.run) {
+        libusb_handle_events_timeout_completed(lusb_hotplug.context, &tv,
+                                               NULL);
+        hotplug_process_pending();
+    }
+
+    return NULL;
+}
+
+/* Free everything the monitor holds once its thread is gone, leaving it ready
+ * to be started again */
+static void hotplug_release(void)
+{
+    size_t i;
+
+    lusb_hotplug.run = false;
+
+    for (i = 0; i < lusb_hotplug.num_pending; i++) {
+        libusb_unref_device(lusb_hotplug.pending[i]);
+    }
+
+    free(lusb_hotplug.entries);
+    lusb_hotplug.entries      = NULL;
+    lusb_hotplug.num_entries  = 0;
+    lusb_hotplug.backing_size = 0;
+    lusb_hotplug.num_pending  = 0;
+    lusb_hotplug.notify       = NULL;
+
+    libusb_exit(lusb_hotplug.context);
+    lusb_hotplug.context = NULL;
+}
+
+static void hotplug_stop(void)
+{
+    MUTEX_LOCK(&lusb_hotplug.lock);
+    lusb_hotplug.active = false;
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    lusb_hotplug.run = false;
+
+    /* Deregistering the callback also wakes up the event handler */
+    libusb_hotplug_deregister_callback(lusb_hotplug.context,
+                                       lusb_hotplug.cb_handle);
+    THREAD_JOIN(lusb_hotplug.thread, NULL);
+
+    hotplug_release();
+
+    log_debug("Stopped libusb hotplug monitor.\n");
+}
+
+static int hotplug_start(backend_hotplug_fn notify)
+{
+    int status;
+
+    if (!lusb_hotplug.initialized) {
+        MUTEX_INIT(&lusb_hotplug.lock);
+        lusb_hotplug.initialized = true;
+    }
+
+    status = libusb_init(&lusb_hotplug.context);
+    if (status != 0) {
+        log_error("Could not initialize libusb: %s\n",
+                  libusb_error_name(status));
+        return error_conv(status);
+    }
+
+    if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        log_debug("libusb does not support hotplug on this platform.\n");
+        libusb_exit(lusb_hotplug.context);
+        lusb_hotplug.context = NULL;
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    /* Cleared again by hotplug_release() if we fail from here on, so that a
+     * later attempt isn't mistaken for a running monitor */
+    lusb_hotplug.notify = notify;
+    lusb_hotplug.run    = true;
+
+    /* Devices already present are reported as arrivals, and identified by the
+     * first pass of the monitor thread. */
+    status = libusb_hotplug_register_callback(
+        lusb_hotplug.context,
+        LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+        LIBUSB_HOTPLUG_ENUMERATE, LIBUSB_HOTPLUG_MATCH_ANY,
+        LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_cb, NULL,
+        &lusb_hotplug.cb_handle);
+
+    if (status != LIBUSB_SUCCESS) {
+        log_error("Could not register hotplug callback: %s\n",
+                  libusb_error_name(status));
+        hotplug_release();
+        return error_conv(status);
+    }
+
+    /* Populate the cache before reporting it as usable */
+    hotplug_process_pending();
+
+    status = THREAD_CREATE(&lusb_hotplug.thread, hotplug_thread, NULL);
+    if (status != THREAD_SUCCESS) {
+        log_error("Could not create hotplug monitor thread.\n");
+        libusb_hotplug_deregister_callback(lusb_hotplug.context,
+                                           lusb_hotplug.cb_handle);
+        hotplug_release();
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    MUTEX_LOCK(&lusb_hotplug.lock);
+    lusb_hotplug.active = true;
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    log_debug("Started libusb hotplug monitor.\n");
+
+    return 0;
+}
+
+static int lusb_hotplug_monitor(bool enable, backend_hotplug_fn notify)
+{
+    if (enable == lusb_hotplug.run) {
+        return 0;
+    }
+
+    if (enable) {
+        return hotplug_start(notify);
+    }
+
+    hotplug_stop();
+    return 0;
+}
+
+/* Fill in `info_list` from the cache. Returns false if the cache is not
+ * active, in which case the caller must walk the bus. */
+static bool cache_probe(struct bladerf_devinfo_list *info_list, int *status)
+{
+    size_t i;
+    bool active;
+
+    if (!lusb_hotplug.initialized) {
+        return false;
+    }
+
+    MUTEX_LOCK(&lusb_hotplug.lock);
+
+    active  = lusb_hotplug.active;
+    *status = 0;
+
+    /* Walk the bus instead if any device couldn't be identified, so that it
+     * is tried again and the user is warned about permissions */
+    for (i = 0; active && i < lusb_hotplug.num_entries; i++) {
+        if (!lusb_hotplug.entries[i].identified) {
+            active = false;
+        }
+    }
+
+    for (i = 0; active && i < lusb_hotplug.num_entries && *status == 0; i++) {
+        *status = bladerf_devinfo_list_add(info_list,
+                                           &lusb_hotplug.entries[i].info);
+    }
+
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    return active;
+}
+
+/* Look up a device's information in the cache, avoiding the need to open the
+ * device to read its string descriptors. */
+static bool cache_lookup(libusb_device *dev, struct bladerf_devinfo *info)
+{
+    const uint8_t bus  = libusb_get_bus_number(dev);
+    const uint8_t addr = libusb_get_device_address(dev);
+    bool found = false;
+    ssize_t i;
+
+    if (!lusb_hotplug.initialized) {
+        return false;
+    }
+
+    MUTEX_LOCK(&lusb_hotplug.lock);
+
+    i = lusb_hotplug.active ? cache_find(bus, addr) : -1;
+
+    /* Partially identified devices must be opened again to read their serial
+     * number, and to report why that fails */
+    if (i >= 0 && lusb_hotplug.entries[i].identified) {
+        memcpy(info, &lusb_hotplug.entries[i].info, sizeof(info[0]));
+        found = true;
+    }
+
+    MUTEX_UNLOCK(&lusb_hotplug.lock);
+
+    return found;
+}
+
 static int lusb_probe(backend_probe_target probe_target,
                       struct bladerf_devinfo_list *info_list)
 {
@@ -308,6 +819,12 @@ static int lusb_probe(backend_probe_target probe_target,
 
     libusb_context *context;
 
+    /* Use the hotplug-maintained cache, if it's available */
+    if (probe_target == BACKEND_PROBE_BLADERF &&
+        cache_probe(info_list, &status)) {
+        return status;
+    }
+
     /* Initialize libusb for device tree walking */
     status = libusb_init(&context);
     if (status) {
@@ -518,8 +1035,14 @@ static int find_and_open_device(libusb_context *context,
         if (device_is_bladerf(list[i])) {
             log_verbose("Found a bladeRF (idx=%d)\n", i);
 
-            /* Open the USB device and get some information */
-            status = get_devinfo(list[i], &curr_info);
+            /* Open the USB device and get some information, unless the
+             * hotplug monitor already has it */
+            if (cache_lookup(list[i], &curr_info)) {
+                status = 0;
+            } else {
+                status = get_devinfo(list[i], &curr_info);
+            }
+
             if (status < 0) {
 
                 /* Give the user a helpful hint in case the have forgotten
@@ -1491,6 +2014,7 @@ static const struct usb_fns libusb_fns = {
     FIELD_INIT(.deinit_stream, lusb_deinit_stream),
     FIELD_INIT(.open_bootloader, lusb_open_bootloader),
     FIELD_INIT(.close_bootloader, lusb_close_bootloader),
+    FIELD_INIT(.hotplug_monitor, lusb_hotplug_monitor),
 };
 
 const struct usb_driver usb_driver_libusb = {
@@ -1146,6 +1146,7 @@ int nios_retune(struct bladerf *dev, bladerf_channel ch,
 
     uint8_t resp_flags;
     uint64_t duration;
+    uint8_t queue_fill, queue_depth;
 
     if (timestamp == NIOS_PKT_RETUNE_CLEAR_QUEUE) {
         log_verbose("Clearing %s retune queue.\n", channel2str(ch));
@@ -1165,7 +1166,11 @@ int nios_retune(struct bladerf *dev, bladerf_channel ch,
         return status;
     }
 
-    nios_pkt_retune_resp_unpack(buf, &duration, &vcocap, &resp_flags);
+    nios_pkt_retune_resp_unpack(buf, &duration, &vcocap, &resp_flags,
+                                &queue_fill, &queue_depth);
+
+    dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].fill  = queue_fill;
+    dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].depth = queue_depth;
 
     if (resp_flags & NIOS_PKT_RETUNERESP_FLAG_TSVTUNE_VALID) {
         log_verbose("%s retune operation: vcocap=%u, duration=%"PRIu64"\n",
@@ -1199,6 +1204,7 @@ int nios_retune2(struct bladerf *dev, bladerf_channel ch,
 
     uint8_t resp_flags;
     uint64_t duration;
+    uint8_t queue_fill, queue_depth;
 
     if (timestamp == NIOS_PKT_RETUNE2_CLEAR_QUEUE) {
         log_verbose("Clearing %s retune queue.\n", channel2str(ch));
@@ -1217,7 +1223,11 @@ int nios_retune2(struct bladerf *dev, bladerf_channel ch,
         return status;
     }
 
-    nios_pkt_retune2_resp_unpack(buf, &duration, &resp_flags);
+    nios_pkt_retune2_resp_unpack(buf, &duration, &resp_flags, &queue_fill,
+                                 &queue_depth);
+
+    dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].fill  = queue_fill;
+    dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].depth = queue_depth;
 
     if (resp_flags & NIOS_PKT_RETUNE2_RESP_FLAG_TSVTUNE_VALID) {
         log_verbose("%s retune operation: duration=%"PRIu64"\n",
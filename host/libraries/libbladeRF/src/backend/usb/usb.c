@@ -224,6 +224,23 @@ static int usb_probe(backend_probe_target probe_target,
     return status;
 }
 
+static int usb_hotplug_monitor(bool enable, backend_hotplug_fn notify)
+{
+    int status = BLADERF_ERR_UNSUPPORTED;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(usb_driver_list); i++) {
+        if (usb_driver_list[i]->fn->hotplug_monitor != NULL) {
+            status = usb_driver_list[i]->fn->hotplug_monitor(enable, notify);
+            if (status != 0) {
+                break;
+            }
+        }
+    }
+
+    return status;
+}
+
 static void usb_close(struct bladerf *dev)
 {
     int status;
@@ -412,7 +429,7 @@ static int usb_load_fpga(struct bladerf *dev, const uint8_t *image, size_t image
 {
     struct bladerf_usb *usb = dev->backend_data;
 
-    unsigned int wait_count;
+    unsigned int delay_us, waited_us;
     const unsigned int timeout_ms = (3 * CTRL_TIMEOUT_MS);
     int status;
 
@@ -444,18 +461,25 @@ static int usb_load_fpga(struct bladerf *dev, const uint8_t *image, size_t image
         return status;
     }
 
-    /* Poll FPGA status to determine if programming was a success */
-    wait_count = 10;
-    status = 0;
+    /* Poll FPGA status to determine if programming was a success. CONF_DONE
+     * is typically asserted shortly after the last byte has been clocked in,
+     * so start with a short poll interval and back off from there. */
+    delay_us  = 1000;
+    waited_us = 0;
+    status    = 0;
 
-    while (wait_count > 0 && status == 0) {
+    while (true) {
         status = usb_is_fpga_configured(dev);
-        if (status == 1) {
+        if (status != 0 || waited_us >= FPGA_CONFIG_TIMEOUT_US) {
             break;
         }
 
-        usleep(200000);
-        wait_count--;
+        usleep(delay_us);
+        waited_us += delay_us;
+
+        if (delay_us < 50000) {
+            delay_us *= 2;
+        }
     }
 
     /* Failed to determine if FPGA is loaded */
@@ -463,14 +487,57 @@ static int usb_load_fpga(struct bladerf *dev, const uint8_t *image, size_t image
         log_debug("Failed to determine if FPGA is loaded: %s\n",
                   bladerf_strerror(status));
         return status;
-    } else if (wait_count == 0 && status != 0) {
+    } else if (status == 0) {
         log_debug("Timeout while waiting for FPGA configuration status\n");
         return BLADERF_ERR_TIMEOUT;
     }
 
+    log_verbose("FPGA configured after %u us of polling\n", waited_us);
+
     return 0;
 }
 
+static int usb_is_fpga_image_loaded(struct bladerf *dev,
+                                    const uint8_t *image,
+                                    size_t image_size)
+{
+    struct bladerf_usb *usb = dev->backend_data;
+    struct bladeRF_fpga_checksum loaded, requested;
+    int status;
+
+    status = usb_is_fpga_configured(dev);
+    if (status != 1) {
+        return status;
+    }
+
+    /* A bitstream autoloaded from flash is not checksummed */
+    if (usb_get_fpga_source(dev) != BLADERF_FPGA_SOURCE_HOST) {
+        return 0;
+    }
+
+    status = usb->fn->control_transfer(usb->driver,
+                                       USB_TARGET_DEVICE,
+                                       USB_REQUEST_VENDOR,
+                                       USB_DIR_DEVICE_TO_HOST,
+                                       BLADE_USB_CMD_QUERY_FPGA_CHECKSUM,
+                                       0, 0,
+                                       &loaded, sizeof(loaded),
+                                       CTRL_TIMEOUT_MS);
+    if (status != 0) {
+        /* Older firmware does not support this request */
+        log_debug("Could not query FPGA checksum: %s\n",
+                  bladerf_strerror(status));
+        return 0;
+    }
+
+    memset(&requested, 0, sizeof(requested));
+    bladeRF_fpga_checksum_update(&requested, image, (uint32_t)image_size);
+
+    return LE32_TO_HOST(loaded.length) == requested.length &&
+           LE32_TO_HOST(loaded.sum1) == requested.sum1 &&
+           LE32_TO_HOST(loaded.sum2) == requested.sum2;
+}
+
 static inline int perform_erase(struct bladerf *dev, uint16_t block)
 {
     int status, erase_ret;
@@ -1311,6 +1378,9 @@ const struct backend_fns backend_fns_usb_legacy = {
     FIELD_INIT(.write_trigger, nios_legacy_write_trigger),
 
     FIELD_INIT(.name, "usb"),
+
+    FIELD_INIT(.hotplug_monitor, usb_hotplug_monitor),
+    FIELD_INIT(.is_fpga_image_loaded, usb_is_fpga_image_loaded),
 };
 
 /* USB backend for use with FPGA supporting update NIOS II packet formats */
@@ -1427,4 +1497,7 @@ const struct backend_fns backend_fns_usb = {
     FIELD_INIT(.write_trigger, nios_write_trigger),
 
     FIELD_INIT(.name, "usb"),
+
+    FIELD_INIT(.hotplug_monitor, usb_hotplug_monitor),
+    FIELD_INIT(.is_fpga_image_loaded, usb_is_fpga_image_loaded),
 };
@@ -56,6 +56,12 @@ extern bool bladerf_usb_reset_device_on_open;
 #define CTRL_TIMEOUT_MS 1000
 #endif
 
+/* Time allowed for the FPGA to report it is configured, after the bitstream
+ * has been sent */
+#ifndef FPGA_CONFIG_TIMEOUT_US
+#define FPGA_CONFIG_TIMEOUT_US 2000000
+#endif
+
 #ifndef BULK_TIMEOUT_MS
 #define BULK_TIMEOUT_MS 1000
 #endif
@@ -170,6 +176,11 @@ struct usb_fns {
 
     int (*open_bootloader)(void **driver, uint8_t bus, uint8_t addr);
     void (*close_bootloader)(void *driver);
+
+    /* Start or stop hotplug monitoring, which also maintains a cache of
+     * attached devices used by probe() and open(). May be NULL if the driver
+     * does not support this. */
+    int (*hotplug_monitor)(bool enable, backend_hotplug_fn notify);
 };
 
 struct usb_driver {
@@ -57,6 +57,7 @@
 #include "helpers/file.h"
 #include "helpers/have_cap.h"
 #include "helpers/interleave.h"
+#include "helpers/sample_convert.h"
 
 #define CHECK_NULL(...) do { \
     const void* _args[] = { __VA_ARGS__, NULL }; \
@@ -219,6 +220,7 @@ void bladerf_close(struct bladerf *dev)
         /** Free gain table entries */
         for (int i = 0; i < NUM_GAIN_CAL_TBLS; i++) {
             gain_cal_tbl_free(&dev->gain_tbls[i]);
+            gain_cal_lut_free(&dev->gain_luts[i]);
         }
 
         MUTEX_UNLOCK(&dev->lock);
@@ -972,6 +974,19 @@ int bladerf_print_quick_tune(struct bladerf *dev, const struct bladerf_quick_tun
     return 0;
 }
 
+int bladerf_release_quick_tune(struct bladerf *dev,
+                               bladerf_channel ch,
+                               const struct bladerf_quick_tune *quick_tune)
+{
+    int status;
+    MUTEX_LOCK(&dev->lock);
+
+    status = dev->board->release_quick_tune(dev, ch, quick_tune);
+
+    MUTEX_UNLOCK(&dev->lock);
+    return status;
+}
+
 int bladerf_schedule_retune(struct bladerf *dev,
                             bladerf_channel ch,
                             bladerf_timestamp timestamp,
@@ -989,6 +1004,25 @@ int bladerf_schedule_retune(struct bladerf *dev,
     return status;
 }
 
+int bladerf_get_retune_queue_status(struct bladerf *dev,
+                                    bladerf_channel ch,
+                                    unsigned int *fill,
+                                    unsigned int *depth)
+{
+    int status = 0;
+    MUTEX_LOCK(&dev->lock);
+
+    if (dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].depth == 0) {
+        status = BLADERF_ERR_UNSUPPORTED;
+    } else {
+        *fill  = dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].fill;
+        *depth = dev->retune_queue[BLADERF_CHANNEL_IS_TX(ch)].depth;
+    }
+
+    MUTEX_UNLOCK(&dev->lock);
+    return status;
+}
+
 int bladerf_cancel_scheduled_retunes(struct bladerf *dev, bladerf_channel ch)
 {
     int status;
@@ -1032,6 +1066,46 @@ int bladerf_set_correction(struct bladerf *dev,
     return status;
 }
 
+int bladerf_get_iq_correction(struct bladerf *dev,
+                              bladerf_channel ch,
+                              struct bladerf_iq_correction *corr)
+{
+    int status;
+    MUTEX_LOCK(&dev->lock);
+
+    status = dev->board->get_iq_correction(dev, ch, corr);
+
+    MUTEX_UNLOCK(&dev->lock);
+    return status;
+}
+
+int bladerf_set_iq_correction(struct bladerf *dev,
+                              bladerf_channel ch,
+                              const struct bladerf_iq_correction *corr)
+{
+    int status;
+    MUTEX_LOCK(&dev->lock);
+
+    status = dev->board->set_iq_correction(dev, ch, corr);
+
+    MUTEX_UNLOCK(&dev->lock);
+    return status;
+}
+
+int bladerf_set_iq_correction_table(struct bladerf *dev,
+                                    bladerf_channel ch,
+                                    const struct bladerf_iq_correction *entries,
+                                    unsigned int num_entries)
+{
+    int status;
+    MUTEX_LOCK(&dev->lock);
+
+    status = dev->board->set_iq_correction_table(dev, ch, entries, num_entries);
+
+    MUTEX_UNLOCK(&dev->lock);
+    return status;
+}
+
 /******************************************************************************/
 /* Trigger */
 /******************************************************************************/
@@ -1247,6 +1321,22 @@ int bladerf_sync_rx(struct bladerf *dev,
     return dev->board->sync_rx(dev, samples, num_samples, metadata, timeout_ms);
 }
 
+int bladerf_sync_set_rx_decimation(struct bladerf *dev,
+                                   unsigned int factor,
+                                   const float *taps,
+                                   unsigned int num_taps,
+                                   double shift)
+{
+    int status;
+    MUTEX_LOCK(&dev->lock);
+
+    status = dev->board->sync_set_rx_decimation(dev, factor, taps, num_taps,
+                                                shift);
+
+    MUTEX_UNLOCK(&dev->lock);
+    return status;
+}
+
 int bladerf_get_timestamp(struct bladerf *dev,
                           bladerf_direction dir,
                           bladerf_timestamp *timestamp)
@@ -1276,6 +1366,40 @@ int bladerf_deinterleave_stream_buffer(bladerf_channel_layout layout,
     return _interleave_deinterleave_buf(layout, format, buffer_size, samples);
 }
 
+int bladerf_convert_samples(bladerf_sample_type in_type,
+                            const void *in,
+                            bladerf_sample_type out_type,
+                            void *out,
+                            size_t num_samples)
+{
+    return sample_convert(in_type, in, out_type, out, num_samples);
+}
+
+int bladerf_byteswap_samples(bladerf_sample_type type,
+                             void *samples,
+                             size_t num_samples)
+{
+    return sample_byteswap(type, samples, num_samples);
+}
+
+int bladerf_get_sample_stats(bladerf_sample_type type,
+                             const void *samples,
+                             size_t num_samples,
+                             struct bladerf_sample_stats *stats)
+{
+    return sample_stats(type, samples, num_samples, stats);
+}
+
+int bladerf_set_sample_kernels(const char *name)
+{
+    return sample_kernels_select(name);
+}
+
+const char *bladerf_get_sample_kernels(void)
+{
+    return sample_kernels_name();
+}
+
 /******************************************************************************/
 /* FPGA/Firmware Loading/Flashing */
 /******************************************************************************/
@@ -1292,6 +1416,14 @@ int bladerf_load_fpga(struct bladerf *dev, const char *fpga_file)
         goto exit;
     }
 
+    if (BLADERF_FPGA_LOAD_IF_CHANGED == dev->fpga_load_mode &&
+        NULL != dev->backend->is_fpga_image_loaded &&
+        1 == dev->backend->is_fpga_image_loaded(dev, buf, buf_size)) {
+        log_info("FPGA bitstream is already loaded. Skipping.\n");
+        status = 0;
+        goto exit;
+    }
+
     status = dev->board->load_fpga(dev, buf, buf_size);
 
 exit:
@@ -1299,6 +1431,40 @@ exit:
     return status;
 }
 
+int bladerf_set_fpga_load_mode(struct bladerf *dev,
+                               bladerf_fpga_load_mode mode)
+{
+    CHECK_NULL(dev);
+
+    switch (mode) {
+        case BLADERF_FPGA_LOAD_ALWAYS:
+        case BLADERF_FPGA_LOAD_IF_CHANGED:
+            break;
+
+        default:
+            log_debug("Invalid FPGA load mode: %d\n", mode);
+            return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dev->lock);
+    dev->fpga_load_mode = mode;
+    MUTEX_UNLOCK(&dev->lock);
+
+    return 0;
+}
+
+int bladerf_get_fpga_load_mode(struct bladerf *dev,
+                               bladerf_fpga_load_mode *mode)
+{
+    CHECK_NULL(dev, mode);
+
+    MUTEX_LOCK(&dev->lock);
+    *mode = dev->fpga_load_mode;
+    MUTEX_UNLOCK(&dev->lock);
+
+    return 0;
+}
+
 int bladerf_flash_fpga(struct bladerf *dev, const char *fpga_file)
 {
     uint8_t *buf = NULL;
@@ -1319,6 +1485,38 @@ exit:
     return status;
 }
 
+int bladerf_set_flash_mode(struct bladerf *dev, bladerf_flash_mode mode)
+{
+    CHECK_NULL(dev);
+
+    switch (mode) {
+        case BLADERF_FLASH_MODE_FULL:
+        case BLADERF_FLASH_MODE_DIFF:
+            break;
+
+        default:
+            log_debug("Invalid flash mode: %d\n", mode);
+            return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dev->lock);
+    dev->flash_mode = mode;
+    MUTEX_UNLOCK(&dev->lock);
+
+    return 0;
+}
+
+int bladerf_get_flash_mode(struct bladerf *dev, bladerf_flash_mode *mode)
+{
+    CHECK_NULL(dev, mode);
+
+    MUTEX_LOCK(&dev->lock);
+    *mode = dev->flash_mode;
+    MUTEX_UNLOCK(&dev->lock);
+
+    return 0;
+}
+
 int bladerf_erase_stored_fpga(struct bladerf *dev)
 {
     int status;
@@ -1890,6 +2088,13 @@ void bladerf_set_usb_reset_on_open(bool enabled)
 #endif
 }
 
+void bladerf_set_warm_open(bool enabled)
+{
+    bladerf_warm_open_enabled = enabled;
+
+    log_verbose("Warm open %s\n", enabled ? "enabled" : "disabled");
+}
+
 /******************************************************************************/
 /* Expansion board APIs */
 /******************************************************************************/
@@ -2392,7 +2597,7 @@ int bladerf_get_gain_target(struct bladerf *dev, bladerf_channel ch, int *gain_t
     MUTEX_LOCK(&dev->lock);
     bladerf_frequency current_frequency;
     struct bladerf_gain_cal_tbl *cal_table = &dev->gain_tbls[ch];
-    struct bladerf_gain_cal_entry current_entry;
+    double gain_corr;
     bladerf_gain current_gain;
     bladerf_gain_mode gain_mode;
 
@@ -2417,10 +2622,76 @@ int bladerf_get_gain_target(struct bladerf *dev, bladerf_channel ch, int *gain_t
 
     CHECK_STATUS(dev->board->get_gain(dev, ch, &current_gain));
     CHECK_STATUS(dev->board->get_frequency(dev, ch, &current_frequency));
-    CHECK_STATUS(get_gain_cal_entry(cal_table, current_frequency, &current_entry));
-    *gain_target = current_gain + current_entry.gain_corr;
+    CHECK_STATUS(gain_cal_lut_lookup(&dev->gain_luts[ch], current_frequency, &gain_corr));
+    *gain_target = current_gain + gain_corr;
 
 error:
     MUTEX_UNLOCK(&dev->lock);
     return status;
 }
+
+int bladerf_convert_gain_calibration(const char *csv_path, const char *binary_path)
+{
+    if (csv_path == NULL || binary_path == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    return gain_cal_csv_to_bin_file(csv_path, binary_path);
+}
+
+int bladerf_convert_gain_calibrations(const char *const *csv_paths,
+                                      const char *const *binary_paths,
+                                      unsigned int num_files,
+                                      unsigned int num_threads,
+                                      int *statuses)
+{
+    char **derived_paths = NULL;
+    unsigned int i;
+    int status;
+
+    if (csv_paths == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (num_files == 0) {
+        return 0;
+    }
+
+    if (binary_paths == NULL) {
+        derived_paths = calloc(num_files, sizeof(derived_paths[0]));
+        if (derived_paths == NULL) {
+            return BLADERF_ERR_MEM;
+        }
+
+        for (i = 0; i < num_files; i++) {
+            const size_t len = strlen(csv_paths[i]);
+            const char *ext = strrchr(csv_paths[i], '.');
+            const size_t base_len =
+                (ext != NULL && strcmp(ext, ".csv") == 0) ? (size_t)(ext - csv_paths[i]) : len;
+
+            derived_paths[i] = malloc(base_len + sizeof(".tbl"));
+            if (derived_paths[i] == NULL) {
+                status = BLADERF_ERR_MEM;
+                goto out;
+            }
+
+            memcpy(derived_paths[i], csv_paths[i], base_len);
+            strcpy(&derived_paths[i][base_len], ".tbl");
+        }
+
+        binary_paths = (const char *const *)derived_paths;
+    }
+
+    status = gain_cal_csv_to_bin_batch(csv_paths, binary_paths, num_files,
+                                       num_threads, statuses);
+
+out:
+    if (derived_paths != NULL) {
+        for (i = 0; i < num_files; i++) {
+            free(derived_paths[i]);
+        }
+        free(derived_paths);
+    }
+
+    return status;
+}
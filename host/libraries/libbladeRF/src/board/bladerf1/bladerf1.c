@@ -34,6 +34,7 @@
 #include "compatibility.h"
 #include "capabilities.h"
 #include "calibration.h"
+#include "tuning_cache.h"
 #include "flash.h"
 
 #include "driver/smb_clock.h"
@@ -54,6 +55,7 @@
 
 #include "streaming/async.h"
 #include "streaming/sync.h"
+#include "streaming/iq_corr.h"
 
 #include "devinfo.h"
 #include "helpers/version.h"
@@ -89,9 +91,16 @@ struct bladerf1_board_data {
     struct calibrations {
         struct dc_cal_tbl *dc_rx;
         struct dc_cal_tbl *dc_tx;
+
+        /* Software correction of sync stream samples */
+        struct iq_corr *iq_rx;
+        struct iq_corr *iq_tx;
     } cal;
     uint16_t dac_trim;
 
+    /* VCOCAP values found by host-based tuning, keyed by frequency */
+    struct tuning_cache tuning_cache;
+
     /* Board properties */
     bladerf_fpga_size fpga_size;
     /* Data message size */
@@ -371,6 +380,49 @@ static const struct bladerf_lms_port_name_map bladerf1_tx_port_map[] = {
 /* Low-level Initialization */
 /******************************************************************************/
 
+/* Load the device's tuning cache. BLADERF_TUNING_CACHE may name the directory
+ * the cache is kept in; otherwise, the bladeRF config directories are searched
+ * and the cache is only persisted if a file already exists there. */
+static void tuning_cache_open(struct bladerf *dev)
+{
+    struct bladerf1_board_data *board_data = dev->board_data;
+    char filename[FILENAME_MAX];
+    char path[FILENAME_MAX];
+    char *full_path = NULL;
+    const char *dir;
+    int status;
+
+    tuning_cache_init(&board_data->tuning_cache);
+
+    snprintf(filename, sizeof(filename), "%s_tuning.cache", dev->ident.serial);
+
+    dir = getenv("BLADERF_TUNING_CACHE");
+    if (dir != NULL && dir[0] != '\0') {
+        status = snprintf(path, sizeof(path), "%s/%s", dir, filename);
+        if (status < 0 || (size_t)status >= sizeof(path)) {
+            log_warning("Tuning cache path is too long; not using it.\n");
+            return;
+        }
+    } else {
+        full_path = file_find(filename);
+        if (full_path == NULL) {
+            return;
+        }
+
+        strncpy(path, full_path, sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+        free(full_path);
+    }
+
+    log_debug("Loading tuning cache %s\n", path);
+    status = tuning_cache_load(&board_data->tuning_cache, path,
+                               dev->ident.serial);
+    if (status != 0) {
+        log_warning("Failed to load tuning cache %s: %s\n", path,
+                    bladerf_strerror(status));
+    }
+}
+
 static bladerf_tuning_mode tuning_get_default_mode(struct bladerf *dev)
 {
     struct bladerf1_board_data *board_data = dev->board_data;
@@ -849,6 +901,19 @@ static int bladerf1_open(struct bladerf *dev, struct bladerf_devinfo *devinfo)
     board_data->module_format[BLADERF_RX] = -1;
     board_data->module_format[BLADERF_TX] = -1;
 
+    status = iq_corr_create(&board_data->cal.iq_rx);
+    if (status != 0) {
+        return status;
+    }
+
+    status = iq_corr_create(&board_data->cal.iq_tx);
+    if (status != 0) {
+        return status;
+    }
+
+    board_data->sync[BLADERF_RX].iq_corr = board_data->cal.iq_rx;
+    board_data->sync[BLADERF_TX].iq_corr = board_data->cal.iq_tx;
+
     dev->flash_arch->status          = STATUS_FLASH_UNINITIALIZED;
     dev->flash_arch->manufacturer_id = 0x0;
     dev->flash_arch->device_id       = 0x0;
@@ -1069,6 +1134,27 @@ static int bladerf1_open(struct bladerf *dev, struct bladerf_devinfo *devinfo)
     free(full_path);
     full_path = NULL;
 
+    /* IQ correction tables take effect at the next retune */
+    snprintf(filename, sizeof(filename), "%s_iq_rx.tbl", dev->ident.serial);
+    full_path = file_find(filename);
+    if (full_path != NULL) {
+        log_debug("Loading RX IQ correction image %s\n", full_path);
+        iq_corr_tbl_image_load(dev, board_data->cal.iq_rx, full_path);
+    }
+    free(full_path);
+    full_path = NULL;
+
+    snprintf(filename, sizeof(filename), "%s_iq_tx.tbl", dev->ident.serial);
+    full_path = file_find(filename);
+    if (full_path != NULL) {
+        log_debug("Loading TX IQ correction image %s\n", full_path);
+        iq_corr_tbl_image_load(dev, board_data->cal.iq_tx, full_path);
+    }
+    free(full_path);
+    full_path = NULL;
+
+    tuning_cache_open(dev);
+
     status = dev->backend->is_fpga_configured(dev);
     if (status < 0) {
         return status;
@@ -1081,9 +1167,9 @@ static int bladerf1_open(struct bladerf *dev, struct bladerf_devinfo *devinfo)
     } else if (status != 1) {
         /* Try searching for an FPGA in the config search path */
         if (board_data->fpga_size == BLADERF_FPGA_40KLE) {
-            full_path = file_find("hostedx40.rbf");
+            full_path = file_find_image("hostedx40.rbf");
         } else if (board_data->fpga_size == BLADERF_FPGA_115KLE) {
-            full_path = file_find("hostedx115.rbf");
+            full_path = file_find_image("hostedx115.rbf");
         } else {
             log_error("Invalid FPGA size %d.\n", board_data->fpga_size);
             return BLADERF_ERR_UNEXPECTED;
@@ -1196,6 +1282,17 @@ static void bladerf1_close(struct bladerf *dev)
         dc_cal_tbl_free(&board_data->cal.dc_rx);
         dc_cal_tbl_free(&board_data->cal.dc_tx);
 
+        iq_corr_free(board_data->cal.iq_rx);
+        iq_corr_free(board_data->cal.iq_tx);
+
+        status = tuning_cache_save(&board_data->tuning_cache,
+                                   dev->ident.serial);
+        if (status != 0) {
+            log_warning("Failed to save tuning cache: %s\n",
+                        bladerf_strerror(status));
+        }
+        tuning_cache_free(&board_data->tuning_cache);
+
         free(board_data);
         board_data = NULL;
     }
@@ -2040,6 +2137,54 @@ static int bladerf1_get_bandwidth_range(struct bladerf *dev,
 /* Frequency */
 /******************************************************************************/
 
+/* Tune an LMS6002D PLL from the host. The VCOCAP search is skipped if the
+ * frequency has been tuned before, and its result is cached otherwise. A
+ * cached value that no longer locks the VCO (e.g., after a temperature
+ * change) is replaced by the result of a fresh search. */
+static int tune_with_cache(struct bladerf *dev,
+                           bladerf_channel ch,
+                           uint32_t frequency)
+{
+    struct bladerf1_board_data *board_data = dev->board_data;
+    struct tuning_cache *cache             = &board_data->tuning_cache;
+    struct lms_freq f;
+    bool cached;
+    int status;
+
+    status = lms_calculate_tuning_params(frequency, &f);
+    if (status != 0) {
+        return status;
+    }
+
+    cached = tuning_cache_lookup(cache, ch, frequency, &f.vcocap);
+    if (cached) {
+        log_verbose("Using cached VCOCAP=%u for %u Hz\n", f.vcocap, frequency);
+        f.flags |= LMS_FREQ_FLAGS_FORCE_VCOCAP;
+    }
+
+    status = lms_set_precalculated_frequency(dev, ch, &f);
+    if (status == 0 && cached) {
+        status = lms_verify_vcocap(dev, ch, &f.vcocap_result);
+    }
+
+    if (status != 0) {
+        if (cached) {
+            tuning_cache_remove(cache, ch, frequency);
+        }
+        return status;
+    }
+
+    if (!cached || f.vcocap_result != f.vcocap) {
+        status = tuning_cache_insert(cache, ch, frequency, f.vcocap_result);
+        if (status != 0) {
+            log_debug("Failed to cache VCOCAP for %u Hz: %s\n", frequency,
+                      bladerf_strerror(status));
+        }
+    }
+
+    return 0;
+}
+
 static int bladerf1_set_frequency(struct bladerf *dev,
                                   bladerf_channel ch,
                                   bladerf_frequency frequency)
@@ -2052,6 +2197,9 @@ static int bladerf1_set_frequency(struct bladerf *dev,
     const struct dc_cal_tbl *dc_cal = (ch == BLADERF_CHANNEL_RX(0))
                                           ? board_data->cal.dc_rx
                                           : board_data->cal.dc_tx;
+    struct iq_corr *iq_corr = (ch == BLADERF_CHANNEL_RX(0))
+                                  ? board_data->cal.iq_rx
+                                  : board_data->cal.iq_tx;
 
     CHECK_BOARD_STATE(STATE_FPGA_LOADED);
 
@@ -2081,7 +2229,7 @@ static int bladerf1_set_frequency(struct bladerf *dev,
 
     switch (board_data->tuning_mode) {
         case BLADERF_TUNING_MODE_HOST:
-            status = lms_set_frequency(dev, ch, (uint32_t)frequency);
+            status = tune_with_cache(dev, ch, (uint32_t)frequency);
             if (status != 0) {
                 return status;
             }
@@ -2139,6 +2287,8 @@ static int bladerf1_set_frequency(struct bladerf *dev,
                     (ch == BLADERF_CHANNEL_RX(0)) ? "RX" : "TX", dc_i, dc_q);
     }
 
+    iq_corr_retune(iq_corr, frequency);
+
     return 0;
 }
 
@@ -2393,6 +2543,15 @@ static int bladerf1_get_quick_tune(struct bladerf *dev,
     return lms_get_quick_tune(dev, ch, quick_tune);
 }
 
+static int bladerf1_release_quick_tune(
+    struct bladerf *dev,
+    bladerf_channel ch,
+    const struct bladerf_quick_tune *quick_tune)
+{
+    /* bladeRF1 quick tune parameters do not occupy any device resources */
+    return 0;
+}
+
 static int bladerf1_schedule_retune(struct bladerf *dev,
                                     bladerf_channel ch,
                                     bladerf_timestamp timestamp,
@@ -2425,6 +2584,13 @@ static int bladerf1_schedule_retune(struct bladerf *dev,
         if (status != 0) {
             return status;
         }
+
+        /* Let the FPGA skip its VCOCAP search if we've already found the
+         * value for this frequency */
+        if (tuning_cache_lookup(&board_data->tuning_cache, ch,
+                                (uint32_t)frequency, &f.vcocap)) {
+            f.flags |= LMS_FREQ_FLAGS_FORCE_VCOCAP;
+        }
     } else {
         f.freqsel       = quick_tune->freqsel;
         f.vcocap        = quick_tune->vcocap;
@@ -2544,6 +2710,97 @@ static int bladerf1_set_correction(struct bladerf *dev, bladerf_channel ch,
     return status;
 }
 
+static struct iq_corr *get_iq_corr(struct bladerf *dev, bladerf_channel ch)
+{
+    struct bladerf1_board_data *board_data = dev->board_data;
+
+    switch (ch) {
+        case BLADERF_CHANNEL_RX(0):
+            return board_data->cal.iq_rx;
+        case BLADERF_CHANNEL_TX(0):
+            return board_data->cal.iq_tx;
+        default:
+            return NULL;
+    }
+}
+
+static int bladerf1_get_iq_correction(struct bladerf *dev,
+                                      bladerf_channel ch,
+                                      struct bladerf_iq_correction *corr)
+{
+    struct iq_corr *iq_corr = get_iq_corr(dev, ch);
+
+    CHECK_BOARD_STATE(STATE_INITIALIZED);
+
+    if (iq_corr == NULL || corr == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    iq_corr_get(iq_corr, corr);
+
+    return 0;
+}
+
+static int bladerf1_set_iq_correction(struct bladerf *dev,
+                                      bladerf_channel ch,
+                                      const struct bladerf_iq_correction *corr)
+{
+    struct iq_corr *iq_corr = get_iq_corr(dev, ch);
+    int status;
+
+    CHECK_BOARD_STATE(STATE_INITIALIZED);
+
+    if (iq_corr == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    /* Fixed parameters replace any table */
+    status = iq_corr_set(iq_corr, corr);
+    if (status == 0) {
+        status = iq_corr_set_table(iq_corr, NULL, 0);
+    }
+
+    return status;
+}
+
+static int bladerf1_set_iq_correction_table(
+    struct bladerf *dev,
+    bladerf_channel ch,
+    const struct bladerf_iq_correction *entries,
+    unsigned int num_entries)
+{
+    struct iq_corr *iq_corr = get_iq_corr(dev, ch);
+    struct lms_freq f;
+    int status;
+
+    CHECK_BOARD_STATE(STATE_INITIALIZED);
+
+    if (iq_corr == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    status = iq_corr_set_table(iq_corr, entries, num_entries);
+    if (status != 0) {
+        return status;
+    }
+
+    if (entries == NULL) {
+        return iq_corr_set(iq_corr, NULL);
+    }
+
+    /* Apply the table at the current frequency, until the next retune. Like
+     * the DC calibration tables, it is indexed by the LMS frequency, ahead of
+     * any XB-200 mixer. */
+    status = lms_get_frequency(dev, ch, &f);
+    if (status != 0) {
+        return status;
+    }
+
+    iq_corr_retune(iq_corr, lms_frequency_to_hz(&f));
+
+    return 0;
+}
+
 /******************************************************************************/
 /* Trigger */
 /******************************************************************************/
@@ -2888,6 +3145,22 @@ static int bladerf1_sync_rx(struct bladerf *dev,
     return status;
 }
 
+static int bladerf1_sync_set_rx_decimation(struct bladerf *dev,
+                                           unsigned int factor,
+                                           const float *taps,
+                                           unsigned int num_taps,
+                                           double shift)
+{
+    struct bladerf1_board_data *board_data = dev->board_data;
+
+    if (!board_data->sync[BLADERF_RX].initialized) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    return sync_set_rx_decimation(&board_data->sync[BLADERF_RX], factor, taps,
+                                  num_taps, shift);
+}
+
 static int bladerf1_get_timestamp(struct bladerf *dev,
                                   bladerf_direction dir,
                                   bladerf_timestamp *value)
@@ -3589,10 +3862,14 @@ const struct board_fns bladerf1_board_fns = {
     FIELD_INIT(.get_rf_port, bladerf1_get_rf_port),
     FIELD_INIT(.get_rf_ports, bladerf1_get_rf_ports),
     FIELD_INIT(.get_quick_tune, bladerf1_get_quick_tune),
+    FIELD_INIT(.release_quick_tune, bladerf1_release_quick_tune),
     FIELD_INIT(.schedule_retune, bladerf1_schedule_retune),
     FIELD_INIT(.cancel_scheduled_retunes, bladerf1_cancel_scheduled_retunes),
     FIELD_INIT(.get_correction, bladerf1_get_correction),
     FIELD_INIT(.set_correction, bladerf1_set_correction),
+    FIELD_INIT(.get_iq_correction, bladerf1_get_iq_correction),
+    FIELD_INIT(.set_iq_correction, bladerf1_set_iq_correction),
+    FIELD_INIT(.set_iq_correction_table, bladerf1_set_iq_correction_table),
     FIELD_INIT(.trigger_init, bladerf1_trigger_init),
     FIELD_INIT(.trigger_arm, bladerf1_trigger_arm),
     FIELD_INIT(.trigger_fire, bladerf1_trigger_fire),
@@ -3607,6 +3884,7 @@ const struct board_fns bladerf1_board_fns = {
     FIELD_INIT(.sync_config, bladerf1_sync_config),
     FIELD_INIT(.sync_tx, bladerf1_sync_tx),
     FIELD_INIT(.sync_rx, bladerf1_sync_rx),
+    FIELD_INIT(.sync_set_rx_decimation, bladerf1_sync_set_rx_decimation),
     FIELD_INIT(.get_timestamp, bladerf1_get_timestamp),
     FIELD_INIT(.load_fpga, bladerf1_load_fpga),
     FIELD_INIT(.flash_fpga, bladerf1_flash_fpga),
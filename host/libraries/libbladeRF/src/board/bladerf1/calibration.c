@@ -47,12 +47,13 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-#include <float.h>
+#include <math.h>
 
 #include "host_config.h"
 #include "minmax.h"
 
 #include "calibration.h"
+#include "streaming/iq_corr.h"
 
 #ifdef TEST_DC_CAL_TABLE
 #   include <stdio.h>
@@ -142,6 +143,153 @@ unsigned int dc_cal_tbl_lookup(const struct dc_cal_tbl *tbl, unsigned int freq)
     return find_entry(tbl, tbl->curr_idx, 0, tbl->n_entries - 1, freq, &limit);
 }
 
+/* Interpolate a y value given two points and a desired x value
+ *
+ * y = interp( (x0, y0), (x1, y1), x )
+ *
+ * Returns y, rounded to the nearest integer
+ */
+static inline int16_t interp(unsigned int x0, int16_t y0,
+                             unsigned int x1, int16_t y1,
+                             unsigned int x)
+{
+    const double num = (double) y1 - y0;
+    const double den = (double) x1 - x0;
+    const double m = den == 0 ? 0 : num / den;
+    const double y = ((double) x - x0) * m + y0;
+
+    return (int16_t) lrint(y);
+}
+
+static inline void dc_cal_interp_entry(const struct dc_cal_tbl *tbl,
+                                       unsigned int idx_low,
+                                       unsigned int idx_high,
+                                       unsigned int freq,
+                                       struct dc_cal_entry *entry)
+{
+    const unsigned int f_low = tbl->entries[idx_low].freq;
+    const unsigned int f_high = tbl->entries[idx_high].freq;
+
+#define ENTRY_VAR(x)                                                        \
+    entry->x    = interp(f_low, tbl->entries[idx_low].x,                    \
+                         f_high, tbl->entries[idx_high].x,                  \
+                         freq)
+
+    entry->freq = freq;
+
+    ENTRY_VAR(dc_i);
+    ENTRY_VAR(dc_q);
+
+    ENTRY_VAR(max_dc_i);
+    ENTRY_VAR(max_dc_q);
+    ENTRY_VAR(mid_dc_i);
+    ENTRY_VAR(mid_dc_q);
+    ENTRY_VAR(min_dc_i);
+    ENTRY_VAR(min_dc_q);
+
+#undef ENTRY_VAR
+}
+
+/* Interpolate between the precomputed values either side of a frequency */
+static inline void dc_cal_interp_dense(const struct dc_cal_tbl *tbl,
+                                       unsigned int idx,
+                                       unsigned int freq,
+                                       struct dc_cal_entry *entry)
+{
+    const struct dc_cal_entry *low  = &tbl->dense[idx];
+    const struct dc_cal_entry *high = &tbl->dense[idx + 1];
+
+#define ENTRY_VAR(x)                                                        \
+    entry->x = interp(low->freq, low->x, high->freq, high->x, freq)
+
+    ENTRY_VAR(dc_i);
+    ENTRY_VAR(dc_q);
+
+    ENTRY_VAR(max_dc_i);
+    ENTRY_VAR(max_dc_q);
+    ENTRY_VAR(mid_dc_i);
+    ENTRY_VAR(mid_dc_q);
+    ENTRY_VAR(min_dc_i);
+    ENTRY_VAR(min_dc_q);
+
+#undef ENTRY_VAR
+}
+
+/* Largest spacing that places every entry on the precomputed grid */
+static unsigned int dc_cal_tbl_dense_step(const struct dc_cal_tbl *tbl)
+{
+    unsigned int step = 0;
+    unsigned int i;
+
+    for (i = 1; i < tbl->n_entries; i++) {
+        unsigned int a = tbl->entries[i].freq - tbl->entries[0].freq;
+        unsigned int b = step;
+
+        while (b != 0) {
+            const unsigned int t = a % b;
+            a = b;
+            b = t;
+        }
+
+        step = a;
+    }
+
+    return step;
+}
+
+/* Precompute the entries at evenly spaced frequencies. The spacing divides
+ * that of every pair of entries, so each entry is reproduced exactly and
+ * frequencies between two entries are interpolated from them in one pass.
+ *
+ * If this would take more than DC_CAL_TBL_DENSE_MAX values, or on allocation
+ * failure, lookups fall back to searching the entries. A coarser grid would
+ * skip over entries and lose resolution. */
+static void dc_cal_tbl_densify(struct dc_cal_tbl *tbl)
+{
+    const unsigned int f_first = tbl->entries[0].freq;
+    const unsigned int f_last  = tbl->entries[tbl->n_entries - 1].freq;
+    unsigned int step = dc_cal_tbl_dense_step(tbl);
+    unsigned int i, idx = 0;
+
+    if (step == 0) {
+        /* A single entry */
+        step = 1;
+    } else if ((f_last - f_first) / step >= DC_CAL_TBL_DENSE_MAX) {
+        log_debug("DC cal table entries are too irregularly spaced to "
+                  "precompute; searching them instead\n");
+        return;
+    }
+
+    tbl->dense = malloc(sizeof(tbl->dense[0]) *
+                        ((f_last - f_first) / step + 1));
+    if (tbl->dense == NULL) {
+        return;
+    }
+
+    tbl->dense_start = f_first;
+    tbl->dense_step  = step;
+    tbl->n_dense     = (f_last - f_first) / step + 1;
+
+    for (i = 0; i < tbl->n_dense; i++) {
+        const unsigned int freq = f_first + i * step;
+
+        /* Advance to the entries surrounding this frequency */
+        while (idx + 1 < tbl->n_entries - 1 &&
+               tbl->entries[idx + 1].freq <= freq) {
+            idx++;
+        }
+
+        if (tbl->n_entries == 1 || tbl->entries[idx].freq == freq) {
+            tbl->dense[i] = tbl->entries[idx];
+        } else if (tbl->entries[idx + 1].freq == freq) {
+            /* Only the last entry, which idx stops short of */
+            tbl->dense[i] = tbl->entries[idx + 1];
+        } else {
+            dc_cal_interp_entry(tbl, idx, idx + 1, freq, &tbl->dense[i]);
+        }
+    }
+}
+
 struct dc_cal_tbl * dc_cal_tbl_load(const uint8_t *buf, size_t buf_len)
 {
     struct dc_cal_tbl *ret;
@@ -159,7 +307,7 @@ struct dc_cal_tbl * dc_cal_tbl_load(const uint8_t *buf, size_t buf_len)
     }
     buf += sizeof(magic);
 
-    ret = malloc(sizeof(ret[0]));
+    ret = calloc(1, sizeof(ret[0]));
     if (ret == NULL) {
         return NULL;
     }
@@ -181,7 +329,13 @@ struct dc_cal_tbl * dc_cal_tbl_load(const uint8_t *buf, size_t buf_len)
         return NULL;
     }
 
-    ret->entries = malloc(sizeof(ret->entries[0]) * ret->n_entries);
+    if (ret->n_entries == 0) {
+        free(ret);
+        return NULL;
+    }
+
+    /* Zeroed, as version 1 tables do not provide the AGC values */
+    ret->entries = calloc(ret->n_entries, sizeof(ret->entries[0]));
     if (ret->entries == NULL) {
         free(ret);
         return NULL;
@@ -239,8 +393,16 @@ struct dc_cal_tbl * dc_cal_tbl_load(const uint8_t *buf, size_t buf_len)
             ret->entries[i].min_dc_i = LE32_TO_HOST(ret->entries[i].min_dc_i);
             ret->entries[i].min_dc_q = LE32_TO_HOST(ret->entries[i].min_dc_q);
         }
+
+        if (i > 0 && ret->entries[i].freq <= ret->entries[i - 1].freq) {
+            log_debug("DC cal table entries are not in order\n");
+            dc_cal_tbl_free(&ret);
+            return NULL;
+        }
     }
 
+    dc_cal_tbl_densify(ret);
+
     return ret;
 }
 
@@ -273,58 +435,63 @@ int dc_cal_tbl_image_load(struct bladerf *dev,
     return status;
 }
 
-/* Interpolate a y value given two points and a desired x value
- *
- * y = interp( (x0, y0), (x1, y1), x )
- *
- * Returns
- */
-static inline unsigned int interp(unsigned int x0, unsigned int y0,
-                           unsigned int x1, unsigned int y1,
-                           unsigned int x)
+int iq_corr_tbl_image_load(struct bladerf *dev,
+                           struct iq_corr *corr, const char *img_file)
 {
-    const float num = (float) y1 - y0;
-    const float den = (float) x1 - x0;
-    const float m = den == 0 ? FLT_MAX : num / den;
-    const float y = (x - x0) * m + y0;
+    int status;
+    struct bladerf_image *img;
 
-    return (unsigned int) y;
-}
+    img = bladerf_alloc_image(dev, BLADERF_IMAGE_TYPE_INVALID, 0, 0);
+    if (img == NULL) {
+        return BLADERF_ERR_MEM;
+    }
 
-static inline void dc_cal_interp_entry(const struct dc_cal_tbl *tbl,
-                                       unsigned int idx_low,
-                                       unsigned int idx_high,
-                                       unsigned int freq,
-                                       struct dc_cal_entry *entry)
-{
-    const unsigned int f_low = tbl->entries[idx_low].freq;
-    const unsigned int f_high = tbl->entries[idx_high].freq;
+    status = bladerf_image_read(img, img_file);
+    if (status != 0) {
+        bladerf_free_image(img);
+        return status;
+    }
 
-#define ENTRY_VAR(x)                                                        \
-    entry->x    = (int16_t) interp(f_low, tbl->entries[idx_low].x,          \
-                             f_high, tbl->entries[idx_low].x,               \
-                             freq)
+    if (img->type == BLADERF_IMAGE_TYPE_RX_IQ_CAL ||
+            img->type == BLADERF_IMAGE_TYPE_TX_IQ_CAL) {
+        status = iq_corr_load_table(corr, img->data, img->length);
+    } else {
+        status = BLADERF_ERR_INVAL;
+    }
 
-    ENTRY_VAR(dc_i);
-    ENTRY_VAR(dc_q);
+    bladerf_free_image(img);
 
-    ENTRY_VAR(max_dc_i);
-    ENTRY_VAR(max_dc_q);
-    ENTRY_VAR(mid_dc_i);
-    ENTRY_VAR(mid_dc_q);
-    ENTRY_VAR(min_dc_i);
-    ENTRY_VAR(min_dc_q);
+    return status;
 }
 
 void dc_cal_tbl_entry(const struct dc_cal_tbl *tbl, unsigned int freq,
                       struct dc_cal_entry *entry)
 {
-    const unsigned int idx = dc_cal_tbl_lookup(tbl, freq);
+    unsigned int idx;
+
+    if (tbl->dense != NULL) {
+        const struct dc_cal_entry *last = &tbl->dense[tbl->n_dense - 1];
+
+        if (freq <= tbl->dense_start) {
+            *entry = tbl->dense[0];
+        } else if (freq >= last->freq) {
+            *entry = *last;
+        } else {
+            /* Below the last point, so this and the next point exist */
+            idx = (freq - tbl->dense_start) / tbl->dense_step;
+            dc_cal_interp_dense(tbl, idx, freq, entry);
+        }
+
+        entry->freq = freq;
+        return;
+    }
+
+    idx = dc_cal_tbl_lookup(tbl, freq);
 
-    if (tbl->entries[idx].freq == freq) {
+    if (tbl->entries[idx].freq == freq || tbl->n_entries == 1 ||
+        (idx == 0 && freq < tbl->entries[0].freq) ||
+        idx == (tbl->n_entries - 1)) {
         memcpy(entry, &tbl->entries[idx], sizeof(struct dc_cal_entry));
-    } else if (idx == (tbl->n_entries - 1)) {
-        dc_cal_interp_entry(tbl, idx - 1, idx, freq, entry);
     } else {
         dc_cal_interp_entry(tbl, idx, idx + 1, freq, entry);
     }
@@ -334,6 +501,7 @@ void dc_cal_tbl_free(struct dc_cal_tbl **tbl)
 {
     if (*tbl != NULL) {
         free((*tbl)->entries);
+        free((*tbl)->dense);
         free(*tbl);
         *tbl = NULL;
     }
@@ -26,6 +26,8 @@
 
 #include <libbladeRF.h>
 
+struct iq_corr;
+
 struct dc_cal_entry {
     unsigned int freq; /* Frequency (Hz) associated with this entry */
     int16_t dc_i;
@@ -46,10 +48,24 @@ struct dc_cal_tbl {
 
     unsigned int curr_idx;
     struct dc_cal_entry *entries; /* Sorted (increasing) by freq */
+
+    /* The entries interpolated at every dense_step Hz from dense_start to
+     * the last entry, for constant-time lookups. Every entry lies on this
+     * grid. NULL if the grid would be too large or could not be allocated,
+     * in which case the entries are searched. */
+    struct dc_cal_entry *dense;
+    unsigned int n_dense;
+    unsigned int dense_start;
+    unsigned int dense_step;
 };
 
 extern struct dc_cal_tbl rx_cal_test;
 
+/* Limit on the number of precomputed DC calibration values. The values are
+ * spaced at the greatest common divisor of the entries' spacings, so this
+ * covers the full bladeRF 1 tuning range calibrated every 250 kHz. */
+#define DC_CAL_TBL_DENSE_MAX 16384
+
 /**
  * Get the index of an (approximate) match from the specific dc cal table
  *
@@ -63,7 +79,11 @@ unsigned int dc_cal_tbl_lookup(const struct dc_cal_tbl *tbl, unsigned int freq);
 /**
  * Get the DC cal values associated with the specified frequencies. If the
  * specified frequency is not in the table, the DC calibration values will
- * be interpolated from surrounding entries.
+ * be interpolated from surrounding entries. Frequencies outside of the table
+ * use the values of the first or last entry.
+ *
+ * For tables from dc_cal_tbl_load(), this interpolates between the two
+ * nearest precomputed values in constant time.
  *
  * @param[in]   tbl      Table to search
  * @param[in]   freq     Desired frequency
@@ -95,6 +115,18 @@ struct dc_cal_tbl *dc_cal_tbl_load(const uint8_t *buf, size_t buf_len);
 int dc_cal_tbl_image_load(struct bladerf *dev,
                           struct dc_cal_tbl **tbl, const char *img_file);
 
+/**
+ * Load a frequency-indexed IQ correction table from an image file
+ *
+ * @param[in]   dev         bladeRF device handle
+ * @param       corr        Correction stage to load the table into
+ * @param[in]   img_file    Path to image file
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int iq_corr_tbl_image_load(struct bladerf *dev,
+                           struct iq_corr *corr, const char *img_file);
+
 /**
  * Free a DC calibration table
  *
@@ -15,6 +15,49 @@
 
 #define OTP_BUFFER_SIZE 256
 
+/**
+ * Differentially update a flash region, given an optional header and data
+ * placed at `data_offset`. The in-memory region image is laid out exactly as a
+ * full erase and program would leave flash, with unused space set to 0xff.
+ */
+static int write_region_diff(struct bladerf *dev,
+                             uint32_t eb,
+                             uint32_t eb_count,
+                             const uint8_t *hdr,
+                             size_t hdr_len,
+                             size_t data_offset,
+                             const uint8_t *data,
+                             size_t len)
+{
+    const size_t region_len = (size_t)eb_count * dev->flash_arch->ebsize_bytes;
+    uint8_t *region;
+    int status;
+
+    if (hdr_len > data_offset || data_offset + len > region_len) {
+        log_debug("Image (%zu bytes) does not fit in flash region (%zu bytes)\n",
+                  data_offset + len, region_len);
+        return BLADERF_ERR_INVAL;
+    }
+
+    region = malloc(region_len);
+    if (region == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    memset(region, 0xff, region_len);
+
+    if (hdr != NULL) {
+        memcpy(region, hdr, hdr_len);
+    }
+
+    memcpy(region + data_offset, data, len);
+
+    status = spi_flash_write_diff(dev, region, eb, eb_count);
+
+    free(region);
+    return status;
+}
+
 int spi_flash_write_fx3_fw(struct bladerf *dev, const uint8_t *image, size_t len)
 {
     int status;
@@ -43,6 +86,11 @@ int spi_flash_write_fx3_fw(struct bladerf *dev, const uint8_t *image, size_t len
         return BLADERF_ERR_INVAL;
     }
 
+    if (dev->flash_mode == BLADERF_FLASH_MODE_DIFF) {
+        return write_region_diff(dev, flash_eb_fw, flash_eb_len_fw, NULL, 0, 0,
+                                 image, len);
+    }
+
     padded_image_len = (uint32_t) len + padding_len;
 
     readback_buf = malloc(padded_image_len);
@@ -173,6 +221,12 @@ int spi_flash_write_fpga_bitstream(struct bladerf *dev,
     /* Fill in metadata with the *actual* FPGA bitstream length */
     fill_fpga_metadata_page(dev, metadata, len);
 
+    if (dev->flash_mode == BLADERF_FLASH_MODE_DIFF) {
+        return write_region_diff(dev, flash_eb_fpga, flash_eb_len_fpga,
+                                 metadata, METADATA_LEN, page_size, bitstream,
+                                 len);
+    }
+
     readback_buf = malloc(padded_bitstream_len);
     if (readback_buf == NULL) {
         return BLADERF_ERR_MEM;
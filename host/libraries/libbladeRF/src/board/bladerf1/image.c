@@ -40,6 +40,7 @@
 #include "helpers/file.h"
 
 #include "flash.h"
+#include "image.h"
 
 /* These two are used interchangeably - ensure they're the same! */
 #if SHA256_DIGEST_SIZE != BLADERF_IMAGE_CHECKSUM_LEN
@@ -96,34 +97,31 @@ static void sha256_buffer(const char *buf, size_t len,
     SHA256_Final((uint8_t*)digest, &ctx);
 }
 
-static int verify_checksum(uint8_t *buf, size_t buf_len)
+static int verify_checksum(const uint8_t *buf, size_t buf_len)
 {
-    char checksum_expected[SHA256_DIGEST_SIZE];
+    static const uint8_t zeros[SHA256_DIGEST_SIZE] = { 0 };
     char checksum_calc[SHA256_DIGEST_SIZE];
+    SHA256_CTX ctx;
 
     if (buf_len <= CALC_IMAGE_SIZE(0)) {
         log_debug("Provided buffer isn't a full image\n");
         return BLADERF_ERR_INVAL;
     }
 
-    /* Backup and clear the expected checksum before we calculate the
-     * expected checksum */
-    memcpy(checksum_expected, &buf[BLADERF_IMAGE_MAGIC_LEN],
-           sizeof(checksum_expected));
-
-    memset(&buf[BLADERF_IMAGE_MAGIC_LEN], 0, SHA256_DIGEST_SIZE);
-
-    sha256_buffer((const char *)buf, buf_len, checksum_calc);
-
-    if (memcmp(checksum_expected, checksum_calc, SHA256_DIGEST_SIZE) != 0) {
+    /* The checksum is calculated with its own field cleared */
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, buf, BLADERF_IMAGE_MAGIC_LEN);
+    SHA256_Update(&ctx, zeros, sizeof(zeros));
+    SHA256_Update(&ctx, &buf[BLADERF_IMAGE_MAGIC_LEN + SHA256_DIGEST_SIZE],
+                  buf_len - BLADERF_IMAGE_MAGIC_LEN - SHA256_DIGEST_SIZE);
+    SHA256_Final((uint8_t*)checksum_calc, &ctx);
+
+    if (memcmp(&buf[BLADERF_IMAGE_MAGIC_LEN], checksum_calc,
+               SHA256_DIGEST_SIZE) != 0) {
         return BLADERF_ERR_CHECKSUM;
-    } else {
-        /* Restore the buffer's checksum so the caller can still use it */
-        memcpy(&buf[BLADERF_IMAGE_MAGIC_LEN], checksum_expected,
-               sizeof(checksum_expected));
-
-        return 0;
     }
+
+    return 0;
 }
 
 static bool image_type_is_valid(bladerf_image_type type) {
@@ -206,8 +204,10 @@ static size_t pack_image(struct bladerf_image *img, uint8_t *buf)
     return i;
 }
 
-/* Unpack flash image from file and validate fields */
-static int unpack_image(struct bladerf_image *img, uint8_t *buf, size_t len)
+/* Unpack and validate an image's metadata. On success, the image's data
+ * begins at buf[*data_offset]. */
+static int unpack_metadata(struct bladerf_image *img, const uint8_t *buf,
+                           size_t len, size_t *data_offset)
 {
     size_t i = 0;
     uint32_t type;
@@ -274,8 +274,23 @@ static int unpack_image(struct bladerf_image *img, uint8_t *buf, size_t len)
         return BLADERF_ERR_INVAL;
     }
 
+    *data_offset = i;
+    return 0;
+}
+
+/* Unpack flash image from file and validate fields */
+static int unpack_image(struct bladerf_image *img, uint8_t *buf, size_t len)
+{
+    size_t offset;
+    int status;
+
+    status = unpack_metadata(img, buf, len, &offset);
+    if (status != 0) {
+        return status;
+    }
+
     /* Just slide the data over */
-    memmove(&buf[0], &buf[i], img->length);
+    memmove(&buf[0], &buf[offset], img->length);
     img->data = buf;
 
     return 0;
@@ -440,6 +455,42 @@ bladerf_image_read_out:
     return rv;
 }
 
+int image_map(struct bladerf_image *img, const char *file,
+              struct file_mapping *map)
+{
+    size_t offset;
+    int status;
+
+    status = file_map(file, map);
+    if (status != 0) {
+        return status;
+    }
+
+    if (file_is_gzip(map->data, map->size)) {
+        log_debug("%s is compressed and cannot be mapped.\n", file);
+        status = BLADERF_ERR_UNSUPPORTED;
+        goto out;
+    }
+
+    status = verify_checksum(map->data, map->size);
+    if (status != 0) {
+        goto out;
+    }
+
+    memset(img, 0, sizeof(*img));
+    status = unpack_metadata(img, map->data, map->size, &offset);
+    if (status == 0) {
+        img->data = (uint8_t *)&map->data[offset];
+    }
+
+out:
+    if (status != 0) {
+        file_unmap(map);
+    }
+
+    return status;
+}
+
 static inline bool is_page_aligned(struct bladerf *dev, uint32_t val)
 {
     return val % dev->flash_arch->psize_bytes == 0;
@@ -0,0 +1,26 @@
+#ifndef BLADERF1_IMAGE_H_
+#define BLADERF1_IMAGE_H_
+
+#include <libbladeRF.h>
+
+#include "helpers/file.h"
+
+/**
+ * Map an image file into memory and validate it, as bladerf_image_read()
+ * does, without copying its contents.
+ *
+ * On success, `img` describes the image and its `data` points into the
+ * mapping, so it must not be freed with bladerf_free_image(). Release the
+ * image with file_unmap() once it is no longer needed.
+ *
+ * @param[out]  img     Image metadata
+ * @param[in]   file    Image file
+ * @param[out]  map     Mapping of the image file
+ *
+ * @return 0 on success, BLADERF_ERR_UNSUPPORTED if the file is compressed, or
+ *         another BLADERF_ERR_* value on failure
+ */
+int image_map(struct bladerf_image *img, const char *file,
+              struct file_mapping *map);
+
+#endif
@@ -0,0 +1,287 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* The tuning cache is stored as a text file:
+ *
+ *  # bladeRF tuning cache
+ *  serial <serial number>
+ *  rx <frequency> <vcocap>
+ *  tx <frequency> <vcocap>
+ *  ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+
+#include "tuning_cache.h"
+
+#define TUNING_CACHE_HEADER "# bladeRF tuning cache"
+
+/* VCOCAP is a 6-bit field */
+#define VCOCAP_MAX 0x3f
+
+void tuning_cache_init(struct tuning_cache *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+void tuning_cache_free(struct tuning_cache *cache)
+{
+    free(cache->entries[BLADERF_MODULE_RX]);
+    free(cache->entries[BLADERF_MODULE_TX]);
+    free(cache->path);
+    tuning_cache_init(cache);
+}
+
+/* Index of the first entry whose frequency is >= freq */
+static unsigned int find_idx(const struct tuning_cache_entry *entries,
+                             unsigned int n_entries, uint32_t freq)
+{
+    unsigned int lo = 0;
+    unsigned int hi = n_entries;
+
+    while (lo < hi) {
+        const unsigned int mid = lo + (hi - lo) / 2;
+        if (entries[mid].freq < freq) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+bool tuning_cache_lookup(const struct tuning_cache *cache,
+                         bladerf_module module,
+                         uint32_t freq,
+                         uint8_t *vcocap)
+{
+    const struct tuning_cache_entry *entries = cache->entries[module];
+    const unsigned int n_entries = cache->n_entries[module];
+    unsigned int idx;
+
+    idx = find_idx(entries, n_entries, freq);
+    if (idx < n_entries && entries[idx].freq == freq) {
+        *vcocap = entries[idx].vcocap;
+        return true;
+    }
+
+    return false;
+}
+
+int tuning_cache_insert(struct tuning_cache *cache,
+                        bladerf_module module,
+                        uint32_t freq,
+                        uint8_t vcocap)
+{
+    struct tuning_cache_entry *entries = cache->entries[module];
+    unsigned int n_entries = cache->n_entries[module];
+    unsigned int idx;
+
+    idx = find_idx(entries, n_entries, freq);
+    if (idx < n_entries && entries[idx].freq == freq) {
+        if (entries[idx].vcocap != vcocap) {
+            entries[idx].vcocap = vcocap;
+            cache->dirty = true;
+        }
+        return 0;
+    }
+
+    if (n_entries >= TUNING_CACHE_MAX_ENTRIES) {
+        log_verbose("Tuning cache full; not caching %u Hz.\n", freq);
+        return 0;
+    }
+
+    if (n_entries == cache->capacity[module]) {
+        const unsigned int capacity = (n_entries == 0) ? 64 : 2 * n_entries;
+
+        entries = realloc(entries, capacity * sizeof(entries[0]));
+        if (entries == NULL) {
+            return BLADERF_ERR_MEM;
+        }
+
+        cache->entries[module]  = entries;
+        cache->capacity[module] = capacity;
+    }
+
+    memmove(&entries[idx + 1], &entries[idx],
+            (n_entries - idx) * sizeof(entries[0]));
+
+    entries[idx].freq   = freq;
+    entries[idx].vcocap = vcocap;
+
+    cache->n_entries[module] = n_entries + 1;
+    cache->dirty = true;
+
+    return 0;
+}
+
+void tuning_cache_remove(struct tuning_cache *cache,
+                         bladerf_module module,
+                         uint32_t freq)
+{
+    struct tuning_cache_entry *entries = cache->entries[module];
+    const unsigned int n_entries = cache->n_entries[module];
+    unsigned int idx;
+
+    idx = find_idx(entries, n_entries, freq);
+    if (idx < n_entries && entries[idx].freq == freq) {
+        memmove(&entries[idx], &entries[idx + 1],
+                (n_entries - idx - 1) * sizeof(entries[0]));
+
+        cache->n_entries[module] = n_entries - 1;
+        cache->dirty = true;
+    }
+}
+
+int tuning_cache_load(struct tuning_cache *cache, const char *path,
+                      const char *serial)
+{
+    FILE *f;
+    char line[128];
+    char module_str[8];
+    char serial_str[BLADERF_SERIAL_LENGTH];
+    unsigned int freq, vcocap;
+    unsigned int line_num = 0;
+    unsigned int n_loaded = 0;
+    bool serial_ok = false;
+    int status = 0;
+
+    free(cache->path);
+    cache->path = strdup(path);
+    if (cache->path == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        if (errno == ENOENT) {
+            log_debug("Tuning cache %s does not exist yet.\n", path);
+            return 0;
+        }
+
+        log_debug("Failed to open tuning cache %s: %s\n", path,
+                  strerror(errno));
+        return BLADERF_ERR_IO;
+    }
+
+    while (status == 0 && fgets(line, sizeof(line), f) != NULL) {
+        line_num++;
+
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        if (sscanf(line, "serial %32s", serial_str) == 1) {
+            serial_ok = (strcmp(serial_str, serial) == 0);
+            if (!serial_ok) {
+                log_warning("Ignoring tuning cache %s, which was created for "
+                            "device %s.\n", path, serial_str);
+                break;
+            }
+        } else if (!serial_ok) {
+            log_warning("Tuning cache %s is missing its serial number.\n",
+                        path);
+            break;
+        } else if (sscanf(line, "%7s %u %u", module_str, &freq, &vcocap) == 3
+                   && vcocap <= VCOCAP_MAX
+                   && (!strcmp(module_str, "rx") || !strcmp(module_str, "tx"))) {
+
+            const bladerf_module module = !strcmp(module_str, "rx")
+                                              ? BLADERF_MODULE_RX
+                                              : BLADERF_MODULE_TX;
+
+            status = tuning_cache_insert(cache, module, freq, (uint8_t)vcocap);
+            n_loaded++;
+        } else {
+            log_warning("Ignoring invalid tuning cache entry at %s:%u\n",
+                        path, line_num);
+        }
+    }
+
+    fclose(f);
+
+    cache->dirty = false;
+    log_debug("Loaded %u entries from tuning cache %s\n", n_loaded, path);
+
+    return status;
+}
+
+static int write_entries(FILE *f, const struct tuning_cache *cache,
+                         bladerf_module module, const char *module_str)
+{
+    const struct tuning_cache_entry *entries = cache->entries[module];
+    unsigned int i;
+
+    for (i = 0; i < cache->n_entries[module]; i++) {
+        if (fprintf(f, "%s %u %u\n", module_str, entries[i].freq,
+                    entries[i].vcocap) < 0) {
+            return BLADERF_ERR_IO;
+        }
+    }
+
+    return 0;
+}
+
+int tuning_cache_save(struct tuning_cache *cache, const char *serial)
+{
+    FILE *f;
+    int status;
+
+    if (cache->path == NULL || !cache->dirty) {
+        return 0;
+    }
+
+    f = fopen(cache->path, "w");
+    if (f == NULL) {
+        log_debug("Failed to open tuning cache %s for writing: %s\n",
+                  cache->path, strerror(errno));
+        return BLADERF_ERR_IO;
+    }
+
+    status = (fprintf(f, TUNING_CACHE_HEADER "\nserial %s\n", serial) < 0)
+                 ? BLADERF_ERR_IO
+                 : 0;
+
+    if (status == 0) {
+        status = write_entries(f, cache, BLADERF_MODULE_RX, "rx");
+    }
+
+    if (status == 0) {
+        status = write_entries(f, cache, BLADERF_MODULE_TX, "tx");
+    }
+
+    if (fclose(f) != 0 && status == 0) {
+        status = BLADERF_ERR_IO;
+    }
+
+    if (status == 0) {
+        cache->dirty = false;
+        log_debug("Saved tuning cache %s\n", cache->path);
+    }
+
+    return status;
+}
@@ -0,0 +1,138 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef BLADERF1_TUNING_CACHE_H_
+#define BLADERF1_TUNING_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libbladeRF.h>
+
+/**
+ * Maximum number of cached frequencies per module. Once a module's cache is
+ * full, further frequencies are tuned normally but not recorded.
+ */
+#define TUNING_CACHE_MAX_ENTRIES 16384
+
+struct tuning_cache_entry {
+    uint32_t freq;  /* LMS6002D PLL frequency (Hz) */
+    uint8_t vcocap; /* VCOCAP value found by the tuning algorithm */
+};
+
+struct tuning_cache {
+    /* Per-module entries, sorted (increasing) by freq */
+    struct tuning_cache_entry *entries[2];
+    unsigned int n_entries[2];
+    unsigned int capacity[2];
+
+    /* Location the cache is saved to on close, or NULL if it is not
+     * persisted */
+    char *path;
+
+    /* Entries have been added since the cache was loaded */
+    bool dirty;
+};
+
+/**
+ * Initialize an empty tuning cache
+ *
+ * @param[out]  cache   Cache to initialize
+ */
+void tuning_cache_init(struct tuning_cache *cache);
+
+/**
+ * Free all entries and the path associated with a tuning cache
+ *
+ * @param       cache   Cache to free
+ */
+void tuning_cache_free(struct tuning_cache *cache);
+
+/**
+ * Look up the VCOCAP value previously found for a frequency
+ *
+ * @param[in]   cache   Cache to search
+ * @param[in]   module  Module
+ * @param[in]   freq    LMS6002D PLL frequency (Hz)
+ * @param[out]  vcocap  Cached VCOCAP value
+ *
+ * @return true if the frequency was found, false otherwise
+ */
+bool tuning_cache_lookup(const struct tuning_cache *cache,
+                         bladerf_module module,
+                         uint32_t freq,
+                         uint8_t *vcocap);
+
+/**
+ * Record the VCOCAP value found for a frequency, replacing any existing entry
+ *
+ * @param       cache   Cache to update
+ * @param[in]   module  Module
+ * @param[in]   freq    LMS6002D PLL frequency (Hz)
+ * @param[in]   vcocap  VCOCAP value
+ *
+ * @return 0 on success, BLADERF_ERR_MEM on allocation failure
+ */
+int tuning_cache_insert(struct tuning_cache *cache,
+                        bladerf_module module,
+                        uint32_t freq,
+                        uint8_t vcocap);
+
+/**
+ * Remove a frequency from the cache
+ *
+ * @param       cache   Cache to update
+ * @param[in]   module  Module
+ * @param[in]   freq    LMS6002D PLL frequency (Hz)
+ */
+void tuning_cache_remove(struct tuning_cache *cache,
+                         bladerf_module module,
+                         uint32_t freq);
+
+/**
+ * Load cache entries from a file, merging them into the cache. The path is
+ * retained and used by tuning_cache_save().
+ *
+ * A missing file is not an error; the cache is saved there later.
+ *
+ * @param       cache   Cache to load into
+ * @param[in]   path    Cache file
+ * @param[in]   serial  Serial number of the device. Files created for other
+ *                      devices are rejected.
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int tuning_cache_load(struct tuning_cache *cache, const char *path,
+                      const char *serial);
+
+/**
+ * Write the cache to the path it was loaded from, if any entries have been
+ * added since then
+ *
+ * @param       cache   Cache to save
+ * @param[in]   serial  Serial number of the device
+ *
+ * @return 0 on success or if there is nothing to save, BLADERF_ERR_* value on
+ *         failure
+ */
+int tuning_cache_save(struct tuning_cache *cache, const char *serial);
+
+#endif
@@ -105,10 +105,58 @@ static struct bladerf_loopback_modes const bladerf2_loopback_modes[] = {
 /* Low-level Initialization */
 /******************************************************************************/
 
+/**
+ * @brief      Determine if the RFIC configuration left by a previous session
+ *             can be resumed, instead of performing a full initialization
+ *
+ * This is only possible when the FPGA-based RFIC controller owns the RFIC,
+ * since the host-based controller's AD9361 driver state does not outlive the
+ * process that created it.
+ *
+ * @param      dev   Device handle
+ *
+ * @return     true if a warm open should be performed, false otherwise
+ */
+static bool _bladerf2_can_warm_open(struct bladerf *dev)
+{
+    struct bladerf2_board_data *board_data = dev->board_data;
+    extern struct controller_fns const rfic_fpga_control;
+    bladerf_rfic_init_state init_state;
+    int status;
+
+    if (!bladerf_warm_open_enabled && NULL == getenv("BLADERF_WARM_OPEN")) {
+        return false;
+    }
+
+    if (!have_cap(board_data->capabilities, BLADERF_CAP_FPGA_TUNING) ||
+        !rfic_fpga_control.is_present(dev)) {
+        log_debug("%s: FPGA-based RFIC control unavailable; performing a cold "
+                  "open\n",
+                  __FUNCTION__);
+        return false;
+    }
+
+    status = rfic_fpga_control.get_init_state(dev, &init_state);
+    if (status < 0) {
+        log_debug("%s: failed to query RFIC state: %s\n", __FUNCTION__,
+                  bladerf_strerror(status));
+        return false;
+    }
+
+    if (BLADERF_RFIC_INIT_STATE_OFF == init_state) {
+        log_debug("%s: RFIC is not initialized; performing a cold open\n",
+                  __FUNCTION__);
+        return false;
+    }
+
+    return true;
+}
+
 static int _bladerf2_initialize(struct bladerf *dev)
 {
     struct bladerf2_board_data *board_data;
     struct bladerf_version required_fw_version, required_fpga_version;
+    bladerf_tuning_mode tuning_mode;
     int status;
 
     /* Test for uninitialized dev struct */
@@ -193,8 +241,18 @@ static int _bladerf2_initialize(struct bladerf *dev)
      *  - Setting up FIR filters
      *  - Disabling RX and TX on the RFIC
      *  - Muting the TX
+     *
+     * On a warm open, the FPGA-based controller simply resumes the
+     * configuration it is already holding.
      */
-    CHECK_STATUS(dev->board->set_tuning_mode(dev, default_tuning_mode(dev)));
+    if (_bladerf2_can_warm_open(dev)) {
+        log_debug("%s: resuming existing RFIC configuration\n", __FUNCTION__);
+        tuning_mode = BLADERF_TUNING_MODE_FPGA;
+    } else {
+        tuning_mode = default_tuning_mode(dev);
+    }
+
+    CHECK_STATUS(dev->board->set_tuning_mode(dev, tuning_mode));
 
     /* Update device state */
     board_data->state = STATE_INITIALIZED;
@@ -210,9 +268,11 @@ static int _bladerf2_initialize(struct bladerf *dev)
     /* Configure PLL */
     CHECK_STATUS(bladerf_set_pll_refclk(dev, BLADERF_REFIN_DEFAULT));
 
-    /* Reset current quick tune profile number */
-    board_data->quick_tune_rx_profile = 0;
-    board_data->quick_tune_tx_profile = 0;
+    /* Release all quick tune profiles */
+    memset(board_data->quick_tune_rx_profiles, 0,
+           sizeof(board_data->quick_tune_rx_profiles));
+    memset(board_data->quick_tune_tx_profiles, 0,
+           sizeof(board_data->quick_tune_tx_profiles));
 
     log_debug("%s: complete\n", __FUNCTION__);
 
@@ -448,15 +508,15 @@ static int bladerf2_open(struct bladerf *dev, struct bladerf_devinfo *devinfo)
         /* Try searching for an FPGA in the config search path */
         switch (board_data->fpga_size) {
             case BLADERF_FPGA_A4:
-                full_path = file_find("hostedxA4.rbf");
+                full_path = file_find_image("hostedxA4.rbf");
                 break;
 
             case BLADERF_FPGA_A5:
-                full_path = file_find("hostedxA5.rbf");
+                full_path = file_find_image("hostedxA5.rbf");
                 break;
 
             case BLADERF_FPGA_A9:
-                full_path = file_find("hostedxA9.rbf");
+                full_path = file_find_image("hostedxA9.rbf");
                 break;
 
             default:
@@ -1416,6 +1476,25 @@ static int bladerf2_get_rf_ports(struct bladerf *dev,
 /* Scheduled Tuning */
 /******************************************************************************/
 
+/* Assign the lowest-numbered free Nios fast lock profile */
+static int _alloc_quick_tune_profile(uint8_t *profiles, uint16_t *profile)
+{
+    uint16_t i;
+
+    for (i = 0; i < NUM_BBP_FASTLOCK_PROFILES; i++) {
+        if ((profiles[i / 8] & (1 << (i % 8))) == 0) {
+            profiles[i / 8] |= (1 << (i % 8));
+            *profile = i;
+            return 0;
+        }
+    }
+
+    log_debug("All %u quick tune profiles are in use.\n",
+              NUM_BBP_FASTLOCK_PROFILES);
+
+    return BLADERF_ERR_QUEUE_FULL;
+}
+
 static int bladerf2_get_quick_tune(struct bladerf *dev,
                                    bladerf_channel ch,
                                    struct bladerf_quick_tune *quick_tune)
@@ -1439,19 +1518,15 @@ static int bladerf2_get_quick_tune(struct bladerf *dev,
     pm = _get_band_port_map_by_freq(ch, freq);
 
     if (BLADERF_CHANNEL_IS_TX(ch)) {
-        if (board_data->quick_tune_tx_profile < NUM_BBP_FASTLOCK_PROFILES) {
-            /* Assign Nios and RFFE profile numbers */
-            quick_tune->nios_profile = board_data->quick_tune_tx_profile++;
-            log_verbose("Quick tune assigned Nios TX fast lock index: %u\n",
-                        quick_tune->nios_profile);
-            quick_tune->rffe_profile =
-                quick_tune->nios_profile % NUM_RFFE_FASTLOCK_PROFILES;
-            log_verbose("Quick tune assigned RFFE TX fast lock index: %u\n",
-                        quick_tune->rffe_profile);
-        } else {
-            log_error("Reached maximum number of TX quick tune profiles.");
-            return BLADERF_ERR_UNEXPECTED;
-        }
+        /* Assign Nios and RFFE profile numbers */
+        CHECK_STATUS(_alloc_quick_tune_profile(
+            board_data->quick_tune_tx_profiles, &quick_tune->nios_profile));
+        log_verbose("Quick tune assigned Nios TX fast lock index: %u\n",
+                    quick_tune->nios_profile);
+        quick_tune->rffe_profile =
+            quick_tune->nios_profile % NUM_RFFE_FASTLOCK_PROFILES;
+        log_verbose("Quick tune assigned RFFE TX fast lock index: %u\n",
+                    quick_tune->rffe_profile);
 
         /* Create a fast lock profile in the RFIC */
         CHECK_STATUS(
@@ -1468,19 +1543,15 @@ static int bladerf2_get_quick_tune(struct bladerf *dev,
         quick_tune->spdt = (pm->spdt << 6) | (pm->spdt << 4);
 
     } else {
-        if (board_data->quick_tune_rx_profile < NUM_BBP_FASTLOCK_PROFILES) {
-            /* Assign Nios and RFFE profile numbers */
-            quick_tune->nios_profile = board_data->quick_tune_rx_profile++;
-            log_verbose("Quick tune assigned Nios RX fast lock index: %u\n",
-                        quick_tune->nios_profile);
-            quick_tune->rffe_profile =
-                quick_tune->nios_profile % NUM_RFFE_FASTLOCK_PROFILES;
-            log_verbose("Quick tune assigned RFFE RX fast lock index: %u\n",
-                        quick_tune->rffe_profile);
-        } else {
-            log_error("Reached maximum number of RX quick tune profiles.");
-            return BLADERF_ERR_UNEXPECTED;
-        }
+        /* Assign Nios and RFFE profile numbers */
+        CHECK_STATUS(_alloc_quick_tune_profile(
+            board_data->quick_tune_rx_profiles, &quick_tune->nios_profile));
+        log_verbose("Quick tune assigned Nios RX fast lock index: %u\n",
+                    quick_tune->nios_profile);
+        quick_tune->rffe_profile =
+            quick_tune->nios_profile % NUM_RFFE_FASTLOCK_PROFILES;
+        log_verbose("Quick tune assigned RFFE RX fast lock index: %u\n",
+                    quick_tune->rffe_profile);
 
         /* Create a fast lock profile in the RFIC */
         CHECK_STATUS(
@@ -1512,6 +1583,33 @@ static int bladerf2_get_quick_tune(struct bladerf *dev,
     return 0;
 }
 
+static int bladerf2_release_quick_tune(
+    struct bladerf *dev,
+    bladerf_channel ch,
+    struct bladerf_quick_tune const *quick_tune)
+{
+    CHECK_BOARD_STATE(STATE_INITIALIZED);
+    NULL_CHECK(quick_tune);
+
+    struct bladerf2_board_data *board_data = dev->board_data;
+    uint8_t *profiles;
+    uint16_t const profile = quick_tune->nios_profile;
+
+    if (profile >= NUM_BBP_FASTLOCK_PROFILES) {
+        RETURN_INVAL_ARG("nios_profile", profile, "is not valid");
+    }
+
+    if (BLADERF_CHANNEL_IS_TX(ch)) {
+        profiles = board_data->quick_tune_tx_profiles;
+    } else {
+        profiles = board_data->quick_tune_rx_profiles;
+    }
+
+    profiles[profile / 8] &= ~(1 << (profile % 8));
+
+    return 0;
+}
+
 static int bladerf2_schedule_retune(struct bladerf *dev,
                                     bladerf_channel ch,
                                     bladerf_timestamp timestamp,
@@ -1996,6 +2094,29 @@ static int bladerf2_set_correction(struct bladerf *dev,
     return 0;
 }
 
+static int bladerf2_get_iq_correction(struct bladerf *dev,
+                                      bladerf_channel ch,
+                                      struct bladerf_iq_correction *corr)
+{
+    return BLADERF_ERR_UNSUPPORTED;
+}
+
+static int bladerf2_set_iq_correction(struct bladerf *dev,
+                                      bladerf_channel ch,
+                                      const struct bladerf_iq_correction *corr)
+{
+    return BLADERF_ERR_UNSUPPORTED;
+}
+
+static int bladerf2_set_iq_correction_table(
+    struct bladerf *dev,
+    bladerf_channel ch,
+    const struct bladerf_iq_correction *entries,
+    unsigned int num_entries)
+{
+    return BLADERF_ERR_UNSUPPORTED;
+}
+
 
 /******************************************************************************/
 /* Trigger */
@@ -2237,6 +2358,24 @@ static int bladerf2_sync_rx(struct bladerf *dev,
                    metadata, timeout_ms);
 }
 
+static int bladerf2_sync_set_rx_decimation(struct bladerf *dev,
+                                           unsigned int factor,
+                                           const float *taps,
+                                           unsigned int num_taps,
+                                           double shift)
+{
+    CHECK_BOARD_STATE(STATE_INITIALIZED);
+
+    struct bladerf2_board_data *board_data = dev->board_data;
+
+    if (!board_data->sync[BLADERF_RX].initialized) {
+        RETURN_INVAL("sync rx", "not initialized");
+    }
+
+    return sync_set_rx_decimation(&board_data->sync[BLADERF_RX], factor, taps,
+                                  num_taps, shift);
+}
+
 static int bladerf2_get_timestamp(struct bladerf *dev,
                                   bladerf_direction dir,
                                   bladerf_timestamp *value)
@@ -2934,10 +3073,14 @@ struct board_fns const bladerf2_board_fns = {
     FIELD_INIT(.get_rf_port, bladerf2_get_rf_port),
     FIELD_INIT(.get_rf_ports, bladerf2_get_rf_ports),
     FIELD_INIT(.get_quick_tune, bladerf2_get_quick_tune),
+    FIELD_INIT(.release_quick_tune, bladerf2_release_quick_tune),
     FIELD_INIT(.schedule_retune, bladerf2_schedule_retune),
     FIELD_INIT(.cancel_scheduled_retunes, bladerf2_cancel_scheduled_retunes),
     FIELD_INIT(.get_correction, bladerf2_get_correction),
     FIELD_INIT(.set_correction, bladerf2_set_correction),
+    FIELD_INIT(.get_iq_correction, bladerf2_get_iq_correction),
+    FIELD_INIT(.set_iq_correction, bladerf2_set_iq_correction),
+    FIELD_INIT(.set_iq_correction_table, bladerf2_set_iq_correction_table),
     FIELD_INIT(.trigger_init, bladerf2_trigger_init),
     FIELD_INIT(.trigger_arm, bladerf2_trigger_arm),
     FIELD_INIT(.trigger_fire, bladerf2_trigger_fire),
@@ -2952,6 +3095,7 @@ struct board_fns const bladerf2_board_fns = {
     FIELD_INIT(.sync_config, bladerf2_sync_config),
     FIELD_INIT(.sync_tx, bladerf2_sync_tx),
     FIELD_INIT(.sync_rx, bladerf2_sync_rx),
+    FIELD_INIT(.sync_set_rx_decimation, bladerf2_sync_set_rx_decimation),
     FIELD_INIT(.get_timestamp, bladerf2_get_timestamp),
     FIELD_INIT(.load_fpga, bladerf2_load_fpga),
     FIELD_INIT(.flash_fpga, bladerf2_flash_fpga),
@@ -253,6 +253,11 @@ bladerf_tuning_mode default_tuning_mode(struct bladerf *dev)
         mode = BLADERF_TUNING_MODE_HOST;
     }
 
+    /* The simulated device only models the FPGA-hosted RFIC controller */
+    if (dev->ident.backend == BLADERF_BACKEND_DUMMY) {
+        mode = BLADERF_TUNING_MODE_FPGA;
+    }
+
     env_var = getenv("BLADERF_DEFAULT_TUNING_MODE");
 
     if (env_var != NULL) {
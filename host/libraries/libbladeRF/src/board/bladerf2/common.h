@@ -175,9 +175,9 @@ struct bladerf2_board_data {
     uint16_t trimdac_last_value;   /**< saved running value */
     uint16_t trimdac_stored_value; /**< cached value read from SPI flash */
 
-    /* Quick Tune Profile Status */
-    uint16_t quick_tune_tx_profile;
-    uint16_t quick_tune_rx_profile;
+    /* Quick Tune Profile Status: bitmaps of the Nios profiles in use */
+    uint8_t quick_tune_tx_profiles[NUM_BBP_FASTLOCK_PROFILES / 8];
+    uint8_t quick_tune_rx_profiles[NUM_BBP_FASTLOCK_PROFILES / 8];
 
     /* RFIC backend command handling */
     struct controller_fns const *rfic;
@@ -189,10 +189,16 @@ struct bladerf2_board_data {
     /* If true, RFIC control will be fully de-initialized on close, instead of
      * just put into a standby state. */
     bool rfic_reset_on_close;
+
+    /* If true, the FPGA-based RFIC controller supports the SYNC command, and
+     * write completion may be awaited without polling. */
+    bool rfic_sync_supported;
 };
 
 struct bladerf_rfic_status_register {
     bool rfic_initialized;
+    bool write_queue_success;
+    bool sync_supported;
     size_t write_queue_length;
 };
 
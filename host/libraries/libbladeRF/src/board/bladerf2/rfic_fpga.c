@@ -53,6 +53,27 @@ static int _rfic_cmd_read(struct bladerf *dev,
                           bladerf_rfic_command cmd,
                           uint64_t *data);
 
+/**
+ * @brief       RFIC Command Write, without waiting
+ *
+ * Enqueues a command using the FPGA-based RFIC interface, using the supplied
+ * data value as an argument. Does not wait for the command to be executed;
+ * use _rfic_fpga_wait() to do so. This allows several commands to be queued
+ * and awaited together.
+ *
+ * @param       dev     Device handle
+ * @param[in]   ch      Channel to act upon; use ::BLADERF_CHANNEL_INVALID for
+ *                      non-channel-specific commands
+ * @param[in]   cmd     Command
+ * @param[in]   data    Argument for command
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+static int _rfic_cmd_write_nowait(struct bladerf *dev,
+                                  bladerf_channel ch,
+                                  bladerf_rfic_command cmd,
+                                  uint64_t data);
+
 /**
  * @brief       RFIC Command Write
  *
@@ -81,6 +102,22 @@ static int _rfic_cmd_write(struct bladerf *dev,
 /* Build RFIC address from bladerf_rfic_command and bladerf_channel */
 #define RFIC_ADDRESS(cmd, ch) ((cmd & 0xFF) + ((ch & 0xF) << 8))
 
+static void _rfic_fpga_unpack_status(
+    uint64_t sreg, struct bladerf_rfic_status_register *rfic_status)
+{
+    rfic_status->rfic_initialized =
+        (sreg >> BLADERF_RFIC_STATUS_INIT_SHIFT) &
+        BLADERF_RFIC_STATUS_INIT_MASK;
+    rfic_status->write_queue_success =
+        (sreg >> BLADERF_RFIC_STATUS_WQSUCCESS_SHIFT) &
+        BLADERF_RFIC_STATUS_WQSUCCESS_MASK;
+    rfic_status->sync_supported = (sreg >> BLADERF_RFIC_STATUS_SYNC_SHIFT) &
+                                  BLADERF_RFIC_STATUS_SYNC_MASK;
+    rfic_status->write_queue_length =
+        (sreg >> BLADERF_RFIC_STATUS_WQLEN_SHIFT) &
+        BLADERF_RFIC_STATUS_WQLEN_MASK;
+}
+
 static int _rfic_fpga_get_status(
     struct bladerf *dev, struct bladerf_rfic_status_register *rfic_status)
 {
@@ -90,22 +127,49 @@ static int _rfic_fpga_get_status(
     status = _rfic_cmd_read(dev, BLADERF_CHANNEL_INVALID,
                             BLADERF_RFIC_COMMAND_STATUS, &sreg);
 
-    rfic_status->rfic_initialized   = ((sreg >> 0) & 0x1);
-    rfic_status->write_queue_length = ((sreg >> 8) & 0xFF);
+    _rfic_fpga_unpack_status(sreg, rfic_status);
+
+    return status;
+}
+
+/* Like _rfic_fpga_get_status(), but has the FPGA execute any pending write
+ * queue jobs before it responds. */
+static int _rfic_fpga_get_status_sync(
+    struct bladerf *dev, struct bladerf_rfic_status_register *rfic_status)
+{
+    uint64_t sreg = 0;
+    int status;
+
+    status = _rfic_cmd_read(dev, BLADERF_CHANNEL_INVALID,
+                            BLADERF_RFIC_COMMAND_SYNC, &sreg);
+
+    _rfic_fpga_unpack_status(sreg, rfic_status);
 
     return status;
 }
 
 static int _rfic_fpga_get_status_wqlen(struct bladerf *dev)
 {
+    struct bladerf2_board_data *board_data = dev->board_data;
     struct bladerf_rfic_status_register rfic_status;
     int status;
 
-    status = _rfic_fpga_get_status(dev, &rfic_status);
+    if (board_data->rfic_sync_supported) {
+        status = _rfic_fpga_get_status_sync(dev, &rfic_status);
+    } else {
+        status = _rfic_fpga_get_status(dev, &rfic_status);
+    }
+
     if (status < 0) {
         return status;
     }
 
+    if (0 == rfic_status.write_queue_length &&
+        !rfic_status.write_queue_success) {
+        log_debug("%s: last queued RFIC command reported failure\n",
+                  __FUNCTION__);
+    }
+
 #ifdef BLADERF_HEADLESS_C_DEBUG
     if (rfic_status.write_queue_length > 0) {
         log_verbose("%s: queue len = %d\n", __FUNCTION__,
@@ -116,20 +180,29 @@ static int _rfic_fpga_get_status_wqlen(struct bladerf *dev)
     return (int)rfic_status.write_queue_length;
 }
 
-static int _rfic_fpga_spinwait(struct bladerf *dev)
+static int _rfic_fpga_wait(struct bladerf *dev)
 {
-    size_t const TRIES       = 30;
-    unsigned int const DELAY = 100;
-    size_t count             = 0;
+    unsigned int const MIN_DELAY = 10;
+    unsigned int const MAX_DELAY = 100;
+    unsigned int const BUDGET    = 3000;
+    unsigned int delay           = MIN_DELAY;
+    unsigned int waited          = 0;
     int jobs;
 
-    /* Poll the CPU and spin until the job has been completed. */
-    do {
+    /* Query the queue state, which (if supported) also has the FPGA execute
+     * the pending jobs before responding. Most commands have therefore
+     * completed by the first response; longer-running ones (e.g., INIT) are
+     * polled with an increasing delay. */
+    while (true) {
         jobs = _rfic_fpga_get_status_wqlen(dev);
-        if (0 != jobs) {
-            usleep(DELAY);
+        if (0 == jobs || waited >= BUDGET) {
+            break;
         }
-    } while ((0 != jobs) && (++count < TRIES));
+
+        usleep(delay);
+        waited += delay;
+        delay = (delay * 2 > MAX_DELAY) ? MAX_DELAY : delay * 2;
+    }
 
     /* If it's simply taking too long to dequeue the command, status will
      * have the number of items in the queue. Bonk this down to a timeout. */
@@ -153,17 +226,24 @@ static int _rfic_cmd_read(struct bladerf *dev,
     return dev->backend->rfic_command_read(dev, RFIC_ADDRESS(cmd, ch), data);
 }
 
+static int _rfic_cmd_write_nowait(struct bladerf *dev,
+                                  bladerf_channel ch,
+                                  bladerf_rfic_command cmd,
+                                  uint64_t data)
+{
+    return dev->backend->rfic_command_write(dev, RFIC_ADDRESS(cmd, ch), data);
+}
+
 static int _rfic_cmd_write(struct bladerf *dev,
                            bladerf_channel ch,
                            bladerf_rfic_command cmd,
                            uint64_t data)
 {
     /* Perform the write command. */
-    CHECK_STATUS(
-        dev->backend->rfic_command_write(dev, RFIC_ADDRESS(cmd, ch), data));
+    CHECK_STATUS(_rfic_cmd_write_nowait(dev, ch, cmd, data));
 
     /* Block until the job has been completed. */
-    return _rfic_fpga_spinwait(dev);
+    return _rfic_fpga_wait(dev);
 }
 
 
@@ -173,15 +253,18 @@ static int _rfic_cmd_write(struct bladerf *dev,
 
 static bool _rfic_fpga_is_present(struct bladerf *dev)
 {
-    uint64_t sreg = 0;
+    struct bladerf2_board_data *board_data = dev->board_data;
+    struct bladerf_rfic_status_register rfic_status;
     int status;
 
-    status = _rfic_cmd_read(dev, BLADERF_CHANNEL_INVALID,
-                            BLADERF_RFIC_COMMAND_STATUS, &sreg);
+    status = _rfic_fpga_get_status(dev, &rfic_status);
     if (status < 0) {
         return false;
     }
 
+    /* Older FPGAs leave this bit reserved, and must be polled */
+    board_data->rfic_sync_supported = rfic_status.sync_supported;
+
     return true;
 }
 
@@ -265,7 +348,6 @@ static int _rfic_fpga_enable_module(struct bladerf *dev,
                                     bool ch_enable)
 {
     struct bladerf2_board_data *board_data = dev->board_data;
-    struct controller_fns const *rfic      = board_data->rfic;
     bladerf_direction dir = BLADERF_CHANNEL_IS_TX(ch) ? BLADERF_TX : BLADERF_RX;
     uint32_t reg;     /* RFFE register value */
     bool ch_enabled;  /* Channel: initial state */
@@ -302,9 +384,11 @@ static int _rfic_fpga_enable_module(struct bladerf *dev,
 
     /* Perform Channel Setup/Teardown */
     if (ch_pending) {
-        /* Set/unset TX mute */
+        /* Set/unset TX mute. This is queued along with the enable command,
+         * and both are awaited together. */
         if (BLADERF_CHANNEL_IS_TX(ch)) {
-            CHECK_STATUS(rfic->set_txmute(dev, ch, !ch_enable));
+            CHECK_STATUS(_rfic_cmd_write_nowait(
+                dev, ch, BLADERF_RFIC_COMMAND_TXMUTE, ch_enable ? 0 : 1));
         }
 
         /* Execute RFIC enable command. */
@@ -30,6 +30,7 @@
 #include "thread.h"
 
 #include "backend/backend.h"
+#include "device_calibration.h"
 
 /* Device capabilities are stored in a 64-bit mask.
  *
@@ -180,6 +181,9 @@ struct bladerf {
     /* Backend's private data */
     void *backend_data;
 
+    /* Trace recording/replay state, when the trace layer wraps the backend */
+    struct trace *trace;
+
     /* Board-specific implementations */
     const struct board_fns *board;
 
@@ -198,8 +202,23 @@ struct bladerf {
     /* Enabled feature */
     bladerf_feature feature;
 
+    /* Flash programming mode */
+    bladerf_flash_mode flash_mode;
+
+    /* FPGA loading mode */
+    bladerf_fpga_load_mode fpga_load_mode;
+
     /* Calibration */
     struct bladerf_gain_cal_tbl gain_tbls[NUM_GAIN_CAL_TBLS];
+    struct gain_cal_lut gain_luts[NUM_GAIN_CAL_TBLS];
+
+    /* Retune queue occupancy reported by the backend for the most recent
+     * retune request, indexed by BLADERF_CHANNEL_IS_TX(). A depth of 0 means
+     * the occupancy is unknown. */
+    struct {
+        unsigned int fill;
+        unsigned int depth;
+    } retune_queue[2];
 };
 
 struct board_fns {
@@ -321,6 +340,9 @@ struct board_fns {
     int (*get_quick_tune)(struct bladerf *dev,
                           bladerf_channel ch,
                           struct bladerf_quick_tune *quick_tune);
+    int (*release_quick_tune)(struct bladerf *dev,
+                              bladerf_channel ch,
+                              const struct bladerf_quick_tune *quick_tune);
     int (*schedule_retune)(struct bladerf *dev,
                            bladerf_channel ch,
                            bladerf_timestamp timestamp,
@@ -337,6 +359,16 @@ struct board_fns {
                           bladerf_channel ch,
                           bladerf_correction corr,
                           int16_t value);
+    int (*get_iq_correction)(struct bladerf *dev,
+                             bladerf_channel ch,
+                             struct bladerf_iq_correction *corr);
+    int (*set_iq_correction)(struct bladerf *dev,
+                             bladerf_channel ch,
+                             const struct bladerf_iq_correction *corr);
+    int (*set_iq_correction_table)(struct bladerf *dev,
+                                   bladerf_channel ch,
+                                   const struct bladerf_iq_correction *entries,
+                                   unsigned int num_entries);
 
     /* Trigger */
     int (*trigger_init)(struct bladerf *dev,
@@ -398,6 +430,11 @@ struct board_fns {
                    unsigned int num_samples,
                    struct bladerf_metadata *metadata,
                    unsigned int timeout_ms);
+    int (*sync_set_rx_decimation)(struct bladerf *dev,
+                                  unsigned int factor,
+                                  const float *taps,
+                                  unsigned int num_taps,
+                                  double shift);
     int (*get_timestamp)(struct bladerf *dev,
                          bladerf_direction dir,
                          bladerf_timestamp *timestamp);
@@ -492,4 +529,8 @@ struct bladerf_flash_arch {
 extern const struct board_fns *bladerf_boards[];
 extern const unsigned int bladerf_boards_len;
 
+/* Reuse existing RFIC configuration on open, if possible. See
+ * bladerf_set_warm_open(). */
+extern bool bladerf_warm_open_enabled;
+
 #endif
@@ -20,14 +20,18 @@
  */
 
 
+#include <float.h>
 #include <string.h>
 #include <stdio.h>
 #include "common.h"
 #include "libbladeRF.h"
 #include "board/board.h"
+#include "board/bladerf1/image.h"
+#include "helpers/file.h"
 #include "helpers/version.h"
 #include "device_calibration.h"
 #include "log.h"
+#include "thread.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -51,6 +55,17 @@
     .patch = 0, \
 }
 
+#define GAIN_CAL_TX_ENTRY_SIZE \
+    (sizeof(uint8_t) + sizeof(bladerf_gain) + 2 * sizeof(uint64_t) + sizeof(float))
+
+#define GAIN_CAL_RX_ENTRY_SIZE                                       \
+    (sizeof(uint8_t) + sizeof(bladerf_gain) + 2 * sizeof(float) +    \
+     2 * sizeof(uint64_t) + sizeof(int32_t))
+
+/* Bound on the size of a dense lookup table, should the calibration entries
+ * not share a common spacing */
+#define GAIN_CAL_LUT_MAX_POINTS 65536
+
 #define __round_int(x) (x >= 0 ? (int)(x + 0.5) : (int)(x - 0.5))
 
 #define RETURN_ERROR_STATUS(_what, _status)                   \
@@ -68,161 +83,560 @@
         }                                  \
     } while (0)
 
-static size_t count_csv_entries(const char *filename) {
-    char line[1024]; // Adjust buffer size as needed
-    int count = 0;
+/* Cursor over the lines of a memory-mapped CSV file */
+struct csv_cursor {
+    const char *p;
+    const char *end;
+    unsigned int line;
+};
 
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Error opening file");
-        return -1;
+/* Return the next line, excluding its line ending, or false at the end */
+static bool csv_next_line(struct csv_cursor *c, const char **line,
+                          const char **line_end)
+{
+    const char *eol;
+
+    if (c->p >= c->end) {
+        return false;
     }
 
-    while (fgets(line, sizeof(line), file)) {
-        count++;
+    eol = memchr(c->p, '\n', c->end - c->p);
+    if (eol == NULL) {
+        eol = c->end;
     }
 
-    fclose(file);
+    *line = c->p;
+    *line_end = (eol > c->p && eol[-1] == '\r') ? eol - 1 : eol;
+
+    c->p = (eol < c->end) ? eol + 1 : eol;
+    c->line++;
 
-    return count - 2; // Subtract 2 to account for the serial number and header lines
+    return true;
 }
 
-int gain_cal_csv_to_bin(struct bladerf *dev, const char *csv_path, const char *binary_path, bladerf_channel ch)
+static bool csv_parse_sep(const char **p, const char *end)
 {
-    int status = 0;
-    struct bladerf_image *image;
-    size_t data_size;
-    size_t entry_size;
-    size_t offset = 0;
+    if (*p < end && **p == ',') {
+        (*p)++;
+        return true;
+    }
 
-    char line[256];
-    char current_dir[1000];
-    char expected_header[1024];
-    char device_serial[BLADERF_SERIAL_LENGTH];
-    char csv_serial[BLADERF_SERIAL_LENGTH];
+    return false;
+}
+
+static bool csv_parse_u64(const char **p, const char *end, uint64_t *value)
+{
+    const char *s = *p;
+    uint64_t v = 0;
+
+    if (s >= end || *s < '0' || *s > '9') {
+        return false;
+    }
+
+    while (s < end && *s >= '0' && *s <= '9') {
+        const unsigned int digit = *s++ - '0';
+        if (v > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        v = v * 10 + digit;
+    }
+
+    *p = s;
+    *value = v;
+    return true;
+}
+
+static bool csv_parse_i32(const char **p, const char *end, int32_t *value)
+{
+    const char *s = *p;
+    bool negative = false;
+    uint64_t v;
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    if (!csv_parse_u64(&s, end, &v) || v > (uint64_t)INT32_MAX + negative) {
+        return false;
+    }
+
+    *p = s;
+    *value = negative ? (int32_t)(-(int64_t)v) : (int32_t)v;
+    return true;
+}
+
+static bool csv_parse_u8(const char **p, const char *end, uint8_t *value)
+{
+    uint64_t v;
+
+    if (!csv_parse_u64(p, end, &v) || v > UINT8_MAX) {
+        return false;
+    }
+
+    *value = (uint8_t)v;
+    return true;
+}
+
+/* Decimal numbers with at most 15 significant digits and a power of ten
+ * within +/-22 are converted to the nearest double by one multiplication or
+ * division. Rounding that to float gives the nearest float, unless the double
+ * lies exactly halfway between two floats, where the tie may have been
+ * created by the first rounding. That case, and anything else unusual, is
+ * left to strtof(). */
+static bool csv_parse_float(const char **p, const char *end, float *value)
+{
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    const char *s = *p;
+    const char *start = s;
+    bool negative = false;
+    uint64_t mantissa = 0;
+    unsigned int n_digits = 0;
+    int exp10 = 0;
+    bool any_digits = false;
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    for (; s < end && *s >= '0' && *s <= '9'; s++) {
+        any_digits = true;
+        if (mantissa != 0 || *s != '0') {
+            mantissa = mantissa * 10 + (*s - '0');
+            n_digits++;
+            if (n_digits > 19) {
+                goto slow_path;
+            }
+        }
+    }
 
+    if (s < end && *s == '.') {
+        for (s++; s < end && *s >= '0' && *s <= '9'; s++) {
+            any_digits = true;
+            if (mantissa != 0 || *s != '0') {
+                mantissa = mantissa * 10 + (*s - '0');
+                n_digits++;
+                if (n_digits > 19) {
+                    goto slow_path;
+                }
+            }
+            exp10--;
+        }
+    }
+
+    if (!any_digits) {
+        return false;
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        int32_t e;
+        const char *q = s + 1;
+        if (!csv_parse_i32(&q, end, &e) || e > 400 || e < -400) {
+            goto slow_path;
+        }
+        exp10 += e;
+        s = q;
+    }
+
+    if (n_digits <= 15 && exp10 >= -22 && exp10 <= 22) {
+        double v = (double)mantissa;
+        uint64_t bits;
+
+        v = (exp10 < 0) ? v / pow10[-exp10] : v * pow10[exp10];
+
+        /* The 29 low mantissa bits are those a float does not have */
+        memcpy(&bits, &v, sizeof(bits));
+        if ((bits & 0x1fffffff) != 0x10000000 && (v == 0 || v >= FLT_MIN)) {
+            *value = (float)(negative ? -v : v);
+            *p = s;
+            return true;
+        }
+    }
+
+slow_path:
+    {
+        char buf[64];
+        char *parse_end;
+        const char *tok_end = start;
+        size_t len;
+
+        while (tok_end < end && *tok_end != ',' && *tok_end != '\r' &&
+               *tok_end != '\n') {
+            tok_end++;
+        }
+
+        len = tok_end - start;
+        if (len == 0 || len >= sizeof(buf)) {
+            return false;
+        }
+
+        memcpy(buf, start, len);
+        buf[len] = '\0';
+
+        *value = strtof(buf, &parse_end);
+        if (parse_end == buf) {
+            return false;
+        }
+
+        *p = start + (parse_end - buf);
+        return true;
+    }
+}
+
+/* Output buffer for packed entries */
+struct gain_cal_buf {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+};
+
+static int gain_cal_buf_reserve(struct gain_cal_buf *buf, size_t n)
+{
+    if (buf->len + n > buf->capacity) {
+        size_t capacity = (buf->capacity == 0) ? 4096 : buf->capacity;
+        uint8_t *data;
+
+        while (capacity < buf->len + n) {
+            capacity *= 2;
+        }
+
+        data = realloc(buf->data, capacity);
+        if (data == NULL) {
+            return BLADERF_ERR_MEM;
+        }
+
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    return 0;
+}
+
+#define GAIN_CAL_PACK(_buf, _field)                                         \
+    do {                                                                    \
+        memcpy(&(_buf)->data[(_buf)->len], &(_field), sizeof(_field));      \
+        (_buf)->len += sizeof(_field);                                      \
+    } while (0)
+
+/* Parse one entry and append it to buf. Fields beyond those expected are
+ * ignored. */
+static bool parse_gain_cal_line(const char *p, const char *end, bool tx,
+                                struct gain_cal_buf *buf)
+{
     uint64_t frequency;
     float power;
     uint64_t cw_freq;
     uint8_t chain;
-    bladerf_gain gain;
+    int32_t gain;
     int32_t rssi;
     float vsg_power;
     uint64_t signal_freq;
 
-    FILE *csvFile = fopen(csv_path, "r");
-    FILE *binaryFile = fopen(binary_path, "wb");
-    if (!csvFile || !binaryFile) {
-        status = BLADERF_ERR_NO_FILE;
-        if (getcwd(current_dir, sizeof(current_dir)) != NULL) {
-            log_error("Error opening calibration file: %s\n", strcat(current_dir, csv_path));
-        } else {
-            log_error("Error opening calibration file\n");
+    if (tx) {
+        if (!(csv_parse_u8(&p, end, &chain) && csv_parse_sep(&p, end) &&
+              csv_parse_i32(&p, end, &gain) && csv_parse_sep(&p, end) &&
+              csv_parse_u64(&p, end, &cw_freq) && csv_parse_sep(&p, end) &&
+              csv_parse_u64(&p, end, &frequency) && csv_parse_sep(&p, end) &&
+              csv_parse_float(&p, end, &power))) {
+            return false;
         }
-        goto error;
+
+        GAIN_CAL_PACK(buf, chain);
+        GAIN_CAL_PACK(buf, gain);
+        GAIN_CAL_PACK(buf, cw_freq);
+        GAIN_CAL_PACK(buf, frequency);
+        GAIN_CAL_PACK(buf, power);
+    } else {
+        if (!(csv_parse_u8(&p, end, &chain) && csv_parse_sep(&p, end) &&
+              csv_parse_i32(&p, end, &gain) && csv_parse_sep(&p, end) &&
+              csv_parse_float(&p, end, &vsg_power) && csv_parse_sep(&p, end) &&
+              csv_parse_u64(&p, end, &signal_freq) && csv_parse_sep(&p, end) &&
+              csv_parse_u64(&p, end, &frequency) && csv_parse_sep(&p, end) &&
+              csv_parse_i32(&p, end, &rssi) && csv_parse_sep(&p, end) &&
+              csv_parse_float(&p, end, &power))) {
+            return false;
+        }
+
+        GAIN_CAL_PACK(buf, chain);
+        GAIN_CAL_PACK(buf, gain);
+        GAIN_CAL_PACK(buf, vsg_power);
+        GAIN_CAL_PACK(buf, signal_freq);
+        GAIN_CAL_PACK(buf, frequency);
+        GAIN_CAL_PACK(buf, rssi);
+        GAIN_CAL_PACK(buf, power);
     }
 
-    strncpy(device_serial, dev->ident.serial, BLADERF_SERIAL_LENGTH);
-    device_serial[BLADERF_SERIAL_LENGTH - 1] = '\0';
+    return true;
+}
 
-    if (!fgets(line, sizeof(line), csvFile)) {
+static bool header_matches(const char *line, const char *line_end,
+                           const char *header)
+{
+    const size_t len = strlen(header);
+    return (size_t)(line_end - line) >= len && memcmp(line, header, len) == 0;
+}
+
+/* Convert a gain calibration CSV file in a single pass over a mapping of the
+ * file. If dir is NULL, the direction is determined from the CSV's header. If
+ * device_serial is NULL, the serial number from the CSV is used. */
+static int gain_cal_csv_convert(const char *csv_path, const char *binary_path,
+                                const bladerf_direction *dir,
+                                const char *device_serial)
+{
+    int status = 0;
+    struct file_mapping map;
+    struct csv_cursor csv;
+    struct gain_cal_buf buf = { NULL, 0, 0 };
+    struct bladerf_image *image = NULL;
+    const char *line, *line_end;
+    char csv_serial[BLADERF_SERIAL_LENGTH] = { 0 };
+    size_t entry_size;
+    size_t num_entries = 0;
+    bool tx;
+
+    status = file_map(csv_path, &map);
+    if (status != 0) {
+        log_error("Error opening calibration file: %s\n", csv_path);
+        return (status == BLADERF_ERR_IO) ? BLADERF_ERR_INVAL : status;
+    }
+
+    csv.p = (const char *)map.data;
+    csv.end = (const char *)map.data + map.size;
+    csv.line = 0;
+
+    if (!csv_next_line(&csv, &line, &line_end)) {
         status = BLADERF_ERR_INVAL;
         log_error("Error reading serial number from CSV file or file is empty.\n");
         goto error;
     }
 
-    sscanf(line, "Serial: %s", csv_serial);
-    if (strcmp(device_serial, csv_serial) != 0) {
+    if (header_matches(line, line_end, "Serial: ")) {
+        const size_t len = line_end - line - strlen("Serial: ");
+        memcpy(csv_serial, line + strlen("Serial: "),
+               (len < sizeof(csv_serial)) ? len : sizeof(csv_serial) - 1);
+    }
+
+    if (device_serial == NULL) {
+        device_serial = csv_serial;
+    } else if (strcmp(device_serial, csv_serial) != 0) {
         log_warning("Gain calibration file serial (%s) does not match device serial (%s)\n", csv_serial, device_serial);
     }
 
-    size_t num_entries = count_csv_entries(csv_path);
-    if (num_entries == 0) {
+    if (!csv_next_line(&csv, &line, &line_end)) {
         status = BLADERF_ERR_INVAL;
         log_error("Error reading header from CSV file or file is empty.\n");
         goto error;
     }
 
-    entry_size = (BLADERF_CHANNEL_IS_TX(ch))
-        ? sizeof(chain) + sizeof(gain) + sizeof(cw_freq) + sizeof(frequency) + sizeof(power)
-        : sizeof(chain) + sizeof(gain) + sizeof(vsg_power) + sizeof(signal_freq) + sizeof(frequency) + sizeof(rssi) + sizeof(power);
+    if (dir == NULL) {
+        tx = header_matches(line, line_end, GAIN_CAL_HEADER_TX);
+        if (!tx && !header_matches(line, line_end, GAIN_CAL_HEADER_RX)) {
+            status = BLADERF_ERR_INVAL;
+            log_error("CSV format does not match expected RX or TX headers: %s\n", csv_path);
+            goto error;
+        }
+    } else {
+        tx = (*dir == BLADERF_TX);
+        if (!header_matches(line, line_end, tx ? GAIN_CAL_HEADER_TX : GAIN_CAL_HEADER_RX)) {
+            status = BLADERF_ERR_INVAL;
+            log_error("CSV format does not match expected %s headers\n", tx ? "TX" : "RX");
+            goto error;
+        }
+    }
 
-    data_size = num_entries * entry_size + BLADERF_SERIAL_LENGTH;
+    entry_size = tx ? GAIN_CAL_TX_ENTRY_SIZE : GAIN_CAL_RX_ENTRY_SIZE;
 
-    image = bladerf_alloc_image(dev, BLADERF_IMAGE_TYPE_GAIN_CAL, 0xffffffff, data_size);
-    if (image == NULL) {
-        log_error("Failed to allocate image\n");
-        status = BLADERF_ERR_MEM;
+    /* Size the buffer for the typical line length, to avoid regrowing it */
+    status = gain_cal_buf_reserve(&buf, BLADERF_SERIAL_LENGTH +
+                                        (map.size / 48 + 1) * entry_size);
+    if (status != 0) {
         goto error;
     }
 
-    if (!fgets(line, sizeof(line), csvFile)) {
+    memset(buf.data, 0, BLADERF_SERIAL_LENGTH);
+    memcpy(buf.data, device_serial,
+           strnlen(device_serial, BLADERF_SERIAL_LENGTH - 1));
+    buf.len = BLADERF_SERIAL_LENGTH;
+
+    while (csv_next_line(&csv, &line, &line_end)) {
+        if (line == line_end) {
+            continue;
+        }
+
+        status = gain_cal_buf_reserve(&buf, entry_size);
+        if (status != 0) {
+            goto error;
+        }
+
+        if (!parse_gain_cal_line(line, line_end, tx, &buf)) {
+            status = BLADERF_ERR_INVAL;
+            log_error("Invalid gain calibration entry at %s:%u\n", csv_path, csv.line);
+            goto error;
+        }
+
+        num_entries++;
+    }
+
+    if (num_entries == 0 || buf.len > UINT32_MAX) {
         status = BLADERF_ERR_INVAL;
-        log_error("Error reading header from CSV file or file is empty.\n");
+        log_error("No gain calibration entries found in %s\n", csv_path);
         goto error;
     }
 
-    strncpy(expected_header, (BLADERF_CHANNEL_IS_TX(ch)) ? GAIN_CAL_HEADER_TX : GAIN_CAL_HEADER_RX, sizeof(expected_header));
-    if (strncmp(line, expected_header, strlen(expected_header)) != 0) {
-        status = BLADERF_ERR_INVAL;
-        log_error("CSV format does not match expected %s headers\n", (BLADERF_CHANNEL_IS_TX(ch)) ? "TX" : "RX");
+    /* The image's data is attached after allocation, as its size was not
+     * known up front. A placeholder address avoids any need for a device. */
+    image = bladerf_alloc_image(NULL, BLADERF_IMAGE_TYPE_GAIN_CAL, 0xffffffff, 0);
+    if (image == NULL) {
+        log_error("Failed to allocate image\n");
+        status = BLADERF_ERR_MEM;
         goto error;
     }
 
     image->version = GAIN_CAL_VERSION;
+    image->data = buf.data;
+    image->length = (uint32_t)buf.len;
+    buf.data = NULL;
 
-    memcpy(&image->data[offset], device_serial, BLADERF_SERIAL_LENGTH);
-    offset += BLADERF_SERIAL_LENGTH;
+    log_debug("Writing image to file: %s\n", binary_path);
+    status = bladerf_image_write(NULL, image, binary_path);
 
-    for (size_t i = 0; i < num_entries; i++) {
-        if (!fgets(line, sizeof(line), csvFile)) {
+error:
+    if (image) {
+        bladerf_free_image(image);
+    }
+
+    free(buf.data);
+    file_unmap(&map);
+    return status;
+}
+
+int gain_cal_csv_to_bin(struct bladerf *dev, const char *csv_path, const char *binary_path, bladerf_channel ch)
+{
+    char device_serial[BLADERF_SERIAL_LENGTH];
+    const bladerf_direction dir = BLADERF_CHANNEL_IS_TX(ch) ? BLADERF_TX : BLADERF_RX;
+
+    strncpy(device_serial, dev->ident.serial, BLADERF_SERIAL_LENGTH);
+    device_serial[BLADERF_SERIAL_LENGTH - 1] = '\0';
+
+    return gain_cal_csv_convert(csv_path, binary_path, &dir, device_serial);
+}
+
+int gain_cal_csv_to_bin_file(const char *csv_path, const char *binary_path)
+{
+    return gain_cal_csv_convert(csv_path, binary_path, NULL, NULL);
+}
+
+struct gain_cal_batch {
+    MUTEX lock;
+    const char *const *csv_paths;
+    const char *const *binary_paths;
+    int *statuses;
+    unsigned int num_files;
+    unsigned int next;
+    unsigned int num_failed;
+};
+
+static void *gain_cal_batch_worker(void *arg)
+{
+    struct gain_cal_batch *batch = arg;
+
+    while (true) {
+        unsigned int i;
+        int status;
+
+        MUTEX_LOCK(&batch->lock);
+        i = batch->next++;
+        MUTEX_UNLOCK(&batch->lock);
+
+        if (i >= batch->num_files) {
             break;
         }
 
-        if (BLADERF_CHANNEL_IS_TX(ch)) {
-            sscanf(line, "%" SCNu8 ",%" SCNi32 ",%" SCNu64 ",%" SCNu64 ",%f",
-                &chain, &gain, &cw_freq, &frequency, &power);
+        status = gain_cal_csv_to_bin_file(batch->csv_paths[i],
+                                          batch->binary_paths[i]);
 
-            memcpy(&image->data[offset], &chain, sizeof(chain));
-            offset += sizeof(chain);
-            memcpy(&image->data[offset], &gain, sizeof(gain));
-            offset += sizeof(gain);
-            memcpy(&image->data[offset], &cw_freq, sizeof(cw_freq));
-            offset += sizeof(cw_freq);
-            memcpy(&image->data[offset], &frequency, sizeof(frequency));
-            offset += sizeof(frequency);
-            memcpy(&image->data[offset], &power, sizeof(power));
-            offset += sizeof(power);
-        } else {
-            sscanf(line, "%" SCNu8 ",%" SCNi32 ",%f,%" SCNu64 ",%" SCNu64 ",%" SCNi32 ",%f",
-                &chain, &gain, &vsg_power, &signal_freq, &frequency, &rssi, &power);
+        if (batch->statuses != NULL) {
+            batch->statuses[i] = status;
+        }
 
-            memcpy(&image->data[offset], &chain, sizeof(chain));
-            offset += sizeof(chain);
-            memcpy(&image->data[offset], &gain, sizeof(gain));
-            offset += sizeof(gain);
-            memcpy(&image->data[offset], &vsg_power, sizeof(vsg_power));
-            offset += sizeof(vsg_power);
-            memcpy(&image->data[offset], &signal_freq, sizeof(signal_freq));
-            offset += sizeof(signal_freq);
-            memcpy(&image->data[offset], &frequency, sizeof(frequency));
-            offset += sizeof(frequency);
-            memcpy(&image->data[offset], &rssi, sizeof(rssi));
-            offset += sizeof(rssi);
-            memcpy(&image->data[offset], &power, sizeof(power));
-            offset += sizeof(power);
+        if (status != 0) {
+            MUTEX_LOCK(&batch->lock);
+            batch->num_failed++;
+            MUTEX_UNLOCK(&batch->lock);
         }
     }
 
-    log_debug("Writing image to file: %s\n", binary_path);
-    bladerf_image_write(dev, image, binary_path);
-    bladerf_free_image(image);
+    return NULL;
+}
 
-error:
-    if (csvFile)
-        fclose(csvFile);
-    if (binaryFile)
-        fclose(binaryFile);
+int gain_cal_csv_to_bin_batch(const char *const *csv_paths,
+                              const char *const *binary_paths,
+                              unsigned int num_files,
+                              unsigned int num_threads,
+                              int *statuses)
+{
+    struct gain_cal_batch batch;
+    THREAD *threads;
+    unsigned int n_started = 0;
+    unsigned int i;
+    int status = 0;
+
+    if (num_threads == 0) {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        num_threads = info.dwNumberOfProcessors;
+#else
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (n_cpus > 0) ? (unsigned int)n_cpus : 1;
+#endif
+    }
+
+    if (num_threads > num_files) {
+        num_threads = num_files;
+    }
+
+    threads = calloc(num_threads, sizeof(threads[0]));
+    if (threads == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    MUTEX_INIT(&batch.lock);
+    batch.csv_paths = csv_paths;
+    batch.binary_paths = binary_paths;
+    batch.statuses = statuses;
+    batch.num_files = num_files;
+    batch.next = 0;
+    batch.num_failed = 0;
+
+    /* The calling thread converts files too, so one fewer thread is needed */
+    for (i = 1; i < num_threads; i++) {
+        if (THREAD_CREATE(&threads[i], gain_cal_batch_worker, &batch) != THREAD_SUCCESS) {
+            log_warning("Failed to start gain calibration conversion thread\n");
+            break;
+        }
+        n_started++;
+    }
+
+    gain_cal_batch_worker(&batch);
+
+    for (i = 1; i <= n_started; i++) {
+        THREAD_JOIN(threads[i], NULL);
+    }
+
+    if (batch.num_failed != 0) {
+        log_error("Failed to convert %u of %u gain calibration files\n",
+                  batch.num_failed, num_files);
+        status = BLADERF_ERR_UNEXPECTED;
+    }
+
+    MUTEX_DESTROY(&batch.lock);
+    free(threads);
     return status;
 }
 
@@ -278,21 +692,15 @@ void gain_cal_tbl_free(struct bladerf_gain_cal_tbl *tbl) {
     tbl->state = BLADERF_GAIN_CAL_UNLOADED;
 }
 
-int load_gain_calibration(struct bladerf *dev, bladerf_channel ch, const char *binary_path) {
-    const int num_channels = 4;  // Make this const to fix the array allocation issue
-    struct bladerf_gain_cal_tbl *gain_tbls = malloc(num_channels * sizeof(struct bladerf_gain_cal_tbl));
-    if (!gain_tbls) {
-        log_error("Failed to allocate memory for gain tables\n");
-        return BLADERF_ERR_MEM;
-    }
-
-    bladerf_gain current_gain;
+/* Extract the entries for the reference chain and gain from an image's
+ * records, which are packed and unaligned. */
+static size_t parse_gain_cal_entries(struct bladerf_gain_cal_tbl *tbl,
+                                     bladerf_channel ch,
+                                     const uint8_t *data,
+                                     size_t num_entries)
+{
     uint64_t frequency;
     float power;
-    size_t entry_counter;
-    size_t offset;
-    int status = 0;
-
     uint64_t cw_freq;
     uint8_t chain;
     bladerf_gain gain;
@@ -300,18 +708,72 @@ int load_gain_calibration(struct bladerf *dev, bladerf_channel ch, const char *b
     float vsg_power;
     bladerf_frequency signal_freq;
 
+    size_t offset = 0;
+    size_t entry_counter = 0;
+
+    for (size_t i = 0; i < num_entries; i++) {
+        if (BLADERF_CHANNEL_IS_TX(ch)) {
+            memcpy(&chain, &data[offset], sizeof(chain));
+            offset += sizeof(chain);
+            memcpy(&gain, &data[offset], sizeof(gain));
+            offset += sizeof(gain);
+            memcpy(&cw_freq, &data[offset], sizeof(cw_freq));
+            offset += sizeof(cw_freq);
+            memcpy(&frequency, &data[offset], sizeof(frequency));
+            offset += sizeof(frequency);
+            memcpy(&power, &data[offset], sizeof(power));
+            offset += sizeof(power);
+        } else {
+            memcpy(&chain, &data[offset], sizeof(chain));
+            offset += sizeof(chain);
+            memcpy(&gain, &data[offset], sizeof(gain));
+            offset += sizeof(gain);
+            memcpy(&vsg_power, &data[offset], sizeof(vsg_power));
+            offset += sizeof(vsg_power);
+            memcpy(&signal_freq, &data[offset], sizeof(signal_freq));
+            offset += sizeof(signal_freq);
+            memcpy(&frequency, &data[offset], sizeof(frequency));
+            offset += sizeof(frequency);
+            memcpy(&rssi, &data[offset], sizeof(rssi));
+            offset += sizeof(rssi);
+            memcpy(&power, &data[offset], sizeof(power));
+            offset += sizeof(power);
+        }
+
+        if (BLADERF_CHANNEL_IS_TX(ch) && chain == 0 && gain == 60) {
+            tbl->entries[entry_counter].freq = frequency;
+            tbl->entries[entry_counter].gain_corr = power;
+            entry_counter++;
+        }
+
+        if (!BLADERF_CHANNEL_IS_TX(ch) && chain == 0 && gain == 0) {
+            tbl->entries[entry_counter].freq = frequency;
+            tbl->entries[entry_counter].gain_corr = power - vsg_power;
+            entry_counter++;
+        }
+    }
+
+    return entry_counter;
+}
+
+int load_gain_calibration(struct bladerf *dev, bladerf_channel ch, const char *binary_path) {
+    struct bladerf_gain_cal_tbl tbl;
+    struct gain_cal_lut lut;
+    bladerf_gain current_gain;
+    size_t entry_counter;
+    int status = 0;
+
+    struct bladerf_image mapped_image;
+    struct file_mapping map;
     struct bladerf_image *image = NULL;
     size_t entry_size;
     size_t num_entries;
     char device_serial[BLADERF_SERIAL_LENGTH];
     char file_serial[BLADERF_SERIAL_LENGTH];
 
-    FILE *binaryFile = fopen(binary_path, "rb");
-    if (!binaryFile) {
-        log_error("Error opening binary file.\n");
-        status = BLADERF_ERR_NO_FILE;
-        goto error;
-    }
+    memset(&tbl, 0, sizeof(tbl));
+    memset(&lut, 0, sizeof(lut));
+    memset(&map, 0, sizeof(map));
 
     status = dev->board->get_gain(dev, ch, &current_gain);
     if (status != 0) {
@@ -319,19 +781,25 @@ int load_gain_calibration(struct bladerf *dev, bladerf_channel ch, const char *b
         goto error;
     }
 
-    status = gain_cal_tbl_init(&gain_tbls[ch], (uint32_t) 10e3);
-    if (status != 0) {
-        log_error("Error initializing gain calibration table\n");
-        status = BLADERF_ERR_MEM;
-        goto error;
-    }
-
     entry_size = (BLADERF_CHANNEL_IS_TX(ch))
-        ? sizeof(chain) + sizeof(gain) + sizeof(cw_freq) + sizeof(frequency) + sizeof(power)
-        : sizeof(chain) + sizeof(gain) + sizeof(vsg_power) + sizeof(signal_freq) + sizeof(frequency) + sizeof(rssi) + sizeof(power);
+        ? GAIN_CAL_TX_ENTRY_SIZE
+        : GAIN_CAL_RX_ENTRY_SIZE;
+
+    /* Parse the entries in place when the file can be mapped, and fall back
+     * to reading it (e.g., if it is compressed) otherwise. */
+    status = image_map(&mapped_image, binary_path, &map);
+    if (status == 0) {
+        image = &mapped_image;
+    } else if (status == BLADERF_ERR_UNSUPPORTED) {
+        image = bladerf_alloc_image(dev, BLADERF_IMAGE_TYPE_GAIN_CAL, 0, 0);
+        if (image == NULL) {
+            status = BLADERF_ERR_MEM;
+            goto error;
+        }
+
+        status = bladerf_image_read(image, binary_path);
+    }
 
-    image = bladerf_alloc_image(dev, BLADERF_IMAGE_TYPE_GAIN_CAL, 0, 0);
-    status = bladerf_image_read(image, binary_path);
     if (status != 0) {
         log_error("Failed to read image: %s\n", bladerf_strerror(status));
         goto error;
@@ -346,6 +814,12 @@ int load_gain_calibration(struct bladerf *dev, bladerf_channel ch, const char *b
         goto error;
     }
 
+    if (image->length < BLADERF_SERIAL_LENGTH) {
+        log_error("Gain calibration image is truncated\n");
+        status = BLADERF_ERR_INVAL;
+        goto error;
+    }
+
     strncpy(device_serial, dev->ident.serial, BLADERF_SERIAL_LENGTH);
     device_serial[BLADERF_SERIAL_LENGTH - 1] = '\0';
     memcpy(file_serial, image->data, BLADERF_SERIAL_LENGTH);
@@ -355,85 +829,189 @@ int load_gain_calibration(struct bladerf *dev, bladerf_channel ch, const char *b
         log_warning("Calibration file serial (%s) does not match device serial (%s)\n", file_serial, device_serial);
     }
 
-    offset = BLADERF_SERIAL_LENGTH;
-    entry_counter = 0;
     num_entries = (image->length - BLADERF_SERIAL_LENGTH) / entry_size;
-    for (uint64_t i = 0; i < num_entries; i++) {
-        if (BLADERF_CHANNEL_IS_TX(ch)) {
-            memcpy(&chain, &image->data[offset], sizeof(chain));
-            offset += sizeof(chain);
-            memcpy(&gain, &image->data[offset], sizeof(gain));
-            offset += sizeof(gain);
-            memcpy(&cw_freq, &image->data[offset], sizeof(cw_freq));
-            offset += sizeof(cw_freq);
-            memcpy(&frequency, &image->data[offset], sizeof(frequency));
-            offset += sizeof(frequency);
-            memcpy(&power, &image->data[offset], sizeof(power));
-            offset += sizeof(power);
-        } else {
-            memcpy(&chain, &image->data[offset], sizeof(chain));
-            offset += sizeof(chain);
-            memcpy(&gain, &image->data[offset], sizeof(gain));
-            offset += sizeof(gain);
-            memcpy(&vsg_power, &image->data[offset], sizeof(vsg_power));
-            offset += sizeof(vsg_power);
-            memcpy(&signal_freq, &image->data[offset], sizeof(signal_freq));
-            offset += sizeof(signal_freq);
-            memcpy(&frequency, &image->data[offset], sizeof(frequency));
-            offset += sizeof(frequency);
-            memcpy(&rssi, &image->data[offset], sizeof(rssi));
-            offset += sizeof(rssi);
-            memcpy(&power, &image->data[offset], sizeof(power));
-            offset += sizeof(power);
-        }
-
-        if (BLADERF_CHANNEL_IS_TX(ch) && chain == 0 && gain == 60) {
-            gain_tbls[ch].entries[entry_counter].freq = frequency;
-            gain_tbls[ch].entries[entry_counter].gain_corr = power;
-            entry_counter++;
-        }
 
-        if (!BLADERF_CHANNEL_IS_TX(ch) && chain == 0 && gain == 0) {
-            gain_tbls[ch].entries[entry_counter].freq = frequency;
-            gain_tbls[ch].entries[entry_counter].gain_corr = power - vsg_power;
-            entry_counter++;
-        }
+    status = gain_cal_tbl_init(&tbl, (uint32_t)(num_entries > 0 ? num_entries : 1));
+    if (status != 0) {
+        log_error("Error initializing gain calibration table\n");
+        status = BLADERF_ERR_MEM;
+        goto error;
     }
 
+    entry_counter = parse_gain_cal_entries(&tbl, ch,
+                                           &image->data[BLADERF_SERIAL_LENGTH],
+                                           num_entries);
     if (entry_counter == 0) {
         log_error("No valid entries found: %s\n", binary_path);
         status = BLADERF_ERR_UNEXPECTED;
         goto error;
     }
 
-    gain_tbls[ch].version = image->version;
-    gain_tbls[ch].start_freq = gain_tbls[ch].entries[0].freq;
-    gain_tbls[ch].stop_freq = gain_tbls[ch].entries[entry_counter-1].freq;
-    gain_tbls[ch].n_entries = entry_counter;
-    gain_tbls[ch].ch = ch;
-    gain_tbls[ch].state = BLADERF_GAIN_CAL_LOADED;
-    gain_tbls[ch].enabled = true;
-    gain_tbls[ch].gain_target = current_gain;
-    strncpy(gain_tbls[ch].file_path, binary_path, gain_tbls[ch].file_path_len);
+    tbl.version = image->version;
+    tbl.start_freq = tbl.entries[0].freq;
+    tbl.stop_freq = tbl.entries[entry_counter-1].freq;
+    tbl.n_entries = entry_counter;
+    tbl.ch = ch;
+    tbl.state = BLADERF_GAIN_CAL_LOADED;
+    tbl.enabled = true;
+    tbl.gain_target = current_gain;
+    strncpy(tbl.file_path, binary_path, tbl.file_path_len);
+
+    status = gain_cal_lut_build(&lut, &tbl);
+    if (status != 0) {
+        goto error;
+    }
 
     gain_cal_tbl_free(&dev->gain_tbls[ch]);
-    dev->gain_tbls[ch] = gain_tbls[ch];
+    dev->gain_tbls[ch] = tbl;
+
+    gain_cal_lut_free(&dev->gain_luts[ch]);
+    dev->gain_luts[ch] = lut;
 
 error:
     if (status != 0) {
         log_error("binary_path: %s\n", binary_path);
+        gain_cal_tbl_free(&tbl);
+        gain_cal_lut_free(&lut);
     }
 
-    if (binaryFile)
-        fclose(binaryFile);
-    if (image)
+    if (image == &mapped_image)
+        file_unmap(&map);
+    else if (image)
         bladerf_free_image(image);
-    if (gain_tbls)
-        free(gain_tbls);
 
     return status;
 }
 
+/* Largest point spacing that places every entry on a point */
+static bladerf_frequency gain_cal_lut_step(const struct bladerf_gain_cal_tbl *tbl)
+{
+    bladerf_frequency step = 0;
+
+    for (uint32_t i = 1; i < tbl->n_entries; i++) {
+        bladerf_frequency a = tbl->entries[i].freq - tbl->entries[0].freq;
+        bladerf_frequency b = step;
+
+        while (b != 0) {
+            bladerf_frequency t = a % b;
+            a = b;
+            b = t;
+        }
+
+        step = a;
+    }
+
+    return step;
+}
+
+int gain_cal_lut_build(struct gain_cal_lut *lut, const struct bladerf_gain_cal_tbl *tbl)
+{
+    bladerf_frequency span;
+    bladerf_frequency step;
+    uint64_t n_points;
+    uint32_t idx = 0;
+
+    memset(lut, 0, sizeof(*lut));
+
+    if (tbl->n_entries == 0 || tbl->entries == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    span = tbl->entries[tbl->n_entries - 1].freq - tbl->entries[0].freq;
+    step = gain_cal_lut_step(tbl);
+
+    if (step == 0) {
+        /* A single frequency; use one point */
+        n_points = 1;
+        step = 1;
+    } else {
+        n_points = span / step + 1;
+        if (n_points > GAIN_CAL_LUT_MAX_POINTS) {
+            step = (span + GAIN_CAL_LUT_MAX_POINTS - 2) / (GAIN_CAL_LUT_MAX_POINTS - 1);
+            n_points = (span + step - 1) / step + 1;
+            log_debug("Gain calibration entries are irregularly spaced; "
+                      "using a %" PRIu64 " Hz lookup table spacing\n", step);
+        }
+    }
+
+    lut->corr = malloc(n_points * sizeof(lut->corr[0]));
+    if (lut->corr == NULL) {
+        log_error("failed to allocate memory for gain correction lookup table\n");
+        return BLADERF_ERR_MEM;
+    }
+
+    lut->start_freq = tbl->entries[0].freq;
+    lut->stop_freq  = tbl->entries[tbl->n_entries - 1].freq;
+    lut->step       = step;
+    lut->n_points   = (uint32_t)n_points;
+
+    /* Both the points and the entries are sorted, so interpolate each point
+     * while walking the entries once. */
+    for (uint32_t i = 0; i < lut->n_points; i++) {
+        bladerf_frequency freq = lut->start_freq + i * step;
+        const struct bladerf_gain_cal_entry *lo, *hi;
+
+        if (freq > lut->stop_freq) {
+            freq = lut->stop_freq;
+        }
+
+        while (idx + 1 < tbl->n_entries && tbl->entries[idx + 1].freq <= freq) {
+            idx++;
+        }
+
+        lo = &tbl->entries[idx];
+        hi = (idx + 1 < tbl->n_entries) ? &tbl->entries[idx + 1] : lo;
+
+        if (lo->freq == freq || hi->freq == lo->freq) {
+            lut->corr[i] = (float)lo->gain_corr;
+        } else {
+            lut->corr[i] = (float)(lo->gain_corr +
+                                   (double)(freq - lo->freq) *
+                                   (hi->gain_corr - lo->gain_corr) /
+                                   (double)(hi->freq - lo->freq));
+        }
+    }
+
+    log_verbose("Built %u point gain correction lookup table from %u entries\n",
+                lut->n_points, tbl->n_entries);
+
+    return 0;
+}
+
+int gain_cal_lut_lookup(const struct gain_cal_lut *lut, bladerf_frequency freq, double *gain_corr)
+{
+    bladerf_frequency offset;
+    uint32_t idx;
+
+    if (lut->n_points == 0 || freq > lut->stop_freq) {
+        log_error("Could not find ceil or floor entries in the calibration table\n");
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    if (freq <= lut->start_freq) {
+        *gain_corr = lut->corr[0];
+        return 0;
+    }
+
+    offset = freq - lut->start_freq;
+    idx = (uint32_t)(offset / lut->step);
+
+    if (idx + 1 >= lut->n_points) {
+        *gain_corr = lut->corr[lut->n_points - 1];
+    } else {
+        const double frac = (double)(offset - idx * lut->step) / lut->step;
+        *gain_corr = lut->corr[idx] + frac * (lut->corr[idx + 1] - lut->corr[idx]);
+    }
+
+    return 0;
+}
+
+void gain_cal_lut_free(struct gain_cal_lut *lut)
+{
+    free(lut->corr);
+    memset(lut, 0, sizeof(*lut));
+}
+
 static void find_floor_ceil_entries_by_frequency(const struct bladerf_gain_cal_tbl *tbl, bladerf_frequency freq,
                                                  struct bladerf_gain_cal_entry **floor, struct bladerf_gain_cal_entry **ceil) {
     int mid = 0;
@@ -503,11 +1081,11 @@ int get_gain_cal_entry(const struct bladerf_gain_cal_tbl *tbl, bladerf_frequency
 int get_gain_correction(struct bladerf *dev, bladerf_frequency freq, bladerf_channel ch, bladerf_gain *compensated_gain) {
     int status = 0;
     struct bladerf_gain_cal_tbl *cal_table = &dev->gain_tbls[ch];
-    struct bladerf_gain_cal_entry entry_next;
+    double gain_corr;
 
-    CHECK_STATUS(get_gain_cal_entry(cal_table, freq, &entry_next));
+    CHECK_STATUS(gain_cal_lut_lookup(&dev->gain_luts[ch], freq, &gain_corr));
 
-    *compensated_gain = __round_int(cal_table->gain_target - entry_next.gain_corr);
+    *compensated_gain = __round_int(cal_table->gain_target - gain_corr);
 
     log_verbose("Target gain:  %i, Compen. gain: %i\n", dev->gain_tbls[ch].gain_target, *compensated_gain);
     return status;
@@ -515,7 +1093,6 @@ int get_gain_correction(struct bladerf *dev, bladerf_frequency freq, bladerf_cha
 
 int apply_gain_correction(struct bladerf *dev, bladerf_channel ch, bladerf_frequency frequency) {
     struct bladerf_range const *gain_range = NULL;
-    bladerf_frequency current_frequency;
     bladerf_gain gain_compensated;
 
     if (dev->gain_tbls[ch].enabled == false) {
@@ -524,7 +1101,6 @@ int apply_gain_correction(struct bladerf *dev, bladerf_channel ch, bladerf_frequ
     }
 
     CHECK_STATUS(dev->board->get_gain_range(dev, ch, &gain_range));
-    CHECK_STATUS(dev->board->get_frequency(dev, ch, &current_frequency));
     CHECK_STATUS(get_gain_correction(dev, frequency, ch, &gain_compensated));
 
     if (gain_compensated > gain_range->max || gain_compensated < gain_range->min) {
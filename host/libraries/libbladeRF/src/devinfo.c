@@ -29,6 +29,7 @@
 
 #include "devinfo.h"
 #include "conversions.h"
+#include "thread.h"
 #include "log.h"
 
 /******************************************************************************/
@@ -68,6 +69,203 @@ void bladerf_free_device_list(struct bladerf_devinfo *devices)
     free(devices);
 }
 
+/******************************************************************************/
+/* Hotplug Subscriptions and Device List Cache */
+/******************************************************************************/
+
+#define HOTPLUG_MAX_SUBSCRIBERS 8
+
+struct hotplug_subscriber {
+    bladerf_hotplug_cb cb;
+    void *user_data;
+};
+
+static struct {
+    bool initialized;
+
+    /* Held while starting or stopping the backend monitor. 'lock' must not
+     * be held across that: stopping the monitor joins its thread, which may
+     * be waiting on 'lock' in hotplug_dispatch(). */
+    MUTEX monitor_lock;
+    bool monitoring;
+
+    MUTEX lock;
+    bool cache_enabled;
+    struct hotplug_subscriber subscribers[HOTPLUG_MAX_SUBSCRIBERS];
+} hotplug;
+
+static void hotplug_dispatch(bool arrived, const struct bladerf_devinfo *info)
+{
+    struct hotplug_subscriber subs[HOTPLUG_MAX_SUBSCRIBERS];
+    const bladerf_hotplug_event event =
+        arrived ? BLADERF_HOTPLUG_ARRIVED : BLADERF_HOTPLUG_LEFT;
+    size_t i;
+
+    /* Callbacks are invoked without the lock held, so that they may call
+     * back into libbladeRF (e.g., to open the device that just arrived) */
+    MUTEX_LOCK(&hotplug.lock);
+    memcpy(subs, hotplug.subscribers, sizeof(subs));
+    MUTEX_UNLOCK(&hotplug.lock);
+
+    for (i = 0; i < HOTPLUG_MAX_SUBSCRIBERS; i++) {
+        if (subs[i].cb != NULL) {
+            subs[i].cb(event, info, subs[i].user_data);
+        }
+    }
+}
+
+/* Start or stop the backend monitor based upon whether anything needs it.
+ * Must be called without hotplug.lock held. */
+static int hotplug_update_monitor(void)
+{
+    bool needed;
+    int status = 0;
+    size_t i;
+
+    MUTEX_LOCK(&hotplug.monitor_lock);
+
+    MUTEX_LOCK(&hotplug.lock);
+    needed = hotplug.cache_enabled;
+    for (i = 0; i < HOTPLUG_MAX_SUBSCRIBERS && !needed; i++) {
+        needed = (hotplug.subscribers[i].cb != NULL);
+    }
+    MUTEX_UNLOCK(&hotplug.lock);
+
+    if (needed != hotplug.monitoring) {
+        status = backend_hotplug_monitor(needed, hotplug_dispatch);
+        if (status == 0) {
+            hotplug.monitoring = needed;
+        }
+    }
+
+    MUTEX_UNLOCK(&hotplug.monitor_lock);
+
+    return status;
+}
+
+void devinfo_hotplug_init(void)
+{
+    MUTEX_INIT(&hotplug.monitor_lock);
+    MUTEX_INIT(&hotplug.lock);
+    hotplug.initialized = true;
+}
+
+void devinfo_hotplug_deinit(void)
+{
+    if (!hotplug.initialized) {
+        return;
+    }
+
+    MUTEX_LOCK(&hotplug.monitor_lock);
+    if (hotplug.monitoring) {
+        backend_hotplug_monitor(false, NULL);
+        hotplug.monitoring = false;
+    }
+    MUTEX_UNLOCK(&hotplug.monitor_lock);
+}
+
+int bladerf_set_device_cache(bool enable)
+{
+    int status;
+    bool prev;
+
+    if (!hotplug.initialized) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    MUTEX_LOCK(&hotplug.lock);
+    prev                  = hotplug.cache_enabled;
+    hotplug.cache_enabled = enable;
+    MUTEX_UNLOCK(&hotplug.lock);
+
+    status = hotplug_update_monitor();
+    if (status != 0) {
+        MUTEX_LOCK(&hotplug.lock);
+        hotplug.cache_enabled = prev;
+        MUTEX_UNLOCK(&hotplug.lock);
+    }
+
+    return status;
+}
+
+int bladerf_hotplug_register(bladerf_hotplug_cb cb,
+                             void *user_data,
+                             int *handle)
+{
+    int status = BLADERF_ERR_MEM;
+    size_t i;
+    size_t slot = HOTPLUG_MAX_SUBSCRIBERS;
+
+    if (cb == NULL || handle == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (!hotplug.initialized) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    MUTEX_LOCK(&hotplug.lock);
+
+    for (i = 0; i < HOTPLUG_MAX_SUBSCRIBERS; i++) {
+        if (hotplug.subscribers[i].cb == NULL) {
+            hotplug.subscribers[i].cb        = cb;
+            hotplug.subscribers[i].user_data = user_data;
+            slot                             = i;
+            break;
+        }
+    }
+
+    MUTEX_UNLOCK(&hotplug.lock);
+
+    if (slot == HOTPLUG_MAX_SUBSCRIBERS) {
+        log_debug("No free hotplug subscriber slots.\n");
+        return status;
+    }
+
+    status = hotplug_update_monitor();
+    if (status == 0) {
+        *handle = (int)slot + 1;
+    } else {
+        MUTEX_LOCK(&hotplug.lock);
+        hotplug.subscribers[slot].cb        = NULL;
+        hotplug.subscribers[slot].user_data = NULL;
+        MUTEX_UNLOCK(&hotplug.lock);
+    }
+
+    return status;
+}
+
+int bladerf_hotplug_deregister(int handle)
+{
+    int status;
+
+    if (handle < 1 || handle > HOTPLUG_MAX_SUBSCRIBERS) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (!hotplug.initialized) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    MUTEX_LOCK(&hotplug.lock);
+
+    if (hotplug.subscribers[handle - 1].cb == NULL) {
+        status = BLADERF_ERR_INVAL;
+    } else {
+        hotplug.subscribers[handle - 1].cb        = NULL;
+        hotplug.subscribers[handle - 1].user_data = NULL;
+        status                                    = 0;
+    }
+
+    MUTEX_UNLOCK(&hotplug.lock);
+
+    if (status == 0) {
+        status = hotplug_update_monitor();
+    }
+
+    return status;
+}
+
 /******************************************************************************/
 /* Device Information Helpers */
 /******************************************************************************/
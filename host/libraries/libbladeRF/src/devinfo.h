@@ -48,6 +48,16 @@ int bladerf_get_device_list(struct bladerf_devinfo **devices);
 
 void bladerf_free_device_list(struct bladerf_devinfo *devices);
 
+/**
+ * Initialize hotplug subscription state. Called once at library load.
+ */
+void devinfo_hotplug_init(void);
+
+/**
+ * Stop any active hotplug monitoring. Called once at library unload.
+ */
+void devinfo_hotplug_deinit(void);
+
 /**
  * Do the device instances for the two provided device info structures match
  * (taking wildcards into account)?
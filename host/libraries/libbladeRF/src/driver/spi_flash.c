@@ -21,6 +21,7 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -132,3 +133,117 @@ int spi_flash_verify(struct bladerf *dev, uint8_t *readback_buf,
     return status;
 }
 
+
+static inline bool page_is_erased(const uint8_t *buf, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (buf[i] != 0xff) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Erase, program and verify a single erase block. Pages that are entirely
+ * 0xff are left as the erase operation put them. */
+static int update_eb(struct bladerf *dev, uint8_t *readback_buf,
+                     const uint8_t *expected_buf, uint32_t erase_block)
+{
+    const uint32_t page_size    = dev->flash_arch->psize_bytes;
+    const uint32_t pages_per_eb = dev->flash_arch->ebsize_bytes / page_size;
+    const uint32_t first_page   = erase_block * pages_per_eb;
+    uint32_t p, run_start;
+    int status;
+
+    status = spi_flash_erase(dev, erase_block, 1);
+    if (status != 0) {
+        log_debug("Failed to erase block %u: %s\n", erase_block,
+                  bladerf_strerror(status));
+        return status;
+    }
+
+    /* Write contiguous runs of non-blank pages */
+    p = 0;
+    while (p < pages_per_eb) {
+        if (page_is_erased(&expected_buf[p * page_size], page_size)) {
+            p++;
+            continue;
+        }
+
+        run_start = p;
+        while (p < pages_per_eb &&
+               !page_is_erased(&expected_buf[p * page_size], page_size)) {
+            p++;
+        }
+
+        status = spi_flash_write(dev, &expected_buf[run_start * page_size],
+                                 first_page + run_start, p - run_start);
+        if (status != 0) {
+            log_debug("Failed to write block %u: %s\n", erase_block,
+                      bladerf_strerror(status));
+            return status;
+        }
+    }
+
+    return spi_flash_verify(dev, readback_buf, expected_buf, first_page,
+                            pages_per_eb);
+}
+
+int spi_flash_write_diff(struct bladerf *dev, const uint8_t *image,
+                         uint32_t erase_block, uint32_t count)
+{
+    const uint32_t eb_size      = dev->flash_arch->ebsize_bytes;
+    const uint32_t pages_per_eb = eb_size / dev->flash_arch->psize_bytes;
+    uint8_t *current;
+    uint32_t i;
+    uint32_t n_updated = 0;
+    int status;
+
+    status = check_eb_access(dev, erase_block, count);
+    if (status != 0) {
+        return status;
+    }
+
+    current = malloc((size_t)count * eb_size);
+    if (current == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    /* Read the entire region back in one pass. This is considerably cheaper
+     * than an erase + program cycle, so we only pay the latter for blocks
+     * whose contents actually change. */
+    status = spi_flash_read(dev, current, erase_block * pages_per_eb,
+                            count * pages_per_eb);
+    if (status != 0) {
+        log_debug("Failed to read back flash region: %s\n",
+                  bladerf_strerror(status));
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        const size_t offset = (size_t)i * eb_size;
+
+        if (memcmp(&current[offset], &image[offset], eb_size) == 0) {
+            log_verbose("Erase block %u is unchanged.\n", erase_block + i);
+            continue;
+        }
+
+        status = update_eb(dev, &current[offset], &image[offset],
+                           erase_block + i);
+        if (status != 0) {
+            goto out;
+        }
+
+        n_updated++;
+    }
+
+    log_info("Updated %u of %u erase block%s starting at block %u\n",
+             n_updated, count, 1 == count ? "" : "s", erase_block);
+
+out:
+    free(current);
+    return status;
+}
@@ -96,4 +96,25 @@ int spi_flash_write(struct bladerf *dev,
                     uint32_t page,
                     uint32_t count);
 
+/**
+ * Update a range of erase blocks so that they match `image`, only erasing and
+ * programming the blocks whose current contents differ.
+ *
+ * The region is read back first, and each block that needs to be rewritten is
+ * verified after programming.
+ *
+ * @param       dev             Device handle
+ * @param[in]   image           New contents of the region. Must be `count` *
+ *                              erase-block-size bytes.
+ * @param[in]   erase_block     Erase block to start at
+ * @param[in]   count           Number of erase blocks
+ *
+ * @return 0 on success, or BLADERF_ERR_INVAL on an invalid `erase_block` or
+ * `count` value, or a value from \ref RETCODES list on other failures.
+ */
+int spi_flash_write_diff(struct bladerf *dev,
+                         const uint8_t *image,
+                         uint32_t erase_block,
+                         uint32_t count);
+
 #endif
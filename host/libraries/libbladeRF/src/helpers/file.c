@@ -28,6 +28,10 @@
 #include <limits.h>
 #include <errno.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include <libbladeRF.h>
 
 #include "host_config.h"
@@ -110,6 +114,94 @@ out:
     return rv;
 }
 
+static bool is_gzip(const uint8_t *buf, size_t len)
+{
+    return len >= 18 && buf[0] == 0x1f && buf[1] == 0x8b;
+}
+
+#ifdef HAVE_ZLIB
+/* Inflate a gzip-compressed buffer into a newly allocated buffer */
+static int gunzip_buffer(const uint8_t *in,
+                         size_t in_len,
+                         uint8_t **out_ret,
+                         size_t *out_len_ret)
+{
+    z_stream strm;
+    uint8_t *out = NULL;
+    size_t out_len;
+    int zstatus;
+    int status = 0;
+
+    /* The gzip trailer holds the uncompressed length, modulo 2^32. Use it as
+     * a starting point, and grow the buffer if it turns out to be short. */
+    out_len = (size_t)in[in_len - 4] | ((size_t)in[in_len - 3] << 8) |
+              ((size_t)in[in_len - 2] << 16) | ((size_t)in[in_len - 1] << 24);
+
+    if (out_len == 0) {
+        out_len = in_len * 4;
+    }
+
+    out = malloc(out_len);
+    if (out == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    memset(&strm, 0, sizeof(strm));
+
+    /* 16 + MAX_WBITS: expect a gzip header and trailer */
+    if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+        free(out);
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    strm.next_in  = (Bytef *)in;
+    strm.avail_in = (uInt)in_len;
+
+    do {
+        if (strm.total_out == out_len) {
+            uint8_t *tmp = realloc(out, out_len * 2);
+            if (tmp == NULL) {
+                status = BLADERF_ERR_MEM;
+                break;
+            }
+
+            out = tmp;
+            out_len *= 2;
+        }
+
+        strm.next_out  = out + strm.total_out;
+        strm.avail_out = (uInt)(out_len - strm.total_out);
+
+        zstatus = inflate(&strm, Z_NO_FLUSH);
+        if (zstatus != Z_OK && zstatus != Z_STREAM_END) {
+            log_debug("%s: inflate failed: %s\n", __FUNCTION__,
+                      strm.msg ? strm.msg : "unknown error");
+            status = BLADERF_ERR_INVAL;
+        }
+    } while (status == 0 && zstatus != Z_STREAM_END);
+
+    if (status == 0) {
+        *out_ret     = out;
+        *out_len_ret = strm.total_out;
+    } else {
+        free(out);
+    }
+
+    inflateEnd(&strm);
+    return status;
+}
+#else
+static int gunzip_buffer(const uint8_t *in,
+                         size_t in_len,
+                         uint8_t **out_ret,
+                         size_t *out_len_ret)
+{
+    log_error("Compressed images are not supported by this build of "
+              "libbladeRF (built without zlib).\n");
+    return BLADERF_ERR_UNSUPPORTED;
+}
+#endif
+
 int file_read_buffer(const char *filename, uint8_t **buf_ret, size_t *size_ret)
 {
     int status = BLADERF_ERR_UNEXPECTED;
@@ -150,6 +242,24 @@ int file_read_buffer(const char *filename, uint8_t **buf_ret, size_t *size_ret)
         goto out;
     }
 
+    /* Transparently decompress gzip'd images */
+    if (is_gzip(buf, len)) {
+        uint8_t *raw;
+        size_t raw_len;
+
+        status = gunzip_buffer(buf, len, &raw, &raw_len);
+        if (status < 0) {
+            goto out;
+        }
+
+        log_verbose("Decompressed %s: %zd -> %zu bytes\n", filename, len,
+                    raw_len);
+
+        free(buf);
+        buf = raw;
+        len = (ssize_t)raw_len;
+    }
+
     *buf_ret  = buf;
     *size_ret = len;
     fclose(f);
@@ -164,6 +274,122 @@ out:
     return status;
 }
 
+#if BLADERF_OS_WINDOWS
+#include <windows.h>
+
+int file_map(const char *filename, struct file_mapping *map)
+{
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+    void *data;
+
+    memset(map, 0, sizeof(*map));
+
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        log_debug("%s: could not open %s\n", __FUNCTION__, filename);
+        return (GetLastError() == ERROR_FILE_NOT_FOUND) ? BLADERF_ERR_NO_FILE
+                                                        : BLADERF_ERR_IO;
+    }
+
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return BLADERF_ERR_IO;
+    }
+
+    mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return BLADERF_ERR_IO;
+    }
+
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return BLADERF_ERR_IO;
+    }
+
+    map->data   = (const uint8_t *)data;
+    map->size   = (size_t)size.QuadPart;
+    map->handle = mapping;
+
+    return 0;
+}
+
+void file_unmap(struct file_mapping *map)
+{
+    if (map->data != NULL) {
+        UnmapViewOfFile(map->data);
+        CloseHandle((HANDLE)map->handle);
+    }
+
+    memset(map, 0, sizeof(*map));
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int file_map(const char *filename, struct file_mapping *map)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    memset(map, 0, sizeof(*map));
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        log_debug("%s: could not open %s: %s\n", __FUNCTION__, filename,
+                  strerror(errno));
+        switch (errno) {
+            case ENOENT:
+                return BLADERF_ERR_NO_FILE;
+
+            case EACCES:
+                return BLADERF_ERR_PERMISSION;
+
+            default:
+                return BLADERF_ERR_IO;
+        }
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return BLADERF_ERR_IO;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        log_debug("%s: could not map %s: %s\n", __FUNCTION__, filename,
+                  strerror(errno));
+        return BLADERF_ERR_IO;
+    }
+
+    map->data = (const uint8_t *)data;
+    map->size = (size_t)st.st_size;
+
+    return 0;
+}
+
+void file_unmap(struct file_mapping *map)
+{
+    if (map->data != NULL) {
+        munmap((void *)map->data, map->size);
+    }
+
+    memset(map, 0, sizeof(*map));
+}
+#endif
+
+bool file_is_gzip(const uint8_t *buf, size_t len)
+{
+    return is_gzip(buf, len);
+}
+
 /* Remove the last entry in a path. This is used to strip the executable name
 * from a path to get the directory that the executable resides in. */
 static size_t strip_last_path_entry(char *buf, char dir_delim)
@@ -412,6 +638,26 @@ static inline size_t get_install_dir(char *buf, size_t max_len)
  * arbitrary, but "sufficiently" large max buffer size for paths */
 #define PATH_MAX_LEN    4096
 
+char *file_find_image(const char *filename)
+{
+    char *full_path = file_find(filename);
+
+#ifdef HAVE_ZLIB
+    if (full_path == NULL) {
+        const size_t len = strlen(filename) + sizeof(".gz");
+        char *gz_name    = malloc(len);
+
+        if (gz_name != NULL) {
+            snprintf(gz_name, len, "%s.gz", filename);
+            full_path = file_find(gz_name);
+            free(gz_name);
+        }
+    }
+#endif
+
+    return full_path;
+}
+
 char *file_find(const char *filename)
 {
     size_t i, max_len;
@@ -30,6 +30,7 @@
 #ifndef HELPERS_FILE_H_
 #define HELPERS_FILE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -39,6 +40,9 @@
  *
  * The caller is responsible for freeing the allocated buffer
  *
+ * If the file is gzip-compressed, its decompressed contents are returned. This
+ * requires libbladeRF to have been built with zlib support.
+ *
  * @param[in]   filename    File open
  * @param[out]  buf         Upon success, this will point to a heap-allocated
  *                          buffer containing the file contents
@@ -49,6 +53,44 @@
  */
 int file_read_buffer(const char *filename, uint8_t **buf, size_t *size);
 
+/**
+ * Read-only memory mapping of a file's contents
+ */
+struct file_mapping {
+    const uint8_t *data; /**< File contents */
+    size_t size;         /**< Size of the file, in bytes */
+    void *handle;        /**< Platform-specific mapping handle */
+};
+
+/**
+ * Map a file's contents into memory, read-only. Unlike file_read_buffer(),
+ * gzip-compressed files are not decompressed; see file_is_gzip().
+ *
+ * @param[in]   filename    File to map
+ * @param[out]  map         Upon success, describes the mapped contents. This
+ *                          must be released with file_unmap().
+ *
+ * @return 0 on success, negative BLADERF_ERR_* value on failure
+ */
+int file_map(const char *filename, struct file_mapping *map);
+
+/**
+ * Release a mapping created by file_map().
+ *
+ * @param[in]   map         Mapping to release
+ */
+void file_unmap(struct file_mapping *map);
+
+/**
+ * Test whether a buffer holds gzip-compressed data
+ *
+ * @param[in]   buf         Buffer
+ * @param[in]   len         Length of the buffer, in bytes
+ *
+ * @return true if the buffer begins with a gzip header
+ */
+bool file_is_gzip(const uint8_t *buf, size_t len);
+
 /**
  * Write to an open file stream.
  *
@@ -94,4 +136,15 @@ ssize_t file_size(FILE *f);
  */
 char *file_find(const char *filename);
 
+/**
+ * Search for the specified image file in bladeRF config directories, as per
+ * file_find(). If it is not found and compressed images are supported, a
+ * gzip-compressed copy (`filename` with ".gz" appended) is searched for.
+ *
+ * @param[in]   filename    File to search for
+ *
+ * @return Full path if the file is found, NULL otherwise.
+ */
+char *file_find_image(const char *filename);
+
 #endif
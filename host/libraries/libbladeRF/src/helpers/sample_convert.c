@@ -0,0 +1,1147 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Sample type conversion, byte swapping and statistics.
+ *
+ * Each operation is implemented by a set of kernels: a generic one, plus SSE2
+ * and AVX2 on x86 and NEON on AArch64 for the operations that benefit. SSE2
+ * and NEON are baseline features of the targets they are compiled for, while
+ * AVX2 kernels are compiled with a target attribute and only selected if the
+ * CPU supports them. All kernel sets produce identical conversions, and
+ * statistics that differ only by floating-point rounding.
+ *
+ * Conversions operate on the chain SC8 - SC16 - CF32 - CF64. Conversions
+ * between types that are not adjacent in the chain are performed in chunks,
+ * through the intermediate types.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libbladeRF.h>
+
+#include "helpers/sample_convert.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SAMPLE_SSE2 1
+
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define SAMPLE_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#define SAMPLE_AVX2 1
+#define TARGET_AVX2
+#endif
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SAMPLE_NEON 1
+#endif
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#define SC8_SCALE 128
+#define SC16_SCALE 2048
+
+/* Samples per chunk when converting through intermediate types or computing
+ * statistics of SC8 samples */
+#define CHUNK_SAMPLES 512
+
+/* Samples whose floating-point statistics are accumulated in single precision
+ * before being added to the double precision totals */
+#define F32_STATS_BLOCK 1024
+
+/* Integer statistics are accumulated exactly */
+struct int_stats {
+    int64_t sum_i;
+    int64_t sum_q;
+    uint64_t sum_power;
+    uint32_t peak_power;
+};
+
+struct float_stats {
+    double sum_i;
+    double sum_q;
+    double sum_power;
+    double peak_power;
+};
+
+/* Conversion kernels operate on `n` values, i.e., twice the number of
+ * samples. Statistics kernels operate on `num_samples` samples, adding to the
+ * totals in `s`. */
+struct sample_kernels {
+    const char *name;
+
+    void (*sc8_to_sc16)(const int8_t *in, int16_t *out, size_t n);
+    void (*sc16_to_sc8)(const int16_t *in, int8_t *out, size_t n);
+    void (*sc16_to_cf32)(const int16_t *in, float *out, size_t n);
+    void (*cf32_to_sc16)(const float *in, int16_t *out, size_t n);
+    void (*cf32_to_cf64)(const float *in, double *out, size_t n);
+    void (*cf64_to_cf32)(const double *in, float *out, size_t n);
+
+    void (*swap16)(uint16_t *x, size_t n);
+
+    void (*stats_sc16)(const int16_t *x,
+                       size_t num_samples,
+                       struct int_stats *s);
+    void (*stats_cf32)(const float *x,
+                       size_t num_samples,
+                       struct float_stats *s);
+};
+
+/******************************************************************************
+ * Generic kernels
+ ******************************************************************************/
+
+static void sc8_to_sc16_generic(const int8_t *in, int16_t *out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = (int16_t)(in[i] * (SC16_SCALE / SC8_SCALE));
+    }
+}
+
+static inline int8_t sc16_to_sc8_one(int16_t x)
+{
+    /* Divide by 16, rounding to nearest with ties to even */
+    const int v = (x + 7 + ((x >> 4) & 1)) >> 4;
+
+    if (v > INT8_MAX) {
+        return INT8_MAX;
+    } else if (v < INT8_MIN) {
+        return INT8_MIN;
+    }
+
+    return (int8_t)v;
+}
+
+static void sc16_to_sc8_generic(const int16_t *in, int8_t *out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = sc16_to_sc8_one(in[i]);
+    }
+}
+
+static void sc16_to_cf32_generic(const int16_t *in, float *out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = in[i] * (1.0f / SC16_SCALE);
+    }
+}
+
+static inline int16_t cf32_to_sc16_one(float x)
+{
+    float v = x * SC16_SCALE;
+
+    /* Saturate before rounding, as the SIMD kernels do. This maps NaN to the
+     * negative limit, which keeps all kernel sets consistent. */
+    if (!(v >= -SC16_SCALE)) {
+        v = -SC16_SCALE;
+    } else if (v > SC16_SCALE - 1) {
+        v = SC16_SCALE - 1;
+    }
+
+    /* Round to nearest, ties to even, in the default rounding mode */
+    return (int16_t)lrintf(v);
+}
+
+static void cf32_to_sc16_generic(const float *in, int16_t *out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = cf32_to_sc16_one(in[i]);
+    }
+}
+
+static void cf32_to_cf64_generic(const float *in, double *out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = in[i];
+    }
+}
+
+static void cf64_to_cf32_generic(const double *in, float *out, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = (float)in[i];
+    }
+}
+
+static void swap16_generic(uint16_t *x, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = (uint16_t)((x[i] << 8) | (x[i] >> 8));
+    }
+}
+
+static void swap32(uint32_t *x, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        const uint32_t v = x[i];
+        x[i] = (v << 24) | ((v << 8) & 0x00ff0000) | ((v >> 8) & 0x0000ff00) |
+               (v >> 24);
+    }
+}
+
+static void swap64(uint64_t *x, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        const uint64_t v = x[i];
+        uint32_t hi      = (uint32_t)(v >> 32);
+        uint32_t lo      = (uint32_t)v;
+
+        swap32(&hi, 1);
+        swap32(&lo, 1);
+        x[i] = ((uint64_t)lo << 32) | hi;
+    }
+}
+
+static void stats_sc16_generic(const int16_t *x,
+                               size_t num_samples,
+                               struct int_stats *s)
+{
+    size_t i;
+
+    for (i = 0; i < num_samples; i++) {
+        const int32_t re     = x[2 * i];
+        const int32_t im     = x[2 * i + 1];
+        const uint32_t power = (uint32_t)(re * re) + (uint32_t)(im * im);
+
+        s->sum_i += re;
+        s->sum_q += im;
+        s->sum_power += power;
+        if (power > s->peak_power) {
+            s->peak_power = power;
+        }
+    }
+}
+
+static void stats_cf32_generic(const float *x,
+                               size_t num_samples,
+                               struct float_stats *s)
+{
+    size_t i;
+
+    for (i = 0; i < num_samples; i++) {
+        const double re    = x[2 * i];
+        const double im    = x[2 * i + 1];
+        const double power = re * re + im * im;
+
+        s->sum_i += re;
+        s->sum_q += im;
+        s->sum_power += power;
+        if (power > s->peak_power) {
+            s->peak_power = power;
+        }
+    }
+}
+
+static void stats_cf64(const double *x, size_t num_samples,
+                       struct float_stats *s)
+{
+    size_t i;
+
+    for (i = 0; i < num_samples; i++) {
+        const double re    = x[2 * i];
+        const double im    = x[2 * i + 1];
+        const double power = re * re + im * im;
+
+        s->sum_i += re;
+        s->sum_q += im;
+        s->sum_power += power;
+        if (power > s->peak_power) {
+            s->peak_power = power;
+        }
+    }
+}
+
+static const struct sample_kernels kernels_generic = {
+    "generic",
+    sc8_to_sc16_generic,
+    sc16_to_sc8_generic,
+    sc16_to_cf32_generic,
+    cf32_to_sc16_generic,
+    cf32_to_cf64_generic,
+    cf64_to_cf32_generic,
+    swap16_generic,
+    stats_sc16_generic,
+    stats_cf32_generic,
+};
+
+/******************************************************************************
+ * SSE2 kernels
+ ******************************************************************************/
+
+#if defined(SAMPLE_SSE2)
+
+static void sc8_to_sc16_sse2(const int8_t *in, int16_t *out, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i           = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)&in[i]);
+
+        /* Placing each byte in the upper half of a 16-bit lane multiplies it
+         * by 256, so an arithmetic shift by 4 leaves it multiplied by 16 */
+        const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(zero, v), 4);
+        const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(zero, v), 4);
+
+        _mm_storeu_si128((__m128i *)&out[i], lo);
+        _mm_storeu_si128((__m128i *)&out[i + 8], hi);
+    }
+
+    sc8_to_sc16_generic(&in[i], &out[i], n - i);
+}
+
+static inline __m128i sc16_to_sc8_round_sse2(__m128i x)
+{
+    const __m128i one   = _mm_set1_epi16(1);
+    const __m128i seven = _mm_set1_epi16(7);
+    const __m128i odd   = _mm_and_si128(_mm_srai_epi16(x, 4), one);
+
+    /* Saturating adds only affect values that saturate in the output */
+    const __m128i v = _mm_adds_epi16(_mm_adds_epi16(x, seven), odd);
+
+    return _mm_srai_epi16(v, 4);
+}
+
+static void sc16_to_sc8_sse2(const int16_t *in, int8_t *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)&in[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *)&in[i + 8]);
+
+        _mm_storeu_si128((__m128i *)&out[i],
+                         _mm_packs_epi16(sc16_to_sc8_round_sse2(a),
+                                         sc16_to_sc8_round_sse2(b)));
+    }
+
+    sc16_to_sc8_generic(&in[i], &out[i], n - i);
+}
+
+static void sc16_to_cf32_sse2(const int16_t *in, float *out, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / SC16_SCALE);
+    size_t i           = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v  = _mm_loadu_si128((const __m128i *)&in[i]);
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+        _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+
+    sc16_to_cf32_generic(&in[i], &out[i], n - i);
+}
+
+/* Scale and saturate. _mm_max_ps() returns its second operand if either is
+ * NaN, so NaN saturates to the negative limit. */
+static inline __m128i cf32_to_sc16_round_sse2(__m128 x)
+{
+    const __m128 scale = _mm_set1_ps((float)SC16_SCALE);
+    const __m128 min   = _mm_set1_ps((float)-SC16_SCALE);
+    const __m128 max   = _mm_set1_ps((float)(SC16_SCALE - 1));
+
+    x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scale), min), max);
+
+    return _mm_cvtps_epi32(x);
+}
+
+static void cf32_to_sc16_sse2(const float *in, int16_t *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = cf32_to_sc16_round_sse2(_mm_loadu_ps(&in[i]));
+        const __m128i b = cf32_to_sc16_round_sse2(_mm_loadu_ps(&in[i + 4]));
+
+        _mm_storeu_si128((__m128i *)&out[i], _mm_packs_epi32(a, b));
+    }
+
+    cf32_to_sc16_generic(&in[i], &out[i], n - i);
+}
+
+static void cf32_to_cf64_sse2(const float *in, double *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_loadu_ps(&in[i]);
+
+        _mm_storeu_pd(&out[i], _mm_cvtps_pd(v));
+        _mm_storeu_pd(&out[i + 2], _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+
+    cf32_to_cf64_generic(&in[i], &out[i], n - i);
+}
+
+static void cf64_to_cf32_sse2(const double *in, float *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(&in[i]));
+        const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(&in[i + 2]));
+
+        _mm_storeu_ps(&out[i], _mm_movelh_ps(lo, hi));
+    }
+
+    cf64_to_cf32_generic(&in[i], &out[i], n - i);
+}
+
+static void swap16_sse2(uint16_t *x, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)&x[i]);
+
+        _mm_storeu_si128((__m128i *)&x[i], _mm_or_si128(_mm_slli_epi16(v, 8),
+                                                        _mm_srli_epi16(v, 8)));
+    }
+
+    swap16_generic(&x[i], n - i);
+}
+
+static inline int64_t hsum_epi32_sse2(__m128i v)
+{
+    int32_t lanes[4];
+
+    _mm_storeu_si128((__m128i *)lanes, v);
+    return (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+/* Sample vectors summed in 32-bit lanes before being flushed to 64-bit
+ * totals. Each lane grows by at most 2^15 per vector. */
+#define SC16_STATS_BLOCK 32768
+
+static void stats_sc16_sse2(const int16_t *x,
+                            size_t num_samples,
+                            struct int_stats *s)
+{
+    const __m128i sel_i = _mm_set1_epi32(0x00000001);
+    const __m128i sel_q = _mm_set1_epi32(0x00010000);
+    const __m128i sign  = _mm_set1_epi32((int)0x80000000);
+    const __m128i zero  = _mm_setzero_si128();
+
+    /* The peak is tracked with the sign bit flipped, so that a signed
+     * comparison orders the unsigned powers */
+    __m128i peak   = sign;
+    __m128i sum_pw = zero;
+    uint64_t pw[2];
+    uint32_t pk[4];
+    size_t i = 0;
+    size_t j;
+
+    while (i + 4 <= num_samples) {
+        size_t end    = num_samples - (num_samples - i) % 4;
+        __m128i sum_i = zero;
+        __m128i sum_q = zero;
+
+        if (end - i > 4 * SC16_STATS_BLOCK) {
+            end = i + 4 * SC16_STATS_BLOCK;
+        }
+
+        for (; i < end; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i *)&x[2 * i]);
+
+            /* I^2 + Q^2 of each sample, which is at most 2^31 and is treated
+             * as unsigned */
+            const __m128i power = _mm_madd_epi16(v, v);
+            const __m128i flip  = _mm_xor_si128(power, sign);
+            const __m128i gt    = _mm_cmpgt_epi32(flip, peak);
+
+            sum_i = _mm_add_epi32(sum_i, _mm_madd_epi16(v, sel_i));
+            sum_q = _mm_add_epi32(sum_q, _mm_madd_epi16(v, sel_q));
+
+            sum_pw = _mm_add_epi64(sum_pw, _mm_unpacklo_epi32(power, zero));
+            sum_pw = _mm_add_epi64(sum_pw, _mm_unpackhi_epi32(power, zero));
+
+            peak = _mm_or_si128(_mm_and_si128(gt, flip),
+                                _mm_andnot_si128(gt, peak));
+        }
+
+        s->sum_i += hsum_epi32_sse2(sum_i);
+        s->sum_q += hsum_epi32_sse2(sum_q);
+    }
+
+    _mm_storeu_si128((__m128i *)pw, sum_pw);
+    s->sum_power += pw[0] + pw[1];
+
+    _mm_storeu_si128((__m128i *)pk, _mm_xor_si128(peak, sign));
+    for (j = 0; j < 4; j++) {
+        if (pk[j] > s->peak_power) {
+            s->peak_power = pk[j];
+        }
+    }
+
+    stats_sc16_generic(&x[2 * i], num_samples - i, s);
+}
+
+static inline double hsum_ps_sse2(__m128 v)
+{
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, v);
+    return (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+static void stats_cf32_sse2(const float *x,
+                            size_t num_samples,
+                            struct float_stats *s)
+{
+    __m128 peak = _mm_setzero_ps();
+    float pk[4];
+    size_t i = 0;
+    size_t j;
+
+    while (i + 2 <= num_samples) {
+        size_t end    = num_samples - (num_samples - i) % 2;
+        __m128 sum    = _mm_setzero_ps();
+        __m128 sum_pw = _mm_setzero_ps();
+        float lanes[4];
+
+        if (end - i > F32_STATS_BLOCK) {
+            end = i + F32_STATS_BLOCK;
+        }
+
+        for (; i < end; i += 2) {
+            const __m128 v  = _mm_loadu_ps(&x[2 * i]);
+            const __m128 sq = _mm_mul_ps(v, v);
+
+            /* I^2 + Q^2 of each sample, in both of its lanes */
+            const __m128 power =
+                _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+
+            sum    = _mm_add_ps(sum, v);
+            sum_pw = _mm_add_ps(sum_pw, sq);
+            peak   = _mm_max_ps(peak, power);
+        }
+
+        _mm_storeu_ps(lanes, sum);
+        s->sum_i += (double)lanes[0] + lanes[2];
+        s->sum_q += (double)lanes[1] + lanes[3];
+        s->sum_power += hsum_ps_sse2(sum_pw);
+    }
+
+    _mm_storeu_ps(pk, peak);
+    for (j = 0; j < 4; j++) {
+        if (pk[j] > s->peak_power) {
+            s->peak_power = pk[j];
+        }
+    }
+
+    stats_cf32_generic(&x[2 * i], num_samples - i, s);
+}
+
+static const struct sample_kernels kernels_sse2 = {
+    "sse2",
+    sc8_to_sc16_sse2,
+    sc16_to_sc8_sse2,
+    sc16_to_cf32_sse2,
+    cf32_to_sc16_sse2,
+    cf32_to_cf64_sse2,
+    cf64_to_cf32_sse2,
+    swap16_sse2,
+    stats_sc16_sse2,
+    stats_cf32_sse2,
+};
+
+#endif
+
+/******************************************************************************
+ * AVX2 kernels
+ *
+ * Only the SC16 <-> CF32 conversions, which dominate streaming workloads, have
+ * AVX2 implementations. The remaining kernels are those of SSE2.
+ ******************************************************************************/
+
+#if defined(SAMPLE_AVX2)
+
+TARGET_AVX2
+static void sc16_to_cf32_avx2(const int16_t *in, float *out, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / SC16_SCALE);
+    size_t i           = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)&in[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *)&in[i + 8]);
+        const __m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a));
+        const __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+
+        _mm256_storeu_ps(&out[i], _mm256_mul_ps(fa, scale));
+        _mm256_storeu_ps(&out[i + 8], _mm256_mul_ps(fb, scale));
+    }
+
+    sc16_to_cf32_sse2(&in[i], &out[i], n - i);
+}
+
+TARGET_AVX2
+static void cf32_to_sc16_avx2(const float *in, int16_t *out, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps((float)SC16_SCALE);
+    const __m256 min   = _mm256_set1_ps((float)-SC16_SCALE);
+    const __m256 max   = _mm256_set1_ps((float)(SC16_SCALE - 1));
+    size_t i           = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(&in[i]), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(&in[i + 8]), scale);
+        __m256i packed;
+
+        /* As with SSE2, max() maps NaN to its second operand */
+        a = _mm256_min_ps(_mm256_max_ps(a, min), max);
+        b = _mm256_min_ps(_mm256_max_ps(b, min), max);
+
+        /* The pack operates within 128-bit lanes, so restore the order of
+         * its 64-bit quarters afterwards */
+        packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a),
+                                    _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm256_storeu_si256((__m256i *)&out[i], packed);
+    }
+
+    cf32_to_sc16_sse2(&in[i], &out[i], n - i);
+}
+
+static const struct sample_kernels kernels_avx2 = {
+    "avx2",
+    sc8_to_sc16_sse2,
+    sc16_to_sc8_sse2,
+    sc16_to_cf32_avx2,
+    cf32_to_sc16_avx2,
+    cf32_to_cf64_sse2,
+    cf64_to_cf32_sse2,
+    swap16_sse2,
+    stats_sc16_sse2,
+    stats_cf32_sse2,
+};
+
+static bool cpu_has_avx2(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+
+    /* AVX2 also requires the OS to save the YMM registers */
+    __cpuid(regs, 1);
+    if ((regs[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+/******************************************************************************
+ * NEON kernels
+ ******************************************************************************/
+
+#if defined(SAMPLE_NEON)
+
+static void sc8_to_sc16_neon(const int8_t *in, int16_t *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const int8x16_t v = vld1q_s8(&in[i]);
+
+        vst1q_s16(&out[i], vshlq_n_s16(vmovl_s8(vget_low_s8(v)), 4));
+        vst1q_s16(&out[i + 8], vshlq_n_s16(vmovl_s8(vget_high_s8(v)), 4));
+    }
+
+    sc8_to_sc16_generic(&in[i], &out[i], n - i);
+}
+
+static inline int8x8_t sc16_to_sc8_round_neon(int16x8_t x)
+{
+    const int16x8_t odd = vandq_s16(vshrq_n_s16(x, 4), vdupq_n_s16(1));
+    const int16x8_t v   = vqaddq_s16(vqaddq_s16(x, vdupq_n_s16(7)), odd);
+
+    return vqmovn_s16(vshrq_n_s16(v, 4));
+}
+
+static void sc16_to_sc8_neon(const int16_t *in, int8_t *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const int8x8_t a = sc16_to_sc8_round_neon(vld1q_s16(&in[i]));
+        const int8x8_t b = sc16_to_sc8_round_neon(vld1q_s16(&in[i + 8]));
+
+        vst1q_s8(&out[i], vcombine_s8(a, b));
+    }
+
+    sc16_to_sc8_generic(&in[i], &out[i], n - i);
+}
+
+static void sc16_to_cf32_neon(const int16_t *in, float *out, size_t n)
+{
+    const float32x4_t scale = vdupq_n_f32(1.0f / SC16_SCALE);
+    size_t i                = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t v  = vld1q_s16(&in[i]);
+        const int32x4_t lo = vmovl_s16(vget_low_s16(v));
+        const int32x4_t hi = vmovl_s16(vget_high_s16(v));
+
+        vst1q_f32(&out[i], vmulq_f32(vcvtq_f32_s32(lo), scale));
+        vst1q_f32(&out[i + 4], vmulq_f32(vcvtq_f32_s32(hi), scale));
+    }
+
+    sc16_to_cf32_generic(&in[i], &out[i], n - i);
+}
+
+/* vmaxnmq_f32() returns the number if one operand is NaN, so NaN saturates to
+ * the negative limit as in the other kernel sets */
+static inline int16x4_t cf32_to_sc16_round_neon(float32x4_t x)
+{
+    x = vmulq_f32(x, vdupq_n_f32((float)SC16_SCALE));
+    x = vmaxnmq_f32(x, vdupq_n_f32((float)-SC16_SCALE));
+    x = vminq_f32(x, vdupq_n_f32((float)(SC16_SCALE - 1)));
+
+    return vmovn_s32(vcvtnq_s32_f32(x));
+}
+
+static void cf32_to_sc16_neon(const float *in, int16_t *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const int16x4_t a = cf32_to_sc16_round_neon(vld1q_f32(&in[i]));
+        const int16x4_t b = cf32_to_sc16_round_neon(vld1q_f32(&in[i + 4]));
+
+        vst1q_s16(&out[i], vcombine_s16(a, b));
+    }
+
+    cf32_to_sc16_generic(&in[i], &out[i], n - i);
+}
+
+static void cf32_to_cf64_neon(const float *in, double *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t v = vld1q_f32(&in[i]);
+
+        vst1q_f64(&out[i], vcvt_f64_f32(vget_low_f32(v)));
+        vst1q_f64(&out[i + 2], vcvt_high_f64_f32(v));
+    }
+
+    cf32_to_cf64_generic(&in[i], &out[i], n - i);
+}
+
+static void cf64_to_cf32_neon(const double *in, float *out, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const float32x2_t lo = vcvt_f32_f64(vld1q_f64(&in[i]));
+
+        vst1q_f32(&out[i], vcvt_high_f32_f64(lo, vld1q_f64(&in[i + 2])));
+    }
+
+    cf64_to_cf32_generic(&in[i], &out[i], n - i);
+}
+
+static void swap16_neon(uint16_t *x, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const uint8x16_t v = vreinterpretq_u8_u16(vld1q_u16(&x[i]));
+
+        vst1q_u16(&x[i], vreinterpretq_u16_u8(vrev16q_u8(v)));
+    }
+
+    swap16_generic(&x[i], n - i);
+}
+
+static const struct sample_kernels kernels_neon = {
+    "neon",
+    sc8_to_sc16_neon,
+    sc16_to_sc8_neon,
+    sc16_to_cf32_neon,
+    cf32_to_sc16_neon,
+    cf32_to_cf64_neon,
+    cf64_to_cf32_neon,
+    swap16_neon,
+    stats_sc16_generic,
+    stats_cf32_generic,
+};
+
+#endif
+
+/******************************************************************************
+ * Kernel selection
+ ******************************************************************************/
+
+/* Selected on first use, or by sample_kernels_select(). As this may happen
+ * while other threads are converting samples, it is only accessed via
+ * kernels_load() and kernels_store(). Racing first uses select the same
+ * kernels. */
+static const struct sample_kernels *active_kernels = NULL;
+
+static const struct sample_kernels *kernels_load(void)
+{
+#if defined(_MSC_VER)
+    return (const struct sample_kernels *)InterlockedCompareExchangePointer(
+        (PVOID volatile *)&active_kernels, NULL, NULL);
+#else
+    return __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void kernels_store(const struct sample_kernels *k)
+{
+#if defined(_MSC_VER)
+    InterlockedExchangePointer((PVOID volatile *)&active_kernels, (PVOID)k);
+#else
+    __atomic_store_n(&active_kernels, k, __ATOMIC_RELEASE);
+#endif
+}
+
+static const struct sample_kernels *best_kernels(void)
+{
+#if defined(SAMPLE_AVX2)
+    if (cpu_has_avx2()) {
+        return &kernels_avx2;
+    }
+#endif
+
+#if defined(SAMPLE_SSE2)
+    return &kernels_sse2;
+#elif defined(SAMPLE_NEON)
+    return &kernels_neon;
+#else
+    return &kernels_generic;
+#endif
+}
+
+static const struct sample_kernels *get_kernels(void)
+{
+    const struct sample_kernels *k = kernels_load();
+
+    if (k == NULL) {
+        k = best_kernels();
+        kernels_store(k);
+    }
+
+    return k;
+}
+
+int sample_kernels_select(const char *name)
+{
+    if (name == NULL) {
+        kernels_store(best_kernels());
+        return 0;
+    }
+
+    if (strcmp(name, "generic") == 0) {
+        kernels_store(&kernels_generic);
+        return 0;
+    }
+
+    if (strcmp(name, "sse2") == 0) {
+#if defined(SAMPLE_SSE2)
+        kernels_store(&kernels_sse2);
+        return 0;
+#else
+        return BLADERF_ERR_UNSUPPORTED;
+#endif
+    }
+
+    if (strcmp(name, "avx2") == 0) {
+#if defined(SAMPLE_AVX2)
+        if (cpu_has_avx2()) {
+            kernels_store(&kernels_avx2);
+            return 0;
+        }
+#endif
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    if (strcmp(name, "neon") == 0) {
+#if defined(SAMPLE_NEON)
+        kernels_store(&kernels_neon);
+        return 0;
+#else
+        return BLADERF_ERR_UNSUPPORTED;
+#endif
+    }
+
+    return BLADERF_ERR_INVAL;
+}
+
+const char *sample_kernels_name(void)
+{
+    return get_kernels()->name;
+}
+
+/******************************************************************************
+ * Operations
+ ******************************************************************************/
+
+size_t sample_type_size(bladerf_sample_type type)
+{
+    switch (type) {
+        case BLADERF_SAMPLE_SC8:
+            return 2 * sizeof(int8_t);
+        case BLADERF_SAMPLE_SC16:
+            return 2 * sizeof(int16_t);
+        case BLADERF_SAMPLE_CF32:
+            return 2 * sizeof(float);
+        case BLADERF_SAMPLE_CF64:
+            return 2 * sizeof(double);
+    }
+
+    return 0;
+}
+
+/* Convert `n` values from `type` to the adjacent type `type + dir` */
+static void convert_step(const struct sample_kernels *k,
+                         bladerf_sample_type type,
+                         int dir,
+                         const void *in,
+                         void *out,
+                         size_t n)
+{
+    switch (type) {
+        case BLADERF_SAMPLE_SC8:
+            k->sc8_to_sc16(in, out, n);
+            break;
+
+        case BLADERF_SAMPLE_SC16:
+            if (dir > 0) {
+                k->sc16_to_cf32(in, out, n);
+            } else {
+                k->sc16_to_sc8(in, out, n);
+            }
+            break;
+
+        case BLADERF_SAMPLE_CF32:
+            if (dir > 0) {
+                k->cf32_to_cf64(in, out, n);
+            } else {
+                k->cf32_to_sc16(in, out, n);
+            }
+            break;
+
+        case BLADERF_SAMPLE_CF64:
+            k->cf64_to_cf32(in, out, n);
+            break;
+    }
+}
+
+int sample_convert(bladerf_sample_type in_type,
+                   const void *in,
+                   bladerf_sample_type out_type,
+                   void *out,
+                   size_t num_samples)
+{
+    const struct sample_kernels *k = get_kernels();
+    const size_t in_size           = sample_type_size(in_type);
+    const size_t out_size          = sample_type_size(out_type);
+    const int dir                  = (out_type > in_type) ? 1 : -1;
+
+    /* Intermediate results, sized for the largest type */
+    double tmp[2][2 * CHUNK_SAMPLES];
+    size_t i;
+
+    if (in_size == 0 || out_size == 0 || in == NULL || out == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (in_type == out_type) {
+        memmove(out, in, num_samples * in_size);
+        return 0;
+    }
+
+    if (in_type + dir == out_type) {
+        convert_step(k, in_type, dir, in, out, 2 * num_samples);
+        return 0;
+    }
+
+    for (i = 0; i < num_samples; i += CHUNK_SAMPLES) {
+        size_t count             = num_samples - i;
+        const void *src          = (const uint8_t *)in + i * in_size;
+        bladerf_sample_type type = in_type;
+        unsigned int t           = 0;
+
+        if (count > CHUNK_SAMPLES) {
+            count = CHUNK_SAMPLES;
+        }
+
+        while (type != out_type) {
+            void *dst;
+
+            if (type + dir == out_type) {
+                dst = (uint8_t *)out + i * out_size;
+            } else {
+                dst = tmp[t];
+                t ^= 1;
+            }
+
+            convert_step(k, type, dir, src, dst, 2 * count);
+
+            src  = dst;
+            type = (bladerf_sample_type)(type + dir);
+        }
+    }
+
+    return 0;
+}
+
+int sample_byteswap(bladerf_sample_type type, void *samples, size_t num_samples)
+{
+    if (samples == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    switch (type) {
+        case BLADERF_SAMPLE_SC8:
+            return 0;
+
+        case BLADERF_SAMPLE_SC16:
+            get_kernels()->swap16(samples, 2 * num_samples);
+            return 0;
+
+        case BLADERF_SAMPLE_CF32:
+            swap32(samples, 2 * num_samples);
+            return 0;
+
+        case BLADERF_SAMPLE_CF64:
+            swap64(samples, 2 * num_samples);
+            return 0;
+    }
+
+    return BLADERF_ERR_INVAL;
+}
+
+static void int_stats_to_stats(const struct int_stats *s,
+                               size_t num_samples,
+                               double scale,
+                               struct bladerf_sample_stats *stats)
+{
+    stats->mean_i     = (double)s->sum_i / num_samples / scale;
+    stats->mean_q     = (double)s->sum_q / num_samples / scale;
+    stats->power      = (double)s->sum_power / num_samples / (scale * scale);
+    stats->peak_power = (double)s->peak_power / (scale * scale);
+}
+
+static void float_stats_to_stats(const struct float_stats *s,
+                                 size_t num_samples,
+                                 struct bladerf_sample_stats *stats)
+{
+    stats->mean_i     = s->sum_i / num_samples;
+    stats->mean_q     = s->sum_q / num_samples;
+    stats->power      = s->sum_power / num_samples;
+    stats->peak_power = s->peak_power;
+}
+
+int sample_stats(bladerf_sample_type type,
+                 const void *samples,
+                 size_t num_samples,
+                 struct bladerf_sample_stats *stats)
+{
+    const struct sample_kernels *k = get_kernels();
+    struct int_stats is            = { 0, 0, 0, 0 };
+    struct float_stats fs          = { 0.0, 0.0, 0.0, 0.0 };
+
+    if (samples == NULL || num_samples == 0 || stats == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    switch (type) {
+        case BLADERF_SAMPLE_SC8: {
+            /* SC8 values are exact in SC16, scaled by 16 */
+            const int8_t *x = samples;
+            int16_t tmp[2 * CHUNK_SAMPLES];
+            size_t i;
+
+            for (i = 0; i < num_samples; i += CHUNK_SAMPLES) {
+                size_t count = num_samples - i;
+                if (count > CHUNK_SAMPLES) {
+                    count = CHUNK_SAMPLES;
+                }
+
+                k->sc8_to_sc16(&x[2 * i], tmp, 2 * count);
+                k->stats_sc16(tmp, count, &is);
+            }
+
+            int_stats_to_stats(&is, num_samples, SC16_SCALE, stats);
+            return 0;
+        }
+
+        case BLADERF_SAMPLE_SC16:
+            k->stats_sc16(samples, num_samples, &is);
+            int_stats_to_stats(&is, num_samples, SC16_SCALE, stats);
+            return 0;
+
+        case BLADERF_SAMPLE_CF32:
+            k->stats_cf32(samples, num_samples, &fs);
+            float_stats_to_stats(&fs, num_samples, stats);
+            return 0;
+
+        case BLADERF_SAMPLE_CF64:
+            stats_cf64(samples, num_samples, &fs);
+            float_stats_to_stats(&fs, num_samples, stats);
+            return 0;
+    }
+
+    return BLADERF_ERR_INVAL;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file sample_convert.h
+ *
+ * This file is not part of the API and may be changed at any time.
+ * If you're interfacing with libbladeRF, DO NOT use this file.
+ *
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef HELPERS_SAMPLE_CONVERT_H_
+#define HELPERS_SAMPLE_CONVERT_H_
+
+#include <stddef.h>
+
+#include <libbladeRF.h>
+
+/**
+ * @return Size of one sample of the specified type, in bytes, or 0 if the type
+ *         is invalid
+ */
+size_t sample_type_size(bladerf_sample_type type);
+
+/** @see bladerf_convert_samples() */
+int sample_convert(bladerf_sample_type in_type,
+                   const void *in,
+                   bladerf_sample_type out_type,
+                   void *out,
+                   size_t num_samples);
+
+/** @see bladerf_byteswap_samples() */
+int sample_byteswap(bladerf_sample_type type, void *samples, size_t num_samples);
+
+/** @see bladerf_get_sample_stats() */
+int sample_stats(bladerf_sample_type type,
+                 const void *samples,
+                 size_t num_samples,
+                 struct bladerf_sample_stats *stats);
+
+/** @see bladerf_set_sample_kernels() */
+int sample_kernels_select(const char *name);
+
+/** @see bladerf_get_sample_kernels() */
+const char *sample_kernels_name(void);
+
+#endif
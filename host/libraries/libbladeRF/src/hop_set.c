@@ -0,0 +1,284 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libbladeRF.h>
+
+#include "conversions.h"
+#include "log.h"
+#include "thread.h"
+
+#include "board/board.h"
+
+#include "hop_set.h"
+
+/* A profile may only be reused once as many hops have been scheduled since its
+ * last use as the FPGA's retune queue holds, so any retune still using the
+ * profile has been performed. This is the queue depth assumed for FPGAs that
+ * do not report it. */
+#define HOP_SET_MIN_REUSE_AGE 16
+
+struct hop {
+    bladerf_frequency frequency;
+    struct bladerf_quick_tune quick_tune;
+
+    bool resident;      /* quick_tune holds a profile for this frequency */
+    uint64_t last_used; /* Value of hop_set.num_scheduled at last use */
+};
+
+struct bladerf_hop_set {
+    struct bladerf *dev;
+    bladerf_channel ch;
+
+    struct hop *hops;
+    unsigned int num_hops;
+
+    uint64_t num_scheduled;
+};
+
+static int evict_lru(struct bladerf_hop_set *hs);
+
+/* Tune to a hop's frequency and store a profile for it, reusing the least
+ * recently scheduled hop's profile if evict is set and none are free. Must be
+ * called with the device lock held. */
+static int make_resident(struct bladerf_hop_set *hs, struct hop *hop,
+                         bool evict)
+{
+    struct bladerf *dev = hs->dev;
+    int status;
+
+    status = dev->board->set_frequency(dev, hs->ch, hop->frequency);
+    if (status != 0) {
+        return status;
+    }
+
+    status = dev->board->get_quick_tune(dev, hs->ch, &hop->quick_tune);
+    if (status == BLADERF_ERR_QUEUE_FULL && evict) {
+        status = evict_lru(hs);
+        if (status == 0) {
+            status = dev->board->get_quick_tune(dev, hs->ch, &hop->quick_tune);
+        }
+    }
+
+    if (status == 0) {
+        hop->resident = true;
+    }
+
+    return status;
+}
+
+/* Release the profile of the least recently scheduled hop, provided it has
+ * not been used recently enough to be pending in the retune queue. */
+static int evict_lru(struct bladerf_hop_set *hs)
+{
+    struct bladerf *dev = hs->dev;
+    struct hop *lru     = NULL;
+    unsigned int min_age;
+    unsigned int i;
+    int status;
+
+    min_age = dev->retune_queue[BLADERF_CHANNEL_IS_TX(hs->ch)].depth;
+    if (min_age == 0) {
+        min_age = HOP_SET_MIN_REUSE_AGE;
+    }
+
+    for (i = 0; i < hs->num_hops; i++) {
+        struct hop *hop = &hs->hops[i];
+        if (hop->resident && (lru == NULL || hop->last_used < lru->last_used)) {
+            lru = hop;
+        }
+    }
+
+    if (lru == NULL ||
+        (lru->last_used != 0 &&
+         hs->num_scheduled - lru->last_used < min_age)) {
+        log_debug("No hop set profile is old enough to reuse.\n");
+        return BLADERF_ERR_QUEUE_FULL;
+    }
+
+    log_verbose("Reusing the profile of %" BLADERF_PRIuFREQ " Hz\n",
+                lru->frequency);
+
+    status = dev->board->release_quick_tune(dev, hs->ch, &lru->quick_tune);
+    if (status == 0) {
+        lru->resident = false;
+    }
+
+    return status;
+}
+
+static void release_all(struct bladerf_hop_set *hs)
+{
+    struct bladerf *dev = hs->dev;
+    unsigned int i;
+
+    for (i = 0; i < hs->num_hops; i++) {
+        if (hs->hops[i].resident) {
+            dev->board->release_quick_tune(dev, hs->ch,
+                                           &hs->hops[i].quick_tune);
+            hs->hops[i].resident = false;
+        }
+    }
+}
+
+int bladerf_hop_set_create(struct bladerf *dev,
+                           bladerf_channel ch,
+                           const bladerf_frequency *frequencies,
+                           unsigned int num_frequencies,
+                           struct bladerf_hop_set **hop_set)
+{
+    struct bladerf_hop_set *hs;
+    bladerf_frequency orig_frequency;
+    unsigned int i;
+    int status;
+
+    if (frequencies == NULL || num_frequencies == 0 || hop_set == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    hs = calloc(1, sizeof(*hs));
+    if (hs == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    hs->hops = calloc(num_frequencies, sizeof(hs->hops[0]));
+    if (hs->hops == NULL) {
+        free(hs);
+        return BLADERF_ERR_MEM;
+    }
+
+    hs->dev      = dev;
+    hs->ch       = ch;
+    hs->num_hops = num_frequencies;
+
+    for (i = 0; i < num_frequencies; i++) {
+        hs->hops[i].frequency = frequencies[i];
+    }
+
+    MUTEX_LOCK(&dev->lock);
+
+    status = dev->board->get_frequency(dev, ch, &orig_frequency);
+    if (status != 0) {
+        goto out;
+    }
+
+    /* Precompute as many profiles as the device holds. The rest are created
+     * as they are scheduled. */
+    for (i = 0; i < num_frequencies; i++) {
+        status = make_resident(hs, &hs->hops[i], false);
+        if (status == BLADERF_ERR_QUEUE_FULL) {
+            log_debug("Hop set has %u of %u frequencies resident.\n", i,
+                      num_frequencies);
+            status = 0;
+            break;
+        } else if (status != 0) {
+            goto out;
+        }
+    }
+
+    status = dev->board->set_frequency(dev, ch, orig_frequency);
+
+out:
+    if (status != 0) {
+        release_all(hs);
+    }
+
+    MUTEX_UNLOCK(&dev->lock);
+
+    if (status != 0) {
+        free(hs->hops);
+        free(hs);
+    } else {
+        *hop_set = hs;
+    }
+
+    return status;
+}
+
+int bladerf_hop_set_schedule(struct bladerf_hop_set *hop_set,
+                             bladerf_timestamp timestamp,
+                             unsigned int index)
+{
+    struct bladerf *dev;
+    struct hop *hop;
+    int status = 0;
+
+    if (hop_set == NULL || index >= hop_set->num_hops) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    dev = hop_set->dev;
+    hop = &hop_set->hops[index];
+
+    MUTEX_LOCK(&dev->lock);
+
+    if (!hop->resident) {
+        log_debug("Creating a profile for %" BLADERF_PRIuFREQ " Hz, which "
+                  "retunes %s now.\n",
+                  hop->frequency, channel2str(hop_set->ch));
+
+        status = make_resident(hop_set, hop, true);
+    }
+
+    if (status == 0) {
+        status = dev->board->schedule_retune(dev, hop_set->ch, timestamp,
+                                             hop->frequency, &hop->quick_tune);
+    }
+
+    if (status == 0) {
+        hop->last_used = ++hop_set->num_scheduled;
+    }
+
+    MUTEX_UNLOCK(&dev->lock);
+
+    return status;
+}
+
+bool hop_set_is_resident(struct bladerf_hop_set *hop_set, unsigned int index)
+{
+    bool resident;
+
+    if (index >= hop_set->num_hops) {
+        return false;
+    }
+
+    MUTEX_LOCK(&hop_set->dev->lock);
+    resident = hop_set->hops[index].resident;
+    MUTEX_UNLOCK(&hop_set->dev->lock);
+
+    return resident;
+}
+
+void bladerf_hop_set_free(struct bladerf_hop_set *hop_set)
+{
+    if (hop_set == NULL) {
+        return;
+    }
+
+    MUTEX_LOCK(&hop_set->dev->lock);
+    release_all(hop_set);
+    MUTEX_UNLOCK(&hop_set->dev->lock);
+
+    free(hop_set->hops);
+    free(hop_set);
+}
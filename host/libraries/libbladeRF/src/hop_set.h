@@ -0,0 +1,41 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef HOP_SET_H_
+#define HOP_SET_H_
+
+#include <stdbool.h>
+
+#include <libbladeRF.h>
+
+/**
+ * Determine whether a hop set frequency has a profile on the device. If it
+ * does not, bladerf_hop_set_schedule() will retune the channel immediately in
+ * order to create one.
+ *
+ * @param[in]   hop_set     Hop set
+ * @param[in]   index       Index of the frequency in the hop set
+ *
+ * @return true if the frequency has a profile
+ */
+bool hop_set_is_resident(struct bladerf_hop_set *hop_set, unsigned int index);
+
+#endif
@@ -28,6 +28,7 @@
 #include <syslog.h>
 #endif
 #include "log.h"
+#include "devinfo.h"
 
 #if !defined(WIN32) && !defined(__CYGWIN__)
 #if !defined(__clang__) && !defined(__GNUC__)
@@ -88,6 +89,8 @@ void __init __bladerf_init(void)
 
     bladerf_log_set_verbosity(log_level);
     log_debug("libbladeRF %s: initializing\n", LIBBLADERF_VERSION);
+
+    devinfo_hotplug_init();
 }
 
 void __fini __bladerf_fini(void)
@@ -96,6 +99,9 @@ void __fini __bladerf_fini(void)
 
     bladerf_log_set_verbosity(log_level);
     log_debug("libbladeRF %s: deinitializing\n", LIBBLADERF_VERSION);
+
+    devinfo_hotplug_deinit();
+
     fflush(NULL);
 #if !defined(WIN32) && !defined(__CYGWIN__) && defined(LOG_SYSLOG_ENABLED)
     closelog();
@@ -0,0 +1,558 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* DC offset and IQ imbalance correction of SC16 Q11 samples.
+ *
+ * The correction y = M (x - dc) is folded into y = M x + o, with M in Q13 and
+ * o = -M dc, so that each output component is one multiply-accumulate of an
+ * interleaved (I, Q) pair with a row of M. The parameter limits keep every
+ * coefficient below 2.9 in magnitude, so the 32-bit accumulation cannot
+ * overflow for any 16-bit input.
+ *
+ * Either kernel yields the same results as the generic one: the sum is
+ * rounded half up by 13 bits, and limited to the 12-bit sample range.
+ *
+ * Tables of parameters may be loaded from the following binary format. All
+ * values are little-endian byte order.
+ *
+ * 0x0000 [uint16_t: Fixed value of 0x1ac2]
+ * 0x0002 [uint32_t: Reserved. Set to 0x00000000]
+ * 0x0006 [uint32_t: Table format version]
+ * 0x000a [uint32_t: Number of entries]
+ * 0x000e [Start of table entries]
+ *
+ * Where a table entry is:
+ *        [uint64_t: Frequency, in Hz]
+ *        [float:    DC offset of I]
+ *        [float:    DC offset of Q]
+ *        [float:    Gain of Q relative to I]
+ *        [float:    Phase error, in degrees]
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IQ_CORR_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IQ_CORR_NEON 1
+#endif
+
+#include "host_config.h"
+#include "thread.h"
+
+#include "iq_corr.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Fractional bits of the matrix coefficients */
+#define IQ_CORR_FRAC_BITS 13
+#define IQ_CORR_ONE (1 << IQ_CORR_FRAC_BITS)
+#define IQ_CORR_ROUND (1 << (IQ_CORR_FRAC_BITS - 1))
+
+/* Parameter limits */
+#define IQ_CORR_DC_MAX 2048.0f
+#define IQ_CORR_GAIN_MIN 0.5f
+#define IQ_CORR_GAIN_MAX 2.0f
+#define IQ_CORR_PHASE_MAX 45.0f
+
+/* Table format */
+#define IQ_CORR_TBL_MAGIC 0x1ac2
+#define IQ_CORR_TBL_VERSION 1
+#define IQ_CORR_TBL_META_SIZE 0x0e
+#define IQ_CORR_TBL_ENTRY_SIZE (sizeof(uint64_t) + 4 * sizeof(uint32_t))
+
+/* Output sample range */
+#define IQ_CORR_SAMPLE_MIN (-2048)
+#define IQ_CORR_SAMPLE_MAX 2047
+
+/* Coefficients of y = M x + o */
+struct iq_corr_coeffs {
+    int16_t m[2][2];
+    int32_t o[2];
+};
+
+struct iq_corr {
+    MUTEX lock;
+
+    /* Written under `lock`, but also read without it by iq_corr_enabled() */
+    volatile bool enabled;
+    struct bladerf_iq_correction params;
+    struct iq_corr_coeffs coeffs;
+
+    /* Frequency-indexed parameters, or NULL */
+    struct bladerf_iq_correction *table;
+    unsigned int table_len;
+};
+
+static const struct bladerf_iq_correction iq_corr_none = {
+    0, 0.0f, 0.0f, 1.0f, 0.0f
+};
+
+static bool params_valid(const struct bladerf_iq_correction *p)
+{
+    /* Written so that NaNs are rejected */
+    return fabsf(p->dc_i) <= IQ_CORR_DC_MAX &&
+           fabsf(p->dc_q) <= IQ_CORR_DC_MAX &&
+           p->gain >= IQ_CORR_GAIN_MIN && p->gain <= IQ_CORR_GAIN_MAX &&
+           fabsf(p->phase) <= IQ_CORR_PHASE_MAX;
+}
+
+/* The impaired quadrature component is Q' = gain (Q cos(phase) + I sin(phase)),
+ * which is undone by
+ *
+ *      [ 1                         0                      ]
+ *  M = [ -tan(phase)               1 / (gain cos(phase))  ]
+ */
+static void compute_coeffs(const struct bladerf_iq_correction *p,
+                           struct iq_corr_coeffs *c)
+{
+    const double phase = p->phase * M_PI / 180.0;
+    double m[2][2];
+    int r;
+
+    m[0][0] = 1.0;
+    m[0][1] = 0.0;
+    m[1][0] = -tan(phase);
+    m[1][1] = 1.0 / (p->gain * cos(phase));
+
+    for (r = 0; r < 2; r++) {
+        c->m[r][0] = (int16_t)lrint(m[r][0] * IQ_CORR_ONE);
+        c->m[r][1] = (int16_t)lrint(m[r][1] * IQ_CORR_ONE);
+        c->o[r]    = (int32_t)lrint(-(c->m[r][0] * (double)p->dc_i +
+                                      c->m[r][1] * (double)p->dc_q));
+    }
+}
+
+int iq_corr_create(struct iq_corr **corr_out)
+{
+    struct iq_corr *corr = calloc(1, sizeof(*corr));
+
+    if (corr == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    MUTEX_INIT(&corr->lock);
+    corr->params = iq_corr_none;
+    compute_coeffs(&corr->params, &corr->coeffs);
+
+    *corr_out = corr;
+    return 0;
+}
+
+int iq_corr_set(struct iq_corr *corr,
+                const struct bladerf_iq_correction *params)
+{
+    struct bladerf_iq_correction p = iq_corr_none;
+    struct iq_corr_coeffs coeffs;
+
+    if (params != NULL) {
+        if (!params_valid(params)) {
+            return BLADERF_ERR_INVAL;
+        }
+        p = *params;
+    }
+
+    p.frequency = 0;
+    compute_coeffs(&p, &coeffs);
+
+    MUTEX_LOCK(&corr->lock);
+    corr->enabled = (params != NULL);
+    corr->params  = p;
+    corr->coeffs  = coeffs;
+    MUTEX_UNLOCK(&corr->lock);
+
+    return 0;
+}
+
+void iq_corr_get(struct iq_corr *corr, struct bladerf_iq_correction *params)
+{
+    MUTEX_LOCK(&corr->lock);
+    *params = corr->params;
+    MUTEX_UNLOCK(&corr->lock);
+}
+
+int iq_corr_set_table(struct iq_corr *corr,
+                      const struct bladerf_iq_correction *entries,
+                      unsigned int num_entries)
+{
+    struct bladerf_iq_correction *table = NULL;
+    struct bladerf_iq_correction *old;
+    unsigned int i;
+
+    if (entries != NULL) {
+        if (num_entries == 0) {
+            return BLADERF_ERR_INVAL;
+        }
+
+        for (i = 0; i < num_entries; i++) {
+            if (!params_valid(&entries[i]) ||
+                (i > 0 && entries[i].frequency <= entries[i - 1].frequency)) {
+                return BLADERF_ERR_INVAL;
+            }
+        }
+
+        table = malloc(num_entries * sizeof(table[0]));
+        if (table == NULL) {
+            return BLADERF_ERR_MEM;
+        }
+
+        memcpy(table, entries, num_entries * sizeof(table[0]));
+    } else {
+        num_entries = 0;
+    }
+
+    MUTEX_LOCK(&corr->lock);
+    old             = corr->table;
+    corr->table     = table;
+    corr->table_len = num_entries;
+    MUTEX_UNLOCK(&corr->lock);
+
+    free(old);
+    return 0;
+}
+
+static float tbl_float(const uint8_t *buf)
+{
+    uint32_t bits;
+    float f;
+
+    memcpy(&bits, buf, sizeof(bits));
+    bits = LE32_TO_HOST(bits);
+    memcpy(&f, &bits, sizeof(f));
+
+    return f;
+}
+
+int iq_corr_load_table(struct iq_corr *corr,
+                       const uint8_t *buf,
+                       size_t buf_len)
+{
+    struct bladerf_iq_correction *entries;
+    uint16_t magic;
+    uint32_t version, n_entries, i;
+    int status;
+
+    if (buf_len < IQ_CORR_TBL_META_SIZE) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    memcpy(&magic, buf, sizeof(magic));
+    if (LE16_TO_HOST(magic) != IQ_CORR_TBL_MAGIC) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    /* The reserved bytes at 0x02 are ignored */
+    memcpy(&version, buf + 0x06, sizeof(version));
+    memcpy(&n_entries, buf + 0x0a, sizeof(n_entries));
+    version   = LE32_TO_HOST(version);
+    n_entries = LE32_TO_HOST(n_entries);
+
+    if (version != IQ_CORR_TBL_VERSION) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    if (n_entries == 0 || (buf_len - IQ_CORR_TBL_META_SIZE) /
+                                  IQ_CORR_TBL_ENTRY_SIZE < n_entries) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    entries = malloc(n_entries * sizeof(entries[0]));
+    if (entries == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    buf += IQ_CORR_TBL_META_SIZE;
+
+    for (i = 0; i < n_entries; i++) {
+        uint64_t freq;
+
+        memcpy(&freq, buf, sizeof(freq));
+        entries[i].frequency = LE64_TO_HOST(freq);
+        entries[i].dc_i      = tbl_float(buf + 8);
+        entries[i].dc_q      = tbl_float(buf + 12);
+        entries[i].gain      = tbl_float(buf + 16);
+        entries[i].phase     = tbl_float(buf + 20);
+
+        buf += IQ_CORR_TBL_ENTRY_SIZE;
+    }
+
+    /* Validates the entries */
+    status = iq_corr_set_table(corr, entries, n_entries);
+    free(entries);
+
+    return status;
+}
+
+void iq_corr_retune(struct iq_corr *corr, bladerf_frequency frequency)
+{
+    struct bladerf_iq_correction p;
+    struct iq_corr_coeffs coeffs;
+    const struct bladerf_iq_correction *lo, *hi;
+    unsigned int low, high;
+    float t;
+
+    MUTEX_LOCK(&corr->lock);
+
+    if (corr->table == NULL) {
+        MUTEX_UNLOCK(&corr->lock);
+        return;
+    }
+
+    /* Find the last entry at or below the frequency */
+    low  = 0;
+    high = corr->table_len;
+    while (high - low > 1) {
+        const unsigned int mid = low + (high - low) / 2;
+        if (corr->table[mid].frequency <= frequency) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    lo = &corr->table[low];
+    hi = (low + 1 < corr->table_len) ? &corr->table[low + 1] : lo;
+
+    if (frequency <= lo->frequency || hi == lo) {
+        p = *lo;
+    } else {
+        t = (float)(frequency - lo->frequency) /
+            (float)(hi->frequency - lo->frequency);
+
+        p.dc_i  = lo->dc_i + t * (hi->dc_i - lo->dc_i);
+        p.dc_q  = lo->dc_q + t * (hi->dc_q - lo->dc_q);
+        p.gain  = lo->gain + t * (hi->gain - lo->gain);
+        p.phase = lo->phase + t * (hi->phase - lo->phase);
+    }
+
+    p.frequency = frequency;
+    compute_coeffs(&p, &coeffs);
+
+    corr->enabled = true;
+    corr->params  = p;
+    corr->coeffs  = coeffs;
+
+    MUTEX_UNLOCK(&corr->lock);
+}
+
+static inline int16_t correct_one(const struct iq_corr_coeffs *c,
+                                  int r,
+                                  int32_t i,
+                                  int32_t q)
+{
+    int32_t v = c->m[r][0] * i + c->m[r][1] * q + c->o[r] + IQ_CORR_ROUND;
+
+    v >>= IQ_CORR_FRAC_BITS;
+
+    if (v < IQ_CORR_SAMPLE_MIN) {
+        v = IQ_CORR_SAMPLE_MIN;
+    } else if (v > IQ_CORR_SAMPLE_MAX) {
+        v = IQ_CORR_SAMPLE_MAX;
+    }
+
+    return (int16_t)v;
+}
+
+static void process_generic(const struct iq_corr_coeffs *c,
+                            int16_t *dst,
+                            const int16_t *src,
+                            size_t n)
+{
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        const int32_t i = src[2 * k];
+        const int32_t q = src[2 * k + 1];
+
+        dst[2 * k]     = correct_one(c, 0, i, q);
+        dst[2 * k + 1] = correct_one(c, 1, i, q);
+    }
+}
+
+#if defined(IQ_CORR_SSE2)
+/* Four samples per vector. Each (I, Q) pair is multiplied by a row of M and
+ * summed by pmaddwd, leaving the corrected I and Q of each sample in separate
+ * vectors to be interleaved again. */
+static size_t process_simd(const struct iq_corr_coeffs *c,
+                           int16_t *dst,
+                           const int16_t *src,
+                           size_t n)
+{
+    const __m128i row_i = _mm_set1_epi32((int32_t)(
+        (uint16_t)c->m[0][0] | ((uint32_t)(uint16_t)c->m[0][1] << 16)));
+    const __m128i row_q = _mm_set1_epi32((int32_t)(
+        (uint16_t)c->m[1][0] | ((uint32_t)(uint16_t)c->m[1][1] << 16)));
+    const __m128i off_i = _mm_set1_epi32(c->o[0] + IQ_CORR_ROUND);
+    const __m128i off_q = _mm_set1_epi32(c->o[1] + IQ_CORR_ROUND);
+    const __m128i lim_lo = _mm_set1_epi16(IQ_CORR_SAMPLE_MIN);
+    const __m128i lim_hi = _mm_set1_epi16(IQ_CORR_SAMPLE_MAX);
+    size_t k;
+
+    for (k = 0; k + 4 <= n; k += 4) {
+        const __m128i x = _mm_loadu_si128((const __m128i *)&src[2 * k]);
+        __m128i vi = _mm_add_epi32(_mm_madd_epi16(x, row_i), off_i);
+        __m128i vq = _mm_add_epi32(_mm_madd_epi16(x, row_q), off_q);
+        __m128i y;
+
+        vi = _mm_srai_epi32(vi, IQ_CORR_FRAC_BITS);
+        vq = _mm_srai_epi32(vq, IQ_CORR_FRAC_BITS);
+
+        y = _mm_packs_epi32(_mm_unpacklo_epi32(vi, vq),
+                            _mm_unpackhi_epi32(vi, vq));
+        y = _mm_min_epi16(_mm_max_epi16(y, lim_lo), lim_hi);
+
+        _mm_storeu_si128((__m128i *)&dst[2 * k], y);
+    }
+
+    return k;
+}
+#elif defined(IQ_CORR_NEON)
+/* Eight samples per iteration, deinterleaved into I and Q vectors on load */
+static size_t process_simd(const struct iq_corr_coeffs *c,
+                           int16_t *dst,
+                           const int16_t *src,
+                           size_t n)
+{
+    const int16x4_t m00 = vdup_n_s16(c->m[0][0]);
+    const int16x4_t m01 = vdup_n_s16(c->m[0][1]);
+    const int16x4_t m10 = vdup_n_s16(c->m[1][0]);
+    const int16x4_t m11 = vdup_n_s16(c->m[1][1]);
+    const int32x4_t off_i = vdupq_n_s32(c->o[0]);
+    const int32x4_t off_q = vdupq_n_s32(c->o[1]);
+    const int16x8_t lim_lo = vdupq_n_s16(IQ_CORR_SAMPLE_MIN);
+    const int16x8_t lim_hi = vdupq_n_s16(IQ_CORR_SAMPLE_MAX);
+    size_t k;
+
+    for (k = 0; k + 8 <= n; k += 8) {
+        const int16x8x2_t x = vld2q_s16(&src[2 * k]);
+        const int16x4_t i_lo = vget_low_s16(x.val[0]);
+        const int16x4_t i_hi = vget_high_s16(x.val[0]);
+        const int16x4_t q_lo = vget_low_s16(x.val[1]);
+        const int16x4_t q_hi = vget_high_s16(x.val[1]);
+        int32x4_t vi_lo, vi_hi, vq_lo, vq_hi;
+        int16x8x2_t y;
+
+        vi_lo = vmlal_s16(vmlal_s16(off_i, i_lo, m00), q_lo, m01);
+        vi_hi = vmlal_s16(vmlal_s16(off_i, i_hi, m00), q_hi, m01);
+        vq_lo = vmlal_s16(vmlal_s16(off_q, i_lo, m10), q_lo, m11);
+        vq_hi = vmlal_s16(vmlal_s16(off_q, i_hi, m10), q_hi, m11);
+
+        y.val[0] = vcombine_s16(vqrshrn_n_s32(vi_lo, IQ_CORR_FRAC_BITS),
+                                vqrshrn_n_s32(vi_hi, IQ_CORR_FRAC_BITS));
+        y.val[1] = vcombine_s16(vqrshrn_n_s32(vq_lo, IQ_CORR_FRAC_BITS),
+                                vqrshrn_n_s32(vq_hi, IQ_CORR_FRAC_BITS));
+
+        y.val[0] = vminq_s16(vmaxq_s16(y.val[0], lim_lo), lim_hi);
+        y.val[1] = vminq_s16(vmaxq_s16(y.val[1], lim_lo), lim_hi);
+
+        vst2q_s16(&dst[2 * k], y);
+    }
+
+    return k;
+}
+#else
+static size_t process_simd(const struct iq_corr_coeffs *c,
+                           int16_t *dst,
+                           const int16_t *src,
+                           size_t n)
+{
+    return 0;
+}
+#endif
+
+bool iq_corr_enabled(const struct iq_corr *corr)
+{
+    return corr->enabled;
+}
+
+/* Take a consistent copy of the coefficients */
+static bool snapshot(struct iq_corr *corr, struct iq_corr_coeffs *c)
+{
+    bool enabled;
+
+    MUTEX_LOCK(&corr->lock);
+    enabled = corr->enabled;
+    *c      = corr->coeffs;
+    MUTEX_UNLOCK(&corr->lock);
+
+    return enabled;
+}
+
+static void process(const struct iq_corr_coeffs *c,
+                    int16_t *dst,
+                    const int16_t *src,
+                    size_t n)
+{
+    const size_t k = process_simd(c, dst, src, n);
+    process_generic(c, dst + 2 * k, src + 2 * k, n - k);
+}
+
+void iq_corr_process(struct iq_corr *corr,
+                     int16_t *dst,
+                     const int16_t *src,
+                     size_t num_samples)
+{
+    struct iq_corr_coeffs c;
+
+    if (snapshot(corr, &c)) {
+        process(&c, dst, src, num_samples);
+    } else if (dst != src) {
+        memcpy(dst, src, num_samples * 2 * sizeof(int16_t));
+    }
+}
+
+void iq_corr_process_msgs(struct iq_corr *corr,
+                          void *buf,
+                          unsigned int num_msgs,
+                          size_t msg_size,
+                          size_t header_size,
+                          size_t samples_per_msg)
+{
+    struct iq_corr_coeffs c;
+    unsigned int i;
+
+    if (!snapshot(corr, &c)) {
+        return;
+    }
+
+    for (i = 0; i < num_msgs; i++) {
+        int16_t *samples =
+            (int16_t *)((uint8_t *)buf + i * msg_size + header_size);
+
+        process(&c, samples, samples, samples_per_msg);
+    }
+}
+
+void iq_corr_free(struct iq_corr *corr)
+{
+    if (corr != NULL) {
+        MUTEX_DESTROY(&corr->lock);
+        free(corr->table);
+        free(corr);
+    }
+}
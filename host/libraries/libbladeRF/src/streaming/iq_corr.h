@@ -0,0 +1,166 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef STREAMING_IQ_CORR_H_
+#define STREAMING_IQ_CORR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libbladeRF.h>
+
+/**
+ * DC offset and IQ imbalance correction applied to SC16 Q11 sync buffers.
+ *
+ * Each sample is corrected as `y = M (x - dc)`, where the 2x2 matrix M undoes
+ * the gain and phase imbalance. The same form pre-distorts TX samples, so
+ * that the imbalance and DC leakage of the transmitter cancel.
+ *
+ * The parameters may be changed while a stream is running. Each call to
+ * iq_corr_process() uses one consistent set of them.
+ */
+struct iq_corr;
+
+/**
+ * Create a correction stage, initially disabled
+ *
+ * @param[out]  corr    Created stage
+ *
+ * @return 0 on success, BLADERF_ERR_MEM on allocation failure
+ */
+int iq_corr_create(struct iq_corr **corr);
+
+/**
+ * Set the correction parameters
+ *
+ * @param       corr    Correction stage
+ * @param[in]   params  Parameters to apply, or NULL to disable the stage. The
+ *                      frequency field is ignored.
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for parameters out of range
+ */
+int iq_corr_set(struct iq_corr *corr,
+                const struct bladerf_iq_correction *params);
+
+/**
+ * Get the correction parameters in effect
+ *
+ * @param       corr    Correction stage
+ * @param[out]  params  Current parameters. These describe no correction if
+ *                      the stage is disabled.
+ */
+void iq_corr_get(struct iq_corr *corr, struct bladerf_iq_correction *params);
+
+/**
+ * Replace the frequency-indexed table of correction parameters
+ *
+ * @param       corr        Correction stage
+ * @param[in]   entries     Entries, in ascending order of frequency. NULL
+ *                          removes the table.
+ * @param[in]   num_entries Number of entries
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for unordered or invalid entries,
+ *         BLADERF_ERR_MEM on allocation failure
+ */
+int iq_corr_set_table(struct iq_corr *corr,
+                      const struct bladerf_iq_correction *entries,
+                      unsigned int num_entries);
+
+/**
+ * Replace the frequency-indexed table of correction parameters with one
+ * loaded from its packed binary form
+ *
+ * @param       corr        Correction stage
+ * @param[in]   buf         Packed table data
+ * @param[in]   buf_len     Length of packed data, in bytes
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for malformed data or invalid
+ *         entries, BLADERF_ERR_UNSUPPORTED for an unknown format version,
+ *         BLADERF_ERR_MEM on allocation failure
+ */
+int iq_corr_load_table(struct iq_corr *corr,
+                       const uint8_t *buf,
+                       size_t buf_len);
+
+/**
+ * Update the correction parameters from the table, for a new frequency.
+ *
+ * The parameters are linearly interpolated between the two nearest entries,
+ * and held at the first or last entry outside of the table's range. This does
+ * nothing if no table is loaded.
+ *
+ * @param       corr        Correction stage
+ * @param[in]   frequency   Frequency that has been tuned to
+ */
+void iq_corr_retune(struct iq_corr *corr, bladerf_frequency frequency);
+
+/**
+ * Check whether the stage currently applies a correction, without taking its
+ * lock. This allows callers to skip processing cheaply when it is disabled;
+ * a stage that is disabled concurrently still passes samples through
+ * unchanged.
+ *
+ * @param       corr        Correction stage
+ *
+ * @return true if fixed parameters or a table are in effect
+ */
+bool iq_corr_enabled(const struct iq_corr *corr);
+
+/**
+ * Correct SC16 Q11 samples. Outputs are limited to [-2048, 2047].
+ *
+ * @param       corr        Correction stage
+ * @param[out]  dst         Corrected samples. May be the same as `src`.
+ * @param[in]   src         Samples to correct
+ * @param[in]   num_samples Number of samples
+ */
+void iq_corr_process(struct iq_corr *corr,
+                     int16_t *dst,
+                     const int16_t *src,
+                     size_t num_samples);
+
+/**
+ * Correct, in place, the SC16 Q11 samples of a buffer of metadata messages
+ *
+ * @param       corr            Correction stage
+ * @param       buf             Buffer of messages
+ * @param[in]   num_msgs        Number of messages in the buffer
+ * @param[in]   msg_size        Size of each message, in bytes
+ * @param[in]   header_size     Size of the header preceding the samples of
+ *                              each message, in bytes
+ * @param[in]   samples_per_msg Number of samples in each message
+ */
+void iq_corr_process_msgs(struct iq_corr *corr,
+                          void *buf,
+                          unsigned int num_msgs,
+                          size_t msg_size,
+                          size_t header_size,
+                          size_t samples_per_msg);
+
+/**
+ * Free a correction stage
+ *
+ * @param       corr    Stage to free. May be NULL.
+ */
+void iq_corr_free(struct iq_corr *corr);
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Frequency shift and FIR decimation of received sync buffers.
+ *
+ * Each channel's samples are shifted by a numerically controlled oscillator
+ * into separate I and Q arrays, following the last num_taps - 1 samples of the
+ * previous buffer. Only every factor'th filter output is computed, as a dot
+ * product of the time-reversed taps with a contiguous window of each array,
+ * which uses SSE or NEON where available.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RX_DSP_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RX_DSP_NEON 1
+#endif
+
+#include "helpers/sample_convert.h"
+
+#include "rx_dsp.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Taps per unit of decimation in designed filters */
+#define RX_DSP_TAPS_PER_FACTOR 16
+
+/* Cutoff of designed filters, relative to the output Nyquist frequency */
+#define RX_DSP_CUTOFF 0.8
+
+struct rx_dsp_channel {
+    /* Shifted samples, preceded by the history of the previous buffer */
+    float *re;
+    float *im;
+
+    /* Offset of the oldest sample of the next output's window */
+    size_t next;
+};
+
+struct rx_dsp {
+    bladerf_sample_type type;
+    unsigned int num_channels;
+    size_t max_samples;
+    unsigned int factor;
+
+    /* Time-reversed taps, with leading zeros up to a multiple of 4 */
+    float *taps;
+    unsigned int num_taps;
+
+    /* Oscillator frequency and phase, in cycles per sample and cycles */
+    double shift;
+    double phase;
+
+    /* Oscillator values for one buffer of samples of one channel */
+    float *nco_re;
+    float *nco_im;
+
+    /* Interleaved input and output, as CF32 */
+    float *in;
+    float *out;
+
+    struct rx_dsp_channel ch[2];
+};
+
+/* Windowed-sinc low-pass filter with unity gain at DC */
+static void design_lowpass(float *taps, unsigned int num_taps,
+                           unsigned int factor)
+{
+    const double fc  = RX_DSP_CUTOFF * 0.5 / factor;
+    const double mid = (num_taps - 1) / 2.0;
+    double sum       = 0.0;
+    unsigned int i;
+
+    for (i = 0; i < num_taps; i++) {
+        const double t = i - mid;
+        const double w = 0.42 - 0.5 * cos(2 * M_PI * i / (num_taps - 1)) +
+                         0.08 * cos(4 * M_PI * i / (num_taps - 1));
+        double h;
+
+        if (t == 0.0) {
+            h = 2 * fc;
+        } else {
+            h = sin(2 * M_PI * fc * t) / (M_PI * t);
+        }
+
+        taps[i] = (float)(h * w);
+        sum += taps[i];
+    }
+
+    for (i = 0; i < num_taps; i++) {
+        taps[i] = (float)(taps[i] / sum);
+    }
+}
+
+int rx_dsp_create(struct rx_dsp **dsp_out,
+                  bladerf_format format,
+                  unsigned int num_channels,
+                  size_t max_samples,
+                  unsigned int factor,
+                  const float *taps,
+                  unsigned int num_taps,
+                  double shift)
+{
+    struct rx_dsp *dsp;
+    size_t per_channel, len;
+    unsigned int i, pad;
+
+    if (format != BLADERF_FORMAT_SC16_Q11 && format != BLADERF_FORMAT_SC8_Q7) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    if (num_channels < 1 || num_channels > 2 || max_samples == 0 ||
+        factor < 1 || factor > RX_DSP_MAX_FACTOR || !(fabs(shift) <= 0.5)) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (taps == NULL) {
+        num_taps = (factor == 1) ? 1 : RX_DSP_TAPS_PER_FACTOR * factor + 1;
+    } else if (num_taps == 0 || num_taps > RX_DSP_MAX_TAPS) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    dsp = calloc(1, sizeof(*dsp));
+    if (dsp == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    dsp->type         = (format == BLADERF_FORMAT_SC8_Q7) ? BLADERF_SAMPLE_SC8
+                                                          : BLADERF_SAMPLE_SC16;
+    dsp->num_channels = num_channels;
+    dsp->max_samples  = max_samples;
+    dsp->factor       = factor;
+    dsp->shift        = shift;
+    dsp->num_taps     = (num_taps + 3) & ~3u;
+
+    per_channel = max_samples / num_channels;
+    len         = dsp->num_taps - 1 + per_channel;
+
+    dsp->taps   = calloc(dsp->num_taps, sizeof(float));
+    dsp->nco_re = malloc(per_channel * sizeof(float));
+    dsp->nco_im = malloc(per_channel * sizeof(float));
+    dsp->in     = malloc(2 * max_samples * sizeof(float));
+    dsp->out    = malloc(2 * max_samples * sizeof(float));
+
+    if (dsp->taps == NULL || dsp->nco_re == NULL || dsp->nco_im == NULL ||
+        dsp->in == NULL || dsp->out == NULL) {
+        rx_dsp_free(dsp);
+        return BLADERF_ERR_MEM;
+    }
+
+    for (i = 0; i < num_channels; i++) {
+        dsp->ch[i].re = malloc(len * sizeof(float));
+        dsp->ch[i].im = malloc(len * sizeof(float));
+
+        if (dsp->ch[i].re == NULL || dsp->ch[i].im == NULL) {
+            rx_dsp_free(dsp);
+            return BLADERF_ERR_MEM;
+        }
+    }
+
+    /* The newest sample of a window pairs with the first tap */
+    pad = dsp->num_taps - num_taps;
+
+    if (taps == NULL) {
+        float *designed = malloc(num_taps * sizeof(float));
+        if (designed == NULL) {
+            rx_dsp_free(dsp);
+            return BLADERF_ERR_MEM;
+        }
+
+        if (num_taps == 1) {
+            designed[0] = 1.0f;
+        } else {
+            design_lowpass(designed, num_taps, factor);
+        }
+
+        for (i = 0; i < num_taps; i++) {
+            dsp->taps[pad + num_taps - 1 - i] = designed[i];
+        }
+
+        free(designed);
+    } else {
+        for (i = 0; i < num_taps; i++) {
+            dsp->taps[pad + num_taps - 1 - i] = taps[i];
+        }
+    }
+
+    rx_dsp_reset(dsp);
+
+    *dsp_out = dsp;
+    return 0;
+}
+
+void rx_dsp_reset(struct rx_dsp *dsp)
+{
+    unsigned int i;
+
+    dsp->phase = 0.0;
+
+    for (i = 0; i < dsp->num_channels; i++) {
+        memset(dsp->ch[i].re, 0, (dsp->num_taps - 1) * sizeof(float));
+        memset(dsp->ch[i].im, 0, (dsp->num_taps - 1) * sizeof(float));
+        dsp->ch[i].next = 0;
+    }
+}
+
+/* Compute the oscillator's values for n samples, from a phasor evaluated in
+ * double precision at the start of the buffer */
+static void nco_fill(struct rx_dsp *dsp, size_t n)
+{
+    const double step_re = cos(2 * M_PI * dsp->shift);
+    const double step_im = sin(2 * M_PI * dsp->shift);
+    double re = cos(2 * M_PI * dsp->phase);
+    double im = sin(2 * M_PI * dsp->phase);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        const double t = re * step_re - im * step_im;
+
+        dsp->nco_re[i] = (float)re;
+        dsp->nco_im[i] = (float)im;
+
+        im = re * step_im + im * step_re;
+        re = t;
+    }
+
+    dsp->phase = fmod(dsp->phase + dsp->shift * (double)n, 1.0);
+}
+
+/* Dot products of the taps with a window of I and Q values */
+static inline void fir_dot(const float *taps,
+                           const float *re,
+                           const float *im,
+                           unsigned int num_taps,
+                           float *out_re,
+                           float *out_im)
+{
+    unsigned int k = 0;
+    float sum_re   = 0.0f;
+    float sum_im   = 0.0f;
+
+#if defined(RX_DSP_SSE)
+    __m128 acc_re = _mm_setzero_ps();
+    __m128 acc_im = _mm_setzero_ps();
+    float lanes[4];
+
+    for (; k + 4 <= num_taps; k += 4) {
+        const __m128 h = _mm_loadu_ps(&taps[k]);
+
+        acc_re = _mm_add_ps(acc_re, _mm_mul_ps(h, _mm_loadu_ps(&re[k])));
+        acc_im = _mm_add_ps(acc_im, _mm_mul_ps(h, _mm_loadu_ps(&im[k])));
+    }
+
+    _mm_storeu_ps(lanes, acc_re);
+    sum_re = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, acc_im);
+    sum_im = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(RX_DSP_NEON)
+    float32x4_t acc_re = vdupq_n_f32(0.0f);
+    float32x4_t acc_im = vdupq_n_f32(0.0f);
+    float lanes[4];
+
+    for (; k + 4 <= num_taps; k += 4) {
+        const float32x4_t h = vld1q_f32(&taps[k]);
+
+        acc_re = vmlaq_f32(acc_re, h, vld1q_f32(&re[k]));
+        acc_im = vmlaq_f32(acc_im, h, vld1q_f32(&im[k]));
+    }
+
+    vst1q_f32(lanes, acc_re);
+    sum_re = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    vst1q_f32(lanes, acc_im);
+    sum_im = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+    for (; k < num_taps; k++) {
+        sum_re += taps[k] * re[k];
+        sum_im += taps[k] * im[k];
+    }
+
+    *out_re = sum_re;
+    *out_im = sum_im;
+}
+
+size_t rx_dsp_process(struct rx_dsp *dsp, void *samples, size_t num_samples)
+{
+    const unsigned int nch  = dsp->num_channels;
+    const unsigned int hist = dsp->num_taps - 1;
+    size_t num_out          = 0;
+    unsigned int c;
+    size_t n;
+
+    if (num_samples > dsp->max_samples) {
+        num_samples = dsp->max_samples;
+    }
+
+    n = num_samples / nch;
+
+    sample_convert(dsp->type, samples, BLADERF_SAMPLE_CF32, dsp->in,
+                   n * nch);
+
+    if (dsp->shift != 0.0) {
+        nco_fill(dsp, n);
+    }
+
+    for (c = 0; c < nch; c++) {
+        struct rx_dsp_channel *ch = &dsp->ch[c];
+        const float *in           = &dsp->in[2 * c];
+        float *re                 = &ch->re[hist];
+        float *im                 = &ch->im[hist];
+        size_t i, m;
+
+        if (dsp->shift != 0.0) {
+            for (i = 0; i < n; i++) {
+                const float x_re = in[2 * nch * i];
+                const float x_im = in[2 * nch * i + 1];
+
+                re[i] = x_re * dsp->nco_re[i] - x_im * dsp->nco_im[i];
+                im[i] = x_re * dsp->nco_im[i] + x_im * dsp->nco_re[i];
+            }
+        } else {
+            for (i = 0; i < n; i++) {
+                re[i] = in[2 * nch * i];
+                im[i] = in[2 * nch * i + 1];
+            }
+        }
+
+        /* The window starting at `next` ends at its newest sample, which
+         * must be within this buffer */
+        for (m = 0; ch->next < n; m++, ch->next += dsp->factor) {
+            float *y = &dsp->out[2 * (m * nch + c)];
+
+            fir_dot(dsp->taps, &ch->re[ch->next], &ch->im[ch->next],
+                    dsp->num_taps, &y[0], &y[1]);
+        }
+
+        ch->next -= n;
+        num_out = m;
+
+        memmove(ch->re, &ch->re[n], hist * sizeof(float));
+        memmove(ch->im, &ch->im[n], hist * sizeof(float));
+    }
+
+    sample_convert(BLADERF_SAMPLE_CF32, dsp->out, dsp->type, samples,
+                   num_out * nch);
+
+    return num_out * nch;
+}
+
+void rx_dsp_free(struct rx_dsp *dsp)
+{
+    unsigned int i;
+
+    if (dsp == NULL) {
+        return;
+    }
+
+    for (i = 0; i < 2; i++) {
+        free(dsp->ch[i].re);
+        free(dsp->ch[i].im);
+    }
+
+    free(dsp->taps);
+    free(dsp->nco_re);
+    free(dsp->nco_im);
+    free(dsp->in);
+    free(dsp->out);
+    free(dsp);
+}
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef STREAMING_RX_DSP_H_
+#define STREAMING_RX_DSP_H_
+
+#include <stddef.h>
+
+#include <libbladeRF.h>
+
+/* Largest supported decimation factor */
+#define RX_DSP_MAX_FACTOR 1024
+
+/* Largest supported number of filter taps */
+#define RX_DSP_MAX_TAPS 8192
+
+/**
+ * Frequency shift and decimation applied to received sync buffers
+ */
+struct rx_dsp;
+
+/**
+ * Create an RX processing stage.
+ *
+ * @param[out]  dsp             Created stage
+ * @param[in]   format          Stream format. Only ::BLADERF_FORMAT_SC16_Q11
+ *                              and ::BLADERF_FORMAT_SC8_Q7 are supported.
+ * @param[in]   num_channels    Number of interleaved channels (1 or 2)
+ * @param[in]   max_samples     Largest buffer that will be processed, in
+ *                              samples across all channels
+ * @param[in]   factor          Decimation factor
+ * @param[in]   taps            Low-pass filter taps, or NULL to design one
+ * @param[in]   num_taps        Number of taps, if `taps` is not NULL
+ * @param[in]   shift           Frequency shift, in cycles per input sample
+ *
+ * @return 0 on success, BLADERF_ERR_UNSUPPORTED for unsupported formats,
+ *         BLADERF_ERR_INVAL for invalid parameters, BLADERF_ERR_MEM on
+ *         allocation failure
+ */
+int rx_dsp_create(struct rx_dsp **dsp,
+                  bladerf_format format,
+                  unsigned int num_channels,
+                  size_t max_samples,
+                  unsigned int factor,
+                  const float *taps,
+                  unsigned int num_taps,
+                  double shift);
+
+/**
+ * Clear the filter history and oscillator phase, as when a stream restarts
+ */
+void rx_dsp_reset(struct rx_dsp *dsp);
+
+/**
+ * Process a buffer in place.
+ *
+ * The output is written to the start of the buffer, in the same format and
+ * channel layout as the input. The filter history carries over from the
+ * previous buffer, so consecutive buffers are processed as one stream.
+ *
+ * @param       dsp             Processing stage
+ * @param       samples         Samples to process
+ * @param[in]   num_samples     Number of samples across all channels. Must be
+ *                              a multiple of the number of channels.
+ *
+ * @return Number of output samples across all channels
+ */
+size_t rx_dsp_process(struct rx_dsp *dsp, void *samples, size_t num_samples);
+
+/**
+ * Free an RX processing stage
+ *
+ * @param       dsp     Stage to free. May be NULL.
+ */
+void rx_dsp_free(struct rx_dsp *dsp);
+
+#endif
@@ -35,6 +35,8 @@
 #include "sync.h"
 #include "sync_worker.h"
 #include "metadata.h"
+#include "rx_dsp.h"
+#include "iq_corr.h"
 
 #include "board/board.h"
 #include "helpers/timeout.h"
@@ -341,6 +343,9 @@ void sync_deinit(struct bladerf_sync *sync)
             free(sync->buf_mgmt.status);
         }
 
+        rx_dsp_free(sync->rx_dsp);
+        sync->rx_dsp = NULL;
+
         MUTEX_DESTROY(&sync->lock);
 
         sync->initialized = false;
@@ -412,6 +417,56 @@ static inline unsigned int timestamp_to_msg(struct bladerf_sync *s, uint64_t t)
     return (unsigned int) m;
 }
 
+int sync_set_rx_decimation(struct bladerf_sync *s,
+                           unsigned int factor,
+                           const float *taps,
+                           unsigned int num_taps,
+                           double shift)
+{
+    struct rx_dsp *dsp = NULL;
+    sync_worker_state worker_state;
+    unsigned int num_channels;
+    int stream_error;
+    int status = 0;
+
+    if (s == NULL || !s->initialized ||
+        (s->stream_config.layout & BLADERF_DIRECTION_MASK) != BLADERF_RX) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    num_channels = s->meta.samples_per_ts;
+
+    MUTEX_LOCK(&s->lock);
+
+    /* The worker applies the stage to received buffers, so it may only be
+     * replaced while they are not being received */
+    worker_state = sync_worker_get_state(s->worker, &stream_error);
+    if (worker_state != SYNC_WORKER_STATE_IDLE) {
+        log_debug("%s: RX stream is running.\n", __FUNCTION__);
+        status = BLADERF_ERR_INVAL;
+        goto out;
+    }
+
+    if (factor != 1 || shift != 0.0 || taps != NULL) {
+        status = rx_dsp_create(&dsp, s->stream_config.format, num_channels,
+                               s->stream_config.samples_per_buffer, factor,
+                               taps, num_taps, shift);
+        if (status != 0) {
+            goto out;
+        }
+    }
+
+    rx_dsp_free(s->rx_dsp);
+    s->rx_dsp = dsp;
+
+    log_debug("RX decimation by %u with a shift of %f cycles/sample %s.\n",
+              factor, shift, (dsp != NULL) ? "enabled" : "disabled");
+
+out:
+    MUTEX_UNLOCK(&s->lock);
+    return status;
+}
+
 int sync_rx(struct bladerf_sync *s, void *samples, unsigned num_samples,
             struct bladerf_metadata *user_meta, unsigned int timeout_ms)
 {
@@ -499,6 +554,13 @@ int sync_rx(struct bladerf_sync *s, void *samples, unsigned num_samples,
                  * transfers, so the consumer index must be reset to 0 */
                 b->cons_i = 0;
                 MUTEX_UNLOCK(&b->lock);
+
+                /* The worker is idle, so the processing stage may be reset
+                 * for the discontinuity */
+                if (s->rx_dsp != NULL) {
+                    rx_dsp_reset(s->rx_dsp);
+                }
+
                 log_debug("%s: Reset buf_mgmt consumer index\n", __FUNCTION__);
                 s->state = SYNC_STATE_START_WORKER;
                 break;
@@ -584,6 +646,12 @@ int sync_rx(struct bladerf_sync *s, void *samples, unsigned num_samples,
 
                 buf_src = (uint8_t*)b->buffers[b->cons_i];
 
+                /* Processed buffers hold fewer samples than were received */
+                if (s->rx_dsp != NULL) {
+                    samples_per_buffer =
+                        (unsigned int)b->actual_lengths[b->cons_i];
+                }
+
                 samples_to_copy = uint_min(num_samples - samples_returned,
                                            samples_per_buffer - b->partial_off);
 
@@ -827,6 +895,23 @@ out:
     return status;
 }
 
+/* Copy samples from the caller into a TX buffer, applying the board's
+ * correction to SC16 Q11 samples */
+static void copy_tx_samples(struct bladerf_sync *s,
+                            uint8_t *dest,
+                            const uint8_t *src,
+                            unsigned int num_samples)
+{
+    if (s->iq_corr != NULL && iq_corr_enabled(s->iq_corr) &&
+        (s->stream_config.format == BLADERF_FORMAT_SC16_Q11 ||
+         s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META)) {
+        iq_corr_process(s->iq_corr, (int16_t *)dest, (const int16_t *)src,
+                        num_samples);
+    } else {
+        memcpy(dest, src, samples2bytes(s, num_samples));
+    }
+}
+
 /* Assumes buffer lock is held */
 static int advance_tx_buffer(struct bladerf_sync *s, struct buffer_mgmt *b)
 {
@@ -1136,9 +1221,11 @@ int sync_tx(struct bladerf_sync *s,
                         ((uint16_t*)packed_dest)[jj+2] |= (src_ptr[zz+3] << 4) & 0xFFF0;
                     }
                 } else {
-                    memcpy(buf_dest + samples2bytes(s, b->partial_off),
-                           samples_src + samples2bytes(s, samples_written),
-                           samples2bytes(s, samples_to_copy));
+                    copy_tx_samples(s,
+                                    buf_dest + samples2bytes(s, b->partial_off),
+                                    samples_src +
+                                        samples2bytes(s, samples_written),
+                                    samples_to_copy);
                 }
 
                 b->partial_off += samples_to_copy;
@@ -1253,11 +1340,13 @@ int sync_tx(struct bladerf_sync *s,
                         if (samples_to_copy != 0) {
                             /* We have user data to copy into the current
                              * message within the buffer */
-                            memcpy(s->meta.curr_msg + METADATA_HEADER_SIZE +
-                                       samples2bytes(s, s->meta.curr_msg_off),
-                                   samples_src +
-                                       samples2bytes(s, samples_written),
-                                   samples2bytes(s, samples_to_copy));
+                            copy_tx_samples(
+                                s,
+                                s->meta.curr_msg + METADATA_HEADER_SIZE +
+                                    samples2bytes(s, s->meta.curr_msg_off),
+                                samples_src +
+                                    samples2bytes(s, samples_written),
+                                samples_to_copy);
 
                             s->meta.curr_msg_off += samples_to_copy;
                             if (s->stream_config.layout == BLADERF_TX_X2)
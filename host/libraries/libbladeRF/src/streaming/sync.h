@@ -144,6 +144,16 @@ struct bladerf_sync {
     struct stream_config stream_config;
     struct sync_worker *worker;
     struct sync_meta meta;
+
+    /* RX processing stage, applied by the worker to each received buffer.
+     * NULL if disabled. */
+    struct rx_dsp *rx_dsp;
+
+    /* DC and IQ imbalance correction of SC16 Q11 samples, applied ahead of
+     * the RX processing stage or as TX samples are buffered. This is owned by
+     * the board and persists across sync_init() calls. NULL if the board
+     * provides none. */
+    struct iq_corr *iq_corr;
 };
 
 /**
@@ -179,6 +189,21 @@ int sync_rx(struct bladerf_sync *sync,
             struct bladerf_metadata *metadata,
             unsigned int timeout_ms);
 
+/**
+ * Configure frequency shifting and decimation of received samples.
+ *
+ * This may only be called while the stream is not running.
+ *
+ * @see bladerf_sync_set_rx_decimation()
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_set_rx_decimation(struct bladerf_sync *sync,
+                           unsigned int factor,
+                           const float *taps,
+                           unsigned int num_taps,
+                           double shift);
+
 int sync_tx(struct bladerf_sync *sync,
             void const *samples,
             unsigned int num_samples,
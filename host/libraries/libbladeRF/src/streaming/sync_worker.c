@@ -35,6 +35,9 @@
 #include "async.h"
 #include "sync.h"
 #include "sync_worker.h"
+#include "rx_dsp.h"
+#include "iq_corr.h"
+#include "metadata.h"
 
 #include "board/board.h"
 #include "backend/usb/usb.h"
@@ -43,6 +46,39 @@
 
 void *sync_worker_task(void *arg);
 
+/* True if the board's correction currently applies to received buffers */
+static bool rx_correction_enabled(const struct bladerf_sync *s)
+{
+    if (s->iq_corr == NULL || !iq_corr_enabled(s->iq_corr)) {
+        return false;
+    }
+
+    return s->stream_config.format == BLADERF_FORMAT_SC16_Q11 ||
+           s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META;
+}
+
+/* Apply the board's correction to the SC16 Q11 samples of a received buffer,
+ * skipping the headers of any metadata messages */
+static void correct_rx_samples(struct bladerf_sync *s,
+                               void *samples,
+                               size_t num_samples)
+{
+    switch (s->stream_config.format) {
+        case BLADERF_FORMAT_SC16_Q11:
+            iq_corr_process(s->iq_corr, samples, samples, num_samples);
+            break;
+
+        case BLADERF_FORMAT_SC16_Q11_META:
+            iq_corr_process_msgs(s->iq_corr, samples, s->meta.msg_per_buf,
+                                 s->meta.msg_size, METADATA_HEADER_SIZE,
+                                 s->meta.samples_per_msg);
+            break;
+
+        default:
+            break;
+    }
+}
+
 static void *rx_callback(struct bladerf *dev,
                          struct bladerf_stream *stream,
                          struct bladerf_metadata *meta,
@@ -80,6 +116,22 @@ static void *rx_callback(struct bladerf *dev,
     if (b->resubmit_count == 0) {
         if (b->status[b->prod_i] == SYNC_BUFFER_EMPTY) {
 
+            const bool correct = rx_correction_enabled(s);
+
+            /* The consumer does not access this buffer until it is full, so
+             * it may be processed without holding the lock */
+            if (correct || s->rx_dsp != NULL) {
+                MUTEX_UNLOCK(&b->lock);
+                if (correct) {
+                    correct_rx_samples(s, samples, num_samples);
+                }
+                if (s->rx_dsp != NULL) {
+                    num_samples =
+                        rx_dsp_process(s->rx_dsp, samples, num_samples);
+                }
+                MUTEX_LOCK(&b->lock);
+            }
+
             /* This buffer is now ready for the consumer */
             b->status[samples_idx] = SYNC_BUFFER_FULL;
             b->actual_lengths[samples_idx] = num_samples;
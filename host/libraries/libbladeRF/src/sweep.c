@@ -0,0 +1,479 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Spectrum sweeps.
+ *
+ * Step i of a sweep dwells on its center frequency from timestamp
+ * t(i) = t_base + (i - base_step) * dwell. Its retune is scheduled for t(i),
+ * and the samples received from t(i) + settle onwards are its FFTs. Retunes are
+ * scheduled ahead of the step being received, up to the depth of the FPGA's
+ * retune queue, so the RX stream and the retunes run without waiting on the
+ * host.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libbladeRF.h>
+
+#include "log.h"
+
+#include "fft.h"
+#include "hop_set.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SWEEP_FFT_SIZE_MIN 64
+#define SWEEP_FFT_SIZE_MAX 65536
+
+/* Retunes scheduled ahead of the step being received */
+#define SWEEP_MAX_PENDING 16
+
+/* Time between reading the current timestamp and the first step of a
+ * (re)started sweep, in microseconds */
+#define SWEEP_LEAD_US 10000
+
+/* Times a sweep may fall behind the stream and be restarted before giving up */
+#define SWEEP_MAX_RESTARTS 8
+
+#define SWEEP_NUM_BUFFERS 32
+#define SWEEP_BUFFER_SIZE 16384
+#define SWEEP_NUM_TRANSFERS 16
+
+/* Full scale of an SC16 Q11 sample */
+#define SWEEP_FULL_SCALE 2048.0
+
+struct bladerf_sweep {
+    struct bladerf *dev;
+    bladerf_channel ch;
+    struct bladerf_sweep_config config;
+
+    unsigned int num_bins;
+    double bin_width;
+
+    /* FFT bins used per step, and the number of steps */
+    unsigned int used;
+    unsigned int num_steps;
+
+    /* Samples to discard after a retune, and samples per step */
+    uint64_t settle;
+    uint64_t dwell;
+    uint64_t lead;
+
+    struct bladerf_hop_set *hop_set;
+    struct fft_plan *plan;
+
+    float *window;
+    double power_scale;
+
+    int16_t *samples;
+    float *re;
+    float *im;
+    double *acc;
+};
+
+void bladerf_sweep_init_config(struct bladerf_sweep_config *config)
+{
+    if (config == NULL) {
+        return;
+    }
+
+    config->start           = 0;
+    config->stop            = 0;
+    config->fft_size        = 1024;
+    config->num_averages    = 4;
+    config->usable_fraction = 0.75f;
+    config->settle_us       = 500;
+}
+
+static int check_config(const struct bladerf_sweep_config *c)
+{
+    if (c->stop <= c->start) {
+        log_debug("Sweep stop frequency must exceed its start frequency.\n");
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (c->fft_size < SWEEP_FFT_SIZE_MIN || c->fft_size > SWEEP_FFT_SIZE_MAX ||
+        (c->fft_size & (c->fft_size - 1)) != 0) {
+        log_debug("Invalid sweep FFT size: %u\n", c->fft_size);
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (c->num_averages == 0) {
+        log_debug("Sweep must average at least one FFT.\n");
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (!(c->usable_fraction >= 0.1f && c->usable_fraction <= 1.0f)) {
+        log_debug("Invalid sweep usable fraction: %f\n", c->usable_fraction);
+        return BLADERF_ERR_INVAL;
+    }
+
+    return 0;
+}
+
+/* Build the Hann window, and the scale from an averaged bin's power to the
+ * power of a full-scale sinusoid in that bin */
+static void init_window(struct bladerf_sweep *s)
+{
+    const unsigned int n = s->config.fft_size;
+    double sum           = 0;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        s->window[i] = (float)(0.5 - 0.5 * cos(2 * M_PI * i / n));
+        sum += s->window[i];
+    }
+
+    s->power_scale = 1.0 / (SWEEP_FULL_SCALE * SWEEP_FULL_SCALE * sum * sum *
+                            s->config.num_averages);
+}
+
+void bladerf_sweep_free(struct bladerf_sweep *sweep)
+{
+    if (sweep == NULL) {
+        return;
+    }
+
+    if (sweep->hop_set != NULL) {
+        bladerf_enable_module(sweep->dev, sweep->ch, false);
+        bladerf_cancel_scheduled_retunes(sweep->dev, sweep->ch);
+        bladerf_hop_set_free(sweep->hop_set);
+    }
+
+    fft_plan_free(sweep->plan);
+    free(sweep->window);
+    free(sweep->samples);
+    free(sweep->re);
+    free(sweep->im);
+    free(sweep->acc);
+    free(sweep);
+}
+
+int bladerf_sweep_create(struct bladerf *dev,
+                         bladerf_channel ch,
+                         const struct bladerf_sweep_config *config,
+                         struct bladerf_sweep **sweep)
+{
+    struct bladerf_sweep *s;
+    const struct bladerf_range *range;
+    bladerf_frequency *frequencies = NULL;
+    bladerf_sample_rate rate;
+    unsigned int n, i;
+    int status;
+
+    if (dev == NULL || config == NULL || sweep == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (ch != BLADERF_CHANNEL_RX(0)) {
+        log_debug("Sweeps are only supported on RX channel 0.\n");
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    status = check_config(config);
+    if (status != 0) {
+        return status;
+    }
+
+    status = bladerf_get_sample_rate(dev, ch, &rate);
+    if (status != 0) {
+        return status;
+    }
+
+    status = bladerf_get_frequency_range(dev, ch, &range);
+    if (status != 0) {
+        return status;
+    }
+
+    s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    n = config->fft_size;
+
+    s->dev       = dev;
+    s->ch        = ch;
+    s->config    = *config;
+    s->bin_width = (double)rate / n;
+    s->used      = ((unsigned int)(n * config->usable_fraction)) & ~1u;
+    s->num_bins  = (unsigned int)ceil((config->stop - config->start) /
+                                     s->bin_width);
+    s->num_steps = (s->num_bins + s->used - 1) / s->used;
+    s->settle    = (uint64_t)config->settle_us * rate / 1000000;
+    s->dwell     = s->settle + (uint64_t)config->num_averages * n;
+    s->lead      = (uint64_t)SWEEP_LEAD_US * rate / 1000000;
+
+    s->plan    = fft_plan_create(n);
+    s->window  = malloc(n * sizeof(s->window[0]));
+    s->samples = malloc(2 * n * sizeof(s->samples[0]));
+    s->re      = malloc(n * sizeof(s->re[0]));
+    s->im      = malloc(n * sizeof(s->im[0]));
+    s->acc     = malloc(n * sizeof(s->acc[0]));
+    frequencies = malloc(s->num_steps * sizeof(frequencies[0]));
+
+    if (s->plan == NULL || s->window == NULL || s->samples == NULL ||
+        s->re == NULL || s->im == NULL || s->acc == NULL ||
+        frequencies == NULL) {
+        status = BLADERF_ERR_MEM;
+        goto error;
+    }
+
+    init_window(s);
+
+    /* Step i covers bins [i * used, (i + 1) * used), and is centered on the
+     * middle one */
+    for (i = 0; i < s->num_steps; i++) {
+        const double fc = config->start +
+                          ((double)i * s->used + s->used / 2) * s->bin_width;
+
+        frequencies[i] = (bladerf_frequency)(fc + 0.5);
+
+        if (fc < (double)range->min * range->scale ||
+            fc > (double)range->max * range->scale) {
+            log_debug("Sweep step at %" BLADERF_PRIuFREQ " Hz is outside of "
+                      "the channel's frequency range.\n", frequencies[i]);
+            status = BLADERF_ERR_INVAL;
+            goto error;
+        }
+    }
+
+    log_verbose("Sweep of %u bins of %.1f Hz in %u steps\n", s->num_bins,
+                s->bin_width, s->num_steps);
+
+    status = bladerf_hop_set_create(dev, ch, frequencies, s->num_steps,
+                                    &s->hop_set);
+    if (status != 0) {
+        goto error;
+    }
+
+    status = bladerf_sync_config(dev, BLADERF_RX_X1,
+                                 BLADERF_FORMAT_SC16_Q11_META,
+                                 SWEEP_NUM_BUFFERS, SWEEP_BUFFER_SIZE,
+                                 SWEEP_NUM_TRANSFERS, 0);
+    if (status != 0) {
+        goto error;
+    }
+
+    status = bladerf_enable_module(dev, ch, true);
+    if (status != 0) {
+        goto error;
+    }
+
+    free(frequencies);
+    *sweep = s;
+    return 0;
+
+error:
+    free(frequencies);
+    bladerf_sweep_free(s);
+    return status;
+}
+
+int bladerf_sweep_get_bins(const struct bladerf_sweep *sweep,
+                           unsigned int *num_bins,
+                           double *bin_width)
+{
+    if (sweep == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (num_bins != NULL) {
+        *num_bins = sweep->num_bins;
+    }
+
+    if (bin_width != NULL) {
+        *bin_width = sweep->bin_width;
+    }
+
+    return 0;
+}
+
+/* Receive and average the FFTs of one step, starting at timestamp t */
+static int capture_step(struct bladerf_sweep *s, bladerf_timestamp t,
+                        unsigned int timeout_ms)
+{
+    const unsigned int n = s->config.fft_size;
+    unsigned int a, k;
+    int status;
+
+    memset(s->acc, 0, n * sizeof(s->acc[0]));
+
+    for (a = 0; a < s->config.num_averages; a++) {
+        struct bladerf_metadata meta;
+
+        memset(&meta, 0, sizeof(meta));
+        meta.timestamp = t + (uint64_t)a * n;
+
+        status = bladerf_sync_rx(s->dev, s->samples, n, &meta, timeout_ms);
+        if (status != 0) {
+            return status;
+        }
+
+        for (k = 0; k < n; k++) {
+            s->re[k] = s->samples[2 * k] * s->window[k];
+            s->im[k] = s->samples[2 * k + 1] * s->window[k];
+        }
+
+        fft_execute(s->plan, s->re, s->im);
+
+        for (k = 0; k < n; k++) {
+            s->acc[k] += (double)s->re[k] * s->re[k] +
+                         (double)s->im[k] * s->im[k];
+        }
+    }
+
+    return 0;
+}
+
+/* Copy a step's central bins into the spectrum */
+static void stitch_step(const struct bladerf_sweep *s, unsigned int step,
+                        float *power)
+{
+    const int n    = (int)s->config.fft_size;
+    const int half = (int)s->used / 2;
+    int off;
+
+    for (off = -half; off < half; off++) {
+        const unsigned int bin = step * s->used + off + half;
+        double p;
+
+        if (bin >= s->num_bins) {
+            break;
+        }
+
+        if (off == 0) {
+            /* The DC bin holds the receiver's DC offset and LO leakage */
+            p = 0.5 * (s->acc[1] + s->acc[n - 1]);
+        } else {
+            p = s->acc[(off + n) % n];
+        }
+
+        power[bin] = (float)(10.0 * log10(p * s->power_scale + 1e-20));
+    }
+}
+
+/* Restart the sweep from a step, after falling behind the stream */
+static int restart(struct bladerf_sweep *s, bladerf_timestamp *t_base)
+{
+    bladerf_timestamp now;
+    int status;
+
+    status = bladerf_cancel_scheduled_retunes(s->dev, s->ch);
+    if (status == 0) {
+        status = bladerf_get_timestamp(s->dev, BLADERF_RX, &now);
+    }
+
+    if (status == 0) {
+        *t_base = now + s->lead;
+    }
+
+    return status;
+}
+
+int bladerf_sweep_run(struct bladerf_sweep *sweep,
+                      float *power,
+                      unsigned int num_bins,
+                      unsigned int timeout_ms)
+{
+    struct bladerf_sweep *s = sweep;
+    unsigned int fill, depth, max_pending;
+    unsigned int scheduled = 0, received = 0, restarts = 0;
+    unsigned int base_step = 0;
+    bladerf_timestamp t_base;
+    int status;
+
+    if (s == NULL || power == NULL || num_bins < s->num_bins) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    max_pending = SWEEP_MAX_PENDING;
+    if (bladerf_get_retune_queue_status(s->dev, s->ch, &fill, &depth) == 0 &&
+        depth < max_pending) {
+        max_pending = depth;
+    }
+
+    status = restart(s, &t_base);
+    if (status != 0) {
+        return status;
+    }
+
+    while (received < s->num_steps) {
+        /* Keep the retune queue topped up. A step without a profile retunes
+         * the channel when it is scheduled, so the steps before it are
+         * received first. */
+        while (scheduled < s->num_steps &&
+               scheduled - received < max_pending) {
+            const bool resident = hop_set_is_resident(s->hop_set, scheduled);
+
+            if (!resident) {
+                if (scheduled != received) {
+                    break;
+                }
+
+                status = restart(s, &t_base);
+                if (status != 0) {
+                    return status;
+                }
+
+                base_step = scheduled;
+            }
+
+            status = bladerf_hop_set_schedule(
+                s->hop_set, t_base + (scheduled - base_step) * s->dwell,
+                scheduled);
+            if (status != 0) {
+                return status;
+            }
+
+            scheduled++;
+        }
+
+        status = capture_step(
+            s, t_base + (received - base_step) * s->dwell + s->settle,
+            timeout_ms);
+
+        if (status == BLADERF_ERR_TIME_PAST && restarts < SWEEP_MAX_RESTARTS) {
+            log_debug("Sweep fell behind at step %u; restarting.\n", received);
+
+            status = restart(s, &t_base);
+            if (status != 0) {
+                return status;
+            }
+
+            restarts++;
+            base_step = received;
+            scheduled = received;
+            continue;
+        } else if (status != 0) {
+            return status;
+        }
+
+        stitch_step(s, received, power);
+        received++;
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Allocation counting for the streaming benchmark.
+ *
+ * With glibc, the allocator entry points are wrapped so that allocations made
+ * by libbladeRF during streaming (which should be none, once a stream is
+ * running) show up in the results. Elsewhere, allocation statistics are
+ * reported as unavailable.
+ *
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include "benchmark.h"
+
+#if defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static int64_t alloc_count;
+static int64_t alloc_bytes;
+
+static inline void alloc_record(size_t size)
+{
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&alloc_bytes, (int64_t)size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    alloc_record(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    alloc_record(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    alloc_record(size);
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    alloc_record(size);
+
+    p = __libc_memalign(alignment, size);
+    if (p == NULL) {
+        return ENOMEM;
+    }
+
+    *memptr = p;
+    return 0;
+}
+
+bool alloc_stats_available(void)
+{
+    return true;
+}
+
+void alloc_stats_get(int64_t *count, int64_t *bytes)
+{
+    *count = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    *bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+}
+
+#else
+
+bool alloc_stats_available(void)
+{
+    return false;
+}
+
+void alloc_stats_get(int64_t *count, int64_t *bytes)
+{
+    *count = 0;
+    *bytes = 0;
+}
+
+#endif
@@ -0,0 +1,423 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "benchmark.h"
+#include "log.h"
+
+/* Packet metadata headers occupy 4 DWORDs of each packet buffer */
+#define PACKET_META_HEADER_DWORDS 4
+
+struct async_ctx {
+    void **buffers;
+    unsigned int num_buffers;
+    unsigned int next;
+
+    uint64_t samples_target;
+    uint64_t samples;
+    uint64_t last_ns;
+
+    uint64_t *intervals;
+    size_t num_intervals;
+    size_t max_intervals;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t cpu_ns(void)
+{
+    return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void compute_latency(uint64_t *samples, size_t n,
+                            struct latency_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    if (n == 0) {
+        return;
+    }
+
+    qsort(samples, n, sizeof(samples[0]), cmp_u64);
+
+    stats->count = n;
+    stats->p50   = samples[(n - 1) * 50 / 100];
+    stats->p90   = samples[(n - 1) * 90 / 100];
+    stats->p99   = samples[(n - 1) * 99 / 100];
+    stats->max   = samples[n - 1];
+}
+
+static inline bool format_has_meta(bladerf_format format)
+{
+    return format == BLADERF_FORMAT_SC16_Q11_META ||
+           format == BLADERF_FORMAT_SC8_Q7_META ||
+           format == BLADERF_FORMAT_PACKET_META;
+}
+
+/* Bytes per sample in the caller's buffers. The sync interface unpacks
+ * SC16 Q11 PACKED samples to SC16 Q11. */
+static inline size_t user_bytes_per_sample(bladerf_format format)
+{
+    switch (format) {
+        case BLADERF_FORMAT_SC8_Q7:
+        case BLADERF_FORMAT_SC8_Q7_META:
+            return 2;
+
+        default:
+            return 4;
+    }
+}
+
+static inline bladerf_channel_layout case_layout(const struct bench_case *c)
+{
+    if (c->dir == BLADERF_TX) {
+        return c->mimo ? BLADERF_TX_X2 : BLADERF_TX_X1;
+    } else {
+        return c->mimo ? BLADERF_RX_X2 : BLADERF_RX_X1;
+    }
+}
+
+static int enable_channels(struct bladerf *dev,
+                           const struct bench_case *c,
+                           bool enable)
+{
+    int status;
+
+    if (c->dir == BLADERF_TX) {
+        status = bladerf_enable_module(dev, BLADERF_CHANNEL_TX(0), enable);
+        if (status == 0 && c->mimo) {
+            status = bladerf_enable_module(dev, BLADERF_CHANNEL_TX(1), enable);
+        }
+    } else {
+        status = bladerf_enable_module(dev, BLADERF_CHANNEL_RX(0), enable);
+        if (status == 0 && c->mimo) {
+            status = bladerf_enable_module(dev, BLADERF_CHANNEL_RX(1), enable);
+        }
+    }
+
+    return status;
+}
+
+static int run_sync(struct bladerf *dev,
+                    const struct bench_params *p,
+                    struct bench_case *c)
+{
+    struct bladerf_metadata meta;
+    unsigned int call_size = c->call_size;
+    uint64_t *latencies    = NULL;
+    void *samples          = NULL;
+    size_t num_calls, i;
+    uint64_t t_start, t_end, cpu_start, cpu_end;
+    int64_t alloc_count_start, alloc_bytes_start;
+    int status;
+
+    /* Each packet is transferred with a single call */
+    if (c->format == BLADERF_FORMAT_PACKET_META) {
+        call_size = c->stream.buffer_size;
+        if (c->dir == BLADERF_TX) {
+            call_size -= PACKET_META_HEADER_DWORDS;
+        }
+        c->call_size = call_size;
+    }
+
+    if (call_size == 0) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    num_calls = (size_t)((p->num_samples + call_size - 1) / call_size);
+
+    status = bladerf_sync_config(dev, case_layout(c), c->format,
+                                 c->stream.num_buffers, c->stream.buffer_size,
+                                 c->stream.num_transfers, p->timeout_ms);
+    if (status != 0) {
+        return status;
+    }
+
+    samples   = calloc(call_size, user_bytes_per_sample(c->format));
+    latencies = calloc(num_calls, sizeof(latencies[0]));
+    if (samples == NULL || latencies == NULL) {
+        status = BLADERF_ERR_MEM;
+        goto out;
+    }
+
+    status = enable_channels(dev, c, true);
+    if (status != 0) {
+        goto out;
+    }
+
+    alloc_stats_get(&alloc_count_start, &alloc_bytes_start);
+    cpu_start = cpu_ns();
+    t_start   = now_ns();
+
+    for (i = 0; i < num_calls && status == 0; i++) {
+        struct bladerf_metadata *meta_ptr = NULL;
+        uint64_t t0;
+
+        if (format_has_meta(c->format)) {
+            memset(&meta, 0, sizeof(meta));
+            meta_ptr = &meta;
+
+            if (c->dir == BLADERF_RX) {
+                meta.flags = BLADERF_META_FLAG_RX_NOW;
+            } else if (c->format != BLADERF_FORMAT_PACKET_META) {
+                if (i == 0) {
+                    meta.flags |= BLADERF_META_FLAG_TX_BURST_START |
+                                  BLADERF_META_FLAG_TX_NOW;
+                }
+                if (i == num_calls - 1) {
+                    meta.flags |= BLADERF_META_FLAG_TX_BURST_END;
+                }
+            }
+        }
+
+        t0 = now_ns();
+
+        if (c->dir == BLADERF_RX) {
+            status = bladerf_sync_rx(dev, samples, call_size, meta_ptr,
+                                     p->timeout_ms);
+        } else {
+            status = bladerf_sync_tx(dev, samples, call_size, meta_ptr,
+                                     p->timeout_ms);
+        }
+
+        latencies[i] = now_ns() - t0;
+
+        if (status == 0) {
+            if (c->dir == BLADERF_RX && meta_ptr != NULL) {
+                c->samples += meta.actual_count;
+                if (meta.status & BLADERF_META_STATUS_OVERRUN) {
+                    c->discontinuities++;
+                }
+            } else {
+                c->samples += call_size;
+            }
+        }
+    }
+
+    t_end   = now_ns();
+    cpu_end = cpu_ns();
+    alloc_stats_get(&c->alloc_count, &c->alloc_bytes);
+
+    c->elapsed_ns   = t_end - t_start;
+    c->cpu_ns       = cpu_end - cpu_start;
+    c->alloc_count -= alloc_count_start;
+    c->alloc_bytes -= alloc_bytes_start;
+
+    compute_latency(latencies, i, &c->latency);
+
+    /* Preserve the streaming error, if any, over a failure to disable */
+    if (status == 0) {
+        status = enable_channels(dev, c, false);
+    } else {
+        enable_channels(dev, c, false);
+    }
+
+out:
+    free(samples);
+    free(latencies);
+    return status;
+}
+
+static void *async_callback(struct bladerf *dev,
+                            struct bladerf_stream *stream,
+                            struct bladerf_metadata *meta,
+                            void *samples,
+                            size_t num_samples,
+                            void *user_data)
+{
+    struct async_ctx *ctx = user_data;
+    const uint64_t now    = now_ns();
+    void *next;
+
+    if (samples != NULL) {
+        if (ctx->num_intervals < ctx->max_intervals && ctx->last_ns != 0) {
+            ctx->intervals[ctx->num_intervals++] = now - ctx->last_ns;
+        }
+
+        ctx->samples += num_samples;
+    }
+
+    ctx->last_ns = now;
+
+    if (ctx->samples >= ctx->samples_target) {
+        return BLADERF_STREAM_SHUTDOWN;
+    }
+
+    next      = ctx->buffers[ctx->next];
+    ctx->next = (ctx->next + 1) % ctx->num_buffers;
+
+    return next;
+}
+
+static int run_async(struct bladerf *dev,
+                     const struct bench_params *p,
+                     struct bench_case *c)
+{
+    struct bladerf_stream *stream = NULL;
+    struct async_ctx ctx;
+    uint64_t t_start, t_end, cpu_start, cpu_end;
+    int64_t alloc_count_start, alloc_bytes_start;
+    int status;
+
+    /* Building metadata headers for TX is left to the application when using
+     * the async interface, which is beyond the scope of this benchmark */
+    if (c->dir == BLADERF_TX && format_has_meta(c->format)) {
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.num_buffers    = c->stream.num_buffers;
+    ctx.samples_target = p->num_samples;
+    ctx.max_intervals  = (size_t)(p->num_samples / c->stream.buffer_size) + 1;
+    ctx.intervals      = calloc(ctx.max_intervals, sizeof(ctx.intervals[0]));
+    if (ctx.intervals == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    status = bladerf_init_stream(&stream, dev, async_callback, &ctx.buffers,
+                                 c->stream.num_buffers, c->format,
+                                 c->stream.buffer_size,
+                                 c->stream.num_transfers, &ctx);
+    if (status != 0) {
+        goto out;
+    }
+
+    /* RX buffers are submitted by the stream itself; the callback hands out
+     * the rest in order */
+    if (c->dir == BLADERF_RX) {
+        ctx.next = c->stream.num_transfers % ctx.num_buffers;
+    }
+
+    status = bladerf_set_stream_timeout(dev, c->dir, p->timeout_ms);
+    if (status != 0) {
+        goto out;
+    }
+
+    status = enable_channels(dev, c, true);
+    if (status != 0) {
+        goto out;
+    }
+
+    alloc_stats_get(&alloc_count_start, &alloc_bytes_start);
+    cpu_start = cpu_ns();
+    t_start   = now_ns();
+
+    status = bladerf_stream(stream, case_layout(c));
+
+    t_end   = now_ns();
+    cpu_end = cpu_ns();
+    alloc_stats_get(&c->alloc_count, &c->alloc_bytes);
+
+    c->samples      = ctx.samples;
+    c->elapsed_ns   = t_end - t_start;
+    c->cpu_ns       = cpu_end - cpu_start;
+    c->alloc_count -= alloc_count_start;
+    c->alloc_bytes -= alloc_bytes_start;
+
+    compute_latency(ctx.intervals, ctx.num_intervals, &c->latency);
+
+    if (status == 0) {
+        status = enable_channels(dev, c, false);
+    } else {
+        enable_channels(dev, c, false);
+    }
+
+out:
+    if (stream != NULL) {
+        bladerf_deinit_stream(stream);
+    }
+
+    free(ctx.intervals);
+    return status;
+}
+
+int bench_run_case(struct bladerf *dev,
+                   const struct bench_params *p,
+                   struct bench_case *c)
+{
+    c->samples         = 0;
+    c->elapsed_ns      = 0;
+    c->cpu_ns          = 0;
+    c->discontinuities = 0;
+    c->alloc_count     = 0;
+    c->alloc_bytes     = 0;
+    memset(&c->latency, 0, sizeof(c->latency));
+
+    if (c->api == BENCH_API_SYNC) {
+        c->status = run_sync(dev, p, c);
+    } else {
+        c->status = run_async(dev, p, c);
+    }
+
+    if (c->status != 0) {
+        log_debug("%s %s %s: %s\n", c->dir == BLADERF_TX ? "TX" : "RX",
+                  c->api == BENCH_API_SYNC ? "sync" : "async",
+                  bench_format_str(c->format), bladerf_strerror(c->status));
+    }
+
+    return c->status;
+}
+
+const char *bench_format_str(bladerf_format format)
+{
+    switch (format) {
+        case BLADERF_FORMAT_SC16_Q11:
+            return "sc16";
+
+        case BLADERF_FORMAT_SC16_Q11_META:
+            return "sc16meta";
+
+        case BLADERF_FORMAT_SC8_Q7:
+            return "sc8";
+
+        case BLADERF_FORMAT_SC8_Q7_META:
+            return "sc8meta";
+
+        case BLADERF_FORMAT_SC16_Q11_PACKED:
+            return "packed";
+
+        case BLADERF_FORMAT_PACKET_META:
+            return "packetmeta";
+
+        default:
+            return "unknown";
+    }
+}
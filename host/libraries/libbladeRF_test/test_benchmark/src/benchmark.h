@@ -0,0 +1,138 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <libbladeRF.h>
+
+/* Device config defaults */
+#define DEFAULT_SAMPLERATE      30720000
+#define DEFAULT_FREQUENCY       915000000
+
+/* Test defaults */
+#define DEFAULT_NUM_SAMPLES     4000000
+#define DEFAULT_TIMEOUT_MS      2500
+
+/* Upper bound on the number of entries in each sweep list */
+#define MAX_SWEEP_ENTRIES       16
+
+typedef enum {
+    BENCH_API_SYNC,
+    BENCH_API_ASYNC,
+} bench_api;
+
+struct stream_params {
+    unsigned int num_buffers;
+    unsigned int buffer_size;   /* Units of samples */
+    unsigned int num_transfers;
+};
+
+/* Sweep description: every combination of these values is run */
+struct bench_sweep {
+    bladerf_direction dirs[2];
+    size_t num_dirs;
+
+    bench_api apis[2];
+    size_t num_apis;
+
+    bladerf_format formats[MAX_SWEEP_ENTRIES];
+    size_t num_formats;
+
+    bool mimo[2];
+    size_t num_layouts;
+
+    struct stream_params streams[MAX_SWEEP_ENTRIES];
+    size_t num_streams;
+
+    unsigned int call_sizes[MAX_SWEEP_ENTRIES];
+    size_t num_call_sizes;
+};
+
+struct bench_params {
+    const char *device_str;
+    unsigned int samplerate;
+    uint64_t num_samples;
+    unsigned int timeout_ms;
+    struct bench_sweep sweep;
+};
+
+/* Latency distribution, in nanoseconds */
+struct latency_stats {
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+};
+
+/* A single benchmark case and its results */
+struct bench_case {
+    bladerf_direction dir;
+    bench_api api;
+    bladerf_format format;
+    bool mimo;
+    struct stream_params stream;
+    unsigned int call_size; /* Samples per sync call; 0 for async */
+
+    int status;
+    uint64_t samples;
+    uint64_t elapsed_ns;
+    uint64_t cpu_ns;
+    uint64_t discontinuities;
+    struct latency_stats latency;
+    int64_t alloc_count;
+    int64_t alloc_bytes;
+};
+
+/**
+ * Run a single benchmark case, filling in its results
+ *
+ * @param       dev     Device handle
+ * @param       p       Benchmark parameters
+ * @param[inout] c      Case to run
+ *
+ * @return 0 if the case ran, or a BLADERF_ERR_* value if the device could not
+ *         be configured. The latter is also stored in c->status.
+ */
+int bench_run_case(struct bladerf *dev,
+                   const struct bench_params *p,
+                   struct bench_case *c);
+
+/**
+ * Whether allocation statistics are available on this platform
+ */
+bool alloc_stats_available(void);
+
+/**
+ * Snapshot of the number of allocations and bytes allocated by this process
+ */
+void alloc_stats_get(int64_t *count, int64_t *bytes);
+
+const char *bench_format_str(bladerf_format format);
+
+#endif
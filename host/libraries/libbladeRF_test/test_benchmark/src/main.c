@@ -0,0 +1,659 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <libbladeRF.h>
+#include <getopt.h>
+
+#include "conversions.h"
+#include "log.h"
+#include "benchmark.h"
+
+/* Device string used for --sim. Requires libbladeRF to be built with
+ * ENABLE_BACKEND_DUMMY. */
+#define SIM_DEVICE_STR "dummy:"
+
+#define OPTSTR "hd:So:s:n:T:D:A:F:L:B:c:"
+static const struct option long_options[] = {
+    { "help",           no_argument,        0,  'h' },
+
+    /* Device configuration */
+    { "device",         required_argument,  0,  'd' },
+    { "sim",            no_argument,        0,  'S' },
+    { "samplerate",     required_argument,  0,  's' },
+
+    /* Test configuration */
+    { "output",         required_argument,  0,  'o' },
+    { "num-samples",    required_argument,  0,  'n' },
+    { "timeout",        required_argument,  0,  'T' },
+
+    /* Sweep configuration */
+    { "directions",     required_argument,  0,  'D' },
+    { "apis",           required_argument,  0,  'A' },
+    { "formats",        required_argument,  0,  'F' },
+    { "layouts",        required_argument,  0,  'L' },
+    { "streams",        required_argument,  0,  'B' },
+    { "call-sizes",     required_argument,  0,  'c' },
+
+    /* Verbosity options */
+    { "lib-verbosity",  required_argument,  0,  1,  },
+    { 0,                0,                  0,  0   },
+};
+
+static const struct numeric_suffix freq_suffixes[] = {
+    { "K",   1000 },
+    { "kHz", 1000 },
+    { "M",   1000000 },
+    { "MHz", 1000000 },
+    { "G",   1000000000 },
+    { "GHz", 1000000000 },
+};
+
+static const unsigned int num_freq_suffixes =
+    sizeof(freq_suffixes) / sizeof(freq_suffixes[0]);
+
+static const struct numeric_suffix count_suffixes[] = {
+    { "K", 1000 },
+    { "M", 1000000 },
+    { "G", 1000000000 },
+};
+
+static const unsigned int num_count_suffixes =
+    sizeof(count_suffixes) / sizeof(count_suffixes[0]);
+
+static const struct numeric_suffix size_suffixes[] = {
+    { "K",  1024 },
+    { "M",  1024 * 1024 },
+};
+
+static const unsigned int num_size_suffixes =
+    sizeof(size_suffixes) / sizeof(size_suffixes[0]);
+
+static void print_usage(const char *argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("Streaming throughput and latency benchmark. Results are written as JSON.\n");
+    printf("\n");
+
+    printf("Device configuration options:\n");
+    printf("    -d, --device <device>       Use the specified device. By default,\n");
+    printf("                                any device found will be used.\n");
+    printf("    -S, --sim                   Use the simulated device (\"%s\").\n", SIM_DEVICE_STR);
+    printf("    -s, --samplerate <value>    Sample rate. Default = %u.\n", DEFAULT_SAMPLERATE);
+    printf("\n");
+
+    printf("Test configuration options:\n");
+    printf("    -o, --output <file>         Write JSON results to <file>. Default = stdout.\n");
+    printf("    -n, --num-samples <n>       # of samples per case. Default = %u.\n", DEFAULT_NUM_SAMPLES);
+    printf("    -T, --timeout <ms>          Stream and sync call timeout. Default = %u.\n", DEFAULT_TIMEOUT_MS);
+    printf("\n");
+
+    printf("Sweep options (comma-separated lists; all combinations are run):\n");
+    printf("    -D, --directions <list>     rx, tx. Default = rx,tx.\n");
+    printf("    -A, --apis <list>           sync, async. Default = sync,async.\n");
+    printf("    -F, --formats <list>        sc16, sc8, packed, sc16meta, sc8meta,\n");
+    printf("                                packetmeta. Default = all.\n");
+    printf("    -L, --layouts <list>        x1, x2. Default = x1,x2.\n");
+    printf("    -B, --streams <list>        Stream configurations, each given as\n");
+    printf("                                <num_buffers>:<buffer_size>:<num_transfers>.\n");
+    printf("                                Default = 16:8192:8,32:32K:16.\n");
+    printf("    -c, --call-sizes <list>     # samples per sync call.\n");
+    printf("                                Default = 1024,8192,32K.\n");
+    printf("\n");
+
+    printf("Misc options:\n");
+    printf("    -h, --help                  Show this help text\n");
+    printf("    --lib-verbosity <level>     Set libbladeRF verbosity (Default: warning)\n");
+    printf("\n");
+
+    printf("Notes:\n");
+    printf("    Buffer sizes should be multiples of 8192 samples, which is valid for\n");
+    printf("    all formats.\n");
+    printf("\n");
+    printf("    PACKET_META cases transfer one packet per call, so the call size is\n");
+    printf("    derived from the buffer size.\n");
+    printf("\n");
+    printf("    Async cases do not use the call size, and report the interval\n");
+    printf("    between stream callbacks as their latency.\n");
+    printf("\n");
+    printf("    To measure library overhead rather than the sample rate against\n");
+    printf("    the simulated device, set BLADERF_DUMMY_REALTIME=0.\n");
+    printf("\n");
+}
+
+/* Split a comma-separated list, invoking parse() for each entry */
+static int parse_list(const char *str, size_t max_entries, size_t *count,
+                      bool (*parse)(const char *tok, size_t idx, void *arg),
+                      void *arg)
+{
+    char *copy, *tok, *saveptr = NULL;
+    int status = 0;
+
+    copy = strdup(str);
+    if (copy == NULL) {
+        return -1;
+    }
+
+    *count = 0;
+
+    for (tok = strtok_r(copy, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        if (*count >= max_entries || !parse(tok, *count, arg)) {
+            fprintf(stderr, "Invalid list entry: %s\n", tok);
+            status = -1;
+            break;
+        }
+
+        (*count)++;
+    }
+
+    if (status == 0 && *count == 0) {
+        status = -1;
+    }
+
+    free(copy);
+    return status;
+}
+
+static bool parse_direction(const char *tok, size_t idx, void *arg)
+{
+    bladerf_direction *dirs = arg;
+
+    if (!strcasecmp(tok, "rx")) {
+        dirs[idx] = BLADERF_RX;
+    } else if (!strcasecmp(tok, "tx")) {
+        dirs[idx] = BLADERF_TX;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_api(const char *tok, size_t idx, void *arg)
+{
+    bench_api *apis = arg;
+
+    if (!strcasecmp(tok, "sync")) {
+        apis[idx] = BENCH_API_SYNC;
+    } else if (!strcasecmp(tok, "async")) {
+        apis[idx] = BENCH_API_ASYNC;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_format(const char *tok, size_t idx, void *arg)
+{
+    bladerf_format *formats = arg;
+
+    if (!strcasecmp(tok, "sc16")) {
+        formats[idx] = BLADERF_FORMAT_SC16_Q11;
+    } else if (!strcasecmp(tok, "sc16meta")) {
+        formats[idx] = BLADERF_FORMAT_SC16_Q11_META;
+    } else if (!strcasecmp(tok, "sc8")) {
+        formats[idx] = BLADERF_FORMAT_SC8_Q7;
+    } else if (!strcasecmp(tok, "sc8meta")) {
+        formats[idx] = BLADERF_FORMAT_SC8_Q7_META;
+    } else if (!strcasecmp(tok, "packed")) {
+        formats[idx] = BLADERF_FORMAT_SC16_Q11_PACKED;
+    } else if (!strcasecmp(tok, "packetmeta")) {
+        formats[idx] = BLADERF_FORMAT_PACKET_META;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_layout(const char *tok, size_t idx, void *arg)
+{
+    bool *mimo = arg;
+
+    if (!strcasecmp(tok, "x1")) {
+        mimo[idx] = false;
+    } else if (!strcasecmp(tok, "x2")) {
+        mimo[idx] = true;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_stream(const char *tok, size_t idx, void *arg)
+{
+    struct stream_params *streams = arg;
+    char buffers[16], size[16], xfers[16];
+    bool ok_buffers, ok_size, ok_xfers;
+
+    if (sscanf(tok, "%15[^:]:%15[^:]:%15s", buffers, size, xfers) != 3) {
+        return false;
+    }
+
+    streams[idx].num_buffers   = str2uint(buffers, 1, UINT_MAX, &ok_buffers);
+    streams[idx].buffer_size   = str2uint_suffix(size, 1, UINT_MAX,
+                                                 size_suffixes,
+                                                 num_size_suffixes, &ok_size);
+    streams[idx].num_transfers = str2uint(xfers, 1, UINT_MAX, &ok_xfers);
+
+    return ok_buffers && ok_size && ok_xfers &&
+           streams[idx].num_transfers < streams[idx].num_buffers;
+}
+
+static bool parse_call_size(const char *tok, size_t idx, void *arg)
+{
+    unsigned int *sizes = arg;
+    bool ok;
+
+    sizes[idx] = str2uint_suffix(tok, 1, UINT_MAX, size_suffixes,
+                                 num_size_suffixes, &ok);
+    return ok;
+}
+
+static void init_params(struct bench_params *p)
+{
+    struct bench_sweep *s = &p->sweep;
+
+    memset(p, 0, sizeof(*p));
+
+    p->samplerate  = DEFAULT_SAMPLERATE;
+    p->num_samples = DEFAULT_NUM_SAMPLES;
+    p->timeout_ms  = DEFAULT_TIMEOUT_MS;
+
+    s->dirs[0]  = BLADERF_RX;
+    s->dirs[1]  = BLADERF_TX;
+    s->num_dirs = 2;
+
+    s->apis[0]  = BENCH_API_SYNC;
+    s->apis[1]  = BENCH_API_ASYNC;
+    s->num_apis = 2;
+
+    s->formats[0]  = BLADERF_FORMAT_SC16_Q11;
+    s->formats[1]  = BLADERF_FORMAT_SC8_Q7;
+    s->formats[2]  = BLADERF_FORMAT_SC16_Q11_PACKED;
+    s->formats[3]  = BLADERF_FORMAT_SC16_Q11_META;
+    s->formats[4]  = BLADERF_FORMAT_SC8_Q7_META;
+    s->formats[5]  = BLADERF_FORMAT_PACKET_META;
+    s->num_formats = 6;
+
+    s->mimo[0]     = false;
+    s->mimo[1]     = true;
+    s->num_layouts = 2;
+
+    s->streams[0].num_buffers   = 16;
+    s->streams[0].buffer_size   = 8192;
+    s->streams[0].num_transfers = 8;
+    s->streams[1].num_buffers   = 32;
+    s->streams[1].buffer_size   = 32768;
+    s->streams[1].num_transfers = 16;
+    s->num_streams              = 2;
+
+    s->call_sizes[0] = 1024;
+    s->call_sizes[1] = 8192;
+    s->call_sizes[2] = 32768;
+    s->num_call_sizes = 3;
+}
+
+static int handle_args(int argc, char *argv[], struct bench_params *p,
+                       const char **output)
+{
+    struct bench_sweep *s = &p->sweep;
+    bladerf_log_level log_level;
+    int c, status = 0;
+    bool ok;
+
+    while (status == 0 &&
+           (c = getopt_long(argc, argv, OPTSTR, long_options, NULL)) != -1) {
+        switch (c) {
+            case 1:
+                log_level = str2loglevel(optarg, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid log level: %s\n", optarg);
+                    status = -1;
+                } else {
+                    bladerf_log_set_verbosity(log_level);
+                }
+                break;
+
+            case 'h':
+                print_usage(argv[0]);
+                return 1;
+
+            case 'd':
+                p->device_str = optarg;
+                break;
+
+            case 'S':
+                p->device_str = SIM_DEVICE_STR;
+                break;
+
+            case 's':
+                p->samplerate = str2uint_suffix(optarg, 1, UINT_MAX,
+                                                freq_suffixes,
+                                                num_freq_suffixes, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid sample rate: %s\n", optarg);
+                    status = -1;
+                }
+                break;
+
+            case 'o':
+                *output = optarg;
+                break;
+
+            case 'n':
+                p->num_samples = str2uint64_suffix(optarg, 1, UINT64_MAX,
+                                                   count_suffixes,
+                                                   num_count_suffixes, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid sample count: %s\n", optarg);
+                    status = -1;
+                }
+                break;
+
+            case 'T':
+                p->timeout_ms = str2uint(optarg, 1, UINT_MAX, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid timeout: %s\n", optarg);
+                    status = -1;
+                }
+                break;
+
+            case 'D':
+                status = parse_list(optarg, 2, &s->num_dirs,
+                                    parse_direction, s->dirs);
+                break;
+
+            case 'A':
+                status = parse_list(optarg, 2, &s->num_apis,
+                                    parse_api, s->apis);
+                break;
+
+            case 'F':
+                status = parse_list(optarg, MAX_SWEEP_ENTRIES, &s->num_formats,
+                                    parse_format, s->formats);
+                break;
+
+            case 'L':
+                status = parse_list(optarg, 2, &s->num_layouts,
+                                    parse_layout, s->mimo);
+                break;
+
+            case 'B':
+                status = parse_list(optarg, MAX_SWEEP_ENTRIES, &s->num_streams,
+                                    parse_stream, s->streams);
+                break;
+
+            case 'c':
+                status = parse_list(optarg, MAX_SWEEP_ENTRIES,
+                                    &s->num_call_sizes, parse_call_size,
+                                    s->call_sizes);
+                break;
+
+            default:
+                status = -1;
+        }
+    }
+
+    return status;
+}
+
+static void print_latency(FILE *out, const char *name,
+                          const struct latency_stats *l)
+{
+    fprintf(out,
+            "      \"%s\": { \"count\": %" PRIu64 ", \"p50\": %.3f, "
+            "\"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+            name, l->count, l->p50 / 1e3, l->p90 / 1e3, l->p99 / 1e3,
+            l->max / 1e3);
+}
+
+static void print_case(FILE *out, const struct bench_case *c, bool last)
+{
+    const double elapsed_s = c->elapsed_ns / 1e9;
+
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"direction\": \"%s\",\n",
+            c->dir == BLADERF_TX ? "tx" : "rx");
+    fprintf(out, "      \"api\": \"%s\",\n",
+            c->api == BENCH_API_SYNC ? "sync" : "async");
+    fprintf(out, "      \"format\": \"%s\",\n", bench_format_str(c->format));
+    fprintf(out, "      \"layout\": \"%s\",\n", c->mimo ? "x2" : "x1");
+    fprintf(out, "      \"num_buffers\": %u,\n", c->stream.num_buffers);
+    fprintf(out, "      \"buffer_size\": %u,\n", c->stream.buffer_size);
+    fprintf(out, "      \"num_transfers\": %u,\n", c->stream.num_transfers);
+
+    if (c->api == BENCH_API_SYNC) {
+        fprintf(out, "      \"call_size\": %u,\n", c->call_size);
+    } else {
+        fprintf(out, "      \"call_size\": null,\n");
+    }
+
+    fprintf(out, "      \"status\": \"%s\",\n",
+            c->status == 0 ? "ok" : bladerf_strerror(c->status));
+
+    fprintf(out, "      \"samples\": %" PRIu64 ",\n", c->samples);
+    fprintf(out, "      \"elapsed_s\": %.6f,\n", elapsed_s);
+    fprintf(out, "      \"samples_per_sec\": %.1f,\n",
+            elapsed_s > 0 ? c->samples / elapsed_s : 0.0);
+    fprintf(out, "      \"cpu_ns_per_sample\": %.3f,\n",
+            c->samples > 0 ? (double)c->cpu_ns / c->samples : 0.0);
+    fprintf(out, "      \"discontinuities\": %" PRIu64 ",\n",
+            c->discontinuities);
+
+    print_latency(out,
+                  c->api == BENCH_API_SYNC ? "call_latency_us"
+                                           : "callback_interval_us",
+                  &c->latency);
+
+    if (alloc_stats_available()) {
+        fprintf(out,
+                "      \"allocations\": { \"count\": %" PRIi64
+                ", \"bytes\": %" PRIi64 " }\n",
+                c->alloc_count, c->alloc_bytes);
+    } else {
+        fprintf(out, "      \"allocations\": null\n");
+    }
+
+    fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+static void print_header(FILE *out, struct bladerf *dev,
+                         const struct bench_params *p,
+                         unsigned int actual_rate)
+{
+    struct bladerf_version lib_version;
+    struct bladerf_devinfo info;
+
+    bladerf_version(&lib_version);
+    bladerf_get_devinfo(dev, &info);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"libbladeRF_test_benchmark\",\n");
+    fprintf(out, "  \"timestamp\": %" PRIu64 ",\n", (uint64_t)time(NULL));
+    fprintf(out, "  \"libbladeRF\": \"%s\",\n", lib_version.describe);
+    fprintf(out, "  \"device\": {\n");
+    fprintf(out, "    \"board\": \"%s\",\n", bladerf_get_board_name(dev));
+    fprintf(out, "    \"backend\": \"%s\",\n", bladerf_backend_str(info.backend));
+    fprintf(out, "    \"serial\": \"%s\"\n", info.serial);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"sample_rate\": %u,\n", actual_rate);
+    fprintf(out, "  \"num_samples\": %" PRIu64 ",\n", p->num_samples);
+    fprintf(out, "  \"results\": [\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench_params p;
+    struct bench_sweep *s = &p.sweep;
+    struct bench_case *cases = NULL;
+    struct bladerf *dev = NULL;
+    const char *output = NULL;
+    FILE *out = stdout;
+    bladerf_sample_rate actual_rate;
+    size_t num_cases = 0, max_cases, i;
+    size_t d, a, f, l, b, k;
+    int status;
+
+    init_params(&p);
+    bladerf_log_set_verbosity(BLADERF_LOG_LEVEL_WARNING);
+
+    status = handle_args(argc, argv, &p, &output);
+    if (status != 0) {
+        if (status < 0) {
+            print_usage(argv[0]);
+        }
+        return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    max_cases = s->num_dirs * s->num_apis * s->num_formats * s->num_layouts *
+                s->num_streams * s->num_call_sizes;
+
+    cases = calloc(max_cases, sizeof(cases[0]));
+    if (cases == NULL) {
+        fprintf(stderr, "Failed to allocate benchmark cases.\n");
+        return EXIT_FAILURE;
+    }
+
+    status = bladerf_open(&dev, p.device_str);
+    if (status != 0) {
+        fprintf(stderr, "Failed to open device: %s\n",
+                bladerf_strerror(status));
+        if (p.device_str == NULL) {
+            fprintf(stderr, "Use --sim to run against the simulated device.\n");
+        }
+        goto out;
+    }
+
+    status = bladerf_set_sample_rate(dev, BLADERF_CHANNEL_RX(0), p.samplerate,
+                                     &actual_rate);
+    if (status == 0) {
+        status = bladerf_set_sample_rate(dev, BLADERF_CHANNEL_TX(0),
+                                         p.samplerate, NULL);
+    }
+
+    if (status == 0) {
+        status = bladerf_set_frequency(dev, BLADERF_CHANNEL_RX(0),
+                                       DEFAULT_FREQUENCY);
+    }
+
+    if (status == 0) {
+        status = bladerf_set_frequency(dev, BLADERF_CHANNEL_TX(0),
+                                       DEFAULT_FREQUENCY);
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Failed to configure device: %s\n",
+                bladerf_strerror(status));
+        goto out;
+    }
+
+    if (output != NULL) {
+        out = fopen(output, "w");
+        if (out == NULL) {
+            perror("Failed to open output file");
+            status = -1;
+            goto out;
+        }
+    }
+
+    /* Async streams ignore the call size, so they are only run once per
+     * stream configuration */
+    for (d = 0; d < s->num_dirs; d++)
+    for (a = 0; a < s->num_apis; a++)
+    for (f = 0; f < s->num_formats; f++)
+    for (l = 0; l < s->num_layouts; l++)
+    for (b = 0; b < s->num_streams; b++)
+    for (k = 0; k < s->num_call_sizes; k++) {
+        struct bench_case *c = &cases[num_cases];
+
+        if (s->apis[a] == BENCH_API_ASYNC && k != 0) {
+            continue;
+        }
+
+        /* PACKET_META call sizes are derived from the buffer size */
+        if (s->apis[a] == BENCH_API_SYNC &&
+            s->formats[f] == BLADERF_FORMAT_PACKET_META && k != 0) {
+            continue;
+        }
+
+        c->dir       = s->dirs[d];
+        c->api       = s->apis[a];
+        c->format    = s->formats[f];
+        c->mimo      = s->mimo[l];
+        c->stream    = s->streams[b];
+        c->call_size = (c->api == BENCH_API_SYNC) ? s->call_sizes[k] : 0;
+
+        fprintf(stderr, "[%zu] %s %-5s %-10s %s %u:%u:%u",
+                num_cases, c->dir == BLADERF_TX ? "TX" : "RX",
+                c->api == BENCH_API_SYNC ? "sync" : "async",
+                bench_format_str(c->format), c->mimo ? "x2" : "x1",
+                c->stream.num_buffers, c->stream.buffer_size,
+                c->stream.num_transfers);
+        if (c->api == BENCH_API_SYNC) {
+            fprintf(stderr, " call=%u", c->call_size);
+        }
+
+        bench_run_case(dev, &p, c);
+
+        if (c->status == 0) {
+            fprintf(stderr, " -> %.2f Msps, %.2f ns/sample\n",
+                    c->elapsed_ns ? c->samples * 1e3 / c->elapsed_ns : 0.0,
+                    c->samples ? (double)c->cpu_ns / c->samples : 0.0);
+        } else {
+            fprintf(stderr, " -> %s\n", bladerf_strerror(c->status));
+        }
+
+        num_cases++;
+    }
+
+    print_header(out, dev, &p, actual_rate);
+    for (i = 0; i < num_cases; i++) {
+        print_case(out, &cases[i], i == num_cases - 1);
+    }
+    fprintf(out, "  ]\n}\n");
+
+    status = 0;
+
+out:
+    if (out != NULL && out != stdout) {
+        fclose(out);
+    }
+
+    if (dev != NULL) {
+        bladerf_close(dev);
+    }
+
+    free(cases);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,563 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Converts gain calibration CSV files in batch, and benchmarks the conversion.
+ *
+ * When CSV files are provided, they are converted to .tbl files alongside
+ * them. Otherwise, synthetic RX and TX calibration sweeps are generated and
+ * converted, both one at a time and in parallel, and each table is checked
+ * entry by entry against a straightforward fgets()/sscanf() parse of its CSV.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <libbladeRF.h>
+#include <getopt.h>
+
+#include "conversions.h"
+#include "log.h"
+
+#define DEFAULT_NUM_FILES 64
+#define DEFAULT_NUM_LINES 5000
+
+#define GAIN_CAL_HEADER_RX "RX Chain,RX Gain,VSG Power into bladeRF RX (dBm),Frequency of signal (Hz),Frequency of bladeRF+PXI (Hz),AD9361 RSSI register value,Power of Signal from Full Scale (dBFS)"
+#define GAIN_CAL_HEADER_TX "TX Chain,TX Gain,Frequency of Signal (Hz),Frequency of bladeRF+PXI (Hz),VSA Measured Power (dBm)"
+
+#define GAIN_CAL_TX_ENTRY_SIZE \
+    (sizeof(uint8_t) + sizeof(int32_t) + 2 * sizeof(uint64_t) + sizeof(float))
+
+#define GAIN_CAL_RX_ENTRY_SIZE                                       \
+    (sizeof(uint8_t) + sizeof(int32_t) + 2 * sizeof(float) +         \
+     2 * sizeof(uint64_t) + sizeof(int32_t))
+
+#define OPTSTR "hj:n:l:o:k"
+static const struct option long_options[] = {
+    { "help",           no_argument,        0,  'h' },
+    { "threads",        required_argument,  0,  'j' },
+    { "num-files",      required_argument,  0,  'n' },
+    { "lines",          required_argument,  0,  'l' },
+    { "output-dir",     required_argument,  0,  'o' },
+    { "keep",           no_argument,        0,  'k' },
+    { "lib-verbosity",  required_argument,  0,  1,  },
+    { 0,                0,                  0,  0   },
+};
+
+struct test_params {
+    unsigned int num_threads;
+    unsigned int num_files;
+    unsigned int num_lines;
+    const char *output_dir;
+    bool keep;
+};
+
+static void print_usage(const char *argv0)
+{
+    printf("Usage: %s [options] [file.csv ...]\n", argv0);
+    printf("Converts gain calibration CSV files to .tbl files in parallel, and\n");
+    printf("reports the conversion throughput. If no files are given, synthetic\n");
+    printf("calibration sweeps are generated and converted, one at a time and\n");
+    printf("in parallel.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("    -j, --threads <n>           # of files to convert concurrently.\n");
+    printf("                                Default = 0 (one per CPU).\n");
+    printf("    -n, --num-files <n>         # of synthetic files. Default = %u.\n", DEFAULT_NUM_FILES);
+    printf("    -l, --lines <n>             # of entries per synthetic file.\n");
+    printf("                                Default = %u.\n", DEFAULT_NUM_LINES);
+    printf("    -o, --output-dir <dir>      Directory for synthetic files. Default = \".\"\n");
+    printf("    -k, --keep                  Keep synthetic files.\n");
+    printf("    -h, --help                  Show this help text\n");
+    printf("    --lib-verbosity <level>     Set libbladeRF verbosity (Default: warning)\n");
+    printf("\n");
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static long file_bytes(const char *path)
+{
+    long len = -1;
+    FILE *f = fopen(path, "rb");
+
+    if (f != NULL) {
+        if (fseek(f, 0, SEEK_END) == 0) {
+            len = ftell(f);
+        }
+        fclose(f);
+    }
+
+    return len;
+}
+
+/* Format a value just short of halfway between x and the next float away
+ * from zero. It should be parsed as x, but it is within half a double's
+ * precision of the midpoint, so rounding it to double first creates a tie. */
+static void format_near_midpoint(char *buf, size_t size, float x)
+{
+    uint32_t bits;
+    float next;
+    size_t i, n_digits = 0;
+
+    memcpy(&bits, &x, sizeof(bits));
+    bits++;
+    memcpy(&next, &bits, sizeof(next));
+
+    /* The midpoint is printed exactly, and truncated to 19 digits */
+    snprintf(buf, size, "%.30f", ((double)x + (double)next) / 2);
+
+    for (i = 0; buf[i] != '\0'; i++) {
+        if (buf[i] >= '0' && buf[i] <= '9' && n_digits++ == 19) {
+            buf[i] = '\0';
+            break;
+        }
+    }
+}
+
+/* Write a calibration sweep resembling one produced by factory tooling */
+static int write_sweep(const char *path, bool tx, unsigned int num_lines,
+                       unsigned int seed)
+{
+    FILE *f = fopen(path, "w");
+    unsigned int i;
+
+    if (f == NULL) {
+        fprintf(stderr, "Failed to create %s\n", path);
+        return -1;
+    }
+
+    fprintf(f, "Serial: %032x\n", seed);
+    fprintf(f, "%s\n", tx ? GAIN_CAL_HEADER_TX : GAIN_CAL_HEADER_RX);
+
+    srand(seed);
+
+    for (i = 0; i < num_lines; i++) {
+        const uint64_t freq = 70000000 + (uint64_t)i * 1000000;
+        const double noise  = (rand() % 20000) / 1e6;
+        char power[64];
+
+        /* Some values lie exactly halfway between two floats, which must be
+         * rounded only once */
+        if (i % 16 == 15) {
+            const float p = (tx ? 4.1f : -24.9f) + (rand() % 256) / 1024.0f;
+            format_near_midpoint(power, sizeof(power), p);
+        } else {
+            snprintf(power, sizeof(power), "%f",
+                     tx ? 4.1 + noise : -24.9 - noise);
+        }
+
+        if (tx) {
+            fprintf(f, "0,60,%" PRIu64 ",%" PRIu64 ",%s\n", freq + 5000000,
+                    freq, power);
+        } else {
+            fprintf(f, "0,0,-30.000000,%" PRIu64 ",%" PRIu64 ",-48,%s\n",
+                    freq + 5000000, freq, power);
+        }
+    }
+
+    return (fclose(f) == 0) ? 0 : -1;
+}
+
+#define PACK(_buf, _len, _field)                                           \
+    do {                                                                   \
+        memcpy(&(_buf)[_len], &(_field), sizeof(_field));                  \
+        (_len) += sizeof(_field);                                          \
+    } while (0)
+
+/* Parse a CSV file with fgets() and sscanf(), as libbladeRF once did, and
+ * pack its serial number and entries as they are laid out in a table */
+static uint8_t *reference_parse(const char *csv_path, size_t *len,
+                                size_t *entry_size)
+{
+    FILE *f = fopen(csv_path, "r");
+    char line[512];
+    uint8_t *data = NULL;
+    size_t capacity = 0;
+    bool tx;
+
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open %s\n", csv_path);
+        return NULL;
+    }
+
+    capacity = BLADERF_SERIAL_LENGTH;
+    data = calloc(1, capacity);
+    if (data == NULL || fgets(line, sizeof(line), f) == NULL) {
+        goto error;
+    }
+
+    sscanf(line, "Serial: %32s", (char *)data);
+    *len = BLADERF_SERIAL_LENGTH;
+
+    if (fgets(line, sizeof(line), f) == NULL) {
+        goto error;
+    }
+
+    tx = strncmp(line, GAIN_CAL_HEADER_TX, strlen(GAIN_CAL_HEADER_TX)) == 0;
+    *entry_size = tx ? GAIN_CAL_TX_ENTRY_SIZE : GAIN_CAL_RX_ENTRY_SIZE;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        uint8_t chain;
+        int32_t gain, rssi;
+        uint64_t freq_a, freq_b;
+        float vsg_power, power;
+        int n;
+
+        if (line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        if (*len + *entry_size > capacity) {
+            uint8_t *tmp = realloc(data, capacity * 2 + *entry_size);
+            if (tmp == NULL) {
+                goto error;
+            }
+            data     = tmp;
+            capacity = capacity * 2 + *entry_size;
+        }
+
+        if (tx) {
+            n = sscanf(line, "%" SCNu8 ",%" SCNi32 ",%" SCNu64 ",%" SCNu64
+                       ",%f", &chain, &gain, &freq_a, &freq_b, &power);
+            if (n != 5) {
+                goto error;
+            }
+
+            PACK(data, *len, chain);
+            PACK(data, *len, gain);
+            PACK(data, *len, freq_a);
+            PACK(data, *len, freq_b);
+            PACK(data, *len, power);
+        } else {
+            n = sscanf(line, "%" SCNu8 ",%" SCNi32 ",%f,%" SCNu64 ",%" SCNu64
+                       ",%" SCNi32 ",%f", &chain, &gain, &vsg_power, &freq_a,
+                       &freq_b, &rssi, &power);
+            if (n != 7) {
+                goto error;
+            }
+
+            PACK(data, *len, chain);
+            PACK(data, *len, gain);
+            PACK(data, *len, vsg_power);
+            PACK(data, *len, freq_a);
+            PACK(data, *len, freq_b);
+            PACK(data, *len, rssi);
+            PACK(data, *len, power);
+        }
+    }
+
+    fclose(f);
+    return data;
+
+error:
+    fprintf(stderr, "Reference parse of %s failed\n", csv_path);
+    fclose(f);
+    free(data);
+    return NULL;
+}
+
+/* Check every entry of a converted table against the reference parse */
+static int verify_table(const char *csv_path, const char *tbl_path)
+{
+    struct bladerf_image *image = NULL;
+    uint8_t *expected;
+    size_t len, entry_size, offset;
+    int status = -1;
+
+    expected = reference_parse(csv_path, &len, &entry_size);
+    if (expected == NULL) {
+        return -1;
+    }
+
+    image = bladerf_alloc_image(NULL, BLADERF_IMAGE_TYPE_INVALID, 0, 0);
+    if (image == NULL) {
+        goto out;
+    }
+
+    if (bladerf_image_read(image, tbl_path) != 0) {
+        fprintf(stderr, "Failed to read %s\n", tbl_path);
+        goto out;
+    }
+
+    if (memcmp(image->data, expected, BLADERF_SERIAL_LENGTH) != 0) {
+        fprintf(stderr, "%s: serial number differs\n", tbl_path);
+        goto out;
+    }
+
+    for (offset = BLADERF_SERIAL_LENGTH; offset < len; offset += entry_size) {
+        if (offset + entry_size > image->length ||
+            memcmp(&image->data[offset], &expected[offset], entry_size) != 0) {
+            fprintf(stderr, "%s: entry %zu differs from the reference parse\n",
+                    tbl_path, (offset - BLADERF_SERIAL_LENGTH) / entry_size);
+            goto out;
+        }
+    }
+
+    if (image->length != len) {
+        fprintf(stderr, "%s: %u bytes, expected %zu\n", tbl_path,
+                image->length, len);
+        goto out;
+    }
+
+    status = 0;
+
+out:
+    if (image != NULL) {
+        bladerf_free_image(image);
+    }
+
+    free(expected);
+    return status;
+}
+
+static int verify_tables(char *const *csv_paths, char *const *tbl_paths,
+                         unsigned int num_files)
+{
+    unsigned int i;
+
+    for (i = 0; i < num_files; i++) {
+        if (verify_table(csv_paths[i], tbl_paths[i]) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void report(const char *name, unsigned int num_files, double bytes,
+                   uint64_t elapsed_ns)
+{
+    const double s = elapsed_ns / 1e9;
+
+    printf("%-12s %6u files  %8.1f ms  %8.1f files/s  %8.1f MB/s\n", name,
+           num_files, s * 1e3, s > 0 ? num_files / s : 0.0,
+           s > 0 ? bytes / s / 1e6 : 0.0);
+}
+
+static int convert_files(const char *const *csv_paths, unsigned int num_files,
+                         unsigned int num_threads)
+{
+    int *statuses;
+    double bytes = 0;
+    uint64_t t_start;
+    unsigned int i;
+    int status;
+
+    statuses = calloc(num_files, sizeof(statuses[0]));
+    if (statuses == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < num_files; i++) {
+        bytes += file_bytes(csv_paths[i]);
+    }
+
+    t_start = now_ns();
+    status = bladerf_convert_gain_calibrations(csv_paths, NULL, num_files,
+                                               num_threads, statuses);
+    report("batch", num_files, bytes, now_ns() - t_start);
+
+    for (i = 0; i < num_files; i++) {
+        if (statuses[i] != 0) {
+            fprintf(stderr, "%s: %s\n", csv_paths[i],
+                    bladerf_strerror(statuses[i]));
+        }
+    }
+
+    free(statuses);
+    return status;
+}
+
+static int run_benchmark(const struct test_params *p)
+{
+    char **csv_paths;
+    char **tbl_paths;
+    double bytes = 0;
+    uint64_t t_start;
+    unsigned int i;
+    int status = 0;
+
+    csv_paths = calloc(p->num_files, sizeof(csv_paths[0]));
+    tbl_paths = calloc(p->num_files, sizeof(tbl_paths[0]));
+    if (csv_paths == NULL || tbl_paths == NULL) {
+        status = -1;
+        goto out;
+    }
+
+    for (i = 0; i < p->num_files && status == 0; i++) {
+        const size_t len = strlen(p->output_dir) + 32;
+
+        csv_paths[i] = malloc(len);
+        tbl_paths[i] = malloc(len);
+        if (csv_paths[i] == NULL || tbl_paths[i] == NULL) {
+            status = -1;
+            break;
+        }
+
+        snprintf(csv_paths[i], len, "%s/gain_cal_%04u.csv", p->output_dir, i);
+        snprintf(tbl_paths[i], len, "%s/gain_cal_%04u.tbl", p->output_dir, i);
+
+        status = write_sweep(csv_paths[i], (i & 1) != 0, p->num_lines, i + 1);
+        bytes += file_bytes(csv_paths[i]);
+    }
+
+    if (status != 0) {
+        goto out;
+    }
+
+    printf("%u files, %u entries each, %.1f MB\n", p->num_files, p->num_lines,
+           bytes / 1e6);
+
+    t_start = now_ns();
+    for (i = 0; i < p->num_files && status == 0; i++) {
+        status = bladerf_convert_gain_calibration(csv_paths[i], tbl_paths[i]);
+    }
+    report("sequential", p->num_files, bytes, now_ns() - t_start);
+
+    if (status != 0) {
+        fprintf(stderr, "Conversion failed: %s\n", bladerf_strerror(status));
+        goto out;
+    }
+
+    status = verify_tables(csv_paths, tbl_paths, p->num_files);
+    if (status != 0) {
+        goto out;
+    }
+
+    status = convert_files((const char *const *)csv_paths, p->num_files,
+                           p->num_threads);
+    if (status != 0) {
+        goto out;
+    }
+
+    status = verify_tables(csv_paths, tbl_paths, p->num_files);
+    if (status == 0) {
+        printf("All tables match the reference parse.\n");
+    }
+
+out:
+    for (i = 0; i < p->num_files; i++) {
+        if (!p->keep && csv_paths != NULL && csv_paths[i] != NULL) {
+            remove(csv_paths[i]);
+            remove(tbl_paths[i]);
+        }
+
+        if (csv_paths != NULL) {
+            free(csv_paths[i]);
+        }
+
+        if (tbl_paths != NULL) {
+            free(tbl_paths[i]);
+        }
+    }
+
+    free(csv_paths);
+    free(tbl_paths);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    struct test_params p;
+    bladerf_log_level log_level = BLADERF_LOG_LEVEL_WARNING;
+    bool ok;
+    int c;
+    int status;
+
+    p.num_threads = 0;
+    p.num_files   = DEFAULT_NUM_FILES;
+    p.num_lines   = DEFAULT_NUM_LINES;
+    p.output_dir  = ".";
+    p.keep        = false;
+
+    while ((c = getopt_long(argc, argv, OPTSTR, long_options, NULL)) != -1) {
+        switch (c) {
+            case 'j':
+                p.num_threads = str2uint(optarg, 0, 1024, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'n':
+                p.num_files = str2uint(optarg, 1, 100000, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid file count: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'l':
+                p.num_lines = str2uint(optarg, 1, 10000000, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid line count: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'o':
+                p.output_dir = optarg;
+                break;
+
+            case 'k':
+                p.keep = true;
+                break;
+
+            case 1:
+                log_level = str2loglevel(optarg, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid log level: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    bladerf_log_set_verbosity(log_level);
+
+    if (optind < argc) {
+        status = convert_files((const char *const *)&argv[optind],
+                               argc - optind, p.num_threads);
+    } else {
+        status = run_benchmark(&p);
+    }
+
+    return (status == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,490 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Checks the software DC offset and IQ imbalance correction against a
+ * floating point reference, its rejection of the image and DC of an impaired
+ * tone, table interpolation and loading, and the handling of metadata
+ * messages.
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libbladeRF.h>
+
+#include "streaming/iq_corr.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define NUM_SAMPLES 4099
+
+static uint32_t seed = 1;
+
+static uint32_t next_rand(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/* Floating point version of the correction */
+static double reference(const struct bladerf_iq_correction *p,
+                        int16_t i,
+                        int16_t q,
+                        bool quadrature)
+{
+    const double phase = p->phase * M_PI / 180.0;
+    const double x_i   = i - p->dc_i;
+    const double x_q   = q - p->dc_q;
+
+    if (!quadrature) {
+        return x_i;
+    }
+
+    return -tan(phase) * x_i + x_q / (p->gain * cos(phase));
+}
+
+static int test_accuracy(void)
+{
+    int16_t *in  = malloc(NUM_SAMPLES * 2 * sizeof(int16_t));
+    int16_t *out = malloc(NUM_SAMPLES * 2 * sizeof(int16_t));
+    struct iq_corr *corr = NULL;
+    double max_err       = 0.0;
+    int failures         = 0;
+    unsigned int trial;
+    size_t k;
+
+    if (in == NULL || out == NULL || iq_corr_create(&corr) != 0) {
+        failures = 1;
+        goto out;
+    }
+
+    for (trial = 0; trial < 64; trial++) {
+        struct bladerf_iq_correction p;
+        size_t n = NUM_SAMPLES - trial;
+
+        p.frequency = 0;
+        p.dc_i  = (float)((int)(next_rand() % 401) - 200) / 4.0f;
+        p.dc_q  = (float)((int)(next_rand() % 401) - 200) / 4.0f;
+        p.gain  = 0.8f + (float)(next_rand() % 1000) / 2500.0f;
+        p.phase = (float)((int)(next_rand() % 2001) - 1000) / 100.0f;
+
+        if (iq_corr_set(corr, &p) != 0) {
+            printf("  Valid parameters rejected\n");
+            failures++;
+            break;
+        }
+
+        for (k = 0; k < 2 * n; k++) {
+            in[k] = (int16_t)((int)(next_rand() % 3000) - 1500);
+        }
+
+        iq_corr_process(corr, out, in, n);
+
+        for (k = 0; k < n; k++) {
+            double ref_i = reference(&p, in[2 * k], in[2 * k + 1], false);
+            double ref_q = reference(&p, in[2 * k], in[2 * k + 1], true);
+
+            ref_i = fmin(fmax(ref_i, -2048.0), 2047.0);
+            ref_q = fmin(fmax(ref_q, -2048.0), 2047.0);
+
+            max_err = fmax(max_err, fabs(out[2 * k] - ref_i));
+            max_err = fmax(max_err, fabs(out[2 * k + 1] - ref_q));
+        }
+
+        /* In place processing must give the same results */
+        iq_corr_process(corr, in, in, n);
+        if (memcmp(in, out, n * 2 * sizeof(int16_t)) != 0) {
+            printf("  In place result differs\n");
+            failures++;
+            break;
+        }
+    }
+
+    printf("  Maximum error %.3f\n", max_err);
+    if (max_err > 1.0) {
+        printf("  FAILED\n");
+        failures++;
+    }
+
+    /* Inputs beyond the 12-bit range must saturate rather than wrap */
+    iq_corr_set(corr, NULL);
+    iq_corr_set_table(corr, NULL, 0);
+    {
+        struct bladerf_iq_correction p = { 0, 0.0f, 0.0f, 0.5f, 0.0f };
+        int16_t big[16];
+
+        for (k = 0; k < 16; k++) {
+            big[k] = (k & 2) ? INT16_MIN : INT16_MAX;
+        }
+
+        iq_corr_set(corr, &p);
+        iq_corr_process(corr, big, big, 8);
+
+        for (k = 0; k < 16; k++) {
+            if (big[k] != ((k & 2) ? -2048 : 2047)) {
+                printf("  Saturation FAILED at %u: %d\n", (unsigned int)k,
+                       big[k]);
+                failures++;
+                break;
+            }
+        }
+    }
+
+out:
+    iq_corr_free(corr);
+    free(in);
+    free(out);
+
+    return failures;
+}
+
+/* Power of the complex exponential at `freq` cycles per sample, in dB
+ * relative to full scale */
+static double tone_power(const int16_t *buf, size_t n, double freq)
+{
+    double re = 0.0, im = 0.0;
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        const double c = cos(2 * M_PI * freq * k);
+        const double s = sin(2 * M_PI * freq * k);
+
+        re += buf[2 * k] * c + buf[2 * k + 1] * s;
+        im += buf[2 * k + 1] * c - buf[2 * k] * s;
+    }
+
+    re /= n * 2048.0;
+    im /= n * 2048.0;
+
+    return 10 * log10(re * re + im * im);
+}
+
+static int test_image_rejection(void)
+{
+    const struct bladerf_iq_correction p = { 0, 31.0f, -17.5f, 1.08f, 4.0f };
+    const double freq  = 0.0625;
+    const double phase = p.phase * M_PI / 180.0;
+    int16_t *buf       = malloc(NUM_SAMPLES * 2 * sizeof(int16_t));
+    struct iq_corr *corr = NULL;
+    double before, after, dc_before, dc_after, signal;
+    int failures = 0;
+    size_t k;
+
+    if (buf == NULL || iq_corr_create(&corr) != 0) {
+        free(buf);
+        return 1;
+    }
+
+    /* A tone with the modelled impairments */
+    for (k = 0; k < NUM_SAMPLES; k++) {
+        const double i = 1500.0 * cos(2 * M_PI * freq * k);
+        const double q = 1500.0 * sin(2 * M_PI * freq * k);
+
+        buf[2 * k]     = (int16_t)lrint(i + p.dc_i);
+        buf[2 * k + 1] = (int16_t)lrint(
+            p.gain * (q * cos(phase) + i * sin(phase)) + p.dc_q);
+    }
+
+    before    = tone_power(buf, NUM_SAMPLES, -freq);
+    dc_before = tone_power(buf, NUM_SAMPLES, 0.0);
+
+    iq_corr_set(corr, &p);
+    iq_corr_process(corr, buf, buf, NUM_SAMPLES);
+
+    signal   = tone_power(buf, NUM_SAMPLES, freq);
+    after    = tone_power(buf, NUM_SAMPLES, -freq);
+    dc_after = tone_power(buf, NUM_SAMPLES, 0.0);
+
+    printf("  Image %.1f -> %.1f dBc, DC %.1f -> %.1f dBc\n",
+           before - signal, after - signal, dc_before - signal,
+           dc_after - signal);
+
+    if (after - signal > -60.0 || dc_after - signal > -60.0) {
+        printf("  FAILED\n");
+        failures++;
+    }
+
+    iq_corr_free(corr);
+    free(buf);
+
+    return failures;
+}
+
+static int test_table(void)
+{
+    const struct bladerf_iq_correction table[] = {
+        { 1000000000, 0.0f, 10.0f, 1.0f, 0.0f },
+        { 2000000000, 100.0f, 10.0f, 1.2f, -2.0f },
+        { 3000000000u, 200.0f, 10.0f, 1.0f, 2.0f },
+    };
+    const struct bladerf_iq_correction unordered[] = {
+        { 2000000000, 0.0f, 0.0f, 1.0f, 0.0f },
+        { 1000000000, 0.0f, 0.0f, 1.0f, 0.0f },
+    };
+    const struct bladerf_iq_correction invalid = { 0, 0.0f, 0.0f, 0.1f, 0.0f };
+    const struct {
+        bladerf_frequency frequency;
+        float dc_i;
+        float gain;
+    } checks[] = {
+        { 500000000, 0.0f, 1.0f },    { 1000000000, 0.0f, 1.0f },
+        { 1500000000, 50.0f, 1.1f },  { 2000000000, 100.0f, 1.2f },
+        { 2750000000u, 175.0f, 1.05f }, { 6000000000u, 200.0f, 1.0f },
+    };
+    struct bladerf_iq_correction p;
+    struct iq_corr *corr;
+    int failures = 0;
+    size_t i;
+
+    if (iq_corr_create(&corr) != 0) {
+        return 1;
+    }
+
+    /* Retuning without a table leaves the stage disabled */
+    iq_corr_retune(corr, 1000000000);
+    iq_corr_get(corr, &p);
+    if (p.dc_q != 0.0f) {
+        printf("  Retune without a table FAILED\n");
+        failures++;
+    }
+
+    if (iq_corr_set_table(corr, unordered, 2) != BLADERF_ERR_INVAL ||
+        iq_corr_set_table(corr, &invalid, 1) != BLADERF_ERR_INVAL ||
+        iq_corr_set(corr, &invalid) != BLADERF_ERR_INVAL) {
+        printf("  Invalid parameters were not rejected\n");
+        failures++;
+    }
+
+    if (iq_corr_set_table(corr, table, 3) != 0) {
+        printf("  Table rejected\n");
+        iq_corr_free(corr);
+        return failures + 1;
+    }
+
+    for (i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        iq_corr_retune(corr, checks[i].frequency);
+        iq_corr_get(corr, &p);
+
+        if (fabsf(p.dc_i - checks[i].dc_i) > 1e-3f ||
+            fabsf(p.gain - checks[i].gain) > 1e-5f || p.dc_q != 10.0f) {
+            printf("  Interpolation at %" PRIu64 " Hz FAILED: dc_i %f, "
+                   "gain %f\n",
+                   checks[i].frequency, p.dc_i, p.gain);
+            failures++;
+        }
+    }
+
+    iq_corr_free(corr);
+
+    return failures;
+}
+
+static void pack_le(uint8_t **p, uint64_t value, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        *(*p)++ = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void pack_float(uint8_t **p, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    pack_le(p, bits, sizeof(bits));
+}
+
+static int test_load_table(void)
+{
+    const struct bladerf_iq_correction table[] = {
+        { 1000000000, 0.0f, 10.0f, 1.0f, 0.0f },
+        { 2000000000, 100.0f, -10.0f, 1.2f, -2.0f },
+    };
+    uint8_t buf[0x0e + 2 * 24];
+    uint8_t *p = buf;
+    struct bladerf_iq_correction c;
+    struct iq_corr *corr;
+    int failures = 0;
+    size_t i;
+
+    pack_le(&p, 0x1ac2, 2);
+    pack_le(&p, 0, 4);
+    pack_le(&p, 1, 4);
+    pack_le(&p, 2, 4);
+
+    for (i = 0; i < 2; i++) {
+        pack_le(&p, table[i].frequency, 8);
+        pack_float(&p, table[i].dc_i);
+        pack_float(&p, table[i].dc_q);
+        pack_float(&p, table[i].gain);
+        pack_float(&p, table[i].phase);
+    }
+
+    if (iq_corr_create(&corr) != 0) {
+        return 1;
+    }
+
+    if (iq_corr_enabled(corr)) {
+        printf("  New stage is enabled\n");
+        failures++;
+    }
+
+    if (iq_corr_load_table(corr, buf, sizeof(buf) - 1) != BLADERF_ERR_INVAL) {
+        printf("  Truncated table was not rejected\n");
+        failures++;
+    }
+
+    buf[6] = 2;
+    if (iq_corr_load_table(corr, buf, sizeof(buf)) !=
+        BLADERF_ERR_UNSUPPORTED) {
+        printf("  Unknown table version was not rejected\n");
+        failures++;
+    }
+    buf[6] = 1;
+
+    buf[0] ^= 0xff;
+    if (iq_corr_load_table(corr, buf, sizeof(buf)) != BLADERF_ERR_INVAL) {
+        printf("  Bad table magic was not rejected\n");
+        failures++;
+    }
+    buf[0] ^= 0xff;
+
+    if (iq_corr_load_table(corr, buf, sizeof(buf)) != 0) {
+        printf("  Table load FAILED\n");
+        iq_corr_free(corr);
+        return failures + 1;
+    }
+
+    for (i = 0; i < 2; i++) {
+        iq_corr_retune(corr, table[i].frequency);
+        iq_corr_get(corr, &c);
+
+        if (c.dc_i != table[i].dc_i || c.dc_q != table[i].dc_q ||
+            c.gain != table[i].gain || c.phase != table[i].phase) {
+            printf("  Loaded entry %u does not match\n", (unsigned int)i);
+            failures++;
+        }
+    }
+
+    if (!iq_corr_enabled(corr)) {
+        printf("  Stage with a table is not enabled\n");
+        failures++;
+    }
+
+    iq_corr_set(corr, NULL);
+    if (iq_corr_enabled(corr)) {
+        printf("  Disabled stage is enabled\n");
+        failures++;
+    }
+
+    iq_corr_free(corr);
+
+    return failures;
+}
+
+static int test_messages(void)
+{
+    const size_t msg_size = 64, header_size = 16;
+    const size_t per_msg  = (msg_size - header_size) / 4;
+    const struct bladerf_iq_correction p = { 0, 5.0f, -5.0f, 1.0f, 0.0f };
+    uint8_t buf[4 * 64];
+    struct iq_corr *corr;
+    int failures = 0;
+    size_t m, k;
+
+    if (iq_corr_create(&corr) != 0) {
+        return 1;
+    }
+
+    for (m = 0; m < 4; m++) {
+        int16_t *s = (int16_t *)(buf + m * msg_size + header_size);
+
+        memset(buf + m * msg_size, 0xa5, header_size);
+        for (k = 0; k < 2 * per_msg; k++) {
+            s[k] = 100;
+        }
+    }
+
+    iq_corr_set(corr, &p);
+    iq_corr_process_msgs(corr, buf, 4, msg_size, header_size, per_msg);
+
+    for (m = 0; m < 4; m++) {
+        const int16_t *s = (const int16_t *)(buf + m * msg_size + header_size);
+
+        for (k = 0; k < header_size; k++) {
+            if (buf[m * msg_size + k] != 0xa5) {
+                failures++;
+            }
+        }
+
+        for (k = 0; k < per_msg; k++) {
+            if (s[2 * k] != 95 || s[2 * k + 1] != 105) {
+                failures++;
+            }
+        }
+    }
+
+    if (failures != 0) {
+        printf("  Metadata messages FAILED\n");
+    }
+
+    iq_corr_free(corr);
+
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    int failures = 0;
+
+    printf("Accuracy:\n");
+    failures += test_accuracy();
+
+    printf("Image rejection:\n");
+    failures += test_image_rejection();
+
+    printf("Tables:\n");
+    failures += test_table();
+    failures += test_load_table();
+
+    printf("Messages:\n");
+    failures += test_messages();
+
+    if (failures != 0) {
+        printf("IQ correction tests FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("IQ correction tests passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,291 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Checks the sync RX frequency shift and decimation stage with synthetic
+ * signals: the designed filter's pass and stop bands, the oscillator, channel
+ * separation, and that splitting a stream into buffers does not change the
+ * result.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libbladeRF.h>
+
+#include "streaming/rx_dsp.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define NUM_SAMPLES 65536
+#define AMPLITUDE 1000.0
+
+/* Fill a buffer with a tone at `freq` cycles per sample on channel `tone_ch`,
+ * and silence on any other channel */
+static void make_tone(int16_t *buf, size_t n, unsigned int num_channels,
+                      unsigned int tone_ch, double freq)
+{
+    size_t i;
+    unsigned int c;
+
+    for (i = 0; i < n; i++) {
+        for (c = 0; c < num_channels; c++) {
+            int16_t *s = &buf[2 * (i * num_channels + c)];
+
+            if (c == tone_ch) {
+                s[0] = (int16_t)lrint(AMPLITUDE * cos(2 * M_PI * freq * i));
+                s[1] = (int16_t)lrint(AMPLITUDE * sin(2 * M_PI * freq * i));
+            } else {
+                s[0] = 0;
+                s[1] = 0;
+            }
+        }
+    }
+}
+
+/* RMS amplitude of one channel's output, after the filter has settled */
+static double rms(const int16_t *buf, size_t n, unsigned int num_channels,
+                  unsigned int ch, size_t skip)
+{
+    double sum = 0.0;
+    size_t i;
+
+    for (i = skip; i < n; i++) {
+        const double re = buf[2 * (i * num_channels + ch)];
+        const double im = buf[2 * (i * num_channels + ch) + 1];
+        sum += re * re + im * im;
+    }
+
+    return sqrt(sum / (n - skip));
+}
+
+/* Decimate a tone, returning the output's RMS amplitude relative to the
+ * input's */
+static double tone_gain(unsigned int factor, double freq, double shift)
+{
+    int16_t *buf = malloc(NUM_SAMPLES * 2 * sizeof(int16_t));
+    struct rx_dsp *dsp;
+    double gain = -1.0;
+    size_t n;
+
+    if (buf == NULL) {
+        return gain;
+    }
+
+    if (rx_dsp_create(&dsp, BLADERF_FORMAT_SC16_Q11, 1, NUM_SAMPLES, factor,
+                      NULL, 0, shift) == 0) {
+        make_tone(buf, NUM_SAMPLES, 1, 0, freq);
+        n    = rx_dsp_process(dsp, buf, NUM_SAMPLES);
+        gain = rms(buf, n, 1, 0, 32) / AMPLITUDE;
+        rx_dsp_free(dsp);
+    }
+
+    free(buf);
+    return gain;
+}
+
+static int test_response(void)
+{
+    const unsigned int factors[] = { 2, 5, 10, 64 };
+    int failures = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(factors) / sizeof(factors[0]); i++) {
+        const unsigned int d = factors[i];
+
+        /* Well within the passband, and a tone that would alias to it. The
+         * stopband is limited by quantization to 1 LSB, at about -66 dB. */
+        const double pass = 20 * log10(tone_gain(d, 0.2 / d, 0.0));
+        const double stop = 20 * log10(fmax(tone_gain(d, 0.8 / d, 0.0),
+                                            0.5 / AMPLITUDE));
+
+        printf("  Decimation by %2u: passband %+.3f dB, stopband %.1f dB\n", d,
+               pass, stop);
+
+        if (fabs(pass) > 0.05 || stop > -60.0) {
+            printf("  FAILED\n");
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+static int test_shift(void)
+{
+    /* A tone at 0.3 cycles/sample is far outside the passband, unless it is
+     * shifted to near DC */
+    const double gain_shifted = tone_gain(16, 0.3, -0.3 + 0.01 / 16);
+    const double gain_none    = tone_gain(16, 0.3, 0.0);
+
+    printf("  Shifted tone gain %.4f, unshifted %.6f\n", gain_shifted,
+           gain_none);
+
+    if (fabs(gain_shifted - 1.0) > 0.01 || gain_none > 0.001) {
+        printf("  FAILED\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Processing a stream in buffers of varying sizes must match processing it in
+ * one buffer */
+static int test_buffering(unsigned int num_channels, bladerf_format format)
+{
+    const size_t n   = NUM_SAMPLES;
+    const size_t ssz = (format == BLADERF_FORMAT_SC8_Q7) ? 2 : 4;
+    uint8_t *input   = malloc(n * num_channels * ssz);
+    uint8_t *whole   = malloc(n * num_channels * ssz);
+    uint8_t *split   = malloc(n * num_channels * ssz);
+    uint8_t *chunk   = malloc(n * num_channels * ssz);
+    struct rx_dsp *a = NULL, *b = NULL;
+    size_t num_whole, num_split = 0, off = 0, i;
+    int failures = 0;
+    uint32_t seed = 12345;
+
+    if (input == NULL || whole == NULL || split == NULL || chunk == NULL ||
+        rx_dsp_create(&a, format, num_channels, n * num_channels, 7, NULL, 0,
+                      0.123) != 0 ||
+        rx_dsp_create(&b, format, num_channels, n * num_channels, 7, NULL, 0,
+                      0.123) != 0) {
+        failures = 1;
+        goto out;
+    }
+
+    for (i = 0; i < n * num_channels * ssz; i++) {
+        seed     = seed * 1664525u + 1013904223u;
+        input[i] = (uint8_t)(seed >> 24);
+    }
+
+    memcpy(whole, input, n * num_channels * ssz);
+    num_whole = rx_dsp_process(a, whole, n * num_channels);
+
+    while (off < n) {
+        size_t len, out;
+
+        seed = seed * 1664525u + 1013904223u;
+        len  = 1 + (seed >> 16) % 3000;
+        if (len > n - off) {
+            len = n - off;
+        }
+
+        memcpy(chunk, input + off * num_channels * ssz,
+               len * num_channels * ssz);
+        out = rx_dsp_process(b, chunk, len * num_channels);
+        memcpy(split + num_split * ssz, chunk, out * ssz);
+
+        num_split += out;
+        off += len;
+    }
+
+    if (num_whole != num_split ||
+        memcmp(whole, split, num_whole * ssz) != 0) {
+        printf("  %u channel %s buffering FAILED: %u vs %u samples\n",
+               num_channels, (ssz == 2) ? "SC8" : "SC16",
+               (unsigned int)num_whole, (unsigned int)num_split);
+        failures++;
+    }
+
+out:
+    rx_dsp_free(a);
+    rx_dsp_free(b);
+    free(input);
+    free(whole);
+    free(split);
+    free(chunk);
+
+    return failures;
+}
+
+static int test_channels(void)
+{
+    int16_t *buf = malloc(NUM_SAMPLES * 2 * 2 * sizeof(int16_t));
+    struct rx_dsp *dsp;
+    int failures = 0;
+    size_t n;
+
+    if (buf == NULL ||
+        rx_dsp_create(&dsp, BLADERF_FORMAT_SC16_Q11, 2, 2 * NUM_SAMPLES, 8,
+                      NULL, 0, 0.0) != 0) {
+        free(buf);
+        return 1;
+    }
+
+    make_tone(buf, NUM_SAMPLES, 2, 1, 0.01);
+    n = rx_dsp_process(dsp, buf, 2 * NUM_SAMPLES) / 2;
+
+    printf("  Channel 0 RMS %.3f, channel 1 RMS %.1f\n",
+           rms(buf, n, 2, 0, 32), rms(buf, n, 2, 1, 32));
+
+    if (n != NUM_SAMPLES / 8 || rms(buf, n, 2, 0, 0) != 0.0 ||
+        fabs(rms(buf, n, 2, 1, 32) / AMPLITUDE - 1.0) > 0.01) {
+        printf("  FAILED\n");
+        failures++;
+    }
+
+    rx_dsp_free(dsp);
+    free(buf);
+
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    int failures = 0;
+    struct rx_dsp *dsp;
+
+    printf("Filter response:\n");
+    failures += test_response();
+
+    printf("Frequency shift:\n");
+    failures += test_shift();
+
+    printf("Channels:\n");
+    failures += test_channels();
+
+    printf("Buffering:\n");
+    failures += test_buffering(1, BLADERF_FORMAT_SC16_Q11);
+    failures += test_buffering(2, BLADERF_FORMAT_SC16_Q11);
+    failures += test_buffering(1, BLADERF_FORMAT_SC8_Q7);
+
+    if (rx_dsp_create(&dsp, BLADERF_FORMAT_SC16_Q11_META, 1, 4096, 4, NULL, 0,
+                      0.0) != BLADERF_ERR_UNSUPPORTED) {
+        printf("Metadata format was not rejected\n");
+        failures++;
+    }
+
+    if (failures != 0) {
+        printf("RX decimation tests FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("RX decimation tests passed\n");
+    return EXIT_SUCCESS;
+}
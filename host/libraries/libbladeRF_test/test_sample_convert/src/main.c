@@ -0,0 +1,690 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Checks the sample conversion, byte swap and statistics functions against
+ * reference implementations, with every kernel set the host supports.
+ *
+ * Integer inputs are checked exhaustively. Float inputs are checked over a
+ * sweep that includes every rounding tie in the SC16 range, plus the limits
+ * and special values. Buffer lengths and offsets are varied so that the SIMD
+ * kernels' tails and unaligned accesses are covered.
+ *
+ * With -b, the throughput of each kernel set is reported instead.
+ */
+#include <float.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libbladeRF.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
+
+#define BENCH_SAMPLES (1 << 20)
+#define BENCH_ITERATIONS 64
+
+static const char *kernel_names[] = { "generic", "sse2", "avx2", "neon" };
+
+static const char *type_names[] = { "SC8", "SC16", "CF32", "CF64" };
+
+static const size_t type_sizes[] = { 2 * sizeof(int8_t), 2 * sizeof(int16_t),
+                                     2 * sizeof(float), 2 * sizeof(double) };
+
+#define OPTSTR "hb"
+static const struct option long_options[] = {
+    { "help",           no_argument,        0,  'h' },
+    { "benchmark",      no_argument,        0,  'b' },
+    { 0,                0,                  0,  0   },
+};
+
+static void print_usage(const char *argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("Checks sample conversions and statistics with each kernel set.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("    -b, --benchmark     Report the throughput of each kernel set\n");
+    printf("    -h, --help          Show this help text\n");
+    printf("\n");
+}
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state;
+}
+
+static int16_t ref_sc16_to_sc8(int16_t x)
+{
+    double v = nearbyint(x / 16.0);
+
+    if (v > 127) {
+        v = 127;
+    } else if (v < -128) {
+        v = -128;
+    }
+
+    return (int16_t)v;
+}
+
+static int16_t ref_cf32_to_sc16(float x)
+{
+    double v = nearbyint((double)x * 2048.0);
+
+    if (v > 2047) {
+        v = 2047;
+    } else if (v < -2048) {
+        v = -2048;
+    }
+
+    return (int16_t)v;
+}
+
+static int check_sc8_sc16(void)
+{
+    int8_t sc8[65536 + 16];
+    int16_t sc16[65536 + 16];
+    int failures = 0;
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        sc8[i] = (int8_t)(i - 128);
+    }
+
+    bladerf_convert_samples(BLADERF_SAMPLE_SC8, sc8, BLADERF_SAMPLE_SC16, sc16,
+                            128);
+
+    for (i = 0; i < 256; i++) {
+        if (sc16[i] != sc8[i] * 16) {
+            fprintf(stderr, "  SC8 %d -> SC16 %d\n", sc8[i], sc16[i]);
+            failures++;
+        }
+    }
+
+    for (i = 0; i < 65536; i++) {
+        sc16[i] = (int16_t)(i - 32768);
+    }
+
+    bladerf_convert_samples(BLADERF_SAMPLE_SC16, sc16, BLADERF_SAMPLE_SC8, sc8,
+                            32768);
+
+    for (i = 0; i < 65536; i++) {
+        if (sc8[i] != ref_sc16_to_sc8(sc16[i])) {
+            if (failures++ < 10) {
+                fprintf(stderr, "  SC16 %d -> SC8 %d, expected %d\n", sc16[i],
+                        sc8[i], ref_sc16_to_sc8(sc16[i]));
+            }
+        }
+    }
+
+    return failures;
+}
+
+static int check_sc16_cf32(void)
+{
+    static int16_t sc16[65536];
+    static float cf32[65536];
+    int failures = 0;
+    int i;
+
+    for (i = 0; i < 65536; i++) {
+        sc16[i] = (int16_t)(i - 32768);
+    }
+
+    bladerf_convert_samples(BLADERF_SAMPLE_SC16, sc16, BLADERF_SAMPLE_CF32,
+                            cf32, 32768);
+
+    for (i = 0; i < 65536; i++) {
+        if (cf32[i] != sc16[i] / 2048.0f) {
+            if (failures++ < 10) {
+                fprintf(stderr, "  SC16 %d -> CF32 %g\n", sc16[i], cf32[i]);
+            }
+        }
+    }
+
+    return failures;
+}
+
+static int check_cf32_sc16(void)
+{
+    /* Every multiple of 1/8 LSB in and somewhat beyond the SC16 range, which
+     * includes every tie */
+    const int sweep_min = -2100 * 8;
+    const int sweep_max = 2100 * 8;
+    const size_t sweep_len = sweep_max - sweep_min;
+
+    const float special[] = { 0.0f, -0.0f, 1.0f, -1.0f, 2.0f, -2.0f,
+                              FLT_MAX, -FLT_MAX, FLT_MIN, -FLT_MIN,
+                              (float)INFINITY, -(float)INFINITY,
+                              1e10f, -1e10f, 2047.5f / 2048, -2048.5f / 2048 };
+    const size_t num_special = sizeof(special) / sizeof(special[0]);
+
+    float *cf32;
+    int16_t *sc16;
+    size_t len, i;
+    int failures = 0;
+
+    len  = sweep_len + num_special + 4096;
+    len += len & 1;
+
+    cf32 = malloc(len * sizeof(cf32[0]));
+    sc16 = malloc(len * sizeof(sc16[0]));
+    if (cf32 == NULL || sc16 == NULL) {
+        free(cf32);
+        free(sc16);
+        return 1;
+    }
+
+    for (i = 0; i < sweep_len; i++) {
+        cf32[i] = (float)(sweep_min + (int)i) / (8 * 2048);
+    }
+
+    for (i = 0; i < num_special; i++) {
+        cf32[sweep_len + i] = special[i];
+    }
+
+    for (i = sweep_len + num_special; i < len; i++) {
+        cf32[i] = ((int32_t)rng() / 2147483648.0f) * 1.1f;
+    }
+
+    bladerf_convert_samples(BLADERF_SAMPLE_CF32, cf32, BLADERF_SAMPLE_SC16,
+                            sc16, len / 2);
+
+    for (i = 0; i < len; i++) {
+        if (sc16[i] != ref_cf32_to_sc16(cf32[i])) {
+            if (failures++ < 10) {
+                fprintf(stderr, "  CF32 %.9g -> SC16 %d, expected %d\n",
+                        cf32[i], sc16[i], ref_cf32_to_sc16(cf32[i]));
+            }
+        }
+    }
+
+    /* NaN converts to an unspecified value, but must not disturb neighbors */
+    cf32[0] = 0.5f;
+    cf32[1] = NAN;
+    cf32[2] = -0.5f;
+    bladerf_convert_samples(BLADERF_SAMPLE_CF32, cf32, BLADERF_SAMPLE_SC16,
+                            sc16, 2);
+    if (sc16[0] != 1024 || sc16[2] != -1024) {
+        fprintf(stderr, "  NaN conversion disturbed neighboring values\n");
+        failures++;
+    }
+
+    free(cf32);
+    free(sc16);
+
+    return failures;
+}
+
+/* Fill a buffer with values that are valid for its type */
+static void fill_random(bladerf_sample_type type, void *buf, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < 2 * n; i++) {
+        switch (type) {
+            case BLADERF_SAMPLE_SC8:
+                ((int8_t *)buf)[i] = (int8_t)rng();
+                break;
+            case BLADERF_SAMPLE_SC16:
+                ((int16_t *)buf)[i] = (int16_t)((rng() >> 16) % 4096) - 2048;
+                break;
+            case BLADERF_SAMPLE_CF32:
+                ((float *)buf)[i] = (int32_t)rng() / 2147483648.0f;
+                break;
+            case BLADERF_SAMPLE_CF64:
+                ((double *)buf)[i] = (int32_t)rng() / 2147483648.0;
+                break;
+        }
+    }
+}
+
+/* Check each conversion against a sequence of conversions between adjacent
+ * types, performed one sample at a time, for a range of lengths and
+ * alignments */
+static int check_chains(void)
+{
+    const size_t max_len = 1500;
+    const size_t max_size = max_len * 2 * sizeof(double) + 16;
+
+    uint8_t *in  = malloc(max_size);
+    uint8_t *out = malloc(max_size);
+    uint8_t *ref = malloc(max_size);
+    uint8_t *a   = malloc(2 * sizeof(double));
+    uint8_t *b   = malloc(2 * sizeof(double));
+    int failures = 0;
+    int from, to;
+
+    if (in == NULL || out == NULL || ref == NULL || a == NULL || b == NULL) {
+        failures = 1;
+        goto out;
+    }
+
+    for (from = BLADERF_SAMPLE_SC8; from <= BLADERF_SAMPLE_CF64; from++) {
+        for (to = BLADERF_SAMPLE_SC8; to <= BLADERF_SAMPLE_CF64; to++) {
+            const size_t lens[] = { 1, 3, 7, 8, 9, 15, 17, 33, 511, 513,
+                                    max_len };
+            size_t l;
+
+            for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+                const size_t len    = lens[l];
+                const size_t offset = l % 3;
+                uint8_t *src        = in + offset;
+                uint8_t *dst        = out + (offset ^ 1);
+                size_t i;
+                int status;
+
+                fill_random((bladerf_sample_type)from, src, len);
+
+                for (i = 0; i < len; i++) {
+                    int t    = from;
+                    int step = (to > from) ? 1 : -1;
+
+                    memcpy(a, src + i * type_sizes[from], type_sizes[from]);
+                    while (t != to) {
+                        bladerf_convert_samples((bladerf_sample_type)t, a,
+                                                (bladerf_sample_type)(t + step),
+                                                b, 1);
+                        memcpy(a, b, type_sizes[t + step]);
+                        t += step;
+                    }
+                    memcpy(ref + i * type_sizes[to], a, type_sizes[to]);
+                }
+
+                status = bladerf_convert_samples((bladerf_sample_type)from,
+                                                 src, (bladerf_sample_type)to,
+                                                 dst, len);
+
+                if (status != 0 ||
+                    memcmp(dst, ref, len * type_sizes[to]) != 0) {
+                    fprintf(stderr, "  %s -> %s of %u samples differs\n",
+                            type_names[from], type_names[to],
+                            (unsigned int)len);
+                    failures++;
+                }
+            }
+        }
+    }
+
+out:
+    free(in);
+    free(out);
+    free(ref);
+    free(a);
+    free(b);
+
+    return failures;
+}
+
+static int check_byteswap(void)
+{
+    const size_t len = 37;
+    uint8_t orig[37 * 16 + 1];
+    uint8_t buf[37 * 16 + 1];
+    int failures = 0;
+    int type;
+    size_t i, j;
+
+    for (i = 0; i < sizeof(orig); i++) {
+        orig[i] = (uint8_t)rng();
+    }
+
+    for (type = BLADERF_SAMPLE_SC8; type <= BLADERF_SAMPLE_CF64; type++) {
+        const size_t width = type_sizes[type] / 2;
+
+        /* Use an odd offset to check unaligned buffers */
+        memcpy(buf, orig, sizeof(buf));
+        bladerf_byteswap_samples((bladerf_sample_type)type, buf + 1, len);
+
+        for (i = 0; i < 2 * len; i++) {
+            for (j = 0; j < width; j++) {
+                if (buf[1 + i * width + j] !=
+                    orig[1 + i * width + (width - 1 - j)]) {
+                    failures++;
+                }
+            }
+        }
+
+        if (buf[0] != orig[0] ||
+            memcmp(&buf[1 + 2 * len * width], &orig[1 + 2 * len * width],
+                   sizeof(buf) - 1 - 2 * len * width) != 0) {
+            failures++;
+        }
+
+        if (failures != 0) {
+            fprintf(stderr, "  %s byte swap failed\n", type_names[type]);
+            break;
+        }
+    }
+
+    return failures;
+}
+
+/* Float statistics are accumulated in blocks of single precision sums, so
+ * allow for rounding relative to full scale */
+static bool close_to(double a, double b)
+{
+    return fabs(a - b) <= 1e-6 * fmax(fabs(b), 1.0);
+}
+
+static int check_stats_of(bladerf_sample_type type, const void *buf,
+                          size_t len)
+{
+    struct bladerf_sample_stats stats;
+    double sum_i = 0, sum_q = 0, sum_pwr = 0, peak = 0;
+    double scale = 1.0;
+    bool exact   = false;
+    size_t i;
+    int status;
+
+    for (i = 0; i < len; i++) {
+        double re, im, pwr;
+
+        switch (type) {
+            case BLADERF_SAMPLE_SC8:
+                re    = ((const int8_t *)buf)[2 * i];
+                im    = ((const int8_t *)buf)[2 * i + 1];
+                scale = 128.0;
+                exact = true;
+                break;
+            case BLADERF_SAMPLE_SC16:
+                re    = ((const int16_t *)buf)[2 * i];
+                im    = ((const int16_t *)buf)[2 * i + 1];
+                scale = 2048.0;
+                exact = true;
+                break;
+            case BLADERF_SAMPLE_CF32:
+                re = ((const float *)buf)[2 * i];
+                im = ((const float *)buf)[2 * i + 1];
+                break;
+            default:
+                re = ((const double *)buf)[2 * i];
+                im = ((const double *)buf)[2 * i + 1];
+                break;
+        }
+
+        pwr = re * re + im * im;
+        sum_i += re;
+        sum_q += im;
+        sum_pwr += pwr;
+        if (pwr > peak) {
+            peak = pwr;
+        }
+    }
+
+    status = bladerf_get_sample_stats(type, buf, len, &stats);
+    if (status != 0) {
+        fprintf(stderr, "  %s stats failed: %s\n", type_names[type],
+                bladerf_strerror(status));
+        return 1;
+    }
+
+    /* Integer sums are exact, and are scaled by powers of two */
+    if (exact ? (stats.mean_i != sum_i / len / scale ||
+                 stats.mean_q != sum_q / len / scale ||
+                 stats.power != sum_pwr / len / (scale * scale) ||
+                 stats.peak_power != peak / (scale * scale))
+              : (!close_to(stats.mean_i, sum_i / len) ||
+                 !close_to(stats.mean_q, sum_q / len) ||
+                 !close_to(stats.power, sum_pwr / len) ||
+                 !close_to(stats.peak_power, peak))) {
+        fprintf(stderr, "  %s stats of %u samples differ: "
+                "mean (%g, %g) power %g peak %g\n", type_names[type],
+                (unsigned int)len, stats.mean_i, stats.mean_q, stats.power,
+                stats.peak_power);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int check_stats(void)
+{
+    const size_t lens[] = { 1, 2, 3, 5, 8, 13, 1000, 200001 };
+    double *buf         = malloc(200001 * 2 * sizeof(double) + 16);
+    struct bladerf_sample_stats stats;
+    int failures = 0;
+    int16_t *sc16;
+    size_t l, i;
+    int type;
+
+    if (buf == NULL) {
+        return 1;
+    }
+
+    for (type = BLADERF_SAMPLE_SC8; type <= BLADERF_SAMPLE_CF64; type++) {
+        for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            void *p = (uint8_t *)buf + (l & 1) * type_sizes[type] / 2;
+
+            fill_random((bladerf_sample_type)type, p, lens[l]);
+            failures += check_stats_of((bladerf_sample_type)type, p, lens[l]);
+        }
+    }
+
+    /* Values at the limits of int16_t, which stress the accumulators */
+    sc16 = (int16_t *)buf;
+    for (i = 0; i < 2 * 200001; i++) {
+        sc16[i] = (i % 3 == 0) ? INT16_MAX : INT16_MIN;
+    }
+    failures += check_stats_of(BLADERF_SAMPLE_SC16, sc16, 200001);
+
+    if (bladerf_get_sample_stats(BLADERF_SAMPLE_SC16, buf, 0, &stats) !=
+        BLADERF_ERR_INVAL) {
+        fprintf(stderr, "  Stats of no samples did not fail\n");
+        failures++;
+    }
+
+    free(buf);
+
+    return failures;
+}
+
+static int run_checks(void)
+{
+    int failures = 0;
+    size_t k;
+    int status;
+
+    if (bladerf_set_sample_kernels("unknown") != BLADERF_ERR_INVAL) {
+        fprintf(stderr, "Selecting an unknown kernel set did not fail\n");
+        failures++;
+    }
+
+    for (k = 0; k < sizeof(kernel_names) / sizeof(kernel_names[0]); k++) {
+        int f = 0;
+
+        status = bladerf_set_sample_kernels(kernel_names[k]);
+        if (status == BLADERF_ERR_UNSUPPORTED) {
+            printf("%-8s unsupported\n", kernel_names[k]);
+            continue;
+        } else if (status != 0 ||
+                   strcmp(bladerf_get_sample_kernels(), kernel_names[k])) {
+            fprintf(stderr, "Failed to select %s kernels\n", kernel_names[k]);
+            failures++;
+            continue;
+        }
+
+        f += check_sc8_sc16();
+        f += check_sc16_cf32();
+        f += check_cf32_sc16();
+        f += check_chains();
+        f += check_byteswap();
+        f += check_stats();
+
+        printf("%-8s %s\n", kernel_names[k], (f == 0) ? "passed" : "FAILED");
+        failures += f;
+    }
+
+    bladerf_set_sample_kernels(NULL);
+
+    return failures;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int run_benchmark(void)
+{
+    const struct {
+        bladerf_sample_type in, out;
+    } convs[] = {
+        { BLADERF_SAMPLE_SC16, BLADERF_SAMPLE_CF32 },
+        { BLADERF_SAMPLE_CF32, BLADERF_SAMPLE_SC16 },
+        { BLADERF_SAMPLE_SC8, BLADERF_SAMPLE_SC16 },
+        { BLADERF_SAMPLE_SC16, BLADERF_SAMPLE_SC8 },
+        { BLADERF_SAMPLE_CF32, BLADERF_SAMPLE_CF64 },
+        { BLADERF_SAMPLE_SC8, BLADERF_SAMPLE_CF64 },
+    };
+    const size_t num_convs = sizeof(convs) / sizeof(convs[0]);
+
+    void *in  = malloc(BENCH_SAMPLES * 2 * sizeof(double));
+    void *out = malloc(BENCH_SAMPLES * 2 * sizeof(double));
+    size_t k, c;
+    int i;
+
+    if (in == NULL || out == NULL) {
+        free(in);
+        free(out);
+        return 1;
+    }
+
+    printf("Throughput in Msamples/s, over %d x %d samples\n\n",
+           BENCH_ITERATIONS, BENCH_SAMPLES);
+    printf("%-8s", "");
+    for (c = 0; c < num_convs; c++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%s>%s", type_names[convs[c].in],
+                 type_names[convs[c].out]);
+        printf("%11s", name);
+    }
+    printf("%11s%11s%11s\n", "SC16 swap", "SC16 stat", "CF32 stat");
+
+    for (k = 0; k < sizeof(kernel_names) / sizeof(kernel_names[0]); k++) {
+        struct bladerf_sample_stats stats;
+        double start;
+
+        if (bladerf_set_sample_kernels(kernel_names[k]) != 0) {
+            continue;
+        }
+
+        printf("%-8s", kernel_names[k]);
+
+        for (c = 0; c < num_convs; c++) {
+            fill_random(convs[c].in, in, BENCH_SAMPLES);
+
+            start = now_s();
+            for (i = 0; i < BENCH_ITERATIONS; i++) {
+                bladerf_convert_samples(convs[c].in, in, convs[c].out, out,
+                                        BENCH_SAMPLES);
+            }
+            printf("%11.1f", BENCH_ITERATIONS * (BENCH_SAMPLES / 1e6) /
+                                 (now_s() - start));
+        }
+
+        start = now_s();
+        for (i = 0; i < BENCH_ITERATIONS; i++) {
+            bladerf_byteswap_samples(BLADERF_SAMPLE_SC16, in, BENCH_SAMPLES);
+        }
+        printf("%11.1f",
+               BENCH_ITERATIONS * (BENCH_SAMPLES / 1e6) / (now_s() - start));
+
+        fill_random(BLADERF_SAMPLE_SC16, in, BENCH_SAMPLES);
+        start = now_s();
+        for (i = 0; i < BENCH_ITERATIONS; i++) {
+            bladerf_get_sample_stats(BLADERF_SAMPLE_SC16, in, BENCH_SAMPLES,
+                                     &stats);
+        }
+        printf("%11.1f",
+               BENCH_ITERATIONS * (BENCH_SAMPLES / 1e6) / (now_s() - start));
+
+        fill_random(BLADERF_SAMPLE_CF32, in, BENCH_SAMPLES);
+        start = now_s();
+        for (i = 0; i < BENCH_ITERATIONS; i++) {
+            bladerf_get_sample_stats(BLADERF_SAMPLE_CF32, in, BENCH_SAMPLES,
+                                     &stats);
+        }
+        printf("%11.1f\n",
+               BENCH_ITERATIONS * (BENCH_SAMPLES / 1e6) / (now_s() - start));
+    }
+
+    bladerf_set_sample_kernels(NULL);
+
+    free(in);
+    free(out);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    bool benchmark = false;
+    int c;
+
+    while ((c = getopt_long(argc, argv, OPTSTR, long_options, NULL)) != -1) {
+        switch (c) {
+            case 'b':
+                benchmark = true;
+                break;
+
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (benchmark) {
+        return (run_benchmark() == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    printf("Default kernels: %s\n", bladerf_get_sample_kernels());
+
+    if (run_checks() != 0) {
+        printf("Sample conversion tests FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Sample conversion tests passed\n");
+    return EXIT_SUCCESS;
+}
@@ -22,6 +22,13 @@
 #include <errno.h>
 #include <limits.h>
 #include <libbladeRF.h>
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
 
 #include "dc_calibration.h"
 #include "rel_assert.h"
@@ -531,6 +538,9 @@ static int cal_table(struct cli_state *s, int argc, char **argv)
     struct dc_calibration_params *params = NULL;
     size_t num_params = 0;
 
+    struct timespec t_start, t_end;
+    double elapsed;
+
     /* The XB-200 does not affect the minimum, as we're tuning the LMS here. */
     unsigned int f_min = BLADERF_FREQUENCY_MIN;
     unsigned int f_inc = 10000000;
@@ -668,11 +678,21 @@ static int cal_table(struct cli_state *s, int argc, char **argv)
         goto out;
     }
 
+    clock_gettime(CLOCK_REALTIME, &t_start);
+
     status = dc_calibration(s->dev, module, params, num_params, true);
     if (status != 0) {
         goto out;
     }
 
+    clock_gettime(CLOCK_REALTIME, &t_end);
+
+    elapsed = (t_end.tv_sec - t_start.tv_sec) +
+              (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+
+    printf("\n  Calibrated %u frequencies in %.1f s (%.1f ms per frequency).\n",
+           (unsigned int) num_params, elapsed, 1e3 * elapsed / num_params);
+
     status = save_table_results(filename, s->dev, module, params, num_params);
     if (status == 0) {
         printf("\n  Done.\n\n");
@@ -29,110 +29,44 @@
 #include "host_config.h"
 #include "minmax.h"
 #include "rel_assert.h"
+#include "rx_writer.h"
+#include "rxtx_csv.h"
 #include "rxtx_impl.h"
 
-#if BLADERF_OS_WINDOWS
-#define EOL "\r\n"
-#else
-#define EOL "\n"
-#endif
-
 /**
- * Peform adjustments on received samples before writing them out:
- *  (1) Mask off FPGA markers
- *  (2) Convert little-endian samples to host endianness, if needed.
+ * Convert little-endian samples to host endianness, if needed, before writing
+ * them out.
  *
  *  @param  buff    Sample buffer
  *  @param  n       Number of samples
  */
 static inline void sc16q11_sample_fixup(int16_t *buf, size_t n)
 {
-    size_t i;
-
-    for (i = 0; i < n; i++) {
-        /* I - Mask off the marker and sign extend */
-        //        *buf &= (*buf) & 0x0fff;
-        //        if (*buf & 0x800) {
-        //            *buf |= 0xf000;
-        //        }
-
-        *buf = LE16_TO_HOST(*buf);
-        buf++;
-
-        /* Q - Mask off the marker and sign extend */
-        //        *buf = HOST_TO_LE16(*buf) & 0x0fff;
-        //        if (*buf & 0x800) {
-        //            *buf |= 0xf000;
-        //        }
-
-        *buf = LE16_TO_HOST(*buf);
-        buf++;
-    }
-}
-
-/*
- * @pre data_mgmt lock is held
- *
- * returns 0 on success, CLI_RET_* on failure (and calls set_last_error()) */
-static int rx_write_bin_sc16q11(struct cli_state *s,
-                                void *samples,
-                                size_t n_samples)
-{
-    size_t status;
-    struct rxtx_data *rx = s->rx;
-
-    MUTEX_LOCK(&rx->file_mgmt.file_lock);
-    status = fwrite(samples, sizeof(int16_t),
-                    2 * n_samples, /* I and Q are each an int16_t */
-                    rx->file_mgmt.file);
-    MUTEX_UNLOCK(&rx->file_mgmt.file_lock);
-
-    if (status != (2 * n_samples)) {
-        set_last_error(&rx->last_error, ETYPE_CLI, CLI_RET_FILEOP);
-        return CLI_RET_FILEOP;
-    } else {
-        return 0;
-    }
+#if BLADERF_BIG_ENDIAN
+    bladerf_byteswap_samples(BLADERF_SAMPLE_SC16, buf, n);
+#else
+    (void)buf;
+    (void)n;
+#endif
 }
 
-/*
- * @pre data_mgmt lock is held
+/* Called on the RX writer thread.
  *
  * returns 0 on success, CLI_RET_* on failure (and calls set_last_error()) */
-static int rx_write_bin_sc8q7(struct cli_state *s,
-                                void *samples,
-                                size_t n_samples)
-{
-    size_t status;
-    struct rxtx_data *rx = s->rx;
-
-    MUTEX_LOCK(&rx->file_mgmt.file_lock);
-    status = fwrite(samples, sizeof(int8_t),
-                    2 * n_samples, /* I and Q are each an int8_t */
-                    rx->file_mgmt.file);
-    MUTEX_UNLOCK(&rx->file_mgmt.file_lock);
-
-    if (status != (2 * n_samples)) {
-        set_last_error(&rx->last_error, ETYPE_CLI, CLI_RET_FILEOP);
-        return CLI_RET_FILEOP;
-    } else {
-        return 0;
-    }
-}
-
-/* returns 0 on success, CLI_RET_* on failure (and calls set_last_error()) */
 static int rx_write_csv(struct cli_state *s,
                         void *samples,
                         size_t n_samples)
 {
-    const size_t MAXLEN = 128; /* max line length (with newline and null) */
+    /* Sample times formatted per fwrite() */
+    const size_t LINES_PER_WRITE = 8192;
+
+    const size_t sample_size = (s->sample_format == BLADERF_FORMAT_SC8_Q7)
+                                   ? 2 * sizeof(int8_t)
+                                   : 2 * sizeof(int16_t);
 
-    char *line = NULL;
-    char *tmp  = NULL;
-    int8_t *samples_sc8q7;
-    int16_t *samples_sc16q11;
+    char *text = NULL;
     struct rxtx_data *rx = s->rx;
-    size_t i, j, nchans;
+    size_t i, n, len, nchans = 0;
     int status = 0;
 
     MUTEX_LOCK(&rx->data_mgmt.lock);
@@ -152,77 +86,38 @@ static int rx_write_csv(struct cli_state *s,
     MUTEX_UNLOCK(&rx->data_mgmt.lock);
 
     if (status != 0) {
-        goto out;
+        return status;
     }
 
-    line = calloc(MAXLEN, 1);
-    if (NULL == line) {
-        status = errno;
-        set_last_error(&rx->last_error, ETYPE_ERRNO, status);
-        goto out;
-    }
+    /* Only whole sample times make a line */
+    n_samples -= n_samples % nchans;
 
-    tmp = calloc(MAXLEN, 1);
-    if (NULL == tmp) {
+    text = malloc(rxtx_csv_max_len(LINES_PER_WRITE * nchans, nchans));
+    if (NULL == text) {
         status = errno;
         set_last_error(&rx->last_error, ETYPE_ERRNO, status);
-        goto out;
+        return CLI_RET_MEM;
     }
 
     MUTEX_LOCK(&rx->file_mgmt.file_lock);
 
-    if (s->sample_format == BLADERF_FORMAT_SC8_Q7) {
-        samples_sc8q7 = (int8_t*)samples;
-        // Output 2 columns for each enabled channel
-        // (2 cols for BLADERF_RX_X1, 4 cols for BLADERF_RX_X2, etc)
-        for (i = 0; i < 2 * n_samples; i += 2 * nchans) {
-            memset(line, 0, MAXLEN);
-            memset(tmp, 0, MAXLEN);
-
-            for (j = 0; j < 2 * nchans; j += 2) {
-                snprintf(tmp, MAXLEN, "%s%d, %d", (j > 0) ? ", " : "",
-                    samples_sc8q7[i + j], samples_sc8q7[i + j + 1]);
-                strncat(line, tmp, MAXLEN - 1);
-            }
+    // Output 2 columns for each enabled channel
+    // (2 cols for BLADERF_RX_X1, 4 cols for BLADERF_RX_X2, etc)
+    for (i = 0; i < n_samples; i += n) {
+        n   = min_sz(n_samples - i, LINES_PER_WRITE * nchans);
+        len = rxtx_csv_format(text, (uint8_t *)samples + i * sample_size, n,
+                              nchans, s->sample_format);
 
-            strncat(line, EOL, MAXLEN - 1);
-
-            if (fputs(line, rx->file_mgmt.file) < 0) {
-                set_last_error(&rx->last_error, ETYPE_ERRNO, errno);
-                status = CLI_RET_FILEOP;
-                break;
-            }
-        }
-    }
-    else {
-        samples_sc16q11 = (int16_t*)samples;
-        // Output 2 columns for each enabled channel
-        // (2 cols for BLADERF_RX_X1, 4 cols for BLADERF_RX_X2, etc)
-        for (i = 0; i < 2 * n_samples; i += 2 * nchans) {
-            memset(line, 0, MAXLEN);
-            memset(tmp, 0, MAXLEN);
-
-            for (j = 0; j < 2 * nchans; j += 2) {
-                snprintf(tmp, MAXLEN, "%s%d, %d", (j > 0) ? ", " : "",
-                    samples_sc16q11[i + j], samples_sc16q11[i + j + 1]);
-                strncat(line, tmp, MAXLEN - 1);
-            }
-
-            strncat(line, EOL, MAXLEN - 1);
-
-            if (fputs(line, rx->file_mgmt.file) < 0) {
-                set_last_error(&rx->last_error, ETYPE_ERRNO, errno);
-                status = CLI_RET_FILEOP;
-                break;
-            }
+        if (fwrite(text, 1, len, rx->file_mgmt.file) != len) {
+            set_last_error(&rx->last_error, ETYPE_ERRNO, errno);
+            status = CLI_RET_FILEOP;
+            break;
         }
     }
 
     MUTEX_UNLOCK(&rx->file_mgmt.file_lock);
 
-out:
-    free(line);
-    free(tmp);
+    free(text);
 
     return status;
 }
@@ -230,11 +125,20 @@ out:
 static int rx_task_exec_running(struct cli_state *s)
 {
     int status = 0;
+    int writer_status;
     int samples_per_buffer;
-    void *samples;
+    uint8_t *block = NULL;
+    size_t block_samples;
+    size_t block_fill = 0;
+    size_t sample_size;
     size_t num_samples;
     size_t samples_read = 0;
     struct rxtx_data *rx = s->rx;
+    struct rx_params *rx_params = rx->params;
+    struct rx_writer *writer;
+    struct rx_writer_config writer_config;
+    struct rx_writer_stats writer_stats;
+    bool prealloc;
     int (*write_samples)(struct cli_state *s, void *samples, size_t n);
     unsigned int timeout_ms;
 
@@ -245,15 +149,32 @@ static int rx_task_exec_running(struct cli_state *s)
     MUTEX_UNLOCK(&rx->data_mgmt.lock);
 
     MUTEX_LOCK(&rx->param_lock);
-    num_samples   = ((struct rx_params *)rx->params)->n_samples;
-    write_samples = ((struct rx_params *)rx->params)->write_samples;
+    num_samples   = rx_params->n_samples;
+    write_samples = rx_params->write_samples;
+    writer_config = rx_params->writer;
+    prealloc      = rx_params->prealloc;
     MUTEX_UNLOCK(&rx->param_lock);
 
-    /* Allocate a buffer for the block of samples */
-    samples = malloc(samples_per_buffer * sizeof(uint16_t) * 2);
-    if (samples == NULL) {
-        status = errno;
-        set_last_error(&rx->last_error, ETYPE_ERRNO, status);
+    sample_size = (s->sample_format == BLADERF_FORMAT_SC8_Q7)
+                      ? 2 * sizeof(int8_t)
+                      : 2 * sizeof(int16_t);
+
+    block_samples = writer_config.block_size / sample_size;
+
+    /* Preallocation needs to know how much we'll write */
+    if (prealloc && write_samples == NULL && num_samples != 0) {
+        writer_config.prealloc = (uint64_t)num_samples * sample_size;
+    } else {
+        writer_config.prealloc = 0;
+    }
+
+    /* Hand the output file to the writer thread, so that disk stalls don't
+     * hold up the stream */
+    status = rx_writer_start(s, &writer_config, sample_size, write_samples,
+                             &writer);
+    if (status != 0) {
+        set_last_error(&rx->last_error, ETYPE_CLI, status);
+        return status;
     }
 
     /*
@@ -261,6 +182,8 @@ static int rx_task_exec_running(struct cli_state *s)
      * have been read
      */
     while (status == 0 && (num_samples == 0 || samples_read < num_samples)) {
+        size_t to_read, to_write;
+
         /*
          * Stop stream on STOP or SHUTDOWN, but only clear STOP. This will keep
          * the SHUTDOWN request around so we can read it when determining our
@@ -271,33 +194,61 @@ static int rx_task_exec_running(struct cli_state *s)
             break;
         }
 
-        /* Read the samples into the sample buffer */
-        status = bladerf_sync_rx(s->dev, samples, samples_per_buffer, NULL,
-                                 timeout_ms);
+        /* Fill blocks across as many transfers as it takes */
+        if (block == NULL) {
+            block = rx_writer_get_block(writer);
+            if (block == NULL) {
+                /* The writer failed; rx_writer_stop() reports why */
+                break;
+            }
+            block_fill = 0;
+        }
+
+        to_read = min_sz(samples_per_buffer, block_samples - block_fill);
+
+        /* Read the samples into the current block */
+        status = bladerf_sync_rx(s->dev, block + block_fill * sample_size,
+                                 (unsigned int)to_read, NULL, timeout_ms);
 
         if (status != 0) {
             set_last_error(&rx->last_error, ETYPE_BLADERF, status);
+            break;
+        }
+
+        if (num_samples == 0) {
+            to_write = to_read;
         } else {
-            size_t to_write =
-                min_sz(samples_per_buffer, (num_samples - samples_read));
+            to_write = min_sz(to_read, num_samples - samples_read);
+        }
 
-            /* Write the samples to the output file */
-            sc16q11_sample_fixup(samples, to_write);
-            status = write_samples(s, samples, to_write);
+        sc16q11_sample_fixup((int16_t *)(block + block_fill * sample_size),
+                             to_write);
 
-            if (status != 0) {
-                set_last_error(&rx->last_error, ETYPE_CLI, status);
-            }
+        block_fill += to_write;
+        samples_read += to_read;
+
+        if (block_fill == block_samples ||
+            (num_samples != 0 && samples_read >= num_samples)) {
+            rx_writer_put_block(writer, block_fill * sample_size);
+            block = NULL;
         }
+    }
 
-        samples_read += samples_per_buffer;
+    /* Keep whatever was received before a stop request or error */
+    if (block != NULL) {
+        rx_writer_put_block(writer, block_fill * sample_size);
     }
 
-    /* Free the sample buffer */
-    if (samples != NULL) {
-        free(samples);
+    writer_status = rx_writer_stop(writer, &writer_stats);
+    if (status == 0) {
+        status = writer_status;
     }
 
+    MUTEX_LOCK(&rx->param_lock);
+    rx_params->writer_stats       = writer_stats;
+    rx_params->writer_stats_valid = true;
+    MUTEX_UNLOCK(&rx->param_lock);
+
     return status;
 }
 
@@ -344,12 +295,10 @@ void *rx_task(void *cli_state_arg)
                         rx_params->write_samples = rx_write_csv;
                         break;
 
+                    /* Binary samples are written out as-is by the writer */
                     case RXTX_FMT_BIN_SC16Q11:
-                        rx_params->write_samples = rx_write_bin_sc16q11;
-                        break;
-
                     case RXTX_FMT_BIN_SC8Q7:
-                        rx_params->write_samples = rx_write_bin_sc8q7;
+                        rx_params->write_samples = NULL;
                         break;
 
                     default:
@@ -395,12 +344,10 @@ void *rx_task(void *cli_state_arg)
                 if (status < 0) {
                     set_last_error(&rx->last_error, ETYPE_BLADERF, status);
                 } else {
+                    /* This records its own errors, which may be file or
+                     * CLI errors rather than libbladeRF ones */
                     status = rx_task_exec_running(cli_state);
 
-                    if (status < 0) {
-                        set_last_error(&rx->last_error, ETYPE_BLADERF, status);
-                    }
-
                     disable_status = rxtx_apply_channels(cli_state, rx, false);
 
                     if (status == 0 && disable_status < 0) {
@@ -475,10 +422,18 @@ static int rx_cmd_start(struct cli_state *s)
 static void rx_print_config(struct rxtx_data *rx)
 {
     size_t n_samples;
+    bool prealloc;
+    bool stats_valid;
+    struct rx_writer_config writer;
+    struct rx_writer_stats stats;
     struct rx_params *rx_params = rx->params;
 
     MUTEX_LOCK(&rx->param_lock);
-    n_samples = rx_params->n_samples;
+    n_samples   = rx_params->n_samples;
+    prealloc    = rx_params->prealloc;
+    writer      = rx_params->writer;
+    stats       = rx_params->writer_stats;
+    stats_valid = rx_params->writer_stats_valid;
     MUTEX_UNLOCK(&rx->param_lock);
 
     printf("\n");
@@ -495,6 +450,23 @@ static void rx_print_config(struct rxtx_data *rx)
     }
     rxtx_print_stream_info(rx, "  ", "\n");
 
+    printf("  Writer queue: %u blocks of %u KiB\n", writer.num_blocks,
+           (unsigned int)(writer.block_size / 1024));
+    printf("  Writer options: direct=%s, prealloc=%s, uring=%s\n",
+           writer.direct ? "on" : "off", prealloc ? "on" : "off",
+           writer.uring ? "on" : "off");
+
+    /* Lets the user tell whether the disk kept up with the last capture */
+    if (stats_valid) {
+        printf("  Last capture: %" PRIu64 " bytes written%s%s\n",
+               stats.bytes, stats.direct ? ", direct" : "",
+               stats.uring ? ", io_uring" : "");
+        printf("  Last capture queue high-water: %u of %u blocks, "
+               "%u stall%s\n",
+               stats.high_water, stats.num_blocks, stats.stalls,
+               stats.stalls == 1 ? "" : "s");
+    }
+
     printf("\n");
 }
 
@@ -534,6 +506,62 @@ static int rx_cmd_config(struct cli_state *s, int argc, char **argv)
                     cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
                     return CLI_RET_INVPARAM;
                 }
+            } else if (!strcasecmp("queue", argv[i])) {
+                /* Configure # of blocks queued for the writer thread */
+                unsigned int n;
+                bool ok;
+
+                n = str2uint(val, RX_WRITER_BLOCKS_MIN, RX_WRITER_BLOCKS_MAX,
+                             &ok);
+
+                if (ok) {
+                    MUTEX_LOCK(&s->rx->param_lock);
+                    rx_params->writer.num_blocks = n;
+                    MUTEX_UNLOCK(&s->rx->param_lock);
+                } else {
+                    cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
+                    return CLI_RET_INVPARAM;
+                }
+            } else if (!strcasecmp("blocksize", argv[i])) {
+                /* Configure size of each write, in bytes */
+                unsigned int n;
+                bool ok;
+
+                n = str2uint_suffix(val, RX_WRITER_BLOCK_SIZE_MIN,
+                                    RX_WRITER_BLOCK_SIZE_MAX, rxtx_kmg_suffixes,
+                                    (int)rxtx_kmg_suffixes_len, &ok);
+
+                if (ok && n % RX_WRITER_ALIGNMENT == 0) {
+                    MUTEX_LOCK(&s->rx->param_lock);
+                    rx_params->writer.block_size = n;
+                    MUTEX_UNLOCK(&s->rx->param_lock);
+                } else {
+                    cli_err(s, argv[0],
+                            "Invalid value for \"%s\" (%s). It must be a "
+                            "multiple of %d.\n",
+                            argv[i], val, RX_WRITER_ALIGNMENT);
+                    return CLI_RET_INVPARAM;
+                }
+            } else if (!strcasecmp("direct", argv[i]) ||
+                       !strcasecmp("prealloc", argv[i]) ||
+                       !strcasecmp("uring", argv[i])) {
+                /* Configure writer I/O options */
+                bool enable;
+
+                if (str2bool(val, &enable) != 0) {
+                    cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
+                    return CLI_RET_INVPARAM;
+                }
+
+                MUTEX_LOCK(&s->rx->param_lock);
+                if (!strcasecmp("direct", argv[i])) {
+                    rx_params->writer.direct = enable;
+                } else if (!strcasecmp("prealloc", argv[i])) {
+                    rx_params->prealloc = enable;
+                } else {
+                    rx_params->writer.uring = enable;
+                }
+                MUTEX_UNLOCK(&s->rx->param_lock);
             } else if (!strcasecmp("channel", argv[i])) {
                 /* Configure RX channels */
                 status = rxtx_handle_channel_list(s, s->rx, val);
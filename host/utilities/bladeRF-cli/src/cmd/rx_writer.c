@@ -0,0 +1,719 @@
+/*
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* O_DIRECT, fallocate() */
+#endif
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if BLADERF_OS_WINDOWS
+#include <malloc.h>
+#endif
+
+/* IORING_OP_WRITE arrived in the same kernel release as this feature flag */
+#if BLADERF_OS_LINUX && HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#ifdef IORING_FEAT_RW_CUR_POS
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define RX_WRITER_URING 1
+#endif
+#endif
+
+#ifndef RX_WRITER_URING
+#define RX_WRITER_URING 0
+#endif
+
+#include "rel_assert.h"
+#include "rx_writer.h"
+#include "rxtx_impl.h"
+#include "thread.h"
+
+/* Maximum # of writes in flight at once via io_uring */
+#define RX_WRITER_URING_DEPTH 32
+
+#if RX_WRITER_URING
+struct rx_uring {
+    int fd;
+    unsigned int entries;
+    unsigned int inflight;
+
+    void *sq_map;
+    size_t sq_map_len;
+    void *cq_map;
+    size_t cq_map_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+#endif
+
+struct rx_writer {
+    struct cli_state *s;
+    int (*format)(struct cli_state *s, void *samples, size_t n);
+    size_t sample_size;
+    size_t block_size;
+    unsigned int num_blocks;
+
+    uint8_t *pool;       /* num_blocks * block_size bytes */
+    size_t *len;         /* Bytes filled in each block */
+    uint64_t *offset;    /* File offset of each block, for positioned I/O */
+    unsigned int *queue; /* Ring of filled blocks, in capture order */
+    unsigned int *free;  /* Stack of empty blocks */
+    unsigned int cur;    /* Block held by the RX task */
+
+    /* The following are protected by 'lock' */
+    MUTEX lock;
+    COND block_queued;
+    COND block_freed;
+    unsigned int queue_head;
+    unsigned int num_queued;
+    unsigned int num_free;
+    unsigned int pending; /* Blocks queued or being written */
+    bool stopping;
+    int status;
+    struct rx_writer_stats stats;
+
+    /* The following are only accessed by the writer thread once started */
+    THREAD thread;
+    bool positioned;     /* Write with pwrite()/io_uring at 'pos' */
+    bool direct;         /* O_DIRECT is currently set */
+    uint64_t pos;
+#if BLADERF_OS_LINUX
+    int fd;
+    bool preallocated;
+#endif
+#if RX_WRITER_URING
+    bool uring;
+    struct rx_uring ring;
+#endif
+};
+
+static void *alloc_aligned(size_t size)
+{
+#if BLADERF_OS_WINDOWS
+    return _aligned_malloc(size, RX_WRITER_ALIGNMENT);
+#else
+    void *ptr;
+    return posix_memalign(&ptr, RX_WRITER_ALIGNMENT, size) == 0 ? ptr : NULL;
+#endif
+}
+
+static void free_aligned(void *ptr)
+{
+#if BLADERF_OS_WINDOWS
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/* Record the first failure and wake the RX task if it's waiting on us */
+static void writer_fail(struct rx_writer *w, enum error_type type, int error,
+                        int status)
+{
+    MUTEX_LOCK(&w->lock);
+    if (w->status == 0) {
+        w->status = status;
+        if (type != ETYPE_CLI) {
+            set_last_error(&w->s->rx->last_error, type, error);
+        }
+    }
+    COND_SIGNAL(&w->block_freed);
+    MUTEX_UNLOCK(&w->lock);
+}
+
+static void release_block(struct rx_writer *w, unsigned int idx)
+{
+    MUTEX_LOCK(&w->lock);
+    w->free[w->num_free++] = idx;
+    w->pending--;
+    COND_SIGNAL(&w->block_freed);
+    MUTEX_UNLOCK(&w->lock);
+}
+
+#if RX_WRITER_URING
+static int uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete)
+{
+    long ret;
+    unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret < 0 ? -errno : (int)ret;
+}
+
+static bool uring_init(struct rx_uring *ring, unsigned int entries)
+{
+    struct io_uring_params p;
+    uint8_t *sq, *cq;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+        goto fail;
+    }
+
+    ring->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ring->cq_map_len =
+        p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_len > ring->sq_map_len) {
+            ring->sq_map_len = ring->cq_map_len;
+        }
+        ring->cq_map_len = 0;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        goto fail;
+    }
+
+    if (ring->cq_map_len == 0) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(NULL, ring->cq_map_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd,
+                            IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            ring->cq_map = NULL;
+            goto fail;
+        }
+    }
+
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        goto fail;
+    }
+
+    sq = ring->sq_map;
+    cq = ring->cq_map;
+
+    ring->sq_tail  = (unsigned int *)(sq + p.sq_off.tail);
+    ring->sq_mask  = (unsigned int *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)(sq + p.sq_off.array);
+    ring->cq_head  = (unsigned int *)(cq + p.cq_off.head);
+    ring->cq_tail  = (unsigned int *)(cq + p.cq_off.tail);
+    ring->cq_mask  = (unsigned int *)(cq + p.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    ring->entries  = p.sq_entries;
+
+    return true;
+
+fail:
+    if (ring->sq_map != NULL) {
+        munmap(ring->sq_map, ring->sq_map_len);
+    }
+    if (ring->cq_map != NULL && ring->cq_map_len != 0) {
+        munmap(ring->cq_map, ring->cq_map_len);
+    }
+    close(ring->fd);
+    return false;
+}
+
+static void uring_deinit(struct rx_uring *ring)
+{
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_map_len != 0) {
+        munmap(ring->cq_map, ring->cq_map_len);
+    }
+    munmap(ring->sq_map, ring->sq_map_len);
+    close(ring->fd);
+}
+#endif
+
+#if BLADERF_OS_LINUX
+static int pwrite_all(int fd, const uint8_t *buf, size_t len, uint64_t off)
+{
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, (off_t)off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        buf += n;
+        len -= n;
+        off += n;
+    }
+
+    return 0;
+}
+#endif
+
+#if RX_WRITER_URING
+/* Handle completed writes, first waiting for at least one if `wait` is set */
+static void uring_reap(struct rx_writer *w, bool wait)
+{
+    struct rx_uring *ring = &w->ring;
+    unsigned int head = *ring->cq_head;
+
+    if (wait && head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        int status = uring_enter(ring->fd, 0, 1);
+        if (status < 0) {
+            /* The in-flight blocks can't be recovered; give up on them */
+            writer_fail(w, ETYPE_ERRNO, -status, CLI_RET_FILEOP);
+            ring->inflight = 0;
+            return;
+        }
+    }
+
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        unsigned int idx = (unsigned int)cqe->user_data;
+        int res = cqe->res;
+
+        if (res < 0) {
+            writer_fail(w, ETYPE_ERRNO, -res, CLI_RET_FILEOP);
+        } else if ((size_t)res < w->len[idx]) {
+            /* Short write; finish it off synchronously */
+            int status = pwrite_all(w->fd, w->pool + idx * w->block_size + res,
+                                    w->len[idx] - res, w->offset[idx] + res);
+            if (status != 0) {
+                writer_fail(w, ETYPE_ERRNO, status, CLI_RET_FILEOP);
+            }
+        }
+
+        head++;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        ring->inflight--;
+        release_block(w, idx);
+    }
+}
+
+static void uring_drain(struct rx_writer *w)
+{
+    while (w->ring.inflight > 0) {
+        uring_reap(w, true);
+    }
+}
+
+/* Returns 0 on success or a negative errno if the write was not submitted */
+static int uring_submit(struct rx_writer *w, unsigned int idx)
+{
+    struct rx_uring *ring = &w->ring;
+    struct io_uring_sqe *sqe;
+    unsigned int tail, i;
+    int status;
+
+    while (ring->inflight >= ring->entries) {
+        uring_reap(w, true);
+    }
+
+    tail = *ring->sq_tail;
+    i    = tail & *ring->sq_mask;
+    sqe  = &ring->sqes[i];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_WRITE;
+    sqe->fd        = w->fd;
+    sqe->addr      = (uintptr_t)(w->pool + idx * w->block_size);
+    sqe->len       = (uint32_t)w->len[idx];
+    sqe->off       = w->offset[idx];
+    sqe->user_data = idx;
+
+    ring->sq_array[i] = i;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    status = uring_enter(ring->fd, 1, 0);
+    if (status < 1) {
+        /* Retract the entry so the ring stays consistent */
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+        return status < 0 ? status : -EAGAIN;
+    }
+
+    ring->inflight++;
+    return 0;
+}
+#endif
+
+/* Write a block from the writer thread. Returns true if the block is done
+ * with, or false if it is still in flight and will be released later. */
+static bool write_block(struct rx_writer *w, unsigned int idx)
+{
+    uint8_t *block = w->pool + idx * w->block_size;
+    size_t len     = w->len[idx];
+    int status;
+
+    MUTEX_LOCK(&w->lock);
+    status = w->status;
+    MUTEX_UNLOCK(&w->lock);
+
+    /* After a failure, just keep recycling blocks until we're stopped */
+    if (status != 0 || len == 0) {
+        return true;
+    }
+
+    if (w->format != NULL) {
+        status = w->format(w->s, block, len / w->sample_size);
+        if (status != 0) {
+            writer_fail(w, ETYPE_CLI, status, status);
+        }
+        return true;
+    }
+
+#if BLADERF_OS_LINUX
+    if (w->positioned) {
+        w->offset[idx] = w->pos;
+        w->pos += len;
+
+#if RX_WRITER_URING
+        if (w->uring) {
+            if (!w->direct || len % RX_WRITER_ALIGNMENT == 0) {
+                if (uring_submit(w, idx) == 0) {
+                    return false;
+                }
+
+                /* Carry on with the synchronous path */
+                w->uring = false;
+            }
+
+            uring_drain(w);
+        }
+#endif
+
+        /* O_DIRECT can't write a short tail; drop it for the final block */
+        if (w->direct && len % RX_WRITER_ALIGNMENT != 0) {
+            int flags = fcntl(w->fd, F_GETFL);
+            if (flags >= 0) {
+                fcntl(w->fd, F_SETFL, flags & ~O_DIRECT);
+            }
+            w->direct = false;
+        }
+
+        status = pwrite_all(w->fd, block, len, w->offset[idx]);
+        if (status != 0) {
+            writer_fail(w, ETYPE_ERRNO, status, CLI_RET_FILEOP);
+        }
+        return true;
+    }
+#endif
+
+    {
+        struct rxtx_data *rx = w->s->rx;
+        size_t n;
+
+        MUTEX_LOCK(&rx->file_mgmt.file_lock);
+        n = fwrite(block, 1, len, rx->file_mgmt.file);
+        MUTEX_UNLOCK(&rx->file_mgmt.file_lock);
+
+        if (n != len) {
+            writer_fail(w, ETYPE_ERRNO, errno, CLI_RET_FILEOP);
+        }
+    }
+
+    return true;
+}
+
+static void *rx_writer_thread(void *arg)
+{
+    struct rx_writer *w = arg;
+    unsigned int idx;
+
+    MUTEX_LOCK(&w->lock);
+
+    while (true) {
+        if (w->num_queued > 0) {
+            idx           = w->queue[w->queue_head];
+            w->queue_head = (w->queue_head + 1) % w->num_blocks;
+            w->num_queued--;
+            MUTEX_UNLOCK(&w->lock);
+
+            if (write_block(w, idx)) {
+                release_block(w, idx);
+            }
+
+            MUTEX_LOCK(&w->lock);
+#if RX_WRITER_URING
+        } else if (w->uring && w->ring.inflight > 0) {
+            MUTEX_UNLOCK(&w->lock);
+            uring_reap(w, true);
+            MUTEX_LOCK(&w->lock);
+#endif
+        } else if (w->stopping) {
+            break;
+        } else {
+            COND_WAIT(&w->block_queued, &w->lock);
+        }
+    }
+
+    MUTEX_UNLOCK(&w->lock);
+
+    return NULL;
+}
+
+static void rx_writer_free(struct rx_writer *w)
+{
+    free_aligned(w->pool);
+    free(w->len);
+    free(w->offset);
+    free(w->queue);
+    free(w->free);
+    free(w);
+}
+
+int rx_writer_start(struct cli_state *s,
+                    const struct rx_writer_config *config,
+                    size_t sample_size,
+                    int (*format)(struct cli_state *s, void *samples, size_t n),
+                    struct rx_writer **writer)
+{
+    struct rx_writer *w;
+    unsigned int i;
+
+    if (config->num_blocks < RX_WRITER_BLOCKS_MIN ||
+        config->block_size % RX_WRITER_ALIGNMENT != 0 ||
+        config->block_size % sample_size != 0) {
+        return CLI_RET_INVPARAM;
+    }
+
+    w = calloc(1, sizeof(*w));
+    if (w == NULL) {
+        return CLI_RET_MEM;
+    }
+
+    w->s           = s;
+    w->format      = format;
+    w->sample_size = sample_size;
+    w->block_size  = config->block_size;
+    w->num_blocks  = config->num_blocks;
+    w->cur         = config->num_blocks;
+
+    w->pool   = alloc_aligned(w->num_blocks * w->block_size);
+    w->len    = calloc(w->num_blocks, sizeof(w->len[0]));
+    w->offset = calloc(w->num_blocks, sizeof(w->offset[0]));
+    w->queue  = calloc(w->num_blocks, sizeof(w->queue[0]));
+    w->free   = calloc(w->num_blocks, sizeof(w->free[0]));
+
+    if (w->pool == NULL || w->len == NULL || w->offset == NULL ||
+        w->queue == NULL || w->free == NULL) {
+        rx_writer_free(w);
+        return CLI_RET_MEM;
+    }
+
+    /* Hand out blocks in ascending order */
+    for (i = 0; i < w->num_blocks; i++) {
+        w->free[i] = w->num_blocks - 1 - i;
+    }
+    w->num_free = w->num_blocks;
+
+    w->stats.num_blocks = w->num_blocks;
+
+#if BLADERF_OS_LINUX
+    w->fd = fileno(s->rx->file_mgmt.file);
+
+    /* Reserve space up front so the file system can lay the capture out
+     * contiguously. The excess is trimmed in rx_writer_stop(). */
+    if (config->prealloc > 0) {
+        w->preallocated = fallocate(w->fd, FALLOC_FL_KEEP_SIZE, 0,
+                                    (off_t)config->prealloc) == 0;
+    }
+
+    if (format == NULL && (config->direct || config->uring)) {
+        if (config->direct) {
+            int flags = fcntl(w->fd, F_GETFL);
+            if (flags >= 0 && fcntl(w->fd, F_SETFL, flags | O_DIRECT) == 0) {
+                w->direct       = true;
+                w->stats.direct = true;
+            }
+        }
+
+#if RX_WRITER_URING
+        if (config->uring) {
+            unsigned int depth = w->num_blocks < RX_WRITER_URING_DEPTH
+                                     ? w->num_blocks
+                                     : RX_WRITER_URING_DEPTH;
+
+            w->uring       = uring_init(&w->ring, depth);
+            w->stats.uring = w->uring;
+        }
+#endif
+
+        if (w->stats.direct || w->stats.uring) {
+            off_t pos;
+
+            fflush(s->rx->file_mgmt.file);
+            pos = lseek(w->fd, 0, SEEK_CUR);
+
+            w->positioned = true;
+            w->pos        = pos < 0 ? 0 : (uint64_t)pos;
+        }
+    }
+#else
+    (void)config->direct;
+    (void)config->uring;
+    (void)config->prealloc;
+#endif
+
+    MUTEX_INIT(&w->lock);
+    COND_INIT(&w->block_queued);
+    COND_INIT(&w->block_freed);
+
+    if (THREAD_CREATE(&w->thread, rx_writer_thread, w) != 0) {
+#if RX_WRITER_URING
+        if (w->uring) {
+            uring_deinit(&w->ring);
+        }
+#endif
+        MUTEX_DESTROY(&w->lock);
+        rx_writer_free(w);
+        return CLI_RET_UNKNOWN;
+    }
+
+    *writer = w;
+    return 0;
+}
+
+void *rx_writer_get_block(struct rx_writer *w)
+{
+    bool waited = false;
+    void *block = NULL;
+
+    assert(w->cur == w->num_blocks);
+
+    MUTEX_LOCK(&w->lock);
+
+    while (w->num_free == 0 && w->status == 0) {
+        waited = true;
+        COND_WAIT(&w->block_freed, &w->lock);
+    }
+
+    if (w->status == 0) {
+        if (waited) {
+            w->stats.stalls++;
+        }
+
+        w->cur = w->free[--w->num_free];
+        block  = w->pool + w->cur * w->block_size;
+    }
+
+    MUTEX_UNLOCK(&w->lock);
+
+    return block;
+}
+
+void rx_writer_put_block(struct rx_writer *w, size_t len)
+{
+    unsigned int tail;
+
+    assert(w->cur < w->num_blocks);
+    assert(len <= w->block_size);
+
+    MUTEX_LOCK(&w->lock);
+
+    w->len[w->cur] = len;
+    tail           = (w->queue_head + w->num_queued) % w->num_blocks;
+    w->queue[tail] = w->cur;
+    w->num_queued++;
+    w->pending++;
+    w->cur = w->num_blocks;
+
+    w->stats.bytes += len;
+    if (w->pending > w->stats.high_water) {
+        w->stats.high_water = w->pending;
+    }
+
+    COND_SIGNAL(&w->block_queued);
+    MUTEX_UNLOCK(&w->lock);
+}
+
+int rx_writer_stop(struct rx_writer *w, struct rx_writer_stats *stats)
+{
+    int status;
+
+    MUTEX_LOCK(&w->lock);
+    w->stopping = true;
+    COND_SIGNAL(&w->block_queued);
+    MUTEX_UNLOCK(&w->lock);
+
+    THREAD_JOIN(w->thread, NULL);
+
+#if RX_WRITER_URING
+    if (w->stats.uring) {
+        uring_deinit(&w->ring);
+    }
+#endif
+
+#if BLADERF_OS_LINUX
+    /* Release any preallocated space past the end of the capture */
+    if (w->preallocated) {
+        off_t end;
+
+        if (w->positioned) {
+            end = (off_t)w->pos;
+        } else {
+            fflush(w->s->rx->file_mgmt.file);
+            end = lseek(w->fd, 0, SEEK_CUR);
+        }
+
+        if (end >= 0 && ftruncate(w->fd, end) != 0) {
+            writer_fail(w, ETYPE_ERRNO, errno, CLI_RET_FILEOP);
+        }
+    }
+#endif
+
+    status = w->status;
+    if (stats != NULL) {
+        *stats = w->stats;
+    }
+
+    MUTEX_DESTROY(&w->lock);
+    rx_writer_free(w);
+
+    return status;
+}
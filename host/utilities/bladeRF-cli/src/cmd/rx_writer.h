@@ -0,0 +1,117 @@
+/*
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* The RX writer decouples the RX task from the output file. The RX task fills
+ * blocks from a fixed pool and queues them; a dedicated thread drains the
+ * queue to disk. A disk stall shorter than the queue depth therefore no
+ * longer stalls bladerf_sync_rx() and overruns the stream. */
+#ifndef RX_WRITER_H__
+#define RX_WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmd.h"
+
+/* Block sizes and addresses are multiples of this, as required by O_DIRECT */
+#define RX_WRITER_ALIGNMENT 4096
+
+#define RX_WRITER_BLOCKS_DEFAULT 32
+#define RX_WRITER_BLOCKS_MIN 2
+#define RX_WRITER_BLOCKS_MAX 4096
+
+#define RX_WRITER_BLOCK_SIZE_DEFAULT (1024 * 1024)
+#define RX_WRITER_BLOCK_SIZE_MIN RX_WRITER_ALIGNMENT
+#define RX_WRITER_BLOCK_SIZE_MAX (64 * 1024 * 1024)
+
+struct rx_writer;
+
+struct rx_writer_config {
+    unsigned int num_blocks; /* # of blocks in the queue */
+    size_t block_size;       /* Size of each block, in bytes */
+    bool direct;             /* Bypass the page cache (O_DIRECT) */
+    bool uring;              /* Submit writes via io_uring */
+    uint64_t prealloc;       /* Bytes to preallocate up front, 0 for none */
+};
+
+struct rx_writer_stats {
+    unsigned int num_blocks; /* # of blocks in the queue */
+    unsigned int high_water; /* Most blocks ever waiting to be written */
+    unsigned int stalls;     /* # of times the RX task waited for a block */
+    uint64_t bytes;          /* Bytes handed to the writer */
+    bool direct;             /* O_DIRECT was in effect */
+    bool uring;              /* io_uring was in effect */
+};
+
+/**
+ * Allocate the block pool and start the writer thread for s->rx's output file
+ *
+ * Binary formats are written directly from the blocks. When `format` is
+ * non-NULL it is called on the writer thread for each block instead, and is
+ * responsible for writing the converted samples to the file.
+ *
+ * Options the platform or file system cannot provide (O_DIRECT, io_uring,
+ * preallocation) are silently disabled; see rx_writer_stop().
+ *
+ * @param[in]   s           CLI state
+ * @param[in]   config      Queue and I/O options
+ * @param[in]   sample_size Size of one sample, in bytes
+ * @param[in]   format      Optional formatting callback
+ * @param[out]  writer      Writer handle
+ *
+ * @return 0 on success, CLI_RET_* on failure
+ */
+int rx_writer_start(struct cli_state *s,
+                    const struct rx_writer_config *config,
+                    size_t sample_size,
+                    int (*format)(struct cli_state *s, void *samples, size_t n),
+                    struct rx_writer **writer);
+
+/**
+ * Get an empty block to fill, waiting for the writer if none are free
+ *
+ * @param   writer  Writer handle
+ *
+ * @return block of config->block_size bytes, or NULL if the writer has failed
+ */
+void *rx_writer_get_block(struct rx_writer *writer);
+
+/**
+ * Queue the block returned by the last rx_writer_get_block() for writing
+ *
+ * @param   writer  Writer handle
+ * @param   len     Number of bytes filled. Only the final block of a
+ *                  capture may be short.
+ */
+void rx_writer_put_block(struct rx_writer *writer, size_t len);
+
+/**
+ * Write out all queued blocks, stop the writer thread and free the writer
+ *
+ * @param[in]   writer  Writer handle
+ * @param[out]  stats   Queue statistics for this capture. May be NULL.
+ *
+ * @return 0 on success, CLI_RET_* if a write failed (and calls
+ *         set_last_error())
+ */
+int rx_writer_stop(struct rx_writer *writer, struct rx_writer_stats *stats);
+
+#endif
@@ -371,6 +371,7 @@ struct rxtx_data *rxtx_data_alloc(bladerf_direction dir)
         } else {
             tx_params->repeat       = 1;
             tx_params->repeat_delay = 0;
+            tx_params->csv_threads  = 1;
             ret->params             = tx_params;
         }
     } else {
@@ -381,8 +382,16 @@ struct rxtx_data *rxtx_data_alloc(bladerf_direction dir)
             free(ret);
             return NULL;
         } else {
-            rx_params->n_samples = 100000;
-            ret->params          = rx_params;
+            rx_params->n_samples          = 100000;
+            rx_params->write_samples      = NULL;
+            rx_params->writer.num_blocks  = RX_WRITER_BLOCKS_DEFAULT;
+            rx_params->writer.block_size  = RX_WRITER_BLOCK_SIZE_DEFAULT;
+            rx_params->writer.direct      = false;
+            rx_params->writer.uring       = false;
+            rx_params->writer.prealloc    = 0;
+            rx_params->prealloc           = false;
+            rx_params->writer_stats_valid = false;
+            ret->params                   = rx_params;
         }
     }
 
@@ -0,0 +1,563 @@
+/*
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conversions.h"
+#include "host_config.h"
+#include "rel_assert.h"
+#include "rxtx_csv.h"
+#include "rxtx_impl.h"
+#include "thread.h"
+
+#if BLADERF_OS_WINDOWS
+#define EOL "\r\n"
+#else
+#define EOL "\n"
+#endif
+
+#define EOL_LEN (sizeof(EOL) - 1)
+
+/* "-32768, -32768, " */
+#define CSV_MAX_SAMPLE_LEN 16
+
+/* Size of each piece of CSV input parsed at once */
+#define CSV_CHUNK_SIZE (1024 * 1024)
+
+/* Longest token handed to strtol() for hex and octal values */
+#define CSV_MAX_TOKEN_LEN 64
+
+static const char digit_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline char *format_int(char *p, int value)
+{
+    char tmp[8];
+    char *t = tmp + sizeof(tmp);
+    unsigned int u;
+
+    if (value < 0) {
+        *p++ = '-';
+        u    = 0u - (unsigned int)value;
+    } else {
+        u = (unsigned int)value;
+    }
+
+    while (u >= 100) {
+        unsigned int r = u % 100;
+        u /= 100;
+        t -= 2;
+        memcpy(t, &digit_pairs[2 * r], 2);
+    }
+
+    if (u >= 10) {
+        t -= 2;
+        memcpy(t, &digit_pairs[2 * u], 2);
+    } else {
+        *--t = (char)('0' + u);
+    }
+
+    memcpy(p, t, tmp + sizeof(tmp) - t);
+    return p + (tmp + sizeof(tmp) - t);
+}
+
+size_t rxtx_csv_max_len(size_t n_samples, size_t nchans)
+{
+    return n_samples * CSV_MAX_SAMPLE_LEN + (n_samples / nchans) * EOL_LEN;
+}
+
+size_t rxtx_csv_format(char *buf,
+                       const void *samples,
+                       size_t n_samples,
+                       size_t nchans,
+                       bladerf_format format)
+{
+    const int8_t *sc8   = samples;
+    const int16_t *sc16 = samples;
+    char *p             = buf;
+    size_t i, j;
+
+    assert(n_samples % nchans == 0);
+
+    for (i = 0; i < 2 * n_samples; i += 2 * nchans) {
+        for (j = i; j < i + 2 * nchans; j += 2) {
+            if (j > i) {
+                *p++ = ',';
+                *p++ = ' ';
+            }
+
+            if (format == BLADERF_FORMAT_SC8_Q7) {
+                p    = format_int(p, sc8[j]);
+                *p++ = ',';
+                *p++ = ' ';
+                p    = format_int(p, sc8[j + 1]);
+            } else {
+                p    = format_int(p, sc16[j]);
+                *p++ = ',';
+                *p++ = ' ';
+                p    = format_int(p, sc16[j + 1]);
+            }
+        }
+
+        memcpy(p, EOL, EOL_LEN);
+        p += EOL_LEN;
+    }
+
+    return p - buf;
+}
+
+/* Separators between values, other than the newline ending each line */
+static inline bool is_delim(char c)
+{
+    switch (c) {
+        case ' ':
+        case '\r':
+        case '\t':
+        case ',':
+        case '.':
+        case ':':
+        case '\0':
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* Parse one value the way strtol(str, NULL, 0) would, including ignoring
+ * anything after the number up to the next separator. */
+static bool parse_value(const char **pos, const char *end, int *value)
+{
+    const char *p = *pos;
+    bool neg      = false;
+    uint64_t u    = 0;
+
+    if (*p == '-' || *p == '+') {
+        neg = (*p == '-');
+        p++;
+    }
+
+    if (p == end || !is_digit(*p)) {
+        return false;
+    }
+
+    if (*p == '0' && p + 1 < end &&
+        (p[1] == 'x' || p[1] == 'X' || is_digit(p[1]))) {
+        /* Hex or octal; rare enough to leave to strtol() */
+        char token[CSV_MAX_TOKEN_LEN + 1];
+        const char *q = *pos;
+        size_t len;
+        bool ok;
+
+        while (q < end && *q != '\n' && !is_delim(*q)) {
+            q++;
+        }
+
+        len = q - *pos;
+        if (len > CSV_MAX_TOKEN_LEN) {
+            return false;
+        }
+
+        memcpy(token, *pos, len);
+        token[len] = '\0';
+
+        *value = str2int(token, INT_MIN, INT_MAX, &ok);
+        *pos   = q;
+        return ok;
+    }
+
+    while (p < end && is_digit(*p)) {
+        u = u * 10 + (*p++ - '0');
+        if (u > (uint64_t)INT_MAX + 1) {
+            return false;
+        }
+    }
+
+    if (!neg && u > INT_MAX) {
+        return false;
+    }
+
+    while (p < end && *p != '\n' && !is_delim(*p)) {
+        p++;
+    }
+
+    *value = neg ? (int)(0 - (int64_t)u) : (int)u;
+    *pos   = p;
+    return true;
+}
+
+enum chunk_state {
+    CHUNK_FREE,  /* Available to be read into */
+    CHUNK_READY, /* Read, awaiting a parser */
+    CHUNK_BUSY,  /* Being parsed */
+    CHUNK_DONE,  /* Parsed, awaiting writing */
+};
+
+struct csv_chunk {
+    enum chunk_state state;
+
+    char *in;
+    size_t in_len;
+    bool too_long; /* Holds part of a line that didn't fit in a chunk */
+
+    uint8_t *out;
+    size_t out_len;
+
+    uint64_t n_lines; /* Newlines in 'in' */
+    uint64_t n_values;
+    uint64_t n_clamped;
+    uint64_t err_line; /* Relative to the chunk; 0 if no error */
+    int err_cols;
+};
+
+struct csv_conv {
+    bladerf_format format;
+    size_t sample_size;
+    int min;
+    int max;
+
+    struct csv_chunk *chunks;
+    unsigned int num_chunks;
+
+    /* The following are protected by 'lock' */
+    MUTEX lock;
+    COND chunk_ready;
+    COND chunk_done;
+    uint64_t next_read;  /* Sequence # of the next chunk to be read */
+    uint64_t next_parse; /* Sequence # of the next chunk to be parsed */
+    bool stop;
+};
+
+static void parse_chunk(const struct csv_conv *conv, struct csv_chunk *c)
+{
+    const char *p   = c->in;
+    const char *end = c->in + c->in_len;
+    uint8_t *out    = c->out;
+    uint64_t line   = 1;
+    int cols        = 0;
+    int value;
+
+    c->n_values  = 0;
+    c->n_clamped = 0;
+    c->err_line  = 0;
+    c->err_cols  = -1;
+
+    if (c->too_long) {
+        c->err_line = 1;
+        return;
+    }
+
+    while (p < end) {
+        if (*p == '\n') {
+            if (cols % 2 != 0) {
+                c->err_line = line;
+                c->err_cols = cols;
+                return;
+            }
+
+            cols = 0;
+            line++;
+            p++;
+        } else if (is_delim(*p)) {
+            p++;
+        } else {
+            if (!parse_value(&p, end, &value)) {
+                c->err_line = line;
+                return;
+            }
+
+            if (value < conv->min) {
+                value = conv->min;
+                c->n_clamped++;
+            } else if (value > conv->max) {
+                value = conv->max;
+                c->n_clamped++;
+            }
+
+            if (conv->sample_size == sizeof(int8_t)) {
+                *out++ = (uint8_t)(int8_t)value;
+            } else {
+                int16_t v16 = (int16_t)value;
+                memcpy(out, &v16, sizeof(v16));
+                out += sizeof(v16);
+            }
+
+            c->n_values++;
+            cols++;
+        }
+    }
+
+    /* Final line without a newline */
+    if (cols % 2 != 0) {
+        c->err_line = line;
+        c->err_cols = cols;
+        return;
+    }
+
+    c->n_lines = line - 1;
+    c->out_len = out - c->out;
+}
+
+static void *csv_worker(void *arg)
+{
+    struct csv_conv *conv = arg;
+    struct csv_chunk *c;
+
+    MUTEX_LOCK(&conv->lock);
+
+    while (true) {
+        while (!conv->stop && conv->next_parse == conv->next_read) {
+            COND_WAIT(&conv->chunk_ready, &conv->lock);
+        }
+
+        if (conv->stop) {
+            break;
+        }
+
+        c = &conv->chunks[conv->next_parse++ % conv->num_chunks];
+        assert(c->state == CHUNK_READY);
+        c->state = CHUNK_BUSY;
+        MUTEX_UNLOCK(&conv->lock);
+
+        parse_chunk(conv, c);
+
+        MUTEX_LOCK(&conv->lock);
+        c->state = CHUNK_DONE;
+        COND_SIGNAL(&conv->chunk_done);
+    }
+
+    MUTEX_UNLOCK(&conv->lock);
+
+    return NULL;
+}
+
+/* Read the next chunk of whole lines, carrying over any partial line.
+ * Returns 0 on success or CLI_RET_FILEOP. c->in_len is 0 at EOF. */
+static int read_chunk(FILE *csv, struct csv_chunk *c, char *carry,
+                      size_t *carry_len)
+{
+    size_t len;
+    size_t i;
+
+    memcpy(c->in, carry, *carry_len);
+    len = *carry_len +
+          fread(c->in + *carry_len, 1, CSV_CHUNK_SIZE - *carry_len, csv);
+
+    if (ferror(csv)) {
+        return CLI_RET_FILEOP;
+    }
+
+    c->too_long = false;
+    c->in_len   = len;
+    *carry_len  = 0;
+
+    if (len == CSV_CHUNK_SIZE) {
+        for (i = len; i > 0 && c->in[i - 1] != '\n'; i--)
+            ;
+
+        if (i == 0) {
+            c->too_long = true;
+        } else {
+            *carry_len = len - i;
+            memcpy(carry, c->in + i, *carry_len);
+            c->in_len = i;
+        }
+    }
+
+    return 0;
+}
+
+int rxtx_csv_convert(FILE *csv,
+                     FILE *bin,
+                     bladerf_format format,
+                     int min,
+                     int max,
+                     unsigned int num_threads,
+                     struct rxtx_csv_result *result)
+{
+    struct csv_conv conv;
+    THREAD *threads = NULL;
+    unsigned int num_started = 0;
+    char *carry = NULL;
+    size_t carry_len = 0;
+    uint64_t next_write = 0;
+    uint64_t line_base = 0;
+    bool eof = false;
+    unsigned int i;
+    int status = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->err_cols = -1;
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    memset(&conv, 0, sizeof(conv));
+    conv.format      = format;
+    conv.sample_size = (format == BLADERF_FORMAT_SC8_Q7) ? sizeof(int8_t)
+                                                          : sizeof(int16_t);
+    conv.min         = min;
+    conv.max         = max;
+
+    /* Keep every parser busy while chunks are read and written */
+    conv.num_chunks = (num_threads == 1) ? 1 : 2 * num_threads;
+
+    conv.chunks = calloc(conv.num_chunks, sizeof(conv.chunks[0]));
+    carry       = malloc(CSV_CHUNK_SIZE);
+    if (conv.chunks == NULL || carry == NULL) {
+        status = CLI_RET_MEM;
+        goto out;
+    }
+
+    for (i = 0; i < conv.num_chunks; i++) {
+        /* Each value takes at least two characters, bar the last */
+        conv.chunks[i].in  = malloc(CSV_CHUNK_SIZE);
+        conv.chunks[i].out =
+            malloc((CSV_CHUNK_SIZE / 2 + 1) * conv.sample_size);
+
+        if (conv.chunks[i].in == NULL || conv.chunks[i].out == NULL) {
+            status = CLI_RET_MEM;
+            goto out;
+        }
+    }
+
+    MUTEX_INIT(&conv.lock);
+    COND_INIT(&conv.chunk_ready);
+    COND_INIT(&conv.chunk_done);
+
+    if (num_threads > 1) {
+        threads = calloc(num_threads, sizeof(threads[0]));
+        if (threads == NULL) {
+            status = CLI_RET_MEM;
+            goto out_destroy;
+        }
+
+        for (i = 0; i < num_threads; i++) {
+            if (THREAD_CREATE(&threads[i], csv_worker, &conv) != 0) {
+                break;
+            }
+            num_started++;
+        }
+
+        /* Make do with whatever threads we got. With none, chunks are
+         * parsed inline below. */
+    }
+
+    while (status == 0) {
+        struct csv_chunk *c;
+
+        /* Read ahead into every free chunk */
+        while (!eof && conv.next_read - next_write < conv.num_chunks) {
+            c = &conv.chunks[conv.next_read % conv.num_chunks];
+
+            status = read_chunk(csv, c, carry, &carry_len);
+            if (status != 0 || c->in_len == 0) {
+                eof = true;
+                break;
+            }
+
+            if (num_started == 0) {
+                parse_chunk(&conv, c);
+                c->state = CHUNK_DONE;
+                conv.next_read++;
+            } else {
+                MUTEX_LOCK(&conv.lock);
+                c->state = CHUNK_READY;
+                conv.next_read++;
+                COND_SIGNAL(&conv.chunk_ready);
+                MUTEX_UNLOCK(&conv.lock);
+            }
+        }
+
+        if (status != 0 || next_write == conv.next_read) {
+            break;
+        }
+
+        /* Write out chunks in the order they were read */
+        c = &conv.chunks[next_write % conv.num_chunks];
+
+        MUTEX_LOCK(&conv.lock);
+        while (c->state != CHUNK_DONE) {
+            COND_WAIT(&conv.chunk_done, &conv.lock);
+        }
+        MUTEX_UNLOCK(&conv.lock);
+
+        if (c->err_line != 0) {
+            result->err_line = line_base + c->err_line;
+            result->err_cols = c->err_cols;
+            status           = CLI_RET_INVPARAM;
+            break;
+        }
+
+        if (fwrite(c->out, 1, c->out_len, bin) != c->out_len) {
+            status = CLI_RET_FILEOP;
+            break;
+        }
+
+        result->n_values += c->n_values;
+        result->n_clamped += c->n_clamped;
+        line_base += c->n_lines;
+
+        c->state = CHUNK_FREE;
+        next_write++;
+    }
+
+    if (num_started > 0) {
+        MUTEX_LOCK(&conv.lock);
+        conv.stop = true;
+        COND_BROADCAST(&conv.chunk_ready);
+        MUTEX_UNLOCK(&conv.lock);
+
+        for (i = 0; i < num_started; i++) {
+            THREAD_JOIN(threads[i], NULL);
+        }
+    }
+
+out_destroy:
+    MUTEX_DESTROY(&conv.lock);
+
+out:
+    if (conv.chunks != NULL) {
+        for (i = 0; i < conv.num_chunks; i++) {
+            free(conv.chunks[i].in);
+            free(conv.chunks[i].out);
+        }
+    }
+
+    free(conv.chunks);
+    free(threads);
+    free(carry);
+
+    return status;
+}
@@ -0,0 +1,100 @@
+/*
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* CSV sample files hold one line per sample time, with an I,Q column pair
+ * per channel. These routines convert between that and SC16 Q11 / SC8 Q7
+ * samples without going through stdio's per-value formatting. */
+#ifndef RXTX_CSV_H__
+#define RXTX_CSV_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <libbladeRF.h>
+
+#define RXTX_CSV_THREADS_MAX 64
+
+/**
+ * Largest amount of text rxtx_csv_format() may produce
+ *
+ * @param   n_samples   Number of samples, over all channels
+ * @param   nchans      Number of channels interleaved in the samples
+ *
+ * @return buffer size, in bytes
+ */
+size_t rxtx_csv_max_len(size_t n_samples, size_t nchans);
+
+/**
+ * Format interleaved samples as CSV
+ *
+ * @param[out]  buf         Output buffer, at least rxtx_csv_max_len() bytes
+ * @param[in]   samples     SC16 Q11 or SC8 Q7 samples
+ * @param[in]   n_samples   Number of samples, over all channels. Must be a
+ *                          multiple of `nchans`.
+ * @param[in]   nchans      Number of channels interleaved in the samples
+ * @param[in]   format      BLADERF_FORMAT_SC8_Q7, or any SC16 Q11 format
+ *
+ * @return number of bytes written to `buf`. It is not NUL-terminated.
+ */
+size_t rxtx_csv_format(char *buf,
+                       const void *samples,
+                       size_t n_samples,
+                       size_t nchans,
+                       bladerf_format format);
+
+struct rxtx_csv_result {
+    uint64_t n_values;  /* Values written to the binary file */
+    uint64_t n_clamped; /* Values clamped to the DAC's range */
+    uint64_t err_line;  /* Line of the first error, starting from 1 */
+    int err_cols;       /* # of values on that line if there were an odd
+                         * number of them, or -1 if it failed to parse */
+};
+
+/**
+ * Convert a CSV file to binary samples
+ *
+ * Values may be separated by commas, whitespace, '.' or ':', and are
+ * parsed like strtol() with a base of 0. Each line must hold whole I,Q
+ * pairs. Values outside the DAC's range are clamped.
+ *
+ * With more than one thread, the file is cut into chunks on line
+ * boundaries and the chunks are parsed in parallel, while this thread
+ * reads and writes them in order.
+ *
+ * @param[in]   csv         CSV input
+ * @param[in]   bin         Binary output, in host byte order
+ * @param[in]   format      BLADERF_FORMAT_SC8_Q7, or any SC16 Q11 format
+ * @param[in]   min         Smallest allowed value
+ * @param[in]   max         Largest allowed value
+ * @param[in]   num_threads Number of threads to parse with
+ * @param[out]  result      Counts, and the location of any parse error
+ *
+ * @return 0 on success, CLI_RET_INVPARAM on a parse error, or
+ *         CLI_RET_FILEOP or CLI_RET_MEM on failure
+ */
+int rxtx_csv_convert(FILE *csv,
+                     FILE *bin,
+                     bladerf_format format,
+                     int min,
+                     int max,
+                     unsigned int num_threads,
+                     struct rxtx_csv_result *result);
+
+#endif
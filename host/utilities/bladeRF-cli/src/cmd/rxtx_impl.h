@@ -31,6 +31,7 @@
 
 #include "cmd.h"
 #include "conversions.h"
+#include "rx_writer.h"
 #include "thread.h"
 
 #define RXTX_ERRMSG_VALUE(param, value) \
@@ -135,11 +136,19 @@ struct rxtx_data {
 struct tx_params {
     unsigned int repeat_delay; /* us delay between repetitions */
     unsigned int repeat;       /* # of repetitions */
+    unsigned int csv_threads;  /* # of threads converting CSV input */
 };
 
 struct rx_params {
     size_t n_samples; /* Number of samples to receive */
+
+    /* Formats and writes samples, or NULL to write them as-is */
     int (*write_samples)(struct cli_state *s, void *samples, size_t n);
+
+    struct rx_writer_config writer;      /* Output queue and I/O options */
+    bool prealloc;                       /* Preallocate space for n samples */
+    struct rx_writer_stats writer_stats; /* Queue usage of the last capture */
+    bool writer_stats_valid;             /* Has a capture been run yet? */
 };
 
 /* Multipliers in units of 1024 */
@@ -18,6 +18,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 #include <errno.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -28,9 +29,9 @@
 #include "conversions.h"
 #include "host_config.h"
 #include "minmax.h"
-#include "parse.h"
 #include "rel_assert.h"
 #include "thread.h"
+#include "rxtx_csv.h"
 #include "rxtx_impl.h"
 
 /* The DAC range is [-2048, 2047] */
@@ -233,24 +234,26 @@ static int tx_task_exec_running(struct rxtx_data *tx, struct cli_state *s)
  */
 static int tx_csv_to_bladerf_format(struct cli_state *s)
 {
-    struct rxtx_data *tx = s->tx;
-    char buf[81]         = { 0 };
-    FILE *bin            = NULL;
-    FILE *csv            = NULL;
-    char *bin_name       = NULL;
-    int8_t *tmp_iq       = NULL;
-    int line             = 1;
-    size_t n_clamped     = 0;
+    struct rxtx_data *tx        = s->tx;
+    struct tx_params *tx_params = tx->params;
+    struct rxtx_csv_result result;
+    FILE *bin                   = NULL;
+    FILE *csv                   = NULL;
+    char *bin_name              = NULL;
+    unsigned int num_threads;
+    size_t n_clamped;
 
     int min_val          = SC16Q11_IQ_MIN;
     int max_val          = SC16Q11_IQ_MAX;
 
-    // 16 bit samples are 2*int8_t samples wide
-    int sample_size      = (s->sample_format == BLADERF_FORMAT_SC8_Q7) ? 1 : 2;
     int status;
 
     assert(tx->file_mgmt.path != NULL);
 
+    MUTEX_LOCK(&tx->param_lock);
+    num_threads = tx_params->csv_threads;
+    MUTEX_UNLOCK(&tx->param_lock);
+
     status = expand_and_open(tx->file_mgmt.path, "r", &csv);
     if (status != 0) {
         goto tx_csv_to_bladerf_format_out;
@@ -273,79 +276,43 @@ static int tx_csv_to_bladerf_format(struct cli_state *s)
         max_val = SC8Q7_IQ_MAX;
     }
 
-    while (fgets(buf, sizeof(buf), csv)) {
-        int i, cols, tmp_int;
-        int **args = NULL;
-
-        cols = csv2int(buf, &args);
-
-        if (cols < 0) {
-            cli_err(s, "tx", "Line (%d): Parsing failed.\n", line);
-            status = CLI_RET_INVPARAM;
-            break;
-        }
-
-        if (cols == 0) {
-            // empty line...?
-            continue;
-        }
-
-        tmp_iq = realloc(tmp_iq, cols * sample_size);
-
-        for (i = 0; i < cols; ++i) {
-            tmp_int = *args[i];
-
-            if (tmp_int < min_val) {
-                tmp_int = min_val;
-                n_clamped++;
-            } else if (tmp_int > max_val) {
-                tmp_int = max_val;
-                n_clamped++;
-            }
-
-            memcpy(tmp_iq + i * sample_size, &tmp_int, sample_size);
-        }
-
-        free_csv2int(cols, args);
-
-        if (cols % 2 != 0) {
-            cli_err(
-                s, "tx",
-                "Line (%d): Encountered %d value%s (values must be in pairs)\n",
-                line, cols, 1 == cols ? "" : "s");
-            status = CLI_RET_INVPARAM;
-            break;
-        }
+    status = rxtx_csv_convert(csv, bin, s->sample_format, min_val, max_val,
+                              num_threads, &result);
 
-        if ((int)fwrite(tmp_iq, sample_size, cols, bin) != cols) {
-            status = CLI_RET_FILEOP;
-            break;
+    if (status == CLI_RET_INVPARAM) {
+        if (result.err_cols < 0) {
+            cli_err(s, "tx", "Line (%" PRIu64 "): Parsing failed.\n",
+                    result.err_line);
+        } else {
+            cli_err(s, "tx",
+                    "Line (%" PRIu64 "): Encountered %d value%s (values must "
+                    "be in pairs)\n",
+                    result.err_line, result.err_cols,
+                    1 == result.err_cols ? "" : "s");
         }
-
-        line++;
+    } else if (status == 0 && fflush(bin) != 0) {
+        status = CLI_RET_FILEOP;
     }
 
     if (status == 0) {
-        if (feof(csv)) {
-            free(tx->file_mgmt.path);
-            tx->file_mgmt.path = bin_name;
-            tx->file_mgmt.format = RXTX_FMT_BIN_SC16Q11;
-
-            if (n_clamped != 0) {
-               if (s->sample_format == BLADERF_FORMAT_SC8_Q7) {
-                   printf("  Warning: %zu value%s clamped within DAC SC8 Q7 "
-                          "range of [%d, %d].\n",
-                          n_clamped, 1 == n_clamped ? "" : "s", SC8Q7_IQ_MIN,
-                          SC8Q7_IQ_MAX);
-               } else {
-                  printf("  Warning: %zu value%s clamped within DAC SC16 Q11 "
-                         "range of [%d, %d].\n",
-                         n_clamped, 1 == n_clamped ? "" : "s", SC16Q11_IQ_MIN,
-                         SC16Q11_IQ_MAX);
-               }
-            }
-        } else {
-            status = CLI_RET_FILEOP;
+        n_clamped = (size_t)result.n_clamped;
+
+        free(tx->file_mgmt.path);
+        tx->file_mgmt.path = bin_name;
+        tx->file_mgmt.format = RXTX_FMT_BIN_SC16Q11;
+
+        if (n_clamped != 0) {
+           if (s->sample_format == BLADERF_FORMAT_SC8_Q7) {
+               printf("  Warning: %zu value%s clamped within DAC SC8 Q7 "
+                      "range of [%d, %d].\n",
+                      n_clamped, 1 == n_clamped ? "" : "s", SC8Q7_IQ_MIN,
+                      SC8Q7_IQ_MAX);
+           } else {
+              printf("  Warning: %zu value%s clamped within DAC SC16 Q11 "
+                     "range of [%d, %d].\n",
+                     n_clamped, 1 == n_clamped ? "" : "s", SC16Q11_IQ_MIN,
+                     SC16Q11_IQ_MAX);
+           }
         }
     }
 
@@ -354,8 +321,6 @@ tx_csv_to_bladerf_format_out:
         free(bin_name);
     }
 
-    free(tmp_iq);
-
     if (csv) {
         fclose(csv);
     }
@@ -526,12 +491,13 @@ static int tx_cmd_start(struct cli_state *s)
 
 static void tx_print_config(struct rxtx_data *tx)
 {
-    unsigned int repetitions, repeat_delay;
+    unsigned int repetitions, repeat_delay, csv_threads;
     struct tx_params *tx_params = tx->params;
 
     MUTEX_LOCK(&tx->param_lock);
     repetitions  = tx_params->repeat;
     repeat_delay = tx_params->repeat_delay;
+    csv_threads  = tx_params->csv_threads;
     MUTEX_UNLOCK(&tx->param_lock);
 
     printf("\n");
@@ -553,6 +519,8 @@ static void tx_print_config(struct rxtx_data *tx)
         printf("  Repetition delay: none\n");
     }
 
+    printf("  CSV conversion threads: %u\n", csv_threads);
+
     rxtx_print_stream_info(tx, "  ", "\n");
 
     printf("\n");
@@ -607,6 +575,21 @@ static int tx_config(struct cli_state *s, int argc, char **argv)
                     cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
                     return CLI_RET_INVPARAM;
                 }
+            } else if (!strcasecmp("threads", argv[i])) {
+                /* Configure the # of threads used to convert CSV input */
+                unsigned int tmp;
+                bool ok;
+
+                tmp = str2uint(val, 1, RXTX_CSV_THREADS_MAX, &ok);
+
+                if (ok) {
+                    MUTEX_LOCK(&s->tx->param_lock);
+                    tx_params->csv_threads = tmp;
+                    MUTEX_UNLOCK(&s->tx->param_lock);
+                } else {
+                    cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
+                    return CLI_RET_INVPARAM;
+                }
             } else if (!strcasecmp("channel", argv[i])) {
                 /* Configure TX channels */
                 status = rxtx_handle_channel_list(s, s->tx, val);
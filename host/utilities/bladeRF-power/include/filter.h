@@ -27,46 +27,85 @@
  */
 #ifndef FILTER_H_
 #define FILTER_H_
+#include <stdint.h>
 #include <stdlib.h>
+#include "libbladeRF.h"
+
+/** Largest number of interleaved channels a filter can process */
+#define NF_FILTER_MAX_CHANNELS 2
 
 /**
- * @brief Apply a predefined FIR filter to input samples to flatten the noise
- * figure across the specified frequency range, specifically designed for
- * bladeRF 2.0 devices.
+ * @brief Streaming FIR filter that flattens the noise figure across the
+ * band, for power measurement.
  *
- * This function convolves input samples with a low-pass FIR filter designed to
- * equalize the device's frequency response for power measurement. The filter
- * aims to achieve a uniform gain across the desired frequency spectrum with
- * minimal ripple.
+ * The filter coefficients are selected for the device's board when the
+ * filter is created. Its state carries over from one block of samples to the
+ * next, so consecutive blocks are filtered as one continuous stream. The
+ * channels of interleaved multi-channel data are filtered independently.
+ */
+struct nf_filter;
+
+/**
+ * @brief Statistics of one channel's filtered samples.
  *
- * @param dev Pointer to the `bladerf` device structure
- * @param samples Pointer to the input sample array, where each element
- * represents a complex sample (interleaved I and Q components). The input array
- * should have a length of `2 * num_samples`, accounting for both I and Q
- * components.
- * @param num_samples The number of complex samples in the `samples` array. This
- * is not the length of the array but the number of complex samples (each
- * consisting of an I and a Q component).
- * @param convolved_samples Pointer to the output sample array where the
- * filtered samples will be stored. This array must be preallocated and have the
- * same length as the `samples` array to hold the convolved (filtered) output.
+ * Both values are in units of full scale squared.
+ */
+struct nf_stats {
+    double sum;     /**< Sum of \f$I^2 + Q^2\f$ */
+    double peak;    /**< Largest \f$I^2 + Q^2\f$ */
+};
+
+/**
+ * @brief Create a noise figure flattening filter for a device.
+ *
+ * @param dev Pointer to the `bladerf` device structure. Filtering is only
+ * performed for bladeRF 2.0 devices; other devices use a pass-through filter.
+ * @param num_channels The number of interleaved channels, at most
+ * NF_FILTER_MAX_CHANNELS.
+ * @param max_samples The largest number of samples, counting all channels,
+ * that will be passed to nf_filter_measure() at once. All memory is
+ * allocated up front.
  *
- * @return BLADERF_ERR_INVAL if any of the input pointers are NULL, indicating
- * an invalid parameter. Returns 0 on successful execution of the function.
+ * @return The filter, or NULL on allocation failure or an invalid number of
+ * channels
+ */
+struct nf_filter *nf_filter_create(struct bladerf *dev,
+                                   unsigned int num_channels,
+                                   size_t max_samples);
+
+/**
+ * @brief Filter a block of SC16 Q11 samples and measure each channel.
+ *
+ * All channels are measured in a single pass over the block.
+ *
+ * @param filter The filter
+ * @param samples Interleaved I and Q samples, in the channel order of the
+ * sync interface. The array should have a length of `2 * num_samples`.
+ * @param num_samples The number of samples, counting all channels. This must
+ * be a multiple of the number of channels, and at most the `max_samples` the
+ * filter was created with.
+ * @param stats Set to the statistics of each channel. The array should have
+ * one element per channel.
+ *
+ * @return BLADERF_ERR_INVAL if `num_samples` is invalid, or 0 on success.
+ */
+int nf_filter_measure(struct nf_filter *filter,
+                      const int16_t *samples,
+                      size_t num_samples,
+                      struct nf_stats *stats);
+
+/**
+ * @brief Clear the filter state, as when the input is discontinuous.
+ *
+ * @param filter The filter
+ */
+void nf_filter_reset(struct nf_filter *filter);
+
+/**
+ * @brief Free a filter.
  *
- * @note The function performs in-place filtering if the input and output arrays
- * are the same. Care must be taken to ensure adequate memory allocation for the
- * output to avoid memory corruption.
- * @note This function checks the device type and only performs filtering for
- * bladeRF 2.0 devices. For other devices, it copies the input samples to the
- * output buffer directly without filtering.
- * @note The filter coefficients and the filtering process are optimized for
- * specific frequency ranges and may not be suitable for all signal processing
- * needs.
+ * @param filter The filter to free. May be NULL.
  */
-int flatten_noise_figure(struct bladerf *dev,
-                         const int16_t *samples,
-                         size_t num_samples,
-                         int16_t *convolved_samples);
+void nf_filter_free(struct nf_filter *filter);
 
-#endif // FILTER_H_
\ No newline at end of file
+#endif // FILTER_H_
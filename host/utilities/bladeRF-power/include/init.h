@@ -29,6 +29,7 @@
 #define INIT_H
 
 #include "libbladeRF.h"
+#include "measure.h"
 
 struct test_params {
     bladerf_channel channel;
@@ -44,10 +45,16 @@ struct test_params {
     bladerf_sample_rate samp_rate;
     bladerf_sample_rate bandwidth;
     bladerf_direction direction;
-    double rx_power;
+    unsigned int num_channels;
+    unsigned int report_rate;
+    char *log_file;
+    struct measure_reading rx_readings[MEASURE_MAX_CHANNELS];
     bool gain_cal_enabled;
     char *gain_cal_file;
     bool show_messages;
+    bool show_spectrum;
+    bool spectrum_valid;
+    float spectrum[MEASURE_FFT_SIZE];
     char message_buffer[4096];  // Adjust size as needed
 };
 
@@ -58,6 +65,36 @@ struct test_params {
  */
 void init_params(struct test_params *test);
 
+/**
+ * @brief Get one of the channels under test
+ *
+ * @param test The test parameters
+ * @param dir The direction of the test
+ * @param i Index of the channel, less than `test->num_channels`
+ *
+ * @return The channel
+ */
+bladerf_channel test_channel(const struct test_params *test,
+                             bladerf_direction dir, unsigned int i);
+
+/**
+ * @brief Call a per-channel libbladeRF setter on each channel under test
+ *
+ * Expands to `CHECK(fn(dev, ch, ...))` for each channel, so the calling file
+ * must define CHECK() and an `error` label.
+ *
+ * @param fn The function to call, taking the device and channel first
+ * @param dev The device
+ * @param test The test parameters
+ * @param dir The direction of the test
+ * @param ... The remaining arguments to `fn`
+ */
+#define CHECK_EACH_CHANNEL(fn, dev, test, dir, ...) do { \
+    for (unsigned int _i = 0; _i < (test)->num_channels; _i++) { \
+        CHECK(fn(dev, test_channel(test, dir, _i), __VA_ARGS__)); \
+    } \
+} while (0)
+
 /**
  * @brief Initialize the device
  *
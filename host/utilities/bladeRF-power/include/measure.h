@@ -0,0 +1,140 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This program is intended to verify that C programs build against
+ * libbladeRF without any unintended dependencies.
+ */
+#ifndef MEASURE_H_
+#define MEASURE_H_
+
+#include <stdbool.h>
+#include "libbladeRF.h"
+
+/** Number of bins in the spectrum view */
+#define MEASURE_FFT_SIZE 1024
+
+/** Largest number of channels measured at once */
+#define MEASURE_MAX_CHANNELS 2
+
+/**
+ * @brief Continuous power measurement running on its own thread.
+ *
+ * For RX, every sample received is filtered and included in the readings,
+ * which are published at the report rate and optionally logged to a file.
+ * With two channels, both are streamed together and measured in a single
+ * pass. A Welch-averaged spectrum of the first channel can be computed
+ * alongside. For TX, the thread transmits a constant full-scale signal.
+ *
+ * The sync interface must be configured, and the channel enabled, before the
+ * measurement is started.
+ */
+struct measure;
+
+struct measure_config {
+    bladerf_channel ch;             /**< Channel to receive or transmit on,
+                                         or the first of the channels */
+    unsigned int num_channels;      /**< Number of channels, with the
+                                         layout of the sync interface */
+    bladerf_sample_rate samp_rate;  /**< Sample rate of the channel */
+    unsigned int report_rate;       /**< Readings per second */
+    unsigned int averages;          /**< Maximum number of FFT segments
+                                         averaged into each spectrum */
+    const char *log_file;           /**< CSV file to log each reading to,
+                                         or NULL */
+};
+
+/**
+ * @brief Readings of one channel over a report interval
+ */
+struct measure_reading {
+    double power;   /**< Average power, in dBFS */
+    double peak;    /**< Peak power, in dBFS */
+    double crest;   /**< Crest factor, in dB */
+};
+
+/**
+ * @brief Start a measurement thread.
+ *
+ * @param m Set to the measurement on success
+ * @param dev Device to stream with
+ * @param config Measurement settings
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for invalid settings,
+ * BLADERF_ERR_MEM on allocation failure, BLADERF_ERR_IO if the log file
+ * could not be opened, or BLADERF_ERR_UNEXPECTED if the thread could not be
+ * created.
+ */
+int measure_start(struct measure **m,
+                  struct bladerf *dev,
+                  const struct measure_config *config);
+
+/**
+ * @brief Get the latest readings.
+ *
+ * @param m The measurement
+ * @param readings Set to the readings of each channel over the last report
+ * interval. These are left unchanged if no reading has completed since the
+ * last restart.
+ *
+ * @return 0, or the error that stopped the measurement thread
+ */
+int measure_get_readings(struct measure *m, struct measure_reading *readings);
+
+/**
+ * @brief Enable or disable the spectrum computation.
+ *
+ * @param m The measurement
+ * @param enable Whether to compute the spectrum
+ */
+void measure_enable_spectrum(struct measure *m, bool enable);
+
+/**
+ * @brief Get the latest spectrum.
+ *
+ * @param m The measurement
+ * @param psd Set to the power in each of the MEASURE_FFT_SIZE bins, in dBFS,
+ * from the lowest to the highest frequency.
+ *
+ * @return true if a spectrum was available
+ */
+bool measure_get_spectrum(struct measure *m, float *psd);
+
+/**
+ * @brief Discard the readings in progress and the filter state.
+ *
+ * This should be called after retuning or changing the gain, so that
+ * readings do not mix samples from before and after the change.
+ *
+ * @param m The measurement
+ */
+void measure_restart(struct measure *m);
+
+/**
+ * @brief Stop the measurement thread and free the measurement.
+ *
+ * @param m The measurement. May be NULL.
+ */
+void measure_stop(struct measure *m);
+
+#endif // MEASURE_H_
@@ -27,12 +27,23 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <limits.h>
 #include <math.h>
 #include <string.h>
 #include "log.h"
 #include "libbladeRF.h"
+#include "filter.h"
+
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FILTER_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FILTER_NEON 1
+#endif
 
 #define CHECK_NULL(...) do { \
     const void* _args[] = { __VA_ARGS__, NULL }; \
@@ -103,33 +114,224 @@ static device_fir_filter_t* get_device_filter(struct bladerf *dev) {
     return &filters[0]; // Default filter
 }
 
-int flatten_noise_figure(struct bladerf *dev,
-                         const int16_t *samples,
-                         size_t num_samples,
-                         int16_t *convolved_samples)
+/* Samples per channel filtered between each transfer of the float
+ * accumulators to the double precision sums */
+#define FILTER_CHUNK 1024
+
+/* Ratio of the SC16 Q11 scale used by bladerf_convert_samples() to the
+ * full scale of the power readings */
+#define FULL_SCALE_RATIO (2048.0 / 2047.0)
+
+struct nf_filter {
+    /* Taps, in single precision */
+    float *taps;
+    size_t num_taps;
+
+    unsigned int num_channels;
+
+    /* Samples converted to float, preceded by the last num_taps - 1
+     * samples of each channel from the previous block */
+    float *work;
+    size_t history;
+    size_t max_samples;
+};
+
+struct nf_filter *nf_filter_create(struct bladerf *dev,
+                                   unsigned int num_channels,
+                                   size_t max_samples)
+{
+    const device_fir_filter_t *fir = get_device_filter(dev);
+    struct nf_filter *filter;
+    size_t i;
+
+    if (num_channels < 1 || num_channels > NF_FILTER_MAX_CHANNELS) {
+        return NULL;
+    }
+
+    filter = calloc(1, sizeof(*filter));
+    if (filter == NULL) {
+        return NULL;
+    }
+
+    filter->num_taps     = fir->tap_num;
+    filter->num_channels = num_channels;
+    filter->history      = 2 * num_channels * (fir->tap_num - 1);
+    filter->max_samples  = max_samples;
+    filter->taps = malloc(fir->tap_num * sizeof(float));
+    filter->work = calloc(filter->history + 2 * max_samples, sizeof(float));
+
+    if (filter->taps == NULL || filter->work == NULL) {
+        nf_filter_free(filter);
+        return NULL;
+    }
+
+    for (i = 0; i < fir->tap_num; i++) {
+        filter->taps[i] = (float)fir->filter_taps[i];
+    }
+
+    return filter;
+}
+
+void nf_filter_reset(struct nf_filter *filter)
+{
+    memset(filter->work, 0, filter->history * sizeof(float));
+}
+
+void nf_filter_free(struct nf_filter *filter)
+{
+    if (filter != NULL) {
+        free(filter->taps);
+        free(filter->work);
+        free(filter);
+    }
+}
+
+/* Filter `n` values starting at `x`, which must be the start of a sample of
+ * the first channel. Output value m is the sum over taps j of taps[j] times
+ * x[m - 2 * num_channels * j], so I and Q of every channel are filtered
+ * alike.
+ *
+ * With one or two channels, value m belongs to channel (m / 2) % num_channels
+ * and that holds for each of the four lanes below, since m advances by four.
+ * The lanes accumulate their own sums and peaks, and are folded into the
+ * channels' statistics at the end. */
+static void filter_chunk(const struct nf_filter *filter,
+                         const float *x,
+                         size_t n,
+                         struct nf_stats *stats)
+{
+    const size_t step = 2 * filter->num_channels;
+    float sum[4]      = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float peak[4]     = { 0.0f, 0.0f, 0.0f, 0.0f };
+    size_t m = 0, j, k;
+
+#if defined(FILTER_SSE)
+    __m128 acc = _mm_setzero_ps();
+    __m128 pk  = _mm_setzero_ps();
+
+    for (; m + 4 <= n; m += 4) {
+        const float *xm = x + m;
+        __m128 y        = _mm_setzero_ps();
+
+        for (j = 0; j < filter->num_taps; j++) {
+            const ptrdiff_t d = -(ptrdiff_t)(step * j);
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(filter->taps[j]),
+                                         _mm_loadu_ps(&xm[d])));
+        }
+
+        y   = _mm_mul_ps(y, y);
+        acc = _mm_add_ps(acc, y);
+
+        /* I^2 + Q^2 of each sample, in both of its lanes */
+        y  = _mm_add_ps(y, _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 3, 0, 1)));
+        pk = _mm_max_ps(pk, y);
+    }
+
+    _mm_storeu_ps(sum, acc);
+    _mm_storeu_ps(peak, pk);
+#elif defined(FILTER_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    float32x4_t pk  = vdupq_n_f32(0.0f);
+
+    for (; m + 4 <= n; m += 4) {
+        const float *xm = x + m;
+        float32x4_t y   = vdupq_n_f32(0.0f);
+
+        for (j = 0; j < filter->num_taps; j++) {
+            const ptrdiff_t d = -(ptrdiff_t)(step * j);
+            y = vmlaq_n_f32(y, vld1q_f32(&xm[d]), filter->taps[j]);
+        }
+
+        y   = vmulq_f32(y, y);
+        acc = vaddq_f32(acc, y);
+
+        /* I^2 + Q^2 of each sample, in both of its lanes */
+        y  = vaddq_f32(y, vrev64q_f32(y));
+        pk = vmaxq_f32(pk, y);
+    }
+
+    vst1q_f32(sum, acc);
+    vst1q_f32(peak, pk);
+#endif
+
+    for (; m < n; m += 2) {
+        const size_t lane = m % 4;
+        const float *xm   = x + m;
+        float yi = 0.0f, yq = 0.0f, p;
+
+        for (j = 0; j < filter->num_taps; j++) {
+            const ptrdiff_t d = -(ptrdiff_t)(step * j);
+            yi += filter->taps[j] * xm[d];
+            yq += filter->taps[j] * xm[d + 1];
+        }
+
+        sum[lane] += yi * yi;
+        sum[lane + 1] += yq * yq;
+
+        p = yi * yi + yq * yq;
+        if (p > peak[lane]) {
+            peak[lane] = p;
+        }
+    }
+
+    for (k = 0; k < 4; k++) {
+        struct nf_stats *s = &stats[(k / 2) % filter->num_channels];
+
+        s->sum += sum[k];
+        if (peak[k] > s->peak) {
+            s->peak = peak[k];
+        }
+    }
+}
+
+int nf_filter_measure(struct nf_filter *filter,
+                      const int16_t *samples,
+                      size_t num_samples,
+                      struct nf_stats *stats)
 {
-    int status = 0;
-    double acc_i, acc_q;
-    CHECK_NULL(dev, samples, convolved_samples);
-
-    device_fir_filter_t* filter = get_device_filter(dev);
-
-    for (size_t i = 0; i < num_samples; i++) {
-        acc_i = 0.0;
-        acc_q = 0.0;
-
-        // Convolve filter with input samples
-        for (size_t j = 0; j < filter->tap_num; j++) {
-            if (i >= j) {
-                acc_i += filter->filter_taps[j] * (double)samples[2*(i-j)];
-                acc_q += filter->filter_taps[j] * (double)samples[2*(i-j) + 1];
-            }
+    const double scale = FULL_SCALE_RATIO * FULL_SCALE_RATIO;
+    const size_t chunk = 2 * FILTER_CHUNK * filter->num_channels;
+    unsigned int c;
+    size_t off;
+    int status;
+
+    CHECK_NULL(filter, samples, stats);
+
+    if (num_samples > filter->max_samples ||
+        num_samples % filter->num_channels != 0) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    status = bladerf_convert_samples(BLADERF_SAMPLE_SC16, samples,
+                                     BLADERF_SAMPLE_CF32,
+                                     filter->work + filter->history,
+                                     num_samples);
+    if (status != 0) {
+        return status;
+    }
+
+    for (c = 0; c < filter->num_channels; c++) {
+        stats[c].sum  = 0.0;
+        stats[c].peak = 0.0;
+    }
+
+    for (off = 0; off < 2 * num_samples; off += chunk) {
+        size_t n = 2 * num_samples - off;
+        if (n > chunk) {
+            n = chunk;
         }
 
-        // Clamping to the to int16_t
-        convolved_samples[2*i] = (int16_t)(fmax(fmin(acc_i, INT16_MAX), INT16_MIN));
-        convolved_samples[2*i + 1] = (int16_t)(fmax(fmin(acc_q, INT16_MAX), INT16_MIN));
+        filter_chunk(filter, filter->work + filter->history + off, n, stats);
+    }
+
+    for (c = 0; c < filter->num_channels; c++) {
+        stats[c].sum *= scale;
+        stats[c].peak *= scale;
     }
 
-    return status;
+    /* Carry the end of this block over as the history of the next */
+    memmove(filter->work, filter->work + 2 * num_samples,
+            filter->history * sizeof(float));
+
+    return 0;
 }
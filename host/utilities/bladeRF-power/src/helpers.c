@@ -33,9 +33,13 @@
 #include "helpers.h"
 #include "libbladeRF.h"
 #include "log.h"
-#include "filter.h"
+#include "measure.h"
 
-#define INT12_MAX 2047
+/* Refresh rate of the display */
+#define UI_RATE 30
+
+/* Number of FFT segments averaged into each spectrum */
+#define SPECTRUM_AVERAGES 16
 
 #define CHECK(fn) do { \
     status = fn; \
@@ -46,16 +50,6 @@
     } \
 } while (0)
 
-#define CHECK_NULL(...) do { \
-    const void* _args[] = { __VA_ARGS__, NULL }; \
-    for (size_t _i = 0; _args[_i] != NULL; ++_i) { \
-        if (_args[_i] == NULL) { \
-            log_error("%s:%d: Argument %zu is a NULL pointer\n", __FILE__, __LINE__, _i + 1); \
-            return BLADERF_ERR_INVAL; \
-        } \
-    } \
-} while (0)
-
 bladerf_direction ask_direction() {
     char direction;
     printf("Enter direction (tx/rx/q[uit]): ");
@@ -78,42 +72,14 @@ bladerf_direction ask_direction() {
     }
 }
 
-static int calculate_power(struct bladerf *dev, const int16_t *samples, size_t num_samples, double *power) {
-    CHECK_NULL(dev, samples, power);
-    int status = 0;
-    double sum = 0;
-    int16_t *samples_filtered = NULL;
-
-    samples_filtered = malloc(2 * num_samples * sizeof(int16_t));
-    CHECK_NULL(samples_filtered);
-
-    CHECK(flatten_noise_figure(dev, samples, num_samples, samples_filtered));
-
-    for (size_t i = 0; i < num_samples; i++) {
-        sum += (samples_filtered[2*i] * samples_filtered[2*i]) + (samples_filtered[2*i+1] * samples_filtered[2*i+1]);
-    }
-
-    const double avg_power = sum / num_samples;
-    const double max_power = INT12_MAX * INT12_MAX;
-    const double avg_power_dbfs = 10 * log10(avg_power / max_power);
-    *power = avg_power_dbfs;
-
-error:
-    if (samples_filtered != NULL)
-        free(samples_filtered);
-
-    return status;
-}
-
 int start_streaming(struct bladerf *dev, struct test_params *test) {
     int status = 0;
     WINDOW *main_win = NULL;
-    const size_t num_samples = test->samp_rate / 30; // 30Hz
+    struct measure *meas = NULL;
+    struct measure_config meas_config;
     const struct bladerf_gain_cal_tbl *gain_tbl = NULL;
 
-    bladerf_channel ch = (test->direction == BLADERF_TX)
-        ? BLADERF_CHANNEL_TX(test->channel)
-        : BLADERF_CHANNEL_RX(test->channel);
+    bladerf_channel ch = test_channel(test, test->direction, 0);
 
     if (test->direction == BLADERF_TX)
         test->gain_mode = BLADERF_GAIN_MGC;
@@ -129,26 +95,21 @@ int start_streaming(struct bladerf *dev, struct test_params *test) {
     close(pipefd[1]);
     fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
 
-    int16_t *samples = malloc(2 * num_samples * sizeof(int16_t));
-    if (samples == NULL) {
-        fprintf(stderr, "Error allocating memory for samples. Exiting...\n");
-        return BLADERF_ERR_INVAL;
-    }
-
-    if (test->direction == BLADERF_TX) {
-        for (size_t i = 0; i < num_samples; i++) {
-            samples[2*i]   = INT12_MAX;
-            samples[2*i+1] = INT12_MAX;
-        }
-    }
-
     CHECK(bladerf_get_gain_calibration(dev, ch, &gain_tbl));
     test->gain_cal_enabled = gain_tbl->enabled;
 
-    CHECK(bladerf_enable_module(dev, ch, true));
+    CHECK_EACH_CHANNEL(bladerf_enable_module, dev, test, test->direction, true);
     CHECK(bladerf_get_gain(dev, ch, &test->gain_actual));
     CHECK(bladerf_get_frequency(dev, ch, &test->frequency_actual));
 
+    meas_config.ch           = ch;
+    meas_config.num_channels = test->num_channels;
+    meas_config.samp_rate    = test->samp_rate;
+    meas_config.report_rate  = test->report_rate;
+    meas_config.averages     = SPECTRUM_AVERAGES;
+    meas_config.log_file     = test->log_file;
+    CHECK(measure_start(&meas, dev, &meas_config));
+
     int cmd = 0;
     init_curses(&main_win);
     bool show_calibration_info = false;
@@ -160,14 +121,22 @@ int start_streaming(struct bladerf *dev, struct test_params *test) {
         if (cmd == 'l' || cmd == KEY_RIGHT) {
             bladerf_frequency next_freq = test->frequency + 5e6;
             test->frequency = (next_freq > test->freq_max) ? test->freq_max : next_freq;
-            CHECK(bladerf_set_frequency(dev, ch, test->frequency));
+            CHECK_EACH_CHANNEL(bladerf_set_frequency, dev, test,
+                               test->direction, test->frequency);
             CHECK(bladerf_get_frequency(dev, ch, &test->frequency_actual));
+            measure_restart(meas);
         }
 
         if (cmd == 'm') {
             test->show_messages = !test->show_messages;
         }
 
+        if (cmd == 's' && test->direction == BLADERF_RX) {
+            test->show_spectrum  = !test->show_spectrum;
+            test->spectrum_valid = false;
+            measure_enable_spectrum(meas, test->show_spectrum);
+        }
+
         // Read from stderr pipe
         char temp_buffer[1024];
         ssize_t bytes_read;
@@ -185,25 +154,33 @@ int start_streaming(struct bladerf *dev, struct test_params *test) {
         if (cmd == 'h' || cmd == KEY_LEFT) {
             bladerf_frequency next_freq = test->frequency - 5e6;
             test->frequency = (next_freq < test->freq_min) ? test->freq_min : next_freq;
-            CHECK(bladerf_set_frequency(dev, ch, test->frequency));
+            CHECK_EACH_CHANNEL(bladerf_set_frequency, dev, test,
+                               test->direction, test->frequency);
             CHECK(bladerf_get_frequency(dev, ch, &test->frequency_actual));
+            measure_restart(meas);
         }
 
         if ((cmd == 'k' || cmd == KEY_UP) && test->gain + 1 <= test->gain_max) {
-            CHECK(bladerf_set_gain(dev, ch, test->gain + 1));
+            CHECK_EACH_CHANNEL(bladerf_set_gain, dev, test, test->direction,
+                               test->gain + 1);
             CHECK(bladerf_get_gain(dev, ch, &test->gain_actual));
+            measure_restart(meas);
         }
 
         if ((cmd == 'j' || cmd == KEY_DOWN) && test->gain - 1 >= test->gain_min) {
-            CHECK(bladerf_set_gain(dev, ch, test->gain - 1));
+            CHECK_EACH_CHANNEL(bladerf_set_gain, dev, test, test->direction,
+                               test->gain - 1);
             CHECK(bladerf_get_gain(dev, ch, &test->gain_actual));
+            measure_restart(meas);
         }
 
         if (cmd == 'c') {
             CHECK(bladerf_get_gain_calibration(dev, ch, &gain_tbl));
-            CHECK(bladerf_enable_gain_calibration(dev, ch, !gain_tbl->enabled));
+            CHECK_EACH_CHANNEL(bladerf_enable_gain_calibration, dev, test,
+                               test->direction, !gain_tbl->enabled);
             CHECK(bladerf_get_gain_calibration(dev, ch, &gain_tbl));
             test->gain_cal_enabled = gain_tbl->enabled;
+            measure_restart(meas);
         }
 
         if (cmd == 'a' && BLADERF_CHANNEL_IS_TX(ch) == false) {
@@ -213,7 +190,8 @@ int start_streaming(struct bladerf *dev, struct test_params *test) {
                             ? BLADERF_GAIN_DEFAULT
                             : BLADERF_GAIN_MGC;
 
-            CHECK(bladerf_set_gain_mode(dev, ch, next_mode));
+            CHECK_EACH_CHANNEL(bladerf_set_gain_mode, dev, test,
+                               test->direction, next_mode);
             CHECK(bladerf_get_gain_mode(dev, ch, &test->gain_mode));
         }
 
@@ -228,6 +206,11 @@ int start_streaming(struct bladerf *dev, struct test_params *test) {
         CHECK(bladerf_get_gain(dev, ch, &test->gain_actual));
         CHECK(bladerf_get_gain_target(dev, ch, &test->gain));
 
+        CHECK(measure_get_readings(meas, test->rx_readings));
+        if (test->show_spectrum) {
+            test->spectrum_valid = measure_get_spectrum(meas, test->spectrum);
+        }
+
         update_window(main_win, test);
 
         if (show_calibration_info) {
@@ -236,16 +219,11 @@ int start_streaming(struct bladerf *dev, struct test_params *test) {
             display_overlay(main_win, cal_tbl);
         }
 
-        if (test->direction == BLADERF_RX) {
-            CHECK(bladerf_sync_rx(dev, samples, num_samples, NULL, 1000));
-            CHECK(calculate_power(dev, samples, num_samples, &test->rx_power));
-        } else {
-            CHECK(bladerf_sync_tx(dev, samples, num_samples, NULL, 1000));
-        }
+        napms(1000 / UI_RATE);
     }
 
 error:
-    free(samples);
+    measure_stop(meas);
     delwin(main_win);
     endwin();
 
@@ -26,6 +26,7 @@
  * libbladeRF without any unintended dependencies.
  */
 #include <stdio.h>
+#include <string.h>
 #include "init.h"
 #include "helpers.h"
 #include "libbladeRF.h"
@@ -56,35 +57,62 @@ void init_params(struct test_params *test) {
     test->bandwidth = test->samp_rate;
     test->direction = DIRECTION_UNSET;
 
-    test->rx_power = 0.0;
+    test->num_channels = 1;
+    test->report_rate  = 30;
+    test->log_file     = NULL;
+    memset(test->rx_readings, 0, sizeof(test->rx_readings));
     test->gain_cal_enabled = false;
     test->gain_cal_file = NULL;
+
+    test->show_spectrum  = false;
+    test->spectrum_valid = false;
+}
+
+bladerf_channel test_channel(const struct test_params *test,
+                             bladerf_direction dir, unsigned int i) {
+    return (dir == BLADERF_TX)
+        ? BLADERF_CHANNEL_TX(test->channel + i)
+        : BLADERF_CHANNEL_RX(test->channel + i);
 }
 
 int dev_init(struct bladerf *dev, bladerf_direction dir, struct test_params *test) {
     int status = 0;
     const struct bladerf_range *freq_range;
     const struct bladerf_range *gain_range;
-    bladerf_channel_layout layout = (dir == BLADERF_TX) ? BLADERF_TX_X1 : BLADERF_RX_X1;
+    bladerf_channel_layout layout;
     bladerf_format format = BLADERF_FORMAT_SC16_Q11;
     size_t num_buffers = 512;
     size_t buffer_size = 16*1024;
     size_t num_transfers = 32;
     size_t stream_timeout = 1000; //ms
 
-    bladerf_channel ch = (dir == BLADERF_TX)
-        ? BLADERF_CHANNEL_TX(test->channel)
-        : BLADERF_CHANNEL_RX(test->channel);
+    bladerf_channel ch = test_channel(test, dir, 0);
+
+    if (test->num_channels == 2) {
+        if (dir != BLADERF_RX || test->channel != 0 ||
+            bladerf_get_channel_count(dev, BLADERF_RX) < 2) {
+            fprintf(stderr, "Measuring both channels requires RX mode on a "
+                            "device with two RX channels.\n");
+            return BLADERF_ERR_UNSUPPORTED;
+        }
+        layout = BLADERF_RX_X2;
+    } else {
+        layout = (dir == BLADERF_TX) ? BLADERF_TX_X1 : BLADERF_RX_X1;
+    }
+
+    CHECK_EACH_CHANNEL(bladerf_set_gain, dev, test, dir, test->gain);
+    CHECK_EACH_CHANNEL(bladerf_set_sample_rate, dev, test, dir, test->samp_rate,
+                       NULL);
+    CHECK_EACH_CHANNEL(bladerf_set_bandwidth, dev, test, dir, test->bandwidth,
+                       &test->bandwidth);
+    CHECK_EACH_CHANNEL(bladerf_set_frequency, dev, test, dir, test->frequency);
 
-    CHECK(bladerf_set_gain(dev, ch, test->gain));
-    CHECK(bladerf_set_sample_rate(dev, ch, test->samp_rate, NULL));
-    CHECK(bladerf_set_bandwidth(dev, ch, test->bandwidth, &test->bandwidth));
-    CHECK(bladerf_set_frequency(dev, ch, test->frequency));
     CHECK(bladerf_sync_config(dev, layout, format, num_buffers, buffer_size,
                               num_transfers, stream_timeout));
 
     if (dir == BLADERF_RX) {
-        CHECK(bladerf_set_gain_mode(dev, ch, test->gain_mode));
+        CHECK_EACH_CHANNEL(bladerf_set_gain_mode, dev, test, dir,
+                           test->gain_mode);
         CHECK(bladerf_get_gain_mode(dev, ch, &test->gain_mode));
     }
 
@@ -96,7 +124,8 @@ int dev_init(struct bladerf *dev, bladerf_direction dir, struct test_params *tes
     test->gain_min = gain_range->min * gain_range->scale;
     test->gain_max = gain_range->max * gain_range->scale;
 
-    CHECK(bladerf_load_gain_calibration(dev, ch, test->gain_cal_file));
+    CHECK_EACH_CHANNEL(bladerf_load_gain_calibration, dev, test, dir,
+                       test->gain_cal_file);
 
 error:
     return status;
@@ -41,15 +41,18 @@
     } \
 } while (0)
 
-#define OPTSTR "d:c:l:trf:s:v:h"
+#define OPTSTR "d:c:l:tr2f:s:o:R:v:h"
 struct option long_options[] = {
     { "device",     required_argument,  NULL,   'd' },
     { "channel",    required_argument,  NULL,   'c' },
     { "load",       required_argument,  NULL,   'l' },
     { "tx",         no_argument,        NULL,   't' },
     { "rx",         no_argument,        NULL,   'r' },
+    { "both",       no_argument,        NULL,   '2' },
     { "frequency",  required_argument,  NULL,   'f' },
     { "sample-rate",required_argument,  NULL,   's' },
+    { "log",        required_argument,  NULL,   'o' },
+    { "rate",       required_argument,  NULL,   'R' },
     { "verbosity",  optional_argument,  NULL,   'v' },
     { "help",       no_argument,        NULL,   'h' },
     { NULL,         0,                  NULL,   0   },
@@ -102,10 +105,26 @@ int main(int argc, char *argv[])
                 test.direction = (opt == 't') ? BLADERF_TX : BLADERF_RX;
                 break;
 
+            case '2':
+                test.num_channels = 2;
+                break;
+
             case 'l':
                 test.gain_cal_file = optarg;
                 break;
 
+            case 'o':
+                test.log_file = optarg;
+                break;
+
+            case 'R':
+                test.report_rate = str2uint(optarg, 1, 1000, &ok);
+                if (!ok) {
+                    fprintf(stderr, "Invalid measurement rate: %s\n", optarg);
+                    return -1;
+                }
+                break;
+
             case 's':
                 test.samp_rate = str2uint_suffix(optarg, 0, UINT32_MAX, freq_suffixes,
                     NUM_FREQ_SUFFIXES, &ok);
@@ -127,8 +146,11 @@ int main(int argc, char *argv[])
                 printf("  -l, --load <file>         Load a specified gain cal file (.csv or .tbl).\n");
                 printf("  -t, --tx                  Transmit mode. Can't be combined with --rx.\n");
                 printf("  -r, --rx                  Receive mode. Can't be combined with --tx.\n");
+                printf("  -2, --both                Measure both RX channels at once (RX mode only).\n");
                 printf("  -f, --frequency <freq>    Set the initial frequency (in Hz).\n");
                 printf("  -s, --sample-rate <rate>  Set the initial sample rate (in Hz).\n");
+                printf("  -o, --log <file>          Log timestamped measurements to a CSV file.\n");
+                printf("  -R, --rate <rate>         Measurements per second, 1 to 1000 (default: 30).\n");
                 printf("  -v, --verbosity <level>   Set the libbladeRF verbosity level (e.g., verbose, debug).\n");
                 printf("  -h, --help                Display this help text and exit.\n");
                 printf("\n");
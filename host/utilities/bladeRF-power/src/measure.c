@@ -0,0 +1,520 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2024 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This program is intended to verify that C programs build against
+ * libbladeRF without any unintended dependencies.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <inttypes.h>
+#include "measure.h"
+#include "filter.h"
+#include "fft.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define INT12_MAX 2047
+
+/* Samples per sync call. This matches the sync buffer size configured by
+ * dev_init(), so that the thread runs at the same granularity as the
+ * stream. */
+#define BLOCK_SAMPLES (16 * 1024)
+
+#define STREAM_TIMEOUT_MS 1000
+
+/* Spectra per second, independent of the report rate */
+#define SPECTRUM_RATE 30
+
+/* stdio buffer for the log file, so that high logging rates cost few
+ * writes */
+#define LOG_BUFFER_SIZE (256 * 1024)
+
+struct measure {
+    struct bladerf *dev;
+    struct measure_config config;
+    pthread_t thread;
+
+    /* Everything below is only used by the thread */
+    int16_t *samples;
+    struct nf_filter *filter;
+    struct nf_stats stats[MEASURE_MAX_CHANNELS];
+    uint64_t report_samples;
+    uint64_t total_samples;
+    double sum[MEASURE_MAX_CHANNELS];
+    double peak[MEASURE_MAX_CHANNELS];
+    uint64_t num_summed;
+    FILE *log;
+
+    struct fft_plan *plan;
+    float *window;
+    double window_power;
+    float *seg_re, *seg_im;     /* Most recent MEASURE_FFT_SIZE samples */
+    float *fft_re, *fft_im;     /* Windowed copy, transformed in place */
+    double *psd_sum;
+    uint64_t spectrum_samples;
+    uint64_t spectrum_interval;
+    unsigned int seg_fill;
+    unsigned int num_segs;
+
+    /* Everything below is shared with the caller, under `lock` */
+    pthread_mutex_t lock;
+    bool running;
+    int status;
+    unsigned int generation;
+    bool spectrum_enabled;
+    bool readings_valid;
+    struct measure_reading readings[MEASURE_MAX_CHANNELS];
+    bool spectrum_valid;
+    float psd[MEASURE_FFT_SIZE];
+};
+
+static void reset_spectrum(struct measure *m)
+{
+    m->spectrum_samples = 0;
+    m->seg_fill = 0;
+    m->num_segs = 0;
+    memset(m->psd_sum, 0, MEASURE_FFT_SIZE * sizeof(double));
+}
+
+static void reset_readings(struct measure *m)
+{
+    nf_filter_reset(m->filter);
+    memset(m->sum, 0, sizeof(m->sum));
+    memset(m->peak, 0, sizeof(m->peak));
+    m->num_summed = 0;
+    reset_spectrum(m);
+}
+
+/* Add samples of the first channel to the Welch estimate. Segments overlap by
+ * half, and at most `averages` of them are transformed per spectrum, so that
+ * the spectrum never holds the thread back from keeping up with the stream.
+ * `num_samples` counts the samples of each channel. */
+static void accumulate_spectrum(struct measure *m,
+                                const int16_t *samples,
+                                size_t num_samples)
+{
+    const unsigned int n   = MEASURE_FFT_SIZE;
+    const unsigned int nch = m->config.num_channels;
+    const float scale      = 1.0f / 2048.0f;
+    size_t i = 0;
+    unsigned int k;
+
+    while (i < num_samples && m->num_segs < m->config.averages) {
+        while (m->seg_fill < n && i < num_samples) {
+            m->seg_re[m->seg_fill] = samples[2 * nch * i] * scale;
+            m->seg_im[m->seg_fill] = samples[2 * nch * i + 1] * scale;
+            m->seg_fill++;
+            i++;
+        }
+
+        if (m->seg_fill < n) {
+            break;
+        }
+
+        for (k = 0; k < n; k++) {
+            m->fft_re[k] = m->seg_re[k] * m->window[k];
+            m->fft_im[k] = m->seg_im[k] * m->window[k];
+        }
+
+        fft_execute(m->plan, m->fft_re, m->fft_im);
+
+        for (k = 0; k < n; k++) {
+            m->psd_sum[k] += (double)m->fft_re[k] * m->fft_re[k] +
+                             (double)m->fft_im[k] * m->fft_im[k];
+        }
+
+        m->num_segs++;
+
+        memmove(m->seg_re, m->seg_re + n / 2, n / 2 * sizeof(float));
+        memmove(m->seg_im, m->seg_im + n / 2, n / 2 * sizeof(float));
+        m->seg_fill = n / 2;
+    }
+}
+
+/* Append the readings to the log, as one line of comma-separated values */
+static int log_readings(struct measure *m)
+{
+    struct timespec now;
+    unsigned int c;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    fprintf(m->log, "%lld.%06ld,%" PRIu64, (long long)now.tv_sec,
+            now.tv_nsec / 1000, m->total_samples);
+
+    for (c = 0; c < m->config.num_channels; c++) {
+        fprintf(m->log, ",%.3f,%.3f,%.3f", m->readings[c].power,
+                m->readings[c].peak, m->readings[c].crest);
+    }
+
+    fputc('\n', m->log);
+
+    return ferror(m->log) ? BLADERF_ERR_IO : 0;
+}
+
+/* Publish the readings of the interval that just completed */
+static int publish_readings(struct measure *m)
+{
+    unsigned int c;
+
+    pthread_mutex_lock(&m->lock);
+
+    for (c = 0; c < m->config.num_channels; c++) {
+        struct measure_reading *r = &m->readings[c];
+
+        r->power = 10 * log10(m->sum[c] / m->num_summed);
+        r->peak  = 10 * log10(m->peak[c]);
+        r->crest = r->peak - r->power;
+    }
+
+    m->readings_valid = true;
+
+    pthread_mutex_unlock(&m->lock);
+
+    memset(m->sum, 0, sizeof(m->sum));
+    memset(m->peak, 0, sizeof(m->peak));
+    m->num_summed = 0;
+
+    /* Only the thread writes the readings, so they can be read unlocked */
+    return (m->log != NULL) ? log_readings(m) : 0;
+}
+
+/* Publish the spectrum, if any segments were transformed */
+static void publish_spectrum(struct measure *m)
+{
+    const double full_scale = (2048.0 / INT12_MAX) * (2048.0 / INT12_MAX);
+    const unsigned int n    = MEASURE_FFT_SIZE;
+    unsigned int k;
+
+    if (m->num_segs > 0) {
+        const double norm = full_scale / (m->num_segs * n * m->window_power);
+
+        pthread_mutex_lock(&m->lock);
+
+        /* Reorder so that DC is in the middle */
+        for (k = 0; k < n; k++) {
+            m->psd[(k + n / 2) % n] =
+                (float)(10 * log10(m->psd_sum[k] * norm + 1e-20));
+        }
+
+        m->spectrum_valid = true;
+
+        pthread_mutex_unlock(&m->lock);
+    }
+
+    reset_spectrum(m);
+}
+
+static void *rx_thread(void *arg)
+{
+    struct measure *m       = arg;
+    const unsigned int nch  = m->config.num_channels;
+    const size_t per_ch     = BLOCK_SAMPLES / nch;
+    unsigned int generation = 0;
+    bool spectrum           = false;
+    bool running            = true;
+    int status              = 0;
+    size_t off, n;
+    unsigned int c;
+
+    while (running) {
+        pthread_mutex_lock(&m->lock);
+        running = m->running;
+        if (m->generation != generation) {
+            generation = m->generation;
+            reset_readings(m);
+        }
+        if (m->spectrum_enabled != spectrum) {
+            spectrum = m->spectrum_enabled;
+            reset_spectrum(m);
+        }
+        pthread_mutex_unlock(&m->lock);
+
+        status = bladerf_sync_rx(m->dev, m->samples, BLOCK_SAMPLES, NULL,
+                                 STREAM_TIMEOUT_MS);
+        if (status != 0) {
+            break;
+        }
+
+        /* Split the block at report boundaries, so that each report covers
+         * exactly its interval however high the report rate */
+        for (off = 0; off < per_ch; off += n) {
+            const int16_t *samples = m->samples + 2 * nch * off;
+
+            n = per_ch - off;
+            if (n > m->report_samples - m->num_summed) {
+                n = m->report_samples - m->num_summed;
+            }
+
+            status = nf_filter_measure(m->filter, samples, n * nch, m->stats);
+            if (status != 0) {
+                goto out;
+            }
+
+            for (c = 0; c < nch; c++) {
+                m->sum[c] += m->stats[c].sum;
+                if (m->stats[c].peak > m->peak[c]) {
+                    m->peak[c] = m->stats[c].peak;
+                }
+            }
+
+            m->num_summed += n;
+            m->total_samples += n;
+
+            if (spectrum) {
+                accumulate_spectrum(m, samples, n);
+
+                m->spectrum_samples += n;
+                if (m->spectrum_samples >= m->spectrum_interval) {
+                    publish_spectrum(m);
+                }
+            }
+
+            if (m->num_summed == m->report_samples) {
+                status = publish_readings(m);
+                if (status != 0) {
+                    goto out;
+                }
+            }
+        }
+    }
+
+out:
+    if (status != 0) {
+        fprintf(stderr, "[Error] Measurement stopped: %s\n",
+                bladerf_strerror(status));
+
+        pthread_mutex_lock(&m->lock);
+        m->status = status;
+        pthread_mutex_unlock(&m->lock);
+    }
+
+    return NULL;
+}
+
+static void *tx_thread(void *arg)
+{
+    struct measure *m = arg;
+    bool running      = true;
+    int status        = 0;
+    size_t i;
+
+    for (i = 0; i < 2 * BLOCK_SAMPLES; i++) {
+        m->samples[i] = INT12_MAX;
+    }
+
+    while (running && status == 0) {
+        status = bladerf_sync_tx(m->dev, m->samples, BLOCK_SAMPLES, NULL,
+                                 STREAM_TIMEOUT_MS);
+
+        pthread_mutex_lock(&m->lock);
+        running = m->running;
+        pthread_mutex_unlock(&m->lock);
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "[Error] Transmission stopped: %s\n",
+                bladerf_strerror(status));
+
+        pthread_mutex_lock(&m->lock);
+        m->status = status;
+        pthread_mutex_unlock(&m->lock);
+    }
+
+    return NULL;
+}
+
+static void free_measure(struct measure *m)
+{
+    if (m->log != NULL) {
+        fclose(m->log);
+    }
+
+    free(m->samples);
+    nf_filter_free(m->filter);
+    fft_plan_free(m->plan);
+    free(m->window);
+    free(m->seg_re);
+    free(m->seg_im);
+    free(m->fft_re);
+    free(m->fft_im);
+    free(m->psd_sum);
+    free(m);
+}
+
+int measure_start(struct measure **m_out,
+                  struct bladerf *dev,
+                  const struct measure_config *config)
+{
+    const unsigned int n = MEASURE_FFT_SIZE;
+    struct measure *m;
+    unsigned int k;
+    int status;
+
+    if (config->num_channels < 1 ||
+        config->num_channels > MEASURE_MAX_CHANNELS ||
+        config->report_rate < 1) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    m = calloc(1, sizeof(*m));
+    if (m == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    m->dev            = dev;
+    m->config         = *config;
+    m->report_samples = config->samp_rate / config->report_rate;
+    if (m->report_samples == 0) {
+        m->report_samples = 1;
+    }
+    m->spectrum_interval = config->samp_rate / SPECTRUM_RATE;
+    m->running        = true;
+
+    m->samples = malloc(2 * BLOCK_SAMPLES * sizeof(int16_t));
+    m->filter  = nf_filter_create(dev, config->num_channels, BLOCK_SAMPLES);
+    m->plan    = fft_plan_create(n);
+    m->window  = malloc(n * sizeof(float));
+    m->seg_re  = malloc(n * sizeof(float));
+    m->seg_im  = malloc(n * sizeof(float));
+    m->fft_re  = malloc(n * sizeof(float));
+    m->fft_im  = malloc(n * sizeof(float));
+    m->psd_sum = calloc(n, sizeof(double));
+
+    if (m->samples == NULL || m->filter == NULL || m->plan == NULL ||
+        m->window == NULL || m->seg_re == NULL || m->seg_im == NULL ||
+        m->fft_re == NULL || m->fft_im == NULL || m->psd_sum == NULL) {
+        free_measure(m);
+        return BLADERF_ERR_MEM;
+    }
+
+    if (config->log_file != NULL) {
+        m->log = fopen(config->log_file, "w");
+        if (m->log == NULL) {
+            fprintf(stderr, "[Error] Failed to open log file: %s\n",
+                    config->log_file);
+            free_measure(m);
+            return BLADERF_ERR_IO;
+        }
+
+        setvbuf(m->log, NULL, _IOFBF, LOG_BUFFER_SIZE);
+
+        fprintf(m->log, "time,sample");
+        for (k = 0; k < config->num_channels; k++) {
+            fprintf(m->log, ",power_dbfs_%u,peak_dbfs_%u,crest_db_%u", k, k, k);
+        }
+        fputc('\n', m->log);
+    }
+
+    /* Hann window */
+    for (k = 0; k < n; k++) {
+        m->window[k] = (float)(0.5 - 0.5 * cos(2 * M_PI * k / n));
+        m->window_power += (double)m->window[k] * m->window[k];
+    }
+
+    if (pthread_mutex_init(&m->lock, NULL) != 0) {
+        free_measure(m);
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    status = pthread_create(&m->thread, NULL,
+                            BLADERF_CHANNEL_IS_TX(config->ch) ? tx_thread
+                                                              : rx_thread,
+                            m);
+    if (status != 0) {
+        pthread_mutex_destroy(&m->lock);
+        free_measure(m);
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    *m_out = m;
+    return 0;
+}
+
+int measure_get_readings(struct measure *m, struct measure_reading *readings)
+{
+    int status;
+
+    pthread_mutex_lock(&m->lock);
+    if (m->readings_valid) {
+        memcpy(readings, m->readings,
+               m->config.num_channels * sizeof(readings[0]));
+    }
+    status = m->status;
+    pthread_mutex_unlock(&m->lock);
+
+    return status;
+}
+
+void measure_enable_spectrum(struct measure *m, bool enable)
+{
+    pthread_mutex_lock(&m->lock);
+    m->spectrum_enabled = enable;
+    m->spectrum_valid   = false;
+    pthread_mutex_unlock(&m->lock);
+}
+
+bool measure_get_spectrum(struct measure *m, float *psd)
+{
+    bool valid;
+
+    pthread_mutex_lock(&m->lock);
+    valid = m->spectrum_valid;
+    if (valid) {
+        memcpy(psd, m->psd, sizeof(m->psd));
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    return valid;
+}
+
+void measure_restart(struct measure *m)
+{
+    pthread_mutex_lock(&m->lock);
+    m->generation++;
+    m->readings_valid = false;
+    m->spectrum_valid = false;
+    pthread_mutex_unlock(&m->lock);
+}
+
+void measure_stop(struct measure *m)
+{
+    if (m == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    m->running = false;
+    pthread_mutex_unlock(&m->lock);
+
+    pthread_join(m->thread, NULL);
+    pthread_mutex_destroy(&m->lock);
+    free_measure(m);
+}
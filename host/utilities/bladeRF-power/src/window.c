@@ -84,6 +84,65 @@ void init_curses(WINDOW **win) {
     *win = newwin(max_y, max_x, 0, 0);
 }
 
+/**
+ * @brief Draws the spectrum as a bar chart.
+ *
+ * Each column shows the highest of the bins that fall within it, so that
+ * narrow signals remain visible however the bins are divided among columns.
+ *
+ * @param win Window to draw in
+ * @param test Test parameters holding the spectrum
+ * @param start_y First row of the chart
+ * @param num_rows Number of rows for the chart, including its labels
+ */
+static void display_spectrum(WINDOW *win, struct test_params *test,
+                             int start_y, int num_rows) {
+    const float DB_MAX = 0.0f;
+    const float DB_MIN = -120.0f;
+    const int LABEL_WIDTH = 6;
+    const int num_cols = getmaxx(win) - 2 - LABEL_WIDTH;
+    const int bar_rows = num_rows - 2;
+
+    if (num_cols <= 0 || bar_rows <= 0) {
+        return;
+    }
+
+    mvwprintw(win, start_y, 1, "Spectrum RX(%i): %0.3f MHz +/- %0.3f MHz",
+        test->channel, test->frequency_actual / 1e6, test->samp_rate / 2e6);
+
+    if (!test->spectrum_valid) {
+        return;
+    }
+
+    mvwprintw(win, start_y + 1, 1, "%4.0f |", DB_MAX);
+    mvwprintw(win, start_y + bar_rows, 1, "%4.0f |", DB_MIN);
+
+    for (int col = 0; col < num_cols; col++) {
+        size_t first = (size_t)col * MEASURE_FFT_SIZE / num_cols;
+        size_t last  = (size_t)(col + 1) * MEASURE_FFT_SIZE / num_cols;
+        float level  = DB_MIN;
+
+        if (last == first) {
+            last = first + 1;
+        }
+
+        for (size_t i = first; i < last; i++) {
+            if (test->spectrum[i] > level) {
+                level = test->spectrum[i];
+            }
+        }
+
+        if (level > DB_MAX) {
+            level = DB_MAX;
+        }
+
+        int height = (int)((level - DB_MIN) / (DB_MAX - DB_MIN) * bar_rows + 0.5f);
+        for (int row = 0; row < height; row++) {
+            mvwaddch(win, start_y + bar_rows - row, 1 + LABEL_WIDTH + col, '#');
+        }
+    }
+}
+
 void update_window(WINDOW *win, struct test_params *test) {
     const size_t MIN_LINES = 10;
     size_t maxy = getmaxy(win);
@@ -92,8 +151,13 @@ void update_window(WINDOW *win, struct test_params *test) {
 
     werase(win);
 
-    mvwprintw(win, start_y++, 1, "Channel:    %s(%i)\n",
-        test->direction == BLADERF_TX ? "TX" : "RX", test->channel);
+    if (test->num_channels == 2) {
+        mvwprintw(win, start_y++, 1, "Channel:    RX(%i, %i)\n",
+            test->channel, test->channel + 1);
+    } else {
+        mvwprintw(win, start_y++, 1, "Channel:    %s(%i)\n",
+            test->direction == BLADERF_TX ? "TX" : "RX", test->channel);
+    }
     mvwprintw(win, start_y++, 1, "Gain Calibration: %s\n", test->gain_cal_enabled ? "enabled" : "disabled");
     mvwprintw(win, start_y++, 1, "Automatic Gain Control: %s\n", test->gain_mode == BLADERF_GAIN_MGC ? "disabled" : "enabled");
     mvwprintw(win, start_y++, 1, "Sample Rate:  %7.3f %sHz\n",
@@ -109,14 +173,35 @@ void update_window(WINDOW *win, struct test_params *test) {
         mvwprintw(win, start_y++, 1, "Output Pwr:  %" PRIi32 "dBm, range: [%" PRIi32 ", %" PRIi32 "]\n",
             test->gain-60, test->gain_min-60, test->gain_max-60);
         display_double(win, test->gain-60, start_y+=2, 1, POWER_SUFFIX_DBM);
-    } else if (test->gain_cal_enabled && test->direction == BLADERF_RX) {
-        mvwprintw(win, start_y++, 1, "Avg Power:   %0.2fdBFS, %0.2fdBm",
-            test->rx_power, rx_power_dbfs_to_dbm(test->rx_power, test->gain));
-        display_double(win, rx_power_dbfs_to_dbm(test->rx_power, test->gain),
-            start_y+=2, 1, POWER_SUFFIX_DBM);
     } else if (test->direction == BLADERF_RX) {
-        mvwprintw(win, start_y++, 1, "Avg Power:   %0.2fdBFS", test->rx_power);
-        display_double(win, test->rx_power, start_y+=2, 1, POWER_SUFFIX_DBFS);
+        const struct measure_reading *r = test->rx_readings;
+
+        mvwprintw(win, start_y, 1, "Avg Power:  ");
+        for (unsigned int i = 0; i < test->num_channels; i++) {
+            if (test->num_channels > 1) {
+                wprintw(win, " RX(%i):", test->channel + i);
+            }
+            wprintw(win, " %0.2fdBFS", r[i].power);
+            if (test->gain_cal_enabled) {
+                wprintw(win, ", %0.2fdBm", rx_power_dbfs_to_dbm(r[i].power, test->gain));
+            }
+        }
+        start_y++;
+
+        mvwprintw(win, start_y, 1, "Peak/Crest: ");
+        for (unsigned int i = 0; i < test->num_channels; i++) {
+            if (test->num_channels > 1) {
+                wprintw(win, " RX(%i):", test->channel + i);
+            }
+            wprintw(win, " %0.2fdBFS / %0.2fdB", r[i].peak, r[i].crest);
+        }
+
+        if (test->gain_cal_enabled) {
+            display_double(win, rx_power_dbfs_to_dbm(r[0].power, test->gain),
+                start_y+=2, 1, POWER_SUFFIX_DBM);
+        } else {
+            display_double(win, r[0].power, start_y+=2, 1, POWER_SUFFIX_DBFS);
+        }
     }
 
     if (test->show_messages) {
@@ -136,9 +221,12 @@ void update_window(WINDOW *win, struct test_params *test) {
             line_start = line_end + 1;
             line_count++;
         }
+    } else if (test->show_spectrum && test->direction == BLADERF_RX) {
+        int spectrum_start_y = 10 + DIGIT_HEIGHT + 1;
+        display_spectrum(win, test, spectrum_start_y, maxy - spectrum_start_y - 3);
     }
 
-    mvwprintw(win, maxy-2, 1, "Keys: [q] Quit, [h/l] Frequency, [j/k] Gain, [c] Toggle Calibration, [a] Toggle AGC, [i] Cal info, [m] Toggle messages\n");
+    mvwprintw(win, maxy-2, 1, "Keys: [q] Quit, [h/l] Frequency, [j/k] Gain, [c] Toggle Calibration, [a] Toggle AGC, [i] Cal info, [m] Toggle messages, [s] Toggle spectrum\n");
     box(win, 0, 0);
 
     if (maxy < MIN_LINES) {